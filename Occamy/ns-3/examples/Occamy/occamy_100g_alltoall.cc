@@ -9,6 +9,7 @@
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/tcp-switch-node.h"
 #include "iostream"
 #include "vector"
 #include "ns3/flow-monitor-helper.h"
@@ -257,6 +258,11 @@ main (int argc, char *argv[])
     
 	cmd.AddValue ("rto", "min Retransmission timeout value in MicroSeconds", rto);
 
+    std::string occOutFile = "";
+    cmd.AddValue ("occOutFile", "File path for switch buffer occupancy percentiles, written once at the end (disabled if empty)", occOutFile);
+    uint64_t occThreshold = 0;
+    cmd.AddValue ("occThreshold", "Occupancy level in bytes, the time spent above it is reported in occOutFile (0 to disable)", occThreshold);
+
 
 
     //create topo============================================
@@ -270,6 +276,8 @@ main (int argc, char *argv[])
     cmd.AddValue ("spineLeafCapacity", "Spine <-> Leaf capacity in Gbps", spineLeafCapacity);
 	cmd.AddValue ("leafServerCapacity", "Leaf <-> Server capacity in Gbps", leafServerCapacity);
 	cmd.AddValue ("linkLatency", "linkLatency in microseconds", linkLatency);
+    bool switchFastPath = false;
+    cmd.AddValue ("switchFastPath", "forward on the leaves and spines with TcpSwitchNode instead of the host IP stack", switchFastPath);
     cmd.Parse (argc, argv);
 
     uint32_t requestSize = requestSizeRate * bufferSize;
@@ -479,9 +487,19 @@ main (int argc, char *argv[])
     }
 
     NodeContainer spines;
-	spines.Create (SPINE_COUNT);
 	NodeContainer leaves;
-	leaves.Create (LEAF_COUNT);
+    if (switchFastPath)
+    {
+        for (uint32_t i = 0; i < SPINE_COUNT; i++)
+            spines.Add (CreateObject<TcpSwitchNode> ());
+        for (uint32_t i = 0; i < LEAF_COUNT; i++)
+            leaves.Add (CreateObject<TcpSwitchNode> ());
+    }
+    else
+    {
+        spines.Create (SPINE_COUNT);
+        leaves.Create (LEAF_COUNT);
+    }
     for (uint32_t i = 0; i < LEAF_COUNT; i++) 
     {
         servers[i].Create (SERVER_COUNT);
@@ -739,8 +757,43 @@ main (int argc, char *argv[])
     flowMonitor = flowHelper.InstallAll();
 
     Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+    NodeContainer switches (spines, leaves);
+    if (occOutFile != "")
+    {
+        std::vector<uint64_t> levels;
+        if (occThreshold > 0)
+        {
+            levels.push_back (occThreshold);
+        }
+        for (uint32_t i = 0; i < switches.GetN (); i++)
+        {
+            switches.Get (i)->m_switch->EnableOccupancyStats (levels);
+            for (uint32_t j = 0; j < 4; j++)
+            {
+                switches.Get (i)->m_switch_group[j]->EnableOccupancyStats (levels);
+            }
+        }
+    }
+
     Simulator::Stop (Seconds (END_TIME+10));
     Simulator::Run ();
+
+    if (occOutFile != "")
+    {
+        std::ofstream occf (occOutFile.c_str ());
+        occf << "occ node mmu kind index queue p50 p99 p999 max nsAbove... nsObserved\n";
+        for (uint32_t i = 0; i < switches.GetN (); i++)
+        {
+            Ptr<Node> sw = switches.Get (i);
+            sw->m_switch->PrintOccupancyStats (occf, sw->GetId ());
+            for (uint32_t j = 0; j < 4; j++)
+            {
+                sw->m_switch_group[j]->PrintOccupancyStats (occf, sw->GetId (), j + 1);
+            }
+        }
+        occf.close ();
+    }
     
 
     std::string resultFolder = "./examples/Occamy/100g_alltoall/";
@@ -9,9 +9,11 @@
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/tcp-switch-node.h"
 #include "iostream"
 #include "vector"
 #include "ns3/flow-monitor-helper.h"
+#include <chrono>
 #include <cmath>
 #include <filesystem>
 
@@ -100,6 +102,16 @@ main (int argc, char *argv[])
     cmd.AddValue ("spineLeafCapacity", "Spine <-> Leaf capacity in Gbps", spineLeafCapacity);
 	cmd.AddValue ("leafServerCapacity", "Leaf <-> Server capacity in Gbps", leafServerCapacity);
 	cmd.AddValue ("linkLatency", "linkLatency in microseconds", linkLatency);
+    std::string flowTrace;
+    cmd.AddValue ("flowTrace", "replay this binary flow trace (see utils/flow-trace-gen.cc) instead of generating the web and request flows", flowTrace);
+    double snapshotTime = 0;
+    cmd.AddValue ("snapshotTime", "fork the simulation into snapshotBranches at this time in seconds, after a shared warm-up (disabled if 0)", snapshotTime);
+    std::string snapshotBranches = "";
+    cmd.AddValue ("snapshotBranches", "branches of the snapshot: name:override,override;name:... where an override is a config path=value (e.g. /NodeList/*/SwitchList/*/QueueAlpha=2) or flowTrace=file to also replay the flows of file after the snapshot; every branch writes <keyName>.<name>.xml", snapshotBranches);
+    uint32_t snapshotParallel = 0;
+    cmd.AddValue ("snapshotParallel", "branches simulated at the same time, 0 for all", snapshotParallel);
+    bool switchFastPath = false;
+    cmd.AddValue ("switchFastPath", "forward on the leaves and spines with TcpSwitchNode instead of the host IP stack", switchFastPath);
     cmd.Parse (argc, argv);
 
     uint32_t requestSize = requestSizeRate * bufferSize;
@@ -238,9 +250,19 @@ main (int argc, char *argv[])
     }
 
     NodeContainer spines;
-	spines.Create (SPINE_COUNT);
 	NodeContainer leaves;
-	leaves.Create (LEAF_COUNT);
+    if (switchFastPath)
+    {
+        for (uint32_t i = 0; i < SPINE_COUNT; i++)
+            spines.Add (CreateObject<TcpSwitchNode> ());
+        for (uint32_t i = 0; i < LEAF_COUNT; i++)
+            leaves.Add (CreateObject<TcpSwitchNode> ());
+    }
+    else
+    {
+        spines.Create (SPINE_COUNT);
+        leaves.Create (LEAF_COUNT);
+    }
 	NodeContainer servers[LEAF_COUNT];
     for (uint32_t i = 0; i < LEAF_COUNT; i++) 
     {
@@ -415,6 +437,83 @@ main (int argc, char *argv[])
     Ptr<SharedMemoryPointToPointNetDevice> emptySharedMemoryPointToPointNetDevice = nullptr;
 
 
+    //trace replay: each flow of the trace is installed when it starts
+    Ptr<FlowTraceReplay> flowReplay;
+    //server addresses by trace id, a lambda can't capture the serverNics array
+    std::vector<Ipv4Address> serverAddress;
+    for (uint32_t leaf = 0; leaf < LEAF_COUNT; leaf++)
+    {
+        for (uint32_t server = 0; server < SERVER_COUNT; server++)
+        {
+            serverAddress.push_back(serverNics[leaf][server].GetAddress (0));
+        }
+    }
+    auto replayFlow = [&](const FlowRecord &f) {
+        uint32_t nServers = LEAF_COUNT * SERVER_COUNT;
+        if (f.src >= nServers || f.dst >= nServers || f.src == f.dst)
+        {
+            std::cout << "Flow " << f.id << " of the trace goes from server " << f.src << " to " << f.dst << ", there are " << nServers << " servers" << std::endl;
+            exit(1);
+        }
+        uint32_t txLeaf = f.src / SERVER_COUNT, txServer = f.src % SERVER_COUNT;
+        uint32_t rxLeaf = f.dst / SERVER_COUNT, rxServer = f.dst % SERVER_COUNT;
+        bool incast = f.flags & FLOW_INCAST;
+        uint16_t port;
+        if (incast)
+        {
+            port = REQUEST_PORT[f.dst]++;
+            if (port > REQUEST_PORT_END)
+            {
+                port = REQUEST_PORT_START;
+                REQUEST_PORT[f.dst] = REQUEST_PORT_START;
+            }
+        }
+        else
+        {
+            port = WEB_PORT[f.dst]++;
+            if (port > WEB_PORT_END)
+            {
+                port = WEB_PORT_START;
+                WEB_PORT[f.dst] = WEB_PORT_START;
+            }
+        }
+        InetSocketAddress ad (serverAddress[f.dst], port);
+        Ptr<BulkSendApplication> bulksend = CreateObject<BulkSendApplication>();
+        bulksend->SetAttribute("Protocol", TypeIdValue(TcpSocketFactory::GetTypeId()));
+        bulksend->SetAttribute ("SendSize", UintegerValue (f.size));
+        bulksend->SetAttribute ("MaxBytes", UintegerValue(f.size));
+        bulksend->SetAttribute("priorityCustom", UintegerValue(f.priority));
+        bulksend->SetAttribute("Remote", AddressValue(Address(ad)));
+        bulksend->SetAttribute("InitialCwnd", UintegerValue (incast ? f.size / PACKET_SIZE + 1 : 120));
+        bulksend->SetAttribute("priority", UintegerValue(f.priority));
+        bulksend->SetStartTime (Seconds (0));
+        bulksend->SetStopTime (Seconds (END_TIME) - Simulator::Now ());
+        servers[txLeaf].Get (txServer)->AddApplication(bulksend);
+
+        PacketSinkHelper sink ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+        ApplicationContainer sinkApp = sink.Install (servers[rxLeaf].Get(rxServer));
+        sinkApp.Get(0)->SetAttribute("TotalQueryBytes", UintegerValue(f.size));
+        sinkApp.Get(0)->SetAttribute("priority", UintegerValue(0)); // ack packets are prioritized
+        sinkApp.Get(0)->SetAttribute("priorityCustom", UintegerValue(0)); // ack packets are prioritized
+        sinkApp.Get(0)->SetAttribute("senderPriority", UintegerValue(f.priority));
+        sinkApp.Start (Seconds (0));
+        sinkApp.Stop (Seconds (END_TIME) - Simulator::Now ());
+
+        uint32_t src_ip = serverAddress[f.src].Get();
+        uint32_t dst_ip = serverAddress[f.dst].Get();
+        emptySharedMemoryPointToPointNetDevice->InsertMap(src_ip,dst_ip,port,f.priority);
+    };
+    if (!flowTrace.empty())
+    {
+        flowReplay = CreateObject<FlowTraceReplay>();
+        flowReplay->Open(flowTrace);
+        flowReplay->SetFlowCallback(FlowTraceReplay::FlowCallback(replayFlow));
+        Simulator::Schedule(Seconds(START_TIME), &FlowTraceReplay::Start, flowReplay);
+        std::cout<<"replaying "<<flowReplay->GetNFlows()<<" flows from "<<flowTrace<<std::endl;
+        webLoad = 0;
+        requestFlowRate = 0;
+    }
+
     //web flow background flow
 
     double oversubRatio = LEAF_SERVER_CAPACITY * SERVER_COUNT / (LEAF_SERVER_CAPACITY * SPINE_COUNT * LINK_COUNT);
@@ -577,10 +676,57 @@ main (int argc, char *argv[])
     FlowMonitorHelper flowHelper;
     flowMonitor = flowHelper.InstallAll();
 
+    //warm-start snapshot: the branches share the simulation up to snapshotTime
+    Ptr<SimulationSnapshot> snapshot;
+    std::vector<Ptr<FlowTraceReplay>> branchReplays;
+    if (snapshotTime > 0)
+    {
+        snapshot = CreateObject<SimulationSnapshot>();
+        snapshot->SetAttribute("MaxParallel", UintegerValue(snapshotParallel));
+        snapshot->AddBranches(snapshotBranches);
+        if (snapshot->GetNBranches() == 0)
+        {
+            std::cout<<"snapshotTime is set without snapshotBranches"<<std::endl;
+            return 1;
+        }
+        auto branch = [&](const std::string &name, const SimulationSnapshot::Overrides &overrides) {
+            for (auto &o : overrides)
+            {
+                if (o.first != "flowTrace")
+                {
+                    std::cout<<"unknown override "<<o.first<<" of branch "<<name<<std::endl;
+                    exit(1);
+                }
+                Ptr<FlowTraceReplay> replay = CreateObject<FlowTraceReplay>();
+                replay->Open(o.second);
+                replay->SetFlowCallback(FlowTraceReplay::FlowCallback(replayFlow));
+                replay->Start();
+                branchReplays.push_back(replay);
+            }
+        };
+        snapshot->SetBranchCallback(SimulationSnapshot::BranchCallback(branch));
+        snapshot->Schedule(Seconds(snapshotTime));
+    }
+
     Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
     Simulator::Stop (Seconds (END_TIME+10));
+    auto wallStart = std::chrono::steady_clock::now();
     Simulator::Run ();
-    
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    std::cout << "events: " << Simulator::GetEventCount() << " wall: " << wall << " s events/sec: "
+              << Simulator::GetEventCount() / wall << std::endl;
+    if (snapshot && snapshot->IsParent())
+    {
+        //the parent only ran the warm-up, the branches write the results
+        uint32_t failed = snapshot->Wait();
+        std::cout<<snapshot->GetNBranches()<<" branches done, "<<failed<<" failed"<<std::endl;
+        Simulator::Destroy ();
+        return failed ? 1 : 0;
+    }
+    if (snapshot)
+    {
+        keyName = snapshot->GetOutputPath(keyName);
+    }
 
     std::string resultFolder = "./examples/Occamy/100g_benchmark/";
     if (!fs::exists(resultFolder)) {
@@ -9,6 +9,7 @@
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/tcp-switch-node.h"
 #include "iostream"
 #include "vector"
 #include "ns3/flow-monitor-helper.h"
@@ -100,6 +101,8 @@ main (int argc, char *argv[])
     cmd.AddValue ("spineLeafCapacity", "Spine <-> Leaf capacity in Gbps", spineLeafCapacity);
 	cmd.AddValue ("leafServerCapacity", "Leaf <-> Server capacity in Gbps", leafServerCapacity);
 	cmd.AddValue ("linkLatency", "linkLatency in microseconds", linkLatency);
+    bool switchFastPath = false;
+    cmd.AddValue ("switchFastPath", "forward on the leaves and spines with TcpSwitchNode instead of the host IP stack", switchFastPath);
     cmd.Parse (argc, argv);
 
     uint32_t requestSize = requestSizeRate * bufferSize;
@@ -238,9 +241,19 @@ main (int argc, char *argv[])
     }
 
     NodeContainer spines;
-	spines.Create (SPINE_COUNT);
 	NodeContainer leaves;
-	leaves.Create (LEAF_COUNT);
+    if (switchFastPath)
+    {
+        for (uint32_t i = 0; i < SPINE_COUNT; i++)
+            spines.Add (CreateObject<TcpSwitchNode> ());
+        for (uint32_t i = 0; i < LEAF_COUNT; i++)
+            leaves.Add (CreateObject<TcpSwitchNode> ());
+    }
+    else
+    {
+        spines.Create (SPINE_COUNT);
+        leaves.Create (LEAF_COUNT);
+    }
 	NodeContainer servers[LEAF_COUNT];
     for (uint32_t i = 0; i < LEAF_COUNT; i++) 
     {
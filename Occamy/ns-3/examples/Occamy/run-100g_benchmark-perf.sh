@@ -0,0 +1,39 @@
+echo "simulator speed of each buffer scheme on the 100g benchmark"
+
+cd ../../
+SERVERS=16
+LEAVES=8
+SPINES=8
+LINKS=1
+SERVER_LEAF_CAP=100
+LEAF_SPINE_CAP=100
+LATENCY=10
+BUFFER_PER_PORT_PER_GBPS=5.12
+
+
+nPrior=2
+requestFlowRate=200.0
+
+bufferSize=$(python3 -c "print(int($BUFFER_PER_PORT_PER_GBPS*1024*8*$SERVER_LEAF_CAP))")
+method_array=("DT" "ABM" "PUSHOUT" "pBuffer")
+tcpProtocol=DCTCP
+webLoad=0.9
+requestSizeRate=0.5
+
+# one run at a time, so the wall clock times are comparable
+for method in ${method_array[*]};do
+    alpha=1.0
+    if [ "$method" == "pBuffer" ]
+    then
+        alpha=8.0
+    fi
+    if [ "$method" == "ABM" ]
+    then
+        alpha=2.0
+    fi
+    # with the switches on the host IP stack and on the TcpSwitchNode fast path
+    for fastPath in false true;do
+        echo -n "${method} switchFastPath=${fastPath}: "
+        ./ns3 run "examples/Occamy/occamy_100g_benchmark.cc --method=${method} --alpha=${alpha} --tcpProtocol=${tcpProtocol} --webLoad=${webLoad} --requestSizeRate=${requestSizeRate} --requestFlowRate=${requestFlowRate} --bufferSize=${bufferSize} --nPrior=${nPrior} --switchFastPath=${fastPath}" | grep "events/sec"
+    done
+done
@@ -1321,6 +1321,154 @@ Ipv4GlobalRoutingSlash32TestCase::DoRun()
     Simulator::Destroy();
 }
 
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief IPv4 GlobalRouting compiled forwarding table test
+ *
+ * Overlapping network routes, a host route and external routes: the lookups must
+ * find the routes of the scan of the route lists, before and after the routes change.
+ */
+class Ipv4GlobalRoutingCompiledFibTestCase : public TestCase
+{
+  public:
+    Ipv4GlobalRoutingCompiledFibTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * \brief Route a packet to dest.
+     * \param dest destination address
+     * \param oif output device, or nullptr for the compiled table
+     * \return the route, nullptr if none
+     */
+    Ptr<Ipv4Route> Lookup(std::string dest, Ptr<NetDevice> oif = nullptr);
+
+    Ptr<Ipv4GlobalRouting> m_routing; //!< routing under test
+};
+
+Ipv4GlobalRoutingCompiledFibTestCase::Ipv4GlobalRoutingCompiledFibTestCase()
+    : TestCase("Compiled forwarding table of global routing")
+{
+}
+
+Ptr<Ipv4Route>
+Ipv4GlobalRoutingCompiledFibTestCase::Lookup(std::string dest, Ptr<NetDevice> oif)
+{
+    Ipv4Header header;
+    header.SetDestination(Ipv4Address(dest.c_str()));
+    header.SetProtocol(17);
+    Socket::SocketErrno sockerr;
+    Ptr<Ipv4Route> route = m_routing->RouteOutput(Create<Packet>(), header, oif, sockerr);
+    NS_TEST_EXPECT_MSG_EQ((sockerr == Socket::ERROR_NOTERROR),
+                          bool(route),
+                          "Wrong socket error for " << dest);
+    return route;
+}
+
+void
+Ipv4GlobalRoutingCompiledFibTestCase::DoRun()
+{
+    Ptr<Node> node = CreateObject<Node>();
+    InternetStackHelper internet;
+    internet.Install(node);
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+    for (uint32_t i = 1; i <= 3; i++)
+    {
+        Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice>();
+        device->SetAddress(Mac48Address::Allocate());
+        node->AddDevice(device);
+        int32_t ifIndex = ipv4->AddInterface(device);
+        std::ostringstream addr;
+        addr << "10.0." << i << ".1";
+        ipv4->AddAddress(ifIndex,
+                         Ipv4InterfaceAddress(Ipv4Address(addr.str().c_str()), Ipv4Mask("/24")));
+        ipv4->SetUp(ifIndex);
+    }
+
+    m_routing = CreateObject<Ipv4GlobalRouting>();
+    m_routing->SetIpv4(ipv4);
+    m_routing->AddHostRouteTo(Ipv4Address("10.1.2.3"), Ipv4Address("10.0.3.2"), 3);
+    m_routing->AddNetworkRouteTo(Ipv4Address("10.1.0.0"),
+                                 Ipv4Mask("/16"),
+                                 Ipv4Address("10.0.1.2"),
+                                 1);
+    m_routing->AddNetworkRouteTo(Ipv4Address("10.1.2.0"),
+                                 Ipv4Mask("/24"),
+                                 Ipv4Address("10.0.2.2"),
+                                 2);
+    m_routing->AddNetworkRouteTo(Ipv4Address("10.0.0.0"),
+                                 Ipv4Mask("/8"),
+                                 Ipv4Address("10.0.3.2"),
+                                 3);
+    m_routing->AddASExternalRouteTo(Ipv4Address("192.168.0.0"),
+                                    Ipv4Mask("/16"),
+                                    Ipv4Address("10.0.2.2"),
+                                    2);
+    m_routing->AddASExternalRouteTo(Ipv4Address("192.168.1.0"),
+                                    Ipv4Mask("/24"),
+                                    Ipv4Address("10.0.1.2"),
+                                    1);
+
+    // host route first, then the first of all the matching network routes (not the longest
+    // prefix), then the first matching external route
+    const char* dests[] = {"10.1.2.3", "10.1.2.4", "10.1.9.9", "10.9.0.1", "192.168.1.1"};
+    const char* gateways[] = {"10.0.3.2", "10.0.1.2", "10.0.1.2", "10.0.3.2", "10.0.2.2"};
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        Ptr<Ipv4Route> route = Lookup(dests[i]);
+        NS_TEST_ASSERT_MSG_NE(route, nullptr, "No route to " << dests[i]);
+        NS_TEST_EXPECT_MSG_EQ(route->GetGateway(),
+                              Ipv4Address(gateways[i]),
+                              "Wrong gateway to " << dests[i]);
+        uint32_t interface = ipv4->GetInterfaceForDevice(route->GetOutputDevice());
+        NS_TEST_EXPECT_MSG_EQ(route->GetSource(),
+                              ipv4->GetAddress(interface, 0).GetLocal(),
+                              "Wrong source to " << dests[i]);
+        // the scan of the lists, restricted to the output device, finds the same route
+        Ptr<Ipv4Route> linear = Lookup(dests[i], route->GetOutputDevice());
+        NS_TEST_ASSERT_MSG_NE(linear, nullptr, "No linear route to " << dests[i]);
+        NS_TEST_EXPECT_MSG_EQ(linear->GetGateway(),
+                              route->GetGateway(),
+                              "Linear lookup disagrees for " << dests[i]);
+    }
+    NS_TEST_EXPECT_MSG_EQ(Lookup("172.16.0.1"), nullptr, "Unexpected route to 172.16.0.1");
+
+    // removing the host route and adding a route recompile the table
+    m_routing->RemoveRoute(0);
+    NS_TEST_EXPECT_MSG_EQ(Lookup("10.1.2.3")->GetGateway(),
+                          Ipv4Address("10.0.1.2"),
+                          "Host route still used after removal");
+    m_routing->AddNetworkRouteTo(Ipv4Address("172.16.0.0"),
+                                 Ipv4Mask("/12"),
+                                 Ipv4Address("10.0.2.2"),
+                                 2);
+    Ptr<Ipv4Route> route = Lookup("172.16.0.1");
+    NS_TEST_ASSERT_MSG_NE(route, nullptr, "No route to 172.16.0.1 after adding it");
+    NS_TEST_EXPECT_MSG_EQ(route->GetGateway(), Ipv4Address("10.0.2.2"), "Wrong added route");
+
+    // a non-contiguous mask falls back to the scan of the lists
+    m_routing->AddNetworkRouteTo(Ipv4Address("192.0.0.5"),
+                                 Ipv4Mask("255.255.0.255"),
+                                 Ipv4Address("10.0.3.2"),
+                                 3);
+    route = Lookup("192.0.7.5");
+    NS_TEST_ASSERT_MSG_NE(route, nullptr, "No route with a non-contiguous mask");
+    NS_TEST_EXPECT_MSG_EQ(route->GetGateway(),
+                          Ipv4Address("10.0.3.2"),
+                          "Wrong route with a non-contiguous mask");
+    NS_TEST_EXPECT_MSG_EQ(Lookup("192.0.7.6"), nullptr, "Unexpected route to 192.0.7.6");
+    NS_TEST_EXPECT_MSG_EQ(Lookup("10.1.2.4")->GetGateway(),
+                          Ipv4Address("10.0.1.2"),
+                          "Wrong route with a non-contiguous mask in the table");
+
+    m_routing->Dispose();
+    m_routing = nullptr;
+    Simulator::Destroy();
+}
+
 /**
  * \ingroup internet-test
  * \ingroup tests
@@ -1344,6 +1492,7 @@ Ipv4GlobalRoutingTestSuite::Ipv4GlobalRoutingTestSuite()
     AddTestCase(new TwoBridgeTest, TestCase::QUICK);
     AddTestCase(new Ipv4DynamicGlobalRoutingTestCase, TestCase::QUICK);
     AddTestCase(new Ipv4GlobalRoutingSlash32TestCase, TestCase::QUICK);
+    AddTestCase(new Ipv4GlobalRoutingCompiledFibTestCase, TestCase::QUICK);
 }
 
 static Ipv4GlobalRoutingTestSuite
@@ -19,6 +19,9 @@
 #include "ns3/tcp-rx-buffer.h"
 #include "ns3/test.h"
 
+#include <random>
+#include <sstream>
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("TcpRxBufferTestSuite");
@@ -294,6 +297,180 @@ TcpRxBufferTestCase::DoTeardown()
 {
 }
 
+/**
+ * \ingroup internet-tests
+ * \ingroup tests
+ *
+ * \brief Adds random, overlapping and out of order segments to a TcpRxBuffer and extracts
+ * from it, and checks after each step what Add returns, the next expected sequence, the
+ * occupancy, the available bytes, the SACK blocks and the extracted bytes against a model
+ * that keeps one flag per byte.
+ *
+ * Every byte carries its sequence number modulo 251, so that a byte stored twice or at the
+ * wrong place shows up in the extracted data.
+ */
+class TcpRxBufferReassemblyTestCase : public TestCase
+{
+  public:
+    TcpRxBufferReassemblyTestCase();
+
+  private:
+    void DoRun() override;
+
+    /// Compares the buffer with the model, returns the first difference or an empty string
+    std::string Check(const TcpRxBuffer& rxBuf) const;
+    /// Whether the byte at seq is stored in the model
+    bool IsStored(uint32_t seq) const;
+
+    static constexpr uint32_t FIRST_SEQ = 1;
+    static constexpr uint32_t MAX_BUFFER = 32768;
+    static constexpr uint32_t STEPS = 20000;
+
+    std::vector<bool> m_stored; //!< per byte from FIRST_SEQ, received and not extracted
+    uint32_t m_size;            //!< bytes stored
+    uint32_t m_next;            //!< first byte not received in sequence
+    uint32_t m_read;            //!< first byte not extracted
+};
+
+TcpRxBufferReassemblyTestCase::TcpRxBufferReassemblyTestCase()
+    : TestCase("TcpRxBuffer reassembly against a byte map"),
+      m_size(0),
+      m_next(FIRST_SEQ),
+      m_read(FIRST_SEQ)
+{
+}
+
+bool
+TcpRxBufferReassemblyTestCase::IsStored(uint32_t seq) const
+{
+    return seq - FIRST_SEQ < m_stored.size() && m_stored[seq - FIRST_SEQ];
+}
+
+std::string
+TcpRxBufferReassemblyTestCase::Check(const TcpRxBuffer& rxBuf) const
+{
+    std::ostringstream diff;
+    auto compare = [&diff](const char* what, uint32_t actual, uint32_t expected) {
+        if (diff.tellp() == 0 && actual != expected)
+        {
+            diff << what << " " << actual << " instead of " << expected;
+        }
+    };
+    compare("NextRxSequence", rxBuf.NextRxSequence().GetValue(), m_next);
+    compare("Size", rxBuf.Size(), m_size);
+    compare("Available", rxBuf.Available(), m_next - m_read);
+    for (const auto& block : rxBuf.GetSackList())
+    {
+        compare("SACK block above NextRxSequence", block.first > rxBuf.NextRxSequence(), true);
+        for (uint32_t seq = block.first.GetValue(); seq < block.second.GetValue(); seq++)
+        {
+            compare("SACK block stored", IsStored(seq), true);
+        }
+    }
+    return diff.str();
+}
+
+void
+TcpRxBufferReassemblyTestCase::DoRun()
+{
+    TcpRxBuffer rxBuf;
+    rxBuf.SetNextRxSequence(SequenceNumber32(FIRST_SEQ));
+    rxBuf.SetMaxBufferSize(MAX_BUFFER);
+
+    std::mt19937_64 rng(1);
+    std::vector<uint8_t> data;
+    uint32_t embedded = 0; // segments that covered stored ones on both sides
+    for (uint32_t step = 0; step < STEPS; step++)
+    {
+        if (rng() % 4 == 0)
+        {
+            uint32_t maxSize = rng() % 8000;
+            Ptr<Packet> p = rxBuf.Extract(maxSize);
+            uint32_t expected = std::min(maxSize, m_next - m_read);
+            NS_TEST_EXPECT_MSG_EQ((p ? p->GetSize() : 0), expected, "extracted, step " << step);
+            if (p && p->GetSize() == expected)
+            {
+                data.resize(expected);
+                p->CopyData(data.data(), expected);
+                for (uint32_t j = 0; j < expected; j++)
+                {
+                    if (data[j] != (m_read + j) % 251)
+                    {
+                        NS_TEST_EXPECT_MSG_EQ(uint32_t(data[j]),
+                                              (m_read + j) % 251,
+                                              "extracted byte " << m_read + j);
+                        return;
+                    }
+                    m_stored[m_read + j - FIRST_SEQ] = false;
+                }
+                m_read += expected;
+                m_size -= expected;
+            }
+        }
+        else
+        {
+            uint32_t head = std::max<int64_t>(FIRST_SEQ, int64_t(m_next) + rng() % 32000 - 2000);
+            uint32_t length = rng() % 3000 + 1;
+            data.resize(length);
+            for (uint32_t j = 0; j < length; j++)
+            {
+                data[j] = (head + j) % 251;
+            }
+            TcpHeader h;
+            h.SetSequenceNumber(SequenceNumber32(head));
+
+            // the bytes from NextRxSequence to the first stored one plus the buffer size
+            uint32_t first = std::max(head, m_next);
+            uint32_t last = head + length;
+            for (uint32_t seq = m_read; seq - FIRST_SEQ < m_stored.size(); seq++)
+            {
+                if (IsStored(seq))
+                {
+                    last = std::min(last, seq + MAX_BUFFER);
+                    break;
+                }
+            }
+            bool added = false;
+            bool storedAfterAdded = false;
+            bool addedAfterStored = false;
+            for (uint32_t seq = first; seq < last; seq++)
+            {
+                if (IsStored(seq))
+                {
+                    storedAfterAdded = storedAfterAdded || added;
+                }
+                else
+                {
+                    addedAfterStored = addedAfterStored || storedAfterAdded;
+                    if (seq - FIRST_SEQ >= m_stored.size())
+                    {
+                        m_stored.resize(seq - FIRST_SEQ + 1);
+                    }
+                    m_stored[seq - FIRST_SEQ] = true;
+                    m_size++;
+                    added = true;
+                }
+            }
+            embedded += addedAfterStored;
+            while (IsStored(m_next))
+            {
+                m_next++;
+            }
+            NS_TEST_EXPECT_MSG_EQ(rxBuf.Add(Create<Packet>(data.data(), length), h),
+                                  added,
+                                  "Add, step " << step);
+        }
+        std::string diff = Check(rxBuf);
+        NS_TEST_EXPECT_MSG_EQ(diff, "", "step " << step);
+        if (!diff.empty())
+        {
+            return; // the model is off from here on
+        }
+    }
+    NS_TEST_EXPECT_MSG_GT(m_read, 10 * MAX_BUFFER, "extracted bytes");
+    NS_TEST_EXPECT_MSG_GT(embedded, 100, "segments over stored ones");
+}
+
 /**
  * \ingroup internet-test
  * \ingroup tests
@@ -307,6 +484,7 @@ class TcpRxBufferTestSuite : public TestSuite
         : TestSuite("tcp-rx-buffer", UNIT)
     {
         AddTestCase(new TcpRxBufferTestCase, TestCase::QUICK);
+        AddTestCase(new TcpRxBufferReassemblyTestCase, TestCase::QUICK);
     }
 };
 
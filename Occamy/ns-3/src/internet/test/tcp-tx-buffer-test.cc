@@ -21,6 +21,8 @@
 #include "ns3/test.h"
 
 #include <limits>
+#include <random>
+#include <sstream>
 
 using namespace ns3;
 
@@ -430,6 +432,327 @@ TcpTxBufferTestCase::DoTeardown()
 {
 }
 
+/**
+ * \ingroup internet-tests
+ * \ingroup tests
+ *
+ * \brief Drives a TcpTxBuffer of one segment items with random sends, SACK blocks, cumulative
+ * ACKs, retransmissions, RTOs and resets, and checks after each step the sacked, lost and
+ * retransmitted counts, NextSeg in and out of recovery, and IsRetransmittedDataAcked against
+ * a model that walks the whole scoreboard, as the buffer did before it learnt to stop early.
+ *
+ * A segment is lost once dupThresh segments above it, up to the highest sacked one, are
+ * sacked; lost and sacked flags stay until the segment is sacked, acked or reset. The highest
+ * sacked segment is the last one newly sacked that is above it or right below it, as in the
+ * buffer. The SACK blocks come in random order, so the buffer sees blocks above and below it.
+ */
+class TcpTxBufferScoreboardTestCase : public TestCase
+{
+  public:
+    /** \brief Constructor */
+    TcpTxBufferScoreboardTestCase();
+
+  private:
+    void DoRun() override;
+
+    /// Flags of a sent segment in the model
+    struct Segment
+    {
+        bool sacked{false};  //!< sacked
+        bool lost{false};    //!< marked lost
+        bool retrans{false}; //!< retransmitted
+    };
+
+    /// Marks the segments with dupThresh sacked segments above them, up to the highest, lost
+    void MarkLost();
+    /// Compares the buffer with the model, returns the first difference or an empty string
+    std::string Check(Ptr<TcpTxBuffer> txBuf) const;
+    /**
+     * \brief Callback to provide a value of receiver window
+     * \returns the receiver window size
+     */
+    uint32_t GetRWnd() const;
+
+    static constexpr uint32_t MSS = 1000;
+    static constexpr uint32_t DUP_THRESH = 3;
+    static constexpr uint32_t MAX_SENT = 200; //!< segments in flight at most
+    static constexpr uint32_t STEPS = 20000;
+
+    std::vector<Segment> m_sent; //!< sent segments, from SND.UNA
+    int32_t m_highestSack;       //!< index of the highest sacked segment, -1 if none
+    uint32_t m_una;              //!< sequence of the first sent segment
+    uint32_t m_unsent;           //!< bytes added and not sent yet
+    uint32_t m_rWnd;             //!< receiver window
+};
+
+TcpTxBufferScoreboardTestCase::TcpTxBufferScoreboardTestCase()
+    : TestCase("TcpTxBuffer scoreboard against a full walk"),
+      m_highestSack(-1),
+      m_una(1),
+      m_unsent(0),
+      m_rWnd(0)
+{
+}
+
+uint32_t
+TcpTxBufferScoreboardTestCase::GetRWnd() const
+{
+    return m_rWnd;
+}
+
+void
+TcpTxBufferScoreboardTestCase::MarkLost()
+{
+    uint32_t sacked = 0;
+    for (int32_t i = m_highestSack; i >= 0; i--)
+    {
+        if (sacked >= DUP_THRESH && !m_sent[i].sacked)
+        {
+            m_sent[i].lost = true;
+        }
+        if (m_sent[i].sacked)
+        {
+            sacked++;
+        }
+    }
+}
+
+std::string
+TcpTxBufferScoreboardTestCase::Check(Ptr<TcpTxBuffer> txBuf) const
+{
+    std::ostringstream diff;
+    auto compare = [&diff](const char* what, uint32_t actual, uint32_t expected) {
+        if (diff.tellp() == 0 && actual != expected)
+        {
+            diff << what << " " << actual << " instead of " << expected;
+        }
+    };
+    uint32_t sacked = 0;
+    uint32_t lost = 0;
+    uint32_t retrans = 0;
+    for (const auto& s : m_sent)
+    {
+        sacked += s.sacked ? MSS : 0;
+        lost += s.lost ? MSS : 0;
+        retrans += s.retrans ? MSS : 0;
+    }
+    compare("sacked bytes", txBuf->GetSacked(), sacked);
+    compare("lost bytes", txBuf->GetLost(), lost);
+    compare("retransmitted bytes", txBuf->GetRetransmitsCount(), retrans);
+
+    uint32_t sentSize = m_sent.size() * MSS;
+    for (bool isRecovery : {false, true})
+    {
+        // RFC 6675 NextSeg: (1) the first lost segment neither retransmitted nor sacked, (2)
+        // new data, (3) in recovery, the first segment neither retransmitted nor sacked
+        bool found = false;
+        uint32_t seq = 0;
+        uint32_t seqHigh = 0;
+        for (uint32_t i = 0; i < m_sent.size() && !found; i++)
+        {
+            if (!m_sent[i].retrans && !m_sent[i].sacked && m_sent[i].lost)
+            {
+                found = true;
+                seq = m_una + i * MSS;
+                seqHigh = seq + MSS;
+            }
+        }
+        if (!found && m_unsent > 0)
+        {
+            found = sentSize <= m_rWnd;
+            seq = m_una + sentSize;
+            seqHigh = found ? seq + std::min(MSS, m_rWnd - sentSize) : 0;
+        }
+        else if (!found && isRecovery)
+        {
+            for (uint32_t i = 0; i < m_sent.size() && !found; i++)
+            {
+                if (!m_sent[i].retrans && !m_sent[i].sacked)
+                {
+                    found = true;
+                    seq = m_una + i * MSS;
+                    seqHigh = seq + MSS;
+                }
+            }
+        }
+        SequenceNumber32 nextSeq;
+        SequenceNumber32 nextSeqHigh;
+        bool nextFound = txBuf->NextSeg(&nextSeq, &nextSeqHigh, isRecovery);
+        compare(isRecovery ? "NextSeg in recovery found" : "NextSeg found", nextFound, found);
+        if (found && nextFound)
+        {
+            compare("NextSeg seq", nextSeq.GetValue(), seq);
+            compare("NextSeg seqHigh", nextSeqHigh.GetValue(), seqHigh);
+        }
+    }
+
+    for (uint32_t i = 0; i <= m_sent.size(); i++)
+    {
+        bool acked = i > 0 && !m_sent[i - 1].sacked && m_sent[i - 1].retrans;
+        compare("IsRetransmittedDataAcked",
+                txBuf->IsRetransmittedDataAcked(SequenceNumber32(m_una + i * MSS)),
+                acked);
+    }
+    return diff.str();
+}
+
+void
+TcpTxBufferScoreboardTestCase::DoRun()
+{
+    Ptr<TcpTxBuffer> txBuf = CreateObject<TcpTxBuffer>();
+    txBuf->SetRWndCallback(MakeCallback(&TcpTxBufferScoreboardTestCase::GetRWnd, this));
+    txBuf->SetHeadSequence(SequenceNumber32(m_una));
+    txBuf->SetSegmentSize(MSS);
+    txBuf->SetDupAckThresh(DUP_THRESH);
+    txBuf->SetMaxBufferSize(std::numeric_limits<uint32_t>::max());
+
+    std::mt19937_64 rng(1);
+    uint32_t seen[3] = {0, 0, 0}; // lost, sacked and retransmitted segments over the steps
+    for (uint32_t step = 0; step < STEPS; step++)
+    {
+        uint32_t n = m_sent.size();
+        m_rWnd = rng() % 8 == 0 ? (rng() % (MAX_SENT + 1)) * MSS
+                                : std::numeric_limits<uint32_t>::max();
+        uint32_t op = rng() % 100;
+        if (op < 10)
+        {
+            // nothing to add every other 500 steps, so that rule (3) of NextSeg gets its turn
+            if ((step / 500) % 2 == 1)
+            {
+                uint32_t bytes = (rng() % 6 + 1) * MSS;
+                txBuf->Add(Create<Packet>(bytes));
+                m_unsent += bytes;
+            }
+        }
+        else if (op < 45)
+        {
+            if (m_unsent > 0 && n < MAX_SENT)
+            {
+                txBuf->CopyFromSequence(MSS, SequenceNumber32(m_una + n * MSS));
+                m_sent.emplace_back();
+                m_unsent -= MSS;
+            }
+        }
+        else if (op < 70)
+        {
+            if (n >= 2)
+            {
+                TcpOptionSack::SackList list;
+                bool newlySacked = false;
+                for (uint32_t b = rng() % 3 + 1; b > 0; b--)
+                {
+                    uint32_t first = rng() % (n - 1) + 1;
+                    uint32_t last = std::min<uint32_t>(n, first + rng() % 4 + 1);
+                    list.emplace_back(SequenceNumber32(m_una + first * MSS),
+                                      SequenceNumber32(m_una + last * MSS));
+                    for (uint32_t i = first; i < last; i++)
+                    {
+                        if (!m_sent[i].sacked && m_highestSack <= int32_t(i) + 1)
+                        {
+                            m_highestSack = i;
+                        }
+                        newlySacked = newlySacked || !m_sent[i].sacked;
+                        m_sent[i].sacked = true;
+                        m_sent[i].lost = false;
+                    }
+                }
+                txBuf->Update(list);
+                if (newlySacked)
+                {
+                    MarkLost();
+                }
+            }
+        }
+        else if (op < 75)
+        {
+            if (n > 0)
+            {
+                // up to a hole, the head is never sacked
+                uint32_t k = 1;
+                while (k < n && m_sent[k].sacked)
+                {
+                    k++;
+                }
+                txBuf->DiscardUpTo(SequenceNumber32(m_una + k * MSS));
+                m_sent.erase(m_sent.begin(), m_sent.begin() + k);
+                m_una += k * MSS;
+                m_highestSack = std::max(m_highestSack - int32_t(k), -1);
+            }
+        }
+        else if (op < 95)
+        {
+            SequenceNumber32 seq;
+            SequenceNumber32 seqHigh;
+            uint32_t i = n;
+            if (rng() % 2 == 0)
+            {
+                if (txBuf->NextSeg(&seq, &seqHigh, true))
+                {
+                    i = (seq.GetValue() - m_una) / MSS;
+                }
+            }
+            else if (n > 0)
+            {
+                i = rng() % n;
+                while (i < n && m_sent[i].sacked)
+                {
+                    i++;
+                }
+            }
+            if (i < n)
+            {
+                txBuf->CopyFromSequence(MSS, SequenceNumber32(m_una + i * MSS));
+                m_sent[i].retrans = true;
+            }
+        }
+        else if (op < 98)
+        {
+            bool resetSack = rng() % 2 == 0;
+            txBuf->SetSentListLost(resetSack);
+            m_highestSack = resetSack ? -1 : m_highestSack;
+            for (auto& s : m_sent)
+            {
+                s.sacked = s.sacked && !resetSack;
+                s.lost = !s.sacked;
+                s.retrans = false;
+            }
+        }
+        else if (op < 99)
+        {
+            txBuf->ResetSentList();
+            m_unsent += n * MSS;
+            m_sent.clear();
+            m_highestSack = -1;
+        }
+        else
+        {
+            // as the socket does when the segment it just got could not be sent
+            if (n > 0 && !m_sent.back().sacked && !m_sent.back().lost && !m_sent.back().retrans)
+            {
+                txBuf->ResetLastSegmentSent();
+                m_unsent += MSS;
+                m_sent.pop_back();
+            }
+        }
+
+        for (const auto& s : m_sent)
+        {
+            seen[0] += s.lost;
+            seen[1] += s.sacked;
+            seen[2] += s.retrans;
+        }
+        std::string diff = Check(txBuf);
+        NS_TEST_EXPECT_MSG_EQ(diff, "", "step " << step << ": " << *txBuf);
+        if (!diff.empty())
+        {
+            return; // the model is off from here on
+        }
+    }
+    NS_TEST_ASSERT_MSG_GT(seen[0], STEPS, "lost segments");
+    NS_TEST_ASSERT_MSG_GT(seen[1], STEPS, "sacked segments");
+    NS_TEST_ASSERT_MSG_GT(seen[2], STEPS, "retransmitted segments");
+}
+
 /**
  * \ingroup internet-test
  * \ingroup tests
@@ -443,6 +766,7 @@ class TcpTxBufferTestSuite : public TestSuite
         : TestSuite("tcp-tx-buffer", UNIT)
     {
         AddTestCase(new TcpTxBufferTestCase, TestCase::QUICK);
+        AddTestCase(new TcpTxBufferScoreboardTestCase, TestCase::QUICK);
     }
 };
 
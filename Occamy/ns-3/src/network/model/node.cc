@@ -84,7 +84,13 @@ Node::GetTypeId()
                 TypeId::ATTR_GET | TypeId::ATTR_SET,
                 UintegerValue(0),
                 MakeUintegerAccessor(&Node::m_sid),
-                MakeUintegerChecker<uint32_t>());
+                MakeUintegerChecker<uint32_t>())
+            .AddAttribute("SwitchList",
+                          "The switch MMUs of this node, m_switch then m_switch_group.",
+                          TypeId::ATTR_GET,
+                          ObjectVectorValue(),
+                          MakeObjectVectorAccessor(&Node::GetSwitch, &Node::GetNSwitches),
+                          MakeObjectVectorChecker<Switch>());
     return tid;
 }
 
@@ -417,6 +423,18 @@ Node::SetNodeType(uint32_t type)
         m_switch_group[3] = CreateObject<Switch>();
 	}
 }
+uint32_t
+Node::GetNSwitches() const
+{
+    return m_node_type == 1 ? 5 : 0;
+}
+
+Ptr<Switch>
+Node::GetSwitch(uint32_t i) const
+{
+    return i == 0 ? m_switch : m_switch_group[i - 1];
+}
+
 uint32_t 
 Node::GetNodeType()
 {
@@ -70,6 +70,10 @@ class Node : public Object
     //tomahawk has 32 ports, 8 ports has a mmus
     Ptr<Switch> m_switch_group[4];
 
+    //m_switch then m_switch_group, none on a host
+    uint32_t GetNSwitches() const;
+    Ptr<Switch> GetSwitch(uint32_t i) const;
+
     //query detail
     bool m_queryLossFlag = false;
     std::string m_queryLossFileName = "loss.txt";
@@ -242,7 +246,9 @@ class Node : public Object
     void DoDispose() override;
     void DoInitialize() override;
 
-  private:
+    /* Modification */
+    // protected, so that a switch node can take over the receive path of its devices
+    /* Modification */
     /**
      * \brief Notifies all the DeviceAdditionListener about the new device added.
      * \param device the added device to notify.
@@ -296,6 +302,9 @@ class Node : public Object
                            NetDevice::PacketType packetType,
                            bool promisc);
 
+    /* Modification */
+  private:
+    /* Modification */
     /**
      * \brief Finish node's construction by setting the correct node ID.
      */
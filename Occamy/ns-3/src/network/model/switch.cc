@@ -1,4 +1,6 @@
+#include "ns3/double.h"
 #include "ns3/log.h"
+#include "ns3/simulator.h"
 #include "switch.h"
 #include "iostream"
 
@@ -13,6 +15,12 @@ TypeId Switch::GetTypeId (void)
     static TypeId tid = TypeId ("ns3::Switch")
         .SetParent<Object> ()
         .SetGroupName("Network")
+        .AddAttribute ("QueueAlpha",
+                       "DT alpha of all the queues, as SetQueueAlpha with the same value for every queue",
+                       TypeId::ATTR_GET | TypeId::ATTR_SET,
+                       DoubleValue (1),
+                       MakeDoubleAccessor (&Switch::SetAllQueueAlpha, &Switch::GetQueueAlpha),
+                       MakeDoubleChecker<double> (0))
     ;
     return tid;
 }
@@ -37,9 +45,15 @@ Switch::Switch(){
 
         for(uint32_t j = 0; j<portCnt;j++){
             saturated[j][i] = 0;        //there is on congestion queue at the beginning, so every port every queue is 0
+            m_qUsedBuffer[j][i] = 0;
         }
     }
 
+    for(uint32_t j = 0; j<portCnt;j++){
+        m_portUsedBuffer[j] = 0;
+    }
+    m_occStats = false;
+
     for(uint32_t i=0;i<priorityCnt;i++){
         N[i] = 0;      //the NP is 0, there is no congestion queue at the beginning
     }
@@ -56,18 +70,87 @@ void Switch::SetBuffer(int maxBuffer,int usedBuffer){
   
 }
 
-void Switch::AddUsed(int size, int qNo){      //this means a packet enqueue
+void Switch::AddUsed(int size, int qNo, uint32_t port){      //this means a packet enqueue
     m_usedBuffer = m_usedBuffer + size;
     int priority = qToP[qNo];
     pUsedBuffer[priority] = pUsedBuffer[priority] + size;
-  
+    if(m_occStats){
+        m_qUsedBuffer[port][qNo] += size;
+        m_portUsedBuffer[port] += size;
+        RecordOccupancy(port, qNo, priority);
+    }
 }
 
-void Switch::DeleteUsed(int size, int qNo){
+void Switch::DeleteUsed(int size, int qNo, uint32_t port){
     m_usedBuffer = m_usedBuffer - size;           //the total used buffer
     int priority = qToP[qNo];
     pUsedBuffer[priority] = pUsedBuffer[priority] - size;             //the used buffer of priority that qNo queue belonging to  
-  
+    if(m_occStats){
+        m_qUsedBuffer[port][qNo] -= size;
+        m_portUsedBuffer[port] -= size;
+        RecordOccupancy(port, qNo, priority);
+    }
+}
+
+void
+Switch::EnableOccupancyStats(const std::vector<uint64_t>& thresholds){
+    m_portOcc.assign(portCnt, OccupancyHistogram());
+    m_queueOcc.assign(portCnt * qCnt, OccupancyHistogram());
+    for(auto& h : m_portOcc){
+        h.SetThresholds(thresholds);
+    }
+    for(auto& h : m_queueOcc){
+        h.SetThresholds(thresholds);
+    }
+    for(int i=0; i<qCnt; i++){
+        m_priorityOcc[i].SetThresholds(thresholds);
+    }
+    m_totalOcc.SetThresholds(thresholds);
+    m_occStats = true;
+}
+
+void
+Switch::RecordOccupancy(uint32_t port, int qNo, int priority){
+    uint64_t now = Simulator::Now().GetTimeStep();
+    m_totalOcc.Update(m_usedBuffer, now);
+    m_priorityOcc[priority].Update(pUsedBuffer[priority], now);
+    m_portOcc[port].Update(m_portUsedBuffer[port], now);
+    m_queueOcc[port * qCnt + qNo].Update(m_qUsedBuffer[port][qNo], now);
+}
+
+//one line per histogram that ever held a byte:
+//  occ <node> <mmu> <kind> <index> <queue> <p50> <p99> <p999> <max> <ns above threshold 0> ... <observed ns>
+//kind is total, priority (index is the priority), port or queue (index is the ifIndex). Unused fields are -1.
+static void
+PrintOccupancyLine(std::ostream& os, uint32_t nodeId, uint32_t mmuId, const char* kind, int index, int q, OccupancyHistogram& h, uint64_t now){
+    h.Finish(now);
+    if(!h.IsActive()){
+        return;
+    }
+    os << "occ " << nodeId << " " << mmuId << " " << kind << " " << index << " " << q
+       << " " << h.Percentile(0.5) << " " << h.Percentile(0.99) << " " << h.Percentile(0.999) << " " << h.GetMax();
+    for(uint32_t i=0; i<h.GetNThresholds(); i++){
+        os << " " << h.GetTimeAbove(i);
+    }
+    os << " " << h.GetTotalTime() << "\n";
+}
+
+void
+Switch::PrintOccupancyStats(std::ostream& os, uint32_t nodeId, uint32_t mmuId){
+    if(!m_occStats){
+        return;
+    }
+    uint64_t now = Simulator::Now().GetTimeStep();
+    PrintOccupancyLine(os, nodeId, mmuId, "total", -1, -1, m_totalOcc, now);
+    for(int i=0; i<qCnt; i++){
+        PrintOccupancyLine(os, nodeId, mmuId, "priority", i, -1, m_priorityOcc[i], now);
+    }
+    for(uint32_t j=0; j<portCnt; j++){
+        PrintOccupancyLine(os, nodeId, mmuId, "port", j, -1, m_portOcc[j], now);
+        for(int i=0; i<qCnt; i++){
+            PrintOccupancyLine(os, nodeId, mmuId, "queue", j, i, m_queueOcc[j * qCnt + i], now);
+        }
+    }
 }
 
 int Switch::GetQueueThreshold(int qNo){
@@ -124,6 +207,18 @@ Switch::SetQueueAlpha(double array[]){
     }
 }
 
+void
+Switch::SetAllQueueAlpha(double alpha){
+    for(int i=0; i<qCnt; i++){
+        qAlpha[i] = alpha;
+    }
+}
+
+double
+Switch::GetQueueAlpha() const{
+    return qAlpha[0];
+}
+
 void
 Switch::SetPriorityAlpha(double array[]){
     for(int i=0; i<qCnt; i++){
@@ -3,7 +3,9 @@
 
 #include "ns3/object.h"
 #include "ns3/ptr.h"
+#include "ns3/occupancy-histogram.h"
 #include "iostream"
+#include <vector>
 
 namespace ns3 {
 
@@ -15,8 +17,9 @@ class Switch : public Object
     virtual ~Switch();
     void SetBuffer(int maxBuffer, int usedBuffer);
     
-    void DeleteUsed(int size, int qNo);
-    void AddUsed(int size, int qNo);
+    // port is the ifIndex of the device owning queue qNo, it is only used for the occupancy statistics
+    void DeleteUsed(int size, int qNo, uint32_t port = 0);
+    void AddUsed(int size, int qNo, uint32_t port = 0);
 
 
     int GetQueueThreshold(int qNo);
@@ -50,6 +53,8 @@ class Switch : public Object
     DequeueMethod GetDequeueMethod();
 
     void SetQueueAlpha(double array[]);
+    void SetAllQueueAlpha(double alpha);
+    double GetQueueAlpha() const;
     void SetPriorityAlpha(double array[]);
     void SetQueueToPriority(int array[]);
     uint64_t GetPrioritySize(int qNo);
@@ -91,6 +96,10 @@ class Switch : public Object
     uint64_t send_size = 0;
     uint64_t send_rate = 0;
 
+    //occupancy statistics of the shared memory, off by default. Enable before traffic starts.
+    void EnableOccupancyStats(const std::vector<uint64_t>& thresholds);
+    void PrintOccupancyStats(std::ostream& os, uint32_t nodeId, uint32_t mmuId = 0);
+
   private:
     int m_maxBuffer;
     int m_usedBuffer;
@@ -99,6 +108,16 @@ class Switch : public Object
     int m_ecn_threshold;
 
     int m_methodType;   // 1--DT 2--ADT
+
+    void RecordOccupancy(uint32_t port, int qNo, int priority);
+
+    bool m_occStats;
+    uint64_t m_qUsedBuffer[portCnt][qCnt];      //shared memory used by each port and queue
+    uint64_t m_portUsedBuffer[portCnt];
+    OccupancyHistogram m_totalOcc;              //m_usedBuffer
+    OccupancyHistogram m_priorityOcc[qCnt];     //pUsedBuffer
+    std::vector<OccupancyHistogram> m_portOcc;  //portCnt
+    std::vector<OccupancyHistogram> m_queueOcc; //portCnt * qCnt
 };
   
 
@@ -0,0 +1,399 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/class-scheduler.h"
+#include "ns3/test.h"
+
+#include <deque>
+#include <random>
+#include <vector>
+
+using namespace ns3;
+
+namespace
+{
+
+/// Packet sizes queued in each class, served by a ClassScheduler.
+class SchedulerBacklog
+{
+  public:
+    SchedulerBacklog(uint32_t n)
+        : m_queues(n)
+    {
+    }
+
+    void Enqueue(uint32_t c, uint32_t size)
+    {
+        if (m_queues[c].empty())
+        {
+            m_sched.SetBacklogged(c);
+        }
+        m_queues[c].push_back(size);
+    }
+
+    /// the class served, -1 for none
+    int32_t Dequeue()
+    {
+        int32_t c = m_sched.Select();
+        if (c >= 0)
+        {
+            uint32_t size = m_queues[c].front();
+            m_queues[c].pop_front();
+            m_sched.Served(c, size, m_queues[c].empty());
+        }
+        return c;
+    }
+
+    ClassScheduler m_sched;
+    std::vector<std::deque<uint32_t>> m_queues;
+};
+
+/// The former round robin of MultipleQueue::DequeueRR.
+class OldRoundRobin
+{
+  public:
+    OldRoundRobin(uint32_t n)
+        : m_queues(n),
+          m_deindex(n - 1)
+    {
+    }
+
+    int32_t Dequeue()
+    {
+        uint32_t n = m_queues.size();
+        for (uint32_t i = 1; i <= n; i++)
+        {
+            uint32_t tempindex = (m_deindex + i) % n;
+            if (!m_queues[tempindex].empty())
+            {
+                m_queues[tempindex].pop_front();
+                m_deindex = tempindex;
+                return tempindex;
+            }
+        }
+        return -1;
+    }
+
+    std::vector<std::deque<uint32_t>> m_queues;
+    uint32_t m_deindex;
+};
+
+/// The former queue 0 first, then round robin over the unpaused queues, of
+/// BEgressQueue::DoDequeueRR.
+class OldStrictRoundRobin
+{
+  public:
+    OldStrictRoundRobin(uint32_t n)
+        : m_queues(n),
+          m_rrlast(0)
+    {
+    }
+
+    int32_t Dequeue(const bool* paused)
+    {
+        uint32_t qCnt = m_queues.size();
+        if (!m_queues[0].empty())
+        {
+            m_queues[0].pop_front();
+            return 0;
+        }
+        for (uint32_t qIndex = 1; qIndex <= qCnt; qIndex++)
+        {
+            uint32_t c = (qIndex + m_rrlast) % qCnt;
+            if (!paused[c] && !m_queues[c].empty())
+            {
+                m_queues[c].pop_front();
+                m_rrlast = c;
+                return c;
+            }
+        }
+        return -1;
+    }
+
+    std::vector<std::deque<uint32_t>> m_queues;
+    uint32_t m_rrlast;
+};
+
+/// The former deficit round robin of MultipleQueue::DequeueDRR, called again while it
+/// returns nothing with a backlog, as the device does on the next transmit.
+class OldDeficitRoundRobin
+{
+  public:
+    OldDeficitRoundRobin(uint32_t n, int32_t weight)
+        : m_queues(n),
+          m_drr_num(n, 0),
+          m_deindex(n - 1),
+          m_weight(weight)
+    {
+    }
+
+    int32_t Dequeue()
+    {
+        bool backlog = false;
+        for (const auto& q : m_queues)
+        {
+            backlog |= !q.empty();
+        }
+        while (backlog)
+        {
+            int32_t c = DequeueOnce();
+            if (c >= 0)
+            {
+                return c;
+            }
+        }
+        return -1;
+    }
+
+    std::vector<std::deque<uint32_t>> m_queues;
+
+  private:
+    int32_t DequeueOnce()
+    {
+        uint32_t n = m_queues.size();
+        for (uint32_t i = 0; i <= n; i++)
+        {
+            uint32_t tempindex = (m_deindex + i) % n;
+            if (i != 0)
+            {
+                m_drr_num[tempindex] += m_weight;
+            }
+            if (m_drr_num[tempindex] <= 0)
+            {
+                continue;
+            }
+            if (!m_queues[tempindex].empty())
+            {
+                m_deindex = tempindex;
+                m_drr_num[m_deindex] -= m_queues[tempindex].front();
+                m_queues[tempindex].pop_front();
+                return tempindex;
+            }
+            m_drr_num[tempindex] = 0;
+        }
+        return -1;
+    }
+
+    std::vector<int64_t> m_drr_num;
+    uint32_t m_deindex;
+    int32_t m_weight;
+};
+
+} // namespace
+
+/**
+ * \brief Random enqueues and dequeues over 8 round robin classes, some of them often
+ * empty, checked against the order of the former MultipleQueue round robin.
+ */
+class ClassSchedulerRoundRobinTestCase : public TestCase
+{
+  public:
+    ClassSchedulerRoundRobinTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+ClassSchedulerRoundRobinTestCase::ClassSchedulerRoundRobinTestCase()
+    : TestCase("round robin order against the former scan")
+{
+}
+
+void
+ClassSchedulerRoundRobinTestCase::DoRun()
+{
+    const uint32_t n = 8;
+    SchedulerBacklog sched(n);
+    sched.m_sched.ConfigureRoundRobin(n);
+    OldRoundRobin old(n);
+    std::mt19937 rng(1);
+    uint32_t served = 0;
+    for (uint32_t i = 0; i < 20000; i++)
+    {
+        if (rng() % 100 < 45)
+        {
+            // the odd classes get a quarter of the packets, so they are often empty
+            uint32_t c = rng() % n;
+            if (c % 2 == 1 && rng() % 4 != 0)
+            {
+                c--;
+            }
+            sched.Enqueue(c, 1000);
+            old.m_queues[c].push_back(1000);
+        }
+        else
+        {
+            int32_t c = sched.Dequeue();
+            NS_TEST_ASSERT_MSG_EQ(c, old.Dequeue(), "class served at step " << i);
+            served += c >= 0;
+        }
+    }
+    NS_TEST_EXPECT_MSG_GT(served, 5000, "packets served");
+}
+
+/**
+ * \brief Queue 0 in strict priority ahead of a round robin over queues 1 to 7, with random
+ * PFC pauses of queues 1 to 7, checked against the order of the former BEgressQueue scan.
+ */
+class ClassSchedulerPausedTestCase : public TestCase
+{
+  public:
+    ClassSchedulerPausedTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+ClassSchedulerPausedTestCase::ClassSchedulerPausedTestCase()
+    : TestCase("strict queue 0 and paused round robin against the former scan")
+{
+}
+
+void
+ClassSchedulerPausedTestCase::DoRun()
+{
+    const uint32_t n = 8;
+    SchedulerBacklog sched(n);
+    std::vector<uint32_t> levels(n, 1);
+    levels[0] = 0;
+    sched.m_sched.Configure(levels, std::vector<uint32_t>(n, 0));
+    OldStrictRoundRobin old(n);
+    bool paused[n] = {false};
+    std::mt19937 rng(2);
+    uint32_t skipped = 0;
+    for (uint32_t i = 0; i < 20000; i++)
+    {
+        uint32_t r = rng() % 100;
+        if (r < 5)
+        {
+            uint32_t c = 1 + rng() % (n - 1);
+            paused[c] = !paused[c];
+        }
+        else if (r < 50)
+        {
+            uint32_t c = rng() % 10 == 0 ? 0 : 1 + rng() % (n - 1);
+            sched.Enqueue(c, 1000);
+            old.m_queues[c].push_back(1000);
+        }
+        else
+        {
+            sched.m_sched.SetPaused(ClassScheduler::Mask(paused, n) & ~uint64_t(1));
+            int32_t c = sched.Dequeue();
+            NS_TEST_ASSERT_MSG_EQ(c, old.Dequeue(paused), "class served at step " << i);
+            bool backlog = false;
+            for (uint32_t k = 0; k < n; k++)
+            {
+                backlog |= !sched.m_queues[k].empty();
+            }
+            skipped += c < 0 && backlog;
+        }
+    }
+    NS_TEST_EXPECT_MSG_GT(skipped, 0, "dequeues with only paused classes backlogged");
+}
+
+/**
+ * \brief Deficit round robin with packets larger than the quantum, so that deficits carry
+ * over between turns, and empty classes, checked on a hand computed order and then against
+ * the order of the former MultipleQueue DRR on random backlogs.
+ */
+class ClassSchedulerDrrTestCase : public TestCase
+{
+  public:
+    ClassSchedulerDrrTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+ClassSchedulerDrrTestCase::ClassSchedulerDrrTestCase()
+    : TestCase("deficit round robin order against the former scan")
+{
+}
+
+void
+ClassSchedulerDrrTestCase::DoRun()
+{
+    const uint32_t n = 4;
+    const uint32_t quantum = 1000;
+    SchedulerBacklog sched(n);
+    sched.m_sched.Configure(std::vector<uint32_t>(n, 0), std::vector<uint32_t>(n, quantum));
+    // class 1 is empty; class 0 sends 1500 bytes on its first turn and carries -500 to its
+    // second; class 2 sends its three 400 byte packets in one turn
+    uint32_t sizes[n][3] = {{1500, 1500, 0}, {0, 0, 0}, {400, 400, 400}, {1000, 0, 0}};
+    for (uint32_t c = 0; c < n; c++)
+    {
+        for (uint32_t size : sizes[c])
+        {
+            if (size > 0)
+            {
+                sched.Enqueue(c, size);
+            }
+        }
+    }
+    std::vector<int32_t> expected = {0, 2, 2, 2, 3, 0, -1};
+    for (uint32_t i = 0; i < expected.size(); i++)
+    {
+        NS_TEST_EXPECT_MSG_EQ(sched.Dequeue(), expected[i], "class served " << i);
+    }
+
+    std::mt19937 rng(3);
+    for (uint32_t run = 0; run < 200; run++)
+    {
+        const uint32_t classes = 8;
+        const int32_t weight = 500 + rng() % 2000;
+        SchedulerBacklog drr(classes);
+        drr.m_sched.Configure(std::vector<uint32_t>(classes, 0),
+                              std::vector<uint32_t>(classes, weight));
+        OldDeficitRoundRobin old(classes, weight);
+        for (uint32_t c = 0; c < classes; c++)
+        {
+            // about a third of the classes stay empty
+            uint32_t count = rng() % 3 == 0 ? 0 : rng() % 20;
+            for (uint32_t k = 0; k < count; k++)
+            {
+                uint32_t size = 64 + rng() % 3000;
+                drr.Enqueue(c, size);
+                old.m_queues[c].push_back(size);
+            }
+        }
+        int32_t c;
+        uint32_t i = 0;
+        do
+        {
+            c = drr.Dequeue();
+            NS_TEST_ASSERT_MSG_EQ(c, old.Dequeue(), "run " << run << ", class served " << i);
+            i++;
+        } while (c >= 0);
+    }
+}
+
+/**
+ * \brief TestSuite for the bitmask egress class scheduler
+ */
+class ClassSchedulerTestSuite : public TestSuite
+{
+  public:
+    ClassSchedulerTestSuite();
+};
+
+ClassSchedulerTestSuite::ClassSchedulerTestSuite()
+    : TestSuite("class-scheduler", UNIT)
+{
+    AddTestCase(new ClassSchedulerRoundRobinTestCase(), TestCase::QUICK);
+    AddTestCase(new ClassSchedulerPausedTestCase(), TestCase::QUICK);
+    AddTestCase(new ClassSchedulerDrrTestCase(), TestCase::QUICK);
+}
+
+static ClassSchedulerTestSuite g_classSchedulerTestSuite; //!< The testsuite
@@ -0,0 +1,189 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log-buckets.h"
+#include "ns3/occupancy-histogram.h"
+#include "ns3/test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Checks the bucket boundaries of LogBuckets: one bucket per value below
+ * 2^SUB_BITS, then 2^SUB_BITS contiguous sub-buckets per power of two, each no wider than
+ * 1/2^SUB_BITS of its values.
+ */
+class LogBucketsTestCase : public TestCase
+{
+  public:
+    LogBucketsTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+LogBucketsTestCase::LogBucketsTestCase()
+    : TestCase("log bucket boundaries")
+{
+}
+
+void
+LogBucketsTestCase::DoRun()
+{
+    typedef OccupancyHistogram::Buckets Buckets;
+    const uint32_t sub = 1 << OccupancyHistogram::SUB_BITS;
+    for (uint32_t v = 0; v < 2 * sub; v++)
+    {
+        NS_TEST_EXPECT_MSG_EQ(Buckets::Index(v), v, "bucket of " << v);
+        NS_TEST_EXPECT_MSG_EQ(Buckets::Upper(v), v, "upper bound of bucket " << v);
+    }
+    NS_TEST_EXPECT_MSG_EQ(Buckets::Index(2 * sub), 2 * sub, "first bucket of width 2");
+    NS_TEST_EXPECT_MSG_EQ(Buckets::Index(2 * sub + 1), 2 * sub, "first bucket of width 2");
+    NS_TEST_EXPECT_MSG_EQ(Buckets::Upper(2 * sub), 2 * sub + 1, "first bucket of width 2");
+    NS_TEST_EXPECT_MSG_EQ(Buckets::Index(5000), 9 * sub + 3, "bucket of 5000");
+    NS_TEST_EXPECT_MSG_EQ(Buckets::Upper(9 * sub + 3), 5119, "upper bound of 5000");
+
+    // the buckets tile the values up to 2^40
+    uint64_t lower = 0;
+    for (uint32_t idx = 0; idx < 40 * sub; idx++)
+    {
+        uint64_t upper = Buckets::Upper(idx);
+        NS_TEST_ASSERT_MSG_GT_OR_EQ(upper, lower, "bucket " << idx << " not empty");
+        NS_TEST_ASSERT_MSG_EQ(Buckets::Index(lower), idx, "lower bound of bucket " << idx);
+        NS_TEST_ASSERT_MSG_EQ(Buckets::Index(upper), idx, "upper bound of bucket " << idx);
+        NS_TEST_ASSERT_MSG_LT_OR_EQ((upper - lower) * sub,
+                                    std::max<uint64_t>(lower, 1) - 1,
+                                    "width of bucket " << idx);
+        lower = upper + 1;
+    }
+    std::vector<uint64_t> counts;
+    Buckets::Add(counts, 5000, 7);
+    Buckets::Add(counts, 5100, 3);
+    NS_TEST_ASSERT_MSG_EQ(counts.size(), 9 * sub + 4, "counts grown to the bucket of 5000");
+    NS_TEST_EXPECT_MSG_EQ(counts[9 * sub + 3], 10, "weight of the bucket of 5000");
+}
+
+/**
+ * \brief Checks the time weighted percentiles, maximum and time above the thresholds of an
+ * OccupancyHistogram, on a known sequence and against the exact percentiles of random ones.
+ */
+class OccupancyHistogramTestCase : public TestCase
+{
+  public:
+    OccupancyHistogramTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+OccupancyHistogramTestCase::OccupancyHistogramTestCase()
+    : TestCase("time weighted occupancy percentiles")
+{
+}
+
+void
+OccupancyHistogramTestCase::DoRun()
+{
+    typedef OccupancyHistogram::Buckets Buckets;
+    OccupancyHistogram h;
+    h.SetThresholds({500, 4000});
+    NS_TEST_EXPECT_MSG_EQ(h.IsActive(), false, "never occupied");
+    NS_TEST_EXPECT_MSG_EQ(h.Percentile(0.5), 0, "empty histogram");
+    // 0 for 100 ns, 1000 for 300 ns, 5000 for 600 ns; the value set at 400 ns is replaced
+    // at the same time and gets no time
+    h.Update(1000, 100);
+    h.Update(7000, 400);
+    h.Update(5000, 400);
+    h.Finish(1000);
+    NS_TEST_EXPECT_MSG_EQ(h.GetTotalTime(), 1000, "time covered");
+    NS_TEST_EXPECT_MSG_EQ(h.GetMax(), 7000, "max, even for no time");
+    NS_TEST_EXPECT_MSG_EQ(h.GetTimeAbove(0), 900, "time above 500");
+    NS_TEST_EXPECT_MSG_EQ(h.GetTimeAbove(1), 600, "time above 4000");
+    NS_TEST_EXPECT_MSG_EQ(h.Percentile(0.05), 0, "p5");
+    NS_TEST_EXPECT_MSG_EQ(h.Percentile(0.3), 1023, "p30, upper bound of the bucket of 1000");
+    NS_TEST_EXPECT_MSG_EQ(h.Percentile(0.4), 1023, "p40, the last ns at 1000");
+    NS_TEST_EXPECT_MSG_EQ(h.Percentile(0.401), 5119, "p40.1, upper bound of the bucket of 5000");
+    NS_TEST_EXPECT_MSG_EQ(h.Percentile(1), 5119, "p100");
+
+    OccupancyHistogram capped;
+    capped.Update(5000, 0);
+    capped.Finish(10);
+    NS_TEST_EXPECT_MSG_EQ(capped.Percentile(0.99), 5000, "percentile capped to the max");
+
+    std::mt19937_64 rng(1);
+    for (uint32_t run = 0; run < 100; run++)
+    {
+        OccupancyHistogram random;
+        std::vector<std::pair<uint64_t, uint64_t>> samples; // value, time
+        uint64_t now = 0;
+        uint64_t value = 0;
+        for (uint32_t i = 0; i < 200; i++)
+        {
+            uint64_t dt = rng() % 1000;
+            samples.push_back({value, dt});
+            now += dt;
+            value = rng() % 4 == 0 ? 0 : rng() >> (rng() % 64);
+            random.Update(value, now);
+        }
+        random.Finish(now);
+        std::sort(samples.begin(), samples.end());
+        uint64_t total = 0;
+        for (const auto& s : samples)
+        {
+            total += s.second;
+        }
+        NS_TEST_ASSERT_MSG_EQ(random.GetTotalTime(), total, "time covered");
+        for (double p : {0.01, 0.25, 0.5, 0.9, 0.99, 0.999, 1.0})
+        {
+            uint64_t rank = std::max<uint64_t>(1, std::ceil(p * total));
+            uint64_t seen = 0;
+            uint64_t exact = 0;
+            for (const auto& s : samples)
+            {
+                seen += s.second;
+                if (seen >= rank)
+                {
+                    exact = s.first;
+                    break;
+                }
+            }
+            uint64_t expected = std::min(Buckets::Upper(Buckets::Index(exact)), random.GetMax());
+            NS_TEST_EXPECT_MSG_EQ(random.Percentile(p), expected, "run " << run << ", p " << p);
+        }
+    }
+}
+
+/**
+ * \brief TestSuite for the log bucketed occupancy histograms
+ */
+class OccupancyHistogramTestSuite : public TestSuite
+{
+  public:
+    OccupancyHistogramTestSuite();
+};
+
+OccupancyHistogramTestSuite::OccupancyHistogramTestSuite()
+    : TestSuite("occupancy-histogram", UNIT)
+{
+    AddTestCase(new LogBucketsTestCase(), TestCase::QUICK);
+    AddTestCase(new OccupancyHistogramTestCase(), TestCase::QUICK);
+}
+
+static OccupancyHistogramTestSuite g_occupancyHistogramTestSuite; //!< The testsuite
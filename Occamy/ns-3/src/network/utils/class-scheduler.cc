@@ -0,0 +1,75 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "class-scheduler.h"
+
+#include "ns3/abort.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace ns3
+{
+
+ClassScheduler::ClassScheduler()
+    : m_backlog(0),
+      m_paused(0)
+{
+}
+
+void
+ClassScheduler::Configure(const std::vector<uint32_t>& levels, const std::vector<uint32_t>& quanta)
+{
+    NS_ABORT_MSG_IF(levels.size() > MAX_CLASSES, "ClassScheduler supports at most " << MAX_CLASSES << " classes");
+    NS_ABORT_MSG_IF(levels.size() != quanta.size(), "ClassScheduler needs one quantum per class");
+
+    std::vector<uint32_t> order(levels);
+    std::sort(order.begin(), order.end());
+    order.erase(std::unique(order.begin(), order.end()), order.end());
+
+    m_levels.assign(order.size(), Level{0, 0});
+    m_level.resize(levels.size());
+    for (uint32_t c = 0; c < levels.size(); c++)
+    {
+        m_level[c] = std::lower_bound(order.begin(), order.end(), levels[c]) - order.begin();
+        m_levels[m_level[c]].mask |= Bit(c);
+        m_levels[m_level[c]].last = c; // the highest class, so the round robin starts at the lowest
+    }
+    m_quantum = quanta;
+    m_deficit.assign(levels.size(), 0);
+    m_backlog = 0;
+    m_paused = 0;
+}
+
+void
+ClassScheduler::ConfigureRoundRobin(uint32_t n)
+{
+    Configure(std::vector<uint32_t>(n, 0), std::vector<uint32_t>(n, 0));
+}
+
+void
+ClassScheduler::ConfigureStrictPriority(uint32_t n)
+{
+    std::vector<uint32_t> levels(n);
+    for (uint32_t c = 0; c < n; c++)
+    {
+        levels[c] = c;
+    }
+    Configure(levels, std::vector<uint32_t>(n, 0));
+}
+
+std::vector<uint32_t>
+ClassScheduler::ParseList(const std::string& s)
+{
+    std::vector<uint32_t> v;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (!item.empty())
+        {
+            v.push_back(std::stoul(item));
+        }
+    }
+    return v;
+}
+
+} // namespace ns3
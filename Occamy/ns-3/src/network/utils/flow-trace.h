@@ -0,0 +1,160 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef FLOW_TRACE_H
+#define FLOW_TRACE_H
+
+#include "ns3/callback.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+namespace ns3
+{
+
+/**
+ * \brief One flow of a binary flow trace, 32 bytes on disk (little endian).
+ *
+ * src and dst are server indices, as used by the examples to pick the nodes.
+ * The incast flows of one query share their id.
+ */
+struct FlowRecord
+{
+    uint64_t start;    //!< ns
+    uint64_t size;     //!< bytes
+    uint32_t src;      //!< sender server index
+    uint32_t dst;      //!< receiver server index
+    uint32_t id;       //!< flow id, or query id for incast flows
+    uint16_t priority; //!< RDMA priority group or TCP priority
+    uint8_t cls;       //!< FLOW_RDMA or FLOW_TCP
+    uint8_t flags;     //!< FLOW_INCAST
+};
+
+enum FlowClass
+{
+    FLOW_RDMA = 0,
+    FLOW_TCP = 1
+};
+
+enum FlowFlags
+{
+    FLOW_INCAST = 1
+};
+
+/**
+ * \brief Writes a binary flow trace: a 32-byte header followed by the records in
+ * non-decreasing start time.
+ */
+class FlowTraceWriter
+{
+  public:
+    FlowTraceWriter();
+    ~FlowTraceWriter();
+
+    void Open(const std::string& path);
+    void Write(const FlowRecord& r);
+    /// writes the flow count in the header
+    void Close();
+
+    uint64_t GetNFlows() const
+    {
+        return m_nFlows;
+    }
+
+  private:
+    FILE* m_file;
+    uint64_t m_nFlows;
+    uint64_t m_lastStart;
+};
+
+/**
+ * \brief Reads a binary flow trace through a read-only memory map.
+ *
+ * Nothing is parsed or copied: records are read in place, and the pages behind
+ * the replay position can be handed back to the kernel with Release(), so a trace
+ * of any length is replayed in constant memory.
+ */
+class FlowTraceReader
+{
+  public:
+    FlowTraceReader();
+    ~FlowTraceReader();
+
+    /// false, with the reason in GetError(), if path is not a complete flow trace
+    bool Open(const std::string& path);
+    void Close();
+
+    const std::string& GetError() const
+    {
+        return m_error;
+    }
+
+    uint64_t GetNFlows() const
+    {
+        return m_nFlows;
+    }
+
+    const FlowRecord& Get(uint64_t i) const
+    {
+        return m_records[i];
+    }
+
+    /// the records before i will not be read again
+    void Release(uint64_t i);
+
+  private:
+    void* m_map;
+    size_t m_mapSize;
+    const FlowRecord* m_records;
+    uint64_t m_nFlows;
+    size_t m_released; //!< bytes of the map already released
+    std::string m_error;
+};
+
+/**
+ * \brief Replays a flow trace: every flow is handed to the callback at its start time.
+ *
+ * Only the next start time is scheduled, so the event list holds one replay event
+ * whatever the number of flows, and the applications of a flow are only created
+ * when it starts.
+ */
+class FlowTraceReplay : public Object
+{
+  public:
+    static TypeId GetTypeId();
+
+    FlowTraceReplay();
+    ~FlowTraceReplay() override;
+
+    typedef Callback<void, const FlowRecord&> FlowCallback;
+
+    void Open(const std::string& path);
+    void SetFlowCallback(FlowCallback cb);
+    /// schedule the flows starting at or after now, flows already past are skipped
+    void Start();
+
+    uint64_t GetNFlows() const
+    {
+        return m_reader.GetNFlows();
+    }
+
+    uint64_t GetNStarted() const
+    {
+        return m_next;
+    }
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    void Fire();
+
+    FlowTraceReader m_reader;
+    FlowCallback m_cb;
+    uint64_t m_next; //!< first flow not started yet
+};
+
+} // namespace ns3
+
+#endif /* FLOW_TRACE_H */
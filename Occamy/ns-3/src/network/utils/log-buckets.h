@@ -0,0 +1,89 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef LOG_BUCKETS_H
+#define LOG_BUCKETS_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief HDR-style log buckets of OccupancyHistogram and SampleHistogram.
+ *
+ * Values below 2^SUB_BITS get one bucket each, and every power of two above that is
+ * split into 2^SUB_BITS linear sub-buckets, so the upper bound of a bucket is within
+ * 1/2^SUB_BITS of any value in it.
+ */
+template <uint32_t SUB_BITS>
+class LogBuckets
+{
+  public:
+    static uint32_t Index(uint64_t v)
+    {
+        if (v < (1u << SUB_BITS))
+        {
+            return v;
+        }
+        uint32_t msb = 63 - __builtin_clzll(v);
+        uint32_t group = msb - SUB_BITS + 1;
+        return (group << SUB_BITS) + ((v >> (msb - SUB_BITS)) & ((1u << SUB_BITS) - 1));
+    }
+
+    /// Largest value that falls into bucket idx
+    static uint64_t Upper(uint32_t idx)
+    {
+        uint32_t group = idx >> SUB_BITS;
+        uint64_t sub = idx & ((1u << SUB_BITS) - 1);
+        if (group == 0)
+        {
+            return sub;
+        }
+        // group g covers [2^(g+SUB_BITS-1), 2^(g+SUB_BITS)) in sub-buckets of width 2^(g-1)
+        uint64_t lower = ((1ull << SUB_BITS) + sub) << (group - 1);
+        return lower + (1ull << (group - 1)) - 1;
+    }
+
+    /// Adds weight to the bucket of v, growing counts on demand
+    static void Add(std::vector<uint64_t>& counts, uint64_t v, uint64_t weight)
+    {
+        uint32_t idx = Index(v);
+        if (idx >= counts.size())
+        {
+            counts.resize(idx + 1, 0);
+        }
+        counts[idx] += weight;
+    }
+
+    /**
+     * Upper bound, capped to max, of the bucket that holds the ceil(p * total)-th smallest
+     * unit of weight. total must be the sum of counts and not 0.
+     */
+    static uint64_t Percentile(const std::vector<uint64_t>& counts,
+                               uint64_t total,
+                               uint64_t max,
+                               double p)
+    {
+        // the rank is rounded up so that p = 1 lands on the last non-empty bucket
+        uint64_t rank = p * total;
+        if (rank < p * total || rank == 0)
+        {
+            rank++;
+        }
+        uint64_t seen = 0;
+        for (uint32_t idx = 0; idx < counts.size(); idx++)
+        {
+            seen += counts[idx];
+            if (seen >= rank)
+            {
+                uint64_t upper = Upper(idx);
+                return upper < max ? upper : max;
+            }
+        }
+        return max;
+    }
+};
+
+} // namespace ns3
+
+#endif /* LOG_BUCKETS_H */
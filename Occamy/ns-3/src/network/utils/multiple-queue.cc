@@ -19,6 +19,8 @@
 #include "multiple-queue.h"
 #include "drop-tail-queue.h"
 #include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/integer.h"
 #include <iostream>
 #include <fstream>
 
@@ -66,7 +68,23 @@ MultipleQueue<Item>::GetTypeId (void)
                                                     MultipleQueue::PQ,
                                                     "PQ",
                                                     MultipleQueue::PQDRR,
-                                                    "PQDRR"));                   
+                                                    "PQDRR"))
+                        .AddAttribute ("DrrWeight",
+                                    "the DRR quantum in bytes of the subqueues not listed in Quanta",
+                                    IntegerValue(2000),
+                                    MakeIntegerAccessor(&MultipleQueue::m_weight),
+                                    MakeIntegerChecker<int>(1))
+                        .AddAttribute ("Quanta",
+                                    "per-subqueue DRR quanta in bytes, comma separated, for DRR and PQDRR",
+                                    StringValue(""),
+                                    MakeStringAccessor(&MultipleQueue::m_quanta),
+                                    MakeStringChecker())
+                        .AddAttribute ("PqCnt",
+                                    "the number of strict priority subqueues served before the DRR ones in PQDRR",
+                                    UintegerValue(2),
+                                    MakeUintegerAccessor(&MultipleQueue::m_pqCnt),
+                                    MakeUintegerChecker<uint32_t>());
+
     return tid;
 }
 
@@ -80,7 +98,6 @@ MultipleQueue<Item>::MultipleQueue () :
         m_queues[i]->SetAttribute("MaxSize",QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS,100000000)));
         //100000000p if a packetsize is 64B, the subqueue size is about 6GB
         //in this way ,the subqueue won't be fulled.
-        m_drr_num[i] = 0;
     }
     NS_LOG_FUNCTION (this);
 
@@ -160,6 +177,9 @@ MultipleQueue<Item>::Enqueue (Ptr<Item> item,uint32_t index)
     }
 
     bool flag = m_queues[index]->Enqueue(item);
+    if(flag){
+        m_sched.SetBacklogged(index);
+    }
 
     return flag;
 }
@@ -173,7 +193,10 @@ MultipleQueue<Item>::Dequeue (uint32_t index)
         return 0;
     }
     Ptr<Item> item = m_queues[index]->Dequeue();
-    
+    if(m_queues[index]->IsEmpty()){
+        m_sched.SetEmpty(index);
+    }
+
     return item;
 }
 
@@ -212,114 +235,88 @@ MultipleQueue<Item>::EnqueueRR (Ptr<Item> item)
 }
 
 template <typename Item>
-Ptr<Item>
-MultipleQueue<Item>::DequeueRR (void)
+void
+MultipleQueue<Item>::ConfigureScheduler (DequeueType type)
 {
-    Ptr<Item> item = 0;
-    for(uint32_t i=1;i<=this->GetUseqCnt();i++){
-        uint32_t tempindex = (m_deindex+i)%(this->GetUseqCnt());
-        item = this->Dequeue(tempindex);
-        if(item){
-            m_deindex = tempindex;
-        break;
+    uint32_t n = std::min(this->GetUseqCnt(), qCnt);
+    if(m_schedConfigured && m_schedType == type && m_sched.GetNClasses() == n){
+        return;
+    }
+    std::vector<uint32_t> levels(n, 0);
+    std::vector<uint32_t> quanta = ClassScheduler::ParseList(m_quanta);
+    quanta.resize(n, m_weight);
+    for(uint32_t i=0;i<n;i++){
+        if(type == MultipleQueue::RR){
+            quanta[i] = 0;
+        }else if(type == MultipleQueue::PQ){
+            levels[i] = i;
+            quanta[i] = 0;
+        }else if(type == MultipleQueue::PQDRR){
+            levels[i] = std::min(i, m_pqCnt);
+            if(i < m_pqCnt){
+                quanta[i] = 0;
+            }
         }
     }
-    return item;
+    m_sched.Configure(levels, quanta);
+    for(uint32_t i=0;i<n;i++){
+        if(!m_queues[i]->IsEmpty()){
+            m_sched.SetBacklogged(i);
+        }
+    }
+    m_schedType = type;
+    m_schedConfigured = true;
 }
 
 template <typename Item>
 Ptr<Item>
-MultipleQueue<Item>::DequeuePQ (void)
+MultipleQueue<Item>::DequeueScheduled (void)
 {
-    Ptr<Item> item = 0;
-    for(uint32_t i=0;i<this->GetUseqCnt();i++){
-        uint32_t tempindex = i;
-        item = this->Dequeue(tempindex);
+    int32_t index;
+    while((index = m_sched.Select()) >= 0){
+        Ptr<Item> item = m_queues[index]->Dequeue();
         if(item){
-            m_deindex = tempindex;
-            break;
+            m_sched.Served(index, item->GetSize(), m_queues[index]->IsEmpty());
+            m_deindex = index;
+            return item;
         }
+        //emptied by a push out behind our back
+        m_sched.SetEmpty(index);
     }
-    return item;
+    return 0;
 }
 
 template <typename Item>
 Ptr<Item>
-MultipleQueue<Item>::DequeueDRR (void)
-{   
-    
-    Ptr<Item> item = 0;
-    for(uint32_t i=0;i<=this->GetUseqCnt();i++){
-        uint32_t tempindex = (m_deindex+i)%(this->GetUseqCnt());
-        if(i!=0){
-            m_drr_num[tempindex] += m_weight;
-        }
-        if(m_drr_num[tempindex] <= 0){
-            continue;
-        }
-        item = this->Dequeue(tempindex);
-        if(item){
-            m_deindex = tempindex;
-            m_drr_num[m_deindex] -= item->GetSize();
-            break;
-        }else{
-            m_drr_num[tempindex] = 0;
-        }
-    }
+MultipleQueue<Item>::DequeueRR (void)
+{
+    ConfigureScheduler(MultipleQueue::RR);
+    return DequeueScheduled();
+}
 
-    return item;
+template <typename Item>
+Ptr<Item>
+MultipleQueue<Item>::DequeuePQ (void)
+{
+    ConfigureScheduler(MultipleQueue::PQ);
+    return DequeueScheduled();
+}
 
+template <typename Item>
+Ptr<Item>
+MultipleQueue<Item>::DequeueDRR (void)
+{
+    ConfigureScheduler(MultipleQueue::DRR);
+    return DequeueScheduled();
 }
 
+//queue 0..m_pqCnt-1 in strict priority, the others use DRR
 template <typename Item>
 Ptr<Item>
 MultipleQueue<Item>::DequeuePQDRR (void)
 {
-    Ptr<Item> item = 0;
-    //queue 0 dequeue
-    item = this->Dequeue(0);
-    if(item){
-        m_deindex = 0;
-        return item;
-    }
-
-    //queue 1 dequeue
-    item = this->Dequeue(1);
-    if(item){
-        m_deindex = 1;
-        return item;
-    }
-
-    //queue 2 dequeue
-    // item = this->Dequeue(2);
-    // if(item){
-    //     m_deindex = 2;
-    //     return item;
-    // }
-
-    //queue 3-useCout use DRR
-    for(uint32_t i=0;i<=this->GetUseqCnt();i++){
-        uint32_t tempindex = (drr_index+i)%(this->GetUseqCnt());
-        if(tempindex < 2){
-            continue;
-        }
-        if(i!=0){
-            m_drr_num[tempindex] += m_weight;
-        }
-        if(m_drr_num[tempindex] <= 0){
-            continue;
-        }
-        item = this->Dequeue(tempindex);
-        if(item){
-            m_deindex = tempindex;
-            drr_index = tempindex;
-            m_drr_num[m_deindex] -= item->GetSize();
-            break;
-        }else{
-            m_drr_num[tempindex] = 0;
-        }
-    }
-    return item;
+    ConfigureScheduler(MultipleQueue::PQDRR);
+    return DequeueScheduled();
 }
 
 template <typename Item>
@@ -20,6 +20,7 @@
 #define MULTIPLE_H
 
 #include "ns3/queue.h"
+#include "class-scheduler.h"
 
 namespace ns3 {
 
@@ -85,8 +86,9 @@ class MultipleQueue : public Queue<Item>
     } DequeueType;
 
     DequeueType m_dequeueType;
-    int m_drr_num[8];
-    int m_weight = 2000;
+    int m_weight = 2000;         //DRR quantum of the subqueues not listed in m_quanta
+    std::string m_quanta;        //per-subqueue DRR quanta, comma separated
+    uint32_t m_pqCnt = 2;        //PQDRR: the first m_pqCnt subqueues are strict priority over the DRR of the others
 
     void SetDequeueType(DequeueType dtype);
     DequeueType GetDequeueType(); 
@@ -100,10 +102,16 @@ class MultipleQueue : public Queue<Item>
     void SetUseqCnt(uint32_t useqCnt);
     uint32_t GetUseqCnt();
 
-    uint32_t drr_index = 2;
-
 
   private:
+    void ConfigureScheduler (DequeueType type);
+    Ptr<Item> DequeueScheduled (void);
+
+    //non-empty subqueues are tracked in m_sched, set up for the dequeue type in use
+    ClassScheduler m_sched;
+    DequeueType m_schedType;
+    bool m_schedConfigured = false;
+
     /*using Queue<Item>::begin;
     using Queue<Item>::end;
     using Queue<Item>::DoEnqueue;
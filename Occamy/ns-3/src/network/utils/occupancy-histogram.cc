@@ -0,0 +1,45 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "occupancy-histogram.h"
+
+#include "ns3/assert.h"
+
+namespace ns3
+{
+
+OccupancyHistogram::OccupancyHistogram()
+    : m_value(0),
+      m_lastTime(0),
+      m_total(0),
+      m_max(0),
+      m_nThresholds(0)
+{
+    for (uint32_t i = 0; i < MAX_THRESHOLDS; i++)
+    {
+        m_thresholds[i] = 0;
+        m_above[i] = 0;
+    }
+}
+
+void
+OccupancyHistogram::SetThresholds(const std::vector<uint64_t>& thresholds)
+{
+    NS_ASSERT_MSG(thresholds.size() <= MAX_THRESHOLDS, "Too many occupancy thresholds");
+    m_nThresholds = thresholds.size();
+    for (uint32_t i = 0; i < m_nThresholds; i++)
+    {
+        m_thresholds[i] = thresholds[i];
+        m_above[i] = 0;
+    }
+}
+
+uint64_t
+OccupancyHistogram::Percentile(double p) const
+{
+    if (m_total == 0)
+    {
+        return m_value;
+    }
+    return Buckets::Percentile(m_counts, m_total, m_max, p);
+}
+
+} // namespace ns3
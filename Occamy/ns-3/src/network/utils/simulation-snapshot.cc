@@ -0,0 +1,251 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "simulation-snapshot.h"
+
+#include "ns3/abort.h"
+#include "ns3/config.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("SimulationSnapshot");
+NS_OBJECT_ENSURE_REGISTERED(SimulationSnapshot);
+
+TypeId
+SimulationSnapshot::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::SimulationSnapshot")
+            .SetParent<Object>()
+            .SetGroupName("Network")
+            .AddConstructor<SimulationSnapshot>()
+            .AddAttribute("MaxParallel",
+                          "Branches running at the same time, 0 for all of them",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&SimulationSnapshot::m_maxParallel),
+                          MakeUintegerChecker<uint32_t>());
+    return tid;
+}
+
+SimulationSnapshot::SimulationSnapshot()
+    : m_maxParallel(0),
+      m_forked(false),
+      m_failed(0)
+{
+}
+
+SimulationSnapshot::~SimulationSnapshot()
+{
+}
+
+void
+SimulationSnapshot::DoDispose()
+{
+    m_cb = BranchCallback();
+    m_streams.clear();
+    Object::DoDispose();
+}
+
+void
+SimulationSnapshot::AddBranch(const std::string& name, const std::string& overrides)
+{
+    NS_ABORT_MSG_IF(name.empty(), "SimulationSnapshot: branch without a name");
+    Branch b;
+    b.name = name;
+    std::stringstream ss(overrides);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (item.empty())
+        {
+            continue;
+        }
+        size_t eq = item.find('=');
+        NS_ABORT_MSG_IF(eq == std::string::npos || eq == 0,
+                        "SimulationSnapshot: override \"" << item << "\" of branch " << name
+                                                          << " is not path=value");
+        b.overrides.emplace_back(item.substr(0, eq), item.substr(eq + 1));
+    }
+    m_branches.push_back(b);
+}
+
+void
+SimulationSnapshot::AddBranches(const std::string& spec)
+{
+    std::stringstream ss(spec);
+    std::string branch;
+    while (std::getline(ss, branch, ';'))
+    {
+        if (branch.empty())
+        {
+            continue;
+        }
+        size_t colon = branch.find(':');
+        AddBranch(branch.substr(0, colon),
+                  colon == std::string::npos ? "" : branch.substr(colon + 1));
+    }
+}
+
+void
+SimulationSnapshot::AddStream(Ptr<OutputStreamWrapper> stream, const std::string& path)
+{
+    NS_ABORT_MSG_IF(!dynamic_cast<std::ofstream*>(stream->GetStream()),
+                    "SimulationSnapshot: " << path << " is not a file stream");
+    m_streams.emplace_back(stream, path);
+}
+
+void
+SimulationSnapshot::SetBranchCallback(BranchCallback cb)
+{
+    m_cb = cb;
+}
+
+void
+SimulationSnapshot::Schedule(Time at)
+{
+    Simulator::Schedule(at - Simulator::Now(), &SimulationSnapshot::Fork, this);
+}
+
+std::string
+SimulationSnapshot::GetOutputPath(const std::string& path) const
+{
+    return m_branch.empty() ? path : path + "." + m_branch;
+}
+
+void
+SimulationSnapshot::Fork()
+{
+    NS_LOG_INFO("Snapshot at " << Simulator::Now().As(Time::S) << ", " << m_branches.size()
+                               << " branches");
+    // buffered output would be written once by every process otherwise
+    for (auto& s : m_streams)
+    {
+        s.first->GetStream()->flush();
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    fflush(nullptr);
+
+    m_forked = true;
+    for (const Branch& b : m_branches)
+    {
+        while (m_maxParallel > 0 && m_children.size() >= m_maxParallel)
+        {
+            WaitOne();
+        }
+        pid_t pid = fork();
+        NS_ABORT_MSG_IF(pid < 0, "SimulationSnapshot: fork failed for branch " << b.name);
+        if (pid == 0)
+        {
+            RunBranch(b);
+            return;
+        }
+        m_children.push_back(pid);
+    }
+    // the parent only simulated the warm-up
+    Simulator::Stop();
+}
+
+void
+SimulationSnapshot::RunBranch(const Branch& b)
+{
+    m_branch = b.name;
+    m_children.clear();
+    for (auto& s : m_streams)
+    {
+        // the branch file starts with what the warm-up wrote, so it reads as the output of a full run
+        std::ofstream* f = static_cast<std::ofstream*>(s.first->GetStream());
+        f->close();
+        f->open(GetOutputPath(s.second));
+        NS_ABORT_MSG_IF(!f->is_open(), "SimulationSnapshot: cannot open " << GetOutputPath(s.second));
+        std::ifstream warmup(s.second);
+        if (warmup.peek() != std::ifstream::traits_type::eof())
+        {
+            *f << warmup.rdbuf();
+        }
+    }
+    Overrides others;
+    for (const auto& o : b.overrides)
+    {
+        if (o.first[0] == '/')
+        {
+            Config::Set(o.first, StringValue(o.second));
+        }
+        else
+        {
+            others.push_back(o);
+        }
+    }
+    if (!m_cb.IsNull())
+    {
+        m_cb(b.name, others);
+    }
+    else
+    {
+        NS_ABORT_MSG_IF(!others.empty(),
+                        "SimulationSnapshot: branch " << b.name
+                                                      << " has overrides that are not attribute paths");
+    }
+    std::cout << "branch " << b.name << " forked at " << Simulator::Now().GetSeconds() << "s, pid "
+              << getpid() << std::endl;
+}
+
+bool
+SimulationSnapshot::WaitOne()
+{
+    // only the branches are waited for, the other children of the process are not ours to reap:
+    // take a branch that has exited, else block on the oldest one
+    int status = 0;
+    pid_t pid = 0;
+    pid_t ret = 0;
+    for (pid_t child : m_children)
+    {
+        ret = waitpid(child, &status, WNOHANG);
+        if (ret != 0)
+        {
+            pid = child;
+            break;
+        }
+    }
+    if (pid == 0)
+    {
+        pid = m_children.front();
+        do
+        {
+            ret = waitpid(pid, &status, 0);
+        } while (ret < 0 && errno == EINTR);
+    }
+    m_children.erase(std::remove(m_children.begin(), m_children.end(), pid), m_children.end());
+    // a branch reaped by someone else has no status, count it as failed
+    if (ret < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        std::cout << "branch process " << pid << " failed" << std::endl;
+        m_failed++;
+        return false;
+    }
+    return true;
+}
+
+uint32_t
+SimulationSnapshot::Wait()
+{
+    while (!m_children.empty())
+    {
+        WaitOne();
+    }
+    return m_failed;
+}
+
+} // namespace ns3
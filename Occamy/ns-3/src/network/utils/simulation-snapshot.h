@@ -0,0 +1,112 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef SIMULATION_SNAPSHOT_H
+#define SIMULATION_SNAPSHOT_H
+
+#include "output-stream-wrapper.h"
+
+#include "ns3/callback.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+#include <string>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Warm-start snapshot: forks the simulation into several branches at a given time.
+ *
+ * The process forks one copy-on-write child per branch at the snapshot time, so the
+ * warm-up before it is simulated once for all the branches. Each child applies the
+ * overrides of its branch and runs on to the end of the simulation; the parent stops
+ * and only waits for the children.
+ *
+ * An override "path=value" whose path starts with '/' is applied with Config::Set.
+ * The others are handed to the branch callback, for the parameters that are not
+ * attributes (e.g. the workload of an example).
+ *
+ * The registered output streams are flushed before forking and reopened by every
+ * child as "<path>.<branch>", starting with a copy of what was written before the
+ * snapshot, so the files of a branch read as the outputs of a full run.
+ */
+class SimulationSnapshot : public Object
+{
+  public:
+    static TypeId GetTypeId();
+
+    SimulationSnapshot();
+    ~SimulationSnapshot() override;
+
+    typedef std::vector<std::pair<std::string, std::string>> Overrides;
+    /// called in the child of a branch with its name and the overrides that are not attribute paths
+    typedef Callback<void, const std::string&, const Overrides&> BranchCallback;
+
+    /// overrides: comma separated "path=value" items
+    void AddBranch(const std::string& name, const std::string& overrides);
+    /**
+     * Parses "name:path=value,path=value;name:..." into branches.
+     * A branch without ':' has no overrides.
+     */
+    void AddBranches(const std::string& spec);
+
+    uint32_t GetNBranches() const
+    {
+        return m_branches.size();
+    }
+
+    /// stream is a file stream opened on path
+    void AddStream(Ptr<OutputStreamWrapper> stream, const std::string& path);
+    void SetBranchCallback(BranchCallback cb);
+
+    /// fork at simulation time at
+    void Schedule(Time at);
+
+    /// name of the branch run by this process, empty in the parent and before the snapshot
+    const std::string& GetBranch() const
+    {
+        return m_branch;
+    }
+
+    /// true in the parent once it has forked the branches
+    bool IsParent() const
+    {
+        return m_forked && m_branch.empty();
+    }
+
+    /// the path of an output written at the end of the run by this process
+    std::string GetOutputPath(const std::string& path) const;
+
+    /// Waits for all the children. Returns the number of branches that failed.
+    uint32_t Wait();
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    struct Branch
+    {
+        std::string name;
+        Overrides overrides;
+    };
+
+    void Fork();
+    void RunBranch(const Branch& b);
+    /// waits for one branch, returns false if it failed
+    bool WaitOne();
+
+    std::vector<Branch> m_branches;
+    std::vector<std::pair<Ptr<OutputStreamWrapper>, std::string>> m_streams;
+    BranchCallback m_cb;
+    uint32_t m_maxParallel;
+    std::string m_branch;
+    bool m_forked;
+    std::vector<pid_t> m_children; //!< children still running
+    uint32_t m_failed;
+};
+
+} // namespace ns3
+
+#endif /* SIMULATION_SNAPSHOT_H */
@@ -52,6 +52,37 @@ namespace ns3
 
 NS_LOG_COMPONENT_DEFINE("SharedMemoryPointToPointNetDevice");
 
+namespace
+{
+/// The header fields a switch port classifies on
+struct FlowKey
+{
+    uint32_t src;
+    uint32_t dst;
+    uint8_t tos;
+    uint8_t protocol;
+    uint16_t dstPort;
+};
+
+/**
+ * Read the key from the first bytes of an IPv4 packet. The packet is neither
+ * copied nor modified: at most the IPv4 header and the first 4 bytes of the
+ * transport header are read out of its buffer.
+ */
+void
+PeekFlowKey(Ptr<const Packet> p, FlowKey& k)
+{
+    uint8_t b[64] = {0};
+    p->CopyData(b, sizeof(b));
+    uint32_t l4 = (b[0] & 0xf) * 4;
+    k.tos = b[1];
+    k.protocol = b[9];
+    k.src = (uint32_t(b[12]) << 24) | (uint32_t(b[13]) << 16) | (uint32_t(b[14]) << 8) | b[15];
+    k.dst = (uint32_t(b[16]) << 24) | (uint32_t(b[17]) << 16) | (uint32_t(b[18]) << 8) | b[19];
+    k.dstPort = (uint16_t(b[l4 + 2]) << 8) | b[l4 + 3];
+}
+} // namespace
+
 NS_OBJECT_ENSURE_REGISTERED(SharedMemoryPointToPointNetDevice);
 std::unordered_map <uint32_t,uint32_t> SharedMemoryPointToPointNetDevice::queueIdMap;
 TypeId
@@ -223,12 +254,21 @@ SharedMemoryPointToPointNetDevice::GetTypeId()
 }
 
 SharedMemoryPointToPointNetDevice::SharedMemoryPointToPointNetDevice()
-    : m_txMachineState(READY),
+    : m_accept(nullptr),
+      m_threshold(nullptr),
+      m_txMachineState(READY),
       m_channel(nullptr),
       m_linkUp(false),
       m_currentPkt(nullptr)
 {
     NS_LOG_FUNCTION(this);
+    //ABM counters, read by the first rate update
+    for (uint32_t p = 0; p < 8; p++)
+    {
+        deqPriorityRate[p] = 1;
+        deqPriorityBytes[p] = 0;
+        nofP[p] = 0;
+    }
 }
 
 SharedMemoryPointToPointNetDevice::~SharedMemoryPointToPointNetDevice()
@@ -264,6 +304,8 @@ SharedMemoryPointToPointNetDevice::DoDispose()
     m_receiveErrorModel = nullptr;
     m_currentPkt = nullptr;
     m_queue = nullptr;
+    m_mulqueue = nullptr;
+    m_mmu = nullptr;
     NetDevice::DoDispose();
 }
 
@@ -302,9 +344,7 @@ SharedMemoryPointToPointNetDevice::TransmitStartSwitch (Ptr<Packet> p, uint32_t
     found = p->PeekPacketTag(Int);
     if (found)
     {   
-        Ptr<MultipleQueue<Packet> > mulqueue = m_queue->GetObject<MultipleQueue<Packet> >();
-        Ptr<Queue<Packet> >subqueue = mulqueue->m_queues[dequeue_index];
-        Int.setTelemetryQlenDeq(Int.getHopCount(), subqueue->GetNBytes()); // queue length at dequeue
+        Int.setTelemetryQlenDeq(Int.getHopCount(), m_mulqueue->m_queues[dequeue_index]->GetNBytes()); // queue length at dequeue
         Int.setTelemetryTsDeq(Int.getHopCount(), Simulator::Now().GetNanoSeconds()); // timestamp at dequeue
         Int.setTelemetryBw(Int.getHopCount(), m_bps.GetBitRate());
         Int.setTelemetryTxBytes(Int.getHopCount(), txBytesInt);
@@ -321,8 +361,7 @@ SharedMemoryPointToPointNetDevice::TransmitStartSwitch (Ptr<Packet> p, uint32_t
     Time txCompleteTime = txTime + m_tInterframeGap;
     
     //msg
-    Ptr<Switch> m_switch = GetMMUSwitch();
-    m_switch->send_size += p->GetSize();
+    m_mmu->send_size += p->GetSize();
 
     NS_LOG_LOGIC ("Schedule TransmitCompleteEvent in " << txCompleteTime.As (Time::S));
     Simulator::Schedule (txCompleteTime, &SharedMemoryPointToPointNetDevice::TransmitCompleteSwitch, this);
@@ -376,8 +415,7 @@ void
 SharedMemoryPointToPointNetDevice::TransmitCompleteSwitch (void)
 {
     NS_LOG_FUNCTION (this);
-    // Ptr<Switch> m_switch = m_node->m_switch;
-    Ptr<Switch> m_switch = GetMMUSwitch();
+    Switch* m_switch = PeekPointer(m_mmu);
 
     //
     // This function is called to when we're all done transmitting a packet.
@@ -393,10 +431,10 @@ SharedMemoryPointToPointNetDevice::TransmitCompleteSwitch (void)
     m_phyTxEndTrace (m_currentPkt);
     m_currentPkt = 0;
 
-    Ptr<MultipleQueue<Packet> > mulqueue = m_queue->GetObject<MultipleQueue<Packet> >(); 
+    MultipleQueue<Packet>* mulqueue = PeekPointer(m_mulqueue);
     Ptr<Packet> packet;
     uint32_t dequeue_index;
-    Ptr<Queue<Packet> >subqueue_de;
+    Queue<Packet>* subqueue_de;
 
     if(m_switch->GetDequeueMethod() == Switch::NORMAL_DEQUEUE){
         //check-drop
@@ -406,12 +444,12 @@ SharedMemoryPointToPointNetDevice::TransmitCompleteSwitch (void)
         return;
         }
             dequeue_index = mulqueue->GetDeIndex();
-            subqueue_de = mulqueue->m_queues[dequeue_index];
+            subqueue_de = PeekPointer(mulqueue->m_queues[dequeue_index]);
         if(usedStaticBuffer[dequeue_index] > subqueue_de->GetNBytes()){
             usedStaticBuffer[dequeue_index] -= packet->GetSize();   //the packet comes from static memory
         }else{
             
-            m_switch->DeleteUsed(packet->GetSize(), dequeue_index); //the packet comes from shared memory
+            m_switch->DeleteUsed(packet->GetSize(), dequeue_index, GetIfIndex()); //the packet comes from shared memory
             TokenDelete(packet->GetSize());
         }
         
@@ -512,6 +550,7 @@ SharedMemoryPointToPointNetDevice::SetQueue(Ptr<Queue<Packet>> q)
 {
     NS_LOG_FUNCTION(this << q);
     m_queue = q;
+    m_mulqueue = q->GetObject<MultipleQueue<Packet>>();
 }
 
 void
@@ -727,96 +766,47 @@ SharedMemoryPointToPointNetDevice::SendSwitch (
     NS_LOG_LOGIC ("p=" << packet << ", dest=" << &dest);
     NS_LOG_LOGIC ("UID is " << packet->GetUid ());
 
-    // Ptr<Switch> m_switch = m_node->m_switch;
-    Ptr<Switch> m_switch = GetMMUSwitch();
+    if (m_accept == nullptr)
+    {
+        BindSwitch();
+    }
+    Switch* m_switch = PeekPointer(m_mmu);
+    MultipleQueue<Packet>* mulqueue = PeekPointer(m_mulqueue);
 
     //get the tos, ip, port
+    FlowKey key;
+    PeekFlowKey(packet, key);
 
-    Ipv4Header ipv4Header;
-    Ptr<Packet> copyPacket = packet->Copy();
-    copyPacket->RemoveHeader(ipv4Header);
-
-    bool found;
     uint32_t unsched = 0;
     UnSchedTag tag;
-    found = copyPacket->PeekPacketTag (tag);
-    if(found){
+    if(packet->PeekPacketTag (tag)){
         unsched=tag.GetValue();
     }
 
-    Ipv4Address source_address = ipv4Header.GetSource ();
-    Ipv4Address dest_address = ipv4Header.GetDestination ();
-    uint8_t protocol = ipv4Header.GetProtocol ();
-    uint32_t tos = (uint32_t)ipv4Header.GetTos();
-    uint32_t ecn = (uint32_t)ipv4Header.GetEcn();
-    uint32_t dscp = (uint32_t)ipv4Header.GetDscp();
-    uint16_t srcPort = 0;
-    uint16_t dstPort = 0;
-
     uint32_t enqueue_index = 100;
-    if(protocol == UdpL4Protocol::PROT_NUMBER){
-        UdpHeader udpHeader;
-        copyPacket->RemoveHeader (udpHeader);
-        srcPort = udpHeader.GetSourcePort ();
-        dstPort = udpHeader.GetDestinationPort ();
-        
-        // enqueue_index = 0;
-        enqueue_index = dscp;
-        
-    }else if(protocol == TcpL4Protocol::PROT_NUMBER){
-        TcpHeader tcpHeader;
-        copyPacket->RemoveHeader (tcpHeader);
-        srcPort = tcpHeader.GetSourcePort ();
-        dstPort = tcpHeader.GetDestinationPort ();
-        
-        enqueue_index = GetQueueId(source_address.Get(), dest_address.Get(), uint32_t(dstPort));
+    if(key.protocol == UdpL4Protocol::PROT_NUMBER){
+        enqueue_index = key.tos >> 2;     //dscp
+    }else if(key.protocol == TcpL4Protocol::PROT_NUMBER){
+        enqueue_index = GetQueueId(key.src, key.dst, uint32_t(key.dstPort));
         if(enqueue_index == 100)
         {   //may be it is not a positive flow, it is ack
             enqueue_index = 0;
         }
-    
-    }
-    if(0){
-        std::cout<<"--------------------"<<std::endl;
-        std::cout<<"pkt_size: "<<packet->GetSize()<<std::endl;
-        std::cout<<source_address<<" : "<<srcPort<<" --> "<<dest_address<<" : "<<dstPort<<std::endl;
-        std::cout<<"protocol: "<<int(protocol)<<std::endl;
-        std::cout<<"tos: "<<tos<<std::endl;
-        std::cout<<"ecn: "<<ecn<<std::endl;
-        std::cout<<"dscp: "<<dscp<<std::endl;
-        std::cout<<std::endl;
-        std::cout<<"--------------------"<<std::endl;
-    }
-    bool is_query = false;
-    if(enqueue_index == 1 && dstPort >= 20010 && dstPort <= 65530){
-        is_query = true;
     }
-    
-    Ptr<MultipleQueue<Packet> > mulqueue = m_queue->GetObject<MultipleQueue<Packet> >();
-    // uint32_t enqueue_index = dscp;
-    Ptr<Queue<Packet> >subqueue = mulqueue->m_queues[enqueue_index];
 
-    
+    Queue<Packet>* subqueue = PeekPointer(mulqueue->m_queues[enqueue_index]);
+
     //ECN process--------------------------------------------------------------------------------------------------------
-    std::string ecnFlag = "false";
-    if(int(subqueue->GetNBytes() + packet->GetSize() - usedStaticBuffer[enqueue_index]) > int(m_switch->GetEcnThreshold())){
+    //only ECN capable packets are marked, so the IPv4 header is rewritten for them alone
+    const char* ecnFlag = "false";
+    uint8_t ecn = key.tos & 0x3;
+    if((ecn == Ipv4Header::EcnType::ECN_ECT1 || ecn == Ipv4Header::EcnType::ECN_ECT0) &&
+       int(subqueue->GetNBytes() + packet->GetSize() - usedStaticBuffer[enqueue_index]) > int(m_switch->GetEcnThreshold())){
         Ipv4Header tempheader;
         packet->RemoveHeader(tempheader);
-
-        if(tempheader.GetEcn()==Ipv4Header::EcnType::ECN_ECT1||tempheader.GetEcn()==Ipv4Header::EcnType::ECN_ECT0)
-        {
-            tempheader.SetEcn(Ipv4Header::EcnType::ECN_CE);
-            ecnFlag = "true";
-        }
-        // if(enqueue_index<=1){
-        //     if(tempheader.GetEcn()==Ipv4Header::EcnType::ECN_ECT1||tempheader.GetEcn()==Ipv4Header::EcnType::ECN_ECT0)
-        //     {
-        //         tempheader.SetEcn(Ipv4Header::EcnType::ECN_CE);
-        //         ecnFlag = "true";
-        //     }
-        // }
-        
+        tempheader.SetEcn(Ipv4Header::EcnType::ECN_CE);
         packet->AddHeader(tempheader);
+        ecnFlag = "true";
     }
 
     //
@@ -848,37 +838,25 @@ SharedMemoryPointToPointNetDevice::SendSwitch (
         usedStaticBufferFlag = true;
         enqueue_flag = mulqueue->EnqueueTos(packet,enqueue_index);
     }else{
-        if(AcceptPacket(packet, enqueue_index, unsched)==true){
+        if((this->*m_accept)(packet, enqueue_index, unsched)==true){
         enqueue_flag = mulqueue->EnqueueTos(packet,enqueue_index);
         }
     }
     
-    // if(enqueue_flag == false && is_query == true){
-    //     WriteQueryLoss();
-    // }
     if(enqueue_flag == false){
         WriteQueryLoss();
     }
 
-    if(enqueue_flag == false){
-        
-    }
-
     if(enqueue_flag){
         
         if(usedStaticBufferFlag==true){
             usedStaticBuffer[enqueue_index] += packet->GetSize();
         }else{
-            m_switch->AddUsed(packet->GetSize(), enqueue_index);
+            m_switch->AddUsed(packet->GetSize(), enqueue_index, GetIfIndex());
         }    
         WriteDetail("+",packet, enqueue_index);
         //show in terminal and write into file
         WriteQueueMsg(enqueue_index, ecnFlag);
-        
-        // if(m_node->GetId() == 10)
-        // {
-        //     ShowMMU();
-        // }
 
         if(m_txMachineState == READY){
         uint32_t dequeue_index = 0 ;
@@ -892,23 +870,19 @@ SharedMemoryPointToPointNetDevice::SendSwitch (
                 return false;
             }
             dequeue_index = mulqueue->GetDeIndex();        
-            Ptr<Queue<Packet> >subqueue_de = mulqueue->m_queues[dequeue_index];
+            Queue<Packet>* subqueue_de = PeekPointer(mulqueue->m_queues[dequeue_index]);
 
             if(usedStaticBuffer[dequeue_index] > subqueue_de->GetNBytes()){
                 usedStaticBuffer[dequeue_index] -= packet->GetSize();   //the packet comes from static memory
             }else{
                 
-                m_switch->DeleteUsed(packet->GetSize(), dequeue_index); //the packet comes from shared memory
+                m_switch->DeleteUsed(packet->GetSize(), dequeue_index, GetIfIndex()); //the packet comes from shared memory
                 TokenDelete(packet->GetSize());
             }
 
             WriteDetail("-",packet, dequeue_index);
 
             WriteQueueMsg(dequeue_index);
-            // if(m_node->GetId() == 10)
-            // {
-            //     ShowMMU();
-            // }
 
         }else{
             return false;
@@ -925,108 +899,135 @@ SharedMemoryPointToPointNetDevice::SendSwitch (
     return false;
 }
 
-bool
-SharedMemoryPointToPointNetDevice::AcceptPacket(Ptr<Packet> packet, uint32_t index, uint32_t unsched){
-    Ptr<MultipleQueue<Packet> > mulqueue = m_queue->GetObject<MultipleQueue<Packet> >();
-    uint32_t enqueue_index = index;
-    Ptr<Queue<Packet> >subqueue = mulqueue->m_queues[enqueue_index];
-    // Ptr<Switch> m_switch = m_node->m_switch;
-    Ptr<Switch> m_switch = GetMMUSwitch();
+void
+SharedMemoryPointToPointNetDevice::BindSwitch()
+{
+    m_mmu = nullptr;
+    GetMMUSwitch();
+    if (m_mulqueue == nullptr)
+    {
+        m_mulqueue = m_queue->GetObject<MultipleQueue<Packet>>();
+    }
+    NS_ASSERT_MSG(m_mulqueue, "A switch port needs a MultipleQueue");
 
-    if(m_switch->GetEnqueueMethod() == Switch::NORMAL_ENQUEUE){
-        //do nothing, the packet can enqueue if the subqueue have space to store it
-        if(int(m_switch->GetUsedBuffer() + packet->GetSize()  ) > m_switch->GetMaxBuffer()){         //we need delete the sum of all static buffer used
-            return false;
-        }
-    }else if(m_switch->GetEnqueueMethod() == Switch::DT){
+    m_threshold = &SharedMemoryPointToPointNetDevice::StaticThreshold;
+    switch (m_mmu->GetEnqueueMethod())
+    {
+    case Switch::DT:
+        m_accept = &SharedMemoryPointToPointNetDevice::AcceptDt;
+        break;
+    case Switch::MULTILAYER_DT:
+        m_accept = &SharedMemoryPointToPointNetDevice::AcceptMultilayerDt;
+        break;
+    case Switch::PUSHOUT:
+        m_accept = &SharedMemoryPointToPointNetDevice::AcceptPushout;
+        break;
+    case Switch::ABM:
+        m_accept = &SharedMemoryPointToPointNetDevice::AcceptAbm;
+        m_threshold = &SharedMemoryPointToPointNetDevice::AbmThreshold;
+        break;
+    default:
+        m_accept = &SharedMemoryPointToPointNetDevice::AcceptNormal;
+        break;
+    }
+}
 
-        if(int(m_switch->GetUsedBuffer() + packet->GetSize()  ) > m_switch->GetMaxBuffer()){          //we need delete static buffer from the total queue length
-            return false;
-        }
+bool
+SharedMemoryPointToPointNetDevice::AcceptPacket(Ptr<Packet> packet, uint32_t index, uint32_t unsched){
+    if (m_accept == nullptr)
+    {
+        BindSwitch();
+    }
+    return (this->*m_accept)(packet, index, unsched);
+}
 
-        //queue len need less than threshold 
-        if (int(subqueue->GetNBytes() + packet->GetSize() - usedStaticBuffer[index]) > GetQueueThreshold(enqueue_index)){
-            return false;
-        }
+bool
+SharedMemoryPointToPointNetDevice::AcceptNormal(Ptr<Packet> packet, uint32_t index, uint32_t unsched){
+    //do nothing, the packet can enqueue if the subqueue have space to store it
+    if(int(m_mmu->GetUsedBuffer() + packet->GetSize()  ) > m_mmu->GetMaxBuffer()){         //we need delete the sum of all static buffer used
+        return false;
+    }
+    return true;
+}
 
+bool
+SharedMemoryPointToPointNetDevice::AcceptDt(Ptr<Packet> packet, uint32_t index, uint32_t unsched){
+    if(int(m_mmu->GetUsedBuffer() + packet->GetSize()  ) > m_mmu->GetMaxBuffer()){          //we need delete static buffer from the total queue length
+        return false;
+    }
 
-    }else if(m_switch->GetEnqueueMethod() == Switch::MULTILAYER_DT){
+    //queue len need less than threshold 
+    if (int(m_mulqueue->m_queues[index]->GetNBytes() + packet->GetSize() - usedStaticBuffer[index]) > StaticThreshold(index)){
+        return false;
+    }
+    return true;
+}
 
-        Ptr<Switch> global_switch = m_node->m_switch;
-        if(!global_switch->first_flag){ //only need to call one
-            // std::cout<<"call "<<std::endl;
-            TokenAdd();
-        } 
+bool
+SharedMemoryPointToPointNetDevice::AcceptMultilayerDt(Ptr<Packet> packet, uint32_t index, uint32_t unsched){
+    Ptr<Switch> global_switch = m_node->m_switch;
+    if(!global_switch->first_flag){ //only need to call one
+        TokenAdd();
+    } 
 
+    if(int(m_mmu->GetUsedBuffer() + packet->GetSize()  ) > m_mmu->GetMaxBuffer()){
+        return false;
+    }
 
+    //if queue len is 0, packet can enqueue
+    uint32_t qlen = m_mulqueue->m_queues[index]->GetNBytes();
+    if (int(qlen - usedStaticBuffer[index]) != 0){
 
-        if(int(m_switch->GetUsedBuffer() + packet->GetSize()  ) > m_switch->GetMaxBuffer()){
+        //queue len need less than threshold
+        if (int(qlen + packet->GetSize() - usedStaticBuffer[index]) > StaticThreshold(index)){
             return false;
         }
+    }
+    return true;
+}
 
-        //if queue len is 0, packet can enqueue
-        if (int(subqueue->GetNBytes() - usedStaticBuffer[index]) != 0){
-
-            //queue len need less than threshold
-            if (int(subqueue->GetNBytes() + packet->GetSize() - usedStaticBuffer[index]) > GetQueueThreshold(enqueue_index)){
+bool
+SharedMemoryPointToPointNetDevice::AcceptPushout(Ptr<Packet> packet, uint32_t index, uint32_t unsched){
+    if(int(m_mmu->GetUsedBuffer() + packet->GetSize()  ) > m_mmu->GetMaxBuffer()){              
+        uint32_t need_space = packet->GetSize();
+        uint32_t push_space = 0;
+        while(push_space < need_space){
+            Ptr<Packet> pushout_packet = PushOutPacket(index);
+            if(pushout_packet == NULL){
                 return false;
             }
-            //priority len need less than the priority threshold, switch have the priority space, so we don't need to deleting ______delete finally
-            // if( uint64_t(m_switch->GetPrioritySize(enqueue_index) + packet->GetSize()) > m_switch->GetPriorityThreshold(enqueue_index)){
-            //     std::cout<<"drop: "<<m_switch->GetPrioritySize(enqueue_index)<<" "<<m_switch->GetPriorityThreshold(enqueue_index)<<std::endl;
-            //     return false;
-            // }
-        }
-
-        
-    }else if(m_switch->GetEnqueueMethod() == Switch::PUSHOUT){
-
-        if(int(m_switch->GetUsedBuffer() + packet->GetSize()  ) > m_switch->GetMaxBuffer()){              
-            uint32_t need_space = packet->GetSize();
-            uint32_t push_space = 0;
-            while(push_space < need_space){
-                Ptr<Packet> pushout_packet = PushOutPacket(enqueue_index);
-                if(pushout_packet == NULL){
-                    return false;
-                }
-                WriteDetail("p", pushout_packet, 0); 
-                push_space += pushout_packet->GetSize();
-            }
-             
-        }
- 
-    }else if(m_switch->GetEnqueueMethod() == Switch::ABM){
-        if(firstTimeUpdate){
-            firstTimeUpdate=false;
-            InvokeUpdates(updateInterval);
+            WriteDetail("p", pushout_packet, 0); 
+            push_space += pushout_packet->GetSize();
         }
-        uint64_t currentSize = subqueue->GetNBytes() - usedStaticBuffer[index];
-        double satLevel = 0;
-        if(currentSize >= 0.9*GetQueueThreshold(enqueue_index) ){
-            satLevel = 1;
-        }
-        uint32_t portId = this->GetIfIndex();
-        m_switch->SetSaturated(portId, enqueue_index, satLevel);
+    }
+    return true;
+}
 
-        if(int(m_switch->GetUsedBuffer() + packet->GetSize()  ) > m_switch->GetMaxBuffer()){
-            return false;
-        }
+bool
+SharedMemoryPointToPointNetDevice::AcceptAbm(Ptr<Packet> packet, uint32_t index, uint32_t unsched){
+    if(firstTimeUpdate){
+        firstTimeUpdate=false;
+        InvokeUpdates(updateInterval);
+    }
+    uint32_t qlen = m_mulqueue->m_queues[index]->GetNBytes();
+    uint64_t currentSize = qlen - usedStaticBuffer[index];
+    int threshold = AbmThreshold(index);
+    double satLevel = 0;
+    if(currentSize >= 0.9*threshold ){
+        satLevel = 1;
+    }
+    m_mmu->SetSaturated(GetIfIndex(), index, satLevel);
 
-        //queue len need less than threshold 
-        int threshold = GetQueueThreshold(enqueue_index);
-        if (unsched){
-        uint32_t priority = m_switch->qToP[enqueue_index];
-            // threshold = threshold * alphaUnsched / m_switch->qAlpha[priority];
-            threshold = threshold;    //don't use
-        } 
-        if (int(subqueue->GetNBytes() + packet->GetSize() - usedStaticBuffer[index]) > threshold){
+    if(int(m_mmu->GetUsedBuffer() + packet->GetSize()  ) > m_mmu->GetMaxBuffer()){
         return false;
-        }
-
     }
 
+    //queue len need less than threshold, unscheduled packets use the same threshold for now
+    if (int(qlen + packet->GetSize() - usedStaticBuffer[index]) > threshold){
+        return false;
+    }
     return true;
-}  
+}
 
 bool
 SharedMemoryPointToPointNetDevice::SendNode (
@@ -1291,9 +1292,11 @@ SharedMemoryPointToPointNetDevice::GetName (){
 }
 
 void
-SharedMemoryPointToPointNetDevice::WriteQueueMsg(int subqueueNo,std::string ecnFlag){
-    Ptr<MultipleQueue<Packet> > mulqueue = m_queue->GetObject<MultipleQueue<Packet> >();
-    Ptr<Queue<Packet> >subqueue = mulqueue->m_queues[subqueueNo];
+SharedMemoryPointToPointNetDevice::WriteQueueMsg(int subqueueNo, const char* ecnFlag){
+    if(m_writeFlag == false){
+        return;
+    }
+    Ptr<Queue<Packet> >subqueue = m_mulqueue->m_queues[subqueueNo];
     int queneLength = subqueue->GetNBytes();       //this is queue len, don't delete static buffer
     // int queneLength = subqueue->GetNBytes() - usedStaticBuffer[subqueueNo];       //this is queue len, delete static buffer
     int threshold = GetQueueThreshold(subqueueNo);
@@ -1378,7 +1381,7 @@ SharedMemoryPointToPointNetDevice::WriteDetail(std::string action, Ptr<Packet> p
         dstPort = tcpHeader.GetDestinationPort ();
     }
     if(m_node->GetNodeType() == 1 && action=="ed"){
-        Ptr<MultipleQueue<Packet> > mulqueue = m_queue->GetObject<MultipleQueue<Packet> >();
+        Ptr<MultipleQueue<Packet> > mulqueue = m_mulqueue;
         Ptr<Queue<Packet> >subqueue = mulqueue->m_queues[index];
         int queneLength = subqueue->GetNBytes();       //this is queue len, don't delete static buffer
         int threshold = GetQueueThreshold(index);
@@ -1446,6 +1449,7 @@ SharedMemoryPointToPointNetDevice::PushOutPacket(uint32_t enqueue_index)
     uint32_t longest_queue_len = 0;
     Ptr<Packet> packet = NULL;
     uint32_t dequeue_index = 0;
+    uint32_t dequeue_port = 0;
 
     Ptr<Queue<Packet> >longest_queue = NULL;
     // for(uint32_t i=0; i<m_node->GetNDevices(); i++){
@@ -1463,12 +1467,13 @@ SharedMemoryPointToPointNetDevice::PushOutPacket(uint32_t enqueue_index)
                 longest_queue_len = subqueue_len;
                 longest_queue = mulqueue->m_queues[j];
                 dequeue_index = j;
+                dequeue_port = i;
             }
         }    
         
     }
 
-    Ptr<MultipleQueue<Packet> > mulqueue = m_queue->GetObject<MultipleQueue<Packet> >();
+    Ptr<MultipleQueue<Packet> > mulqueue = m_mulqueue;
     if(mulqueue->GetDequeueType() == MultipleQueue<Packet>::DequeueType::PQ){
         
         if(dequeue_index < enqueue_index){  //low can't push high 
@@ -1483,7 +1488,7 @@ SharedMemoryPointToPointNetDevice::PushOutPacket(uint32_t enqueue_index)
     packet = longest_queue->Dequeue();
     
     if(packet != NULL){
-        m_switch->DeleteUsed(packet->GetSize(), dequeue_index);
+        m_switch->DeleteUsed(packet->GetSize(), dequeue_index, dequeue_port);
     }
     return packet;
 }
@@ -1531,24 +1536,24 @@ SharedMemoryPointToPointNetDevice::GetDequeueRate(uint32_t enqueue_index){
 
 int
 SharedMemoryPointToPointNetDevice::GetQueueThreshold(uint32_t index){
-    double threshold = 0;
-    // Ptr<Switch> m_switch = m_node->m_switch;
-    Ptr<Switch> m_switch = GetMMUSwitch();
-
-    if(m_switch->GetEnqueueMethod() == Switch::NORMAL_ENQUEUE){
-        threshold = m_switch->GetQueueThreshold(index);
-    }else if(m_switch->GetEnqueueMethod() == Switch::DT){
-        threshold = m_switch->GetQueueThreshold(index);
-    }else if(m_switch->GetEnqueueMethod() == Switch::MULTILAYER_DT){
-        threshold = m_switch->GetQueueThreshold(index);
-    }else if(m_switch->GetEnqueueMethod() == Switch::PUSHOUT){
-        threshold = m_switch->GetQueueThreshold(index);
-    }else if(m_switch->GetEnqueueMethod() == Switch::ABM){
-        threshold = m_switch->GetQueueThreshold(index)*GetDequeueRate(index)/GetNP(index);
-        if (threshold> UINT32_MAX){
-            threshold = UINT32_MAX-1500;
-        } 
+    if (m_threshold == nullptr)
+    {
+        BindSwitch();
     }
+    return (this->*m_threshold)(index);
+}
+
+int
+SharedMemoryPointToPointNetDevice::StaticThreshold(uint32_t index){
+    return m_mmu->GetQueueThreshold(index);
+}
+
+int
+SharedMemoryPointToPointNetDevice::AbmThreshold(uint32_t index){
+    double threshold = m_mmu->GetQueueThreshold(index)*GetDequeueRate(index)/GetNP(index);
+    if (threshold> UINT32_MAX){
+        threshold = UINT32_MAX-1500;
+    } 
     return int(threshold);
 }
 
@@ -1679,7 +1684,7 @@ SharedMemoryPointToPointNetDevice::DropRR()
     // Ptr<Switch> m_switch = m_node->m_switch;
     Ptr<Switch> m_switch = GetMMUSwitch();
 
-    Ptr<MultipleQueue<Packet> > mulqueue = m_queue->GetObject<MultipleQueue<Packet> >();
+    Ptr<MultipleQueue<Packet> > mulqueue = m_mulqueue;
     while(1)
     {   
         bool flag = false;
@@ -1701,7 +1706,7 @@ SharedMemoryPointToPointNetDevice::DropRR()
                 // std::cout<<the_time<<"    "<<last_head_drop_time<<"     " <<the_time - last_head_drop_time<<std::endl;
                 Ptr<Packet> packet = mulqueue->Dequeue(check_index);
                 if(packet != NULL){
-                    m_switch->DeleteUsed(packet->GetSize(), check_index);
+                    m_switch->DeleteUsed(packet->GetSize(), check_index, GetIfIndex());
                     m_switch->last_head_drop_time = (int64_t)Simulator::Now ().GetNanoSeconds ();
                     // std::cout<<m_switch-> last_head_drop_time<<std::endl;
                 }
@@ -1719,25 +1724,13 @@ SharedMemoryPointToPointNetDevice::DropRR()
 Ptr<Switch>
 SharedMemoryPointToPointNetDevice::GetMMUSwitch()
 {   
-    
-    Ptr<Switch> mmu_switch = nullptr;
-    uint32_t port_num =  this->GetIfIndex() - 1;   //0 is stack
-
-
-    // std::cout<<"p"<<port_num << " "<< this->GetType()<<std::endl;
-    if(port_num / 8 > 3)
+    if(m_mmu == nullptr)
     {
-        std::cout<<"GetMMUSwitch error"<<std::endl;
-    }
-
-    if(port_num / 8 >= 3)
-    {   
-        std::cout<<port_num<<std::endl;
-        std::cout<<"where 3? "<<std::endl;
-        std::cout<<this->GetType()<<std::endl;
+        uint32_t port_num =  this->GetIfIndex() - 1;   //0 is stack
+        NS_ASSERT_MSG(port_num / 8 < 4, "Port " << port_num << " is beyond the 4 MMUs of the switch");
+        m_mmu = m_node->m_switch_group[port_num/8];
     }
-    mmu_switch = m_node->m_switch_group[port_num/8];
-    return mmu_switch;
+    return m_mmu;
 }
 
 void 
@@ -1825,7 +1818,7 @@ SharedMemoryPointToPointNetDevice::DropTOKEN()
 
     uint32_t temp_last_head_drop_port = m_switch->last_head_drop_port;
     uint32_t temp_last_head_drop_queue = m_switch->last_head_drop_queue;
-    uint32_t max_queue_no = m_queue->GetObject<MultipleQueue<Packet> >()->m_useqCnt;
+    uint32_t max_queue_no = m_mulqueue->m_useqCnt;
     
     // std::cout<<"token drop"<<std::endl;
     while(1){
@@ -1861,7 +1854,7 @@ SharedMemoryPointToPointNetDevice::DropTOKEN()
             
             Ptr<Packet> packet = mulqueue->Dequeue(temp_last_head_drop_queue);
             if(packet != NULL){
-                m_switch->DeleteUsed(packet->GetSize(), temp_last_head_drop_queue);
+                m_switch->DeleteUsed(packet->GetSize(), temp_last_head_drop_queue, temp_last_head_drop_port);
                 TokenDelete(packet->GetSize());
                 //store msg
                 m_switch->last_head_drop_port = temp_last_head_drop_port;
@@ -1893,7 +1886,7 @@ SharedMemoryPointToPointNetDevice::DropLONGTOKEN()
     uint32_t longest_queue_len = 0;
     Ptr<Packet> packet = NULL;
     uint32_t dequeue_index = 0;
-    uint32_t max_queue_no = m_queue->GetObject<MultipleQueue<Packet> >()->m_useqCnt;
+    uint32_t max_queue_no = m_mulqueue->m_useqCnt;
     uint32_t long_dev_index = 0;
 
     Ptr<Queue<Packet> >longest_queue = NULL;
@@ -1920,7 +1913,7 @@ SharedMemoryPointToPointNetDevice::DropLONGTOKEN()
     if(double(longest_queue->GetNBytes() - usedStaticBuffer[dequeue_index]) / double(GetQueueThreshold(dequeue_index)) > 1.0){
         packet = longest_queue->Dequeue();
         if(packet != NULL){
-            m_switch->DeleteUsed(packet->GetSize(), dequeue_index);
+            m_switch->DeleteUsed(packet->GetSize(), dequeue_index, long_dev_index);
             // std::cout<<"head-long: "<<m_node->GetId()<<" "<<long_dev_index<<"-"<<dequeue_index<<std::endl;
             TokenDelete(packet->GetSize());    
         }
@@ -37,6 +37,8 @@ namespace ns3
 
 class SharedMemoryPointToPointChannel;
 class ErrorModel;
+template <typename Item>
+class MultipleQueue;
 
 /**
  * \defgroup point-to-point Point-To-Point Network Device
@@ -68,7 +70,7 @@ class SharedMemoryPointToPointNetDevice : public NetDevice
     std::ofstream m_fileFout;
     int m_writeCount = 0;
     int m_writeFrequence = 1;
-    void WriteQueueMsg(int subqueueNo, std::string ecnFlag = "null");
+    void WriteQueueMsg(int subqueueNo, const char* ecnFlag = "null");
     void SetWriteFileFolderName(std::string folderName);
     Ptr<Packet> PushOutPacket(uint32_t enqueue_index);
     int GetQueueThreshold(uint32_t index);
@@ -390,6 +392,32 @@ class SharedMemoryPointToPointNetDevice : public NetDevice
      */
     void NotifyLinkUp();
 
+    /**
+     * \brief Resolve the MMU and the MultipleQueue of a switch port and bind the
+     * admission policy of the MMU enqueue method.
+     *
+     * Done once, when the port switches its first packet: the enqueue method must
+     * not change after the traffic has started.
+     */
+    void BindSwitch();
+
+    // admission policies, one per Switch::EnqueueMethod
+    bool AcceptNormal(Ptr<Packet> packet, uint32_t index, uint32_t unsched);
+    bool AcceptDt(Ptr<Packet> packet, uint32_t index, uint32_t unsched);
+    bool AcceptMultilayerDt(Ptr<Packet> packet, uint32_t index, uint32_t unsched);
+    bool AcceptPushout(Ptr<Packet> packet, uint32_t index, uint32_t unsched);
+    bool AcceptAbm(Ptr<Packet> packet, uint32_t index, uint32_t unsched);
+    int StaticThreshold(uint32_t index);
+    int AbmThreshold(uint32_t index);
+
+    typedef bool (SharedMemoryPointToPointNetDevice::*AcceptPolicy)(Ptr<Packet>, uint32_t, uint32_t);
+    typedef int (SharedMemoryPointToPointNetDevice::*ThresholdPolicy)(uint32_t);
+
+    Ptr<Switch> m_mmu;                     //!< MMU whose buffer this port shares
+    Ptr<MultipleQueue<Packet>> m_mulqueue; //!< m_queue as a MultipleQueue
+    AcceptPolicy m_accept;                 //!< bound by BindSwitch
+    ThresholdPolicy m_threshold;           //!< bound by BindSwitch
+
     /**
      * Enumeration of the states of the transmit machine of the net device.
      */
@@ -0,0 +1,413 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/data-rate.h"
+#include "ns3/multiple-queue.h"
+#include "ns3/node.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/shared-memory-point-to-point-net-device.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/simulator.h"
+#include "ns3/switch.h"
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Runs the same random enqueues and dequeues on two identical switches, one admitting
+ * with SharedMemoryPointToPointNetDevice::AcceptPacket and the other with a copy of the
+ * AcceptPacket that dispatched on the enqueue method per packet, and checks that every packet
+ * gets the same admit/drop decision and that the queues stay the same.
+ *
+ * Enqueues go to the static buffer of a queue first, as in SendSwitch. The ports have 2000 bytes
+ * of static buffer and share a 30000 byte MMU; the ABM rates are updated every 10us.
+ */
+class SharedMemoryAdmissionTestCase : public TestCase
+{
+  public:
+    /**
+     * \param method enqueue method of the MMUs
+     * \param name name of the method
+     */
+    SharedMemoryAdmissionTestCase(Switch::EnqueueMethod method, const std::string& name);
+
+  private:
+    struct Op
+    {
+        bool enqueue;
+        uint32_t port;  //!< 1 to PORTS
+        uint32_t index; //!< queue
+        uint32_t size;
+    };
+
+    /// a switch and its ports, device i is port i
+    struct Twin
+    {
+        Ptr<Node> node;
+        std::vector<Ptr<SharedMemoryPointToPointNetDevice>> dev;
+    };
+
+    void DoRun() override;
+    void Build(Twin& t);
+    void Apply(uint32_t i);
+    /// enqueues as SendSwitch does, returns whether the packet was admitted
+    bool Enqueue(Twin& t, const Op& op, bool reference);
+    void Dequeue(Twin& t, const Op& op);
+    /// bytes in the subqueues of a port
+    static uint32_t QueuedBytes(Ptr<SharedMemoryPointToPointNetDevice> dev);
+    /// bytes in all the subqueues of the switch
+    static uint32_t QueuedBytes(const Twin& t);
+
+    /// AcceptPacket before the policies were bound once per port
+    static bool ReferenceAccept(Ptr<SharedMemoryPointToPointNetDevice> dev,
+                                Ptr<Packet> packet,
+                                uint32_t index);
+    static int ReferenceThreshold(Ptr<SharedMemoryPointToPointNetDevice> dev, uint32_t index);
+
+    static const uint32_t PORTS = 8;
+    static const uint32_t OPS = 4000;
+
+    Switch::EnqueueMethod m_method;
+    Twin m_twin[2]; //!< bound policies, reference
+    std::vector<Op> m_ops;
+    uint32_t m_applied;
+    uint32_t m_admitted;
+    uint32_t m_dropped;
+    uint32_t m_pushedOut; //!< admissions that pushed packets out
+    uint32_t m_differ;
+    uint32_t m_firstDiffer;
+};
+
+SharedMemoryAdmissionTestCase::SharedMemoryAdmissionTestCase(Switch::EnqueueMethod method,
+                                                             const std::string& name)
+    : TestCase("Admission of " + name + " against the per-packet dispatch"),
+      m_method(method),
+      m_applied(0),
+      m_admitted(0),
+      m_dropped(0),
+      m_pushedOut(0),
+      m_differ(0),
+      m_firstDiffer(0)
+{
+}
+
+bool
+SharedMemoryAdmissionTestCase::ReferenceAccept(Ptr<SharedMemoryPointToPointNetDevice> dev,
+                                               Ptr<Packet> packet,
+                                               uint32_t index)
+{
+    Ptr<MultipleQueue<Packet>> mulqueue = dev->GetQueue()->GetObject<MultipleQueue<Packet>>();
+    Ptr<Queue<Packet>> subqueue = mulqueue->m_queues[index];
+    Ptr<Switch> m_switch = dev->GetMMUSwitch();
+    uint32_t* usedStaticBuffer = dev->usedStaticBuffer;
+
+    if (m_switch->GetEnqueueMethod() == Switch::NORMAL_ENQUEUE)
+    {
+        if (int(m_switch->GetUsedBuffer() + packet->GetSize()) > m_switch->GetMaxBuffer())
+        {
+            return false;
+        }
+    }
+    else if (m_switch->GetEnqueueMethod() == Switch::DT)
+    {
+        if (int(m_switch->GetUsedBuffer() + packet->GetSize()) > m_switch->GetMaxBuffer())
+        {
+            return false;
+        }
+        if (int(subqueue->GetNBytes() + packet->GetSize() - usedStaticBuffer[index]) >
+            ReferenceThreshold(dev, index))
+        {
+            return false;
+        }
+    }
+    else if (m_switch->GetEnqueueMethod() == Switch::MULTILAYER_DT)
+    {
+        Ptr<Switch> global_switch = dev->GetNode()->m_switch;
+        if (!global_switch->first_flag)
+        {
+            dev->TokenAdd();
+        }
+        if (int(m_switch->GetUsedBuffer() + packet->GetSize()) > m_switch->GetMaxBuffer())
+        {
+            return false;
+        }
+        if (int(subqueue->GetNBytes() - usedStaticBuffer[index]) != 0)
+        {
+            if (int(subqueue->GetNBytes() + packet->GetSize() - usedStaticBuffer[index]) >
+                ReferenceThreshold(dev, index))
+            {
+                return false;
+            }
+        }
+    }
+    else if (m_switch->GetEnqueueMethod() == Switch::PUSHOUT)
+    {
+        if (int(m_switch->GetUsedBuffer() + packet->GetSize()) > m_switch->GetMaxBuffer())
+        {
+            uint32_t need_space = packet->GetSize();
+            uint32_t push_space = 0;
+            while (push_space < need_space)
+            {
+                Ptr<Packet> pushout_packet = dev->PushOutPacket(index);
+                if (pushout_packet == nullptr)
+                {
+                    return false;
+                }
+                push_space += pushout_packet->GetSize();
+            }
+        }
+    }
+    else if (m_switch->GetEnqueueMethod() == Switch::ABM)
+    {
+        if (dev->firstTimeUpdate)
+        {
+            dev->firstTimeUpdate = false;
+            dev->InvokeUpdates(dev->updateInterval);
+        }
+        uint64_t currentSize = subqueue->GetNBytes() - usedStaticBuffer[index];
+        double satLevel = 0;
+        if (currentSize >= 0.9 * ReferenceThreshold(dev, index))
+        {
+            satLevel = 1;
+        }
+        m_switch->SetSaturated(dev->GetIfIndex(), index, satLevel);
+        if (int(m_switch->GetUsedBuffer() + packet->GetSize()) > m_switch->GetMaxBuffer())
+        {
+            return false;
+        }
+        if (int(subqueue->GetNBytes() + packet->GetSize() - usedStaticBuffer[index]) >
+            ReferenceThreshold(dev, index))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int
+SharedMemoryAdmissionTestCase::ReferenceThreshold(Ptr<SharedMemoryPointToPointNetDevice> dev,
+                                                  uint32_t index)
+{
+    Ptr<Switch> m_switch = dev->GetMMUSwitch();
+    double threshold = m_switch->GetQueueThreshold(index);
+    if (m_switch->GetEnqueueMethod() == Switch::ABM)
+    {
+        threshold = threshold * dev->GetDequeueRate(index) / dev->GetNP(index);
+        if (threshold > UINT32_MAX)
+        {
+            threshold = UINT32_MAX - 1500;
+        }
+    }
+    return int(threshold);
+}
+
+void
+SharedMemoryAdmissionTestCase::Build(Twin& t)
+{
+    t.node = CreateObject<Node>();
+    t.node->SetNodeType(1);
+    t.node->m_switch->SetEnqueueMethod(m_method);
+    t.node->m_switch->port_num = PORTS;
+    for (uint32_t j = 0; j < 4; j++)
+    {
+        t.node->m_switch_group[j]->SetBuffer(30000, 0);
+        t.node->m_switch_group[j]->SetAllQueueAlpha(0.5);
+        t.node->m_switch_group[j]->SetEnqueueMethod(m_method);
+    }
+    // device 0 stands for the stack, PushOutPacket skips it
+    t.node->AddDevice(CreateObject<SimpleNetDevice>());
+    t.dev.assign(1, nullptr);
+    for (uint32_t i = 1; i <= PORTS; i++)
+    {
+        Ptr<SharedMemoryPointToPointNetDevice> dev =
+            CreateObject<SharedMemoryPointToPointNetDevice>();
+        dev->SetAttribute("StaticBuffer", UintegerValue(2000));
+        dev->SetAttribute("UpdataInterval", UintegerValue(10000));
+        dev->SetDataRate(DataRate("10Gbps"));
+        t.node->AddDevice(dev);
+        dev->SetQueue(CreateObject<MultipleQueue<Packet>>());
+        t.dev.push_back(dev);
+    }
+}
+
+bool
+SharedMemoryAdmissionTestCase::Enqueue(Twin& t, const Op& op, bool reference)
+{
+    Ptr<SharedMemoryPointToPointNetDevice> dev = t.dev[op.port];
+    Ptr<MultipleQueue<Packet>> mulqueue = dev->GetQueue()->GetObject<MultipleQueue<Packet>>();
+    Ptr<Packet> packet = Create<Packet>(op.size);
+    if (dev->usedStaticBuffer[op.index] + op.size <= dev->staticBuffer)
+    {
+        mulqueue->EnqueueTos(packet, op.index);
+        dev->usedStaticBuffer[op.index] += op.size;
+        return true;
+    }
+    bool accept = reference ? ReferenceAccept(dev, packet, op.index)
+                            : dev->AcceptPacket(packet, op.index, 0);
+    if (accept)
+    {
+        mulqueue->EnqueueTos(packet, op.index);
+        dev->GetMMUSwitch()->AddUsed(op.size, op.index, op.port);
+    }
+    return accept;
+}
+
+void
+SharedMemoryAdmissionTestCase::Dequeue(Twin& t, const Op& op)
+{
+    Ptr<SharedMemoryPointToPointNetDevice> dev = t.dev[op.port];
+    Ptr<MultipleQueue<Packet>> mulqueue = dev->GetQueue()->GetObject<MultipleQueue<Packet>>();
+    Ptr<Packet> packet = mulqueue->Dequeue();
+    if (packet == nullptr)
+    {
+        return;
+    }
+    uint32_t index = mulqueue->GetDeIndex();
+    if (dev->usedStaticBuffer[index] > mulqueue->m_queues[index]->GetNBytes())
+    {
+        dev->usedStaticBuffer[index] -= packet->GetSize();
+    }
+    else
+    {
+        dev->GetMMUSwitch()->DeleteUsed(packet->GetSize(), index, op.port);
+        dev->TokenDelete(packet->GetSize());
+    }
+    dev->ChangeDeqPriorityBytes(packet, index);
+}
+
+uint32_t
+SharedMemoryAdmissionTestCase::QueuedBytes(Ptr<SharedMemoryPointToPointNetDevice> dev)
+{
+    Ptr<MultipleQueue<Packet>> mulqueue = dev->GetQueue()->GetObject<MultipleQueue<Packet>>();
+    uint32_t bytes = 0;
+    for (const auto& subqueue : mulqueue->m_queues)
+    {
+        bytes += subqueue->GetNBytes();
+    }
+    return bytes;
+}
+
+uint32_t
+SharedMemoryAdmissionTestCase::QueuedBytes(const Twin& t)
+{
+    uint32_t bytes = 0;
+    for (uint32_t p = 1; p <= PORTS; p++)
+    {
+        bytes += QueuedBytes(t.dev[p]);
+    }
+    return bytes;
+}
+
+void
+SharedMemoryAdmissionTestCase::Apply(uint32_t i)
+{
+    const Op& op = m_ops[i];
+    m_applied++;
+    if (!op.enqueue)
+    {
+        Dequeue(m_twin[0], op);
+        Dequeue(m_twin[1], op);
+        return;
+    }
+    uint32_t before = QueuedBytes(m_twin[0]);
+    bool bound = Enqueue(m_twin[0], op, false);
+    bool reference = Enqueue(m_twin[1], op, true);
+    (bound ? m_admitted : m_dropped)++;
+    if (QueuedBytes(m_twin[0]) < before + (bound ? op.size : 0))
+    {
+        m_pushedOut++;
+    }
+    bool same = bound == reference;
+    for (uint32_t j = 0; j < 4 && same; j++)
+    {
+        same = m_twin[0].node->m_switch_group[j]->GetUsedBuffer() ==
+               m_twin[1].node->m_switch_group[j]->GetUsedBuffer();
+    }
+    for (uint32_t p = 1; p <= PORTS && same; p++)
+    {
+        same = QueuedBytes(m_twin[0].dev[p]) == QueuedBytes(m_twin[1].dev[p]);
+    }
+    if (!same && m_differ++ == 0)
+    {
+        m_firstDiffer = i;
+    }
+}
+
+void
+SharedMemoryAdmissionTestCase::DoRun()
+{
+    Build(m_twin[0]);
+    Build(m_twin[1]);
+
+    Ptr<UniformRandomVariable> uv = CreateObject<UniformRandomVariable>();
+    uv->SetStream(1);
+    const uint32_t sizes[] = {64, 1000, 1500};
+    for (uint32_t i = 0; i < OPS; i++)
+    {
+        Op op;
+        // more enqueues than dequeues, so that the shared buffer fills up
+        op.enqueue = uv->GetValue() < 0.7;
+        op.port = uv->GetInteger(1, PORTS);
+        op.index = uv->GetInteger(0, 7);
+        op.size = sizes[uv->GetInteger(0, 2)];
+        m_ops.push_back(op);
+        Simulator::Schedule(NanoSeconds(100 * (i + 1)),
+                            &SharedMemoryAdmissionTestCase::Apply,
+                            this,
+                            i);
+    }
+    Simulator::Stop(NanoSeconds(100 * (OPS + 1)));
+    Simulator::Run();
+    Simulator::Destroy();
+
+    NS_TEST_EXPECT_MSG_EQ(m_applied, OPS, "operations applied");
+    NS_TEST_EXPECT_MSG_GT(m_admitted, 0, "no packet admitted");
+    if (m_method == Switch::PUSHOUT)
+    {
+        NS_TEST_EXPECT_MSG_GT(m_pushedOut, 0, "no packet pushed out");
+    }
+    else
+    {
+        NS_TEST_EXPECT_MSG_GT(m_dropped, 0, "no packet dropped");
+        NS_TEST_EXPECT_MSG_EQ(m_pushedOut, 0, "packets pushed out");
+    }
+    NS_TEST_EXPECT_MSG_EQ(m_differ, 0, "first differing operation " << m_firstDiffer);
+}
+
+/**
+ * \brief TestSuite for the admission policies of SharedMemoryPointToPointNetDevice
+ */
+class SharedMemoryAdmissionTestSuite : public TestSuite
+{
+  public:
+    SharedMemoryAdmissionTestSuite();
+};
+
+SharedMemoryAdmissionTestSuite::SharedMemoryAdmissionTestSuite()
+    : TestSuite("shared-memory-admission", UNIT)
+{
+    AddTestCase(new SharedMemoryAdmissionTestCase(Switch::NORMAL_ENQUEUE, "NORMAL_ENQUEUE"),
+                TestCase::QUICK);
+    AddTestCase(new SharedMemoryAdmissionTestCase(Switch::DT, "DT"), TestCase::QUICK);
+    AddTestCase(new SharedMemoryAdmissionTestCase(Switch::MULTILAYER_DT, "MULTILAYER_DT"),
+                TestCase::QUICK);
+    AddTestCase(new SharedMemoryAdmissionTestCase(Switch::PUSHOUT, "PUSHOUT"), TestCase::QUICK);
+    AddTestCase(new SharedMemoryAdmissionTestCase(Switch::ABM, "ABM"), TestCase::QUICK);
+}
+
+static SharedMemoryAdmissionTestSuite g_sharedMemoryAdmissionTestSuite; //!< The testsuite
@@ -0,0 +1,346 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program writes binary flow traces (see FlowTraceReader) that the evaluation examples replay with
+// their flowTrace option, so that every buffer scheme is run on exactly the same arrivals.
+//
+// It generates the workloads of the examples: Poisson background flows per server with sizes drawn from a
+// CDF file, for RDMA and TCP, plus incast queries, on LEAF_COUNT leaves of SERVER_COUNT servers. The
+// destinations are on the next leaf (permutation, as the Reverie examples) or anywhere else (uniform, as the
+// Occamy examples). Everything is drawn from one seeded generator, and the per-server arrival processes are
+// merged on the fly, so multi-million flow traces are written in constant memory.
+//
+// It also converts the text flow files of the RDMA examples ("src dst pg dport size start" lines after the
+// flow count) and dumps a trace as text.
+//
+// Sample usage:
+//   ./ns3 run 'flow-trace-gen --cdf=examples/Occamy/websearch.txt --tcpLoad=0.4 --uniform=1 --out=web40.bin'
+//   ./ns3 run 'flow-trace-gen --convert=flow.txt --out=flow.bin'
+//   ./ns3 run 'flow-trace-gen --dump=web40.bin'
+
+#include "ns3/command-line.h"
+#include "ns3/flow-trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <vector>
+
+using namespace ns3;
+
+/// Flow size distribution, read and sampled as cdf.c does
+struct Cdf
+{
+    std::vector<double> value;
+    std::vector<double> cdf;
+
+    void Load(const std::string& file)
+    {
+        std::ifstream in(file);
+        if (!in)
+        {
+            std::cout << "Cannot open CDF file " << file << std::endl;
+            exit(1);
+        }
+        double v;
+        double c;
+        while (in >> v >> c)
+        {
+            value.push_back(v);
+            cdf.push_back(c);
+        }
+    }
+
+    double Mean() const
+    {
+        double avg = 0;
+        for (size_t i = 0; i < value.size(); i++)
+        {
+            double v = i == 0 ? value[i] / 2 : (value[i] + value[i - 1]) / 2;
+            double p = i == 0 ? cdf[i] : cdf[i] - cdf[i - 1];
+            avg += v * p;
+        }
+        return avg;
+    }
+
+    /// x uniform in [0, 1)
+    double Sample(double x) const
+    {
+        double lo = std::min(0.0, cdf.front());
+        double hi = std::max(1.0, cdf.back());
+        x = lo + x * (hi - lo);
+        for (size_t i = 0; i < value.size(); i++)
+        {
+            if (x <= cdf[i])
+            {
+                double x1 = i == 0 ? 0 : cdf[i - 1];
+                double y1 = i == 0 ? 0 : value[i - 1];
+                if (x1 == cdf[i])
+                {
+                    return (y1 + value[i]) / 2;
+                }
+                return y1 + (x - x1) * (value[i] - y1) / (cdf[i] - x1);
+            }
+        }
+        return value.back();
+    }
+};
+
+/// One Poisson arrival process: the background flows of a server, or its incast queries
+struct Source
+{
+    double next; //!< next arrival, s
+    double rate; //!< arrivals per second
+    uint32_t server;
+    uint8_t cls;
+    bool query;
+};
+
+struct Later
+{
+    bool operator()(const Source& a, const Source& b) const
+    {
+        return a.next > b.next;
+    }
+};
+
+int
+Dump(const std::string& path)
+{
+    FlowTraceReader reader;
+    if (!reader.Open(path))
+    {
+        std::cout << reader.GetError() << std::endl;
+        return 1;
+    }
+    std::cout << "start_ns size src dst id priority class flags" << std::endl;
+    for (uint64_t i = 0; i < reader.GetNFlows(); i++)
+    {
+        const FlowRecord& r = reader.Get(i);
+        std::cout << r.start << " " << r.size << " " << r.src << " " << r.dst << " " << r.id << " "
+                  << r.priority << " " << uint32_t(r.cls) << " " << uint32_t(r.flags) << std::endl;
+    }
+    return 0;
+}
+
+int
+Convert(const std::string& in, const std::string& out)
+{
+    std::ifstream f(in);
+    if (!f)
+    {
+        std::cout << "Cannot open flow file " << in << std::endl;
+        return 1;
+    }
+    uint64_t n;
+    f >> n;
+    std::vector<FlowRecord> flows(n);
+    for (uint64_t i = 0; i < n; i++)
+    {
+        uint64_t src;
+        uint64_t dst;
+        uint64_t pg;
+        uint64_t dport;
+        uint64_t size;
+        double start;
+        f >> src >> dst >> pg >> dport >> size >> start;
+        FlowRecord& r = flows[i];
+        r.start = std::llround(start * 1e9);
+        r.size = size;
+        r.src = src;
+        r.dst = dst;
+        r.id = i;
+        r.priority = pg;
+        r.cls = FLOW_RDMA;
+        r.flags = 0;
+    }
+    std::stable_sort(flows.begin(), flows.end(), [](const FlowRecord& a, const FlowRecord& b) {
+        return a.start < b.start;
+    });
+    FlowTraceWriter writer;
+    writer.Open(out);
+    for (const FlowRecord& r : flows)
+    {
+        writer.Write(r);
+    }
+    writer.Close();
+    std::cout << "converted " << n << " flows to " << out << std::endl;
+    return 0;
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string out = "flows.bin";
+    std::string cdfFile = "examples/Occamy/websearch.txt";
+    std::string dump;
+    std::string convert;
+    uint32_t leaves = 2;
+    uint32_t servers = 48;
+    double linkRate = 10; // Gbps
+    double oversub = 1;
+    double rdmaLoad = 0;
+    double tcpLoad = 0;
+    uint32_t rdmaPrio = 3;
+    uint32_t tcpPrio = 1;
+    double queryRate = 0;
+    uint64_t querySize = 0;
+    uint32_t queryClass = FLOW_TCP;
+    uint32_t fanIn = 0;
+    bool uniform = false;
+    double start = 1;
+    double end = 2;
+    uint64_t seed = 1;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("out", "output trace", out);
+    cmd.AddValue("dump", "print this trace as text and exit", dump);
+    cmd.AddValue("convert",
+                 "convert this text flow file (flow count, then src dst pg dport size start) "
+                 "to out and exit",
+                 convert);
+    cmd.AddValue("cdf", "flow size CDF file of the background flows", cdfFile);
+    cmd.AddValue("leaves", "number of leaves", leaves);
+    cmd.AddValue("servers", "servers per leaf", servers);
+    cmd.AddValue("linkRate", "server link rate in Gbps", linkRate);
+    cmd.AddValue("oversub", "leaf oversubscription ratio", oversub);
+    cmd.AddValue("rdmaLoad", "load of the RDMA background flows", rdmaLoad);
+    cmd.AddValue("tcpLoad", "load of the TCP background flows", tcpLoad);
+    cmd.AddValue("rdmaPrio", "priority group of the RDMA flows", rdmaPrio);
+    cmd.AddValue("tcpPrio", "priority of the TCP flows", tcpPrio);
+    cmd.AddValue("queryRate", "incast queries per second per server", queryRate);
+    cmd.AddValue("querySize", "bytes of a query, split among its senders", querySize);
+    cmd.AddValue("queryClass", "transport of the queries: 0 RDMA, 1 TCP", queryClass);
+    cmd.AddValue("fanIn", "senders of a query, 0 for servers", fanIn);
+    cmd.AddValue("uniform", "destinations on any other server instead of the next leaf", uniform);
+    cmd.AddValue("start", "first arrival after this time, s (START_TIME of the examples, earlier flows are not replayed)", start);
+    cmd.AddValue("end", "no arrival after this time, s (FLOW_LAUNCH_END_TIME of the examples)", end);
+    cmd.AddValue("seed", "random seed", seed);
+    cmd.Parse(argc, argv);
+
+    if (!dump.empty())
+    {
+        return Dump(dump);
+    }
+    if (!convert.empty())
+    {
+        return Convert(convert, out);
+    }
+
+    Cdf cdf;
+    if (rdmaLoad > 0 || tcpLoad > 0)
+    {
+        cdf.Load(cdfFile);
+    }
+    uint32_t nServers = leaves * servers;
+    fanIn = fanIn ? fanIn : servers;
+    if (queryRate > 0 && (leaves < 2 || fanIn > (uniform ? nServers - servers : servers)))
+    {
+        std::cout << "fanIn " << fanIn << " is larger than the number of possible senders" << std::endl;
+        return 1;
+    }
+
+    std::mt19937_64 gen(seed);
+    std::uniform_real_distribution<double> unif(0, 1);
+    auto exponential = [&](double rate) { return -std::log(1 - unif(gen)) / rate; };
+
+    // per server arrival rates, as in the examples
+    double bgRate = linkRate * 1e9 / oversub / 8;
+    std::priority_queue<Source, std::vector<Source>, Later> sources;
+    for (uint32_t s = 0; s < nServers; s++)
+    {
+        if (rdmaLoad > 0)
+        {
+            double rate = rdmaLoad * bgRate / cdf.Mean();
+            sources.push(Source{start + exponential(rate), rate, s, FLOW_RDMA, false});
+        }
+        if (tcpLoad > 0)
+        {
+            double rate = tcpLoad * bgRate / cdf.Mean();
+            sources.push(Source{start + exponential(rate), rate, s, FLOW_TCP, false});
+        }
+        if (queryRate > 0 && querySize > 0)
+        {
+            sources.push(Source{start + exponential(queryRate), queryRate, s, uint8_t(queryClass), true});
+        }
+    }
+
+    FlowTraceWriter writer;
+    writer.Open(out);
+    uint32_t id = 0;
+    uint64_t queries = 0;
+    std::vector<uint32_t> picked(nServers, UINT32_MAX);
+    while (!sources.empty() && sources.top().next < end)
+    {
+        Source src = sources.top();
+        sources.pop();
+        uint32_t leaf = src.server / servers;
+        uint32_t nextLeaf = (leaf + 1) % leaves;
+
+        FlowRecord r;
+        r.start = std::llround(src.next * 1e9);
+        r.cls = src.cls;
+        r.priority = src.cls == FLOW_RDMA ? rdmaPrio : tcpPrio;
+        r.id = id++;
+        if (!src.query)
+        {
+            r.src = src.server;
+            do
+            {
+                r.dst = uniform ? gen() % nServers : nextLeaf * servers + gen() % servers;
+            } while (r.dst == r.src);
+            double size = 0;
+            while (size < 1)
+            {
+                size = cdf.Sample(unif(gen));
+            }
+            r.size = size;
+            r.flags = 0;
+            writer.Write(r);
+        }
+        else
+        {
+            // fanIn senders answer the server: the first servers of the next leaf, or random servers of other leaves
+            r.dst = src.server;
+            r.size = querySize / fanIn;
+            r.flags = FLOW_INCAST;
+            for (uint32_t k = 0; k < fanIn; k++)
+            {
+                if (!uniform)
+                {
+                    r.src = nextLeaf * servers + k;
+                }
+                else
+                {
+                    do
+                    {
+                        r.src = gen() % nServers;
+                    } while (r.src / servers == leaf || picked[r.src] == r.id);
+                    picked[r.src] = r.id;
+                }
+                writer.Write(r);
+            }
+            queries++;
+        }
+        src.next += exponential(src.rate);
+        sources.push(src);
+    }
+    writer.Close();
+    std::cout << "wrote " << writer.GetNFlows() << " flows (" << queries << " queries) to " << out << std::endl;
+    return 0;
+}
@@ -155,6 +155,9 @@ macro(write_configtable)
   string(APPEND out "LibXml2 support               : ")
   check_on_or_off("ON" "${LIBXML2_FOUND}")
 
+  string(APPEND out "Memory accounting             : ")
+  check_on_or_off("${NS3_MEMORY_STATS}" "${NS3_MEMORY_STATS}")
+
   string(APPEND out "MPI Support                   : ")
   check_on_or_off("${NS3_MPI}" "${MPI_FOUND}")
 
@@ -627,6 +627,10 @@ macro(process_options)
     add_definitions(-DENABLE_DES_METRICS)
   endif()
 
+  if(${NS3_MEMORY_STATS})
+    add_definitions(-DENABLE_MEMORY_STATS)
+  endif()
+
   if(${NS3_SANITIZE} AND ${NS3_SANITIZE_MEMORY})
     message(
       FATAL_ERROR
@@ -22,6 +22,7 @@
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/traffic-control-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/tcp-switch-node.h"
 #include "ns3/gen-queue-disc.h"
 #include "ns3/red-queue-disc.h"
 #include "ns3/fq-pie-queue-disc.h"
@@ -395,6 +396,9 @@ main (int argc, char *argv[])
 	uint32_t rto = 10 * 1000; // in MicroSeconds, 5 milliseconds.
 	cmd.AddValue ("rto", "min Retransmission timeout value in MicroSeconds", rto);
 
+	bool switchFastPath = false;
+	cmd.AddValue ("switchFastPath", "forward on the leaves and spines with TcpSwitchNode instead of the host IP stack", switchFastPath);
+
 	/*Parse CMD*/
 	cmd.Parse (argc, argv);
 
@@ -520,9 +524,17 @@ main (int argc, char *argv[])
 
 
 	NodeContainer spines;
-	spines.Create (SPINE_COUNT);
 	NodeContainer leaves;
-	leaves.Create (LEAF_COUNT);
+	if (switchFastPath) {
+		for (uint32_t i = 0; i < SPINE_COUNT; i++)
+			spines.Add (CreateObject<TcpSwitchNode> ());
+		for (uint32_t i = 0; i < LEAF_COUNT; i++)
+			leaves.Add (CreateObject<TcpSwitchNode> ());
+	}
+	else {
+		spines.Create (SPINE_COUNT);
+		leaves.Create (LEAF_COUNT);
+	}
 	NodeContainer servers[LEAF_COUNT];
 	Ipv4InterfaceContainer serverIpv4[LEAF_COUNT];
 
@@ -22,11 +22,13 @@
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/traffic-control-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/tcp-switch-node.h"
 #include "ns3/gen-queue-disc.h"
 #include "ns3/red-queue-disc.h"
 #include "ns3/fq-pie-queue-disc.h"
 #include "ns3/fq-codel-queue-disc.h"
 #include "ns3/shared-memory.h"
+#include "ns3/buffer-replay.h"
 
 # define PACKET_SIZE 1400
 # define GIGA 1000000000
@@ -405,6 +407,12 @@ main (int argc, char *argv[])
 	uint32_t torPrintall = 0;
 	cmd.AddValue ("torPrintall", "torPrintall", torPrintall);
 
+	bool switchFastPath = false;
+	cmd.AddValue ("switchFastPath", "forward on the leaves and spines with TcpSwitchNode instead of the host IP stack", switchFastPath);
+
+	std::string bufferTraceFile = "";
+	cmd.AddValue ("bufferTraceFile", "File path for the arrivals at the first leaf, to replay with buffer-replay", bufferTraceFile);
+
 	/*Parse CMD*/
 	cmd.Parse (argc, argv);
 
@@ -667,9 +675,17 @@ main (int argc, char *argv[])
 	}
 
 	NodeContainer spines;
-	spines.Create (SPINE_COUNT);
 	NodeContainer leaves;
-	leaves.Create (LEAF_COUNT);
+	if (switchFastPath) {
+		for (uint32_t i = 0; i < SPINE_COUNT; i++)
+			spines.Add (CreateObject<TcpSwitchNode> ());
+		for (uint32_t i = 0; i < LEAF_COUNT; i++)
+			leaves.Add (CreateObject<TcpSwitchNode> ());
+	}
+	else {
+		spines.Create (SPINE_COUNT);
+		leaves.Create (LEAF_COUNT);
+	}
 	NodeContainer servers[LEAF_COUNT];
 	Ipv4InterfaceContainer serverIpv4[LEAF_COUNT];
 
@@ -941,6 +957,12 @@ main (int argc, char *argv[])
 	Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 	// NS_LOG_UNCOND("Running the Simulation...!");
 	std::cout << "Running the Simulation...!" << std::endl;
+	if (!bufferTraceFile.empty()) {
+		Ptr<OutputStreamWrapper> bufferTrace = asciiTraceHelper.CreateFileStream (bufferTraceFile);
+		for (uint32_t i = 0; i < ToRQueueDiscs[0].GetN(); i++) {
+			BufferReplay::Record(DynamicCast<GenQueueDisc> (ToRQueueDiscs[0].Get(i)), bufferTrace);
+		}
+	}
 	Simulator::Stop (Seconds (END_TIME));
 	Simulator::Run ();
 	Simulator::Destroy ();
@@ -0,0 +1,150 @@
+/*
+ Replays the arrivals recorded at a leaf of abm-evaluation (--bufferTraceFile) through several
+ buffer management algorithms in one run, and prints the drops and the buffer occupancy of each.
+ Sample usage: ./ns3 run 'buffer-replay --traceFile=leaf0.tr --algorithms=DT,ABM,IB --BufferSize=5600000'
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "ns3/core-module.h"
+#include "ns3/traffic-control-module.h"
+#include "ns3/buffer-replay.h"
+#include "ns3/gen-queue-disc.h"
+
+# define PACKET_SIZE 1400
+
+/*Buffer Management Algorithms*/
+# define DT 101
+# define FAB 102
+# define CS 103
+# define IB 104
+# define ABM 110
+# define LQD 111
+# define CREDENCE 666
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("BUFFER_REPLAY");
+
+double alpha_values[8] = {1};
+uint32_t nPrior = 2;
+double RTTBytes = 0;
+uint32_t RTTPackets = 0;
+
+void Configure(uint32_t algorithm, Ptr<GenQueueDisc> genDisc) {
+	for (uint32_t n = 0; n < nPrior; n++) {
+		genDisc->alphas[n] = alpha_values[n];
+	}
+	switch (algorithm) {
+	case FAB:
+		genDisc->SetFabWindow(MicroSeconds(5000));
+		genDisc->SetFabThreshold(15 * PACKET_SIZE);
+		break;
+	case IB:
+		genDisc->SetAfdWindow(MicroSeconds(50));
+		genDisc->SetDppWindow(MicroSeconds(5000));
+		genDisc->SetDppThreshold(RTTPackets);
+		for (uint32_t n = 0; n < nPrior; n++) {
+			genDisc->SetQrefAfd(n, uint32_t(RTTBytes));
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	CommandLine cmd;
+
+	std::string traceFile = "./buffer-trace.txt";
+	cmd.AddValue ("traceFile", "Arrivals recorded with abm-evaluation --bufferTraceFile", traceFile);
+
+	std::string algorithms = "DT,FAB,CS,IB,ABM";
+	cmd.AddValue ("algorithms", "Comma separated buffer management algorithms: DT, FAB, CS, IB, ABM, LQD, CREDENCE", algorithms);
+
+	uint32_t BufferSize = 1000 * 1000;
+	cmd.AddValue ("BufferSize", "BufferSize in Bytes", BufferSize);
+
+	cmd.AddValue ("nPrior", "number of priorities", nPrior);
+
+	std::string alphasFile = "examples/ABM/alphas";
+	cmd.AddValue ("alphasFile", "alpha values file (should be exactly nPrior lines)", alphasFile);
+
+	double linkLatency = 10;
+	cmd.AddValue ("linkLatency", "linkLatency in microseconds, for the IB and ABM parameters", linkLatency);
+
+	double alphaUpdateInterval = 1;
+	cmd.AddValue("alphaUpdateInterval", "(Number of Rtts) update interval for alpha values in ABM", alphaUpdateInterval);
+
+	std::string outFile = "";
+	cmd.AddValue ("outFile", "File path for the statistics, stdout if empty", outFile);
+
+	cmd.Parse (argc, argv);
+
+	/*Reading alpha values from file*/
+	std::string line;
+	std::fstream aFile;
+	aFile.open(alphasFile);
+	uint32_t p = 0;
+	while ( getline( aFile, line ) && p < 8 ) { // hard coded to read only 8 alpha values.
+		std::istringstream iss( line );
+		double a;
+		iss >> a;
+		alpha_values[p] = a;
+		p++;
+	}
+	aFile.close();
+
+	BufferReplay replay;
+	replay.SetBufferSize(BufferSize);
+	replay.SetNPrior(nPrior);
+
+	std::ifstream trace(traceFile);
+	NS_ABORT_MSG_IF (!trace.is_open(), "Cannot open " << traceFile);
+	replay.Load(trace);
+
+	// IB and ABM take their RTT from the port rate, that of the first port with arrivals
+	double portBw = 0;
+	for (double rate : replay.GetRates()) {
+		if (rate > 0) {
+			portBw = rate;
+			break;
+		}
+	}
+	RTTBytes = (portBw * 1e9 * 1e-6) * linkLatency;
+	RTTPackets = RTTBytes / PACKET_SIZE + 1;
+	Config::SetDefault("ns3::GenQueueDisc::updateInterval", UintegerValue(alphaUpdateInterval * linkLatency * 8 * 1000));
+
+	std::istringstream names(algorithms);
+	std::string name;
+	while (getline(names, name, ',')) {
+		uint32_t algorithm;
+		if (name == "DT") algorithm = DT;
+		else if (name == "FAB") algorithm = FAB;
+		else if (name == "CS") algorithm = CS;
+		else if (name == "IB") algorithm = IB;
+		else if (name == "ABM") algorithm = ABM;
+		else if (name == "LQD") algorithm = LQD;
+		else if (name == "CREDENCE") algorithm = CREDENCE;
+		else {
+			std::cout << "Unknown buffer management algorithm " << name << ". Exiting!" << std::endl;
+			return 0;
+		}
+		replay.AddPolicy(name, algorithm, MakeBoundCallback(&Configure, algorithm));
+	}
+
+	replay.Run();
+	Simulator::Destroy ();
+
+	if (outFile.empty()) {
+		replay.Print(std::cout);
+	}
+	else {
+		std::ofstream out(outFile);
+		replay.Print(out);
+	}
+	return 0;
+}
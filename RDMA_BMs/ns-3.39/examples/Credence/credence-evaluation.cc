@@ -25,6 +25,7 @@
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/traffic-control-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/tcp-switch-node.h"
 #include "ns3/gen-queue-disc.h"
 #include "ns3/red-queue-disc.h"
 #include "ns3/fq-pie-queue-disc.h"
@@ -479,6 +480,9 @@ main (int argc, char *argv[])
 	enableStats = 0;
 	cmd.AddValue("enableStats", "enable stats output from tors, fcts",enableStats);
 
+	bool switchFastPath = false;
+	cmd.AddValue ("switchFastPath", "forward on the leaves and spines with TcpSwitchNode instead of the host IP stack", switchFastPath);
+
 	/*Parse CMD*/
 	cmd.Parse (argc, argv);
 
@@ -761,9 +765,17 @@ main (int argc, char *argv[])
 	}
 
 	NodeContainer spines;
-	spines.Create (SPINE_COUNT);
 	NodeContainer leaves;
-	leaves.Create (LEAF_COUNT);
+	if (switchFastPath) {
+		for (uint32_t i = 0; i < SPINE_COUNT; i++)
+			spines.Add (CreateObject<TcpSwitchNode> ());
+		for (uint32_t i = 0; i < LEAF_COUNT; i++)
+			leaves.Add (CreateObject<TcpSwitchNode> ());
+	}
+	else {
+		spines.Create (SPINE_COUNT);
+		leaves.Create (LEAF_COUNT);
+	}
 	NodeContainer servers[LEAF_COUNT];
 	Ipv4InterfaceContainer serverIpv4[LEAF_COUNT];
 
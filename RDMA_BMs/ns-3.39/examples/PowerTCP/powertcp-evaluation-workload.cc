@@ -64,6 +64,7 @@ extern "C"
 uint32_t cc_mode = 1;
 bool enable_qcn = true;
 uint32_t packet_payload_size = 1000, l2_chunk_size = 0, l2_ack_interval = 0;
+uint32_t ack_coalesce_interval = 0, ack_coalesce_bytes = 0, min_cnp_interval = 0; // ns, bytes, ns
 double pause_time = 5, simulator_stop_time = 3.01;
 std::string data_rate, link_delay, topology_file, flow_file, trace_file, trace_output_file;
 std::string fct_output_file = "fct.txt";
@@ -681,6 +682,27 @@ int main(int argc, char *argv[])
 			l2_ack_interval = v;
 			std::cout << "L2_ACK_INTERVAL\t\t\t" << l2_ack_interval << "\n";
 		}
+		else if (key.compare("ACK_COALESCE_INTERVAL") == 0)
+		{
+			uint32_t v;
+			conf >> v;
+			ack_coalesce_interval = v;
+			std::cout << "ACK_COALESCE_INTERVAL\t\t" << ack_coalesce_interval << "\n";
+		}
+		else if (key.compare("ACK_COALESCE_BYTES") == 0)
+		{
+			uint32_t v;
+			conf >> v;
+			ack_coalesce_bytes = v;
+			std::cout << "ACK_COALESCE_BYTES\t\t" << ack_coalesce_bytes << "\n";
+		}
+		else if (key.compare("MIN_CNP_INTERVAL") == 0)
+		{
+			uint32_t v;
+			conf >> v;
+			min_cnp_interval = v;
+			std::cout << "MIN_CNP_INTERVAL\t\t" << min_cnp_interval << "\n";
+		}
 		else if (key.compare("L2_BACK_TO_ZERO") == 0)
 		{
 			uint32_t v;
@@ -1162,6 +1184,9 @@ int main(int argc, char *argv[])
 			rdmaHw->SetAttribute("L2BackToZero", BooleanValue(l2_back_to_zero));
 			rdmaHw->SetAttribute("L2ChunkSize", UintegerValue(l2_chunk_size));
 			rdmaHw->SetAttribute("L2AckInterval", UintegerValue(l2_ack_interval));
+			rdmaHw->SetAttribute("AckCoalesceInterval", TimeValue(NanoSeconds(ack_coalesce_interval)));
+			rdmaHw->SetAttribute("AckCoalesceBytes", UintegerValue(ack_coalesce_bytes));
+			rdmaHw->SetAttribute("MinCnpInterval", TimeValue(NanoSeconds(min_cnp_interval)));
 			rdmaHw->SetAttribute("CcMode", UintegerValue(cc_mode));
 			rdmaHw->SetAttribute("RateDecreaseInterval", DoubleValue(rate_decrease_interval));
 			rdmaHw->SetAttribute("MinRate", DataRateValue(DataRate(min_rate)));
@@ -1336,6 +1361,15 @@ int main(int argc, char *argv[])
 	NS_LOG_INFO("Run Simulation.");
 	Simulator::Stop(Seconds(END_TIME));
 	Simulator::Run();
+#if ENABLE_QP
+	// reverse path feedback of all the receivers
+	RdmaHw::FeedbackStats feedback;
+	for (uint32_t i = 0; i < node_num; i++) {
+		if (n.Get(i)->GetNodeType() == 0)
+			feedback.Add(n.Get(i)->GetObject<RdmaDriver>()->m_rdma->m_feedbackStats);
+	}
+	feedback.Print(std::cout);
+#endif
 	Simulator::Destroy();
 	NS_LOG_INFO("Done.");
 
@@ -10,6 +10,7 @@
 #include <time.h>
 #include "ns3/core-module.h"
 #include "ns3/qbb-helper.h"
+#include "ns3/dc-topology-helper.h"
 #include "ns3/point-to-point-helper.h"
 #include "ns3/applications-module.h"
 #include "ns3/internet-module.h"
@@ -22,6 +23,11 @@
 #include <ns3/rdma-client-helper.h>
 #include <ns3/rdma-driver.h>
 #include <ns3/switch-node.h>
+#include <ns3/fluid-background.h>
+#include <ns3/collective-job.h>
+#include <ns3/flow-trace.h>
+#include <ns3/fct-summary.h>
+#include <ns3/simulation-snapshot.h>
 #include <ns3/sim-setting.h>
 
 #include <cmath>
@@ -31,6 +37,7 @@
 #include <map>
 #include <ctime>
 #include <set>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <stdlib.h>
@@ -71,6 +78,8 @@ std::string topology_file, flow_file;
 
 Ptr<OutputStreamWrapper> fctOutput;
 AsciiTraceHelper asciiTraceHelper;
+// online FCT/QCT percentiles, NULL unless fctSummaryFile is set
+FctSummary *fctSummary = NULL;
 
 Ptr<OutputStreamWrapper> torStats;
 AsciiTraceHelper torTraceHelper;
@@ -118,16 +127,8 @@ uint32_t PORT_START[512] = {4444};
 std::ifstream topof, flowf, tracef;
 
 NodeContainer n;
-NetDeviceContainer switchToSwitchInterfaces;
-std::map< uint32_t, std::map< uint32_t, std::vector<Ptr<QbbNetDevice>> > > switchToSwitch;
-
-// vamsi
-std::map<uint32_t, uint32_t> switchNumToId;
-std::map<uint32_t, uint32_t> switchIdToNum;
-std::map<uint32_t, NetDeviceContainer> switchUp;
-std::map<uint32_t, NetDeviceContainer> switchDown;
-//NetDeviceContainer switchUp[switch_num];
-std::map<uint32_t, NetDeviceContainer> sourceNodes;
+// the network, from TOPOLOGY_FILE or the topology option, with its routes and pair delays
+DcTopologyHelper topo;
 
 NodeContainer servers;
 NodeContainer tors;
@@ -136,20 +137,6 @@ uint64_t nic_rate;
 
 uint64_t maxRtt, maxBdp;
 
-struct Interface {
-    uint32_t idx;
-    bool up;
-    uint64_t delay;
-    uint64_t bw;
-
-    Interface() : idx(0), up(false) {}
-};
-map<Ptr<Node>, map<Ptr<Node>, Interface> > nbr2if;
-// Mapping destination to next hop for each node: <node, <dest, <nexthop0, ...> > >
-map<Ptr<Node>, map<Ptr<Node>, vector<Ptr<Node> > > > nextHop;
-map<Ptr<Node>, map<Ptr<Node>, uint64_t> > pairDelay;
-map<Ptr<Node>, map<Ptr<Node>, uint64_t> > pairTxDelay;
-map<uint32_t, map<uint32_t, uint64_t> > pairBw;
 map<Ptr<Node>, map<Ptr<Node>, uint64_t> > pairBdp;
 map<uint32_t, map<uint32_t, uint64_t> > pairRtt;
 
@@ -194,22 +181,20 @@ void ScheduleFlowInputs() {
     }
 }
 
-Ipv4Address node_id_to_ip(uint32_t id) {
-    return Ipv4Address(0x0b000001 + ((id / 256) * 0x00010000) + ((id % 256) * 0x00000100));
-}
-
-uint32_t ip_to_node_id(Ipv4Address ip) {
-    return (ip.Get() >> 8) & 0xffff;
-}
-
-
-void TraceMsgFinish (Ptr<OutputStreamWrapper> stream, double size, double start, bool incast, uint32_t prior )
+void TraceMsgFinish (Ptr<OutputStreamWrapper> stream, uint32_t dst, double size, double start, bool incast, uint32_t prior )
 {
     double fct, standalone_fct, slowdown;
     fct = Simulator::Now().GetNanoSeconds() - start;
     standalone_fct = maxRtt + (1e9*size * 8.0) / nic_rate;
     slowdown = fct / standalone_fct;
 
+    if (fctSummary != NULL) {
+        fctSummary->AddFlow(FLOW_TCP, size, fct, standalone_fct, incast);
+        if (incast)
+            fctSummary->QueryFlowDone(FctSummary::QueryKey(dst, start), start, size, maxRtt, nic_rate, Simulator::Now().GetNanoSeconds());
+    }
+    if (!stream)
+        return;
     *stream->GetStream ()
             << Simulator::Now().GetSeconds()
             << " " << size
@@ -223,13 +208,21 @@ void TraceMsgFinish (Ptr<OutputStreamWrapper> stream, double size, double start,
 }
 
 void qp_finish(Ptr<OutputStreamWrapper> fout, Ptr<RdmaQueuePair> q) {
-    uint32_t sid = ip_to_node_id(q->sip), did = ip_to_node_id(q->dip);
-    uint64_t base_rtt = pairRtt[sid][did], b = pairBw[sid][did];
+    uint32_t sid = DcTopologyHelper::GetHostNode(q->sip), did = DcTopologyHelper::GetHostNode(q->dip);
+    uint64_t base_rtt = pairRtt[sid][did], b = topo.GetPairBw(sid, did);
     uint32_t total_bytes = q->m_size + ((q->m_size - 1) / packet_payload_size + 1) * (CustomHeader::GetStaticWholeHeaderSize() - IntHeader::GetStaticSize()); // translate to the minimum bytes required (with header but no INT)
     uint64_t standalone_fct = base_rtt + total_bytes * 8 * 1e9 / b;
     uint64_t fct = (Simulator::Now() - q->startTime).GetNanoSeconds();
     double slowdown = double(fct)/standalone_fct;
-    *fout->GetStream () 
+    if (fctSummary != NULL) {
+        fctSummary->AddFlow(FLOW_RDMA, q->m_size, fct, standalone_fct, q->incastFlow);
+        if (q->incastFlow) {
+            uint64_t start = q->startTime.GetNanoSeconds();
+            fctSummary->QueryFlowDone(FctSummary::QueryKey(did, start), start, total_bytes, base_rtt, b, Simulator::Now().GetNanoSeconds());
+        }
+    }
+    if (fout)
+        *fout->GetStream () 
             << Simulator::Now().GetSeconds()
             << " " << q->m_size
             << " " << fct 
@@ -258,84 +251,27 @@ void get_pfc(Ptr<OutputStreamWrapper> fout, Ptr<QbbNetDevice> dev, uint32_t type
     // fprintf(fout, "%lu %u %u %u %u\n", Simulator::Now().GetTimeStep(), dev->GetNode()->GetId(), dev->GetNode()->GetNodeType(), dev->GetIfIndex(), type);
 }
 
-void CalculateRoute(Ptr<Node> host) {
-    // queue for the BFS.
-    vector<Ptr<Node> > q;
-    // Distance from the host to each node.
-    map<Ptr<Node>, int> dis;
-    map<Ptr<Node>, uint64_t> delay;
-    map<Ptr<Node>, uint64_t> txDelay;
-    map<Ptr<Node>, uint64_t> bw;
-    // init BFS.
-    q.push_back(host);
-    dis[host] = 0;
-    delay[host] = 0;
-    txDelay[host] = 0;
-    bw[host] = 0xfffffffffffffffflu;
-    // BFS.
-    for (int i = 0; i < (int)q.size(); i++) {
-        Ptr<Node> now = q[i];
-        int d = dis[now];
-        for (auto it = nbr2if[now].begin(); it != nbr2if[now].end(); it++) {
-            // skip down link
-            if (!it->second.up)
-                continue;
-            Ptr<Node> next = it->first;
-            // If 'next' have not been visited.
-            if (dis.find(next) == dis.end()) {
-                dis[next] = d + 1;
-                delay[next] = delay[now] + it->second.delay;
-                txDelay[next] = txDelay[now] + packet_payload_size * 1000000000lu * 8 / it->second.bw;
-                bw[next] = std::min(bw[now], it->second.bw);
-                // we only enqueue switch, because we do not want packets to go through host as middle point
-                if (next->GetNodeType() == 1)
-                    q.push_back(next);
-            }
-            // if 'now' is on the shortest path from 'next' to 'host'.
-            if (d + 1 == dis[next]) {
-                nextHop[next][host].push_back(now);
-            }
-        }
-    }
-    for (auto it : delay)
-        pairDelay[it.first][host] = it.second;
-    for (auto it : txDelay)
-        pairTxDelay[it.first][host] = it.second;
-    for (auto it : bw)
-        pairBw[it.first->GetId()][host->GetId()] = it.second;
-}
+// Hybrid mode: when set, the background workload is simulated as fluid flows (see FluidBackground).
+Ptr<FluidBackground> fluidBg;
 
-void CalculateRoutes(NodeContainer &n) {
-    for (int i = 0; i < (int)n.GetN(); i++) {
-        Ptr<Node> node = n.Get(i);
-        if (node->GetNodeType() == 0)
-            CalculateRoute(node);
-    }
+// Optional ML training job (see CollectiveJob), run on top of the background workload.
+Ptr<CollectiveJob> collectiveJob;
+
+void TraceJobComplete(std::string collective, uint32_t job, Time start, Time jct) {
+    std::cout << "collective " << collective << " job " << job << " start " << start.GetSeconds() << " jctus " << jct.GetMicroSeconds() << std::endl;
 }
 
-void SetRoutingEntries() {
-    // For each node.
-    for (auto i = nextHop.begin(); i != nextHop.end(); i++) {
-        Ptr<Node> node = i->first;
-        auto &table = i->second;
-        for (auto j = table.begin(); j != table.end(); j++) {
-            // The destination node.
-            Ptr<Node> dst = j->first;
-            // The IP address of the dst.
-            Ipv4Address dstAddr = dst->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal();
-            // The next hops towards the dst.
-            vector<Ptr<Node> > nexts = j->second;
-            for (int k = 0; k < (int)nexts.size(); k++) {
-                Ptr<Node> next = nexts[k];
-                uint32_t interface = nbr2if[node][next].idx;
-                if (node->GetNodeType() == 1)
-                    DynamicCast<SwitchNode>(node)->AddTableEntry(dstAddr, interface);
-                else {
-                    node->GetObject<RdmaDriver>()->m_rdma->AddTableEntry(dstAddr, interface);
-                }
-            }
-        }
+// Egress devices from src to dst, following the routing tables. hash picks among the ECMP next hops.
+std::vector<Ptr<QbbNetDevice> > fluid_path(Ptr<Node> src, Ptr<Node> dst, uint32_t hash) {
+    std::vector<Ptr<QbbNetDevice> > path;
+    uint32_t now = src->GetId();
+    while (now != dst->GetId()) {
+        vector<uint32_t> nexts = topo.GetNextHops(now, dst->GetId());
+        const DcTopologyHelper::Port &port = topo.GetPorts(now)[nexts[hash % nexts.size()]];
+        path.push_back(port.dev);
+        now = port.peer;
     }
+    return path;
 }
 
 uint64_t get_nic_rate(NodeContainer &n) {
@@ -417,6 +353,9 @@ void incast_rdma (int fromLeafId, double requestRate, uint32_t requestSize, stru
                 query += flowSize;
                 flowCount++;
 
+                if (fctSummary != NULL)
+                    fctSummary->ExpectQueryFlow(FctSummary::QueryKey(destServerIndex, Seconds(startTime).GetNanoSeconds()));
+
                 RdmaClientHelper clientHelper(3, serverAddress[fromServerIndex], serverAddress[destServerIndex], sport, dport, flowSize, has_win ? (global_t == 1 ? maxBdp : pairBdp[n.Get(fromServerIndex)][n.Get(destServerIndex)]) : 0, global_t == 1 ? maxRtt : pairRtt[fromServerIndex][destServerIndex], Simulator::GetMaximumSimulationTime()-MicroSeconds(1));
                 ApplicationContainer appCon = clientHelper.Install(n.Get(fromServerIndex));
                 // std::cout << " from " << fromServerIndex << " to " << destServerIndex <<  " fromLeadId " << fromLeafId << " serverCount " << SERVER_COUNT << " leafCount " << LEAF_COUNT <<  std::endl;
@@ -469,6 +408,11 @@ void workload_rdma (int fromLeafId, double requestRate, struct cdf_table *cdfTab
 
             flowCount += 1;
 
+            if (fluidBg != NULL) {
+                fluidBg->AddFlow(fluid_path(n.Get(fromServerIndex), n.Get(destServerIndex), sport), 3, LOSSLESS, flowSize, Seconds(startTime));
+                startTime += poission_gen_interval (requestRate);
+                continue;
+            }
 
             RdmaClientHelper clientHelper(3, serverAddress[fromServerIndex], serverAddress[destServerIndex], sport, dport, flowSize, has_win ? (global_t == 1 ? maxBdp : pairBdp[n.Get(fromServerIndex)][n.Get(destServerIndex)]) : 0, global_t == 1 ? maxRtt : pairRtt[fromServerIndex][destServerIndex], Simulator::GetMaximumSimulationTime());
             ApplicationContainer appCon = clientHelper.Install(n.Get(fromServerIndex));
@@ -540,7 +484,9 @@ void incast_tcp (int incastLeaf, double requestRate, uint32_t requestSize, struc
                 flowCount += 1;
                 sinkApp.Start (startApp);
                 sinkApp.Stop (Seconds (END_TIME));
-                sinkApp.Get(0)->TraceConnectWithoutContext("FlowFinish", MakeBoundCallback(&TraceMsgFinish, fctOutput));
+                sinkApp.Get(0)->TraceConnectWithoutContext("FlowFinish", MakeBoundCallback(&TraceMsgFinish, fctOutput, uint32_t(incastLeaf*SERVER_COUNT + incastServer)));
+                if (fctSummary != NULL)
+                    fctSummary->ExpectQueryFlow(FctSummary::QueryKey(incastLeaf*SERVER_COUNT + incastServer, Seconds(startTime).GetNanoSeconds()));
             }
             startTime += poission_gen_interval (requestRate);
         }
@@ -577,6 +523,13 @@ void workload_tcp (int txLeaf, double requestRate, struct cdf_table *cdfTable,
                 flowSize = gen_random_cdf (cdfTable);
             }
 
+            if (fluidBg != NULL) {
+                fluidBg->AddFlow(fluid_path(n.Get(txLeaf*SERVER_COUNT + txServer), n.Get(rxLeaf*SERVER_COUNT + rxServer), port), prior, LOSSY, flowSize, Seconds(startTime));
+                flowCount += 2;
+                startTime += poission_gen_interval (requestRate);
+                continue;
+            }
+
             Ptr<Node> rxNode = n.Get (rxLeaf*SERVER_COUNT + rxServer);
             Ptr<Ipv4> ipv4 = rxNode->GetObject<Ipv4> ();
             Ipv4InterfaceAddress rxInterface = ipv4->GetAddress (1, 0);
@@ -607,13 +560,123 @@ void workload_tcp (int txLeaf, double requestRate, struct cdf_table *cdfTable,
             flowCount += 1;
             sinkApp.Start (Seconds(startTime));
             sinkApp.Stop (Seconds (END_TIME));
-            sinkApp.Get(0)->TraceConnectWithoutContext("FlowFinish", MakeBoundCallback(&TraceMsgFinish, fctOutput));
+            sinkApp.Get(0)->TraceConnectWithoutContext("FlowFinish", MakeBoundCallback(&TraceMsgFinish, fctOutput, uint32_t(rxLeaf*SERVER_COUNT + rxServer)));
             startTime += poission_gen_interval (requestRate);
         }
     }
 }
 
 
+// Trace replay: the flows are read from a binary flow trace (see utils/flow-trace-gen.cc) and each one is
+// installed when it starts, instead of installing the whole generated workload before the simulation.
+Ptr<FlowTraceReplay> flowReplay;
+uint32_t replayServers = 0;
+double replayEndTime = 0;
+long replayFlowCount = 1;
+
+void replay_rdma(const FlowRecord &f) {
+    if (DestportNumder[f.src][f.dst] == UINT16_MAX - 1)
+        DestportNumder[f.src][f.dst] = rand_range(10000, 11000);
+    if (portNumder[f.src][f.dst] == UINT16_MAX - 1)
+        portNumder[f.src][f.dst] = rand_range(10000, 11000);
+    uint16_t dport = DestportNumder[f.src][f.dst]++;
+    uint16_t sport = portNumder[f.src][f.dst]++;
+    replayFlowCount++;
+
+    if (fluidBg != NULL && !(f.flags & FLOW_INCAST)) {
+        fluidBg->AddFlow(fluid_path(n.Get(f.src), n.Get(f.dst), sport), f.priority, LOSSLESS, f.size, Simulator::Now());
+        return;
+    }
+
+    // the RDMA hw marks the qps stopping just before the end of the simulation as incast
+    Time stopTime = Simulator::GetMaximumSimulationTime();
+    if (f.flags & FLOW_INCAST) {
+        stopTime -= MicroSeconds(1);
+        if (fctSummary != NULL)
+            fctSummary->ExpectQueryFlow(FctSummary::QueryKey(f.dst, Simulator::Now().GetNanoSeconds()));
+    }
+    RdmaClientHelper clientHelper(f.priority, serverAddress[f.src], serverAddress[f.dst], sport, dport, f.size, has_win ? (global_t == 1 ? maxBdp : pairBdp[n.Get(f.src)][n.Get(f.dst)]) : 0, global_t == 1 ? maxRtt : pairRtt[f.src][f.dst], stopTime);
+    ApplicationContainer appCon = clientHelper.Install(n.Get(f.src));
+    appCon.Start(Seconds(0));
+}
+
+void replay_tcp(const FlowRecord &f) {
+    bool incast = f.flags & FLOW_INCAST;
+    uint16_t port = PORT_START[f.dst]++;
+    if (port >= UINT16_MAX - 1) {
+        port = 4444;
+        PORT_START[f.dst] = 4444;
+    }
+
+    if (fluidBg != NULL && !incast) {
+        fluidBg->AddFlow(fluid_path(n.Get(f.src), n.Get(f.dst), port), f.priority, LOSSY, f.size, Simulator::Now());
+        replayFlowCount += 2;
+        return;
+    }
+
+    Ipv4Address rxAddress = n.Get(f.dst)->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal();
+    Ptr<BulkSendApplication> bulksend = CreateObject<BulkSendApplication>();
+    bulksend->SetAttribute("Protocol", TypeIdValue(TcpSocketFactory::GetTypeId()));
+    bulksend->SetAttribute("SendSize", UintegerValue(f.size));
+    bulksend->SetAttribute("MaxBytes", UintegerValue(f.size));
+    bulksend->SetAttribute("FlowId", UintegerValue(replayFlowCount++));
+    bulksend->SetAttribute("priorityCustom", UintegerValue(f.priority));
+    bulksend->SetAttribute("Remote", AddressValue(InetSocketAddress(rxAddress, port)));
+    bulksend->SetAttribute("InitialCwnd", UintegerValue((incast ? f.size : maxBdp) / packet_payload_size + 1));
+    bulksend->SetAttribute("priority", UintegerValue(f.priority));
+    if (incast)
+        bulksend->SetAttribute("sendAt", TimeValue(Simulator::Now()));
+    bulksend->SetStartTime(Seconds(0));
+    bulksend->SetStopTime(Seconds(replayEndTime) - Simulator::Now());
+    n.Get(f.src)->AddApplication(bulksend);
+
+    PacketSinkHelper sink("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), port));
+    ApplicationContainer sinkApp = sink.Install(n.Get(f.dst));
+    sinkApp.Get(0)->SetAttribute("TotalQueryBytes", UintegerValue(f.size));
+    if (incast)
+        sinkApp.Get(0)->SetAttribute("recvAt", TimeValue(Simulator::Now()));
+    sinkApp.Get(0)->SetAttribute("priority", UintegerValue(incast ? 1 : 0)); // ack packets are prioritized
+    sinkApp.Get(0)->SetAttribute("priorityCustom", UintegerValue(incast ? 1 : 0));
+    sinkApp.Get(0)->SetAttribute("senderPriority", UintegerValue(f.priority));
+    sinkApp.Get(0)->SetAttribute("flowId", UintegerValue(replayFlowCount++));
+    sinkApp.Start(Seconds(0));
+    sinkApp.Stop(Seconds(replayEndTime) - Simulator::Now());
+    sinkApp.Get(0)->TraceConnectWithoutContext("FlowFinish", MakeBoundCallback(&TraceMsgFinish, fctOutput, f.dst));
+    if (incast && fctSummary != NULL)
+        fctSummary->ExpectQueryFlow(FctSummary::QueryKey(f.dst, Simulator::Now().GetNanoSeconds()));
+}
+
+void replay_flow(const FlowRecord &f) {
+    if (f.src >= replayServers || f.dst >= replayServers || f.src == f.dst) {
+        std::cout << "Flow " << f.id << " of the trace goes from server " << f.src << " to " << f.dst << ", there are " << replayServers << " servers" << std::endl;
+        exit(1);
+    }
+    if (f.cls == FLOW_RDMA)
+        replay_rdma(f);
+    else
+        replay_tcp(f);
+}
+
+
+// Warm-start snapshot: called in every branch once forked. A flowTrace override replays the flows of
+// the trace from now on, on top of the workload of the warm-up.
+Ptr<SimulationSnapshot> snapshot;
+std::vector<Ptr<FlowTraceReplay> > branchReplays;
+
+void snapshot_branch(const std::string &name, const SimulationSnapshot::Overrides &overrides) {
+    for (auto &o : overrides) {
+        if (o.first != "flowTrace") {
+            std::cout << "Unknown override " << o.first << " of branch " << name << std::endl;
+            exit(1);
+        }
+        Ptr<FlowTraceReplay> replay = CreateObject<FlowTraceReplay>();
+        replay->Open(o.second);
+        replay->SetFlowCallback(MakeCallback(&replay_flow));
+        replay->Start();
+        branchReplays.push_back(replay);
+    }
+}
+
 uint32_t flowEnd = 0;
 
 void printBuffer(Ptr<OutputStreamWrapper> fout, NodeContainer switches, double delay) {
@@ -729,6 +792,18 @@ int main(int argc, char *argv[])
     double gamma = 0.99;
     cmd.AddValue("gamma","gamma parameter value for Reverie", gamma);
 
+    uint32_t aqmAlg = SwitchAqm::AQM_RED;
+    cmd.AddValue("aqm", "ECN marking algorithm at the switch egress: 0 RED, 1 PI2, 2 sojourn time, 3 phantom queue", aqmAlg);
+
+    bool aqmEnqueue = false;
+    cmd.AddValue("aqmEnqueue", "mark at enqueue instead of dequeue", aqmEnqueue);
+
+    bool irn = false;
+    cmd.AddValue("irn", "IRN selective retransmission for all RDMA qps instead of go-back-N", irn);
+
+    uint32_t irnPgMask = 0;
+    cmd.AddValue("irnPgMask", "IRN selective retransmission for the RDMA qps of these priority groups (bitmask)", irnPgMask);
+
     std::string alphasFile = "/home/vamsi/src/phd/codebase/ns3-datacenter/simulator/ns-3.35/examples/Reverie/alphas"; // On lakewood
     cmd.AddValue ("alphasFile", "alpha values file (should be exactly nPrior lines)", alphasFile);
 
@@ -737,21 +812,87 @@ int main(int argc, char *argv[])
     std::string fctOutFile = "./fcts.txt";
     cmd.AddValue ("fctOutFile", "File path for FCTs", fctOutFile);
 
+    bool fctPerFlow = true;
+    cmd.AddValue ("fctPerFlow", "Write one line per completed flow to fctOutFile", fctPerFlow);
+
+    std::string fctSummaryFile = "";
+    cmd.AddValue ("fctSummaryFile", "File path for slowdown percentiles per flow size and QCT percentiles, aggregated during the run and written once at the end (disabled if empty)", fctSummaryFile);
+
+    std::string fctSizeBuckets = "";
+    cmd.AddValue ("fctSizeBuckets", "Comma separated upper bounds in bytes of the flow size buckets of fctSummaryFile (default 10KB,100KB,1MB,10MB)", fctSizeBuckets);
+
     std::string torOutFile = "./tor.txt";
     cmd.AddValue ("torOutFile", "File path for ToR statistic", torOutFile);
 
     std::string pfcOutFile = "./pfc.txt";
     cmd.AddValue ("pfcOutFile", "File path for pfc events", pfcOutFile);
 
+    bool fluidBackground = false;
+    cmd.AddValue ("fluidBackground", "Simulate the background workload (workload_rdma/workload_tcp) as fluid flows, queries and incasts stay packet-level", fluidBackground);
+
+    uint64_t fluidPerFlowQueue = 0;
+    cmd.AddValue ("fluidPerFlowQueue", "Standing queue per fluid flow at a saturated port in bytes, on top of the ECN kmin", fluidPerFlowQueue);
+
+    std::string occOutFile = "";
+    cmd.AddValue ("occOutFile", "File path for switch buffer occupancy percentiles, written once at the end (disabled if empty)", occOutFile);
+
+    std::string occThresholds = "";
+    cmd.AddValue ("occThresholds", "Comma separated occupancy levels in bytes, the time spent above each is reported in occOutFile", occThresholds);
+
+    std::string bufferConfig = "";
+    cmd.AddValue ("bufferConfig", "SONiC-like buffer pools, profiles and pg to queue map applied to every switch, sonic buffer model only (disabled if empty)", bufferConfig);
+
+    std::string pifoRank = "None";
+    cmd.AddValue ("pifoRank", "Switch egress queues ordered by rank instead of FIFO: None, SRPT (remaining flow size), LSTF (least slack) or STFQ (start-time fair queuing)", pifoRank);
+    uint32_t pifoQueues = 0xfe;
+    cmd.AddValue ("pifoQueues", "Bitmask of the egress queues using pifoRank", pifoQueues);
+    double slackFactor = 2.0;
+    cmd.AddValue ("slackFactor", "LSTF: flow deadline in multiples of its ideal completion time", slackFactor);
+    std::string collective = "None";
+    cmd.AddValue ("collective", "Collective job started at START_TIME: None, Ring, DoubleBinaryTree, HalvingDoubling (allreduce) or AllToAll", collective);
+    uint64_t collectiveSize = 16 * 1024 * 1024;
+    cmd.AddValue ("collectiveSize", "Bytes reduced by the allreduce, or sent to every other rank by the all-to-all", collectiveSize);
+    uint32_t collectiveChunks = 1;
+    cmd.AddValue ("collectiveChunks", "Chunks pipelined through the collective", collectiveChunks);
+    uint32_t collectiveRanks = 0;
+    cmd.AddValue ("collectiveRanks", "Ranks of the collective job on the first servers, 0 for all", collectiveRanks);
+    uint32_t collectiveIterations = 1;
+    cmd.AddValue ("collectiveIterations", "Collectives run back to back by the job", collectiveIterations);
+    double collectiveCompute = 0;
+    cmd.AddValue ("collectiveCompute", "Compute time between two iterations, in us", collectiveCompute);
+    bool collectiveTcp = false;
+    cmd.AddValue ("collectiveTcp", "Collective transfers over TCP instead of RDMA", collectiveTcp);
+    std::string flowTrace;
+    cmd.AddValue ("flowTrace", "Replay this binary flow trace (see utils/flow-trace-gen.cc) instead of generating the RDMA and TCP workloads", flowTrace);
+    double snapshotTime = 0;
+    cmd.AddValue ("snapshotTime", "Fork the simulation into snapshotBranches at this time in seconds, after a shared warm-up (disabled if 0)", snapshotTime);
+    std::string snapshotBranches = "";
+    cmd.AddValue ("snapshotBranches", "Branches of the snapshot: name:override,override;name:... where an override is a config path=value (e.g. /NodeList/*/$ns3::SwitchNode/Mmu/Gamma=0.9) or flowTrace=file to also replay the flows of file after the snapshot. Every branch writes its outputs to <file>.<name>", snapshotBranches);
+    uint32_t snapshotParallel = 0;
+    cmd.AddValue ("snapshotParallel", "Branches simulated at the same time, 0 for all", snapshotParallel);
+    std::string memStatsFile = "";
+    cmd.AddValue ("memStatsFile", "File path for the RSS and the live objects and bytes per subsystem over time (disabled if empty, counters need ns-3 configured with --enable-memory-stats)", memStatsFile);
+    double memStatsInterval = 1e-3;
+    cmd.AddValue ("memStatsInterval", "Sampling interval of memStatsFile in seconds", memStatsInterval);
+    std::string topology = "";
+    cmd.AddValue ("topology", "Generate the network instead of reading TOPOLOGY_FILE: leafspine:hostsPerLeaf,leaves,spines[,linksPerPair], fattree:k or clos:hostsPerLeaf,leavesPerPod,spinesPerPod,pods,coresPerSpine[,linksPerPair]", topology);
+    std::string topologyHostRate = "25Gbps";
+    cmd.AddValue ("topologyHostRate", "Rate of the host links of the generated topology", topologyHostRate);
+    std::string topologyFabricRate = "25Gbps";
+    cmd.AddValue ("topologyFabricRate", "Rate of the switch to switch links of the generated topology", topologyFabricRate);
+    std::string topologyDelay = "2us";
+    cmd.AddValue ("topologyDelay", "Delay of the links of the generated topology", topologyDelay);
+
 
 
     cmd.Parse (argc, argv);
 
     flowEnd = FLOW_LAUNCH_END_TIME;
 
-    fctOutput = asciiTraceHelper.CreateFileStream (fctOutFile);
+    if (fctPerFlow) {
+        fctOutput = asciiTraceHelper.CreateFileStream (fctOutFile);
 
-    *fctOutput->GetStream () 
+        *fctOutput->GetStream () 
             << "timestamp"
             << " " << "flowsize"
             << " " << "fctus"
@@ -761,6 +902,19 @@ int main(int argc, char *argv[])
             << " " << "priority"
             << " " << "incastflow"
             << std::endl;
+    }
+
+    if (fctSummaryFile != "") {
+        fctSummary = new FctSummary();
+        if (fctSizeBuckets != "") {
+            std::vector<uint64_t> bounds;
+            std::stringstream ss(fctSizeBuckets);
+            std::string bound;
+            while (std::getline(ss, bound, ','))
+                bounds.push_back(std::stoull(bound));
+            fctSummary->SetSizeBuckets(bounds);
+        }
+    }
 
     torStats = torTraceHelper.CreateFileStream (torOutFile);
     *torStats->GetStream() 
@@ -986,6 +1140,8 @@ int main(int argc, char *argv[])
 
     Config::SetDefault("ns3::QbbNetDevice::PauseTime", UintegerValue(pause_time));
     Config::SetDefault("ns3::QbbNetDevice::QcnEnabled", BooleanValue(enable_qcn));
+    Config::SetDefault("ns3::BEgressQueue::PifoRank", StringValue(pifoRank));
+    Config::SetDefault("ns3::BEgressQueue::PifoQueues", UintegerValue(pifoQueues));
 
     // set int_multi
     IntHop::multi = int_multi;
@@ -1006,86 +1162,30 @@ int main(int argc, char *argv[])
         printf("PINT bits: %d bytes: %d\n", Pint::get_n_bits(), Pint::get_n_bytes());
     }
 
-    topof.open(topology_file.c_str());
     flowf.open(flow_file.c_str());
-    uint32_t node_num, switch_num, tors, link_num, trace_num;
-    topof >> node_num >> switch_num >> tors >> link_num >> LEAF_SERVER_CAPACITY >> SPINE_LEAF_CAPACITY ;
-    LEAF_COUNT = tors;
-    SPINE_COUNT = switch_num - tors;
-    SERVER_COUNT = (node_num - switch_num) / tors;
-
-    LINK_COUNT = (link_num - (SERVER_COUNT * tors))/(LEAF_COUNT*SPINE_COUNT); // number of links between each tor-spine pair
-
-    flowf >> flow_num;
-
-    NodeContainer serverNodes;
-    NodeContainer torNodes;
-    NodeContainer spineNodes;
-    NodeContainer switchNodes;
-    NodeContainer allNodes;
-
-    std::vector<uint32_t> node_type(node_num, 0);
-
-    for (uint32_t i = 0; i < switch_num; i++) {
-        uint32_t sid;
-        topof >> sid;
-        switchNumToId[i] = sid;
-        switchIdToNum[sid] = i;
-        if (i < tors) {
-            node_type[sid] = 1;
-        }
-        else
-            node_type[sid] = 2;
-
+    if (topology == "") {
+        topof.open(topology_file.c_str());
+        topo.LoadFile(topof);
     }
-
-    for (uint32_t i = 0; i < node_num; i++) {
-        if (node_type[i] == 0) {
-            Ptr<Node> node = CreateObject<Node>();
-            n.Add(node);
-            allNodes.Add(node);
-            serverNodes.Add(node);
-        }
-        else {
-            Ptr<SwitchNode> sw = CreateObject<SwitchNode>();
-            n.Add(sw);
-            switchNodes.Add(sw);
-            allNodes.Add(sw);
-            sw->SetAttribute("EcnEnabled", BooleanValue(enable_qcn));
-            sw->SetNodeType(1);
-            if (node_type[i] == 1) {
-                torNodes.Add(sw);
-            }
-            else if (node_type[i] == 2) {
-                spineNodes.Add(sw);
-            }
-        }
+    else {
+        topo.SetShape(topology);
+        topo.SetTierLink(DcTopologyHelper::HOST, DataRate(topologyHostRate), Time(topologyDelay));
+        topo.SetTierLink(DcTopologyHelper::LEAF, DataRate(topologyFabricRate), Time(topologyDelay));
+        topo.SetTierLink(DcTopologyHelper::SPINE, DataRate(topologyFabricRate), Time(topologyDelay));
     }
+    uint32_t node_num = topo.GetN();
+    LEAF_COUNT = topo.GetN(DcTopologyHelper::LEAF);
+    SPINE_COUNT = topo.GetN(DcTopologyHelper::SPINE);
+    SERVER_COUNT = topo.GetHostsPerLeaf();
+    LINK_COUNT = topo.GetLinksPerPair(); // number of links between each tor-spine pair
+    LEAF_SERVER_CAPACITY = topo.GetTierRate(DcTopologyHelper::HOST).GetBitRate();
+    SPINE_LEAF_CAPACITY = topo.GetTierRate(DcTopologyHelper::LEAF).GetBitRate();
 
+    flowf >> flow_num;
 
     NS_LOG_INFO("Create nodes.");
 
     Config::SetDefault ("ns3::Ipv4GlobalRouting::FlowEcmpRouting", BooleanValue(true));
-    InternetStackHelper internet;
-    Ipv4GlobalRoutingHelper globalRoutingHelper;
-    internet.SetRoutingHelper (globalRoutingHelper);
-    internet.Install(n);
-
-    //
-    // Assign IP to each server
-    //
-    for (uint32_t i = 0; i < node_num; i++) {
-        if (n.Get(i)->GetNodeType() == 0) { // is server
-            serverAddress.resize(i + 1);
-            serverAddress[i] = node_id_to_ip(i);
-        }
-    }
-
-    NS_LOG_INFO("Create channels.");
-
-    //
-    // Explicitly create the channels required by the topology.
-    //
 
     Ptr<RateErrorModel> rem = CreateObject<RateErrorModel>();
     Ptr<UniformRandomVariable> uv = CreateObject<UniformRandomVariable>();
@@ -1093,96 +1193,34 @@ int main(int argc, char *argv[])
     uv->SetStream(50);
     rem->SetAttribute("ErrorRate", DoubleValue(error_rate_per_link));
     rem->SetAttribute("ErrorUnit", StringValue("ERROR_UNIT_PACKET"));
+    topo.SetErrorModel(rem);
 
+    // nodes, internet stack, channels and addresses
     QbbHelper qbb;
-    Ipv4AddressHelper ipv4;
-    for (uint32_t i = 0; i < link_num; i++)
-    {
-        uint32_t src, dst;
-        std::string data_rate, link_delay;
-        double error_rate;
-        topof >> src >> dst >> data_rate >> link_delay >> error_rate;
-
-        // std::cout << src << " " << dst << " " << n.GetN() << std::endl;
-        Ptr<Node> snode = n.Get(src), dnode = n.Get(dst);
-
-
-        qbb.SetDeviceAttribute("DataRate", StringValue(data_rate));
-        qbb.SetChannelAttribute("Delay", StringValue(link_delay));
-
-        if (error_rate > 0)
-        {
-            Ptr<RateErrorModel> rem = CreateObject<RateErrorModel>();
-            Ptr<UniformRandomVariable> uv = CreateObject<UniformRandomVariable>();
-            rem->SetRandomVariable(uv);
-            uv->SetStream(50);
-            rem->SetAttribute("ErrorRate", DoubleValue(error_rate));
-            rem->SetAttribute("ErrorUnit", StringValue("ERROR_UNIT_PACKET"));
-            qbb.SetDeviceAttribute("ReceiveErrorModel", PointerValue(rem));
-        }
-        else
-        {
-            qbb.SetDeviceAttribute("ReceiveErrorModel", PointerValue(rem));
-        }
-
-        fflush(stdout);
-
-        // Assigne server IP
-        // Note: this should be before the automatic assignment below (ipv4.Assign(d)),
-        // because we want our IP to be the primary IP (first in the IP address list),
-        // so that the global routing is based on our IP
-        NetDeviceContainer d = qbb.Install(snode, dnode);
-        if (snode->GetNodeType() == 0) {
-            Ptr<Ipv4> ipv4 = snode->GetObject<Ipv4>();
-            ipv4->AddInterface(d.Get(0));
-            ipv4->AddAddress(1, Ipv4InterfaceAddress(serverAddress[src], Ipv4Mask(0xff000000)));
-        }
-        if (dnode->GetNodeType() == 0) {
-            Ptr<Ipv4> ipv4 = dnode->GetObject<Ipv4>();
-            ipv4->AddInterface(d.Get(1));
-            ipv4->AddAddress(1, Ipv4InterfaceAddress(serverAddress[dst], Ipv4Mask(0xff000000)));
-        }
-
-
-        if (!snode->GetNodeType()) {
-            sourceNodes[src].Add(DynamicCast<QbbNetDevice>(d.Get(0)));
-        }
-
-        if (!snode->GetNodeType() && dnode->GetNodeType()) {
-            switchDown[switchIdToNum[dst]].Add(DynamicCast<QbbNetDevice>(d.Get(1)));
-        }
+    n = topo.Build(qbb);
 
+    NodeContainer torNodes = topo.GetNodes(DcTopologyHelper::LEAF);
+    NodeContainer switchNodes;
+    switchNodes.Add(torNodes);
+    switchNodes.Add(topo.GetNodes(DcTopologyHelper::SPINE));
+    switchNodes.Add(topo.GetNodes(DcTopologyHelper::CORE));
+    for (uint32_t i = 0; i < switchNodes.GetN(); i++)
+        switchNodes.Get(i)->SetAttribute("EcnEnabled", BooleanValue(enable_qcn));
 
-        if (snode->GetNodeType() && dnode->GetNodeType()) {
-            switchToSwitchInterfaces.Add(d);
-            switchUp[switchIdToNum[src]].Add(DynamicCast<QbbNetDevice>(d.Get(0)));
-            switchUp[switchIdToNum[dst]].Add(DynamicCast<QbbNetDevice>(d.Get(1)));
-            switchToSwitch[src][dst].push_back(DynamicCast<QbbNetDevice>(d.Get(0)));
-            switchToSwitch[src][dst].push_back(DynamicCast<QbbNetDevice>(d.Get(1)));
+    //
+    // Assign IP to each server
+    //
+    for (uint32_t i = 0; i < node_num; i++) {
+        if (n.Get(i)->GetNodeType() == 0) { // is server
+            serverAddress.resize(i + 1);
+            serverAddress[i] = DcTopologyHelper::GetHostAddress(i);
         }
+    }
 
-        // used to create a graph of the topology
-        nbr2if[snode][dnode].idx = DynamicCast<QbbNetDevice>(d.Get(0))->GetIfIndex();
-        nbr2if[snode][dnode].up = true;
-        nbr2if[snode][dnode].delay = DynamicCast<QbbChannel>(DynamicCast<QbbNetDevice>(d.Get(0))->GetChannel())->GetDelay().GetTimeStep();
-        nbr2if[snode][dnode].bw = DynamicCast<QbbNetDevice>(d.Get(0))->GetDataRate().GetBitRate();
-        nbr2if[dnode][snode].idx = DynamicCast<QbbNetDevice>(d.Get(1))->GetIfIndex();
-        nbr2if[dnode][snode].up = true;
-        nbr2if[dnode][snode].delay = DynamicCast<QbbChannel>(DynamicCast<QbbNetDevice>(d.Get(1))->GetChannel())->GetDelay().GetTimeStep();
-        nbr2if[dnode][snode].bw = DynamicCast<QbbNetDevice>(d.Get(1))->GetDataRate().GetBitRate();
-
-        // This is just to set up the connectivity between nodes. The IP addresses are useless
-        // char ipstring[16];
-        std::stringstream ipstring;
-        ipstring << "10." << i / 254 + 1 << "." << i % 254 + 1 << ".0";
-        // sprintf(ipstring, "10.%d.%d.0", i / 254 + 1, i % 254 + 1);
-        ipv4.SetBase(ipstring.str().c_str(), "255.255.255.0");
-        // ipv4.SetBase(ipstring, "255.255.255.0");
-        ipv4.Assign(d);
-
-        // setup PFC trace
-        DynamicCast<QbbNetDevice>(d.Get(0))->TraceConnectWithoutContext("QbbPfc", MakeBoundCallback (&get_pfc, pfc_file, DynamicCast<QbbNetDevice>(d.Get(0))));
-        DynamicCast<QbbNetDevice>(d.Get(1))->TraceConnectWithoutContext("QbbPfc", MakeBoundCallback (&get_pfc, pfc_file, DynamicCast<QbbNetDevice>(d.Get(1))));
+    // setup PFC trace
+    for (const DcTopologyHelper::Link &link : topo.GetLinks()) {
+        link.aDev->TraceConnectWithoutContext("QbbPfc", MakeBoundCallback (&get_pfc, pfc_file, link.aDev));
+        link.bDev->TraceConnectWithoutContext("QbbPfc", MakeBoundCallback (&get_pfc, pfc_file, link.bDev));
     }
 
     nic_rate = get_nic_rate(n);
@@ -1221,6 +1259,10 @@ int main(int argc, char *argv[])
             rdmaHw->SetAttribute("DctcpRateAI", DataRateValue(DataRate(dctcp_rate_ai)));
             rdmaHw->SetAttribute("PowerTCPEnabled", BooleanValue(powertcp));
             rdmaHw->SetAttribute("PowerTCPdelay", BooleanValue(thetapowertcp));
+            rdmaHw->SetAttribute("IrnEnabled", BooleanValue(irn));
+            rdmaHw->SetAttribute("IrnPgMask", UintegerValue(irnPgMask));
+            rdmaHw->SetAttribute("RankTag", BooleanValue(pifoRank != "None"));
+            rdmaHw->SetAttribute("SlackFactor", DoubleValue(slackFactor));
             rdmaHw->SetPintSmplThresh(pint_prob);
             // create and install RdmaDriver
             Ptr<RdmaDriver> rdma = CreateObject<RdmaDriver>();
@@ -1243,8 +1285,12 @@ int main(int argc, char *argv[])
         RdmaEgressQueue::ack_q_idx = 3;
 
     // setup routing
-    CalculateRoutes(n);
-    SetRoutingEntries();
+    topo.PopulateRoutes(packet_payload_size);
+
+    if (fluidBackground) {
+        fluidBg = CreateObject<FluidBackground>();
+        fluidBg->SetAttribute("PerFlowQueue", UintegerValue(fluidPerFlowQueue));
+    }
     //
     // get BDP and delay
     //
@@ -1258,10 +1304,10 @@ int main(int argc, char *argv[])
                 continue;
             if (i == j)
                 continue;
-            uint64_t delay = pairDelay[n.Get(i)][n.Get(j)];
-            uint64_t txDelay = pairTxDelay[n.Get(i)][n.Get(j)];
+            uint64_t delay = topo.GetPairDelay(i, j);
+            uint64_t txDelay = topo.GetPairTxDelay(i, j);
             uint64_t rtt = delay * 2 + txDelay;
-            uint64_t bw = pairBw[i][j];
+            uint64_t bw = topo.GetPairBw(i, j);
             uint64_t bdp = rtt * bw / 1000000000 / 8;
             pairBdp[n.Get(i)][n.Get(j)] = bdp;
             pairRtt[i][j] = rtt;
@@ -1279,6 +1325,9 @@ int main(int argc, char *argv[])
     // config switch
     // The switch mmu runs Dynamic Thresholds (DT) by default.
     uint64_t totalHeadroom;
+    SwitchBufferConfig swBufferConfig;
+    if (bufferConfig != "")
+        swBufferConfig.Load(bufferConfig);
     for (uint32_t i = 0; i < node_num; i++) {
         if (n.Get(i)->GetNodeType()) { // is switch
             Ptr<SwitchNode> sw = DynamicCast<SwitchNode>(n.Get(i));
@@ -1292,6 +1341,15 @@ int main(int argc, char *argv[])
             sw->m_mmu->SetPortCount(sw->GetNDevices() - 1); // set the actual port count here so that we don't always iterate over the default 256 ports.
             sw->m_mmu->SetBufferModel(bufferModel);
             sw->m_mmu->SetGamma(gamma);
+            sw->m_mmu->aqm->SetAqm(aqmAlg, aqmEnqueue ? SwitchAqm::MARK_ENQUEUE : SwitchAqm::MARK_DEQUEUE);
+            if (occOutFile != "") {
+                std::vector<uint64_t> levels;
+                std::stringstream ss(occThresholds);
+                std::string level;
+                while (std::getline(ss, level, ','))
+                    levels.push_back(std::stoull(level));
+                sw->m_mmu->EnableOccupancyStats(levels);
+            }
             // std::cout << "ports " << sw->GetNDevices() << " node " << i << std::endl;
             for (uint32_t j = 1; j < sw->GetNDevices(); j++) {
                 Ptr<QbbNetDevice> dev = DynamicCast<QbbNetDevice>(sw->GetDevice(j));
@@ -1328,6 +1386,8 @@ int main(int argc, char *argv[])
             sw->m_mmu->SetEgressLosslessPool(buffer_size);
             sw->m_mmu->SetEgressLossyPool((buffer_size - totalHeadroom) * egressLossyShare);
             sw->m_mmu->node_id = sw->GetId();
+            if (bufferConfig != "")
+                sw->m_mmu->ApplyBufferConfig(swBufferConfig);
         }
         if (n.Get(i)->GetNodeType())
             std::cout << "total headroom: " << totalHeadroom << " ingressPool " << buffer_size - totalHeadroom << " egressLosslessPool " 
@@ -1345,8 +1405,9 @@ int main(int argc, char *argv[])
             sw->SetAttribute("PowerEnabled", BooleanValue(powertcp));
         }
     }
+    topo.AssignStreams(0); // PINT dithering and ECN marking of the switches
 
-    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    topo.PopulateGlobalRouting();
 
     NS_LOG_INFO("Create Applications.");
 
@@ -1385,6 +1446,24 @@ int main(int argc, char *argv[])
 
     long flowCount = 1;
     long totalFlowSize = 0;
+    replayServers = SERVER_COUNT * LEAF_COUNT;
+    replayEndTime = END_TIME;
+    if (!flowTrace.empty() || snapshotBranches.find("flowTrace=") != std::string::npos) {
+        if (SERVER_COUNT * LEAF_COUNT > sizeof(PORT_START) / sizeof(PORT_START[0])) {
+            std::cout << "Trace replay supports at most " << sizeof(PORT_START) / sizeof(PORT_START[0]) << " servers" << std::endl;
+            exit(1);
+        }
+    }
+    if (!flowTrace.empty()) {
+        flowReplay = CreateObject<FlowTraceReplay>();
+        flowReplay->Open(flowTrace);
+        flowReplay->SetFlowCallback(MakeCallback(&replay_flow));
+        Simulator::Schedule(Seconds(START_TIME), &FlowTraceReplay::Start, flowReplay);
+        std::cout << "replaying " << flowReplay->GetNFlows() << " flows from " << flowTrace << std::endl;
+        rdmaload = tcpload = 0;
+        rdmaqueryRequestRate = tcpqueryRequestRate = 0;
+    }
+
     double requestRate = rdmaload * LEAF_SERVER_CAPACITY * SERVER_COUNT / oversubRatio / (8 * avg_cdf (cdfTable)) / SERVER_COUNT;
 
     for (int fromLeafId = 0; fromLeafId < LEAF_COUNT; fromLeafId ++)
@@ -1428,19 +1507,107 @@ int main(int argc, char *argv[])
             incast_tcp(fromLeafId, tcpqueryRequestRate, tcprequestSize, cdfTable, flowCount, SERVER_COUNT, LEAF_COUNT, START_TIME, END_TIME, FLOW_LAUNCH_END_TIME);
         }
     }
+
+    if (collective != "None") {
+        uint32_t ranks = collectiveRanks ? collectiveRanks : SERVER_COUNT * LEAF_COUNT;
+        NodeContainer rankNodes;
+        std::vector<Ipv4Address> rankAddresses;
+        for (uint32_t i = 0; i < ranks; i++) {
+            rankNodes.Add(n.Get(i));
+            rankAddresses.push_back(collectiveTcp ? n.Get(i)->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal() : serverAddress[i]);
+        }
+        collectiveJob = CreateObject<CollectiveJob>();
+        collectiveJob->SetAttribute("Transport", EnumValue(collectiveTcp ? CollectiveJob::TCP : CollectiveJob::RDMA));
+        collectiveJob->SetAttribute("Priority", UintegerValue(collectiveTcp ? 1 : 3));
+        collectiveJob->SetAttribute("Window", UintegerValue(has_win ? maxBdp : 0));
+        collectiveJob->SetAttribute("BaseRtt", UintegerValue(maxRtt));
+        collectiveJob->SetRanks(rankNodes, rankAddresses);
+        CollectiveDag &dag = collectiveJob->GetDag();
+        std::vector<uint32_t> r = CollectiveDag::Ranks(ranks);
+        uint32_t done = CollectiveDag::NONE;
+        for (uint32_t it = 0; it < collectiveIterations; it++) {
+            if (it > 0 && collectiveCompute > 0) {
+                uint32_t compute = dag.AddBarrier(NanoSeconds(collectiveCompute * 1000));
+                dag.AddDependency(done, compute);
+                done = compute;
+            }
+            if (collective == "Ring")
+                done = dag.RingAllReduce(r, collectiveSize, collectiveChunks, done);
+            else if (collective == "DoubleBinaryTree")
+                done = dag.DoubleBinaryTreeAllReduce(r, collectiveSize, collectiveChunks, done);
+            else if (collective == "HalvingDoubling")
+                done = dag.HalvingDoublingAllReduce(r, collectiveSize, collectiveChunks, done);
+            else if (collective == "AllToAll")
+                done = dag.AllToAll(r, collectiveSize, collectiveChunks, done);
+            else {
+                std::cout << "Unknown collective " << collective << std::endl;
+                exit(1);
+            }
+        }
+        std::cout << "collective " << collective << " ranks " << ranks << " transfers " << dag.GetNTransfers() << std::endl;
+        collectiveJob->TraceConnectWithoutContext("JobComplete", MakeBoundCallback(&TraceJobComplete, collective));
+        collectiveJob->Start(Seconds(START_TIME));
+    }
+    Ptr<OutputStreamWrapper> memStats;
+    if (memStatsFile != "") {
+        memStats = Create<OutputStreamWrapper>(memStatsFile, std::ios::out);
+        MemoryStats::Start(Seconds(memStatsInterval), memStats->GetStream());
+    }
+    if (snapshotTime > 0) {
+        snapshot = CreateObject<SimulationSnapshot>();
+        snapshot->SetAttribute("MaxParallel", UintegerValue(snapshotParallel));
+        snapshot->AddBranches(snapshotBranches);
+        if (snapshot->GetNBranches() == 0) {
+            std::cout << "snapshotTime is set without snapshotBranches" << std::endl;
+            exit(1);
+        }
+        if (fctOutput)
+            snapshot->AddStream(fctOutput, fctOutFile);
+        snapshot->AddStream(torStats, torOutFile);
+        snapshot->AddStream(pfc_file, pfcOutFile);
+        if (memStats)
+            snapshot->AddStream(memStats, memStatsFile);
+        snapshot->SetBranchCallback(MakeCallback(&snapshot_branch));
+        snapshot->Schedule(Seconds(snapshotTime));
+    }
 std::cout << "apps finished" << std::endl;
     topof.close();
     tracef.close();
     double delay = 1.5 * maxRtt * 1e-9; // 10 micro seconds
     Simulator::Schedule(Seconds(START_TIME), printBuffer, torStats, torNodes, delay);
 
-    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
     // AsciiTraceHelper ascii;
     // qbb.EnableAsciiAll (ascii.CreateFileStream ("eval.tr"));
     // std::cout << "Running Simulation.\n";
     NS_LOG_INFO("Run Simulation.");
     Simulator::Stop(Seconds(END_TIME));
     Simulator::Run();
+    if (snapshot != NULL && snapshot->IsParent()) {
+        // the parent only ran the warm-up, the branches write the results
+        uint32_t failed = snapshot->Wait();
+        std::cout << snapshot->GetNBranches() << " branches done, " << failed << " failed" << std::endl;
+        Simulator::Destroy();
+        return failed ? 1 : 0;
+    }
+    if (snapshot != NULL) {
+        occOutFile = occOutFile != "" ? snapshot->GetOutputPath(occOutFile) : "";
+        fctSummaryFile = fctSummaryFile != "" ? snapshot->GetOutputPath(fctSummaryFile) : "";
+    }
+    if (occOutFile != "") {
+        std::ofstream occf(occOutFile.c_str());
+        occf << "occ node kind port queue p50 p99 p999 max nsAbove... nsObserved\n";
+        for (uint32_t i = 0; i < switchNodes.GetN(); i++)
+            DynamicCast<SwitchNode>(switchNodes.Get(i))->m_mmu->PrintOccupancyStats(occf);
+        occf.close();
+    }
+    if (fctSummary != NULL) {
+        std::ofstream sumf(fctSummaryFile.c_str());
+        fctSummary->Print(sumf);
+        sumf.close();
+        delete fctSummary;
+        fctSummary = NULL;
+    }
+    MemoryStats::PrintPeak(std::cout);
     Simulator::Destroy();
     NS_LOG_INFO("Done.");
 }
\ No newline at end of file
@@ -0,0 +1,46 @@
+source config.sh
+DIR=$(pwd)
+DUMP_DIR=$DIR/dump_fluid
+
+if [ ! -d "$DUMP_DIR" ];then
+	mkdir $DUMP_DIR
+fi
+
+cd $NS3
+
+# Runs the same RDMA burst experiment with a packet-level and a fluid (hybrid) background,
+# then compares the foreground (incast) FCT slowdowns and the wall-clock time of both runs.
+
+DT=101
+DCQCNCC=1
+CUBIC=2
+
+START_TIME=1
+END_TIME=4
+FLOW_LAUNCH_END_TIME=3
+BUFFER_PER_PORT_PER_GBPS=5.12 # in KiloBytes per port per Gbps
+BUFFERSIZE=$(python3 -c "print(20*25*1000*$BUFFER_PER_PORT_PER_GBPS)") # in Bytes
+ALPHAFILE=$DIR/alphas
+
+alg=$DT
+rdmaload=0.8
+rdmaburst=1000000
+RDMAREQRATE=2
+
+for fluid in false true;do
+	FCTFILE=$DUMP_DIR/fluid-$fluid-$alg-$rdmaload-$rdmaburst.fct
+	DUMPFILE=$DUMP_DIR/fluid-$fluid-$alg-$rdmaload-$rdmaburst.out
+	echo $FCTFILE
+	START=$(date +%s)
+	./waf --run "reverie-evaluation-sigcomm2023 --bufferalgIngress=$alg --bufferalgEgress=$alg --rdmacc=$DCQCNCC --rdmaload=$rdmaload --rdmarequestSize=$rdmaburst --rdmaqueryRequestRate=$RDMAREQRATE --tcpload=0 --tcpcc=$CUBIC --enableEcn=true --tcpqueryRequestRate=0 --tcprequestSize=0 --bufferModel=sonic --START_TIME=$START_TIME --END_TIME=$END_TIME --FLOW_LAUNCH_END_TIME=$FLOW_LAUNCH_END_TIME --buffersize=$BUFFERSIZE --fctOutFile=$FCTFILE --alphasFile=$ALPHAFILE --fluidBackground=$fluid" > $DUMPFILE 2> $DUMPFILE
+	echo "fluidBackground=$fluid wall time $(( $(date +%s)-$START ))s"
+done
+
+python3 - $DUMP_DIR/fluid-false-$alg-$rdmaload-$rdmaburst.fct $DUMP_DIR/fluid-true-$alg-$rdmaload-$rdmaburst.fct <<'PY'
+import sys
+import pandas as pd
+for name, f in zip(["packet", "hybrid"], sys.argv[1:]):
+    df = pd.read_csv(f, delimiter=' ')
+    fg = df[df["incastflow"] == 1]["slowdown"]
+    print(name, "foreground flows", len(fg), "slowdown p50 %.2f p95 %.2f p99 %.2f" % tuple(fg.quantile([0.5, 0.95, 0.99])))
+PY
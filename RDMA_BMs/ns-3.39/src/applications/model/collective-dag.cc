@@ -0,0 +1,282 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "collective-dag.h"
+
+#include "ns3/abort.h"
+
+namespace ns3 {
+
+CollectiveDag::CollectiveDag ()
+  : m_nRanks (0)
+{
+}
+
+uint32_t
+CollectiveDag::AddTransfer (uint32_t src, uint32_t dst, uint64_t size, Time delay)
+{
+  Transfer t;
+  t.src = src;
+  t.dst = dst;
+  t.size = size;
+  t.delay = delay;
+  t.nDeps = 0;
+  m_transfers.push_back (t);
+  if (src != NONE && src >= m_nRanks)
+    m_nRanks = src + 1;
+  if (dst != NONE && dst >= m_nRanks)
+    m_nRanks = dst + 1;
+  return m_transfers.size () - 1;
+}
+
+uint32_t
+CollectiveDag::AddBarrier (Time delay)
+{
+  return AddTransfer (NONE, NONE, 0, delay);
+}
+
+void
+CollectiveDag::AddDependency (uint32_t before, uint32_t after)
+{
+  NS_ABORT_MSG_IF (before >= m_transfers.size () || after >= m_transfers.size (), "CollectiveDag: unknown transfer");
+  m_transfers[before].succ.push_back (after);
+  m_transfers[after].nDeps++;
+}
+
+uint32_t
+CollectiveDag::GetNTransfers (void) const
+{
+  return m_transfers.size ();
+}
+
+const CollectiveDag::Transfer&
+CollectiveDag::GetTransfer (uint32_t id) const
+{
+  return m_transfers[id];
+}
+
+uint32_t
+CollectiveDag::GetNRanks (void) const
+{
+  return m_nRanks;
+}
+
+std::vector<uint32_t>
+CollectiveDag::Ranks (uint32_t n)
+{
+  std::vector<uint32_t> r (n);
+  for (uint32_t i = 0; i < n; i++)
+    r[i] = i;
+  return r;
+}
+
+uint64_t
+CollectiveDag::Piece (uint64_t bytes, uint32_t n, uint32_t k)
+{
+  return bytes * (k + 1) / n - bytes * k / n;
+}
+
+uint32_t
+CollectiveDag::Close (uint32_t first, uint32_t after)
+{
+  uint32_t end = m_transfers.size ();
+  if (after != NONE)
+    {
+      for (uint32_t t = first; t < end; t++)
+        if (m_transfers[t].nDeps == 0)
+          AddDependency (after, t);
+    }
+  uint32_t done = AddBarrier ();
+  for (uint32_t t = first; t < end; t++)
+    if (m_transfers[t].succ.empty ())
+      AddDependency (t, done);
+  if (first == end && after != NONE)
+    AddDependency (after, done);
+  return done;
+}
+
+uint32_t
+CollectiveDag::RingAllReduce (const std::vector<uint32_t>& ranks, uint64_t bytes, uint32_t chunks, uint32_t after)
+{
+  NS_ABORT_MSG_IF (chunks == 0, "CollectiveDag: chunks must be positive");
+  uint32_t n = ranks.size ();
+  uint32_t first = m_transfers.size ();
+  uint32_t steps = n > 1 ? 2 * (n - 1) : 0;
+  // transfer (s, i, k): chunk k of the step s send of rank i to rank i+1
+#define RING_ID(s, i, k) (first + ((s) * n + (i)) * chunks + (k))
+  for (uint32_t s = 0; s < steps; s++)
+    for (uint32_t i = 0; i < n; i++)
+      {
+        // rank i sends the segment it received in the previous step, reduced with its own
+        uint64_t seg = Piece (bytes, n, (i + n - s % n) % n);
+        for (uint32_t k = 0; k < chunks; k++)
+          AddTransfer (ranks[i], ranks[(i + 1) % n], Piece (seg, chunks, k));
+      }
+  for (uint32_t s = 0; s < steps; s++)
+    for (uint32_t i = 0; i < n; i++)
+      for (uint32_t k = 0; k < chunks; k++)
+        {
+          if (s > 0)
+            AddDependency (RING_ID (s - 1, (i + n - 1) % n, k), RING_ID (s, i, k));
+          if (k > 0)
+            AddDependency (RING_ID (s, i, k - 1), RING_ID (s, i, k));
+        }
+#undef RING_ID
+  return Close (first, after);
+}
+
+namespace {
+// binary tree of NCCL on positions 0 .. n-1, rooted at 0: with b the lowest set bit of v,
+// v hangs below (v ^ b) | 2b, or v ^ b past the end, so the odd positions are the leaves
+void
+BuildTree (uint32_t n, std::vector<uint32_t>& parents)
+{
+  parents[0] = CollectiveDag::NONE;
+  for (uint32_t v = 1; v < n; v++)
+    {
+      uint32_t bit = v & (~v + 1);
+      uint32_t up = (v ^ bit) | (bit << 1);
+      parents[v] = up < n ? up : v ^ bit;
+    }
+}
+}
+
+uint32_t
+CollectiveDag::DoubleBinaryTreeAllReduce (const std::vector<uint32_t>& ranks, uint64_t bytes, uint32_t chunks, uint32_t after)
+{
+  NS_ABORT_MSG_IF (chunks == 0, "CollectiveDag: chunks must be positive");
+  uint32_t n = ranks.size ();
+  uint32_t first = m_transfers.size ();
+  if (n > 1)
+    {
+      std::vector<uint32_t> parent (n);
+      BuildTree (n, parent);
+      uint32_t root = 0;
+      std::vector<uint32_t> rootChildren;
+      for (uint32_t v = 0; v < n; v++)
+        if (v != root && parent[v] == root)
+          rootChildren.push_back (v);
+
+      for (uint32_t t = 0; t < 2; t++)
+        {
+          std::vector<uint32_t> rank (n);
+          for (uint32_t v = 0; v < n; v++)
+            rank[v] = ranks[t == 0 ? v : (n % 2 ? (v + 1) % n : n - 1 - v)];
+          uint64_t treeBytes = Piece (bytes, 2, t);
+
+          // up (v, k): chunk k reduced from v to its parent, down (v, k): from the parent to v
+          uint32_t upBase = m_transfers.size ();
+          for (uint32_t v = 0; v < n; v++)
+            if (v != root)
+              for (uint32_t k = 0; k < chunks; k++)
+                AddTransfer (rank[v], rank[parent[v]], Piece (treeBytes, chunks, k));
+          uint32_t downBase = m_transfers.size ();
+          for (uint32_t v = 0; v < n; v++)
+            if (v != root)
+              for (uint32_t k = 0; k < chunks; k++)
+                AddTransfer (rank[parent[v]], rank[v], Piece (treeBytes, chunks, k));
+#define TREE_ID(base, v, k) ((base) + ((v) - ((v) > root)) * chunks + (k))
+          for (uint32_t v = 0; v < n; v++)
+            {
+              if (v == root)
+                continue;
+              for (uint32_t k = 0; k < chunks; k++)
+                {
+                  if (parent[v] != root)
+                    {
+                      AddDependency (TREE_ID (upBase, v, k), TREE_ID (upBase, parent[v], k));
+                      AddDependency (TREE_ID (downBase, parent[v], k), TREE_ID (downBase, v, k));
+                    }
+                  else
+                    {
+                      // the root broadcasts a chunk once all its children have reduced it
+                      for (uint32_t c : rootChildren)
+                        AddDependency (TREE_ID (upBase, v, k), TREE_ID (downBase, c, k));
+                    }
+                  if (k > 0)
+                    {
+                      AddDependency (TREE_ID (upBase, v, k - 1), TREE_ID (upBase, v, k));
+                      AddDependency (TREE_ID (downBase, v, k - 1), TREE_ID (downBase, v, k));
+                    }
+                }
+            }
+#undef TREE_ID
+        }
+    }
+  return Close (first, after);
+}
+
+uint32_t
+CollectiveDag::HalvingDoublingAllReduce (const std::vector<uint32_t>& ranks, uint64_t bytes, uint32_t chunks, uint32_t after)
+{
+  NS_ABORT_MSG_IF (chunks == 0, "CollectiveDag: chunks must be positive");
+  uint32_t n = ranks.size ();
+  NS_ABORT_MSG_IF (n & (n - 1), "CollectiveDag: halving-doubling needs a power of 2 ranks, not " << n);
+  uint32_t first = m_transfers.size ();
+  uint32_t logN = 0;
+  while ((1u << logN) < n)
+    logN++;
+  // step s < logN exchanges half of the current segment with the rank at distance n/2^(s+1),
+  // then the allgather steps double it back with the ranks at distance 1, 2, .. n/2
+  std::vector<uint32_t> dist (2 * logN);
+  std::vector<uint64_t> size (2 * logN);
+  for (uint32_t s = 0; s < logN; s++)
+    {
+      dist[s] = n >> (s + 1);
+      size[s] = bytes >> (s + 1);
+      dist[logN + s] = 1 << s;
+      size[logN + s] = bytes >> (logN - s);
+    }
+#define HD_ID(s, i, k) (first + ((s) * n + (i)) * chunks + (k))
+  for (uint32_t s = 0; s < 2 * logN; s++)
+    for (uint32_t i = 0; i < n; i++)
+      for (uint32_t k = 0; k < chunks; k++)
+        AddTransfer (ranks[i], ranks[i ^ dist[s]], Piece (size[s], chunks, k));
+  for (uint32_t s = 0; s < 2 * logN; s++)
+    for (uint32_t i = 0; i < n; i++)
+      for (uint32_t k = 0; k < chunks; k++)
+        {
+          if (s > 0)
+            AddDependency (HD_ID (s - 1, i ^ dist[s - 1], k), HD_ID (s, i, k));
+          if (k > 0)
+            AddDependency (HD_ID (s, i, k - 1), HD_ID (s, i, k));
+        }
+#undef HD_ID
+  return Close (first, after);
+}
+
+uint32_t
+CollectiveDag::AllToAll (const std::vector<uint32_t>& ranks, uint64_t bytes, uint32_t chunks, uint32_t after)
+{
+  NS_ABORT_MSG_IF (chunks == 0, "CollectiveDag: chunks must be positive");
+  uint32_t n = ranks.size ();
+  uint32_t first = m_transfers.size ();
+  for (uint32_t i = 0; i < n; i++)
+    for (uint32_t j = 0; j < n; j++)
+      {
+        if (i == j)
+          continue;
+        for (uint32_t k = 0; k < chunks; k++)
+          {
+            uint32_t id = AddTransfer (ranks[i], ranks[j], Piece (bytes, chunks, k));
+            if (k > 0)
+              AddDependency (id - 1, id);
+          }
+      }
+  return Close (first, after);
+}
+
+} // namespace ns3
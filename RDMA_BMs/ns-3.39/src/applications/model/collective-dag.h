@@ -0,0 +1,101 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef COLLECTIVE_DAG_H
+#define COLLECTIVE_DAG_H
+
+#include "ns3/nstime.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ * \brief A collective communication job as a dependency graph of transfers.
+ *
+ * A transfer moves size bytes from rank src to rank dst once all the transfers it
+ * depends on have completed, plus an optional delay (compute time). A barrier is a
+ * transfer of 0 bytes; it completes as soon as it is ready, and is used to join or
+ * sequence collectives.
+ *
+ * The collective builders append the transfers of one collective among the given
+ * ranks and return a barrier that completes with it. With after set, the collective
+ * only starts once that transfer has completed, so collectives can be chained with
+ * each other and with compute phases. Every builder splits its data into chunks
+ * pipelined through the schedule: the chunks of one step leave a rank in order, and
+ * chunk k moves on to the next step without waiting for chunk k+1.
+ *
+ * Ranks are plain indices; CollectiveJob maps them to nodes.
+ */
+class CollectiveDag
+{
+public:
+  static const uint32_t NONE = 0xffffffff;
+
+  struct Transfer
+  {
+    uint32_t src;
+    uint32_t dst;
+    uint64_t size;                //!< bytes, 0 for a barrier
+    Time delay;                   //!< between the last dependency and the start
+    uint32_t nDeps;
+    std::vector<uint32_t> succ;   //!< transfers waiting for this one
+  };
+
+  CollectiveDag ();
+
+  uint32_t AddTransfer (uint32_t src, uint32_t dst, uint64_t size, Time delay = Time (0));
+  uint32_t AddBarrier (Time delay = Time (0));
+  /// after cannot start before before has completed
+  void AddDependency (uint32_t before, uint32_t after);
+
+  uint32_t GetNTransfers (void) const;
+  const Transfer& GetTransfer (uint32_t id) const;
+  /// one more than the largest rank used
+  uint32_t GetNRanks (void) const;
+
+  /// ranks 0 .. n-1
+  static std::vector<uint32_t> Ranks (uint32_t n);
+
+  /// reduce-scatter then allgather around the ring, 2(n-1) steps of bytes/n
+  uint32_t RingAllReduce (const std::vector<uint32_t>& ranks, uint64_t bytes, uint32_t chunks = 1, uint32_t after = NONE);
+  /**
+   * Reduce to the root then broadcast, on two binary trees carrying half the data each.
+   * The interior ranks of the first tree are the even ones. The second tree is the first
+   * one mirrored (even n) or shifted by one (odd n), so every rank is a leaf in at least
+   * one of them, but for rank 0 with an odd n, as in NCCL.
+   */
+  uint32_t DoubleBinaryTreeAllReduce (const std::vector<uint32_t>& ranks, uint64_t bytes, uint32_t chunks = 1, uint32_t after = NONE);
+  /// recursive halving reduce-scatter then recursive doubling allgather, n must be a power of 2
+  uint32_t HalvingDoublingAllReduce (const std::vector<uint32_t>& ranks, uint64_t bytes, uint32_t chunks = 1, uint32_t after = NONE);
+  /// every rank sends bytes to every other rank
+  uint32_t AllToAll (const std::vector<uint32_t>& ranks, uint64_t bytes, uint32_t chunks = 1, uint32_t after = NONE);
+
+private:
+  /// size of piece k when bytes is split in n
+  static uint64_t Piece (uint64_t bytes, uint32_t n, uint32_t k);
+  /// hook the transfers from first on after the after transfer, and return a barrier after them
+  uint32_t Close (uint32_t first, uint32_t after);
+
+  std::vector<Transfer> m_transfers;
+  uint32_t m_nRanks;
+};
+
+} // namespace ns3
+
+#endif /* COLLECTIVE_DAG_H */
@@ -0,0 +1,278 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "collective-job.h"
+
+#include "bulk-send-application.h"
+#include "packet-sink.h"
+#include "rdma-client.h"
+
+#include "ns3/abort.h"
+#include "ns3/enum.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/tcp-socket-factory.h"
+#include "ns3/uinteger.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CollectiveJob");
+NS_OBJECT_ENSURE_REGISTERED (CollectiveJob);
+
+TypeId
+CollectiveJob::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CollectiveJob")
+    .SetParent<Object> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<CollectiveJob> ()
+    .AddAttribute ("JobId", "Identifier of the job in the traces",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&CollectiveJob::m_jobId),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Transport", "How the transfers are sent",
+                   EnumValue (RDMA),
+                   MakeEnumAccessor (&CollectiveJob::m_transport),
+                   MakeEnumChecker (TCP, "Tcp",
+                                    RDMA, "Rdma"))
+    .AddAttribute ("BasePort", "First port used on every rank",
+                   UintegerValue (20000),
+                   MakeUintegerAccessor (&CollectiveJob::m_basePort),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("Priority", "TCP priority or RDMA priority group of the transfers",
+                   UintegerValue (3),
+                   MakeUintegerAccessor (&CollectiveJob::m_priority),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Window", "RDMA window in bytes, 0 for none",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&CollectiveJob::m_win),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("BaseRtt", "RDMA base RTT in ns",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&CollectiveJob::m_baseRtt),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("InitialCwnd", "TCP initial window in segments",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&CollectiveJob::m_initialCwnd),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddTraceSource ("TransferComplete", "A transfer of the job completed: job, transfer, time since its start",
+                     MakeTraceSourceAccessor (&CollectiveJob::m_transferTrace),
+                     "ns3::CollectiveJob::TransferTracedCallback")
+    .AddTraceSource ("JobComplete", "The last transfer of the job completed: job, start, job completion time",
+                     MakeTraceSourceAccessor (&CollectiveJob::m_jobTrace),
+                     "ns3::CollectiveJob::JobTracedCallback")
+  ;
+  return tid;
+}
+
+CollectiveJob::CollectiveJob ()
+  : m_remaining (0),
+    m_end (Time (-1))
+{
+  NS_LOG_FUNCTION (this);
+}
+
+CollectiveJob::~CollectiveJob ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+CollectiveJob::DoDispose (void)
+{
+  m_launch = LaunchCallback ();
+  m_nodes = NodeContainer ();
+  Object::DoDispose ();
+}
+
+CollectiveDag&
+CollectiveJob::GetDag (void)
+{
+  return m_dag;
+}
+
+void
+CollectiveJob::SetRanks (NodeContainer nodes, const std::vector<Ipv4Address>& addresses)
+{
+  NS_ABORT_MSG_IF (nodes.GetN () != addresses.size (), "CollectiveJob: one address per rank");
+  m_nodes = nodes;
+  m_addresses = addresses;
+}
+
+void
+CollectiveJob::SetLaunchCallback (LaunchCallback cb)
+{
+  m_launch = cb;
+}
+
+void
+CollectiveJob::Start (Time at)
+{
+  Simulator::Schedule (at, &CollectiveJob::DoStart, this);
+}
+
+void
+CollectiveJob::DoStart (void)
+{
+  NS_ABORT_MSG_IF (m_launch.IsNull () && m_dag.GetNRanks () > m_nodes.GetN (),
+                   "CollectiveJob: the DAG uses " << m_dag.GetNRanks () << " ranks but only " << m_nodes.GetN () << " are set");
+  uint32_t n = m_dag.GetNTransfers ();
+  m_pending.resize (n);
+  m_launched.resize (n);
+  m_port.assign (m_nodes.GetN (), m_basePort);
+  m_remaining = n;
+  m_start = Simulator::Now ();
+  m_end = Time (-1);
+  NS_LOG_INFO ("Job " << m_jobId << " starts with " << n << " transfers");
+  for (uint32_t i = 0; i < n; i++)
+    m_pending[i] = m_dag.GetTransfer (i).nDeps;
+  for (uint32_t i = 0; i < n; i++)
+    if (m_pending[i] == 0)
+      Ready (i);
+  if (n == 0)
+    {
+      m_end = m_start;
+      m_jobTrace (m_jobId, m_start, Time (0));
+    }
+}
+
+void
+CollectiveJob::Ready (uint32_t id)
+{
+  const CollectiveDag::Transfer& t = m_dag.GetTransfer (id);
+  if (t.size == 0 || t.src == t.dst)
+    {
+      // barriers complete through the event queue, a long chain of them would recurse otherwise
+      Simulator::Schedule (t.delay, &CollectiveJob::TransferDone, this, id);
+      m_launched[id] = Simulator::Now () + t.delay;
+    }
+  else if (t.delay.IsStrictlyPositive ())
+    Simulator::Schedule (t.delay, &CollectiveJob::Launch, this, id);
+  else
+    Launch (id);
+}
+
+void
+CollectiveJob::Launch (uint32_t id)
+{
+  m_launched[id] = Simulator::Now ();
+  if (!m_launch.IsNull ())
+    m_launch (this, id);
+  else if (m_transport == TCP)
+    LaunchTcp (id);
+  else
+    LaunchRdma (id);
+}
+
+uint16_t
+CollectiveJob::NextPort (uint32_t rank)
+{
+  uint16_t port = m_port[rank]++;
+  if (m_port[rank] == 0)
+    m_port[rank] = m_basePort;
+  return port;
+}
+
+void
+CollectiveJob::LaunchTcp (uint32_t id)
+{
+  const CollectiveDag::Transfer& t = m_dag.GetTransfer (id);
+  uint16_t port = NextPort (t.dst);
+
+  Ptr<PacketSink> sink = CreateObject<PacketSink> ();
+  sink->SetAttribute ("Protocol", TypeIdValue (TcpSocketFactory::GetTypeId ()));
+  sink->SetAttribute ("Local", AddressValue (InetSocketAddress (Ipv4Address::GetAny (), port)));
+  sink->SetAttribute ("TotalQueryBytes", UintegerValue (t.size));
+  sink->SetAttribute ("recvAt", TimeValue (Simulator::Now ()));
+  sink->SetAttribute ("priority", UintegerValue (1)); // ack packets are prioritized
+  sink->SetAttribute ("priorityCustom", UintegerValue (1));
+  sink->SetAttribute ("senderPriority", UintegerValue (m_priority));
+  sink->SetAttribute ("flowId", UintegerValue (id));
+  sink->SetStartTime (Seconds (0));
+  sink->TraceConnectWithoutContext ("FlowFinish", MakeCallback (&CollectiveJob::TcpFinish, this).Bind (id));
+  m_nodes.Get (t.dst)->AddApplication (sink);
+
+  Ptr<BulkSendApplication> bulksend = CreateObject<BulkSendApplication> ();
+  bulksend->SetAttribute ("Protocol", TypeIdValue (TcpSocketFactory::GetTypeId ()));
+  bulksend->SetAttribute ("SendSize", UintegerValue (t.size));
+  bulksend->SetAttribute ("MaxBytes", UintegerValue (t.size));
+  bulksend->SetAttribute ("FlowId", UintegerValue (id));
+  bulksend->SetAttribute ("priorityCustom", UintegerValue (m_priority));
+  bulksend->SetAttribute ("priority", UintegerValue (m_priority));
+  bulksend->SetAttribute ("Remote", AddressValue (InetSocketAddress (m_addresses[t.dst], port)));
+  bulksend->SetAttribute ("InitialCwnd", UintegerValue (m_initialCwnd));
+  bulksend->SetAttribute ("sendAt", TimeValue (Simulator::Now ()));
+  bulksend->SetStartTime (Seconds (0));
+  m_nodes.Get (t.src)->AddApplication (bulksend);
+}
+
+void
+CollectiveJob::TcpFinish (uint32_t id, double, double, bool, uint32_t)
+{
+  TransferDone (id);
+}
+
+void
+CollectiveJob::LaunchRdma (uint32_t id)
+{
+  const CollectiveDag::Transfer& t = m_dag.GetTransfer (id);
+  Ptr<RdmaClient> client = CreateObject<RdmaClient> ();
+  client->SetAttribute ("PriorityGroup", UintegerValue (m_priority));
+  client->SetAttribute ("Window", UintegerValue (m_win));
+  client->SetAttribute ("BaseRtt", UintegerValue (m_baseRtt));
+  client->SetLocal (m_addresses[t.src], NextPort (t.src));
+  client->SetRemote (m_addresses[t.dst], NextPort (t.dst));
+  client->SetSize (t.size);
+  client->SetFinishCallback (MakeCallback (&CollectiveJob::TransferDone, this).Bind (id));
+  client->SetStartTime (Seconds (0));
+  m_nodes.Get (t.src)->AddApplication (client);
+}
+
+void
+CollectiveJob::TransferDone (uint32_t id)
+{
+  NS_ASSERT_MSG (m_pending[id] == 0 && m_remaining > 0, "CollectiveJob: transfer " << id << " completed twice");
+  m_pending[id] = CollectiveDag::NONE; // done
+  m_remaining--;
+  m_transferTrace (m_jobId, id, Simulator::Now () - m_launched[id]);
+
+  const CollectiveDag::Transfer& t = m_dag.GetTransfer (id);
+  for (uint32_t s : t.succ)
+    if (--m_pending[s] == 0)
+      Ready (s);
+
+  if (m_remaining == 0)
+    {
+      m_end = Simulator::Now ();
+      NS_LOG_INFO ("Job " << m_jobId << " completes in " << GetJct ());
+      m_jobTrace (m_jobId, m_start, m_end - m_start);
+    }
+}
+
+bool
+CollectiveJob::IsComplete (void) const
+{
+  return m_remaining == 0 && !m_end.IsNegative ();
+}
+
+Time
+CollectiveJob::GetJct (void) const
+{
+  return m_end - m_start;
+}
+
+} // namespace ns3
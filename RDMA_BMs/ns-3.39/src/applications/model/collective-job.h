@@ -0,0 +1,121 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef COLLECTIVE_JOB_H
+#define COLLECTIVE_JOB_H
+
+#include "collective-dag.h"
+
+#include "ns3/callback.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/node-container.h"
+#include "ns3/object.h"
+#include "ns3/traced-callback.h"
+
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ * \brief Runs a CollectiveDag on a set of nodes and reports the job completion time.
+ *
+ * Every transfer is started as its own flow when its last dependency completes:
+ * a BulkSendApplication to a PacketSink over TCP, or an RdmaClient (queue pair) over
+ * RDMA. A TCP transfer completes when the sink has received all its bytes, an RDMA
+ * transfer when its queue pair completes at the sender. Each completion decrements
+ * the dependency count of the transfers waiting for it, so resolving the graph costs
+ * O(1) per dependency whatever its size.
+ *
+ * The DAG is filled with GetDag () before Start (). A launch callback replaces the
+ * built-in transports; it must call TransferDone () once the transfer has completed.
+ */
+class CollectiveJob : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  enum Transport
+  {
+    TCP,
+    RDMA
+  };
+
+  /// launches transfer id of the job
+  typedef Callback<void, Ptr<CollectiveJob>, uint32_t> LaunchCallback;
+
+  typedef void (* TransferTracedCallback)(uint32_t job, uint32_t transfer, Time fct);
+  typedef void (* JobTracedCallback)(uint32_t job, Time start, Time jct);
+
+  CollectiveJob ();
+  virtual ~CollectiveJob ();
+
+  CollectiveDag& GetDag (void);
+
+  /**
+   * \param nodes node of each rank
+   * \param addresses IPv4 address of each rank, used to reach it
+   */
+  void SetRanks (NodeContainer nodes, const std::vector<Ipv4Address>& addresses);
+  void SetLaunchCallback (LaunchCallback cb);
+
+  void Start (Time at);
+  void TransferDone (uint32_t id);
+
+  bool IsComplete (void) const;
+  /// job completion time, from Start to the completion of the last transfer
+  Time GetJct (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  void DoStart (void);
+  void Ready (uint32_t id);
+  void Launch (uint32_t id);
+  void LaunchTcp (uint32_t id);
+  void LaunchRdma (uint32_t id);
+  /// connected to the FlowFinish trace of the PacketSink
+  void TcpFinish (uint32_t id, double size, double start, bool incast, uint32_t prio);
+  uint16_t NextPort (uint32_t rank);
+
+  CollectiveDag m_dag;
+  NodeContainer m_nodes;
+  std::vector<Ipv4Address> m_addresses;
+  LaunchCallback m_launch;
+
+  uint32_t m_jobId;
+  Transport m_transport;
+  uint16_t m_basePort;
+  uint32_t m_priority;     //!< TCP priority or RDMA priority group
+  uint32_t m_win;          //!< RDMA window, 0 for none
+  uint64_t m_baseRtt;      //!< RDMA base RTT, ns
+  uint32_t m_initialCwnd;  //!< TCP initial window, segments
+
+  std::vector<uint32_t> m_pending;   //!< unfinished dependencies of each transfer
+  std::vector<Time> m_launched;      //!< start of each transfer
+  std::vector<uint16_t> m_port;      //!< next port of each rank
+  uint32_t m_remaining;
+  Time m_start;
+  Time m_end;
+
+  TracedCallback<uint32_t, uint32_t, Time> m_transferTrace;   //!< job, transfer, its completion time
+  TracedCallback<uint32_t, Time, Time> m_jobTrace;            //!< job, start, completion time
+};
+
+} // namespace ns3
+
+#endif /* COLLECTIVE_JOB_H */
@@ -128,7 +128,13 @@ void RdmaClient::SetSize(uint64_t size){
 	m_size = size;
 }
 
+void RdmaClient::SetFinishCallback (Callback<void> cb){
+	m_finishCb = cb;
+}
+
 void RdmaClient::Finish(){
+	if (!m_finishCb.IsNull())
+		m_finishCb();
 	m_node->DeleteApplication(this);
 }
 
@@ -61,6 +61,8 @@ public:
   void SetLocal (Ipv4Address ip, uint16_t port);
   void SetPG (uint16_t pg);
   void SetSize(uint64_t size);
+  // called when the queue pair completes, before the application is removed
+  void SetFinishCallback (Callback<void> cb);
   void Finish();
 
 protected:
@@ -80,6 +82,7 @@ private:
   uint64_t m_baseRtt; // base Rtt
 
   Time stopTime;
+  Callback<void> m_finishCb;
 };
 
 } // namespace ns3
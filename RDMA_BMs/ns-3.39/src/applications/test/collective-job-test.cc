@@ -0,0 +1,438 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/collective-dag.h"
+#include "ns3/collective-job.h"
+#include "ns3/data-rate.h"
+#include "ns3/enum.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-interface-container.h"
+#include "ns3/node-container.h"
+#include "ns3/simple-net-device-helper.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/test.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace ns3;
+
+namespace
+{
+
+/// size of piece k when bytes is split in n, as CollectiveDag splits segments and chunks
+uint64_t
+Piece(uint64_t bytes, uint32_t n, uint32_t k)
+{
+    return bytes * (k + 1) / n - bytes * k / n;
+}
+
+/// the transfers each transfer depends on
+std::vector<std::vector<uint32_t>>
+Predecessors(const CollectiveDag& dag)
+{
+    std::vector<std::vector<uint32_t>> pred(dag.GetNTransfers());
+    for (uint32_t id = 0; id < dag.GetNTransfers(); id++)
+    {
+        for (uint32_t s : dag.GetTransfer(id).succ)
+        {
+            pred[s].push_back(id);
+        }
+    }
+    return pred;
+}
+
+} // namespace
+
+/**
+ * \ingroup applications-test
+ * \ingroup tests
+ *
+ * Checks the transfers and dependencies of a ring all-reduce of uneven segments, in two
+ * chunks, started after a compute barrier.
+ */
+class CollectiveRingDagTestCase : public TestCase
+{
+  public:
+    CollectiveRingDagTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+CollectiveRingDagTestCase::CollectiveRingDagTestCase()
+    : TestCase("ring all-reduce DAG")
+{
+}
+
+void
+CollectiveRingDagTestCase::DoRun()
+{
+    const uint32_t n = 4;
+    const uint32_t chunks = 2;
+    const uint64_t bytes = 1003; // segments of 250, 251, 251 and 251 bytes
+    const uint32_t steps = 2 * (n - 1);
+    CollectiveDag dag;
+    uint32_t compute = dag.AddBarrier(MicroSeconds(5));
+    uint32_t done = dag.RingAllReduce(CollectiveDag::Ranks(n), bytes, chunks, compute);
+    NS_TEST_ASSERT_MSG_EQ(dag.GetNTransfers(), 2 + steps * n * chunks, "transfers");
+    NS_TEST_EXPECT_MSG_EQ(done, dag.GetNTransfers() - 1, "closing barrier");
+    NS_TEST_EXPECT_MSG_EQ(dag.GetNRanks(), n, "ranks");
+    NS_TEST_EXPECT_MSG_EQ(dag.GetTransfer(done).size, 0, "closing barrier");
+    NS_TEST_EXPECT_MSG_EQ(dag.GetTransfer(done).nDeps, n, "last chunk of every rank");
+    NS_TEST_EXPECT_MSG_EQ(dag.GetTransfer(compute).succ.size(), n, "first chunk of every rank");
+
+    std::vector<std::vector<uint32_t>> pred = Predecessors(dag);
+    uint64_t total = 0;
+    for (uint32_t s = 0; s < steps; s++)
+    {
+        for (uint32_t i = 0; i < n; i++)
+        {
+            // rank i sends segment i - s: the one it received at the step before, and after
+            // the reduce-scatter the fully reduced segment i + 1
+            uint64_t seg = Piece(bytes, n, (i + n - s % n) % n);
+            for (uint32_t k = 0; k < chunks; k++)
+            {
+                uint32_t id = 1 + (s * n + i) * chunks + k;
+                const CollectiveDag::Transfer& t = dag.GetTransfer(id);
+                NS_TEST_EXPECT_MSG_EQ(t.src, i, "sender of " << id);
+                NS_TEST_EXPECT_MSG_EQ(t.dst, (i + 1) % n, "receiver of " << id);
+                NS_TEST_EXPECT_MSG_EQ(t.size, Piece(seg, chunks, k), "size of " << id);
+                total += t.size;
+                std::vector<uint32_t> expected;
+                if (s == 0 && k == 0)
+                {
+                    expected.push_back(compute);
+                }
+                if (s > 0)
+                {
+                    // the same chunk, received from rank i - 1 at the step before
+                    expected.push_back(1 + ((s - 1) * n + (i + n - 1) % n) * chunks + k);
+                }
+                if (k > 0)
+                {
+                    expected.push_back(id - 1);
+                }
+                std::sort(expected.begin(), expected.end());
+                std::sort(pred[id].begin(), pred[id].end());
+                NS_TEST_EXPECT_MSG_EQ((pred[id] == expected), true, "dependencies of " << id);
+                NS_TEST_EXPECT_MSG_EQ(t.nDeps, expected.size(), "dependency count of " << id);
+            }
+        }
+    }
+    NS_TEST_EXPECT_MSG_EQ(total, steps * bytes, "bytes sent");
+}
+
+/**
+ * \ingroup applications-test
+ * \ingroup tests
+ *
+ * Checks the two trees of the double binary tree all-reduce for 2 to 9 ranks: each tree
+ * reaches every rank from the root, carries half the data up and back down, and every
+ * rank is a leaf in one of them, but rank 0 with an odd number of ranks.
+ */
+class CollectiveTreeDagTestCase : public TestCase
+{
+  public:
+    CollectiveTreeDagTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+CollectiveTreeDagTestCase::CollectiveTreeDagTestCase()
+    : TestCase("double binary tree all-reduce DAG")
+{
+}
+
+void
+CollectiveTreeDagTestCase::DoRun()
+{
+    const uint64_t bytes = 1001;
+    for (uint32_t n = 2; n <= 9; n++)
+    {
+        CollectiveDag dag;
+        uint32_t done = dag.DoubleBinaryTreeAllReduce(CollectiveDag::Ranks(n), bytes);
+        NS_TEST_ASSERT_MSG_EQ(dag.GetNTransfers(), 4 * (n - 1) + 1, "transfers of " << n);
+        NS_TEST_EXPECT_MSG_EQ(done, 4 * (n - 1), "closing barrier of " << n);
+        std::vector<uint32_t> interior(n, 0);
+        for (uint32_t t = 0; t < 2; t++)
+        {
+            // up transfers first, then down transfers, in the same order
+            uint32_t up = 2 * (n - 1) * t;
+            uint32_t down = up + n - 1;
+            std::vector<uint32_t> parent(n, CollectiveDag::NONE);
+            std::vector<bool> sends(n, false);
+            for (uint32_t j = 0; j < n - 1; j++)
+            {
+                const CollectiveDag::Transfer& u = dag.GetTransfer(up + j);
+                const CollectiveDag::Transfer& d = dag.GetTransfer(down + j);
+                NS_TEST_EXPECT_MSG_EQ(u.size, Piece(bytes, 2, t), "half of the data");
+                NS_TEST_EXPECT_MSG_EQ(d.size, u.size, "the same data back down");
+                NS_TEST_EXPECT_MSG_EQ(d.src, u.dst, "down from the parent");
+                NS_TEST_EXPECT_MSG_EQ(d.dst, u.src, "down to the child");
+                NS_TEST_EXPECT_MSG_EQ(parent[u.src], CollectiveDag::NONE, "one parent");
+                parent[u.src] = u.dst;
+                sends[d.src] = true;
+            }
+            uint32_t root = n;
+            for (uint32_t v = 0; v < n; v++)
+            {
+                if (parent[v] == CollectiveDag::NONE)
+                {
+                    NS_TEST_EXPECT_MSG_EQ(root, n, "one root in tree " << t << " of " << n);
+                    root = v;
+                }
+                interior[v] += sends[v];
+            }
+            for (uint32_t v = 0; v < n; v++)
+            {
+                uint32_t hops = 0;
+                for (uint32_t w = v; w != root && hops <= n; w = parent[w])
+                {
+                    hops++;
+                }
+                NS_TEST_EXPECT_MSG_LT_OR_EQ(hops, n - 1, "rank " << v << " reaches the root");
+            }
+        }
+        for (uint32_t v = 0; v < n; v++)
+        {
+            uint32_t both = n % 2 == 1 && v == 0 ? 2 : 1;
+            NS_TEST_EXPECT_MSG_LT_OR_EQ(interior[v], both, "rank " << v << " of " << n);
+        }
+    }
+}
+
+/**
+ * \ingroup applications-test
+ * \ingroup tests
+ *
+ * Runs a compute phase, a ring all-reduce and a double binary tree all-reduce back to
+ * back through a launch callback that completes each transfer after 1 us plus 1 ns per
+ * byte. Every transfer must start as soon as its last dependency completes, and the job
+ * completion time is the critical path of the three phases.
+ */
+class CollectiveReleaseTestCase : public TestCase
+{
+  public:
+    CollectiveReleaseTestCase();
+
+  private:
+    void DoRun() override;
+    void Launch(Ptr<CollectiveJob> job, uint32_t id);
+    void TransferComplete(uint32_t job, uint32_t id, Time fct);
+    void JobComplete(uint32_t job, Time start, Time jct);
+
+    std::vector<Time> m_launched;
+    std::vector<Time> m_completed;
+    uint32_t m_jobs;
+    Time m_jct;
+};
+
+CollectiveReleaseTestCase::CollectiveReleaseTestCase()
+    : TestCase("dependency release order and JCT of chained collectives"),
+      m_jobs(0)
+{
+}
+
+void
+CollectiveReleaseTestCase::Launch(Ptr<CollectiveJob> job, uint32_t id)
+{
+    m_launched[id] = Simulator::Now();
+    uint64_t size = job->GetDag().GetTransfer(id).size;
+    Simulator::Schedule(MicroSeconds(1) + NanoSeconds(size),
+                        &CollectiveJob::TransferDone,
+                        job,
+                        id);
+}
+
+void
+CollectiveReleaseTestCase::TransferComplete(uint32_t job, uint32_t id, Time fct)
+{
+    NS_TEST_EXPECT_MSG_EQ(job, 7, "job id");
+    NS_TEST_EXPECT_MSG_EQ(m_completed[id].IsNegative(), true, "transfer " << id << " once");
+    m_completed[id] = Simulator::Now();
+}
+
+void
+CollectiveReleaseTestCase::JobComplete(uint32_t job, Time start, Time jct)
+{
+    m_jobs++;
+    m_jct = jct;
+    NS_TEST_EXPECT_MSG_EQ(start, MicroSeconds(10), "job start");
+}
+
+void
+CollectiveReleaseTestCase::DoRun()
+{
+    Ptr<CollectiveJob> job = CreateObject<CollectiveJob>();
+    job->SetAttribute("JobId", UintegerValue(7));
+    CollectiveDag& dag = job->GetDag();
+    uint32_t compute = dag.AddBarrier(MicroSeconds(5));
+    // 1000 byte segments, 2 us per step
+    uint32_t ring = dag.RingAllReduce(CollectiveDag::Ranks(4), 4000, 1, compute);
+    // halves of 2000 bytes, 3 us per hop, over 3 hops up and 3 hops down (0 <- 4 <- 2 <- 1)
+    dag.DoubleBinaryTreeAllReduce(CollectiveDag::Ranks(5), 4000, 1, ring);
+    job->SetLaunchCallback(MakeCallback(&CollectiveReleaseTestCase::Launch, this));
+    job->TraceConnectWithoutContext("TransferComplete",
+                                    MakeCallback(&CollectiveReleaseTestCase::TransferComplete,
+                                                 this));
+    job->TraceConnectWithoutContext("JobComplete",
+                                    MakeCallback(&CollectiveReleaseTestCase::JobComplete, this));
+    uint32_t n = dag.GetNTransfers();
+    m_launched.assign(n, Time(-1));
+    m_completed.assign(n, Time(-1));
+    job->Start(MicroSeconds(10));
+    Simulator::Run();
+
+    NS_TEST_EXPECT_MSG_EQ(m_jobs, 1, "job completed once");
+    NS_TEST_EXPECT_MSG_EQ(job->IsComplete(), true, "job complete");
+    NS_TEST_EXPECT_MSG_EQ(m_jct, MicroSeconds(5 + 6 * 2 + 6 * 3), "JCT");
+    NS_TEST_EXPECT_MSG_EQ(job->GetJct(), m_jct, "GetJct");
+    std::vector<std::vector<uint32_t>> pred = Predecessors(dag);
+    for (uint32_t id = 0; id < n; id++)
+    {
+        const CollectiveDag::Transfer& t = dag.GetTransfer(id);
+        NS_TEST_ASSERT_MSG_EQ(m_completed[id].IsNegative(), false, "transfer " << id << " done");
+        Time ready = MicroSeconds(10);
+        for (uint32_t p : pred[id])
+        {
+            ready = std::max(ready, m_completed[p]);
+        }
+        if (t.size > 0)
+        {
+            NS_TEST_EXPECT_MSG_EQ(m_launched[id], ready + t.delay, "start of " << id);
+        }
+        else
+        {
+            NS_TEST_EXPECT_MSG_EQ(m_launched[id].IsNegative(), true, "barrier " << id);
+            NS_TEST_EXPECT_MSG_EQ(m_completed[id], ready + t.delay, "barrier " << id);
+        }
+    }
+    Simulator::Destroy();
+}
+
+/**
+ * \ingroup applications-test
+ * \ingroup tests
+ *
+ * Runs a ring all-reduce over TCP among 3 nodes with 100 Mbps interfaces. Every transfer
+ * must start after its dependencies and the job takes at least the time of the 4 steps
+ * at the interface rate, and not much more.
+ */
+class CollectiveTcpJobTestCase : public TestCase
+{
+  public:
+    CollectiveTcpJobTestCase();
+
+  private:
+    void DoRun() override;
+    void TransferComplete(uint32_t job, uint32_t id, Time fct);
+
+    std::vector<Time> m_launched;
+    std::vector<Time> m_completed;
+};
+
+CollectiveTcpJobTestCase::CollectiveTcpJobTestCase()
+    : TestCase("ring all-reduce over TCP on a small topology")
+{
+}
+
+void
+CollectiveTcpJobTestCase::TransferComplete(uint32_t job, uint32_t id, Time fct)
+{
+    m_completed[id] = Simulator::Now();
+    m_launched[id] = Simulator::Now() - fct;
+}
+
+void
+CollectiveTcpJobTestCase::DoRun()
+{
+    const uint32_t n = 3;
+    const uint64_t bytes = 3 * 100000;
+    NodeContainer nodes;
+    nodes.Create(n);
+    SimpleNetDeviceHelper simple;
+    simple.SetDeviceAttribute("DataRate", StringValue("100Mbps"));
+    simple.SetChannelAttribute("Delay", StringValue("10us"));
+    NetDeviceContainer devices = simple.Install(nodes);
+    InternetStackHelper internet;
+    internet.Install(nodes);
+    Ipv4AddressHelper ipv4;
+    ipv4.SetBase("10.1.1.0", "255.255.255.0");
+    Ipv4InterfaceContainer interfaces = ipv4.Assign(devices);
+    std::vector<Ipv4Address> addresses;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        addresses.push_back(interfaces.GetAddress(i));
+    }
+
+    Ptr<CollectiveJob> job = CreateObject<CollectiveJob>();
+    job->SetAttribute("Transport", EnumValue(CollectiveJob::TCP));
+    job->SetRanks(nodes, addresses);
+    CollectiveDag& dag = job->GetDag();
+    dag.RingAllReduce(CollectiveDag::Ranks(n), bytes);
+    job->TraceConnectWithoutContext("TransferComplete",
+                                    MakeCallback(&CollectiveTcpJobTestCase::TransferComplete,
+                                                 this));
+    m_launched.assign(dag.GetNTransfers(), Time(-1));
+    m_completed.assign(dag.GetNTransfers(), Time(-1));
+    job->Start(MilliSeconds(1));
+    Simulator::Stop(Seconds(10));
+    Simulator::Run();
+
+    NS_TEST_ASSERT_MSG_EQ(job->IsComplete(), true, "job complete");
+    // every step sends a third of the data from each interface
+    Time step = DataRate("100Mbps").CalculateBytesTxTime(bytes / n);
+    NS_TEST_EXPECT_MSG_GT_OR_EQ(job->GetJct(), 4 * step, "JCT");
+    NS_TEST_EXPECT_MSG_LT(job->GetJct(), 8 * step, "JCT");
+    std::vector<std::vector<uint32_t>> pred = Predecessors(dag);
+    for (uint32_t id = 0; id < dag.GetNTransfers(); id++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(m_completed[id].IsNegative(), false, "transfer " << id << " done");
+        for (uint32_t p : pred[id])
+        {
+            NS_TEST_EXPECT_MSG_GT_OR_EQ(m_launched[id],
+                                        m_completed[p],
+                                        "transfer " << id << " after " << p);
+        }
+    }
+    Simulator::Destroy();
+}
+
+/**
+ * \ingroup applications-test
+ * \ingroup tests
+ *
+ * \brief TestSuite for the collective communication DAGs and jobs
+ */
+class CollectiveJobTestSuite : public TestSuite
+{
+  public:
+    CollectiveJobTestSuite();
+};
+
+CollectiveJobTestSuite::CollectiveJobTestSuite()
+    : TestSuite("collective-job", UNIT)
+{
+    AddTestCase(new CollectiveRingDagTestCase(), TestCase::QUICK);
+    AddTestCase(new CollectiveTreeDagTestCase(), TestCase::QUICK);
+    AddTestCase(new CollectiveReleaseTestCase(), TestCase::QUICK);
+    AddTestCase(new CollectiveTcpJobTestCase(), TestCase::QUICK);
+}
+
+static CollectiveJobTestSuite g_collectiveJobTestSuite; //!< The testsuite
@@ -21,6 +21,7 @@
 
 #include "assert.h"
 #include "log.h"
+#include "memory-stats.h"
 #include "scheduler.h"
 #include "simulator.h"
 
@@ -80,6 +81,7 @@ DefaultSimulatorImpl::DoDispose()
     while (!m_events->IsEmpty())
     {
         Scheduler::Event next = m_events->RemoveNext();
+        NS_MEMORY_STATS_REMOVE(EVENT, sizeof(Scheduler::Event) + sizeof(EventImpl));
         next.impl->Unref();
     }
     m_events = nullptr;
@@ -135,6 +137,7 @@ DefaultSimulatorImpl::ProcessOneEvent()
 
     NS_ASSERT(next.key.m_ts >= m_currentTs);
     m_unscheduledEvents--;
+    NS_MEMORY_STATS_REMOVE(EVENT, sizeof(Scheduler::Event) + sizeof(EventImpl));
     m_eventCount++;
 
     NS_LOG_LOGIC("handle " << next.key.m_ts);
@@ -179,6 +182,7 @@ DefaultSimulatorImpl::ProcessEventsWithContext()
         ev.key.m_uid = m_uid;
         m_uid++;
         m_unscheduledEvents++;
+        NS_MEMORY_STATS_ADD(EVENT, sizeof(Scheduler::Event) + sizeof(EventImpl));
         m_events->Insert(ev);
     }
 }
@@ -236,6 +240,7 @@ DefaultSimulatorImpl::Schedule(const Time& delay, EventImpl* event)
     ev.key.m_uid = m_uid;
     m_uid++;
     m_unscheduledEvents++;
+    NS_MEMORY_STATS_ADD(EVENT, sizeof(Scheduler::Event) + sizeof(EventImpl));
     m_events->Insert(ev);
     return EventId(event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
 }
@@ -255,6 +260,7 @@ DefaultSimulatorImpl::ScheduleWithContext(uint32_t context, const Time& delay, E
         ev.key.m_uid = m_uid;
         m_uid++;
         m_unscheduledEvents++;
+        NS_MEMORY_STATS_ADD(EVENT, sizeof(Scheduler::Event) + sizeof(EventImpl));
         m_events->Insert(ev);
     }
     else
@@ -344,6 +350,7 @@ DefaultSimulatorImpl::Remove(const EventId& id)
     event.impl->Unref();
 
     m_unscheduledEvents--;
+    NS_MEMORY_STATS_REMOVE(EVENT, sizeof(Scheduler::Event) + sizeof(EventImpl));
 }
 
 void
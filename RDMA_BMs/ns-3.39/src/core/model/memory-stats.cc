@@ -0,0 +1,127 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "memory-stats.h"
+
+#include "simulator.h"
+
+#include <fstream>
+
+#ifdef __unix__
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+/**
+ * \file
+ * \ingroup core
+ * ns3::MemoryStats implementation.
+ */
+
+namespace ns3
+{
+
+namespace
+{
+
+const char* const CATEGORY_NAMES[MemoryStats::N_CATEGORIES] =
+    {"node", "device", "mmu", "qp", "app", "queued", "tag", "event"};
+
+} // namespace
+
+int64_t MemoryStats::s_count[MemoryStats::N_CATEGORIES] = {};
+int64_t MemoryStats::s_bytes[MemoryStats::N_CATEGORIES] = {};
+int64_t MemoryStats::s_peakCount[MemoryStats::N_CATEGORIES] = {};
+int64_t MemoryStats::s_peakBytes[MemoryStats::N_CATEGORIES] = {};
+Time MemoryStats::s_interval;
+std::ostream* MemoryStats::s_os = nullptr;
+
+const char*
+MemoryStats::GetName(Category c)
+{
+    return CATEGORY_NAMES[c];
+}
+
+bool
+MemoryStats::IsEnabled()
+{
+#ifdef ENABLE_MEMORY_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t
+MemoryStats::GetRss()
+{
+#ifdef __linux__
+    // second field of statm: resident pages
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0;
+    uint64_t resident = 0;
+    if (statm >> size >> resident)
+    {
+        return resident * sysconf(_SC_PAGESIZE) / 1024;
+    }
+#endif
+    return 0;
+}
+
+uint64_t
+MemoryStats::GetPeakRss()
+{
+#ifdef __unix__
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return 0;
+}
+
+void
+MemoryStats::Start(Time interval, std::ostream* os)
+{
+    s_interval = interval;
+    s_os = os;
+    *s_os << "time_ns rss_kb";
+    for (uint32_t c = 0; c < N_CATEGORIES; c++)
+    {
+        *s_os << " " << CATEGORY_NAMES[c] << "_n " << CATEGORY_NAMES[c] << "_bytes";
+    }
+    *s_os << "\n";
+    Simulator::ScheduleNow(&MemoryStats::Sample);
+}
+
+void
+MemoryStats::Sample()
+{
+    *s_os << Simulator::Now().GetNanoSeconds() << " " << GetRss();
+    for (uint32_t c = 0; c < N_CATEGORIES; c++)
+    {
+        *s_os << " " << s_count[c] << " " << s_bytes[c];
+    }
+    *s_os << "\n";
+    Simulator::Schedule(s_interval, &MemoryStats::Sample);
+}
+
+void
+MemoryStats::PrintPeak(std::ostream& os)
+{
+    os << "memory category count bytes peak_count peak_bytes\n";
+    if (IsEnabled())
+    {
+        for (uint32_t c = 0; c < N_CATEGORIES; c++)
+        {
+            os << "memory " << CATEGORY_NAMES[c] << " " << s_count[c] << " " << s_bytes[c] << " "
+               << s_peakCount[c] << " " << s_peakBytes[c] << "\n";
+        }
+    }
+    os << "memory peak_rss_kb " << GetPeakRss() << "\n";
+}
+
+} // namespace ns3
@@ -0,0 +1,130 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include "nstime.h"
+
+#include <ostream>
+#include <stdint.h>
+
+/**
+ * \file
+ * \ingroup core
+ * ns3::MemoryStats declaration and the NS_MEMORY_STATS_* macros.
+ */
+
+namespace ns3
+{
+
+/**
+ * \ingroup core
+ * \brief Live object counts and bytes per subsystem, to see where the memory of a run goes.
+ *
+ * The models report their objects with the NS_MEMORY_STATS_* macros, which only do
+ * something when ns-3 is configured with NS3_MEMORY_STATS (ENABLE_MEMORY_STATS defined);
+ * otherwise they compile to nothing and the counters stay at zero. The bytes are the
+ * fixed size of the objects (sizeof), plus the payload of queued packets and tags: they
+ * show which subsystem grows, not the exact heap usage, which the RSS columns give.
+ *
+ * Start() samples the counters and the RSS periodically in simulation time and writes
+ * one line per sample; PrintPeak() writes the peak of every category and the peak RSS.
+ * The RSS is available whether or not the counters are compiled in.
+ */
+class MemoryStats
+{
+  public:
+    enum Category
+    {
+        NODE = 0,
+        DEVICE,
+        MMU,
+        QP,
+        APPLICATION,
+        QUEUED_PACKET,
+        PACKET_TAG,
+        EVENT,
+        N_CATEGORIES
+    };
+
+    static const char* GetName(Category c);
+
+    /// One more object of c, of bytes
+    static void Add(Category c, int64_t bytes)
+    {
+        s_count[c]++;
+        Resize(c, bytes);
+        if (s_count[c] > s_peakCount[c])
+        {
+            s_peakCount[c] = s_count[c];
+        }
+    }
+
+    /// One object of c, of bytes, is gone
+    static void Remove(Category c, int64_t bytes)
+    {
+        s_count[c]--;
+        s_bytes[c] -= bytes;
+    }
+
+    /// A live object of c grew by delta bytes (shrank if negative)
+    static void Resize(Category c, int64_t delta)
+    {
+        s_bytes[c] += delta;
+        if (s_bytes[c] > s_peakBytes[c])
+        {
+            s_peakBytes[c] = s_bytes[c];
+        }
+    }
+
+    static int64_t GetCount(Category c)
+    {
+        return s_count[c];
+    }
+
+    static int64_t GetBytes(Category c)
+    {
+        return s_bytes[c];
+    }
+
+    /// Whether the counters are compiled in
+    static bool IsEnabled();
+
+    /// Resident set size now, in KB, 0 if unknown
+    static uint64_t GetRss();
+    /// Largest resident set size of the process so far, in KB
+    static uint64_t GetPeakRss();
+
+    /**
+     * Writes a header, then a sample every interval from now until the end of the
+     * simulation: time, RSS, and the count and bytes of every category.
+     */
+    static void Start(Time interval, std::ostream* os);
+    /// Writes the current, peak count and peak bytes of every category and the peak RSS.
+    static void PrintPeak(std::ostream& os);
+
+  private:
+    static void Sample();
+
+    static int64_t s_count[N_CATEGORIES];
+    static int64_t s_bytes[N_CATEGORIES];
+    static int64_t s_peakCount[N_CATEGORIES];
+    static int64_t s_peakBytes[N_CATEGORIES];
+    static Time s_interval;
+    static std::ostream* s_os;
+};
+
+} // namespace ns3
+
+#ifdef ENABLE_MEMORY_STATS
+#define NS_MEMORY_STATS_ADD(category, bytes) ns3::MemoryStats::Add(ns3::MemoryStats::category, bytes)
+#define NS_MEMORY_STATS_REMOVE(category, bytes)                                                   \
+    ns3::MemoryStats::Remove(ns3::MemoryStats::category, bytes)
+#define NS_MEMORY_STATS_RESIZE(category, delta)                                                   \
+    ns3::MemoryStats::Resize(ns3::MemoryStats::category, delta)
+#else
+#define NS_MEMORY_STATS_ADD(category, bytes)
+#define NS_MEMORY_STATS_REMOVE(category, bytes)
+#define NS_MEMORY_STATS_RESIZE(category, delta)
+#endif
+
+#endif /* MEMORY_STATS_H */
@@ -60,6 +60,12 @@ Ipv4GlobalRoutingHelper::Create(Ptr<Node> node) const
 void
 Ipv4GlobalRoutingHelper::PopulateRoutingTables()
 {
+    /* Modification */
+    if (GlobalRouteManager::InitializeRoutesBfs())
+    {
+        return;
+    }
+    /* Modification */
     GlobalRouteManager::BuildGlobalRoutingDatabase();
     GlobalRouteManager::InitializeRoutes();
 }
@@ -68,6 +74,12 @@ void
 Ipv4GlobalRoutingHelper::RecomputeRoutingTables()
 {
     GlobalRouteManager::DeleteGlobalRoutes();
+    /* Modification */
+    if (GlobalRouteManager::InitializeRoutesBfs())
+    {
+        return;
+    }
+    /* Modification */
     GlobalRouteManager::BuildGlobalRoutingDatabase();
     GlobalRouteManager::InitializeRoutes();
 }
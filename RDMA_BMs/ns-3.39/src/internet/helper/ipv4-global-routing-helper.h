@@ -71,7 +71,9 @@ class Ipv4GlobalRoutingHelper : public Ipv4RoutingHelper
      * routers.
      *
      * All this function does is call the functions
-     * BuildGlobalRoutingDatabase () and  InitializeRoutes ().
+     * BuildGlobalRoutingDatabase () and  InitializeRoutes (), or
+     * GlobalRouteManager::InitializeRoutesBfs () on point-to-point topologies
+     * with equal link metrics, which gives the same tables faster.
      *
      */
     static void PopulateRoutingTables();
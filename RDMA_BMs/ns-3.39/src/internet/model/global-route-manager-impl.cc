@@ -40,6 +40,16 @@
 #include <utility>
 #include <vector>
 
+/* Modification */
+#include "loopback-net-device.h"
+
+#include "ns3/channel.h"
+
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+/* Modification */
+
 namespace ns3
 {
 
@@ -733,6 +743,387 @@ GlobalRouteManagerImpl::InitializeRoutes()
     NS_LOG_INFO("Finished SPF calculation");
 }
 
+/* Modification */
+//
+// Global routing on a topology of point-to-point links with the same metric everywhere,
+// without the LSDB.  The candidate queue of SPFCalculate () is then a FIFO of the
+// routers in breadth first order (no network vertices, no lower-cost paths to reorder),
+// so a BFS per router over a dense copy of the router LSAs visits the routers in the
+// same order, merges the same root exit directions and adds the same routes in the same
+// order.  The searches of the routers are independent and touch no simulation object;
+// they run in parallel, and the routes are added to the tables afterwards, in batches.
+//
+bool
+GlobalRouteManagerImpl::InitializeRoutesBfs(uint32_t threads)
+{
+    NS_LOG_FUNCTION(this << threads);
+    BfsTopology topo;
+    if (!BuildBfsTopology(topo))
+    {
+        NS_LOG_INFO("Topology does not qualify for BFS global routing");
+        return false;
+    }
+    std::vector<uint32_t> roots;
+    for (uint32_t i = 0; i < topo.routerId.size(); i++)
+    {
+        if (topo.local[i])
+        {
+            roots.push_back(i);
+        }
+    }
+    if (threads == 0)
+    {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    threads = std::min<uint32_t>(threads, roots.size());
+    NS_LOG_INFO("BFS global routing of " << roots.size() << " routers with " << threads
+                                         << " threads");
+
+    // bound the memory of the routes waiting to be added
+    uint32_t batch = std::max(1U, threads) * 16;
+    std::vector<std::vector<BfsRoute>> routes(batch);
+    for (uint32_t start = 0; start < roots.size(); start += batch)
+    {
+        uint32_t n = std::min<uint32_t>(batch, roots.size() - start);
+        std::atomic<uint32_t> next(0);
+        auto worker = [&]() {
+            for (uint32_t j = next++; j < n; j = next++)
+            {
+                routes[j].clear();
+                BfsCalculate(topo, roots[start + j], routes[j]);
+            }
+        };
+        if (threads <= 1)
+        {
+            worker();
+        }
+        else
+        {
+            std::vector<std::thread> pool;
+            for (uint32_t t = 0; t < threads; t++)
+            {
+                pool.emplace_back(worker);
+            }
+            for (std::thread& t : pool)
+            {
+                t.join();
+            }
+        }
+        for (uint32_t j = 0; j < n; j++)
+        {
+            Ptr<Ipv4GlobalRouting> gr = topo.routing[roots[start + j]];
+            for (const BfsRoute& r : routes[j])
+            {
+                if (r.host)
+                {
+                    gr->AddHostRouteTo(Ipv4Address(r.dest), Ipv4Address(r.gateway), r.interface);
+                }
+                else
+                {
+                    gr->AddNetworkRouteTo(Ipv4Address(r.dest),
+                                          Ipv4Mask(r.mask),
+                                          Ipv4Address(r.gateway),
+                                          r.interface);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool
+GlobalRouteManagerImpl::BuildBfsTopology(BfsTopology& topo) const
+{
+    NS_LOG_FUNCTION(this);
+    std::vector<Ptr<Node>> nodes;
+    std::unordered_map<uint32_t, uint32_t> index; // by router id
+    for (NodeList::Iterator i = NodeList::Begin(); i != NodeList::End(); i++)
+    {
+        Ptr<GlobalRouter> rtr = (*i)->GetObject<GlobalRouter>();
+        if (!rtr)
+        {
+            continue;
+        }
+        if (rtr->GetNInjectedRoutes() > 0)
+        {
+            NS_LOG_LOGIC("Node " << (*i)->GetId() << " injects external routes");
+            return false;
+        }
+        index[rtr->GetRouterId().Get()] = nodes.size();
+        nodes.push_back(*i);
+        topo.routing.push_back(rtr->GetRoutingProtocol());
+        topo.routerId.push_back(rtr->GetRouterId().Get());
+        topo.local.push_back((*i)->GetSystemId() == Simulator::GetSystemId());
+    }
+
+    // the link records of GlobalRouter::DiscoverLSAs () and ProcessPointToPointLink ()
+    uint16_t metric = 0;
+    for (uint32_t n = 0; n < nodes.size(); n++)
+    {
+        topo.first.push_back(topo.records.size());
+        Ptr<Ipv4> ipv4 = nodes[n]->GetObject<Ipv4>();
+        if (!ipv4)
+        {
+            return false;
+        }
+        for (uint32_t d = 0; d < nodes[n]->GetNDevices(); d++)
+        {
+            Ptr<NetDevice> nd = nodes[n]->GetDevice(d);
+            if (DynamicCast<LoopbackNetDevice>(nd))
+            {
+                continue;
+            }
+            int32_t interface = ipv4->GetInterfaceForDevice(nd);
+            if (interface == -1 || !(ipv4->IsUp(interface) && ipv4->IsForwarding(interface)))
+            {
+                continue;
+            }
+            Ptr<Channel> ch = nd->GetChannel();
+            if (!nd->IsPointToPoint() || !ch || ch->GetNDevices() != 2 ||
+                ipv4->GetNAddresses(interface) == 0)
+            {
+                NS_LOG_LOGIC("Node " << nodes[n]->GetId() << " has a link that is not point-to-point");
+                return false;
+            }
+            Ptr<NetDevice> ndRemote = ch->GetDevice(0) == nd ? ch->GetDevice(1) : ch->GetDevice(0);
+            Ptr<Node> nodeRemote = ndRemote->GetNode();
+            Ptr<Ipv4> ipv4Remote = nodeRemote->GetObject<Ipv4>();
+            if (!ipv4Remote)
+            {
+                return false;
+            }
+            Ptr<GlobalRouter> rtrRemote = nodeRemote->GetObject<GlobalRouter>();
+            if (!rtrRemote)
+            {
+                continue;
+            }
+            int32_t interfaceRemote = ipv4Remote->GetInterfaceForDevice(ndRemote);
+            if (interfaceRemote == -1 || ipv4Remote->GetNAddresses(interfaceRemote) == 0)
+            {
+                return false;
+            }
+            Ipv4Address addrLocal = ipv4->GetAddress(interface, 0).GetLocal();
+            BfsTopology::Record r;
+            if (ipv4Remote->IsUp(interfaceRemote))
+            {
+                uint16_t metricLocal = ipv4->GetMetric(interface);
+                if (metricLocal == 0 || (metric != 0 && metricLocal != metric))
+                {
+                    NS_LOG_LOGIC("Link metrics differ");
+                    return false;
+                }
+                metric = metricLocal;
+                r.p2p = true;
+                r.linkId = rtrRemote->GetRouterId().Get();
+                r.linkData = addrLocal.Get();
+                r.peer = index[r.linkId];
+                r.outIf = ipv4->GetInterfaceForPrefix(addrLocal, Ipv4Mask("255.255.255.255"));
+                topo.records.push_back(r);
+            }
+            r.p2p = false;
+            r.linkId = ipv4Remote->GetAddress(interfaceRemote, 0).GetLocal().Get();
+            r.linkData = ipv4Remote->GetAddress(interfaceRemote, 0).GetMask().Get();
+            r.peer = 0;
+            r.outIf = -1;
+            topo.records.push_back(r);
+        }
+    }
+    topo.first.push_back(topo.records.size());
+
+    // SPFNexthopCalculation () takes the next hop from the first record of the peer back
+    // to the root, which the SPF assumes to exist
+    for (uint32_t n = 0; n < nodes.size(); n++)
+    {
+        for (uint32_t i = topo.first[n]; i < topo.first[n + 1]; i++)
+        {
+            const BfsTopology::Record& r = topo.records[i];
+            if (!r.p2p)
+            {
+                continue;
+            }
+            bool back = false;
+            for (uint32_t j = topo.first[r.peer]; j < topo.first[r.peer + 1] && !back; j++)
+            {
+                back = topo.records[j].linkId == topo.routerId[n];
+            }
+            if (!back)
+            {
+                NS_LOG_LOGIC("Link from node " << nodes[n]->GetId() << " is one-way");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void
+GlobalRouteManagerImpl::BfsCalculate(const BfsTopology& topo,
+                                     uint32_t root,
+                                     std::vector<BfsRoute>& routes) const
+{
+    typedef std::pair<uint32_t, int32_t> Exit; // as SPFVertex::NodeExit_t, sorted the same
+    const std::vector<BfsTopology::Record>& rec = topo.records;
+    const std::vector<uint32_t>& first = topo.first;
+    uint32_t rootId = topo.routerId[root];
+
+    // CheckForStubNode ()
+    uint32_t transits = 0;
+    uint32_t transitLink = 0;
+    for (uint32_t i = first[root]; i < first[root + 1]; i++)
+    {
+        if (rec[i].p2p)
+        {
+            transits++;
+            transitLink = i;
+        }
+    }
+    if (transits == 0)
+    {
+        return;
+    }
+    if (transits == 1)
+    {
+        uint32_t w = rec[transitLink].peer;
+        for (uint32_t j = first[w]; j < first[w + 1]; j++)
+        {
+            if (rec[j].p2p && rec[j].linkId == rootId)
+            {
+                routes.push_back({false, 0, 0, rec[j].linkData, uint32_t(rec[transitLink].outIf)});
+                return;
+            }
+        }
+    }
+
+    // SPFCalculate (): SPFNext () on each router popped from the candidate queue, and
+    // SPFIntraAddRouter () when it is popped
+    enum
+    {
+        NOT_EXPLORED,
+        CANDIDATE,
+        IN_SPFTREE
+    };
+    uint32_t n = topo.routerId.size();
+    std::vector<uint8_t> status(n, NOT_EXPLORED);
+    std::vector<uint32_t> hops(n, 0);
+    std::vector<std::vector<Exit>> exits(n);
+    std::vector<std::vector<uint32_t>> parents(n);
+    std::vector<std::vector<uint32_t>> children(n);
+    std::vector<uint32_t> queue;
+    status[root] = IN_SPFTREE;
+    std::vector<Exit> rootExit(1);
+    for (uint32_t v = root, head = 0;;)
+    {
+        for (uint32_t i = first[v]; i < first[v + 1]; i++)
+        {
+            if (!rec[i].p2p)
+            {
+                continue;
+            }
+            uint32_t w = rec[i].peer;
+            if (status[w] == IN_SPFTREE || (status[w] == CANDIDATE && hops[w] < hops[v] + 1))
+            {
+                continue;
+            }
+            const std::vector<Exit>* exit = &exits[v];
+            if (v == root)
+            {
+                // SPFGetNextLink (w, root): the first record of w back to the root
+                uint32_t j = first[w];
+                while (rec[j].linkId != rootId)
+                {
+                    j++;
+                }
+                rootExit[0] = Exit(rec[j].linkData, rec[i].outIf);
+                exit = &rootExit;
+            }
+            if (status[w] == NOT_EXPLORED)
+            {
+                status[w] = CANDIDATE;
+                hops[w] = hops[v] + 1;
+                exits[w] = *exit;
+                parents[w].push_back(v);
+                queue.push_back(w);
+            }
+            else
+            {
+                // equal cost: MergeRootExitDirections () and MergeParent ()
+                exits[w].insert(exits[w].end(), exit->begin(), exit->end());
+                std::sort(exits[w].begin(), exits[w].end());
+                exits[w].erase(std::unique(exits[w].begin(), exits[w].end()), exits[w].end());
+                if (std::find(parents[w].begin(), parents[w].end(), v) == parents[w].end())
+                {
+                    parents[w].push_back(v);
+                }
+            }
+        }
+        if (head == queue.size())
+        {
+            break;
+        }
+        v = queue[head++];
+        status[v] = IN_SPFTREE;
+        for (uint32_t p : parents[v])
+        {
+            children[p].push_back(v);
+        }
+        for (uint32_t i = first[v]; i < first[v + 1]; i++)
+        {
+            if (!rec[i].p2p)
+            {
+                continue;
+            }
+            for (const Exit& e : exits[v])
+            {
+                if (e.second >= 0)
+                {
+                    routes.push_back({true, rec[i].linkData, 0, e.first, uint32_t(e.second)});
+                }
+            }
+        }
+    }
+
+    // SPFProcessStubs (): depth first over the children, each router once
+    std::vector<bool> processed(n, false);
+    std::vector<std::pair<uint32_t, uint32_t>> stack(1, std::make_pair(root, 0));
+    while (!stack.empty())
+    {
+        uint32_t v = stack.back().first;
+        uint32_t c = stack.back().second++;
+        if (c == children[v].size())
+        {
+            processed[v] = true;
+            stack.pop_back();
+            continue;
+        }
+        uint32_t w = children[v][c];
+        if (processed[w])
+        {
+            continue;
+        }
+        // SPFIntraAddStub ()
+        for (uint32_t i = first[w]; i < first[w + 1]; i++)
+        {
+            if (rec[i].p2p)
+            {
+                continue;
+            }
+            for (const Exit& e : exits[w])
+            {
+                if (e.second >= 0)
+                {
+                    routes.push_back({false,
+                                      rec[i].linkId & rec[i].linkData,
+                                      rec[i].linkData,
+                                      e.first,
+                                      uint32_t(e.second)});
+                }
+            }
+        }
+        stack.emplace_back(w, 0);
+    }
+}
+/* Modification */
+
 //
 // This method is derived from quagga ospf_spf_next ().  See RFC2328 Section
 // 16.1 (2) for further details.
@@ -737,10 +737,75 @@ class GlobalRouteManagerImpl
      */
     void DebugSPFCalculate(Ipv4Address root);
 
+    /* Modification */
+    /**
+     * @brief Populate the per-node forwarding tables with a breadth first search
+     * per router instead of the LSDB and SPF calculation.
+     *
+     * Only for topologies of point-to-point links with the same metric everywhere
+     * and without injected external routes, where every shortest path has the same
+     * hop count.  The tables, and the order of the routes in them, are the same as
+     * after BuildGlobalRoutingDatabase () and InitializeRoutes ().
+     *
+     * @param threads threads for the searches, 0 for one per core
+     * @returns false, without touching any table, if the topology does not qualify
+     */
+    virtual bool InitializeRoutesBfs(uint32_t threads);
+    /* Modification */
+
   private:
     SPFVertex* m_spfroot;           //!< the root node
     GlobalRouteManagerLSDB* m_lsdb; //!< the Link State DataBase (LSDB) of the Global Route Manager
 
+    /* Modification */
+    /// The router LSAs of a point-to-point topology, with routers by index
+    struct BfsTopology
+    {
+        /// A link record of a router LSA
+        struct Record
+        {
+            bool p2p;          //!< PointToPoint record, otherwise StubNetwork
+            uint32_t linkId;   //!< router id of the peer, or stub network address
+            uint32_t linkData; //!< local address, or stub network mask
+            uint32_t peer;     //!< router index of the peer of a PointToPoint record
+            int32_t outIf;     //!< interface of the local address
+        };
+
+        std::vector<Ptr<Ipv4GlobalRouting>> routing; //!< routing protocol of each router
+        std::vector<uint32_t> routerId;              //!< router id of each router
+        std::vector<bool> local;                     //!< router is on this system
+        std::vector<uint32_t> first; //!< records of router i are [first[i], first[i + 1])
+        std::vector<Record> records; //!< records of all routers, in LSA order
+    };
+
+    /// A route to add to the table of a router
+    struct BfsRoute
+    {
+        bool host;          //!< host route, otherwise network route
+        uint32_t dest;      //!< host or network address
+        uint32_t mask;      //!< network mask
+        uint32_t gateway;   //!< next hop
+        uint32_t interface; //!< outgoing interface
+    };
+
+    /**
+     * @brief Collect the router LSAs of the topology, as DiscoverLSAs () would
+     * @param topo the topology to fill
+     * @returns false if the topology does not qualify for InitializeRoutesBfs ()
+     */
+    bool BuildBfsTopology(BfsTopology& topo) const;
+
+    /**
+     * @brief Compute the routes of a router, in the order CheckForStubNode () and
+     * SPFCalculate () add them. Touches no simulation object, so the routers can be
+     * computed in parallel.
+     * @param topo the topology
+     * @param root router index
+     * @param routes the routes to add to the table of root
+     */
+    void BfsCalculate(const BfsTopology& topo, uint32_t root, std::vector<BfsRoute>& routes) const;
+    /* Modification */
+
     /**
      * \brief Test if a node is a stub, from an OSPF sense.
      *
@@ -57,6 +57,15 @@ GlobalRouteManager::InitializeRoutes()
     SimulationSingleton<GlobalRouteManagerImpl>::Get()->InitializeRoutes();
 }
 
+/* Modification */
+bool
+GlobalRouteManager::InitializeRoutesBfs(uint32_t threads)
+{
+    NS_LOG_FUNCTION(threads);
+    return SimulationSingleton<GlobalRouteManagerImpl>::Get()->InitializeRoutesBfs(threads);
+}
+/* Modification */
+
 uint32_t
 GlobalRouteManager::AllocateRouterId()
 {
@@ -70,6 +70,18 @@ class GlobalRouteManager
      * per-node forwarding tables
      */
     static void InitializeRoutes();
+
+    /* Modification */
+    /**
+     * @brief Compute routes with a breadth first search per router and populate
+     * per-node forwarding tables, for point-to-point topologies with equal link
+     * metrics. The tables are the same as with BuildGlobalRoutingDatabase () and
+     * InitializeRoutes ().
+     * @param threads threads for the searches, 0 for one per core
+     * @returns false, without touching any table, if the topology does not qualify
+     */
+    static bool InitializeRoutesBfs(uint32_t threads = 0);
+    /* Modification */
 };
 
 } // namespace ns3
@@ -30,7 +30,10 @@
 #include "ns3/packet.h"
 #include "ns3/simulator.h"
 
+#include <algorithm>
+#include <functional>
 #include <iomanip>
+#include <map>
 #include <vector>
 
 /* Modification */
@@ -82,6 +85,10 @@ Ipv4GlobalRouting::Ipv4GlobalRouting()
     NS_LOG_FUNCTION(this);
 
     m_rand = CreateObject<UniformRandomVariable>();
+    /* Modification */
+    m_fibValid = false;
+    m_fibLinear = false;
+    /* Modification */
 }
 
 Ipv4GlobalRouting::~Ipv4GlobalRouting()
@@ -96,6 +103,9 @@ Ipv4GlobalRouting::AddHostRouteTo(Ipv4Address dest, Ipv4Address nextHop, uint32_
     Ipv4RoutingTableEntry* route = new Ipv4RoutingTableEntry();
     *route = Ipv4RoutingTableEntry::CreateHostRouteTo(dest, nextHop, interface);
     m_hostRoutes.push_back(route);
+    /* Modification */
+    InvalidateFib();
+    /* Modification */
 }
 
 void
@@ -105,6 +115,9 @@ Ipv4GlobalRouting::AddHostRouteTo(Ipv4Address dest, uint32_t interface)
     Ipv4RoutingTableEntry* route = new Ipv4RoutingTableEntry();
     *route = Ipv4RoutingTableEntry::CreateHostRouteTo(dest, interface);
     m_hostRoutes.push_back(route);
+    /* Modification */
+    InvalidateFib();
+    /* Modification */
 }
 
 void
@@ -117,6 +130,9 @@ Ipv4GlobalRouting::AddNetworkRouteTo(Ipv4Address network,
     Ipv4RoutingTableEntry* route = new Ipv4RoutingTableEntry();
     *route = Ipv4RoutingTableEntry::CreateNetworkRouteTo(network, networkMask, nextHop, interface);
     m_networkRoutes.push_back(route);
+    /* Modification */
+    InvalidateFib();
+    /* Modification */
 }
 
 void
@@ -126,6 +142,9 @@ Ipv4GlobalRouting::AddNetworkRouteTo(Ipv4Address network, Ipv4Mask networkMask,
     Ipv4RoutingTableEntry* route = new Ipv4RoutingTableEntry();
     *route = Ipv4RoutingTableEntry::CreateNetworkRouteTo(network, networkMask, interface);
     m_networkRoutes.push_back(route);
+    /* Modification */
+    InvalidateFib();
+    /* Modification */
 }
 
 void
@@ -138,6 +157,9 @@ Ipv4GlobalRouting::AddASExternalRouteTo(Ipv4Address network,
     Ipv4RoutingTableEntry* route = new Ipv4RoutingTableEntry();
     *route = Ipv4RoutingTableEntry::CreateNetworkRouteTo(network, networkMask, nextHop, interface);
     m_ASexternalRoutes.push_back(route);
+    /* Modification */
+    InvalidateFib();
+    /* Modification */
 }
 
 /* Modification */
@@ -202,6 +224,22 @@ Ipv4GlobalRouting::LookupGlobal(Ipv4Address dest, Ptr<NetDevice> oif)
 {
     NS_LOG_FUNCTION(this << dest << oif);
     NS_LOG_LOGIC("Looking for route for destination " << dest);
+    /* Modification */
+    if (!oif && CompileFib())
+    {
+        const FibGroup* group = LookupFib(dest);
+        if (!group)
+        {
+            return nullptr;
+        }
+        uint32_t selectIndex = 0;
+        if (m_randomEcmpRouting)
+        {
+            selectIndex = m_rand->GetInteger(0, group->end - group->begin - 1);
+        }
+        return GetFibRoute(m_fibIds[group->begin + selectIndex]);
+    }
+    /* Modification */
     Ptr<Ipv4Route> rtentry = nullptr;
     // store all available routes that bring packets to their destination
     typedef std::vector<Ipv4RoutingTableEntry*> RouteVec_t;
@@ -300,6 +338,14 @@ Ipv4GlobalRouting::LookupGlobal(Ipv4Address dest, Ptr<NetDevice> oif)
     }
 }
 
+/* Modification */
+Ptr<Ipv4Route>
+Ipv4GlobalRouting::LookupForward (const Ipv4Header &header, Ptr<const Packet> ipPayload)
+{
+  return LookupGlobal (header, ipPayload);
+}
+/* Modification */
+
 /* Modification */
 Ptr<Ipv4Route>
 Ipv4GlobalRouting::LookupGlobal (const Ipv4Header &header, Ptr<const Packet> ipPayload, Ptr<NetDevice> oif)
@@ -307,6 +353,29 @@ Ipv4GlobalRouting::LookupGlobal (const Ipv4Header &header, Ptr<const Packet> ipP
    NS_LOG_FUNCTION_NOARGS ();
   NS_ABORT_MSG_IF (m_randomEcmpRouting && m_flowEcmpRouting, "Ecmp mode selection");
   NS_LOG_LOGIC ("Looking for route for destination " << header.GetDestination());
+  if (!oif && CompileFib ())
+    {
+      const FibGroup *group = LookupFib (header.GetDestination ());
+      if (!group)
+        {
+          return nullptr;
+        }
+      uint32_t n = group->end - group->begin;
+      uint32_t selectIndex;
+      if (m_randomEcmpRouting)
+        {
+          selectIndex = m_rand->GetInteger (0, n - 1);
+        }
+      else if (m_flowEcmpRouting && n > 1)
+        {
+          selectIndex = GetTupleValue (header, ipPayload) % n;
+        }
+      else
+        {
+          selectIndex = 0;
+        }
+      return GetFibRoute (m_fibIds[group->begin + selectIndex]);
+    }
    Ptr<Ipv4Route> rtentry = 0;
    // store all available routes that bring packets to their destination
    typedef std::vector<Ipv4RoutingTableEntry*> RouteVec_t;
@@ -419,6 +488,167 @@ Ipv4GlobalRouting::LookupGlobal (const Ipv4Header &header, Ptr<const Packet> ipP
       return 0;
     }
 }
+
+void
+Ipv4GlobalRouting::InvalidateFib ()
+{
+  // the containers are empty while the table is invalid; clearing them again would cost
+  // the bucket count of the hashes on every route added in bulk
+  if (!m_fibValid)
+    {
+      return;
+    }
+  m_fibValid = false;
+  m_fibEntries.clear ();
+  m_fibRoutes.clear ();
+  m_fibIds.clear ();
+  m_fibHosts.clear ();
+  m_fibNetworks.clear ();
+  m_fibExternal.clear ();
+}
+
+bool
+Ipv4GlobalRouting::CompileFib ()
+{
+  if (m_fibValid)
+    {
+      return !m_fibLinear;
+    }
+  NS_LOG_FUNCTION (this);
+  m_fibValid = true;
+  m_fibLinear = false;
+  for (NetworkRoutesCI j = m_networkRoutes.begin (); j != m_networkRoutes.end () && !m_fibLinear; j++)
+    {
+      uint32_t mask = (*j)->GetDestNetworkMask ().Get ();
+      m_fibLinear = (~mask & (~mask + 1)) != 0;
+    }
+  for (ASExternalRoutesCI k = m_ASexternalRoutes.begin (); k != m_ASexternalRoutes.end () && !m_fibLinear; k++)
+    {
+      uint32_t mask = (*k)->GetDestNetworkMask ().Get ();
+      m_fibLinear = (~mask & (~mask + 1)) != 0;
+    }
+  if (m_fibLinear)
+    {
+      NS_LOG_LOGIC ("Non-contiguous network mask, no compiled forwarding table");
+      return false;
+    }
+
+  // route ids follow the order of the lists, which is the order LookupGlobal finds them in
+  m_fibEntries.reserve (GetNRoutes ());
+  m_fibEntries.insert (m_fibEntries.end (), m_hostRoutes.begin (), m_hostRoutes.end ());
+  m_fibEntries.insert (m_fibEntries.end (), m_networkRoutes.begin (), m_networkRoutes.end ());
+  m_fibEntries.insert (m_fibEntries.end (), m_ASexternalRoutes.begin (), m_ASexternalRoutes.end ());
+  m_fibRoutes.resize (m_fibEntries.size ());
+
+  uint32_t nHost = m_hostRoutes.size ();
+  uint32_t nNetwork = m_networkRoutes.size ();
+  std::unordered_map<uint32_t, std::vector<uint32_t> > hosts;
+  for (uint32_t id = 0; id < nHost; id++)
+    {
+      hosts[m_fibEntries[id]->GetDest ().Get ()].push_back (id);
+    }
+  for (auto &host : hosts)
+    {
+      FibGroup group;
+      group.begin = m_fibIds.size ();
+      m_fibIds.insert (m_fibIds.end (), host.second.begin (), host.second.end ());
+      group.end = m_fibIds.size ();
+      m_fibHosts[host.first] = group;
+    }
+  // all the matching network routes are candidates, but only the first external one
+  CompileFibLevels (nHost, nHost + nNetwork, false, m_fibNetworks);
+  CompileFibLevels (nHost + nNetwork, m_fibEntries.size (), true, m_fibExternal);
+  NS_LOG_LOGIC ("Compiled " << m_fibEntries.size () << " routes, " << m_fibNetworks.size ()
+                << " network and " << m_fibExternal.size () << " external prefix lengths");
+  return true;
+}
+
+void
+Ipv4GlobalRouting::CompileFibLevels (uint32_t first, uint32_t last, bool firstOnly, std::vector<FibLevel> &levels)
+{
+  // contiguous masks, so a larger mask is a longer prefix
+  std::map<uint32_t, std::unordered_map<uint32_t, std::vector<uint32_t> >, std::greater<uint32_t> > byMask;
+  for (uint32_t id = first; id < last; id++)
+    {
+      uint32_t mask = m_fibEntries[id]->GetDestNetworkMask ().Get ();
+      byMask[mask][m_fibEntries[id]->GetDestNetwork ().Get () & mask].push_back (id);
+    }
+  for (auto &level : byMask)
+    {
+      FibLevel fib;
+      fib.mask = level.first;
+      for (auto &prefix : level.second)
+        {
+          // a destination in this prefix also matches the shorter prefixes that contain it
+          std::vector<uint32_t> ids;
+          for (auto &shorter : byMask)
+            {
+              if (shorter.first > level.first)
+                {
+                  continue;
+                }
+              auto found = shorter.second.find (prefix.first & shorter.first);
+              if (found != shorter.second.end ())
+                {
+                  ids.insert (ids.end (), found->second.begin (), found->second.end ());
+                }
+            }
+          std::sort (ids.begin (), ids.end ());
+          if (firstOnly)
+            {
+              ids.resize (1);
+            }
+          FibGroup group;
+          group.begin = m_fibIds.size ();
+          m_fibIds.insert (m_fibIds.end (), ids.begin (), ids.end ());
+          group.end = m_fibIds.size ();
+          fib.groups[prefix.first] = group;
+        }
+      levels.push_back (std::move (fib));
+    }
+}
+
+const Ipv4GlobalRouting::FibGroup *
+Ipv4GlobalRouting::LookupFib (Ipv4Address dest) const
+{
+  uint32_t addr = dest.Get ();
+  auto host = m_fibHosts.find (addr);
+  if (host != m_fibHosts.end ())
+    {
+      return &host->second;
+    }
+  const std::vector<FibLevel> *tables[] = {&m_fibNetworks, &m_fibExternal};
+  for (const std::vector<FibLevel> *levels : tables)
+    {
+      for (const FibLevel &level : *levels)
+        {
+          auto group = level.groups.find (addr & level.mask);
+          if (group != level.groups.end ())
+            {
+              return &group->second;
+            }
+        }
+    }
+  return nullptr;
+}
+
+// The route of an entry does not change until the table is invalidated, and nothing
+// downstream modifies a route returned by the routing protocol, so it is shared.
+Ptr<Ipv4Route>
+Ipv4GlobalRouting::GetFibRoute (uint32_t id)
+{
+  Ptr<Ipv4Route> &rtentry = m_fibRoutes[id];
+  if (!rtentry)
+    {
+      Ipv4RoutingTableEntry *route = m_fibEntries[id];
+      rtentry = Create<Ipv4Route> ();
+      rtentry->SetDestination (route->GetDest ());
+      rtentry->SetSource (m_ipv4->GetAddress (route->GetInterface (), 0).GetLocal ());
+      rtentry->SetGateway (route->GetGateway ());
+      rtentry->SetOutputDevice (m_ipv4->GetNetDevice (route->GetInterface ()));
+    }
+  return rtentry;
+}
 /* Modification */
 
 uint32_t
@@ -480,6 +710,9 @@ void
 Ipv4GlobalRouting::RemoveRoute(uint32_t index)
 {
     NS_LOG_FUNCTION(this << index);
+    /* Modification */
+    InvalidateFib();
+    /* Modification */
     if (index < m_hostRoutes.size())
     {
         uint32_t tmp = 0;
@@ -542,6 +775,9 @@ void
 Ipv4GlobalRouting::DoDispose()
 {
     NS_LOG_FUNCTION(this);
+    /* Modification */
+    InvalidateFib();
+    /* Modification */
     for (HostRoutesI i = m_hostRoutes.begin(); i != m_hostRoutes.end(); i = m_hostRoutes.erase(i))
     {
         delete (*i);
@@ -728,6 +964,9 @@ void
 Ipv4GlobalRouting::NotifyInterfaceUp(uint32_t i)
 {
     NS_LOG_FUNCTION(this << i);
+    /* Modification */
+    InvalidateFib();
+    /* Modification */
     if (m_respondToInterfaceEvents && Simulator::Now().GetSeconds() > 0) // avoid startup events
     {
         GlobalRouteManager::DeleteGlobalRoutes();
@@ -740,6 +979,9 @@ void
 Ipv4GlobalRouting::NotifyInterfaceDown(uint32_t i)
 {
     NS_LOG_FUNCTION(this << i);
+    /* Modification */
+    InvalidateFib();
+    /* Modification */
     if (m_respondToInterfaceEvents && Simulator::Now().GetSeconds() > 0) // avoid startup events
     {
         GlobalRouteManager::DeleteGlobalRoutes();
@@ -752,6 +994,9 @@ void
 Ipv4GlobalRouting::NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address)
 {
     NS_LOG_FUNCTION(this << interface << address);
+    /* Modification */
+    InvalidateFib();
+    /* Modification */
     if (m_respondToInterfaceEvents && Simulator::Now().GetSeconds() > 0) // avoid startup events
     {
         GlobalRouteManager::DeleteGlobalRoutes();
@@ -764,6 +1009,9 @@ void
 Ipv4GlobalRouting::NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address)
 {
     NS_LOG_FUNCTION(this << interface << address);
+    /* Modification */
+    InvalidateFib();
+    /* Modification */
     if (m_respondToInterfaceEvents && Simulator::Now().GetSeconds() > 0) // avoid startup events
     {
         GlobalRouteManager::DeleteGlobalRoutes();
@@ -778,6 +1026,9 @@ Ipv4GlobalRouting::SetIpv4(Ptr<Ipv4> ipv4)
     NS_LOG_FUNCTION(this << ipv4);
     NS_ASSERT(!m_ipv4 && ipv4);
     m_ipv4 = ipv4;
+    /* Modification */
+    InvalidateFib();
+    /* Modification */
 }
 
 } // namespace ns3
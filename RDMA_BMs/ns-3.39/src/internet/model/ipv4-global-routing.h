@@ -28,6 +28,8 @@
 
 #include <list>
 #include <stdint.h>
+#include <unordered_map>
+#include <vector>
 
 namespace ns3
 {
@@ -107,6 +109,16 @@ class Ipv4GlobalRouting : public Ipv4RoutingProtocol
     void SetIpv4(Ptr<Ipv4> ipv4) override;
     void PrintRoutingTable(Ptr<OutputStreamWrapper> stream,
                            Time::Unit unit = Time::S) const override;
+    /* Modification */
+    /**
+     * \brief The route RouteInput forwards a packet on, without its local delivery checks.
+     *
+     * \param header the IPv4 header of the packet
+     * \param ipPayload the packet without the IPv4 header
+     * \return the route, 0 if there is none
+     */
+    Ptr<Ipv4Route> LookupForward (const Ipv4Header &header, Ptr<const Packet> ipPayload);
+    /* Modification */
 
     /**
      * \brief Add a host route to the global routing table.
@@ -276,6 +288,34 @@ class Ipv4GlobalRouting : public Ipv4RoutingProtocol
     uint32_t GetTupleValue (const Ipv4Header &header, Ptr<const Packet> ipPayload);
     Ptr<Ipv4Route> LookupGlobal (const Ipv4Header &header, Ptr<const Packet> ipPayload, Ptr<NetDevice> oif = 0);
     bool m_flowEcmpRouting;
+
+    // Compiled forwarding table: LookupGlobal without an output interface finds the same
+    // routes as the scan of the three lists, with one hash lookup per prefix length in use.
+    // It is rebuilt on the first lookup after the routes or the interfaces change.
+    struct FibGroup
+    {
+      uint32_t begin; //!< first index in m_fibIds
+      uint32_t end;
+    };
+    struct FibLevel
+    {
+      uint32_t mask;
+      std::unordered_map<uint32_t, FibGroup> groups; //!< by network address
+    };
+    void InvalidateFib ();
+    bool CompileFib ();
+    void CompileFibLevels (uint32_t first, uint32_t last, bool firstOnly, std::vector<FibLevel> &levels);
+    const FibGroup *LookupFib (Ipv4Address dest) const;
+    Ptr<Ipv4Route> GetFibRoute (uint32_t id);
+
+    bool m_fibValid;
+    bool m_fibLinear; //!< non-contiguous masks, lookups scan the lists
+    std::vector<Ipv4RoutingTableEntry *> m_fibEntries; //!< host, network then external routes
+    std::vector<Ptr<Ipv4Route> > m_fibRoutes; //!< created on first use
+    std::vector<uint32_t> m_fibIds; //!< route ids of the groups, in list order
+    std::unordered_map<uint32_t, FibGroup> m_fibHosts;
+    std::vector<FibLevel> m_fibNetworks; //!< longest prefix first
+    std::vector<FibLevel> m_fibExternal;
     /* Modification */
 
     HostRoutes m_hostRoutes;             //!< Routes to hosts
@@ -172,7 +172,15 @@ TcpRxBuffer::Add(Ptr<Packet> p, const TcpHeader& tcph)
         }
     }
     // Remove overlapped bytes from packet
-    BufIterator i = m_data.begin();
+    /* Modification */
+    // The stored packets do not overlap, so the ones before the last packet starting at
+    // or before headSeq also end before it
+    BufIterator i = m_data.upper_bound(headSeq);
+    if (i != m_data.begin())
+    {
+        --i;
+    }
+    /* Modification */
     while (i != m_data.end() && i->first <= tailSeq)
     {
         SequenceNumber32 lastByteSeq = i->first + SequenceNumber32(i->second->GetSize());
@@ -221,13 +229,11 @@ TcpRxBuffer::Add(Ptr<Packet> p, const TcpHeader& tcph)
     NS_LOG_LOGIC("Buffered packet of seqno=" << headSeq << " len=" << p->GetSize());
     // Update variables
     m_size += p->GetSize(); // Occupancy
-    for (i = m_data.begin(); i != m_data.end(); ++i)
+    /* Modification */
+    for (i = m_data.lower_bound(m_nextRxSeq); i != m_data.end(); ++i)
+    /* Modification */
     {
-        if (i->first < m_nextRxSeq)
-        {
-            continue;
-        }
-        else if (i->first > m_nextRxSeq)
+        if (i->first > m_nextRxSeq)
         {
             break;
         };
@@ -0,0 +1,175 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "tcp-switch-node.h"
+
+#include "ipv4-global-routing.h"
+#include "ipv4-interface.h"
+#include "ipv4-l3-protocol.h"
+#include "ipv4-queue-disc-item.h"
+#include "loopback-net-device.h"
+
+#include "ns3/log.h"
+#include "ns3/net-device-queue-interface.h"
+#include "ns3/queue-disc.h"
+#include "ns3/socket.h"
+#include "ns3/traffic-control-layer.h"
+
+#include <limits>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("TcpSwitchNode");
+
+NS_OBJECT_ENSURE_REGISTERED(TcpSwitchNode);
+
+TypeId
+TcpSwitchNode::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::TcpSwitchNode")
+                            .SetParent<Node>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<TcpSwitchNode>();
+    return tid;
+}
+
+TcpSwitchNode::TcpSwitchNode()
+    : m_minMtu(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+TcpSwitchNode::~TcpSwitchNode()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+TcpSwitchNode::DoInitialize()
+{
+    NS_LOG_FUNCTION(this);
+    m_ipv4 = GetObject<Ipv4L3Protocol>();
+    m_tc = GetObject<TrafficControlLayer>();
+    if (m_ipv4)
+    {
+        m_routing = DynamicCast<Ipv4GlobalRouting>(m_ipv4->GetRoutingProtocol());
+    }
+    if (m_routing && m_tc && !ChecksumEnabled())
+    {
+        m_ports.assign(GetNDevices(), Port());
+        m_minMtu = std::numeric_limits<uint32_t>::max();
+        for (uint32_t i = 0; i < m_ipv4->GetNInterfaces(); i++)
+        {
+            Ptr<Ipv4Interface> interface = m_ipv4->GetInterface(i);
+            Ptr<NetDevice> device = interface->GetDevice();
+            for (uint32_t j = 0; j < interface->GetNAddresses(); j++)
+            {
+                m_local.insert(interface->GetAddress(j).GetLocal().Get());
+                m_local.insert(interface->GetAddress(j).GetBroadcast().Get());
+            }
+            if (DynamicCast<LoopbackNetDevice>(device))
+            {
+                continue;
+            }
+            m_minMtu = std::min(m_minMtu, uint32_t(device->GetMtu()));
+            Port& port = m_ports[device->GetIfIndex()];
+            port.interface = interface;
+            Ptr<NetDeviceQueueInterface> ndqi = device->GetObject<NetDeviceQueueInterface>();
+            port.direct = !device->NeedsArp() && (!ndqi || ndqi->GetNTxQueues() == 1);
+            if (port.direct)
+            {
+                port.queueDisc = m_tc->GetRootQueueDiscOnDevice(device);
+                port.broadcast = device->GetBroadcast();
+                device->SetReceiveCallback(MakeCallback(&TcpSwitchNode::ReceiveFromDevice, this));
+            }
+        }
+    }
+    Node::DoInitialize();
+}
+
+void
+TcpSwitchNode::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_ports.clear();
+    m_local.clear();
+    m_ipv4 = nullptr;
+    m_routing = nullptr;
+    m_tc = nullptr;
+    Node::DoDispose();
+}
+
+// What Ipv4L3Protocol::Receive, Ipv4GlobalRouting::RouteInput, Ipv4L3Protocol::IpForward,
+// SendRealOut, Ipv4Interface::Send and TrafficControlLayer::Send do with a unicast packet
+// to forward. Everything else goes to the stack before the route lookup, so that a random
+// ECMP choice is drawn once.
+bool
+TcpSwitchNode::ReceiveFromDevice(Ptr<NetDevice> device,
+                                 Ptr<const Packet> p,
+                                 uint16_t protocol,
+                                 const Address& from)
+{
+    NS_LOG_FUNCTION(this << device << p << protocol << from);
+    const Port& in = m_ports[device->GetIfIndex()];
+    if (protocol != Ipv4L3Protocol::PROT_NUMBER || p->GetSize() > m_minMtu ||
+        !in.interface->IsUp() || !in.interface->IsForwarding())
+    {
+        return NonPromiscReceiveFromDevice(device, p, protocol, from);
+    }
+
+    Ptr<Packet> packet = p->Copy();
+    Ipv4Header header;
+    packet->RemoveHeader(header);
+    Ipv4Address dest = header.GetDestination();
+    if (header.GetTtl() <= 1 || dest.IsMulticast() || dest.IsBroadcast() ||
+        m_local.count(dest.Get()))
+    {
+        return NonPromiscReceiveFromDevice(device, p, protocol, from);
+    }
+    if (header.GetPayloadSize() < packet->GetSize())
+    {
+        packet->RemoveAtEnd(packet->GetSize() - header.GetPayloadSize());
+    }
+    Ptr<Ipv4Route> route = m_routing->LookupForward(header, packet);
+    if (!route)
+    {
+        return NonPromiscReceiveFromDevice(device, p, protocol, from);
+    }
+
+    header.SetTtl(header.GetTtl() - 1);
+    SocketPriorityTag priorityTag;
+    packet->RemovePacketTag(priorityTag);
+    uint8_t priority = Socket::IpTos2Priority(header.GetTos());
+    if (priority)
+    {
+        priorityTag.SetPriority(priority);
+        packet->AddPacketTag(priorityTag);
+    }
+
+    Ptr<NetDevice> outDevice = route->GetOutputDevice();
+    const Port& out = m_ports[outDevice->GetIfIndex()];
+    if (!out.interface->IsUp())
+    {
+        return true;
+    }
+    if (!out.direct)
+    {
+        out.interface->Send(packet,
+                            header,
+                            route->GetGateway().IsAny() ? dest : route->GetGateway());
+        return true;
+    }
+    Ptr<Ipv4QueueDiscItem> item =
+        Create<Ipv4QueueDiscItem>(packet, out.broadcast, Ipv4L3Protocol::PROT_NUMBER, header);
+    if (out.queueDisc)
+    {
+        out.queueDisc->Enqueue(item);
+        out.queueDisc->Run();
+    }
+    else
+    {
+        m_tc->Send(outDevice, item);
+    }
+    return true;
+}
+
+} // namespace ns3
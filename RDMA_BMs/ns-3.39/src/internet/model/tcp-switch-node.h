@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef TCP_SWITCH_NODE_H
+#define TCP_SWITCH_NODE_H
+
+#include "ns3/address.h"
+#include "ns3/node.h"
+
+#include <stdint.h>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup internet
+ * ns3::TcpSwitchNode declaration.
+ */
+
+namespace ns3
+{
+
+class Ipv4GlobalRouting;
+class Ipv4Interface;
+class Ipv4L3Protocol;
+class QueueDisc;
+class TrafficControlLayer;
+
+/**
+ * \ingroup internet
+ * \brief A switch of the TCP experiments that forwards IPv4 packets without the host stack.
+ *
+ * The counterpart of the RDMA SwitchNode for the leaves and spines of the examples
+ * built with an internet stack, Ipv4GlobalRouting and traffic-control queue discs. At
+ * initialization the node takes over the receive callback of its point-to-point style
+ * devices (no ARP, one tx queue). A unicast packet for another node then skips the
+ * protocol handlers, Ipv4L3Protocol and the TrafficControlLayer: the route comes from
+ * Ipv4GlobalRouting::LookupForward, i.e. the compiled table and the same ECMP choice,
+ * the TTL is decremented in the header, and the packet goes straight into the root
+ * queue disc of the output device (the buffer admission of GenQueueDisc, ECN marks on
+ * the header of the Ipv4QueueDiscItem) or, without one, to the device.
+ *
+ * Packets for the node itself, broadcast and multicast packets, packets whose TTL
+ * expires, packets larger than the smallest MTU, packets without a route and packets
+ * from a down or non-forwarding interface go through the stack as on a Node, so the
+ * forwarding decisions and drops are the same. The Ipv4L3Protocol Rx, UnicastForward
+ * and Tx traces do not fire for the packets of the fast path (a FlowMonitor sees no
+ * forwarding on the switches; the host side statistics are unchanged). The ports and
+ * their queue discs are taken at initialization. Without Ipv4GlobalRouting as the
+ * routing protocol, or with checksums enabled, the node behaves as a Node.
+ */
+class TcpSwitchNode : public Node
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    TcpSwitchNode();
+    ~TcpSwitchNode() override;
+
+  protected:
+    void DoInitialize() override;
+    void DoDispose() override;
+
+  private:
+    /// An IPv4 device of the switch
+    struct Port
+    {
+        Ptr<Ipv4Interface> interface;
+        Ptr<QueueDisc> queueDisc; //!< root queue disc of the device, 0 if none
+        Address broadcast;
+        bool direct = false; //!< packets are received and sent without the stack
+    };
+
+    bool ReceiveFromDevice(Ptr<NetDevice> device,
+                           Ptr<const Packet> p,
+                           uint16_t protocol,
+                           const Address& from);
+
+    Ptr<Ipv4L3Protocol> m_ipv4;
+    Ptr<Ipv4GlobalRouting> m_routing;
+    Ptr<TrafficControlLayer> m_tc;
+    std::vector<Port> m_ports;            //!< by device index
+    std::unordered_set<uint32_t> m_local; //!< addresses and broadcast addresses of the interfaces
+    uint32_t m_minMtu;
+};
+
+} // namespace ns3
+
+#endif /* TCP_SWITCH_NODE_H */
@@ -61,7 +61,10 @@ TcpTxBuffer::TcpTxBuffer(uint32_t n)
     : m_maxBuffer(32768),
       m_size(0),
       m_sentSize(0),
-      m_firstByteSeq(n)
+      m_firstByteSeq(n),
+      /* Modification */
+      m_lostMarkedSeq(n)
+      /* Modification */
 {
     m_rWndCallback = MakeNullCallback<uint32_t>();
 }
@@ -177,6 +180,9 @@ TcpTxBuffer::SetHeadSequence(const SequenceNumber32& seq)
     // if you change the head with data already sent, something bad will happen
     NS_ASSERT(m_sentList.empty());
     m_highestSack = std::make_pair(m_sentList.end(), SequenceNumber32(0));
+    /* Modification */
+    m_lostMarkedSeq = seq;
+    /* Modification */
 }
 
 bool
@@ -652,10 +658,23 @@ bool
 TcpTxBuffer::IsRetransmittedDataAcked(const SequenceNumber32& ack) const
 {
     NS_LOG_FUNCTION(this);
+    /* Modification */
+    if (m_retrans == 0)
+    {
+        return false;
+    }
+    /* Modification */
     for (const auto& it : m_sentList)
     {
         TcpTxItem* item = it;
         Ptr<Packet> p = item->m_packet;
+        /* Modification */
+        // The sent list is in sequence order: nothing from here on ends at ack
+        if (item->m_startSeq >= ack)
+        {
+            break;
+        }
+        /* Modification */
         if (item->m_startSeq + p->GetSize() == ack && !item->m_sacked && item->m_retrans)
         {
             return true;
@@ -771,6 +790,12 @@ TcpTxBuffer::DiscardUpTo(const SequenceNumber32& seq, const Callback<void, TcpTx
     {
         m_highestSack = std::make_pair(m_sentList.end(), SequenceNumber32(0));
     }
+    /* Modification */
+    if (m_lostMarkedSeq < m_firstByteSeq)
+    {
+        m_lostMarkedSeq = m_firstByteSeq;
+    }
+    /* Modification */
 
     NS_LOG_DEBUG("Discarded up to " << seq << " lost: " << m_lostOut << " retrans: " << m_retrans
                                     << " sacked: " << m_sackedOut);
@@ -790,7 +815,9 @@ TcpTxBuffer::Update(const TcpOptionSack::SackList& list, const Callback<void, Tc
 
     for (auto option_it = list.begin(); option_it != list.end(); ++option_it)
     {
-        PacketList::iterator item_it = m_sentList.begin();
+        /* Modification */
+        PacketList::const_iterator item_it = m_sentList.begin();
+        /* Modification */
         SequenceNumber32 beginOfCurrentPacket = m_firstByteSeq;
 
         if (m_firstByteSeq + m_sentSize < (*option_it).first)
@@ -799,6 +826,16 @@ TcpTxBuffer::Update(const TcpOptionSack::SackList& list, const Callback<void, Tc
             return bytesSacked;
         }
 
+        /* Modification */
+        // The items before the highest sacked one end before a block that starts above it,
+        // which is the usual case of the newest block: skip them
+        if (m_highestSack.first != m_sentList.end() && (*option_it).first >= m_highestSack.second)
+        {
+            item_it = m_highestSack.first;
+            beginOfCurrentPacket = m_highestSack.second;
+        }
+        /* Modification */
+
         while (item_it != m_sentList.end())
         {
             uint32_t pktSize = (*item_it)->m_packet->GetSize();
@@ -891,6 +928,9 @@ TcpTxBuffer::UpdateLostCount()
                                                  << *(*m_highestSack.first));
     }
 
+    /* Modification */
+    SequenceNumber32 lostMarked = m_lostMarkedSeq;
+    /* Modification */
     for (auto it = m_highestSack.first; it != m_sentList.begin(); --it)
     {
         TcpTxItem* item = *it;
@@ -901,6 +941,18 @@ TcpTxBuffer::UpdateLostCount()
 
         if (sacked >= m_dupAckThresh)
         {
+            /* Modification */
+            // From here down every item ends up sacked or lost. The ones below
+            // lostMarked already are, so the rest of the walk changes nothing.
+            if (item->m_startSeq < lostMarked)
+            {
+                break;
+            }
+            if (m_lostMarkedSeq < item->m_startSeq + item->m_packet->GetSize())
+            {
+                m_lostMarkedSeq = item->m_startSeq + item->m_packet->GetSize();
+            }
+            /* Modification */
             if (!item->m_sacked && !item->m_lost)
             {
                 item->m_lost = true;
@@ -988,6 +1040,14 @@ TcpTxBuffer::NextSeg(SequenceNumber32* seq, SequenceNumber32* seqHigh, bool isRe
 
     for (it = m_sentList.begin(); it != m_sentList.end(); ++it)
     {
+        /* Modification */
+        // Without lost items rule (1) cannot apply, and rule (3) takes the first candidate:
+        // a sender that is not recovering does not walk the window for every segment
+        if (m_lostOut == 0 && (!isRecovery || seqPerRule3.GetValue() != 0))
+        {
+            break;
+        }
+        /* Modification */
         item = *it;
 
         // Condition 1.a , 1.b , and 1.c
@@ -1226,6 +1286,9 @@ TcpTxBuffer::ResetRenoSack()
     }
 
     m_highestSack = std::make_pair(m_sentList.end(), SequenceNumber32(0));
+    /* Modification */
+    m_lostMarkedSeq = m_firstByteSeq;
+    /* Modification */
 }
 
 void
@@ -1255,6 +1318,9 @@ TcpTxBuffer::ResetSentList()
     m_retrans = 0;
     m_sackedOut = 0;
     m_highestSack = std::make_pair(m_sentList.end(), SequenceNumber32(0));
+    /* Modification */
+    m_lostMarkedSeq = m_firstByteSeq;
+    /* Modification */
 }
 
 void
@@ -1272,6 +1338,12 @@ TcpTxBuffer::ResetLastSegmentSent()
             m_retrans -= item->m_packet->GetSize();
         }
         m_appList.insert(m_appList.begin(), item);
+        /* Modification */
+        if (item->m_startSeq < m_lostMarkedSeq)
+        {
+            m_lostMarkedSeq = item->m_startSeq;
+        }
+        /* Modification */
     }
     ConsistencyCheck();
 }
@@ -612,6 +612,11 @@ class TcpTxBuffer : public Object
         m_firstByteSeq; //!< Sequence number of the first byte in data (SND.UNA)
     std::pair<PacketList::const_iterator, SequenceNumber32> m_highestSack; //!< Highest SACK byte
 
+    /* Modification */
+    /// Every sent item that starts before it is sacked or lost; UpdateLostCount stops there
+    SequenceNumber32 m_lostMarkedSeq;
+    /* Modification */
+
     uint32_t m_lostOut{0};   //!< Number of lost bytes
     uint32_t m_sackedOut{0}; //!< Number of sacked bytes
     uint32_t m_retrans{0};   //!< Number of retransmitted bytes
@@ -16,6 +16,8 @@
 #include "ns3/boolean.h"
 #include "ns3/bridge-helper.h"
 #include "ns3/config.h"
+#include "ns3/global-route-manager.h"
+#include "ns3/global-router-interface.h"
 #include "ns3/inet-socket-address.h"
 #include "ns3/internet-stack-helper.h"
 #include "ns3/ipv4-address-helper.h"
@@ -28,7 +30,9 @@
 #include "ns3/ipv4-static-routing-helper.h"
 #include "ns3/log.h"
 #include "ns3/node-container.h"
+#include "ns3/node-list.h"
 #include "ns3/node.h"
+#include "ns3/output-stream-wrapper.h"
 #include "ns3/packet.h"
 #include "ns3/pointer.h"
 #include "ns3/simple-channel.h"
@@ -1313,6 +1317,272 @@ Ipv4GlobalRoutingSlash32TestCase::DoRun()
     Simulator::Destroy();
 }
 
+/**
+ * \ingroup internet-test
+ *
+ * \brief IPv4 GlobalRouting compiled forwarding table test
+ *
+ * Overlapping network routes, a host route and external routes: the lookups must
+ * find the routes of the scan of the route lists, before and after the routes change.
+ */
+class Ipv4GlobalRoutingCompiledFibTestCase : public TestCase
+{
+  public:
+    Ipv4GlobalRoutingCompiledFibTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * \brief Route a packet to dest.
+     * \param dest destination address
+     * \param oif output device, or nullptr for the compiled table
+     * \return the route, nullptr if none
+     */
+    Ptr<Ipv4Route> Lookup(std::string dest, Ptr<NetDevice> oif = nullptr);
+
+    Ptr<Ipv4GlobalRouting> m_routing; //!< routing under test
+};
+
+Ipv4GlobalRoutingCompiledFibTestCase::Ipv4GlobalRoutingCompiledFibTestCase()
+    : TestCase("Compiled forwarding table of global routing")
+{
+}
+
+Ptr<Ipv4Route>
+Ipv4GlobalRoutingCompiledFibTestCase::Lookup(std::string dest, Ptr<NetDevice> oif)
+{
+    Ipv4Header header;
+    header.SetDestination(Ipv4Address(dest.c_str()));
+    header.SetProtocol(17);
+    Socket::SocketErrno sockerr;
+    Ptr<Ipv4Route> route = m_routing->RouteOutput(Create<Packet>(), header, oif, sockerr);
+    NS_TEST_EXPECT_MSG_EQ((sockerr == Socket::ERROR_NOTERROR),
+                          bool(route),
+                          "Wrong socket error for " << dest);
+    return route;
+}
+
+void
+Ipv4GlobalRoutingCompiledFibTestCase::DoRun()
+{
+    Ptr<Node> node = CreateObject<Node>();
+    InternetStackHelper internet;
+    internet.Install(node);
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+    for (uint32_t i = 1; i <= 3; i++)
+    {
+        Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice>();
+        device->SetAddress(Mac48Address::Allocate());
+        node->AddDevice(device);
+        int32_t ifIndex = ipv4->AddInterface(device);
+        std::ostringstream addr;
+        addr << "10.0." << i << ".1";
+        ipv4->AddAddress(ifIndex,
+                         Ipv4InterfaceAddress(Ipv4Address(addr.str().c_str()), Ipv4Mask("/24")));
+        ipv4->SetUp(ifIndex);
+    }
+
+    m_routing = CreateObject<Ipv4GlobalRouting>();
+    m_routing->SetIpv4(ipv4);
+    m_routing->AddHostRouteTo(Ipv4Address("10.1.2.3"), Ipv4Address("10.0.3.2"), 3);
+    m_routing->AddNetworkRouteTo(Ipv4Address("10.1.0.0"),
+                                 Ipv4Mask("/16"),
+                                 Ipv4Address("10.0.1.2"),
+                                 1);
+    m_routing->AddNetworkRouteTo(Ipv4Address("10.1.2.0"),
+                                 Ipv4Mask("/24"),
+                                 Ipv4Address("10.0.2.2"),
+                                 2);
+    m_routing->AddNetworkRouteTo(Ipv4Address("10.0.0.0"),
+                                 Ipv4Mask("/8"),
+                                 Ipv4Address("10.0.3.2"),
+                                 3);
+    m_routing->AddASExternalRouteTo(Ipv4Address("192.168.0.0"),
+                                    Ipv4Mask("/16"),
+                                    Ipv4Address("10.0.2.2"),
+                                    2);
+    m_routing->AddASExternalRouteTo(Ipv4Address("192.168.1.0"),
+                                    Ipv4Mask("/24"),
+                                    Ipv4Address("10.0.1.2"),
+                                    1);
+
+    // host route first, then the first of all the matching network routes (not the longest
+    // prefix), then the first matching external route
+    const char* dests[] = {"10.1.2.3", "10.1.2.4", "10.1.9.9", "10.9.0.1", "192.168.1.1"};
+    const char* gateways[] = {"10.0.3.2", "10.0.1.2", "10.0.1.2", "10.0.3.2", "10.0.2.2"};
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        Ptr<Ipv4Route> route = Lookup(dests[i]);
+        NS_TEST_ASSERT_MSG_NE(route, nullptr, "No route to " << dests[i]);
+        NS_TEST_EXPECT_MSG_EQ(route->GetGateway(),
+                              Ipv4Address(gateways[i]),
+                              "Wrong gateway to " << dests[i]);
+        uint32_t interface = ipv4->GetInterfaceForDevice(route->GetOutputDevice());
+        NS_TEST_EXPECT_MSG_EQ(route->GetSource(),
+                              ipv4->GetAddress(interface, 0).GetLocal(),
+                              "Wrong source to " << dests[i]);
+        // the scan of the lists, restricted to the output device, finds the same route
+        Ptr<Ipv4Route> linear = Lookup(dests[i], route->GetOutputDevice());
+        NS_TEST_ASSERT_MSG_NE(linear, nullptr, "No linear route to " << dests[i]);
+        NS_TEST_EXPECT_MSG_EQ(linear->GetGateway(),
+                              route->GetGateway(),
+                              "Linear lookup disagrees for " << dests[i]);
+    }
+    NS_TEST_EXPECT_MSG_EQ(Lookup("172.16.0.1"), nullptr, "Unexpected route to 172.16.0.1");
+
+    // removing the host route and adding a route recompile the table
+    m_routing->RemoveRoute(0);
+    NS_TEST_EXPECT_MSG_EQ(Lookup("10.1.2.3")->GetGateway(),
+                          Ipv4Address("10.0.1.2"),
+                          "Host route still used after removal");
+    m_routing->AddNetworkRouteTo(Ipv4Address("172.16.0.0"),
+                                 Ipv4Mask("/12"),
+                                 Ipv4Address("10.0.2.2"),
+                                 2);
+    Ptr<Ipv4Route> route = Lookup("172.16.0.1");
+    NS_TEST_ASSERT_MSG_NE(route, nullptr, "No route to 172.16.0.1 after adding it");
+    NS_TEST_EXPECT_MSG_EQ(route->GetGateway(), Ipv4Address("10.0.2.2"), "Wrong added route");
+
+    // a non-contiguous mask falls back to the scan of the lists
+    m_routing->AddNetworkRouteTo(Ipv4Address("192.0.0.5"),
+                                 Ipv4Mask("255.255.0.255"),
+                                 Ipv4Address("10.0.3.2"),
+                                 3);
+    route = Lookup("192.0.7.5");
+    NS_TEST_ASSERT_MSG_NE(route, nullptr, "No route with a non-contiguous mask");
+    NS_TEST_EXPECT_MSG_EQ(route->GetGateway(),
+                          Ipv4Address("10.0.3.2"),
+                          "Wrong route with a non-contiguous mask");
+    NS_TEST_EXPECT_MSG_EQ(Lookup("192.0.7.6"), nullptr, "Unexpected route to 192.0.7.6");
+    NS_TEST_EXPECT_MSG_EQ(Lookup("10.1.2.4")->GetGateway(),
+                          Ipv4Address("10.0.1.2"),
+                          "Wrong route with a non-contiguous mask in the table");
+
+    m_routing->Dispose();
+    m_routing = nullptr;
+    Simulator::Destroy();
+}
+
+/**
+ * \ingroup internet-test
+ *
+ * \brief IPv4 GlobalRouting BFS route computation test
+ *
+ * On a k=4 fat-tree of point-to-point links, with a parallel link and a
+ * dual-homed host for unequal ECMP fan-outs, GlobalRouteManager::InitializeRoutesBfs
+ * must give the same routing tables, route by route, as the LSDB and SPF calculation.
+ */
+class Ipv4GlobalRoutingBfsTestCase : public TestCase
+{
+  public:
+    Ipv4GlobalRoutingBfsTestCase();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * \brief Print the global routing tables of all the nodes.
+     * \return the tables
+     */
+    std::string DumpTables();
+};
+
+Ipv4GlobalRoutingBfsTestCase::Ipv4GlobalRoutingBfsTestCase()
+    : TestCase("BFS global routing gives the SPF routing tables")
+{
+}
+
+std::string
+Ipv4GlobalRoutingBfsTestCase::DumpTables()
+{
+    std::ostringstream os;
+    Ptr<OutputStreamWrapper> stream = Create<OutputStreamWrapper>(&os);
+    for (uint32_t i = 0; i < NodeList::GetNNodes(); i++)
+    {
+        Ptr<GlobalRouter> router = NodeList::GetNode(i)->GetObject<GlobalRouter>();
+        router->GetRoutingProtocol()->PrintRoutingTable(stream);
+    }
+    return os.str();
+}
+
+void
+Ipv4GlobalRoutingBfsTestCase::DoRun()
+{
+    const uint32_t k = 4;
+    NodeContainer hosts;
+    NodeContainer edges;
+    NodeContainer aggs;
+    NodeContainer cores;
+    hosts.Create(k * k * k / 4);
+    edges.Create(k * k / 2);
+    aggs.Create(k * k / 2);
+    cores.Create(k * k / 4);
+    InternetStackHelper internet;
+    internet.Install(hosts);
+    internet.Install(edges);
+    internet.Install(aggs);
+    internet.Install(cores);
+
+    SimpleNetDeviceHelper devHelper;
+    devHelper.SetNetDevicePointToPointMode(true);
+    Ipv4AddressHelper ipv4;
+    ipv4.SetBase("10.0.0.0", "255.255.255.252");
+    std::vector<NetDeviceContainer> links;
+    auto connect = [&](Ptr<Node> a, Ptr<Node> b) {
+        links.push_back(devHelper.Install(NodeContainer(a, b)));
+        ipv4.Assign(links.back());
+        ipv4.NewNetwork();
+    };
+    for (uint32_t h = 0; h < hosts.GetN(); h++)
+    {
+        connect(hosts.Get(h), edges.Get(h / (k / 2)));
+    }
+    for (uint32_t e = 0; e < edges.GetN(); e++)
+    {
+        for (uint32_t a = 0; a < k / 2; a++)
+        {
+            connect(edges.Get(e), aggs.Get(e / (k / 2) * (k / 2) + a));
+        }
+    }
+    for (uint32_t a = 0; a < aggs.GetN(); a++)
+    {
+        for (uint32_t c = 0; c < k / 2; c++)
+        {
+            connect(aggs.Get(a), cores.Get(a % (k / 2) * (k / 2) + c));
+        }
+    }
+    connect(edges.Get(0), aggs.Get(0));
+    connect(hosts.Get(hosts.GetN() - 1), edges.Get(0));
+
+    GlobalRouteManager::BuildGlobalRoutingDatabase();
+    GlobalRouteManager::InitializeRoutes();
+    std::string spf = DumpTables();
+    NS_TEST_ASSERT_MSG_GT(spf.size(), 10000, "SPF installed too few routes");
+
+    uint32_t threads[] = {1, 4};
+    for (uint32_t t : threads)
+    {
+        GlobalRouteManager::DeleteGlobalRoutes();
+        NS_TEST_ASSERT_MSG_EQ(GlobalRouteManager::InitializeRoutesBfs(t),
+                              true,
+                              "Fat-tree does not qualify for BFS global routing");
+        NS_TEST_EXPECT_MSG_EQ((DumpTables() == spf),
+                              true,
+                              "BFS routing tables differ from SPF with " << t << " threads");
+    }
+
+    // unequal metrics need the SPF
+    Ptr<Ipv4> ipv4Edge = edges.Get(0)->GetObject<Ipv4>();
+    ipv4Edge->SetMetric(ipv4Edge->GetInterfaceForDevice(links.back().Get(1)), 2);
+    GlobalRouteManager::DeleteGlobalRoutes();
+    NS_TEST_EXPECT_MSG_EQ(GlobalRouteManager::InitializeRoutesBfs(1),
+                          false,
+                          "BFS global routing accepted unequal metrics");
+
+    Simulator::Destroy();
+}
+
 /**
  * \ingroup internet-test
  *
@@ -1335,6 +1605,8 @@ Ipv4GlobalRoutingTestSuite::Ipv4GlobalRoutingTestSuite()
     AddTestCase(new TwoBridgeTest, TestCase::QUICK);
     AddTestCase(new Ipv4DynamicGlobalRoutingTestCase, TestCase::QUICK);
     AddTestCase(new Ipv4GlobalRoutingSlash32TestCase, TestCase::QUICK);
+    AddTestCase(new Ipv4GlobalRoutingCompiledFibTestCase, TestCase::QUICK);
+    AddTestCase(new Ipv4GlobalRoutingBfsTestCase, TestCase::QUICK);
 }
 
 static Ipv4GlobalRoutingTestSuite
@@ -0,0 +1,352 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/boolean.h"
+#include "ns3/data-rate.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-generator.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/ipv4-global-routing.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/node.h"
+#include "ns3/simple-channel.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+#include "ns3/tcp-socket-factory.h"
+#include "ns3/tcp-switch-node.h"
+#include "ns3/test.h"
+#include "ns3/udp-socket-factory.h"
+
+#include <limits>
+
+using namespace ns3;
+
+/**
+ * \ingroup internet-test
+ *
+ * \brief Runs two TCP flows over two switches (h0, h2 - s0 - s1 - h1) with the switches as
+ * plain Nodes and as TcpSwitchNodes, and checks that the flows deliver the same bytes at the
+ * same times.
+ *
+ * h0 also sends UDP probes that TcpSwitchNode must leave to the stack: TTL 1, to an address
+ * of s0, to the limited broadcast address, and to a network s0 has no route to. They must
+ * end the same way in both runs.
+ */
+class TcpSwitchNodeTestCase : public TestCase
+{
+  public:
+    TcpSwitchNodeTestCase();
+
+  private:
+    /// A TCP flow to h1
+    struct Flow
+    {
+        uint32_t size;
+        uint32_t sent;
+        uint32_t received;
+        Time finish; //!< time h1 received the last byte
+        Ptr<Socket> socket;
+    };
+
+    /// What a run observed
+    struct Result
+    {
+        Flow flows[2];
+        uint32_t forwards;     //!< UnicastForward of the stack of s0 and s1
+        uint32_t ttlDrops;     //!< at s0
+        uint32_t noRouteDrops; //!< at s0
+        uint32_t s0Rx;         //!< UDP packets received by s0
+        uint32_t h1Rx;         //!< UDP packets received by h1
+    };
+
+    void DoRun() override;
+    /**
+     * \brief Runs the topology.
+     * \param fastPath whether the switches are TcpSwitchNodes
+     */
+    void Run(bool fastPath);
+
+    static void StartFlow(Flow* flow, Ipv4Address dest, uint16_t port);
+    static void SendMore(Flow* flow, Ptr<Socket> socket, uint32_t available);
+    static void Accept(Flow* flow, Ptr<Socket> socket, const Address& from);
+    static void Receive(Flow* flow, Ptr<Socket> socket);
+    static void SendProbe(Ptr<Socket> socket, Ipv4Address dest);
+
+    void Forward(const Ipv4Header& header, Ptr<const Packet> p, uint32_t interface);
+    void Drop(const Ipv4Header& header,
+              Ptr<const Packet> p,
+              Ipv4L3Protocol::DropReason reason,
+              Ptr<Ipv4> ipv4,
+              uint32_t interface);
+    static void ReceiveUdp(uint32_t* count, Ptr<Socket> socket);
+
+    Result m_result[2]; //!< plain Nodes, TcpSwitchNodes
+    Result* m_cur;
+};
+
+TcpSwitchNodeTestCase::TcpSwitchNodeTestCase()
+    : TestCase("TcpSwitchNode forwards like the IPv4 stack"),
+      m_result(),
+      m_cur(nullptr)
+{
+}
+
+void
+TcpSwitchNodeTestCase::StartFlow(Flow* flow, Ipv4Address dest, uint16_t port)
+{
+    flow->socket->Connect(InetSocketAddress(dest, port));
+}
+
+void
+TcpSwitchNodeTestCase::SendMore(Flow* flow, Ptr<Socket> socket, uint32_t available)
+{
+    while (flow->sent < flow->size && socket->GetTxAvailable() > 0)
+    {
+        uint32_t n = std::min(flow->size - flow->sent, socket->GetTxAvailable());
+        int sent = socket->Send(Create<Packet>(n));
+        if (sent <= 0)
+        {
+            return;
+        }
+        flow->sent += sent;
+    }
+    if (flow->sent == flow->size)
+    {
+        socket->Close();
+    }
+}
+
+void
+TcpSwitchNodeTestCase::Accept(Flow* flow, Ptr<Socket> socket, const Address& from)
+{
+    socket->SetRecvCallback(MakeBoundCallback(&TcpSwitchNodeTestCase::Receive, flow));
+}
+
+void
+TcpSwitchNodeTestCase::Receive(Flow* flow, Ptr<Socket> socket)
+{
+    while (Ptr<Packet> p = socket->Recv(std::numeric_limits<uint32_t>::max(), 0))
+    {
+        if (p->GetSize() == 0)
+        {
+            break;
+        }
+        flow->received += p->GetSize();
+        flow->finish = Simulator::Now();
+    }
+}
+
+void
+TcpSwitchNodeTestCase::SendProbe(Ptr<Socket> socket, Ipv4Address dest)
+{
+    socket->SendTo(Create<Packet>(100), 0, InetSocketAddress(dest, 9));
+}
+
+void
+TcpSwitchNodeTestCase::Forward(const Ipv4Header& header, Ptr<const Packet> p, uint32_t interface)
+{
+    m_cur->forwards++;
+}
+
+void
+TcpSwitchNodeTestCase::Drop(const Ipv4Header& header,
+                            Ptr<const Packet> p,
+                            Ipv4L3Protocol::DropReason reason,
+                            Ptr<Ipv4> ipv4,
+                            uint32_t interface)
+{
+    if (reason == Ipv4L3Protocol::DROP_TTL_EXPIRED)
+    {
+        m_cur->ttlDrops++;
+    }
+    else if (reason == Ipv4L3Protocol::DROP_NO_ROUTE)
+    {
+        m_cur->noRouteDrops++;
+    }
+}
+
+void
+TcpSwitchNodeTestCase::ReceiveUdp(uint32_t* count, Ptr<Socket> socket)
+{
+    while (socket->Recv())
+    {
+        (*count)++;
+    }
+}
+
+void
+TcpSwitchNodeTestCase::Run(bool fastPath)
+{
+    m_cur = &m_result[fastPath];
+
+    Ptr<Node> h0 = CreateObject<Node>();
+    Ptr<Node> h1 = CreateObject<Node>();
+    Ptr<Node> h2 = CreateObject<Node>();
+    Ptr<Node> s0 = fastPath ? Ptr<Node>(CreateObject<TcpSwitchNode>()) : CreateObject<Node>();
+    Ptr<Node> s1 = fastPath ? Ptr<Node>(CreateObject<TcpSwitchNode>()) : CreateObject<Node>();
+
+    InternetStackHelper internet;
+    internet.SetIpv6StackInstall(false);
+    internet.SetRoutingHelper(Ipv4GlobalRoutingHelper());
+    internet.Install(NodeContainer(NodeContainer(h0, h1, h2), NodeContainer(s0, s1)));
+
+    Ipv4AddressHelper address;
+    Ipv4InterfaceContainer ifs[4];
+    Ptr<Node> ends[4][2] = {{h0, s0}, {h2, s0}, {s0, s1}, {s1, h1}};
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        Ptr<SimpleChannel> channel = CreateObject<SimpleChannel>();
+        channel->SetAttribute("Delay", TimeValue(MicroSeconds(20)));
+        NetDeviceContainer devices;
+        for (uint32_t k = 0; k < 2; k++)
+        {
+            Ptr<SimpleNetDevice> dev = CreateObject<SimpleNetDevice>();
+            dev->SetAttribute("PointToPointMode", BooleanValue(true));
+            dev->SetAttribute("DataRate", DataRateValue(DataRate("100Mbps")));
+            dev->SetAddress(Mac48Address::Allocate());
+            dev->SetChannel(channel);
+            ends[i][k]->AddDevice(dev);
+            devices.Add(dev);
+        }
+        address.SetBase(Ipv4Address(("10.1." + std::to_string(i + 1) + ".0").c_str()),
+                        "255.255.255.0");
+        ifs[i] = address.Assign(devices);
+    }
+    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    // h0 believes s0 knows 10.9.9.0/24
+    Ptr<Ipv4> h0Ipv4 = h0->GetObject<Ipv4>();
+    DynamicCast<Ipv4GlobalRouting>(h0Ipv4->GetRoutingProtocol())
+        ->AddNetworkRouteTo("10.9.9.0", "255.255.255.0", ifs[0].GetAddress(1), 1);
+
+    Ptr<Ipv4L3Protocol> s0Ipv4 = s0->GetObject<Ipv4L3Protocol>();
+    s0Ipv4->TraceConnectWithoutContext("UnicastForward",
+                                       MakeCallback(&TcpSwitchNodeTestCase::Forward, this));
+    s0Ipv4->TraceConnectWithoutContext("Drop", MakeCallback(&TcpSwitchNodeTestCase::Drop, this));
+    s1->GetObject<Ipv4L3Protocol>()->TraceConnectWithoutContext(
+        "UnicastForward",
+        MakeCallback(&TcpSwitchNodeTestCase::Forward, this));
+
+    // TCP flows h0 -> h1 and h2 -> h1, sharing s0 -> s1
+    Ptr<Node> senders[2] = {h0, h2};
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        Flow* flow = &m_cur->flows[i];
+        flow->size = 300000 + 100000 * i;
+        Ptr<Socket> sink = Socket::CreateSocket(h1, TcpSocketFactory::GetTypeId());
+        sink->Bind(InetSocketAddress(Ipv4Address::GetAny(), 5000 + i));
+        sink->Listen();
+        sink->SetAcceptCallback(MakeNullCallback<bool, Ptr<Socket>, const Address&>(),
+                                MakeBoundCallback(&TcpSwitchNodeTestCase::Accept, flow));
+        flow->socket = Socket::CreateSocket(senders[i], TcpSocketFactory::GetTypeId());
+        flow->socket->Bind();
+        flow->socket->SetSendCallback(MakeBoundCallback(&TcpSwitchNodeTestCase::SendMore, flow));
+        Simulator::ScheduleWithContext(senders[i]->GetId(),
+                                       MilliSeconds(1 + i),
+                                       &TcpSwitchNodeTestCase::StartFlow,
+                                       flow,
+                                       ifs[3].GetAddress(1),
+                                       5000 + i);
+    }
+
+    // UDP probes from h0, while the flows run
+    Ptr<Socket> s0Sink = Socket::CreateSocket(s0, UdpSocketFactory::GetTypeId());
+    s0Sink->Bind(InetSocketAddress(Ipv4Address::GetAny(), 9));
+    s0Sink->SetRecvCallback(MakeBoundCallback(&TcpSwitchNodeTestCase::ReceiveUdp, &m_cur->s0Rx));
+    Ptr<Socket> h1Sink = Socket::CreateSocket(h1, UdpSocketFactory::GetTypeId());
+    h1Sink->Bind(InetSocketAddress(Ipv4Address::GetAny(), 9));
+    h1Sink->SetRecvCallback(MakeBoundCallback(&TcpSwitchNodeTestCase::ReceiveUdp, &m_cur->h1Rx));
+
+    Ptr<Socket> probe = Socket::CreateSocket(h0, UdpSocketFactory::GetTypeId());
+    probe->Bind();
+    probe->SetAllowBroadcast(true);
+    Ptr<Socket> ttlProbe = Socket::CreateSocket(h0, UdpSocketFactory::GetTypeId());
+    ttlProbe->Bind();
+    ttlProbe->SetIpTtl(1);
+    Ipv4Address probes[] = {ifs[3].GetAddress(1),
+                            ifs[2].GetAddress(0),
+                            Ipv4Address::GetBroadcast(),
+                            Ipv4Address("10.9.9.1")};
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        Simulator::ScheduleWithContext(h0->GetId(),
+                                       MilliSeconds(5 + i),
+                                       &TcpSwitchNodeTestCase::SendProbe,
+                                       probe,
+                                       probes[i]);
+    }
+    Simulator::ScheduleWithContext(h0->GetId(),
+                                   MilliSeconds(9),
+                                   &TcpSwitchNodeTestCase::SendProbe,
+                                   ttlProbe,
+                                   ifs[3].GetAddress(1));
+
+    Simulator::Stop(Seconds(10));
+    Simulator::Run();
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        m_cur->flows[i].socket = nullptr;
+    }
+    Simulator::Destroy();
+    Ipv4AddressGenerator::Reset();
+}
+
+void
+TcpSwitchNodeTestCase::DoRun()
+{
+    Run(false);
+    Run(true);
+
+    const Result& stack = m_result[0];
+    const Result& fast = m_result[1];
+    NS_TEST_EXPECT_MSG_GT(stack.forwards, 0, "the stack forwards");
+    NS_TEST_EXPECT_MSG_EQ(fast.forwards, 0, "TcpSwitchNode forwards without the stack");
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        NS_TEST_EXPECT_MSG_EQ(stack.flows[i].received, stack.flows[i].size, "flow " << i);
+        NS_TEST_EXPECT_MSG_EQ(fast.flows[i].received, stack.flows[i].received, "flow " << i);
+        NS_TEST_EXPECT_MSG_EQ(fast.flows[i].finish, stack.flows[i].finish, "fct of flow " << i);
+    }
+
+    NS_TEST_EXPECT_MSG_EQ(stack.ttlDrops, 1, "TTL 1");
+    NS_TEST_EXPECT_MSG_EQ(stack.noRouteDrops, 1, "no route");
+    NS_TEST_EXPECT_MSG_EQ(stack.s0Rx, 2, "local and broadcast");
+    NS_TEST_EXPECT_MSG_EQ(stack.h1Rx, 1, "unicast");
+    NS_TEST_EXPECT_MSG_EQ(fast.ttlDrops, stack.ttlDrops, "TTL 1");
+    NS_TEST_EXPECT_MSG_EQ(fast.noRouteDrops, stack.noRouteDrops, "no route");
+    NS_TEST_EXPECT_MSG_EQ(fast.s0Rx, stack.s0Rx, "local and broadcast");
+    NS_TEST_EXPECT_MSG_EQ(fast.h1Rx, stack.h1Rx, "unicast");
+}
+
+/**
+ * \ingroup internet-test
+ *
+ * \brief TestSuite for TcpSwitchNode
+ */
+class TcpSwitchNodeTestSuite : public TestSuite
+{
+  public:
+    TcpSwitchNodeTestSuite();
+};
+
+TcpSwitchNodeTestSuite::TcpSwitchNodeTestSuite()
+    : TestSuite("tcp-switch-node", UNIT)
+{
+    AddTestCase(new TcpSwitchNodeTestCase(), TestCase::QUICK);
+}
+
+static TcpSwitchNodeTestSuite g_tcpSwitchNodeTestSuite; //!< The testsuite
@@ -23,6 +23,7 @@
 #include "application.h"
 
 #include "ns3/log.h"
+#include "ns3/memory-stats.h"
 #include "ns3/node.h"
 #include "ns3/nstime.h"
 #include "ns3/simulator.h"
@@ -59,12 +60,14 @@ Application::GetTypeId()
 Application::Application()
 {
     NS_LOG_FUNCTION(this);
+    NS_MEMORY_STATS_ADD(APPLICATION, sizeof(Application));
 }
 
 // \brief Application Destructor
 Application::~Application()
 {
     NS_LOG_FUNCTION(this);
+    NS_MEMORY_STATS_REMOVE(APPLICATION, sizeof(Application));
 }
 
 void
@@ -28,6 +28,7 @@
 #include "ns3/boolean.h"
 #include "ns3/global-value.h"
 #include "ns3/log.h"
+#include "ns3/memory-stats.h"
 #include "ns3/object-vector.h"
 #include "ns3/packet.h"
 #include "ns3/simulator.h"
@@ -106,11 +107,13 @@ Node::Construct()
 {
     NS_LOG_FUNCTION(this);
     m_id = NodeList::Add(this);
+    NS_MEMORY_STATS_ADD(NODE, sizeof(Node));
 }
 
 Node::~Node()
 {
     NS_LOG_FUNCTION(this);
+    NS_MEMORY_STATS_REMOVE(NODE, sizeof(Node));
 }
 
 uint32_t
@@ -45,6 +45,7 @@ PacketTagList::CreateTagData(size_t dataSize)
                                             << std::numeric_limits<decltype(TagData::size)>::max());
 
     void* p = std::malloc(sizeof(TagData) + dataSize - 1);
+    NS_MEMORY_STATS_ADD(PACKET_TAG, sizeof(TagData) + dataSize - 1);
     // The matching frees are in RemoveAll and RemoveWriter
 
     TagData* tag = new (p) TagData;
@@ -195,6 +196,7 @@ PacketTagList::RemoveWriter(Tag& tag,
     if (preMerge)
     {
         // found tid before first merge, so delete cur
+        NS_MEMORY_STATS_REMOVE(PACKET_TAG, sizeof(TagData) + cur->size - 1);
         cur->~TagData();
         std::free(cur);
     }
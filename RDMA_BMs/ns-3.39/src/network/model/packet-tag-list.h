@@ -24,6 +24,7 @@
 \brief  Defines a linked list of Packet tags, including copy-on-write semantics.
 */
 
+#include "ns3/memory-stats.h"
 #include "ns3/type-id.h"
 
 #include <ostream>
@@ -365,6 +366,7 @@ PacketTagList::RemoveAll()
         }
         if (prev != nullptr)
         {
+            NS_MEMORY_STATS_REMOVE(PACKET_TAG, sizeof(TagData) + prev->size - 1);
             prev->~TagData();
             std::free(prev);
         }
@@ -372,6 +374,7 @@ PacketTagList::RemoveAll()
     }
     if (prev != nullptr)
     {
+        NS_MEMORY_STATS_REMOVE(PACKET_TAG, sizeof(TagData) + prev->size - 1);
         prev->~TagData();
         std::free(prev);
     }
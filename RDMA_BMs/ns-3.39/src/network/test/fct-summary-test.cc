@@ -0,0 +1,301 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/fct-summary.h"
+#include "ns3/flow-trace.h"
+#include "ns3/test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+namespace
+{
+
+/// what SampleHistogram reports for the exact percentile v of samples up to max
+uint64_t
+Reported(uint64_t v, uint64_t max)
+{
+    typedef SampleHistogram::Buckets Buckets;
+    return std::min(Buckets::Upper(Buckets::Index(v)), max);
+}
+
+/// the ceil(p * n)-th smallest of sorted
+uint64_t
+Exact(const std::vector<uint64_t>& sorted, double p)
+{
+    uint64_t rank = std::max<uint64_t>(1, std::ceil(p * sorted.size()));
+    return sorted[rank - 1];
+}
+
+/// the value lines of FctSummary::Print, keyed by their first keyFields fields
+std::map<std::string, std::vector<double>>
+ParsePrint(const FctSummary& s, uint32_t keyFields)
+{
+    std::ostringstream os;
+    s.Print(os);
+    std::istringstream is(os.str());
+    std::map<std::string, std::vector<double>> lines;
+    std::string line;
+    while (std::getline(is, line))
+    {
+        if (line.find(" mean ") != std::string::npos)
+        {
+            continue; // a header
+        }
+        std::istringstream ls(line);
+        std::string key;
+        std::string field;
+        uint32_t n = 0;
+        std::vector<double> values;
+        while (ls >> field)
+        {
+            if (n++ < keyFields)
+            {
+                key += (key.empty() ? "" : " ") + field;
+            }
+            else
+            {
+                values.push_back(std::stod(field));
+            }
+        }
+        lines[key] = values;
+    }
+    return lines;
+}
+
+} // namespace
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * Checks the bucket edges of SampleHistogram, and its percentiles, mean and max against
+ * the exact ones of known and random sample lists.
+ */
+class SampleHistogramTestCase : public TestCase
+{
+  public:
+    SampleHistogramTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+SampleHistogramTestCase::SampleHistogramTestCase()
+    : TestCase("sample histogram buckets and percentiles")
+{
+}
+
+void
+SampleHistogramTestCase::DoRun()
+{
+    typedef SampleHistogram::Buckets Buckets;
+    const uint32_t sub = 1 << SampleHistogram::SUB_BITS;
+    // exact up to 2 * 2^SUB_BITS, then buckets of 2, 4, ...
+    NS_TEST_EXPECT_MSG_EQ(Buckets::Upper(Buckets::Index(2 * sub - 1)), 2 * sub - 1, "exact");
+    NS_TEST_EXPECT_MSG_EQ(Buckets::Index(2 * sub), Buckets::Index(2 * sub + 1), "width 2");
+    NS_TEST_EXPECT_MSG_NE(Buckets::Index(2 * sub + 1), Buckets::Index(2 * sub + 2), "width 2");
+    NS_TEST_EXPECT_MSG_EQ(Buckets::Upper(Buckets::Index(2 * sub)), 2 * sub + 1, "width 2");
+    NS_TEST_EXPECT_MSG_EQ(Buckets::Upper(Buckets::Index(990)), 991, "width 4");
+    NS_TEST_EXPECT_MSG_EQ(Buckets::Upper(Buckets::Index(50000)), 50175, "width 256");
+
+    SampleHistogram empty;
+    NS_TEST_EXPECT_MSG_EQ(empty.Percentile(0.5), 0, "empty");
+    NS_TEST_EXPECT_MSG_EQ(empty.GetMean(), 0, "empty");
+
+    SampleHistogram h;
+    for (uint64_t v = 1000; v >= 1; v--)
+    {
+        h.Add(v);
+    }
+    NS_TEST_EXPECT_MSG_EQ(h.GetN(), 1000, "samples");
+    NS_TEST_EXPECT_MSG_EQ(h.GetMean(), 500.5, "mean");
+    NS_TEST_EXPECT_MSG_EQ(h.GetMax(), 1000, "max");
+    NS_TEST_EXPECT_MSG_EQ(h.Percentile(0.1), 100, "p10, exact below 256");
+    NS_TEST_EXPECT_MSG_EQ(h.Percentile(0.5), 501, "p50");
+    NS_TEST_EXPECT_MSG_EQ(h.Percentile(0.99), 991, "p99");
+    NS_TEST_EXPECT_MSG_EQ(h.Percentile(1), 1000, "p100, capped to the max");
+
+    std::mt19937_64 rng(1);
+    for (uint32_t run = 0; run < 100; run++)
+    {
+        SampleHistogram random;
+        std::vector<uint64_t> samples;
+        uint32_t n = 1 + rng() % 2000;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            uint64_t v = rng() >> (rng() % 64);
+            random.Add(v);
+            samples.push_back(v);
+        }
+        std::sort(samples.begin(), samples.end());
+        for (double p : {0.01, 0.5, 0.95, 0.99, 0.999, 1.0})
+        {
+            uint64_t exact = Exact(samples, p);
+            uint64_t reported = random.Percentile(p);
+            NS_TEST_EXPECT_MSG_EQ(reported, Reported(exact, samples.back()), "run " << run);
+            NS_TEST_EXPECT_MSG_LT_OR_EQ(reported - exact, exact / sub, "within 1/2^SUB_BITS");
+        }
+    }
+}
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * Feeds FctSummary known flows and queries and checks the lines it prints: the flow
+ * slowdown percentiles per class, incast flag and size bucket, and the QCT of complete,
+ * unannounced and incomplete queries.
+ */
+class FctSummaryTestCase : public TestCase
+{
+  public:
+    FctSummaryTestCase();
+
+  private:
+    void DoRun() override;
+    /**
+     * Checks the printed line key: the number of samples, then after count fields, their
+     * mean, p50, p95, p99, p999 and max.
+     */
+    void CheckLine(const std::map<std::string, std::vector<double>>& lines,
+                   const std::string& key,
+                   uint32_t count,
+                   std::vector<uint64_t> samples);
+};
+
+FctSummaryTestCase::FctSummaryTestCase()
+    : TestCase("FCT slowdown and QCT percentiles")
+{
+}
+
+void
+FctSummaryTestCase::CheckLine(const std::map<std::string, std::vector<double>>& lines,
+                              const std::string& key,
+                              uint32_t count,
+                              std::vector<uint64_t> samples)
+{
+    auto it = lines.find(key);
+    NS_TEST_EXPECT_MSG_EQ((it != lines.end()), true, "line " << key);
+    if (it == lines.end() || it->second.size() != count + 6)
+    {
+        NS_TEST_EXPECT_MSG_EQ((it == lines.end()), true, "fields of " << key);
+        return;
+    }
+    const std::vector<double>& line = it->second;
+    NS_TEST_EXPECT_MSG_EQ(line[0], samples.size(), "samples of " << key);
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (uint64_t v : samples)
+    {
+        sum += v;
+    }
+    std::vector<double> expected = {sum / samples.size() / 1000};
+    for (double p : {0.5, 0.95, 0.99, 0.999})
+    {
+        expected.push_back(Reported(Exact(samples, p), samples.back()) / 1000.0);
+    }
+    expected.push_back(samples.back() / 1000.0);
+    for (uint32_t i = 0; i < expected.size(); i++)
+    {
+        NS_TEST_EXPECT_MSG_EQ_TOL(line[count + i],
+                                  expected[i],
+                                  expected[i] * 1e-5,
+                                  key << ", field " << count + i);
+    }
+}
+
+void
+FctSummaryTestCase::DoRun()
+{
+    FctSummary s;
+    // RDMA flows of 5000 bytes with slowdowns 1 to 100, and of 10000 bytes, the first
+    // size of the second bucket, with slowdown 2
+    std::vector<uint64_t> small;
+    for (uint64_t k = 1; k <= 100; k++)
+    {
+        s.AddFlow(FLOW_RDMA, 5000, k * 10000, 10000, false);
+        small.push_back(k * 1000);
+    }
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        s.AddFlow(FLOW_RDMA, 10000, 40000, 20000, false);
+    }
+    // TCP incast flows, slowdown 2.5 and 7.25 x 1000 rounded
+    s.AddFlow(FLOW_TCP, 20000000, 25000, 10000, true);
+    s.AddFlow(FLOW_TCP, 20000000, 29000, 4000, true);
+
+    // query A: two announced flows, the QCT runs to the last one
+    uint64_t a = FctSummary::QueryKey(2, 1000);
+    s.ExpectQueryFlow(a);
+    s.ExpectQueryFlow(a);
+    s.QueryFlowDone(a, 1000, 1000, 8000, 100000000000, 21000);
+    s.QueryFlowDone(a, 1000, 3000, 10000, 25000000000, 31000);
+    // query B: one unannounced flow, closed by Print
+    uint64_t b = FctSummary::QueryKey(3, 5000);
+    s.QueryFlowDone(b, 5000, 2000, 8000, 100000000000, 15000);
+    // query C: two announced flows, only one completes
+    uint64_t c = FctSummary::QueryKey(2, 2000);
+    s.ExpectQueryFlow(c);
+    s.ExpectQueryFlow(c);
+    s.QueryFlowDone(c, 2000, 1000, 8000, 100000000000, 50000);
+
+    std::map<std::string, std::vector<double>> lines = ParsePrint(s, 5);
+    CheckLine(lines, "fct rdma 0 0 10000", 1, small);
+    CheckLine(lines, "fct rdma 0 10000 100000", 1, {2000, 2000, 2000});
+    CheckLine(lines, "fct tcp 1 10000000 inf", 1, {2500, 7250});
+    NS_TEST_EXPECT_MSG_EQ(lines.count("fct tcp 0 10000000 inf"), 0, "no TCP flow not incast");
+
+    lines = ParsePrint(s, 2);
+    // A takes 30 us, B 10 us, C is incomplete
+    CheckLine(lines, "qct us", 2, {30000, 10000});
+    const std::vector<double>& qct = lines["qct us"];
+    NS_TEST_EXPECT_MSG_EQ((qct.size() > 1 && qct[1] == 1), true, "one incomplete query");
+    // ideal of A: 10 us RTT and 4000 bytes at 25 Gbps, of B: 8 us and 2000 bytes at 100 Gbps
+    NS_TEST_EXPECT_MSG_EQ(FctSummary::IdealFct(4000, 10000, 25000000000), 11280, "ideal of A");
+    uint64_t slowdownA =
+        std::llround(1000.0 * 30000 / FctSummary::IdealFct(4000, 10000, 25000000000));
+    uint64_t slowdownB =
+        std::llround(1000.0 * 10000 / FctSummary::IdealFct(2000, 8000, 100000000000));
+    CheckLine(lines, "qct slowdown", 2, {slowdownA, slowdownB});
+}
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief TestSuite for the FCT and QCT summaries
+ */
+class FctSummaryTestSuite : public TestSuite
+{
+  public:
+    FctSummaryTestSuite();
+};
+
+FctSummaryTestSuite::FctSummaryTestSuite()
+    : TestSuite("fct-summary", UNIT)
+{
+    AddTestCase(new SampleHistogramTestCase(), TestCase::QUICK);
+    AddTestCase(new FctSummaryTestCase(), TestCase::QUICK);
+}
+
+static FctSummaryTestSuite g_fctSummaryTestSuite; //!< The testsuite
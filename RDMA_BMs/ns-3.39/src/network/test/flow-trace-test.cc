@@ -0,0 +1,289 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/flow-trace.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+namespace
+{
+
+bool
+SameRecord(const FlowRecord& a, const FlowRecord& b)
+{
+    return a.start == b.start && a.size == b.size && a.src == b.src && a.dst == b.dst &&
+           a.id == b.id && a.priority == b.priority && a.cls == b.cls && a.flags == b.flags;
+}
+
+std::string
+ReadFile(const std::string& path)
+{
+    std::ifstream f(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+void
+WriteFile(const std::string& path, const std::string& data)
+{
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(data.data(), data.size());
+}
+
+} // namespace
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * Writes a trace of 600000 flows, larger than the 16 MB the reader releases at a time,
+ * reads it back through the memory map and replays it: every flow must be handed over
+ * unchanged, in order, at its start time. A second replay started halfway skips the
+ * flows already past.
+ */
+class FlowTraceRoundTripTestCase : public TestCase
+{
+  public:
+    FlowTraceRoundTripTestCase();
+
+  private:
+    void DoRun() override;
+    void Flow(const FlowRecord& r);
+    void LateFlow(const FlowRecord& r);
+
+    std::vector<FlowRecord> m_flows;
+    uint64_t m_replayed;
+    uint64_t m_late;      //!< flows of the replay started at m_lateStart
+    uint64_t m_lateStart; //!< ns
+};
+
+FlowTraceRoundTripTestCase::FlowTraceRoundTripTestCase()
+    : TestCase("flow trace write, read and replay"),
+      m_replayed(0),
+      m_late(0),
+      m_lateStart(0)
+{
+}
+
+void
+FlowTraceRoundTripTestCase::Flow(const FlowRecord& r)
+{
+    NS_TEST_ASSERT_MSG_LT(m_replayed, m_flows.size(), "flows replayed");
+    NS_TEST_ASSERT_MSG_EQ(SameRecord(r, m_flows[m_replayed]), true, "flow " << m_replayed);
+    NS_TEST_ASSERT_MSG_EQ(uint64_t(Simulator::Now().GetNanoSeconds()),
+                          r.start,
+                          "start of flow " << m_replayed);
+    m_replayed++;
+}
+
+void
+FlowTraceRoundTripTestCase::LateFlow(const FlowRecord& r)
+{
+    NS_TEST_ASSERT_MSG_GT_OR_EQ(r.start, m_lateStart, "flows past the start are skipped");
+    m_late++;
+}
+
+void
+FlowTraceRoundTripTestCase::DoRun()
+{
+    const uint64_t n = 600000;
+    std::string path = CreateTempDirFilename("flows.bin");
+    std::mt19937_64 rng(1);
+    FlowTraceWriter writer;
+    writer.Open(path);
+    uint64_t start = 1000;
+    for (uint64_t i = 0; i < n; i++)
+    {
+        FlowRecord r;
+        memset(&r, 0, sizeof(r));
+        start += rng() % 3 == 0 ? 0 : rng() % 2000; // some flows start together
+        r.start = start;
+        r.size = 1 + rng() % 100000000;
+        r.src = rng() % 1024;
+        r.dst = rng() % 1024;
+        r.id = i;
+        r.priority = rng() % 8;
+        r.cls = rng() % 2 ? FLOW_TCP : FLOW_RDMA;
+        r.flags = rng() % 10 == 0 ? FLOW_INCAST : 0;
+        writer.Write(r);
+        m_flows.push_back(r);
+    }
+    NS_TEST_EXPECT_MSG_EQ(writer.GetNFlows(), n, "flows written");
+    writer.Close();
+
+    FlowTraceReader reader;
+    NS_TEST_ASSERT_MSG_EQ(reader.Open(path), true, reader.GetError());
+    NS_TEST_ASSERT_MSG_EQ(reader.GetNFlows(), n, "flows read");
+    for (uint64_t i = 0; i < n; i++)
+    {
+        NS_TEST_ASSERT_MSG_EQ(SameRecord(reader.Get(i), m_flows[i]), true, "flow " << i);
+    }
+    reader.Close();
+
+    Ptr<FlowTraceReplay> replay = CreateObject<FlowTraceReplay>();
+    replay->Open(path);
+    replay->SetFlowCallback(MakeCallback(&FlowTraceRoundTripTestCase::Flow, this));
+    replay->Start();
+    m_lateStart = m_flows[n / 2].start + 1;
+    Ptr<FlowTraceReplay> late = CreateObject<FlowTraceReplay>();
+    late->Open(path);
+    late->SetFlowCallback(MakeCallback(&FlowTraceRoundTripTestCase::LateFlow, this));
+    Simulator::Schedule(NanoSeconds(m_lateStart), &FlowTraceReplay::Start, late);
+    Simulator::Run();
+
+    NS_TEST_EXPECT_MSG_EQ(m_replayed, n, "flows replayed");
+    NS_TEST_EXPECT_MSG_EQ(replay->GetNStarted(), n, "flows started");
+    uint64_t after = 0;
+    for (const FlowRecord& r : m_flows)
+    {
+        after += r.start >= m_lateStart;
+    }
+    NS_TEST_EXPECT_MSG_EQ(m_late, after, "flows of the late replay");
+    NS_TEST_EXPECT_MSG_EQ(late->GetNStarted(), n, "late replay done");
+    replay->Dispose();
+    late->Dispose();
+    Simulator::Destroy();
+}
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * Checks that the reader refuses missing, empty, truncated and corrupt traces, and that
+ * a trace without flows replays nothing.
+ */
+class FlowTraceCorruptTestCase : public TestCase
+{
+  public:
+    FlowTraceCorruptTestCase();
+
+  private:
+    void DoRun() override;
+    void Flow(const FlowRecord& r);
+    /// checks that the reader refuses data
+    void Refuse(const std::string& data, const std::string& what, const std::string& error);
+
+    uint32_t m_flows;
+};
+
+FlowTraceCorruptTestCase::FlowTraceCorruptTestCase()
+    : TestCase("empty, truncated and corrupt flow traces"),
+      m_flows(0)
+{
+}
+
+void
+FlowTraceCorruptTestCase::Flow(const FlowRecord& r)
+{
+    m_flows++;
+}
+
+void
+FlowTraceCorruptTestCase::Refuse(const std::string& data,
+                                 const std::string& what,
+                                 const std::string& error)
+{
+    std::string path = CreateTempDirFilename("bad.bin");
+    WriteFile(path, data);
+    FlowTraceReader reader;
+    NS_TEST_EXPECT_MSG_EQ(reader.Open(path), false, what);
+    NS_TEST_EXPECT_MSG_NE(reader.GetError().find(error), std::string::npos, what);
+    NS_TEST_EXPECT_MSG_EQ(reader.GetNFlows(), 0, what);
+}
+
+void
+FlowTraceCorruptTestCase::DoRun()
+{
+    FlowTraceReader reader;
+    NS_TEST_EXPECT_MSG_EQ(reader.Open(CreateTempDirFilename("missing.bin")), false, "missing");
+    NS_TEST_EXPECT_MSG_NE(reader.GetError().find("Cannot open"), std::string::npos, "missing");
+
+    std::string path = CreateTempDirFilename("flows.bin");
+    FlowTraceWriter writer;
+    writer.Open(path);
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        FlowRecord r;
+        memset(&r, 0, sizeof(r));
+        r.start = 1000 * (i + 1);
+        r.size = 1000;
+        r.id = i;
+        writer.Write(r);
+    }
+    writer.Close();
+    std::string good = ReadFile(path);
+    NS_TEST_ASSERT_MSG_EQ(good.size(), 32 + 3 * 32, "trace size");
+    NS_TEST_EXPECT_MSG_EQ(reader.Open(path), true, reader.GetError());
+    NS_TEST_EXPECT_MSG_EQ(reader.GetNFlows(), 3, "flows");
+    reader.Close();
+
+    Refuse("", "empty file", "truncated");
+    Refuse(good.substr(0, 20), "truncated header", "truncated");
+    Refuse(good.substr(0, 32 + 2 * 32 + 10), "truncated records", "truncated");
+    std::string bad = good;
+    bad[0] = 'X';
+    Refuse(bad, "bad magic", "not a flow trace");
+    bad = good;
+    bad[8] = 2; // version
+    Refuse(bad, "bad version", "version");
+    bad = good;
+    bad[12] = 16; // record size
+    Refuse(bad, "bad record size", "version");
+    bad = good;
+    memset(&bad[16], 0xff, 8); // flow count
+    Refuse(bad, "bad flow count", "truncated");
+    Refuse(std::string(32, '\0'), "header never completed by Close()", "not a flow trace");
+
+    // a trace without flows
+    writer.Open(path);
+    writer.Close();
+    Ptr<FlowTraceReplay> replay = CreateObject<FlowTraceReplay>();
+    replay->Open(path);
+    replay->SetFlowCallback(MakeCallback(&FlowTraceCorruptTestCase::Flow, this));
+    replay->Start();
+    Simulator::Run();
+    NS_TEST_EXPECT_MSG_EQ(replay->GetNFlows(), 0, "no flows");
+    NS_TEST_EXPECT_MSG_EQ(m_flows, 0, "no flows replayed");
+    replay->Dispose();
+    Simulator::Destroy();
+}
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief TestSuite for the binary flow traces
+ */
+class FlowTraceTestSuite : public TestSuite
+{
+  public:
+    FlowTraceTestSuite();
+};
+
+FlowTraceTestSuite::FlowTraceTestSuite()
+    : TestSuite("flow-trace", UNIT)
+{
+    AddTestCase(new FlowTraceRoundTripTestCase(), TestCase::QUICK);
+    AddTestCase(new FlowTraceCorruptTestCase(), TestCase::QUICK);
+}
+
+static FlowTraceTestSuite g_flowTraceTestSuite; //!< The testsuite
@@ -0,0 +1,302 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/broadcom-egress-queue.h"
+#include "ns3/enum.h"
+#include "ns3/pifo-queue.h"
+#include "ns3/rank-tag.h"
+#include "ns3/test.h"
+
+#include <vector>
+
+using namespace ns3;
+
+namespace
+{
+
+/// a packet of the given size with a RankTag
+Ptr<Packet>
+MakePacket(uint32_t flow, uint64_t remaining, uint64_t deadline, uint32_t size = 1000)
+{
+    Ptr<Packet> p = Create<Packet>(size);
+    p->AddPacketTag(RankTag(flow, remaining, deadline));
+    return p;
+}
+
+/// the flow of a dequeued packet, ~0 for none
+uint32_t
+FlowOf(Ptr<Packet> p)
+{
+    RankTag tag;
+    if (!p || !p->PeekPacketTag(tag))
+    {
+        return ~0u;
+    }
+    return tag.GetFlow();
+}
+
+} // namespace
+
+/**
+ * \brief Checks that a RankTag keeps its fields through the packet tag list.
+ */
+class RankTagTestCase : public TestCase
+{
+  public:
+    RankTagTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+RankTagTestCase::RankTagTestCase()
+    : TestCase("RankTag serialization")
+{
+}
+
+void
+RankTagTestCase::DoRun()
+{
+    Ptr<Packet> p = MakePacket(0xdeadbeef, 123456789012ULL, 987654321098ULL);
+    RankTag tag;
+    NS_TEST_ASSERT_MSG_EQ(p->PeekPacketTag(tag), true, "tag found");
+    NS_TEST_EXPECT_MSG_EQ(tag.GetFlow(), 0xdeadbeef, "flow");
+    NS_TEST_EXPECT_MSG_EQ(tag.GetRemaining(), 123456789012ULL, "remaining");
+    NS_TEST_EXPECT_MSG_EQ(tag.GetDeadline(), 987654321098ULL, "deadline");
+}
+
+/**
+ * \brief Dequeue order of PifoQueue under SRPT and least slack: flows by rank, equal ranks in
+ * arrival order, and packets of one flow in arrival order even when a later one has a smaller
+ * rank.
+ */
+class PifoQueueRankTestCase : public TestCase
+{
+  public:
+    PifoQueueRankTestCase();
+
+  private:
+    void DoRun() override;
+    /// dequeues everything and checks the flows in order
+    void Drain(PifoQueue& q, const std::vector<uint32_t>& flows, const std::string& what);
+};
+
+PifoQueueRankTestCase::PifoQueueRankTestCase()
+    : TestCase("PifoQueue rank order, ties and flow order")
+{
+}
+
+void
+PifoQueueRankTestCase::Drain(PifoQueue& q,
+                             const std::vector<uint32_t>& flows,
+                             const std::string& what)
+{
+    NS_TEST_EXPECT_MSG_EQ(q.GetNPackets(), flows.size(), what << ": packets queued");
+    for (uint32_t i = 0; i < flows.size(); i++)
+    {
+        NS_TEST_EXPECT_MSG_EQ(FlowOf(q.Dequeue()), flows[i], what << ": packet " << i);
+    }
+    NS_TEST_EXPECT_MSG_EQ(q.IsEmpty(), true, what << ": empty");
+    NS_TEST_EXPECT_MSG_EQ(q.GetNBytes(), 0, what << ": bytes");
+    NS_TEST_EXPECT_MSG_EQ(q.Dequeue(), nullptr, what << ": nothing left");
+}
+
+void
+PifoQueueRankTestCase::DoRun()
+{
+    // SRPT: the smallest remaining size first
+    PifoQueue srpt;
+    srpt.Enqueue(MakePacket(1, 5000, 0));
+    srpt.Enqueue(MakePacket(2, 1000, 0));
+    srpt.Enqueue(MakePacket(3, 3000, 0));
+    NS_TEST_EXPECT_MSG_EQ(srpt.GetNBytes(), 3000, "bytes queued");
+    Drain(srpt, {2, 3, 1}, "SRPT");
+
+    // least slack: the earliest deadline first, the remaining size is ignored
+    PifoQueue lstf;
+    lstf.SetRank(PifoQueue::RANK_LSTF);
+    lstf.Enqueue(MakePacket(1, 1000, 300));
+    lstf.Enqueue(MakePacket(2, 9000, 100));
+    lstf.Enqueue(MakePacket(3, 5000, 200));
+    Drain(lstf, {2, 3, 1}, "LSTF");
+
+    // equal ranks leave in arrival order, also after the heap was reordered
+    PifoQueue ties;
+    ties.Enqueue(MakePacket(4, 2000, 0));
+    ties.Enqueue(MakePacket(1, 3000, 0));
+    ties.Enqueue(MakePacket(2, 2000, 0));
+    ties.Enqueue(MakePacket(3, 2000, 0));
+    ties.Enqueue(MakePacket(5, 1000, 0));
+    Drain(ties, {5, 4, 2, 3, 1}, "ties");
+
+    // flow 1 holds the smallest rank with its second packet, its first packet goes first; a
+    // packet without tag is flow 0 with rank 0
+    PifoQueue order;
+    order.Enqueue(MakePacket(1, 6000, 0));
+    order.Enqueue(MakePacket(2, 4000, 0));
+    order.Enqueue(MakePacket(1, 1000, 0));
+    order.Enqueue(Create<Packet>(100));
+    Ptr<Packet> p = order.Dequeue();
+    RankTag tag;
+    NS_TEST_EXPECT_MSG_EQ(p->PeekPacketTag(tag), false, "untagged packet first");
+    p = order.Dequeue();
+    NS_TEST_ASSERT_MSG_EQ(p->PeekPacketTag(tag), true, "tagged packet");
+    NS_TEST_EXPECT_MSG_EQ(tag.GetFlow(), 1, "flow 1 first");
+    NS_TEST_EXPECT_MSG_EQ(tag.GetRemaining(), 6000, "earliest packet of flow 1 first");
+    Drain(order, {1, 2}, "flow order");
+
+    // a rank callback replaces the rank functions
+    PifoQueue cb;
+    cb.SetRankCallback(MakeCallback(
+        +[](Ptr<const Packet> p, uint32_t flow) -> uint64_t { return 10 - flow; }));
+    cb.Enqueue(MakePacket(1, 1000, 0));
+    cb.Enqueue(MakePacket(3, 3000, 0));
+    cb.Enqueue(MakePacket(2, 2000, 0));
+    Drain(cb, {3, 2, 1}, "callback");
+}
+
+/**
+ * \brief Start-time fair queuing interleaves backlogged flows packet by packet, and a flow that
+ * starts late gets no credit for the time before it started.
+ */
+class PifoQueueStfqTestCase : public TestCase
+{
+  public:
+    PifoQueueStfqTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+PifoQueueStfqTestCase::PifoQueueStfqTestCase()
+    : TestCase("PifoQueue start-time fair queuing")
+{
+}
+
+void
+PifoQueueStfqTestCase::DoRun()
+{
+    PifoQueue q;
+    q.SetRank(PifoQueue::RANK_STFQ);
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        q.Enqueue(MakePacket(1, 0, 0));
+    }
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        q.Enqueue(MakePacket(2, 0, 0));
+    }
+    std::vector<uint32_t> expected = {1, 2, 1, 2, 1, 2, 1, 2};
+    for (uint32_t i = 0; i < expected.size(); i++)
+    {
+        NS_TEST_EXPECT_MSG_EQ(FlowOf(q.Dequeue()), expected[i], "interleaved packet " << i);
+    }
+
+    // flow 3 arrives while flow 1 is backlogged: it starts at the virtual time, not at 0, so it
+    // alternates with flow 1 instead of sending its three packets first
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        q.Enqueue(MakePacket(1, 0, 0));
+    }
+    NS_TEST_EXPECT_MSG_EQ(FlowOf(q.Dequeue()), 1, "flow 1 alone");
+    NS_TEST_EXPECT_MSG_EQ(FlowOf(q.Dequeue()), 1, "flow 1 alone");
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        q.Enqueue(MakePacket(3, 0, 0));
+    }
+    expected = {3, 1, 3, 1, 3};
+    for (uint32_t i = 0; i < expected.size(); i++)
+    {
+        NS_TEST_EXPECT_MSG_EQ(FlowOf(q.Dequeue()), expected[i], "after idle, packet " << i);
+    }
+    NS_TEST_EXPECT_MSG_EQ(q.IsEmpty(), true, "empty");
+}
+
+/**
+ * \brief BEgressQueue with PIFO classes: a class keeps its rank order, a paused class is
+ * skipped without losing its packets, and it resumes in rank order. Queue 0 stays FIFO.
+ */
+class BEgressQueuePifoTestCase : public TestCase
+{
+  public:
+    BEgressQueuePifoTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+BEgressQueuePifoTestCase::BEgressQueuePifoTestCase()
+    : TestCase("BEgressQueue PIFO classes with paused queues")
+{
+}
+
+void
+BEgressQueuePifoTestCase::DoRun()
+{
+    Ptr<BEgressQueue> q = CreateObject<BEgressQueue>();
+    q->SetAttribute("PifoRank", EnumValue(PifoQueue::RANK_SRPT));
+    bool paused[BEgressQueue::qCnt] = {};
+
+    // queue 0 is FIFO although its ranks are reversed
+    q->Enqueue(MakePacket(10, 2000, 0), 0);
+    q->Enqueue(MakePacket(11, 1000, 0), 0);
+    q->Enqueue(MakePacket(1, 3000, 0), 1);
+    q->Enqueue(MakePacket(2, 1000, 0), 1);
+    q->Enqueue(MakePacket(3, 2000, 0), 1);
+    q->Enqueue(MakePacket(20, 500, 0), 2);
+    NS_TEST_EXPECT_MSG_EQ(q->GetNBytes(1), 3000, "bytes of queue 1");
+    NS_TEST_EXPECT_MSG_EQ(q->GetNBytesTotal(), 6000, "bytes queued");
+
+    // queue 1 is paused: queue 0, never paused, then queue 2
+    paused[0] = paused[1] = true;
+    NS_TEST_EXPECT_MSG_EQ(FlowOf(q->DequeueRR(paused)), 10, "queue 0, first in");
+    NS_TEST_EXPECT_MSG_EQ(FlowOf(q->DequeueRR(paused)), 11, "queue 0, second in");
+    NS_TEST_EXPECT_MSG_EQ(FlowOf(q->DequeueRR(paused)), 20, "queue 2 while 1 is paused");
+    NS_TEST_EXPECT_MSG_EQ(q->GetLastQueue(), 2, "last queue");
+    NS_TEST_EXPECT_MSG_EQ(q->DequeueRR(paused), nullptr, "only the paused queue is left");
+    NS_TEST_EXPECT_MSG_EQ(q->GetNBytes(1), 3000, "paused queue kept its bytes");
+
+    // a packet with a smaller rank arrives while paused and goes first on resume
+    q->Enqueue(MakePacket(4, 500, 0), 1);
+    paused[1] = false;
+    std::vector<uint32_t> expected = {4, 2, 3, 1};
+    for (uint32_t i = 0; i < expected.size(); i++)
+    {
+        NS_TEST_EXPECT_MSG_EQ(FlowOf(q->DequeueRR(paused)), expected[i], "resumed, packet " << i);
+        NS_TEST_EXPECT_MSG_EQ(q->GetLastQueue(), 1, "resumed queue");
+    }
+    NS_TEST_EXPECT_MSG_EQ(q->GetNBytesTotal(), 0, "empty");
+    NS_TEST_EXPECT_MSG_EQ(q->DequeueRR(paused), nullptr, "nothing left");
+}
+
+/**
+ * \brief TestSuite for PifoQueue and RankTag
+ */
+class PifoQueueTestSuite : public TestSuite
+{
+  public:
+    PifoQueueTestSuite();
+};
+
+PifoQueueTestSuite::PifoQueueTestSuite()
+    : TestSuite("pifo-queue", UNIT)
+{
+    AddTestCase(new RankTagTestCase(), TestCase::QUICK);
+    AddTestCase(new PifoQueueRankTestCase(), TestCase::QUICK);
+    AddTestCase(new PifoQueueStfqTestCase(), TestCase::QUICK);
+    AddTestCase(new BEgressQueuePifoTestCase(), TestCase::QUICK);
+}
+
+static PifoQueueTestSuite g_pifoQueueTestSuite; //!< The testsuite
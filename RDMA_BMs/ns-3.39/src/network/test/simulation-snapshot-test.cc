@@ -0,0 +1,193 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/data-rate.h"
+#include "ns3/node.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/simulation-snapshot.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+
+#include <fstream>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace ns3;
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief Warms up a simulation that writes one line per second, forks it at 4.5 s into two
+ * branches and checks the file of each branch and the exit statuses collected by Wait().
+ *
+ * Branch "a" sets the DataRate of a device with a config path, branch "b" changes the step of
+ * the output with the branch callback and exits with status 2. The process also has a child
+ * that is not a branch and has already exited when the branches are waited for: Wait() must
+ * not reap it.
+ */
+class SimulationSnapshotTestCase : public TestCase
+{
+  public:
+    /**
+     * \param maxParallel SimulationSnapshot MaxParallel
+     */
+    SimulationSnapshotTestCase(uint32_t maxParallel);
+
+  private:
+    void DoRun() override;
+    void Write();
+    void Branch(const std::string& name, const SimulationSnapshot::Overrides& overrides);
+    static std::string ReadFile(const std::string& path);
+    /// the lines a full run of a branch writes from second `from` to second `to`
+    static std::string Lines(uint32_t from, uint32_t to, uint64_t rate, uint32_t step);
+
+    uint32_t m_maxParallel;
+    Ptr<SimpleNetDevice> m_dev;
+    Ptr<OutputStreamWrapper> m_out;
+    uint32_t m_step;
+    int m_exit;
+};
+
+SimulationSnapshotTestCase::SimulationSnapshotTestCase(uint32_t maxParallel)
+    : TestCase("Snapshot forked into two branches, MaxParallel " + std::to_string(maxParallel)),
+      m_maxParallel(maxParallel),
+      m_step(1),
+      m_exit(0)
+{
+}
+
+void
+SimulationSnapshotTestCase::Write()
+{
+    DataRateValue rate;
+    m_dev->GetAttribute("DataRate", rate);
+    *m_out->GetStream() << Simulator::Now().GetSeconds() << " " << rate.Get().GetBitRate() << " "
+                        << m_step << "\n";
+    Simulator::Schedule(Seconds(1), &SimulationSnapshotTestCase::Write, this);
+}
+
+void
+SimulationSnapshotTestCase::Branch(const std::string& name,
+                                   const SimulationSnapshot::Overrides& overrides)
+{
+    for (const auto& o : overrides)
+    {
+        if (o.first == "step")
+        {
+            m_step = std::stoul(o.second);
+        }
+        else if (o.first == "exit")
+        {
+            m_exit = std::stoi(o.second);
+        }
+    }
+}
+
+std::string
+SimulationSnapshotTestCase::ReadFile(const std::string& path)
+{
+    std::ifstream f(path);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    return ss.str();
+}
+
+std::string
+SimulationSnapshotTestCase::Lines(uint32_t from, uint32_t to, uint64_t rate, uint32_t step)
+{
+    std::stringstream ss;
+    for (uint32_t t = from; t <= to; t++)
+    {
+        ss << t << " " << rate << " " << step << "\n";
+    }
+    return ss.str();
+}
+
+void
+SimulationSnapshotTestCase::DoRun()
+{
+    std::string path = CreateTempDirFilename("snapshot-" + std::to_string(m_maxParallel) + ".txt");
+    Ptr<Node> node = CreateObject<Node>();
+    m_dev = CreateObject<SimpleNetDevice>();
+    m_dev->SetAttribute("DataRate", DataRateValue(DataRate("1Gbps")));
+    node->AddDevice(m_dev);
+    m_out = Create<OutputStreamWrapper>(path, std::ios::out);
+
+    Ptr<SimulationSnapshot> snapshot = CreateObject<SimulationSnapshot>();
+    snapshot->SetAttribute("MaxParallel", UintegerValue(m_maxParallel));
+    snapshot->AddBranches("a:/NodeList/" + std::to_string(node->GetId()) +
+                          "/DeviceList/0/DataRate=2Gbps;b:step=3,exit=2");
+    snapshot->AddStream(m_out, path);
+    snapshot->SetBranchCallback(MakeCallback(&SimulationSnapshotTestCase::Branch, this));
+    snapshot->Schedule(Seconds(4.5));
+
+    pid_t other = fork();
+    NS_TEST_ASSERT_MSG_GT_OR_EQ(other, 0, "fork");
+    if (other == 0)
+    {
+        _exit(0);
+    }
+
+    Simulator::Schedule(Seconds(1), &SimulationSnapshotTestCase::Write, this);
+    Simulator::Stop(Seconds(10.5));
+    Simulator::Run();
+    if (!snapshot->GetBranch().empty())
+    {
+        // a branch reports to the parent through its file and its exit status only
+        m_out->GetStream()->flush();
+        _exit(m_exit);
+    }
+    uint32_t failed = snapshot->Wait();
+    int status = 0;
+    pid_t reaped = waitpid(other, &status, 0);
+    m_out->GetStream()->flush();
+    Simulator::Destroy();
+
+    NS_TEST_EXPECT_MSG_EQ(snapshot->IsParent(), true, "the branches were not forked");
+    NS_TEST_EXPECT_MSG_EQ(failed, 1, "failed branches");
+    NS_TEST_EXPECT_MSG_EQ(reaped, other, "Wait() reaped a child that is not a branch");
+    NS_TEST_EXPECT_MSG_EQ(ReadFile(path), Lines(1, 4, 1000000000, 1), "warm-up output");
+    NS_TEST_EXPECT_MSG_EQ(ReadFile(path + ".a"),
+                          Lines(1, 4, 1000000000, 1) + Lines(5, 10, 2000000000, 1),
+                          "output of branch a");
+    NS_TEST_EXPECT_MSG_EQ(ReadFile(path + ".b"),
+                          Lines(1, 4, 1000000000, 1) + Lines(5, 10, 1000000000, 3),
+                          "output of branch b");
+}
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief TestSuite for SimulationSnapshot
+ */
+class SimulationSnapshotTestSuite : public TestSuite
+{
+  public:
+    SimulationSnapshotTestSuite();
+};
+
+SimulationSnapshotTestSuite::SimulationSnapshotTestSuite()
+    : TestSuite("simulation-snapshot", UNIT)
+{
+    AddTestCase(new SimulationSnapshotTestCase(0), TestCase::QUICK);
+    AddTestCase(new SimulationSnapshotTestCase(1), TestCase::QUICK);
+}
+
+static SimulationSnapshotTestSuite g_simulationSnapshotTestSuite; //!< The testsuite
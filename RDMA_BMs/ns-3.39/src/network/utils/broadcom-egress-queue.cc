@@ -21,6 +21,7 @@
 #include "ns3/enum.h"
 #include "ns3/uinteger.h"
 #include "ns3/double.h"
+#include "ns3/string.h"
 #include "ns3/simulator.h"
 #include "drop-tail-queue.h"
 #include "broadcom-egress-queue.h"
@@ -42,6 +43,25 @@ namespace ns3 {
 				DoubleValue(1000.0 * 1024 * 1024),
 				MakeDoubleAccessor(&BEgressQueue::m_maxBytes),
 				MakeDoubleChecker<double>())
+			.AddAttribute("Quanta",
+				"DRR quanta in bytes of queues 0..qCnt-1, comma separated. Queue 0 is always served first; queues "
+				"not listed or with a 0 quantum send one packet per turn, so the default is plain round robin.",
+				StringValue(""),
+				MakeStringAccessor(&BEgressQueue::m_quanta),
+				MakeStringChecker())
+			.AddAttribute("PifoRank",
+				"Rank function of the PIFO queues, None keeps every queue FIFO",
+				EnumValue(-1),
+				MakeEnumAccessor(&BEgressQueue::m_pifoRank),
+				MakeEnumChecker(-1, "None",
+				                PifoQueue::RANK_SRPT, "SRPT",
+				                PifoQueue::RANK_LSTF, "LSTF",
+				                PifoQueue::RANK_STFQ, "STFQ"))
+			.AddAttribute("PifoQueues",
+				"Bitmask of the queues ordered by rank when PifoRank is set. Queue 0 (control) is always FIFO",
+				UintegerValue(0xfe),
+				MakeUintegerAccessor(&BEgressQueue::m_pifoQueues),
+				MakeUintegerChecker<uint32_t>())
 			;
 
 		return tid;
@@ -53,7 +73,8 @@ namespace ns3 {
 		NS_LOG_FUNCTION_NOARGS();
 		m_bytesInQueueTotal = 0;
 		m_rxBytes= 0;
-		m_rrlast = 0;
+		m_qlast = 0;
+		m_configured = false;
 		for (uint32_t i = 0; i < fCnt; i++)
 		{
 			m_bytesInQueue[i] = 0;
@@ -76,15 +97,21 @@ namespace ns3 {
 			// NS_ABORT_MSG("debug");
 			// std::cout << "debug: enqueue size " << m_bytesInQueueTotal << std::endl;
 			// std::cout << "debug " << "qIndex " << qIndex << std::endl;
+			if (!m_configured)
+				Configure();
 			if (m_bytesInQueueTotal + p->GetSize() < m_maxBytes)  //infinite queue
 			{
-				if(!m_queues[qIndex]->Enqueue(p)) {
+				if (qIndex < qCnt && m_isPifo[qIndex])
+					m_pifo[qIndex].Enqueue(p);
+				else if(!m_queues[qIndex]->Enqueue(p)) {
 					std::cout << "currentSize " << m_bytesInQueueTotal << " MaxSize " << m_queues[qIndex]->GetMaxSize().GetValue() << std::endl;
 					NS_ABORT_MSG("BEgressQueue implementation error: must not drop here");
 				}
 				m_bytesInQueueTotal += p->GetSize();
 				m_bytesInQueue[qIndex] += p->GetSize();
 				m_rxBytes+= p->GetSize();
+				if (qIndex < qCnt)
+					m_sched.SetBacklogged(qIndex);
 			}
 			else
 			{
@@ -106,39 +133,19 @@ namespace ns3 {
 			NS_LOG_LOGIC("Queue empty");
 			return 0;
 		}
-		bool found = false;
-		uint32_t qIndex;
-
-		if (m_queues[0]->GetNPackets() > 0) //0 is the highest priority
-		{
-			found = true;
-			qIndex = 0;
-		}
-		else
-		{
-			if (!found)
-			{
-				for (qIndex = 1; qIndex <= qCnt; qIndex++)
-				{
-					if (!paused[(qIndex + m_rrlast) % qCnt] && m_queues[(qIndex + m_rrlast) % qCnt]->GetNPackets() > 0)  //round robin
-					{
-						found = true;
-						break;
-					}
-				}
-				qIndex = (qIndex + m_rrlast) % qCnt;
-			}
-		}
+		if (!m_configured)
+			Configure();
+		m_sched.SetPaused(ClassScheduler::Mask(paused, qCnt) & ~uint64_t(1)); // queue 0 is never paused
+		int32_t qIndex = m_sched.Select();
+		bool found = qIndex >= 0;
 		if (found)
 		{
-			Ptr<Packet> p = m_queues[qIndex]->Dequeue();
+			bool pifo = m_isPifo[qIndex];
+			Ptr<Packet> p = pifo ? m_pifo[qIndex].Dequeue() : m_queues[qIndex]->Dequeue();
 			m_traceBeqDequeue(p, qIndex);
 			m_bytesInQueueTotal -= p->GetSize();
 			m_bytesInQueue[qIndex] -= p->GetSize();
-			if (qIndex != 0)
-			{
-				m_rrlast = qIndex;
-			}
+			m_sched.Served(qIndex, p->GetSize(), pifo ? m_pifo[qIndex].IsEmpty() : m_queues[qIndex]->IsEmpty());
 			m_qlast = qIndex;
 			NS_LOG_LOGIC("Popped " << p);
 			NS_LOG_LOGIC("Number bytes " << m_bytesInQueueTotal);
@@ -151,6 +158,36 @@ namespace ns3 {
 		return 0;
 	}
 
+	void
+		BEgressQueue::Configure()
+	{
+		m_pifo.resize(qCnt);
+		for (uint32_t i = 0; i < qCnt; i++)
+		{
+			m_isPifo[i] = i > 0 && m_pifoRank >= 0 && (m_pifoQueues >> i & 1);
+			if (m_isPifo[i])
+			{
+				m_pifo[i].SetRank(m_pifoRank);
+				m_pifo[i].SetRankCallback(m_pifoRankCb);
+			}
+		}
+
+		std::vector<uint32_t> levels(qCnt, 1);
+		levels[0] = 0;
+		std::vector<uint32_t> quanta = ClassScheduler::ParseList(m_quanta);
+		quanta.resize(qCnt, 0);
+		quanta[0] = 0;
+		m_sched.Configure(levels, quanta);
+		m_configured = true;
+	}
+
+	void
+		BEgressQueue::SetPifoRankCallback(PifoQueue::RankCallback cb)
+	{
+		NS_ABORT_MSG_IF(m_configured, "The PIFO rank callback must be set before the first packet");
+		m_pifoRankCb = cb;
+	}
+
 	bool
 		BEgressQueue::Enqueue(Ptr<Packet> p, uint32_t qIndex)
 	{
@@ -198,12 +235,15 @@ namespace ns3 {
 		std::cout << "Warning: Call Broadcom queues without priority\n";
 		uint32_t qIndex = 0;
 		NS_LOG_FUNCTION(this << p);
+		if (!m_configured)
+			Configure();
 		if (m_bytesInQueueTotal + p->GetSize() < m_maxBytes)
 		{
 			m_queues[qIndex]->Enqueue(p);
 			m_bytesInQueueTotal += p->GetSize();
 			m_bytesInQueue[qIndex] += p->GetSize();
 			m_rxBytes+= p->GetSize();
+			m_sched.SetBacklogged(qIndex);
 		}
 		else
 		{
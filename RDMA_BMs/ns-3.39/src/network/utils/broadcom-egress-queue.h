@@ -25,6 +25,8 @@
 #include "drop-tail-queue.h"
 #include "ns3/point-to-point-net-device.h"
 #include "ns3/event-id.h"
+#include "class-scheduler.h"
+#include "pifo-queue.h"
 
 namespace ns3 {
 
@@ -45,6 +47,9 @@ namespace ns3 {
 
 		uint32_t GetLastQueue();
 
+		// replaces the rank function of the PIFO queues
+		void SetPifoRankCallback(PifoQueue::RankCallback cb);
+
 		TracedCallback<Ptr<const Packet>, uint32_t> m_traceBeqEnqueue;
 		TracedCallback<Ptr<const Packet>, uint32_t> m_traceBeqDequeue;
 
@@ -65,12 +70,22 @@ namespace ns3 {
 		virtual bool DoEnqueue(Ptr<Packet> p);
 		virtual Ptr<Packet> DoDequeue(void);
 		virtual Ptr<const Packet> DoPeek(void) const;
+		void Configure();
 		double m_maxBytes; //total bytes limit
 		uint32_t m_bytesInQueue[fCnt];
 		uint32_t m_bytesInQueueTotal;
 		uint64_t m_rxBytes;
-		uint32_t m_rrlast;
 		uint32_t m_qlast;
+		// queue 0 in strict priority over queues 1..qCnt-1 in (deficit) round robin
+		ClassScheduler m_sched;
+		std::string m_quanta;
+		// the queues in m_pifoQueues keep their packets in rank order instead of FIFO
+		int m_pifoRank;
+		uint32_t m_pifoQueues;
+		PifoQueue::RankCallback m_pifoRankCb;
+		std::vector<PifoQueue> m_pifo;
+		bool m_isPifo[qCnt];
+		bool m_configured;
 		std::vector<Ptr<Queue<Packet>> > m_queues; // uc queues
 		// vamsi
 		uint64_t numTxBytes; // for throughput calculations
@@ -0,0 +1,173 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef CLASS_SCHEDULER_H
+#define CLASS_SCHEDULER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Egress class scheduler driven by bitmasks, shared by the multi-queue egress models.
+ *
+ * Every class has a strict priority level and a DRR quantum. Levels are served in
+ * increasing order; the classes of one level share it round robin, one packet per
+ * turn if their quantum is 0, or deficit round robin otherwise (a class keeps its
+ * turn while its deficit is positive, and gets its quantum when the turn comes back).
+ * One level with quantum 0 is the usual round robin, one class per level is strict
+ * priority, and a few single-class levels above a DRR level is PQ-over-DRR.
+ *
+ * The owner reports when a class becomes backlogged or empty, and may pause classes
+ * (PFC). Select() finds the next class with a count-trailing-zeros on the eligible
+ * classes of each level instead of probing every queue. A class reported backlogged
+ * that turns out empty (its queue was drained behind the scheduler's back) must be
+ * reported empty and Select() called again.
+ */
+class ClassScheduler
+{
+  public:
+    static const uint32_t MAX_CLASSES = 64;
+
+    ClassScheduler();
+
+    /**
+     * \param levels strict priority level of each class, lower levels are served first
+     * \param quanta DRR quantum of each class in bytes, 0 for one packet per turn
+     */
+    void Configure(const std::vector<uint32_t>& levels, const std::vector<uint32_t>& quanta);
+    /// n classes served round robin
+    void ConfigureRoundRobin(uint32_t n);
+    /// n classes in strict priority, class 0 first
+    void ConfigureStrictPriority(uint32_t n);
+
+    uint32_t GetNClasses() const
+    {
+        return m_level.size();
+    }
+
+    void SetBacklogged(uint32_t c)
+    {
+        m_backlog |= Bit(c);
+    }
+
+    void SetEmpty(uint32_t c)
+    {
+        m_backlog &= ~Bit(c);
+        if (c < m_deficit.size())
+        {
+            m_deficit[c] = 0;
+        }
+    }
+
+    uint64_t GetBacklogged() const
+    {
+        return m_backlog;
+    }
+
+    /// Paused classes are skipped by Select() but keep their deficit.
+    void SetPaused(uint64_t mask)
+    {
+        m_paused = mask;
+    }
+
+    /// The class to serve next, or -1 if no class is backlogged and unpaused.
+    int32_t Select()
+    {
+        uint64_t eligible = m_backlog & ~m_paused;
+        if (eligible == 0)
+        {
+            return -1;
+        }
+        for (uint32_t l = 0; l < m_levels.size(); l++)
+        {
+            uint64_t m = eligible & m_levels[l].mask;
+            if (m == 0)
+            {
+                continue;
+            }
+            uint32_t c = m_levels[l].last;
+            if ((m & Bit(c)) && m_quantum[c] > 0 && m_deficit[c] > 0)
+            {
+                return c;
+            }
+            while (true)
+            {
+                c = Next(m, c);
+                if (m_quantum[c] == 0)
+                {
+                    return c;
+                }
+                m_levels[l].last = c;
+                m_deficit[c] += m_quantum[c];
+                if (m_deficit[c] > 0)
+                {
+                    return c;
+                }
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * A packet of size bytes was dequeued from class c, as returned by Select().
+     * \param empty whether the class queue is now empty
+     */
+    void Served(uint32_t c, uint32_t size, bool empty)
+    {
+        m_levels[m_level[c]].last = c;
+        if (m_quantum[c] > 0)
+        {
+            m_deficit[c] -= size;
+        }
+        if (empty)
+        {
+            SetEmpty(c);
+        }
+    }
+
+    /// Bitmask of the first n entries of flags.
+    static uint64_t Mask(const bool* flags, uint32_t n)
+    {
+        uint64_t mask = 0;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            mask |= uint64_t(flags[i]) << i;
+        }
+        return mask;
+    }
+
+    /// Parse a comma separated list of integers, as used by the Quanta attributes.
+    static std::vector<uint32_t> ParseList(const std::string& s);
+
+  private:
+    static uint64_t Bit(uint32_t c)
+    {
+        return uint64_t(1) << c;
+    }
+
+    /// The first class of m after c, wrapping around.
+    static uint32_t Next(uint64_t m, uint32_t c)
+    {
+        uint64_t above = c + 1 < MAX_CLASSES ? m & ~((Bit(c) << 1) - 1) : 0;
+        return __builtin_ctzll(above ? above : m);
+    }
+
+    struct Level
+    {
+        uint64_t mask; //!< classes of this level
+        uint32_t last; //!< class served last, the round robin resumes after it
+    };
+
+    std::vector<Level> m_levels;   //!< in the order they are served
+    std::vector<uint32_t> m_level; //!< index in m_levels of each class
+    std::vector<uint32_t> m_quantum;
+    std::vector<int64_t> m_deficit;
+    uint64_t m_backlog;
+    uint64_t m_paused;
+};
+
+} // namespace ns3
+
+#endif /* CLASS_SCHEDULER_H */
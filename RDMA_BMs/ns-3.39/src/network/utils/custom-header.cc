@@ -95,7 +95,7 @@ uint32_t CustomHeader::GetSerializedSize (void) const{
 		else if (l3Prot == 0x11) // UDP
 			len += GetUdpHeaderSize();
 		else if (l3Prot == 0xFC || l3Prot == 0xFD)
-			len += GetAckSerializedSize();
+			len += GetAckSerializedSize() + (((ack.flags >> 1) & 1) ? sizeof(ack.sack) : 0);
 		else if (l3Prot == 0xFF)
 			len += 8;
 		else if (l3Prot == 0xFE)
@@ -175,6 +175,8 @@ void CustomHeader::Serialize (Buffer::Iterator start) const{
 		  i.WriteU16(ack.pg);
 		  i.WriteU32(ack.seq);
 		  udp.ih.Serialize(i);
+		  if ((ack.flags >> 1) & 1) // qbbHeader::FLAG_SACK
+			  i.WriteU32(ack.sack);
 	  }else if (l3Prot == 0xFE){ // PFC
 		  i.WriteU32 (pfc.time);
 		  i.WriteU32 (pfc.qlen);
@@ -313,6 +315,12 @@ CustomHeader::Deserialize (Buffer::Iterator start)
 		  if (getInt)
 			  ack.ih.Deserialize(i);
 		  l4Size = GetAckSerializedSize();
+		  if ((ack.flags >> 1) & 1) { // qbbHeader::FLAG_SACK
+			  i = start;
+			  i.Next(l2Size + l3Size + l4Size);
+			  ack.sack = i.ReadU32();
+			  l4Size += sizeof(ack.sack);
+		  }
 	  }else if (l3Prot == 0xFE){ // PFC
 		  pfc.time = i.ReadU32 ();
 		  pfc.qlen = i.ReadU32 ();
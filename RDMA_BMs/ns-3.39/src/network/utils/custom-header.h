@@ -124,6 +124,7 @@ public:
 		  uint16_t pg;
 		  uint32_t seq; // the qbb sequence number.
 		  IntHeader ih;
+		  uint32_t sack; // present if flag bit 1 (qbbHeader::FLAG_SACK) is set
 	  } ack;
 	  // PauseHeader
 	  struct {
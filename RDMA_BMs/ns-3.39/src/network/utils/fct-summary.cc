@@ -0,0 +1,172 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "fct-summary.h"
+
+#include "flow-trace.h"
+
+#include "ns3/assert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace ns3
+{
+
+namespace
+{
+
+const double PERCENTILES[] = {0.5, 0.95, 0.99, 0.999};
+
+/// mean, percentiles and max of a histogram of values scaled by scale
+void
+PrintPercentiles(std::ostream& os, const SampleHistogram& h, double scale)
+{
+    os << " " << h.GetMean() / scale;
+    for (double p : PERCENTILES)
+    {
+        os << " " << h.Percentile(p) / scale;
+    }
+    os << " " << h.GetMax() / scale << "\n";
+}
+
+} // namespace
+
+SampleHistogram::SampleHistogram()
+    : m_n(0),
+      m_sum(0),
+      m_max(0)
+{
+}
+
+uint64_t
+SampleHistogram::Percentile(double p) const
+{
+    if (m_n == 0)
+    {
+        return 0;
+    }
+    // same rank as the scripts: the ceil(p * n)-th smallest sample
+    return Buckets::Percentile(m_counts, m_n, m_max, p);
+}
+
+FctSummary::FctSummary()
+    : m_bounds({10000, 100000, 1000000, 10000000})
+{
+}
+
+void
+FctSummary::SetSizeBuckets(const std::vector<uint64_t>& bounds)
+{
+    NS_ASSERT_MSG(m_slowdown.empty(), "Size buckets set after the first flow");
+    NS_ASSERT_MSG(std::is_sorted(bounds.begin(), bounds.end()), "Size buckets must be increasing");
+    m_bounds = bounds;
+}
+
+uint32_t
+FctSummary::Bucket(uint64_t size) const
+{
+    return std::upper_bound(m_bounds.begin(), m_bounds.end(), size) - m_bounds.begin();
+}
+
+void
+FctSummary::AddFlow(uint8_t cls, uint64_t size, uint64_t fct, uint64_t ideal, bool incast)
+{
+    uint32_t nBuckets = m_bounds.size() + 1;
+    uint32_t idx = (cls * 2 + incast) * nBuckets + Bucket(size);
+    if (idx >= m_slowdown.size())
+    {
+        m_slowdown.resize((cls + 1) * 2 * nBuckets);
+    }
+    m_slowdown[idx].Add(std::llround(1000.0 * fct / std::max<uint64_t>(ideal, 1)));
+}
+
+void
+FctSummary::ExpectQueryFlow(uint64_t query)
+{
+    auto it = m_queries.find(query);
+    if (it == m_queries.end())
+    {
+        m_queries[query] = Query{1, 0, 0, 0, UINT64_MAX, 0};
+        return;
+    }
+    it->second.pending++;
+}
+
+void
+FctSummary::QueryFlowDone(uint64_t query,
+                          uint64_t start,
+                          uint64_t bytes,
+                          uint64_t rtt,
+                          uint64_t bw,
+                          uint64_t now)
+{
+    auto it = m_queries.find(query);
+    if (it == m_queries.end())
+    {
+        // not announced with ExpectQueryFlow: it is closed by Print
+        it = m_queries.emplace(query, Query{0, start, 0, 0, UINT64_MAX, 0}).first;
+    }
+    Query& q = it->second;
+    q.pending--;
+    q.start = start;
+    q.bytes += bytes;
+    q.rtt = std::max(q.rtt, rtt);
+    q.bw = std::min(q.bw, bw);
+    q.end = std::max(q.end, now);
+    if (q.pending == 0)
+    {
+        AddQuery(q, m_qct, m_qctSlowdown);
+        m_queries.erase(it);
+    }
+}
+
+void
+FctSummary::AddQuery(const Query& q, SampleHistogram& qct, SampleHistogram& slowdown)
+{
+    uint64_t t = q.end - q.start;
+    qct.Add(t);
+    slowdown.Add(std::llround(1000.0 * t / std::max<uint64_t>(IdealFct(q.bytes, q.rtt, q.bw), 1)));
+}
+
+void
+FctSummary::Print(std::ostream& os) const
+{
+    os << "fct class incast sizeFrom sizeTo flows mean p50 p95 p99 p999 max\n";
+    uint32_t nBuckets = m_bounds.size() + 1;
+    for (uint32_t idx = 0; idx < m_slowdown.size(); idx++)
+    {
+        const SampleHistogram& h = m_slowdown[idx];
+        if (h.GetN() == 0)
+        {
+            continue;
+        }
+        uint32_t cls = idx / nBuckets / 2;
+        uint32_t b = idx % nBuckets;
+        os << "fct " << (cls == FLOW_RDMA ? "rdma" : cls == FLOW_TCP ? "tcp" : std::to_string(cls))
+           << " " << (idx / nBuckets) % 2 << " " << (b == 0 ? 0 : m_bounds[b - 1]) << " "
+           << (b < m_bounds.size() ? std::to_string(m_bounds[b]) : "inf") << " " << h.GetN();
+        PrintPercentiles(os, h, 1000);
+    }
+
+    // queries whose flows were never announced are complete once the run is over
+    SampleHistogram qct = m_qct;
+    SampleHistogram qctSlowdown = m_qctSlowdown;
+    uint64_t incomplete = 0;
+    for (const auto& it : m_queries)
+    {
+        const Query& q = it.second;
+        if (q.pending > 0)
+        {
+            incomplete++;
+            continue;
+        }
+        AddQuery(q, qct, qctSlowdown);
+    }
+    os << "qct metric queries incomplete mean p50 p95 p99 p999 max\n";
+    os << "qct us " << qct.GetN() << " " << incomplete;
+    PrintPercentiles(os, qct, 1000);
+    os << "qct slowdown " << qctSlowdown.GetN() << " " << incomplete;
+    PrintPercentiles(os, qctSlowdown, 1000);
+}
+
+} // namespace ns3
@@ -0,0 +1,139 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef FCT_SUMMARY_H
+#define FCT_SUMMARY_H
+
+#include "log-buckets.h"
+
+#include <ostream>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Count histogram with HDR-style buckets, as OccupancyHistogram but per sample.
+ *
+ * Every power of two above 2^SUB_BITS is split into 2^SUB_BITS linear sub-buckets,
+ * so a reported percentile is within 1/2^SUB_BITS (0.8%) of the exact one.
+ */
+class SampleHistogram
+{
+  public:
+    static const uint32_t SUB_BITS = 7;
+    typedef LogBuckets<SUB_BITS> Buckets;
+
+    SampleHistogram();
+
+    void Add(uint64_t v)
+    {
+        Buckets::Add(m_counts, v, 1);
+        m_n++;
+        m_sum += v;
+        if (v > m_max)
+        {
+            m_max = v;
+        }
+    }
+
+    /// Smallest bucket upper bound at or below which a fraction p of the samples fall.
+    uint64_t Percentile(double p) const;
+
+    uint64_t GetN() const
+    {
+        return m_n;
+    }
+
+    double GetMean() const
+    {
+        return m_n ? m_sum / m_n : 0;
+    }
+
+    uint64_t GetMax() const
+    {
+        return m_max;
+    }
+
+  private:
+    std::vector<uint64_t> m_counts; //!< samples per bucket, grown on demand
+    uint64_t m_n;
+    double m_sum;
+    uint64_t m_max;
+};
+
+/**
+ * \brief Flow and query completion time statistics, aggregated while the simulation runs.
+ *
+ * Each completed flow is folded into the slowdown histogram (FCT over ideal FCT) of
+ * its transport class, incast flag and size bucket, and the flows of a query into the
+ * histograms of its completion time (QCT) once the last one has completed. Nothing is
+ * kept per flow, so the memory does not grow with the length of the run, and Print()
+ * writes a few lines of percentiles instead of one line per flow.
+ */
+class FctSummary
+{
+  public:
+    FctSummary();
+
+    /// Upper bounds (bytes, exclusive) of the size buckets; the last bucket is unbounded.
+    void SetSizeBuckets(const std::vector<uint64_t>& bounds);
+
+    /// FCT (ns) of bytes alone on a path of base RTT rtt (ns) and bottleneck bw (bps)
+    static uint64_t IdealFct(uint64_t bytes, uint64_t rtt, uint64_t bw)
+    {
+        return rtt + bytes * 8 * 1000000000.0 / bw;
+    }
+
+    /**
+     * \param cls transport class of the flow, FLOW_RDMA or FLOW_TCP
+     * \param size flow size in bytes, selects the bucket
+     * \param fct flow completion time in ns
+     * \param ideal FCT of the flow alone in the network, in ns
+     */
+    void AddFlow(uint8_t cls, uint64_t size, uint64_t fct, uint64_t ideal, bool incast);
+
+    /// Key of the query answered to server dst, started at start (ns)
+    static uint64_t QueryKey(uint32_t dst, uint64_t start)
+    {
+        return (uint64_t(dst) << 44) | start;
+    }
+
+    /// One more flow answers this query. Must be called before any of its flows completes.
+    void ExpectQueryFlow(uint64_t query);
+
+    /**
+     * A flow of the query completed at now (ns). The QCT is recorded when the last expected
+     * flow has completed; its ideal is the query bytes at bw (bps) after rtt (ns), the
+     * largest RTT and smallest bandwidth of the flows.
+     */
+    void QueryFlowDone(uint64_t query, uint64_t start, uint64_t bytes, uint64_t rtt, uint64_t bw, uint64_t now);
+
+    /// Writes the fct and qct percentile lines.
+    void Print(std::ostream& os) const;
+
+  private:
+    struct Query
+    {
+        int64_t pending; //!< expected flows not completed yet
+        uint64_t start;
+        uint64_t bytes;
+        uint64_t rtt;
+        uint64_t bw;
+        uint64_t end;
+    };
+
+    static void AddQuery(const Query& q, SampleHistogram& qct, SampleHistogram& slowdown);
+    uint32_t Bucket(uint64_t size) const;
+
+    std::vector<uint64_t> m_bounds;
+    /// slowdown x1000 per (class, incast, size bucket), grown on demand
+    std::vector<SampleHistogram> m_slowdown;
+    std::unordered_map<uint64_t, Query> m_queries; //!< queries with flows in flight
+    SampleHistogram m_qct;         //!< ns
+    SampleHistogram m_qctSlowdown; //!< x1000
+};
+
+} // namespace ns3
+
+#endif /* FCT_SUMMARY_H */
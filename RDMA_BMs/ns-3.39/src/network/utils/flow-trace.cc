@@ -0,0 +1,253 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "flow-trace.h"
+
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+namespace
+{
+const char FLOW_TRACE_MAGIC[8] = {'N', 'S', '3', 'F', 'L', 'O', 'W', 'S'};
+const uint32_t FLOW_TRACE_VERSION = 1;
+
+struct FlowTraceHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t nFlows;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(FlowRecord) == 32, "FlowRecord must match the on-disk layout");
+static_assert(sizeof(FlowTraceHeader) == 32, "FlowTraceHeader must match the on-disk layout");
+} // namespace
+
+FlowTraceWriter::FlowTraceWriter()
+    : m_file(nullptr),
+      m_nFlows(0),
+      m_lastStart(0)
+{
+}
+
+FlowTraceWriter::~FlowTraceWriter()
+{
+    Close();
+}
+
+void
+FlowTraceWriter::Open(const std::string& path)
+{
+    Close();
+    m_file = fopen(path.c_str(), "wb");
+    NS_ABORT_MSG_IF(m_file == nullptr, "Cannot write flow trace " << path);
+    setvbuf(m_file, nullptr, _IOFBF, 1 << 20);
+    m_nFlows = 0;
+    m_lastStart = 0;
+    FlowTraceHeader h;
+    memset(&h, 0, sizeof(h));
+    fwrite(&h, sizeof(h), 1, m_file); // completed by Close()
+}
+
+void
+FlowTraceWriter::Write(const FlowRecord& r)
+{
+    NS_ABORT_MSG_IF(r.start < m_lastStart, "Flow trace records must be written in start time order");
+    m_lastStart = r.start;
+    fwrite(&r, sizeof(r), 1, m_file);
+    m_nFlows++;
+}
+
+void
+FlowTraceWriter::Close()
+{
+    if (m_file == nullptr)
+    {
+        return;
+    }
+    FlowTraceHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, FLOW_TRACE_MAGIC, sizeof(h.magic));
+    h.version = FLOW_TRACE_VERSION;
+    h.recordSize = sizeof(FlowRecord);
+    h.nFlows = m_nFlows;
+    fseek(m_file, 0, SEEK_SET);
+    fwrite(&h, sizeof(h), 1, m_file);
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+FlowTraceReader::FlowTraceReader()
+    : m_map(nullptr),
+      m_mapSize(0),
+      m_records(nullptr),
+      m_nFlows(0),
+      m_released(0)
+{
+}
+
+FlowTraceReader::~FlowTraceReader()
+{
+    Close();
+}
+
+bool
+FlowTraceReader::Open(const std::string& path)
+{
+    Close();
+    m_error.clear();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        m_error = "Cannot open flow trace " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(FlowTraceHeader))
+    {
+        close(fd);
+        m_error = "Flow trace " + path + " is truncated";
+        return false;
+    }
+    m_mapSize = st.st_size;
+    m_map = mmap(nullptr, m_mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m_map == MAP_FAILED)
+    {
+        m_map = nullptr;
+        m_error = "Cannot map flow trace " + path;
+        return false;
+    }
+    madvise(m_map, m_mapSize, MADV_SEQUENTIAL);
+
+    const FlowTraceHeader* h = static_cast<const FlowTraceHeader*>(m_map);
+    if (memcmp(h->magic, FLOW_TRACE_MAGIC, sizeof(h->magic)) != 0)
+    {
+        m_error = path + " is not a flow trace";
+    }
+    else if (h->version != FLOW_TRACE_VERSION || h->recordSize != sizeof(FlowRecord))
+    {
+        m_error = "Unsupported flow trace version " + std::to_string(h->version) + " in " + path;
+    }
+    else if ((m_mapSize - sizeof(FlowTraceHeader)) / sizeof(FlowRecord) < h->nFlows)
+    {
+        m_error = "Flow trace " + path + " is truncated";
+    }
+    if (!m_error.empty())
+    {
+        Close();
+        return false;
+    }
+    m_nFlows = h->nFlows;
+    m_records = reinterpret_cast<const FlowRecord*>(h + 1);
+    m_released = 0;
+    return true;
+}
+
+void
+FlowTraceReader::Close()
+{
+    if (m_map != nullptr)
+    {
+        munmap(m_map, m_mapSize);
+    }
+    m_map = nullptr;
+    m_records = nullptr;
+    m_nFlows = 0;
+}
+
+void
+FlowTraceReader::Release(uint64_t i)
+{
+    static const size_t chunk = 16 << 20; // released in large steps, a madvise per flow would cost more than the read
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t upto = (sizeof(FlowTraceHeader) + i * sizeof(FlowRecord)) / page * page;
+    if (upto >= m_released + chunk)
+    {
+        madvise(static_cast<char*>(m_map) + m_released, upto - m_released, MADV_DONTNEED);
+        m_released = upto;
+    }
+}
+
+NS_OBJECT_ENSURE_REGISTERED(FlowTraceReplay);
+
+TypeId
+FlowTraceReplay::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::FlowTraceReplay")
+                            .SetParent<Object>()
+                            .SetGroupName("Network")
+                            .AddConstructor<FlowTraceReplay>();
+    return tid;
+}
+
+FlowTraceReplay::FlowTraceReplay()
+    : m_next(0)
+{
+}
+
+FlowTraceReplay::~FlowTraceReplay()
+{
+}
+
+void
+FlowTraceReplay::DoDispose()
+{
+    m_cb = FlowCallback();
+    m_reader.Close();
+    Object::DoDispose();
+}
+
+void
+FlowTraceReplay::Open(const std::string& path)
+{
+    NS_ABORT_MSG_IF(!m_reader.Open(path), m_reader.GetError());
+    m_next = 0;
+}
+
+void
+FlowTraceReplay::SetFlowCallback(FlowCallback cb)
+{
+    m_cb = cb;
+}
+
+void
+FlowTraceReplay::Start()
+{
+    uint64_t now = Simulator::Now().GetNanoSeconds();
+    while (m_next < m_reader.GetNFlows() && m_reader.Get(m_next).start < now)
+    {
+        m_next++;
+    }
+    if (m_next < m_reader.GetNFlows())
+    {
+        Simulator::Schedule(NanoSeconds(m_reader.Get(m_next).start - now), &FlowTraceReplay::Fire, this);
+    }
+}
+
+void
+FlowTraceReplay::Fire()
+{
+    uint64_t now = Simulator::Now().GetNanoSeconds();
+    uint64_t n = m_reader.GetNFlows();
+    while (m_next < n && m_reader.Get(m_next).start <= now)
+    {
+        m_cb(m_reader.Get(m_next));
+        m_next++;
+    }
+    m_reader.Release(m_next);
+    if (m_next < n)
+    {
+        Simulator::Schedule(NanoSeconds(m_reader.Get(m_next).start - now), &FlowTraceReplay::Fire, this);
+    }
+}
+
+} // namespace ns3
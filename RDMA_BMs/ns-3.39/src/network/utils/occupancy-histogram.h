@@ -0,0 +1,118 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef OCCUPANCY_HISTOGRAM_H
+#define OCCUPANCY_HISTOGRAM_H
+
+#include "log-buckets.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Time-weighted, log-bucketed histogram of a buffer occupancy.
+ *
+ * Buckets are HDR-style: values below 2^SUB_BITS get one bucket each, and every
+ * power of two above that is split into 2^SUB_BITS linear sub-buckets, so the
+ * relative error of a reported percentile is below 1/2^SUB_BITS (6.25%).
+ *
+ * Update() is O(1) (plus one compare per configured threshold) and credits the
+ * time since the previous update to the previous value. Percentiles are thus
+ * fractions of simulated time, not of packet events.
+ */
+class OccupancyHistogram
+{
+  public:
+    static const uint32_t SUB_BITS = 4;
+    static const uint32_t MAX_THRESHOLDS = 4;
+    typedef LogBuckets<SUB_BITS> Buckets;
+
+    OccupancyHistogram();
+
+    /**
+     * Set the byte levels for which the time spent strictly above is tracked.
+     * Must be called before the first Update(); at most MAX_THRESHOLDS levels are kept.
+     */
+    void SetThresholds(const std::vector<uint64_t>& thresholds);
+
+    /// The occupancy changed to value at time now (ns).
+    void Update(uint64_t value, uint64_t now)
+    {
+        uint64_t elapsed = now - m_lastTime;
+        if (elapsed > 0)
+        {
+            Buckets::Add(m_counts, m_value, elapsed);
+            for (uint32_t i = 0; i < m_nThresholds; i++)
+            {
+                if (m_value > m_thresholds[i])
+                {
+                    m_above[i] += elapsed;
+                }
+            }
+            m_total += elapsed;
+            m_lastTime = now;
+        }
+        m_value = value;
+        if (value > m_max)
+        {
+            m_max = value;
+        }
+    }
+
+    /// Credit the time up to now to the current value. Call before reading the results.
+    void Finish(uint64_t now)
+    {
+        Update(m_value, now);
+    }
+
+    /// Smallest bucket upper bound below which the occupancy stayed for a fraction p of the time.
+    uint64_t Percentile(double p) const;
+
+    uint64_t GetMax() const
+    {
+        return m_max;
+    }
+
+    /// Total time (ns) covered by the histogram
+    uint64_t GetTotalTime() const
+    {
+        return m_total;
+    }
+
+    uint32_t GetNThresholds() const
+    {
+        return m_nThresholds;
+    }
+
+    uint64_t GetThreshold(uint32_t i) const
+    {
+        return m_thresholds[i];
+    }
+
+    /// Time (ns) the occupancy spent above the i-th threshold
+    uint64_t GetTimeAbove(uint32_t i) const
+    {
+        return m_above[i];
+    }
+
+    /// True if the occupancy was ever non-zero
+    bool IsActive() const
+    {
+        return m_max > 0;
+    }
+
+  private:
+    std::vector<uint64_t> m_counts; //!< time (ns) per bucket, grown on demand
+    uint64_t m_value;
+    uint64_t m_lastTime;
+    uint64_t m_total;
+    uint64_t m_max;
+    uint32_t m_nThresholds;
+    uint64_t m_thresholds[MAX_THRESHOLDS];
+    uint64_t m_above[MAX_THRESHOLDS];
+};
+
+} // namespace ns3
+
+#endif /* OCCUPANCY_HISTOGRAM_H */
@@ -0,0 +1,259 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "pifo-queue.h"
+
+#include "rank-tag.h"
+
+#include "ns3/abort.h"
+#include "ns3/memory-stats.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+PifoQueue::PifoQueue()
+    : m_alg(RANK_SRPT),
+      m_nIdle(0),
+      m_sweepAt(64),
+      m_seq(0),
+      m_vtime(0),
+      m_nPackets(0),
+      m_nBytes(0)
+{
+}
+
+PifoQueue::~PifoQueue()
+{
+#ifdef ENABLE_MEMORY_STATS
+    for (const Flow& f : m_flows)
+    {
+        for (const Entry& e : f.pkts)
+        {
+            NS_MEMORY_STATS_REMOVE(QUEUED_PACKET, sizeof(Packet) + e.p->GetSize());
+        }
+    }
+#endif
+}
+
+void
+PifoQueue::SetRank(uint32_t alg)
+{
+    NS_ABORT_MSG_IF(alg > RANK_STFQ, "Unknown PIFO rank function " << alg);
+    m_alg = alg;
+}
+
+void
+PifoQueue::SetRankCallback(RankCallback cb)
+{
+    m_rankCb = cb;
+}
+
+uint64_t
+PifoQueue::Rank(Ptr<Packet> p, uint32_t flow, Flow& f)
+{
+    if (!m_rankCb.IsNull())
+    {
+        return m_rankCb(p, flow);
+    }
+    RankTag tag;
+    bool found = p->PeekPacketTag(tag);
+    switch (m_alg)
+    {
+    case RANK_SRPT:
+        return found ? tag.GetRemaining() : 0;
+    case RANK_LSTF:
+        return found ? tag.GetDeadline() : 0;
+    default: {
+        // start tag; weight 1, so the finish tag advances by the packet size
+        uint64_t start = std::max(m_vtime, f.finish);
+        f.finish = start + p->GetSize();
+        return start;
+    }
+    }
+}
+
+uint32_t
+PifoQueue::GetFlow(uint32_t id)
+{
+    auto it = m_index.find(id);
+    if (it != m_index.end())
+    {
+        return it->second;
+    }
+    uint32_t idx;
+    if (!m_free.empty())
+    {
+        idx = m_free.back();
+        m_free.pop_back();
+    }
+    else
+    {
+        idx = m_flows.size();
+        m_flows.emplace_back();
+    }
+    Flow& f = m_flows[idx];
+    f.id = id;
+    f.heapPos = -1;
+    f.finish = 0;
+    m_index[id] = idx;
+    m_nIdle++; // until its packet is pushed
+    return idx;
+}
+
+void
+PifoQueue::Enqueue(Ptr<Packet> p)
+{
+    RankTag tag;
+    uint32_t id = p->PeekPacketTag(tag) ? tag.GetFlow() : 0;
+    uint32_t idx = GetFlow(id);
+    Flow& f = m_flows[idx];
+
+    Key k = {Rank(p, id, f), m_seq++};
+    f.pkts.push_back(Entry{p, k.rank, k.seq});
+    while (!f.mins.empty() && f.mins.back().rank > k.rank)
+    {
+        f.mins.pop_back();
+    }
+    f.mins.push_back(k);
+
+    if (f.heapPos < 0)
+    {
+        m_nIdle--;
+        m_heap.push_back(idx);
+        f.heapPos = m_heap.size() - 1;
+        SiftUp(f.heapPos);
+    }
+    else if (f.mins.size() == 1)
+    {
+        SiftUp(f.heapPos); // the flow minimum decreased
+    }
+    m_nPackets++;
+    m_nBytes += p->GetSize();
+    NS_MEMORY_STATS_ADD(QUEUED_PACKET, sizeof(Packet) + p->GetSize());
+}
+
+Ptr<Packet>
+PifoQueue::Dequeue(void)
+{
+    if (m_heap.empty())
+    {
+        return 0;
+    }
+    uint32_t idx = m_heap[0];
+    Flow& f = m_flows[idx];
+    Entry e = f.pkts.front();
+    f.pkts.pop_front();
+    if (f.mins.front().seq == e.seq)
+    {
+        f.mins.pop_front();
+    }
+    if (m_alg == RANK_STFQ && m_rankCb.IsNull())
+    {
+        m_vtime = e.rank;
+    }
+    m_nPackets--;
+    m_nBytes -= e.p->GetSize();
+    NS_MEMORY_STATS_REMOVE(QUEUED_PACKET, sizeof(Packet) + e.p->GetSize());
+
+    if (f.pkts.empty())
+    {
+        uint32_t last = m_heap.back();
+        m_heap.pop_back();
+        f.heapPos = -1;
+        if (last != idx)
+        {
+            Place(0, last);
+            SiftDown(0);
+        }
+        Release(idx);
+    }
+    else
+    {
+        SiftDown(0); // the flow minimum can only have increased
+    }
+    return e.p;
+}
+
+// A flow without queued packets is forgotten, unless its STFQ finish tag is still ahead of the virtual time.
+void
+PifoQueue::Release(uint32_t idx)
+{
+    Flow& f = m_flows[idx];
+    if (m_alg == RANK_STFQ && m_rankCb.IsNull() && f.finish > m_vtime)
+    {
+        m_nIdle++;
+        if (m_nIdle > m_sweepAt)
+        {
+            // the flows that survive a sweep are not looked at again before their number doubles
+            Sweep();
+            m_sweepAt = std::max<uint32_t>(64, 2 * m_nIdle);
+        }
+        return;
+    }
+    m_index.erase(f.id);
+    m_free.push_back(idx);
+}
+
+void
+PifoQueue::Sweep(void)
+{
+    for (auto it = m_index.begin(); it != m_index.end();)
+    {
+        Flow& f = m_flows[it->second];
+        if (f.heapPos < 0 && f.finish <= m_vtime)
+        {
+            m_free.push_back(it->second);
+            it = m_index.erase(it);
+            m_nIdle--;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void
+PifoQueue::SiftUp(uint32_t pos)
+{
+    uint32_t idx = m_heap[pos];
+    while (pos > 0)
+    {
+        uint32_t parent = (pos - 1) / 2;
+        if (!Less(idx, m_heap[parent]))
+        {
+            break;
+        }
+        Place(pos, m_heap[parent]);
+        pos = parent;
+    }
+    Place(pos, idx);
+}
+
+void
+PifoQueue::SiftDown(uint32_t pos)
+{
+    uint32_t idx = m_heap[pos];
+    uint32_t n = m_heap.size();
+    while (true)
+    {
+        uint32_t child = 2 * pos + 1;
+        if (child >= n)
+        {
+            break;
+        }
+        if (child + 1 < n && Less(m_heap[child + 1], m_heap[child]))
+        {
+            child++;
+        }
+        if (!Less(m_heap[child], idx))
+        {
+            break;
+        }
+        Place(pos, m_heap[child]);
+        pos = child;
+    }
+    Place(pos, idx);
+}
+
+} // namespace ns3
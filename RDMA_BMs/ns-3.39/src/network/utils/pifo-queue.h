@@ -0,0 +1,127 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef PIFO_QUEUE_H
+#define PIFO_QUEUE_H
+
+#include "ns3/callback.h"
+#include "ns3/packet.h"
+
+#include <deque>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \brief Push-in first-out packet queue ordered by a per-packet rank.
+ *
+ * The rank is computed at enqueue from the RankTag of the packet: remaining flow
+ * size (SRPT, pFabric), deadline (least slack first), or a start-time fair queuing
+ * tag computed here; a callback may replace the built-in rank functions. Packets
+ * without a RankTag form flow 0 with rank 0.
+ *
+ * Packets of one flow never overtake each other: as in pFabric, Dequeue() picks the
+ * flow holding the smallest rank (ties in arrival order) and sends its earliest
+ * packet. Flows are kept in an indexed binary heap keyed by the minimum rank of their
+ * queued packets, so both operations are O(log active flows).
+ */
+class PifoQueue
+{
+  public:
+    enum
+    {
+        RANK_SRPT = 0,
+        RANK_LSTF = 1,
+        RANK_STFQ = 2
+    };
+
+    /// rank of a packet of the given flow, smaller is served first
+    typedef Callback<uint64_t, Ptr<const Packet>, uint32_t> RankCallback;
+
+    PifoQueue();
+    ~PifoQueue();
+
+    void SetRank(uint32_t alg);
+    void SetRankCallback(RankCallback cb);
+
+    void Enqueue(Ptr<Packet> p);
+    Ptr<Packet> Dequeue(void);
+
+    bool IsEmpty(void) const
+    {
+        return m_nPackets == 0;
+    }
+
+    uint32_t GetNPackets(void) const
+    {
+        return m_nPackets;
+    }
+
+    uint64_t GetNBytes(void) const
+    {
+        return m_nBytes;
+    }
+
+  private:
+    struct Key
+    {
+        uint64_t rank;
+        uint64_t seq; //!< arrival order, breaks ties
+    };
+
+    struct Entry
+    {
+        Ptr<Packet> p;
+        uint64_t rank;
+        uint64_t seq;
+    };
+
+    struct Flow
+    {
+        uint32_t id;
+        std::deque<Entry> pkts;
+        std::deque<Key> mins; //!< increasing ranks, front is the minimum of pkts
+        int32_t heapPos;      //!< -1 when the flow has no packet queued
+        uint64_t finish;      //!< STFQ finish tag of the last packet
+    };
+
+    uint64_t Rank(Ptr<Packet> p, uint32_t flow, Flow& f);
+    uint32_t GetFlow(uint32_t id);
+    void Release(uint32_t idx);
+    void Sweep(void);
+
+    bool Less(uint32_t a, uint32_t b) const
+    {
+        const Key& x = m_flows[a].mins.front();
+        const Key& y = m_flows[b].mins.front();
+        return x.rank < y.rank || (x.rank == y.rank && x.seq < y.seq);
+    }
+
+    void SiftUp(uint32_t pos);
+    void SiftDown(uint32_t pos);
+    void Place(uint32_t pos, uint32_t idx)
+    {
+        m_heap[pos] = idx;
+        m_flows[idx].heapPos = pos;
+    }
+
+    uint32_t m_alg;
+    RankCallback m_rankCb;
+
+    std::vector<Flow> m_flows;
+    std::vector<uint32_t> m_free;
+    std::unordered_map<uint32_t, uint32_t> m_index; //!< flow id -> m_flows index
+    std::vector<uint32_t> m_heap;                   //!< backlogged flows
+    uint32_t m_nIdle;                               //!< flows kept only for their STFQ finish tag
+    uint32_t m_sweepAt;                             //!< m_nIdle that triggers the next Sweep()
+
+    uint64_t m_seq;
+    uint64_t m_vtime; //!< STFQ virtual time, start tag of the last packet sent
+    uint32_t m_nPackets;
+    uint64_t m_nBytes;
+};
+
+} // namespace ns3
+
+#endif /* PIFO_QUEUE_H */
@@ -23,6 +23,7 @@
 #define QUEUE_H
 
 #include "ns3/log.h"
+#include "ns3/memory-stats.h"
 #include "ns3/object.h"
 #include "ns3/packet.h"
 #include "ns3/queue-fwd.h"
@@ -508,6 +509,13 @@ Queue<Item, Container>::Queue()
 template <typename Item, typename Container>
 Queue<Item, Container>::~Queue()
 {
+    // the packets of a queue destroyed without DoDispose (e.g. a BEgressQueue class queue)
+#ifdef ENABLE_MEMORY_STATS
+    for (const auto& item : m_packets)
+    {
+        NS_MEMORY_STATS_REMOVE(QUEUED_PACKET, sizeof(Item) + item->GetSize());
+    }
+#endif
 }
 
 template <typename Item, typename Container>
@@ -546,6 +554,7 @@ Queue<Item, Container>::DoEnqueue(ConstIterator pos, Ptr<Item> item, Iterator& r
 
     m_nPackets++;
     m_nTotalReceivedPackets++;
+    NS_MEMORY_STATS_ADD(QUEUED_PACKET, sizeof(Item) + size);
 
     NS_LOG_LOGIC("m_traceEnqueue (p)");
     m_traceEnqueue(item);
@@ -575,6 +584,7 @@ Queue<Item, Container>::DoDequeue(ConstIterator pos)
 
         m_nBytes -= item->GetSize();
         m_nPackets--;
+        NS_MEMORY_STATS_REMOVE(QUEUED_PACKET, sizeof(Item) + item->GetSize());
 
         NS_LOG_LOGIC("m_traceDequeue (p)");
         m_traceDequeue(item);
@@ -604,6 +614,7 @@ Queue<Item, Container>::DoRemove(ConstIterator pos)
 
         m_nBytes -= item->GetSize();
         m_nPackets--;
+        NS_MEMORY_STATS_REMOVE(QUEUED_PACKET, sizeof(Item) + item->GetSize());
 
         // packets are first dequeued and then dropped
         NS_LOG_LOGIC("m_traceDequeue (p)");
@@ -653,6 +664,7 @@ Queue<Item, Container>::DoRemovePushOut (ConstIterator pos)
 
       m_nBytes -= item->GetSize ();
       m_nPackets--;
+      NS_MEMORY_STATS_REMOVE (QUEUED_PACKET, sizeof (Item) + item->GetSize ());
 
       DropAfterEnqueue(item);
     }
@@ -679,6 +691,12 @@ void
 Queue<Item, Container>::DoDispose()
 {
     NS_LOG_FUNCTION(this);
+#ifdef ENABLE_MEMORY_STATS
+    for (const auto& item : m_packets)
+    {
+        NS_MEMORY_STATS_REMOVE(QUEUED_PACKET, sizeof(Item) + item->GetSize());
+    }
+#endif
     m_packets.clear();
     Object::DoDispose();
 }
@@ -0,0 +1,64 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "rank-tag.h"
+
+namespace ns3
+{
+
+NS_OBJECT_ENSURE_REGISTERED(RankTag);
+
+TypeId
+RankTag::GetTypeId(void)
+{
+    static TypeId tid = TypeId("ns3::RankTag").SetParent<Tag>().AddConstructor<RankTag>();
+    return tid;
+}
+
+TypeId
+RankTag::GetInstanceTypeId(void) const
+{
+    return GetTypeId();
+}
+
+RankTag::RankTag()
+    : m_flow(0),
+      m_remaining(0),
+      m_deadline(0)
+{
+}
+
+RankTag::RankTag(uint32_t flow, uint64_t remaining, uint64_t deadline)
+    : m_flow(flow),
+      m_remaining(remaining),
+      m_deadline(deadline)
+{
+}
+
+uint32_t
+RankTag::GetSerializedSize(void) const
+{
+    return 20;
+}
+
+void
+RankTag::Serialize(TagBuffer i) const
+{
+    i.WriteU32(m_flow);
+    i.WriteU64(m_remaining);
+    i.WriteU64(m_deadline);
+}
+
+void
+RankTag::Deserialize(TagBuffer i)
+{
+    m_flow = i.ReadU32();
+    m_remaining = i.ReadU64();
+    m_deadline = i.ReadU64();
+}
+
+void
+RankTag::Print(std::ostream& os) const
+{
+    os << "flow=" << m_flow << " remaining=" << m_remaining << " deadline=" << m_deadline;
+}
+
+} // namespace ns3
@@ -0,0 +1,56 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef RANK_TAG_H
+#define RANK_TAG_H
+
+#include "ns3/tag.h"
+#include "ns3/packet.h"
+#include <iostream>
+
+namespace ns3
+{
+
+/**
+ * \brief Flow state stamped by the sender for the rank functions of PifoQueue.
+ *
+ * flow identifies the flow at the switch, remaining is the number of flow bytes not
+ * sent yet including this packet (SRPT), and deadline is the absolute time in ns by
+ * which the flow should complete (least slack: with a global clock the slack left at
+ * any hop orders packets the same way as their deadline).
+ */
+class RankTag : public Tag
+{
+  public:
+    static TypeId GetTypeId(void);
+    virtual TypeId GetInstanceTypeId(void) const;
+    virtual uint32_t GetSerializedSize(void) const;
+    virtual void Serialize(TagBuffer i) const;
+    virtual void Deserialize(TagBuffer i);
+    virtual void Print(std::ostream& os) const;
+
+    RankTag();
+    RankTag(uint32_t flow, uint64_t remaining, uint64_t deadline);
+
+    uint32_t GetFlow(void) const
+    {
+        return m_flow;
+    }
+
+    uint64_t GetRemaining(void) const
+    {
+        return m_remaining;
+    }
+
+    uint64_t GetDeadline(void) const
+    {
+        return m_deadline;
+    }
+
+  private:
+    uint32_t m_flow;
+    uint64_t m_remaining;
+    uint64_t m_deadline;
+};
+
+} // namespace ns3
+
+#endif /* RANK_TAG_H */
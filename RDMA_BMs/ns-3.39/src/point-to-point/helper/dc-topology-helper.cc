@@ -0,0 +1,636 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+#include "ns3/pointer.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-list-routing.h"
+#include "ns3/ipv4-global-routing.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/switch-node.h"
+#include "ns3/rdma-driver.h"
+#include "dc-topology-helper.h"
+
+NS_LOG_COMPONENT_DEFINE ("DcTopologyHelper");
+
+namespace ns3 {
+
+namespace {
+
+const uint8_t UNREACHABLE = 0xff;
+
+/// Address of end side (0 or 1) of link l, as Ipv4AddressHelper gave them in the examples
+Ipv4Address
+LinkAddress (uint32_t l, uint32_t side)
+{
+  return Ipv4Address (0x0a000000 + ((l / 254 + 1) << 16) + ((l % 254 + 1) << 8) + side + 1);
+}
+
+Ptr<Ipv4GlobalRouting>
+GetGlobalRouting (Ptr<Ipv4> ipv4)
+{
+  Ptr<Ipv4RoutingProtocol> rp = ipv4->GetRoutingProtocol ();
+  Ptr<Ipv4GlobalRouting> gr = DynamicCast<Ipv4GlobalRouting> (rp);
+  Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting> (rp);
+  for (uint32_t i = 0; !gr && list && i < list->GetNRoutingProtocols (); i++)
+    {
+      int16_t priority;
+      gr = DynamicCast<Ipv4GlobalRouting> (list->GetRoutingProtocol (i, priority));
+    }
+  return gr;
+}
+
+} // namespace
+
+DcTopologyHelper::DcTopologyHelper ()
+  : m_linksPerPair (1)
+{
+  for (uint32_t t = 0; t < N_TIERS; t++)
+    {
+      m_count[t] = 0;
+      m_tierRate[t] = DataRate ("100Gbps");
+      m_tierDelay[t] = MicroSeconds (1);
+    }
+}
+
+void
+DcTopologyHelper::Reset (uint32_t nodes)
+{
+  m_tier.clear ();
+  m_tier.reserve (nodes);
+  m_links.clear ();
+  for (uint32_t t = 0; t < N_TIERS; t++)
+    {
+      m_count[t] = 0;
+    }
+}
+
+uint32_t
+DcTopologyHelper::AddNodes (Tier tier, uint32_t n)
+{
+  uint32_t first = m_tier.size ();
+  m_tier.resize (first + n, tier);
+  m_count[tier] += n;
+  return first;
+}
+
+void
+DcTopologyHelper::AddLink (uint32_t a, uint32_t b, Tier lower)
+{
+  AddLink (a, b, m_tierRate[lower], m_tierDelay[lower], 0);
+}
+
+void
+DcTopologyHelper::AddLink (uint32_t a, uint32_t b, DataRate rate, Time delay, double errorRate)
+{
+  Link link;
+  link.a = a;
+  link.b = b;
+  link.rate = rate;
+  link.delay = delay;
+  link.errorRate = errorRate;
+  m_links.push_back (link);
+}
+
+void
+DcTopologyHelper::SetLeafSpine (uint32_t hostsPerLeaf, uint32_t leaves, uint32_t spines, uint32_t linksPerPair)
+{
+  SetClos (hostsPerLeaf, leaves, spines, 1, 0, linksPerPair);
+}
+
+void
+DcTopologyHelper::SetClos (uint32_t hostsPerLeaf, uint32_t leavesPerPod, uint32_t spinesPerPod, uint32_t pods,
+                           uint32_t coresPerSpine, uint32_t linksPerPair)
+{
+  NS_ABORT_MSG_IF (pods > 1 && coresPerSpine == 0, "DcTopologyHelper: pods are not connected without cores");
+  NS_ABORT_MSG_IF (linksPerPair == 0, "DcTopologyHelper: linksPerPair must be at least 1");
+  uint32_t leaves = leavesPerPod * pods;
+  uint32_t spines = spinesPerPod * pods;
+  uint32_t cores = spinesPerPod * coresPerSpine;
+  Reset (hostsPerLeaf * leaves + leaves + spines + cores);
+  m_linksPerPair = linksPerPair;
+  uint32_t host0 = AddNodes (HOST, hostsPerLeaf * leaves);
+  uint32_t leaf0 = AddNodes (LEAF, leaves);
+  uint32_t spine0 = AddNodes (SPINE, spines);
+  uint32_t core0 = AddNodes (CORE, cores);
+
+  m_links.reserve (hostsPerLeaf * leaves + (leavesPerPod + coresPerSpine) * spines * linksPerPair);
+  for (uint32_t l = 0; l < leaves; l++)
+    {
+      for (uint32_t h = 0; h < hostsPerLeaf; h++)
+        {
+          AddLink (host0 + l * hostsPerLeaf + h, leaf0 + l, HOST);
+        }
+    }
+  for (uint32_t p = 0; p < pods; p++)
+    {
+      for (uint32_t l = 0; l < leavesPerPod; l++)
+        {
+          for (uint32_t s = 0; s < spinesPerPod; s++)
+            {
+              for (uint32_t x = 0; x < linksPerPair; x++)
+                {
+                  AddLink (leaf0 + p * leavesPerPod + l, spine0 + p * spinesPerPod + s, LEAF);
+                }
+            }
+        }
+    }
+  for (uint32_t p = 0; p < pods; p++)
+    {
+      for (uint32_t s = 0; s < spinesPerPod; s++)
+        {
+          for (uint32_t c = 0; c < coresPerSpine; c++)
+            {
+              for (uint32_t x = 0; x < linksPerPair; x++)
+                {
+                  AddLink (spine0 + p * spinesPerPod + s, core0 + s * coresPerSpine + c, SPINE);
+                }
+            }
+        }
+    }
+}
+
+void
+DcTopologyHelper::SetFatTree (uint32_t k)
+{
+  NS_ABORT_MSG_IF (k < 2 || k % 2, "DcTopologyHelper: the fat-tree k must be even");
+  SetClos (k / 2, k / 2, k / 2, k, k / 2);
+}
+
+void
+DcTopologyHelper::SetShape (std::string shape)
+{
+  std::string::size_type colon = shape.find (':');
+  NS_ABORT_MSG_IF (colon == std::string::npos, "DcTopologyHelper: bad shape " << shape);
+  std::string name = shape.substr (0, colon);
+  std::vector<uint32_t> args;
+  std::istringstream is (shape.substr (colon + 1));
+  std::string arg;
+  while (std::getline (is, arg, ','))
+    {
+      args.push_back (std::stoul (arg));
+    }
+  if (name == "fattree" && args.size () == 1)
+    {
+      SetFatTree (args[0]);
+    }
+  else if (name == "leafspine" && (args.size () == 3 || args.size () == 4))
+    {
+      SetLeafSpine (args[0], args[1], args[2], args.size () == 4 ? args[3] : 1);
+    }
+  else if (name == "clos" && (args.size () == 5 || args.size () == 6))
+    {
+      SetClos (args[0], args[1], args[2], args[3], args[4], args.size () == 6 ? args[5] : 1);
+    }
+  else
+    {
+      NS_FATAL_ERROR ("DcTopologyHelper: bad shape " << shape);
+    }
+}
+
+void
+DcTopologyHelper::SetTierLink (Tier lower, DataRate rate, Time delay)
+{
+  m_tierRate[lower] = rate;
+  m_tierDelay[lower] = delay;
+  // the links of a shape that is already set
+  for (uint32_t l = 0; l < m_links.size (); l++)
+    {
+      if (std::min (m_tier[m_links[l].a], m_tier[m_links[l].b]) == lower)
+        {
+          m_links[l].rate = rate;
+          m_links[l].delay = delay;
+        }
+    }
+}
+
+void
+DcTopologyHelper::SetErrorModel (Ptr<ErrorModel> em)
+{
+  m_errorModel = em;
+}
+
+void
+DcTopologyHelper::LoadFile (std::istream &is)
+{
+  uint32_t nodes, switches, leaves, links;
+  uint64_t hostRate, fabricRate;
+  is >> nodes >> switches >> leaves >> links >> hostRate >> fabricRate;
+  NS_ABORT_MSG_IF (!is, "DcTopologyHelper: bad topology file header");
+  Reset (nodes);
+  AddNodes (HOST, nodes);
+  for (uint32_t i = 0; i < switches; i++)
+    {
+      uint32_t sid;
+      is >> sid;
+      NS_ABORT_MSG_IF (sid >= nodes, "DcTopologyHelper: bad switch id " << sid);
+      Tier tier = i < leaves ? LEAF : SPINE;
+      m_tier[sid] = tier;
+      m_count[HOST]--;
+      m_count[tier]++;
+    }
+  m_tierRate[HOST] = DataRate (hostRate);
+  m_tierRate[LEAF] = DataRate (fabricRate);
+
+  m_links.reserve (links);
+  for (uint32_t i = 0; i < links; i++)
+    {
+      uint32_t src, dst;
+      std::string rate, delay;
+      double errorRate;
+      is >> src >> dst >> rate >> delay >> errorRate;
+      NS_ABORT_MSG_IF (!is || src >= nodes || dst >= nodes, "DcTopologyHelper: bad link " << i);
+      AddLink (src, dst, DataRate (rate), Time (delay), errorRate);
+    }
+  uint32_t pairs = m_count[LEAF] * m_count[SPINE];
+  m_linksPerPair = pairs ? (links - m_count[HOST]) / pairs : 1;
+}
+
+NodeContainer
+DcTopologyHelper::Build (QbbHelper &qbb)
+{
+  uint32_t n = m_tier.size ();
+  m_nodes = NodeContainer ();
+  m_ports.assign (n, std::vector<Port> ());
+  m_hosts.clear ();
+  m_hostIndex.assign (n, 0);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      if (m_tier[i] == HOST)
+        {
+          m_hostIndex[i] = m_hosts.size ();
+          m_hosts.push_back (i);
+          m_nodes.Add (CreateObject<Node> ());
+        }
+      else
+        {
+          Ptr<SwitchNode> sw = CreateObject<SwitchNode> ();
+          sw->SetNodeType (1);
+          m_nodes.Add (sw);
+        }
+    }
+
+  InternetStackHelper internet;
+  Ipv4GlobalRoutingHelper globalRoutingHelper;
+  internet.SetRoutingHelper (globalRoutingHelper);
+  internet.Install (m_nodes);
+
+  std::vector<Ptr<Ipv4> > ipv4 (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      ipv4[i] = m_nodes.Get (i)->GetObject<Ipv4> ();
+    }
+
+  NS_ABORT_MSG_IF (m_links.size () > 254 * 255, "DcTopologyHelper: too many links for the 10.x.y.0/24 link addresses");
+  DataRate rate;
+  Time delay (-1);
+  for (uint32_t l = 0; l < m_links.size (); l++)
+    {
+      Link &link = m_links[l];
+      // only touch the factories when the attributes change
+      if (link.rate != rate)
+        {
+          rate = link.rate;
+          qbb.SetDeviceAttribute ("DataRate", DataRateValue (rate));
+        }
+      if (link.delay != delay)
+        {
+          delay = link.delay;
+          qbb.SetChannelAttribute ("Delay", TimeValue (delay));
+        }
+      if (link.errorRate > 0)
+        {
+          Ptr<RateErrorModel> rem = CreateObject<RateErrorModel> ();
+          Ptr<UniformRandomVariable> uv = CreateObject<UniformRandomVariable> ();
+          rem->SetRandomVariable (uv);
+          uv->SetStream (50);
+          rem->SetAttribute ("ErrorRate", DoubleValue (link.errorRate));
+          rem->SetAttribute ("ErrorUnit", StringValue ("ERROR_UNIT_PACKET"));
+          qbb.SetDeviceAttribute ("ReceiveErrorModel", PointerValue (rem));
+        }
+      else if (l == 0 || m_links[l - 1].errorRate > 0)
+        {
+          qbb.SetDeviceAttribute ("ReceiveErrorModel", PointerValue (m_errorModel));
+        }
+
+      NetDeviceContainer d = qbb.Install (m_nodes.Get (link.a), m_nodes.Get (link.b));
+      link.aDev = DynamicCast<QbbNetDevice> (d.Get (0));
+      link.bDev = DynamicCast<QbbNetDevice> (d.Get (1));
+      uint32_t end[2] = {link.a, link.b};
+      Ptr<QbbNetDevice> dev[2] = {link.aDev, link.bDev};
+      uint32_t port[2] = {static_cast<uint32_t> (m_ports[link.a].size ()),
+                          static_cast<uint32_t> (m_ports[link.b].size ())};
+      for (uint32_t side = 0; side < 2; side++)
+        {
+          uint32_t x = end[side];
+          int32_t intf = ipv4[x]->AddInterface (dev[side]);
+          // the host address first, the routing is based on the primary address
+          if (m_tier[x] == HOST && port[side] == 0)
+            {
+              ipv4[x]->AddAddress (intf, Ipv4InterfaceAddress (GetHostAddress (x), Ipv4Mask (0xff000000)));
+            }
+          ipv4[x]->AddAddress (intf, Ipv4InterfaceAddress (LinkAddress (l, side), Ipv4Mask (0xffffff00)));
+          ipv4[x]->SetMetric (intf, 1);
+          ipv4[x]->SetUp (intf);
+
+          Port p;
+          p.peer = end[1 - side];
+          p.peerPort = port[1 - side];
+          p.link = l;
+          p.ipv4If = intf;
+          p.dev = dev[side];
+          m_ports[x].push_back (p);
+        }
+    }
+  return m_nodes;
+}
+
+void
+DcTopologyHelper::PopulateRoutes (uint32_t mtu)
+{
+  uint32_t n = m_tier.size ();
+  uint32_t hosts = m_hosts.size ();
+  NS_ABORT_MSG_IF (m_ports.size () != n, "DcTopologyHelper: PopulateRoutes before Build");
+
+  std::vector<Ptr<SwitchNode> > sw (n);
+  std::vector<Ptr<RdmaHw> > rdma (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      if (m_tier[i] != HOST)
+        {
+          sw[i] = DynamicCast<SwitchNode> (m_nodes.Get (i));
+        }
+      else if (Ptr<RdmaDriver> driver = m_nodes.Get (i)->GetObject<RdmaDriver> ())
+        {
+          rdma[i] = driver->m_rdma;
+        }
+    }
+
+  // group the hosts by the switch of their single link
+  std::vector<uint32_t> rootGroup (n, std::numeric_limits<uint32_t>::max ());
+  m_hostGroup.assign (hosts, 0);
+  m_groupRoot.clear ();
+  m_groupHosts.clear ();
+  m_hostDelay.assign (hosts, 0);
+  m_hostTxDelay.assign (hosts, 0);
+  m_hostBw.assign (hosts, std::numeric_limits<uint64_t>::max ());
+  for (uint32_t hi = 0; hi < hosts; hi++)
+    {
+      uint32_t host = m_hosts[hi];
+      const std::vector<Port> &ports = m_ports[host];
+      uint32_t root = host;
+      if (ports.size () == 1 && m_tier[ports[0].peer] != HOST)
+        {
+          const Link &link = m_links[ports[0].link];
+          root = ports[0].peer;
+          m_hostDelay[hi] = link.delay.GetTimeStep ();
+          m_hostTxDelay[hi] = mtu * 1000000000lu * 8 / link.rate.GetBitRate ();
+          m_hostBw[hi] = link.rate.GetBitRate ();
+        }
+      if (rootGroup[root] == std::numeric_limits<uint32_t>::max ())
+        {
+          rootGroup[root] = m_groupRoot.size ();
+          m_groupRoot.push_back (root);
+          m_groupHosts.push_back (std::vector<uint32_t> ());
+        }
+      m_hostGroup[hi] = rootGroup[root];
+      m_groupHosts[rootGroup[root]].push_back (host);
+    }
+
+  uint32_t groups = m_groupRoot.size ();
+  m_dist.assign (uint64_t (groups) * n, UNREACHABLE);
+  m_groupDelay.assign (uint64_t (groups) * groups, 0);
+  m_groupTxDelay.assign (uint64_t (groups) * groups, 0);
+  m_groupBw.assign (uint64_t (groups) * groups, 0);
+  std::vector<uint32_t> q;
+  q.reserve (n);
+  std::vector<uint64_t> delay (n);
+  std::vector<uint64_t> txDelay (n);
+  std::vector<uint64_t> bw (n);
+  std::vector<Ipv4Address> dstAddr;
+
+  for (uint32_t g = 0; g < groups; g++)
+    {
+      uint32_t root = m_groupRoot[g];
+      dstAddr.clear ();
+      for (uint32_t host : m_groupHosts[g])
+        {
+          dstAddr.push_back (GetHostAddress (host));
+        }
+      // a leaf reaches its hosts directly
+      for (const Port &port : m_ports[root])
+        {
+          if (sw[root] && m_tier[port.peer] == HOST && m_hostGroup[m_hostIndex[port.peer]] == g)
+            {
+              Ipv4Address addr = GetHostAddress (port.peer);
+              sw[root]->AddTableEntry (addr, port.dev->GetIfIndex ());
+            }
+        }
+      uint8_t *dist = &m_dist[uint64_t (g) * n];
+      q.clear ();
+      q.push_back (root);
+      dist[root] = 0;
+      delay[root] = 0;
+      txDelay[root] = 0;
+      bw[root] = std::numeric_limits<uint64_t>::max ();
+      for (uint32_t i = 0; i < q.size (); i++)
+        {
+          uint32_t now = q[i];
+          uint32_t d = dist[now];
+          for (const Port &port : m_ports[now])
+            {
+              uint32_t next = port.peer;
+              const Link &link = m_links[port.link];
+              if (dist[next] == UNREACHABLE)
+                {
+                  dist[next] = d + 1;
+                  delay[next] = delay[now] + link.delay.GetTimeStep ();
+                  txDelay[next] = txDelay[now] + mtu * 1000000000lu * 8 / link.rate.GetBitRate ();
+                  bw[next] = std::min (bw[now], link.rate.GetBitRate ());
+                  // only switches are enqueued, hosts do not forward
+                  if (m_tier[next] != HOST)
+                    {
+                      q.push_back (next);
+                    }
+                }
+              // now is on a shortest path from next to the hosts of the group
+              if (dist[next] == d + 1)
+                {
+                  uint32_t ifIndex = m_ports[next][port.peerPort].dev->GetIfIndex ();
+                  for (uint32_t h = 0; h < dstAddr.size (); h++)
+                    {
+                      if (m_groupHosts[g][h] == next)
+                        {
+                          continue;
+                        }
+                      if (sw[next])
+                        {
+                          sw[next]->AddTableEntry (dstAddr[h], ifIndex);
+                        }
+                      else if (rdma[next])
+                        {
+                          rdma[next]->AddTableEntry (dstAddr[h], ifIndex);
+                        }
+                    }
+                }
+            }
+        }
+      for (uint32_t src = 0; src < groups; src++)
+        {
+          uint32_t srcRoot = m_groupRoot[src];
+          if (dist[srcRoot] != UNREACHABLE)
+            {
+              uint64_t idx = uint64_t (src) * groups + g;
+              m_groupDelay[idx] = delay[srcRoot];
+              m_groupTxDelay[idx] = txDelay[srcRoot];
+              m_groupBw[idx] = bw[srcRoot];
+            }
+        }
+    }
+}
+
+int64_t
+DcTopologyHelper::GroupPairIndex (uint32_t src, uint32_t dst) const
+{
+  uint32_t gs = m_hostGroup[m_hostIndex[src]];
+  uint32_t gd = m_hostGroup[m_hostIndex[dst]];
+  if (m_dist[uint64_t (gd) * m_tier.size () + m_groupRoot[gs]] == UNREACHABLE)
+    {
+      return -1;
+    }
+  return int64_t (gs) * m_groupRoot.size () + gd;
+}
+
+uint64_t
+DcTopologyHelper::GetPairDelay (uint32_t src, uint32_t dst) const
+{
+  int64_t idx = GroupPairIndex (src, dst);
+  if (src == dst || idx < 0)
+    {
+      return 0;
+    }
+  return m_hostDelay[m_hostIndex[src]] + m_groupDelay[idx] + m_hostDelay[m_hostIndex[dst]];
+}
+
+uint64_t
+DcTopologyHelper::GetPairTxDelay (uint32_t src, uint32_t dst) const
+{
+  int64_t idx = GroupPairIndex (src, dst);
+  if (src == dst || idx < 0)
+    {
+      return 0;
+    }
+  return m_hostTxDelay[m_hostIndex[src]] + m_groupTxDelay[idx] + m_hostTxDelay[m_hostIndex[dst]];
+}
+
+uint64_t
+DcTopologyHelper::GetPairBw (uint32_t src, uint32_t dst) const
+{
+  int64_t idx = GroupPairIndex (src, dst);
+  if (src == dst)
+    {
+      return std::numeric_limits<uint64_t>::max ();
+    }
+  if (idx < 0)
+    {
+      return 0;
+    }
+  return std::min (std::min (m_hostBw[m_hostIndex[src]], m_groupBw[idx]), m_hostBw[m_hostIndex[dst]]);
+}
+
+int64_t
+DcTopologyHelper::AssignStreams (int64_t stream)
+{
+  int64_t currentStream = stream;
+  for (uint32_t i = 0; i < m_nodes.GetN (); i++)
+    {
+      Ptr<SwitchNode> sw = DynamicCast<SwitchNode> (m_nodes.Get (i));
+      if (sw)
+        {
+          currentStream += sw->AssignStreams (currentStream);
+        }
+    }
+  return currentStream - stream;
+}
+
+void
+DcTopologyHelper::PopulateGlobalRouting ()
+{
+  // a route to all the hosts (11.0.0.0/8) through every uplink, the switches do the rest
+  for (uint32_t host : m_hosts)
+    {
+      Ptr<Ipv4GlobalRouting> gr = GetGlobalRouting (m_nodes.Get (host)->GetObject<Ipv4> ());
+      NS_ABORT_MSG_IF (!gr, "DcTopologyHelper: node " << host << " has no Ipv4GlobalRouting");
+      for (const Port &port : m_ports[host])
+        {
+          uint32_t peerSide = m_links[port.link].a == port.peer ? 0 : 1;
+          gr->AddNetworkRouteTo (Ipv4Address (0x0b000000), Ipv4Mask (0xff000000),
+                                 LinkAddress (port.link, peerSide), port.ipv4If);
+        }
+    }
+}
+
+Ipv4Address
+DcTopologyHelper::GetHostAddress (uint32_t node)
+{
+  return Ipv4Address (0x0b000001 + ((node / 256) * 0x00010000) + ((node % 256) * 0x00000100));
+}
+
+uint32_t
+DcTopologyHelper::GetHostNode (Ipv4Address addr)
+{
+  return (addr.Get () >> 8) & 0xffff;
+}
+
+NodeContainer
+DcTopologyHelper::GetNodes (Tier tier) const
+{
+  NodeContainer c;
+  for (uint32_t i = 0; i < m_nodes.GetN (); i++)
+    {
+      if (m_tier[i] == tier)
+        {
+          c.Add (m_nodes.Get (i));
+        }
+    }
+  return c;
+}
+
+uint32_t
+DcTopologyHelper::GetHostsPerLeaf () const
+{
+  return m_count[LEAF] ? m_count[HOST] / m_count[LEAF] : m_count[HOST];
+}
+
+std::vector<uint32_t>
+DcTopologyHelper::GetNextHops (uint32_t node, uint32_t dst) const
+{
+  std::vector<uint32_t> hops;
+  uint32_t g = m_hostGroup[m_hostIndex[dst]];
+  const uint8_t *dist = &m_dist[uint64_t (g) * m_tier.size ()];
+  // hops to dst: one more than to the group root, unless dst is the root
+  uint32_t extra = m_groupRoot[g] == dst ? 0 : 1;
+  if (node == dst || dist[node] == UNREACHABLE)
+    {
+      return hops;
+    }
+  for (uint32_t p = 0; p < m_ports[node].size (); p++)
+    {
+      uint32_t peer = m_ports[node][p].peer;
+      if (peer == dst ? dist[node] + extra == 1
+                      : m_tier[peer] != HOST && dist[peer] + 1 == dist[node])
+        {
+          hops.push_back (p);
+        }
+    }
+  return hops;
+}
+
+} // namespace ns3
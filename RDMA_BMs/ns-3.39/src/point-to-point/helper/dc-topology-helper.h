@@ -0,0 +1,171 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef DC_TOPOLOGY_HELPER_H
+#define DC_TOPOLOGY_HELPER_H
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "ns3/data-rate.h"
+#include "ns3/error-model.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+#include "ns3/qbb-helper.h"
+#include "ns3/qbb-net-device.h"
+
+namespace ns3 {
+
+/**
+ * \brief Build leaf-spine, 3-tier Clos and k-ary fat-tree data center networks of
+ * QbbNetDevices in bulk, and fill their routing tables.
+ *
+ * The shape is set with SetLeafSpine, SetClos, SetFatTree or SetShape, or read with
+ * LoadFile from the topology file format of the examples. Build then creates the nodes
+ * (hosts first, grouped by leaf, then leaves, spines and cores; switches are SwitchNodes),
+ * the internet stack and the links. Addresses come from the node and link index:
+ * host i is GetHostAddress (i) and link l gets 10.(l/254+1).(l%254+1).{1,2}/24, so no
+ * address allocator is involved.
+ *
+ * PopulateRoutes runs one BFS over the switches per leaf, or per host that is not attached
+ * to a single switch, and adds the shortest paths (all of them, ECMP, parallel links
+ * included) to the SwitchNode and RdmaHw tables; it also keeps the delay, tx delay and
+ * bottleneck rate between these BFS roots, from which those of the host pairs are computed,
+ * so the memory grows with the square of the leaves rather than of the hosts. It has to run
+ * after the RdmaDrivers are installed. PopulateGlobalRouting gives every host a route to
+ * the hosts through its uplinks, which replaces Ipv4GlobalRoutingHelper::PopulateRoutingTables
+ * (switches forward on their own tables and never look at their Ipv4 routing).
+ *
+ * Node indices are positions in GetNodes (); they are the node ids when the topology is
+ * built before any other node.
+ */
+class DcTopologyHelper
+{
+public:
+  enum Tier
+  {
+    HOST = 0,
+    LEAF,
+    SPINE,
+    CORE,
+    N_TIERS
+  };
+
+  struct Link
+  {
+    uint32_t a; //!< node index, the lower tier end of a generated shape
+    uint32_t b;
+    DataRate rate;
+    Time delay;
+    double errorRate;
+    Ptr<QbbNetDevice> aDev; //!< set by Build
+    Ptr<QbbNetDevice> bDev;
+  };
+
+  struct Port
+  {
+    uint32_t peer; //!< node index at the other end
+    uint32_t peerPort; //!< index of the port at the other end
+    uint32_t link; //!< index in GetLinks ()
+    uint32_t ipv4If; //!< Ipv4 interface of the device
+    Ptr<QbbNetDevice> dev;
+  };
+
+  DcTopologyHelper ();
+
+  /// hostsPerLeaf hosts under each of leaves leaves, every leaf connected to every spine
+  void SetLeafSpine (uint32_t hostsPerLeaf, uint32_t leaves, uint32_t spines, uint32_t linksPerPair = 1);
+  /**
+   * pods of leavesPerPod leaves and spinesPerPod spines, every leaf connected to every
+   * spine of its pod. Spine j of every pod is connected to cores j*coresPerSpine to
+   * (j+1)*coresPerSpine-1.
+   */
+  void SetClos (uint32_t hostsPerLeaf, uint32_t leavesPerPod, uint32_t spinesPerPod, uint32_t pods,
+                uint32_t coresPerSpine, uint32_t linksPerPair = 1);
+  /// k pods of k/2 leaves and k/2 spines, (k/2)^2 cores, k^3/4 hosts
+  void SetFatTree (uint32_t k);
+  /// "leafspine:hostsPerLeaf,leaves,spines[,linksPerPair]", "fattree:k" or
+  /// "clos:hostsPerLeaf,leavesPerPod,spinesPerPod,pods,coresPerSpine[,linksPerPair]"
+  void SetShape (std::string shape);
+  /// Rate and delay of the links from lower to the tier above it (default 100Gbps, 1us)
+  void SetTierLink (Tier lower, DataRate rate, Time delay);
+  /// Error model of the devices of links whose errorRate is 0 (default none)
+  void SetErrorModel (Ptr<ErrorModel> em);
+  /**
+   * Reads the topology file of the examples: "nodes switches leaves links hostRate fabricRate",
+   * the switch ids (leaves first), then one "src dst rate delay errorRate" line per link.
+   */
+  void LoadFile (std::istream &is);
+
+  /// Creates the nodes, the internet stack, the devices and the addresses
+  NodeContainer Build (QbbHelper &qbb);
+  /// Fills the SwitchNode and RdmaHw tables and the pair metrics; mtu gives the tx delay
+  void PopulateRoutes (uint32_t mtu);
+  void PopulateGlobalRouting ();
+  /// Assigns fixed random streams to the switches, returns the number of streams used
+  int64_t AssignStreams (int64_t stream);
+
+  static Ipv4Address GetHostAddress (uint32_t node);
+  static uint32_t GetHostNode (Ipv4Address addr);
+
+  const NodeContainer &GetNodes () const { return m_nodes; }
+  NodeContainer GetNodes (Tier tier) const;
+  uint32_t GetN () const { return m_tier.size (); }
+  uint32_t GetN (Tier tier) const { return m_count[tier]; }
+  Tier GetTier (uint32_t node) const { return Tier (m_tier[node]); }
+  uint32_t GetHostsPerLeaf () const;
+  uint32_t GetLinksPerPair () const { return m_linksPerPair; }
+  DataRate GetTierRate (Tier lower) const { return m_tierRate[lower]; }
+  const std::vector<Link> &GetLinks () const { return m_links; }
+  const std::vector<Port> &GetPorts (uint32_t node) const { return m_ports[node]; }
+
+  /// Next hops from node towards host dst, as indices in GetPorts (node)
+  std::vector<uint32_t> GetNextHops (uint32_t node, uint32_t dst) const;
+  /// Propagation delay in ns from host src to host dst, along a shortest path
+  uint64_t GetPairDelay (uint32_t src, uint32_t dst) const;
+  /// Store and forward delay in ns of an mtu sized packet from src to dst
+  uint64_t GetPairTxDelay (uint32_t src, uint32_t dst) const;
+  /// Bottleneck rate in bps from src to dst
+  uint64_t GetPairBw (uint32_t src, uint32_t dst) const;
+
+private:
+  void Reset (uint32_t nodes);
+  uint32_t AddNodes (Tier tier, uint32_t n);
+  void AddLink (uint32_t a, uint32_t b, Tier lower);
+  void AddLink (uint32_t a, uint32_t b, DataRate rate, Time delay, double errorRate);
+  /// Index of the metrics from the group of host src to the group of host dst, or -1 if dst
+  /// cannot be reached
+  int64_t GroupPairIndex (uint32_t src, uint32_t dst) const;
+
+  std::vector<uint8_t> m_tier;
+  uint32_t m_count[N_TIERS];
+  uint32_t m_linksPerPair;
+  DataRate m_tierRate[N_TIERS];
+  Time m_tierDelay[N_TIERS];
+  Ptr<ErrorModel> m_errorModel;
+  std::vector<Link> m_links;
+
+  NodeContainer m_nodes;
+  std::vector<std::vector<Port> > m_ports;
+  std::vector<uint32_t> m_hosts; //!< node index of every host
+  std::vector<uint32_t> m_hostIndex; //!< position in m_hosts of a host node
+
+  // The hosts attached to the same single switch (a leaf) share a group, whose BFS starts at
+  // that switch; any other host is a group of its own.
+  std::vector<uint32_t> m_hostGroup; //!< group of every host index
+  std::vector<uint32_t> m_groupRoot; //!< node the BFS of every group starts from
+  std::vector<std::vector<uint32_t> > m_groupHosts; //!< host nodes of every group
+  std::vector<uint8_t> m_dist; //!< hops from node to the group root, [group * nodes + node]
+  // delay, tx delay and rate from a host index to its group root, 0, 0 and max for a root
+  std::vector<uint64_t> m_hostDelay;
+  std::vector<uint64_t> m_hostTxDelay;
+  std::vector<uint64_t> m_hostBw;
+  // delay, tx delay and bottleneck rate between group roots, [src group * groups + dst group]
+  std::vector<uint64_t> m_groupDelay;
+  std::vector<uint64_t> m_groupTxDelay;
+  std::vector<uint64_t> m_groupBw;
+};
+
+} // namespace ns3
+
+#endif /* DC_TOPOLOGY_HELPER_H */
@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <cmath>
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/log.h"
+#include "ns3/trace-source-accessor.h"
+#include "switch-node.h"
+#include "qbb-channel.h"
+#include "fluid-background.h"
+
+NS_LOG_COMPONENT_DEFINE("FluidBackground");
+namespace ns3 {
+TypeId FluidBackground::GetTypeId(void) {
+	static TypeId tid = TypeId("ns3::FluidBackground")
+	                    .SetParent<Object>()
+	                    .AddConstructor<FluidBackground>()
+	                    .AddAttribute("ForegroundShare",
+	                                  "Fraction of every link capacity that fluid flows cannot use",
+	                                  DoubleValue(0.1),
+	                                  MakeDoubleAccessor(&FluidBackground::m_foregroundShare),
+	                                  MakeDoubleChecker<double>(0.01, 1.0))
+	                    .AddAttribute("PerFlowQueue",
+	                                  "Standing queue per fluid flow at a saturated switch port, in bytes, on top of the port's kmin",
+	                                  UintegerValue(0),
+	                                  MakeUintegerAccessor(&FluidBackground::m_perFlowQueue),
+	                                  MakeUintegerChecker<uint64_t>())
+	                    .AddTraceSource("FlowComplete",
+	                                    "A fluid flow finished (size, start time, completion time)",
+	                                    MakeTraceSourceAccessor(&FluidBackground::m_traceFlowComplete),
+	                                    "ns3::FluidBackground::FlowCompleteTracedCallback");
+	return tid;
+}
+
+FluidBackground::FluidBackground(void) {
+	m_foregroundShare = 0.1;
+	m_perFlowQueue = 0;
+	m_nActive = 0;
+	m_mark = 0;
+}
+
+uint32_t FluidBackground::GetLink(Ptr<QbbNetDevice> dev) {
+	auto it = m_linkIndex.find(PeekPointer(dev));
+	if (it != m_linkIndex.end())
+		return it->second;
+
+	Link l;
+	l.dev = dev;
+	l.port = dev->GetIfIndex();
+	Ptr<SwitchNode> sw = DynamicCast<SwitchNode>(dev->GetNode());
+	if (sw != NULL)
+		l.mmu = sw->m_mmu;
+	l.capacity = dev->GetDataRate().GetBitRate() * (1 - m_foregroundShare) / 8e9;
+	l.rate = 0;
+	l.queue = 0;
+	l.left = 0;
+	l.cnt = 0;
+	l.mark = 0;
+	m_links.push_back(l);
+	m_linkIndex[PeekPointer(dev)] = m_links.size() - 1;
+	return m_links.size() - 1;
+}
+
+uint32_t FluidBackground::AddFlow(const std::vector<Ptr<QbbNetDevice> > &path, uint32_t qIndex, uint32_t type, uint64_t size, Time start) {
+	NS_ASSERT_MSG(!path.empty(), "A fluid flow needs at least one link");
+	NS_ASSERT_MSG(qIndex != 0, "Queue 0 bypasses admission and cannot carry fluid");
+	Flow f;
+	for (uint32_t i = 0; i < path.size(); i++) {
+		f.links.push_back(GetLink(path[i]));
+		uint32_t inPort = 0;
+		if (i > 0) {
+			// the ingress port at this hop is the peer of the previous egress device
+			Ptr<QbbChannel> ch = DynamicCast<QbbChannel>(path[i - 1]->GetChannel());
+			Ptr<NetDevice> peer = ch->GetDevice(0) == path[i - 1] ? ch->GetDevice(1) : ch->GetDevice(0);
+			NS_ASSERT_MSG(peer->GetNode() == path[i]->GetNode(), "Fluid path is not connected");
+			inPort = peer->GetIfIndex();
+		}
+		f.inPorts.push_back(inPort);
+		f.charged.push_back(0);
+	}
+	f.qIndex = qIndex;
+	f.type = type;
+	f.size = size;
+	f.remaining = size;
+	f.rate = 0;
+	f.last = 0;
+	f.finish = 0;
+	f.queued = 0;
+	f.epoch = 0;
+	f.start = start;
+	f.active = false;
+	f.frozen = false;
+	uint32_t id;
+	if (!m_free.empty()) {
+		id = m_free.back();
+		m_free.pop_back();
+		// the entries of the previous flow with this id may still be in m_finish
+		f.epoch = m_flows[id].epoch + 1;
+		m_flows[id] = f;
+	}
+	else {
+		id = m_flows.size();
+		m_flows.push_back(f);
+		m_flowMark.push_back(0);
+	}
+	Simulator::Schedule(start - Simulator::Now(), &FluidBackground::StartFlow, this, id);
+	return id;
+}
+
+DataRate FluidBackground::GetFlowRate(uint32_t id) {
+	if (id >= m_flows.size() || !m_flows[id].active)
+		return DataRate(0);
+	return DataRate(m_flows[id].rate * 8e9);
+}
+
+void FluidBackground::StartFlow(uint32_t id) {
+	Flow &f = m_flows[id];
+	f.active = true;
+	f.last = Simulator::Now().GetNanoSeconds();
+	// the flows of a link are kept sorted, so the allocation walks m_flows in order
+	for (uint32_t l : f.links) {
+		std::vector<uint32_t> &flows = m_links[l].flows;
+		flows.insert(std::lower_bound(flows.begin(), flows.end(), id), id);
+	}
+	m_nActive++;
+	Reallocate(f.links);
+}
+
+// Retires the flows due now and gives their bandwidth to the flows connected to them.
+void FluidBackground::Complete(void) {
+	uint64_t now = Simulator::Now().GetNanoSeconds();
+	std::vector<uint32_t> freed;
+	while (!m_finish.empty() && m_finish.top().time <= now) {
+		uint32_t id = m_finish.top().id;
+		uint32_t epoch = m_finish.top().epoch;
+		m_finish.pop();
+		Flow &f = m_flows[id];
+		if (!f.active || f.epoch != epoch)
+			continue;
+		if (f.finish > now) {
+			// slowed down since the entry was pushed
+			f.queued = f.finish;
+			m_finish.push(Finish{f.queued, id, f.epoch});
+			continue;
+		}
+		for (uint32_t h = 0; h < f.links.size(); h++) {
+			Charge(f, h, 0);
+			std::vector<uint32_t> &flows = m_links[f.links[h]].flows;
+			flows.erase(std::lower_bound(flows.begin(), flows.end(), id));
+			freed.push_back(f.links[h]);
+		}
+		m_traceFlowComplete(f.size, f.start, Simulator::Now() - f.start);
+		f.active = false;
+		std::vector<uint32_t>().swap(f.links);
+		std::vector<uint32_t>().swap(f.inPorts);
+		std::vector<uint64_t>().swap(f.charged);
+		m_free.push_back(id);
+		m_nActive--;
+	}
+	Reallocate(freed);
+}
+
+// Recomputes the rates of the component of links and flows reachable from the seed links. Rates outside of it
+// cannot change: every link there keeps its flows and its capacity.
+void FluidBackground::Reallocate(const std::vector<uint32_t> &seed) {
+	uint64_t now = Simulator::Now().GetNanoSeconds();
+	m_mark++;
+	std::vector<uint32_t> &links = m_compLinks, &flows = m_compFlows;
+	std::vector<double> &oldRate = m_oldRate;
+	links.clear();
+	flows.clear();
+	oldRate.clear();
+	for (uint32_t l : seed) {
+		if (m_links[l].mark != m_mark) {
+			m_links[l].mark = m_mark;
+			links.push_back(l);
+		}
+	}
+	// once every active flow is in, so are their links
+	for (uint32_t i = 0; i < links.size() && flows.size() < m_nActive; i++) {
+		for (uint32_t id : m_links[links[i]].flows) {
+			if (m_flowMark[id] == m_mark)
+				continue;
+			m_flowMark[id] = m_mark;
+			// the bytes sent so far at the old rate
+			Flow &f = m_flows[id];
+			Advance(f, now);
+			flows.push_back(id);
+			oldRate.push_back(f.rate);
+			for (uint32_t l : f.links) {
+				if (m_links[l].mark != m_mark) {
+					m_links[l].mark = m_mark;
+					links.push_back(l);
+				}
+			}
+		}
+	}
+
+	Allocate(links, flows);
+	Apply(links, flows);
+
+	for (uint32_t i = 0; i < flows.size(); i++) {
+		Flow &f = m_flows[flows[i]];
+		// a flow whose rate did not change keeps its finish time and its entry
+		if (f.rate == oldRate[i])
+			continue;
+		if (f.rate == 0) {
+			f.epoch++;
+			continue;
+		}
+		// the last byte may be lost to rounding
+		f.finish = now + (f.remaining < 1 ? 0 : (uint64_t)std::ceil(f.remaining / f.rate));
+		if (oldRate[i] > 0 && f.queued <= f.finish)
+			continue;
+		f.epoch++;
+		f.queued = f.finish;
+		m_finish.push(Finish{f.queued, flows[i], f.epoch});
+	}
+
+	while (!m_finish.empty()) {
+		const Flow &f = m_flows[m_finish.top().id];
+		if (f.active && f.epoch == m_finish.top().epoch)
+			break;
+		m_finish.pop();
+	}
+	if (m_finish.size() > 2 * m_nActive + 1024) {
+		// drop the stale entries
+		std::vector<Finish> current;
+		for (uint32_t id = 0; id < m_flows.size(); id++) {
+			const Flow &f = m_flows[id];
+			if (f.active && f.rate > 0)
+				current.push_back(Finish{f.queued, id, f.epoch});
+		}
+		m_finish = std::priority_queue<Finish, std::vector<Finish>, std::greater<Finish> >(std::greater<Finish>(), std::move(current));
+	}
+
+	Simulator::Cancel(m_nextCompletion);
+	if (!m_finish.empty())
+		m_nextCompletion = Simulator::Schedule(NanoSeconds(m_finish.top().time - now), &FluidBackground::Complete, this);
+}
+
+void FluidBackground::Advance(Flow &f, uint64_t now) {
+	f.remaining = std::max(0.0, f.remaining - f.rate * (now - f.last));
+	f.last = now;
+}
+
+// Max-min fair rates by progressive filling: repeatedly find the link with the smallest fair share among the
+// flows not fixed yet, and fix those flows at that share.
+void FluidBackground::Allocate(const std::vector<uint32_t> &links, const std::vector<uint32_t> &flows) {
+	for (uint32_t l : links) {
+		m_links[l].left = m_links[l].capacity;
+		m_links[l].cnt = m_links[l].flows.size();
+	}
+	for (uint32_t id : flows) {
+		m_flows[id].frozen = false;
+		m_flows[id].rate = 0;
+	}
+
+	while (true) {
+		int best = -1;
+		double share = 0;
+		for (uint32_t l : links) {
+			if (m_links[l].cnt == 0)
+				continue;
+			double s = m_links[l].left / m_links[l].cnt;
+			if (best < 0 || s < share) {
+				best = l;
+				share = s;
+			}
+		}
+		if (best < 0)
+			break;
+		for (uint32_t id : m_links[best].flows) {
+			Flow &f = m_flows[id];
+			if (f.frozen)
+				continue;
+			f.frozen = true;
+			f.rate = share;
+			for (uint32_t l : f.links) {
+				m_links[l].left = std::max(0.0, m_links[l].left - share);
+				m_links[l].cnt--;
+			}
+		}
+	}
+}
+
+// Push the new rates to the devices and the standing queues to the switch MMUs.
+void FluidBackground::Apply(const std::vector<uint32_t> &links, const std::vector<uint32_t> &flows) {
+	for (uint32_t l : links) {
+		Link &link = m_links[l];
+		link.rate = 0;
+		for (uint32_t id : link.flows)
+			link.rate += m_flows[id].rate;
+		link.queue = 0;
+		if (link.mmu != NULL && !link.flows.empty() && link.rate >= link.capacity * (1 - 1e-6))
+			link.queue = link.mmu->aqm->kmin[link.port] + m_perFlowQueue * link.flows.size();
+		uint64_t line = link.dev->GetDataRate().GetBitRate();
+		link.dev->SetFluidBackground(link.rate * 8e9, NanoSeconds(link.queue * 8e9 / line));
+	}
+	for (uint32_t id : flows) {
+		Flow &f = m_flows[id];
+		for (uint32_t h = 0; h < f.links.size(); h++) {
+			Link &link = m_links[f.links[h]];
+			Charge(f, h, link.queue > 0 ? link.queue * f.rate / link.rate : 0);
+		}
+	}
+}
+
+void FluidBackground::Charge(Flow &f, uint32_t hop, uint64_t bytes) {
+	Link &link = m_links[f.links[hop]];
+	if (link.mmu == NULL || bytes == f.charged[hop])
+		return;
+	// the queue and the type the packets of the flow would get from the buffer profiles of the switch
+	uint32_t q = link.mmu->GetQueue(f.qIndex);
+	uint32_t type = link.mmu->GetType(f.inPorts[hop], q, f.type == 1);
+	link.mmu->AddFluidBytes(f.inPorts[hop], link.port, q, type, int64_t(bytes) - int64_t(f.charged[hop]));
+	f.charged[hop] = bytes;
+}
+
+} /* namespace ns3 */
@@ -0,0 +1,128 @@
+#ifndef FLUID_BACKGROUND_H
+#define FLUID_BACKGROUND_H
+
+#include <queue>
+#include <vector>
+#include <unordered_map>
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/traced-callback.h"
+#include "qbb-net-device.h"
+#include "switch-mmu.h"
+
+namespace ns3 {
+
+/*
+FluidBackground models background flows as fluid instead of packets (hybrid mode).
+
+Each flow follows a fixed path of egress devices (source NIC first) and gets a max-min fair rate. A fraction
+ForegroundShare of every link is kept for the packet-level (foreground) traffic.
+
+Rates only change on a flow arrival or departure, and only for the flows connected to it: the flows that share a link
+with it, the flows that share a link with those, and so on. Each event recomputes the allocation of that component of
+links and flows, which is the allocation a global recomputation would give, and pushes it to those links only. The
+bytes left of a flow are brought up to date when its rate changes, and the next completion comes from a heap of
+finish times, so the cost of an event does not grow with the flows elsewhere in the network. A flow that slows down
+keeps its earlier entry in the heap, which is pushed again at its new finish time when it comes up.
+
+The fluid affects the packet-level simulation in two ways:
+	- Every QbbNetDevice on the path serializes packets at the line rate minus the fluid rate, and delays them by the
+	  drain time of the fluid queue (QbbNetDevice::SetFluidBackground).
+	- A switch egress queue saturated by fluid holds a standing queue of kmin (the RED threshold of the port)
+	  + PerFlowQueue bytes per fluid flow. It is charged to SwitchMmu (AddFluidBytes) split across flows by rate,
+	  so it counts towards the buffer thresholds, PFC and ECN marking seen by the foreground packets.
+*/
+class FluidBackground : public Object {
+public:
+	static TypeId GetTypeId (void);
+
+	FluidBackground(void);
+
+	// Attributes must be set before the first AddFlow.
+	// path: egress devices from the source NIC to the last switch egress port towards the destination.
+	// type: LOSSLESS (0) or LOSSY (1), as used by SwitchMmu admission.
+	// Returns the id of the flow, for GetFlowRate.
+	uint32_t AddFlow(const std::vector<Ptr<QbbNetDevice> > &path, uint32_t qIndex, uint32_t type, uint64_t size, Time start);
+
+	uint32_t GetNActiveFlows(void) {return m_nActive;}
+	// Flows added and not finished yet, started or not
+	uint32_t GetNFlows(void) {return m_flows.size() - m_free.size();}
+	// Current rate of flow id, 0 before it starts and after it finishes. The id is reused by a later AddFlow.
+	DataRate GetFlowRate(uint32_t id);
+
+	typedef void (* FlowCompleteTracedCallback)(uint64_t size, Time start, Time fct);
+	TracedCallback<uint64_t, Time, Time> m_traceFlowComplete;
+
+private:
+	struct Link {
+		Ptr<QbbNetDevice> dev;
+		Ptr<SwitchMmu> mmu; // null for a host NIC
+		uint32_t port;
+		double capacity; // bytes/ns usable by the fluid
+		double rate; // allocated fluid rate, bytes/ns
+		uint64_t queue; // standing fluid queue, bytes
+		std::vector<uint32_t> flows; // active flows on this link, sorted
+		// scratch for the allocation
+		double left;
+		uint32_t cnt;
+		uint32_t mark;
+	};
+	struct Flow {
+		std::vector<uint32_t> links;
+		std::vector<uint32_t> inPorts; // ingress port at the switch owning links[i], unused for the NIC
+		std::vector<uint64_t> charged; // bytes charged to the mmu of links[i]
+		uint32_t qIndex;
+		uint32_t type;
+		uint64_t size;
+		double remaining; // bytes, at time last
+		double rate; // bytes/ns
+		uint64_t last; // ns
+		uint64_t finish; // ns
+		uint64_t queued; // ns, time of the entry of the flow in m_finish while rate > 0, at most finish
+		uint32_t epoch; // tells the current entry of the flow in m_finish from the stale ones
+		Time start;
+		bool active;
+		// scratch for the allocation
+		bool frozen;
+	};
+
+	uint32_t GetLink(Ptr<QbbNetDevice> dev);
+	void StartFlow(uint32_t id);
+	void Complete(void);
+	void Reallocate(const std::vector<uint32_t> &seed);
+	void Advance(Flow &f, uint64_t now);
+	void Allocate(const std::vector<uint32_t> &links, const std::vector<uint32_t> &flows);
+	void Apply(const std::vector<uint32_t> &links, const std::vector<uint32_t> &flows);
+	void Charge(Flow &f, uint32_t hop, uint64_t bytes);
+
+	double m_foregroundShare;
+	uint64_t m_perFlowQueue;
+
+	std::vector<Link> m_links;
+	std::unordered_map<QbbNetDevice*, uint32_t> m_linkIndex;
+	std::vector<Flow> m_flows;
+	std::vector<uint32_t> m_free; // ids of the finished flows, reused by AddFlow
+	uint32_t m_nActive;
+	// One entry per flow with a rate, no later than its finish time, earliest first. Entries are not removed when a
+	// flow speeds up, they are skipped when their epoch is not the one of the flow.
+	struct Finish {
+		uint64_t time; // ns
+		uint32_t id;
+		uint32_t epoch;
+		bool operator>(const Finish &o) const {return time > o.time;}
+	};
+	std::priority_queue<Finish, std::vector<Finish>, std::greater<Finish> > m_finish;
+	// marks the links and flows of the component being reallocated. The marks of the flows are kept apart from
+	// m_flows so that the search of the component stays in cache.
+	uint32_t m_mark;
+	std::vector<uint32_t> m_flowMark;
+	std::vector<uint32_t> m_compLinks, m_compFlows;
+	std::vector<double> m_oldRate;
+	EventId m_nextCompletion;
+};
+
+} /* namespace ns3 */
+
+#endif /* FLUID_BACKGROUND_H */
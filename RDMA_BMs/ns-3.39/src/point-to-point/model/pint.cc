@@ -1,17 +1,77 @@
 #include <cmath>
 #include <cstdlib>
 #include <cstdio>
+#include <algorithm>
 
 #include "pint.h"
 
 namespace ns3{
 
+namespace {
+// log2(1 + i/1024) with 8 extra fraction bits, and 2^(i/1024) in Q30
+struct PintTables {
+	int64_t log2[(1 << PintMath::TABLE_BITS) + 1];
+	uint64_t exp2[(1 << PintMath::TABLE_BITS) + 1];
+	PintTables() {
+		for (int i = 0; i <= (1 << PintMath::TABLE_BITS); i++) {
+			double f = double(i) / (1 << PintMath::TABLE_BITS);
+			log2[i] = llround(std::log2(1 + f) * (1 << (PintMath::FRAC_BITS + 8)));
+			exp2[i] = llround(std::exp2(f) * (1 << 30));
+		}
+	}
+};
+const PintTables tables;
+}
+
+int32_t PintMath::log2(uint64_t x){
+	int msb = 63 - __builtin_clzll(x);
+	// mantissa with the leading one at bit 31
+	uint32_t m = msb >= 31 ? x >> (msb - 31) : x << (31 - msb);
+	uint32_t idx = (m >> (31 - TABLE_BITS)) & ((1 << TABLE_BITS) - 1);
+	uint32_t rem = (m >> (31 - TABLE_BITS - 16)) & 0xffff;
+	int64_t v = tables.log2[idx] + (((tables.log2[idx + 1] - tables.log2[idx]) * rem) >> 16);
+	return (msb << FRAC_BITS) + (v >> 8);
+}
+
+uint64_t PintMath::exp2(int64_t y){
+	int64_t ip = y >> FRAC_BITS; // floor
+	uint32_t frac = y & ((1 << FRAC_BITS) - 1);
+	uint32_t idx = frac >> (FRAC_BITS - TABLE_BITS);
+	uint32_t rem = frac & ((1 << (FRAC_BITS - TABLE_BITS)) - 1);
+	uint64_t m = tables.exp2[idx] + (((tables.exp2[idx + 1] - tables.exp2[idx]) * rem) >> (FRAC_BITS - TABLE_BITS)); // Q30
+	if (ip >= 63) // m < 2^31, so m << 32 is still below 2^63
+		return uint64_t(1) << 63;
+	if (ip >= 30)
+		return m << (ip - 30);
+	if (30 - ip >= 64)
+		return 0;
+	return m >> (30 - ip);
+}
+
 double Pint::log_base = 1.05;
 double Pint::log_factor = 1 / log(log_base);
+std::vector<double> Pint::power_table;
+std::vector<double> Pint::inv_gap;
+
+namespace {
+struct PintInit {
+	PintInit() {Pint::set_log_base(Pint::log_base);}
+};
+const PintInit pintInit;
+}
 
 void Pint::set_log_base(double base){
 	log_base = base;
 	log_factor = 1 / log(log_base);
+
+	uint32_t n = 1 << get_n_bits();
+	power_table.resize(n);
+	inv_gap.resize(n);
+	for (uint32_t p = 0; p < n; p++)
+		power_table[p] = pow(log_base, p);
+	for (uint32_t p = 0; p + 1 < n; p++)
+		inv_gap[p] = 65536 / (power_table[p + 1] - power_table[p]);
+	inv_gap[n - 1] = 0;
 }
 
 int Pint::get_n_bits(){
@@ -37,8 +97,95 @@ uint16_t Pint::encode_u(double u){
 	return p;
 }
 
+uint16_t Pint::encode_u(uint32_t u_toInt, uint32_t rnd){
+	if (u_toInt == 0) u_toInt = 1;
+	// the largest p with log_base^p <= u_toInt; values beyond the table saturate instead of overflowing the header field
+	uint32_t p = std::upper_bound(power_table.begin(), power_table.end(), double(u_toInt)) - power_table.begin() - 1;
+	if (rnd < (u_toInt - power_table[p]) * inv_gap[p])
+		p++;
+	return p;
+}
+
 double Pint::decode_u(uint16_t p){
+	if (p < power_table.size())
+		return power_table[p] / max_concurrent;
 	return pow(log_base, p) / max_concurrent;
 }
 
+uint32_t Pint::update_u(uint64_t dt, uint64_t qlen, uint32_t byte, uint32_t u, uint64_t T, int32_t log_B, int32_t log_T){
+	static const int32_t log_1e9 = PintMath::log2(1000000000);
+	const int64_t one = int64_t(1) << PintMath::FRAC_BITS;
+	const int guard = 8; // extra bits kept in the sum, rounded off at the end
+	uint64_t newU = 0;
+	if ((qlen >> 8) > 0 && dt > 0) // dt*qlen*1e9/(B*T^2), qlen in units of 256 bytes
+		newU += PintMath::exp2(int64_t(PintMath::log2(dt)) + PintMath::log2(qlen >> 8) + log_1e9 - log_B - 2 * int64_t(log_T) + (8 + u_shift + guard) * one);
+	if (byte > 0) // byte*1e9/(B*T)
+		newU += PintMath::exp2(int64_t(PintMath::log2(byte)) + log_1e9 - log_B - log_T + (u_shift + guard) * one);
+	if (T > dt && u > 0) // (T-dt)*u/T
+		newU += PintMath::exp2(int64_t(PintMath::log2(T - dt)) + PintMath::log2(u) - log_T + guard * one);
+	newU = (newU + (1 << (guard - 1))) >> guard;
+	return std::min<uint64_t>(newU, UINT32_MAX);
+}
+
+double Pint::update_u_float(uint64_t dt, uint64_t qlen, uint32_t lastPktSize, double u, uint64_t T, uint64_t B){
+	int b = 20, m = 16, l = 20; // see log2apprx's paremeters
+	int sft = logres_shift(b, l);
+	double fct = 1 << sft; // (multiplication factor corresponding to sft)
+	double log_T = log2(T) * fct; // log2(T)*fct
+	double log_B = log2(B) * fct; // log2(B)*fct
+	double log_1e9 = log2(1e9) * fct; // log2(1e9)*fct
+	double qterm = 0;
+	double byteTerm = 0;
+	double uTerm = 0;
+	if ((qlen >> 8) > 0) {
+		int log_dt = log2apprx(dt, b, m, l); // ~log2(dt)*fct
+		int log_qlen = log2apprx(qlen >> 8, b, m, l); // ~log2(qlen / 256)*fct
+		qterm = pow(2, (
+		                log_dt + log_qlen + log_1e9 - log_B - 2 * log_T
+		            ) / fct
+		           ) * 256;
+		// 2^((log2(dt)*fct+log2(qlen/256)*fct+log2(1e9)*fct-log2(B)*fct-2*log2(T)*fct)/fct)*256 ~= dt*qlen*1e9/(B*T^2)
+	}
+	if (lastPktSize > 0) {
+		int byte = lastPktSize;
+		int log_byte = log2apprx(byte, b, m, l);
+		byteTerm = pow(2, (
+		                   log_byte + log_1e9 - log_B - log_T
+		               ) / fct
+		              );
+		// 2^((log2(byte)*fct+log2(1e9)*fct-log2(B)*fct-log2(T)*fct)/fct) ~= byte*1e9 / (B*T)
+	}
+	if (T > dt && u > 0) {
+		int log_T_dt = log2apprx(T - dt, b, m, l); // ~log2(T-dt)*fct
+		int log_u = log2apprx(int(round(u * 8192)), b, m, l); // ~log2(u*512)*fct
+		uTerm = pow(2, (
+		                log_T_dt + log_u - log_T
+		            ) / fct
+		           ) / 8192;
+		// 2^((log2(T-dt)*fct+log2(u*512)*fct-log2(T)*fct)/fct)/512 = (T-dt)*u/T
+	}
+	return qterm + byteTerm + uTerm;
+}
+
+int Pint::logres_shift(int b, int l) {
+	static int data[] = {0, 0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5};
+	return l - data[b];
+}
+
+int Pint::log2apprx(int x, int b, int m, int l) {
+	int x0 = x;
+	int msb = int(log2(x)) + 1;
+	if (msb > m) {
+		x = (x >> (msb - m) << (msb - m));
+#if 0
+		x += + (1 << (msb - m - 1));
+#else
+		int mask = (1 << (msb - m)) - 1;
+		if ((x0 & mask) > (rand() & mask))
+			x += 1 << (msb - m);
+#endif
+	}
+	return int(log2(x) * (1 << logres_shift(b, l)));
+}
+
 } /* namespace ns3 */
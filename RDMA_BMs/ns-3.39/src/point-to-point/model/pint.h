@@ -2,17 +2,51 @@
 #define PINT_H
 
 #include <stdint.h>
+#include <vector>
 
 namespace ns3{
+
+/*
+Fixed point log2/exp2 for the HPCC-PINT utilization estimate at the switch.
+Values in the log domain are scaled by 2^FRAC_BITS. Both use a 1024-entry table with linear interpolation, which is
+more precise than the 16-bit log2apprx approximation they replace.
+*/
+class PintMath{
+public:
+	static const int FRAC_BITS = 15; // same scale as logres_shift(20, 20)
+	static const int TABLE_BITS = 10;
+	static int32_t log2(uint64_t x); // x > 0
+	static uint64_t exp2(int64_t y); // 2^(y / 2^FRAC_BITS) rounded down, saturates at 2^63
+};
+
 class Pint{
 public:
 	static const uint32_t max_concurrent = 512; // max number of concurrent flows
+	static const uint32_t u_shift = 13; // the switch keeps u in units of 1/2^u_shift
 	static double log_base, log_factor; // used for PINT
 	static void set_log_base(double base);
 	static int get_n_bits();
 	static int get_n_bytes();
 	static uint16_t encode_u(double u);
 	static double decode_u(uint16_t p);
+
+	// Table driven encoding of u_toInt = ceil(u * max_concurrent). rnd is uniform in [0, 65536) for the probabilistic rounding.
+	static uint16_t encode_u(uint32_t u_toInt, uint32_t rnd);
+
+	// Switch port utilization estimate: u' = (T-dt)/T*u + dt*qlen/(B*T^2) + byte/(B*T), computed in the log domain.
+	// dt and T in ns, byte is the size of the previous packet. update_u takes log_B = PintMath::log2(B in Bps) and
+	// log_T = PintMath::log2(T) precomputed per port, and u in units of 1/2^u_shift.
+	static uint32_t update_u(uint64_t dt, uint64_t qlen, uint32_t byte, uint32_t u, uint64_t T, int32_t log_B, int32_t log_T);
+	// The former floating point implementation (log2/pow and log2apprx dithered with rand()), kept as a reference.
+	static double update_u_float(uint64_t dt, uint64_t qlen, uint32_t byte, double u, uint64_t T, uint64_t B);
+
+	// for approximate calc in update_u_float
+	static int logres_shift(int b, int l);
+	static int log2apprx(int x, int b, int m, int l); // given x of at most b bits, use most significant m bits of x, calc the result in l bits
+
+private:
+	static std::vector<double> power_table; // log_base^p for every encodable p
+	static std::vector<double> inv_gap; // 65536 / (log_base^(p+1) - log_base^p)
 };
 } /* namespace ns3 */
 
@@ -25,6 +25,7 @@
 #include "ns3/trace-source-accessor.h"
 #include "ns3/uinteger.h"
 #include "ns3/pointer.h"
+#include "ns3/memory-stats.h"
 #include "point-to-point-net-device.h"
 #include "point-to-point-channel.h"
 #include "ppp-header.h"
@@ -180,11 +181,13 @@ PointToPointNetDevice::PointToPointNetDevice ()
     m_currentPkt (0)
 {
   NS_LOG_FUNCTION (this);
+  NS_MEMORY_STATS_ADD (DEVICE, sizeof (PointToPointNetDevice));
 }
 
 PointToPointNetDevice::~PointToPointNetDevice ()
 {
   NS_LOG_FUNCTION (this);
+  NS_MEMORY_STATS_REMOVE (DEVICE, sizeof (PointToPointNetDevice));
 }
 
 void
@@ -12,12 +12,12 @@ namespace ns3 {
 	NS_OBJECT_ENSURE_REGISTERED(qbbHeader);
 
 	qbbHeader::qbbHeader(uint16_t pg)
-		: m_pg(pg), sport(0), dport(0), flags(0), m_seq(0)
+		: m_pg(pg), sport(0), dport(0), flags(0), m_seq(0), m_sack(0)
 	{
 	}
 
 	qbbHeader::qbbHeader()
-		: m_pg(0), sport(0), dport(0), flags(0), m_seq(0)
+		: m_pg(0), sport(0), dport(0), flags(0), m_seq(0), m_sack(0)
 	{}
 
 	qbbHeader::~qbbHeader()
@@ -50,6 +50,10 @@ namespace ns3 {
 	void qbbHeader::SetIntHeader(const IntHeader &_ih){
 		ih = _ih;
 	}
+	void qbbHeader::SetSack(uint32_t sack){
+		flags |= 1 << FLAG_SACK;
+		m_sack = sack;
+	}
 
 	uint16_t qbbHeader::GetPG() const
 	{
@@ -75,6 +79,9 @@ namespace ns3 {
 	uint8_t qbbHeader::GetCnp() const{
 		return (flags >> FLAG_CNP) & 1;
 	}
+	uint32_t qbbHeader::GetSack() const{
+		return m_sack;
+	}
 
 	TypeId
 		qbbHeader::GetTypeId(void)
@@ -96,7 +103,7 @@ namespace ns3 {
 	}
 	uint32_t qbbHeader::GetSerializedSize(void)  const
 	{
-		return GetBaseSize() + IntHeader::GetStaticSize();
+		return GetBaseSize() + IntHeader::GetStaticSize() + (((flags >> FLAG_SACK) & 1) ? sizeof(m_sack) : 0);
 	}
 	uint32_t qbbHeader::GetBaseSize() {
 		qbbHeader tmp;
@@ -113,6 +120,8 @@ namespace ns3 {
 
 		// write IntHeader
 		ih.Serialize(i);
+		if ((flags >> FLAG_SACK) & 1)
+			i.WriteU32(m_sack);
 	}
 
 	uint32_t qbbHeader::Deserialize(Buffer::Iterator start)
@@ -126,6 +135,8 @@ namespace ns3 {
 
 		// read IntHeader
 		ih.Deserialize(i);
+		if ((flags >> FLAG_SACK) & 1)
+			m_sack = i.ReadU32();
 		return GetSerializedSize();
 	}
 }; // namespace ns3
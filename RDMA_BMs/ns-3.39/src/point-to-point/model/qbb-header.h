@@ -24,7 +24,8 @@ class qbbHeader : public Header
 public:
  
   enum {
-	  FLAG_CNP = 0
+	  FLAG_CNP = 0,
+	  FLAG_SACK = 1 // NACK carries the seq of the out-of-order packet that triggered it (IRN)
   };
   qbbHeader (uint16_t pg);
   qbbHeader ();
@@ -41,6 +42,7 @@ public:
   void SetTs(uint64_t ts);
   void SetCnp();
   void SetIntHeader(const IntHeader &_ih);
+  void SetSack(uint32_t sack);
 
 //Getters
   /**
@@ -53,6 +55,7 @@ public:
   uint16_t GetDport() const;
   uint64_t GetTs() const;
   uint8_t GetCnp() const;
+  uint32_t GetSack() const;
 
   static TypeId GetTypeId (void);
   virtual TypeId GetInstanceTypeId (void) const;
@@ -68,6 +71,7 @@ private:
   uint16_t m_pg;
   uint32_t m_seq; // the qbb sequence number.
   IntHeader ih;
+  uint32_t m_sack; // only on the wire if FLAG_SACK is set
   
 };
 
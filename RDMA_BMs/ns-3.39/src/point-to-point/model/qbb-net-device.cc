@@ -45,6 +45,7 @@
 #include "ns3/udp-header.h"
 #include "ns3/seq-ts-header.h"
 #include "ns3/pointer.h"
+#include "ns3/memory-stats.h"
 #include "ns3/custom-header.h"
 #include "ns3/rdma-tag.h"
 #include "ns3/interface-tag.h"
@@ -133,12 +134,14 @@ int RdmaEgressQueue::GetNextQindex(bool paused[]) {
 			if (min_finish_id < 0xffffffff) {
 				int nxt = min_finish_id;
 				auto &qps = m_qpGrp->m_qps;
+				m_qpGrp->Remove(qps[min_finish_id]);
 				for (int i = min_finish_id + 1; i < fcount; i++) if (!qps[i]->IsFinished()) {
 						if (i == res) // update res to the idx after removing finished qp
 							res = nxt;
 						qps[nxt] = qps[i];
 						nxt++;
-					}
+					} else
+						m_qpGrp->Remove(qps[i]);
 				qps.resize(nxt);
 			}
 
@@ -177,6 +180,7 @@ Ptr<RdmaQueuePair> RdmaEgressQueue::GetQp(uint32_t i) {
 void RdmaEgressQueue::RecoverQueue(uint32_t i) {
 	NS_ASSERT_MSG(i < m_qpGrp->GetN(), "RdmaEgressQueue::RecoverQueue: qIndex >= m_qpGrp->GetN()");
 	m_qpGrp->Get(i)->snd_nxt = m_qpGrp->Get(i)->snd_una;
+	m_qpGrp->Update(m_qpGrp->Get(i));
 }
 
 void RdmaEgressQueue::EnqueueHighPrioQ(Ptr<Packet> p) {
@@ -245,6 +249,7 @@ QbbNetDevice::GetTypeId(void)
 QbbNetDevice::QbbNetDevice()
 {
 	NS_LOG_FUNCTION(this);
+	NS_MEMORY_STATS_RESIZE(DEVICE, sizeof(QbbNetDevice) - sizeof(PointToPointNetDevice));
 	m_ecn_source = new std::vector<ECNAccount>;
 	m_rdmaEQ = CreateObject<RdmaEgressQueue>();
 	m_rdmaEQ->qb_dev = this;
@@ -255,18 +260,22 @@ QbbNetDevice::QbbNetDevice()
 		m_rdmaEQ->dummy_paused[i] = dummy_paused[i];
 	}
 	hostDequeueIndex = 0;
+	m_fluidBps = 0;
 }
 
 QbbNetDevice::~QbbNetDevice()
 {
 	NS_LOG_FUNCTION(this);
+	NS_MEMORY_STATS_RESIZE(DEVICE, -int64_t(sizeof(QbbNetDevice) - sizeof(PointToPointNetDevice)));
 }
 
 void
 QbbNetDevice::DoDispose()
 {
 	NS_LOG_FUNCTION(this);
-
+	// the egress queue points back to the device
+	m_rdmaEQ->qb_dev = 0;
+	m_rdmaEQ = 0;
 	PointToPointNetDevice::DoDispose();
 }
 
@@ -274,6 +283,13 @@ DataRate QbbNetDevice::GetDataRate() {
 	return m_bps;
 }
 
+void QbbNetDevice::SetFluidBackground(uint64_t bps, Time queueDelay) {
+	NS_ASSERT_MSG(bps < m_bps.GetBitRate(), "Fluid background cannot take the whole link");
+	m_fluidBps = bps;
+	m_fluidLeft = DataRate(m_bps.GetBitRate() - bps);
+	m_fluidDelay = queueDelay;
+}
+
 bool
 QbbNetDevice::TransmitStart(Ptr<Packet> p)
 {
@@ -289,13 +305,18 @@ QbbNetDevice::TransmitStart(Ptr<Packet> p)
 	m_currentPkt = p;
 	m_phyTxBeginTrace(m_currentPkt);
 
-	Time txTime = m_bps.CalculateBytesTxTime(p->GetSize());
+	Time txTime = m_fluidBps ? m_fluidLeft.CalculateBytesTxTime(p->GetSize()) : m_bps.CalculateBytesTxTime(p->GetSize());
 	Time txCompleteTime = txTime + m_tInterframeGap;
 
 	NS_LOG_LOGIC("Schedule TransmitCompleteEvent in " << txCompleteTime.GetSeconds() << "sec");
 	Simulator::Schedule(txCompleteTime, &QbbNetDevice::TransmitComplete, this);
 
-	bool result = m_channel->TransmitStart(p, this, txTime);
+	// The fluid queue delay is added on the wire. It may shrink between two packets; never let a packet overtake.
+	Time arrival = Simulator::Now() + txTime + m_fluidDelay;
+	if (arrival < m_lastArrival)
+		arrival = m_lastArrival;
+	m_lastArrival = arrival;
+	bool result = m_channel->TransmitStart(p, this, arrival - Simulator::Now());
 	if (result == false)
 	{
 		m_phyTxDropTrace(p);
@@ -364,16 +385,12 @@ QbbNetDevice::DequeueAndTransmit(void)
 
 			// update for the next avail time
 			m_rdmaPktSent(lastQp, p, m_tInterframeGap);
+			m_rdmaEQ->m_qpGrp->Update(lastQp);
 			totalBytesSent += p->GetSize();
 		} else { // no packet to send
 			NS_LOG_INFO("PAUSE prohibits send at node " << m_node->GetId());
-			Time t = Simulator::GetMaximumSimulationTime();
-			for (uint32_t i = 0; i < m_rdmaEQ->GetFlowCount(); i++) {
-				Ptr<RdmaQueuePair> qp = m_rdmaEQ->GetQp(i);
-				if (qp->GetBytesLeft() == 0)
-					continue;
-				t = Min(qp->m_nextAvail, t);
-			}
+			// wake up when the first qp with bytes left is available, unless one already is
+			Time t = m_rdmaEQ->m_qpGrp->GetNextAvail();
 			if (m_nextSend.IsExpired() && t < Simulator::GetMaximumSimulationTime() && t > Simulator::Now()) {
 				m_nextSend = Simulator::Schedule(t - Simulator::Now(), &QbbNetDevice::DequeueAndTransmit, this);
 			}
@@ -406,18 +423,6 @@ QbbNetDevice::DequeueAndTransmit(void)
 			return;
 		} else { //No queue can deliver any packet
 			NS_LOG_INFO("PAUSE prohibits send at node " << m_node->GetId());
-			if (m_node->GetNodeType() == 0 && m_qcnEnabled) { //nothing to send, possibly due to qcn flow control, if so reschedule sending
-				Time t = Simulator::GetMaximumSimulationTime();
-				for (uint32_t i = 0; i < m_rdmaEQ->GetFlowCount(); i++) {
-					Ptr<RdmaQueuePair> qp = m_rdmaEQ->GetQp(i);
-					if (qp->GetBytesLeft() == 0)
-						continue;
-					t = Min(qp->m_nextAvail, t);
-				}
-				if (m_nextSend.IsExpired() && t < Simulator::GetMaximumSimulationTime() && t > Simulator::Now()) {
-					m_nextSend = Simulator::Schedule(t - Simulator::Now(), &QbbNetDevice::DequeueAndTransmit, this);
-				}
-			}
 		}
 	}
 	return;
@@ -635,6 +640,7 @@ bool QbbNetDevice::IsQbb(void) const {
 
 void QbbNetDevice::NewQp(Ptr<RdmaQueuePair> qp) {
 	qp->m_nextAvail = Simulator::Now();
+	m_rdmaEQ->m_qpGrp->Update(qp);
 	DequeueAndTransmit();
 }
 void QbbNetDevice::ReassignedQp(Ptr<RdmaQueuePair> qp) {
@@ -235,6 +235,12 @@ protected:
 
   std::vector<ECNAccount> *m_ecn_source;
 
+  // fluid background traffic on this link, see SetFluidBackground
+  uint64_t m_fluidBps;
+  DataRate m_fluidLeft;	//< line rate left for packets
+  Time m_fluidDelay;
+  Time m_lastArrival;	//< arrival time of the last packet at the peer, arrivals are kept in order
+
 public:
 	Ptr<RdmaEgressQueue> m_rdmaEQ;
 	void RdmaEnqueueHighPrioQ(Ptr<Packet> p);
@@ -252,6 +258,9 @@ public:
 	Ptr<RdmaEgressQueue> GetRdmaQueue();
 	void TakeDown(); // take down this device
 	void UpdateNextAvail(Time t);
+	// Hybrid fluid/packet mode (FluidBackground): fluid flows take bps of the line rate and their standing queue
+	// delays every packet by queueDelay. Calling with 0 and zero delay restores plain packet-level behavior.
+	void SetFluidBackground(uint64_t bps, Time queueDelay);
 
 	TracedCallback<Ptr<const Packet>, Ptr<RdmaQueuePair> > m_traceQpDequeue; // the trace for printing dequeue
 
@@ -0,0 +1,108 @@
+#include <iostream>
+#include "rdma-data-header.h"
+#include "ns3/packet.h"
+#include "ns3/seq-ts-header.h"
+#include "ns3/udp-header.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/int-header.h"
+#include "ns3/simulator.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED(RdmaDataHeader);
+
+RdmaDataHeader::RdmaDataHeader() {
+}
+
+void RdmaDataHeader::Build(Ipv4Address sip, Ipv4Address dip, uint16_t sport, uint16_t dport, uint16_t pg) {
+	// same headers as the RdmaHw::GetNxtPacket of old, with an empty payload
+	Ptr<Packet> p = Create<Packet>(0);
+	SeqTsHeader seqTs;
+	seqTs.SetSeq(0);
+	seqTs.SetPG(pg);
+	p->AddHeader(seqTs);
+	UdpHeader udpHeader;
+	udpHeader.SetDestinationPort(dport);
+	udpHeader.SetSourcePort(sport);
+	p->AddHeader(udpHeader);
+	Ipv4Header ipHeader;
+	ipHeader.SetSource(sip);
+	ipHeader.SetDestination(dip);
+	ipHeader.SetProtocol(0x11);
+	ipHeader.SetPayloadSize(p->GetSize());
+	ipHeader.SetTtl(64);
+	ipHeader.SetTos(0);
+	ipHeader.SetIdentification(0);
+	p->AddHeader(ipHeader);
+	PppHeader ppp;
+	ppp.SetProtocol(0x0021);
+	p->AddHeader(ppp);
+
+	NS_ASSERT_MSG(p->GetSize() == GetStaticSize(), "RdmaDataHeader: unexpected header size " << p->GetSize());
+	m_bytes.resize(p->GetSize());
+	p->CopyData(m_bytes.data(), m_bytes.size());
+}
+
+uint32_t RdmaDataHeader::GetStaticSize() {
+	return SeqOffset() + SeqTsHeader::GetHeaderSize();
+}
+
+void RdmaDataHeader::Set(uint32_t seq, uint16_t ipid, uint32_t payload) {
+	uint32_t udpLen = UDP_SIZE + SeqTsHeader::GetHeaderSize() + payload;
+	WriteU16(IpOffset() + 2, udpLen + IP_SIZE);
+	WriteU16(IpOffset() + 4, ipid);
+	WriteU16(UdpOffset() + 4, udpLen);
+	WriteU16(SeqOffset(), seq >> 16);
+	WriteU16(SeqOffset() + 2, seq);
+	if (IntHeader::mode == IntHeader::TS) {
+		// IntHeader writes ts with Buffer::Iterator::WriteU64, least significant byte first
+		uint64_t ts = Simulator::Now().GetTimeStep();
+		for (uint32_t i = 0; i < 8; i++, ts >>= 8)
+			m_bytes[SeqOffset() + 6 + i] = ts & 0xff;
+	}
+}
+
+uint16_t RdmaDataHeader::ReadU16(uint32_t offset) const {
+	return (uint16_t(m_bytes[offset]) << 8) | m_bytes[offset + 1];
+}
+
+uint32_t RdmaDataHeader::ReadU32(uint32_t offset) const {
+	return (uint32_t(ReadU16(offset)) << 16) | ReadU16(offset + 2);
+}
+
+TypeId RdmaDataHeader::GetTypeId(void) {
+	static TypeId tid = TypeId("ns3::RdmaDataHeader")
+		.SetParent<Header>()
+		.AddConstructor<RdmaDataHeader>()
+		;
+	return tid;
+}
+
+TypeId RdmaDataHeader::GetInstanceTypeId(void) const {
+	return GetTypeId();
+}
+
+void RdmaDataHeader::Print(std::ostream &os) const {
+	if (!IsBuilt())
+		return;
+	os << "src=" << Ipv4Address(ReadU32(IpOffset() + 12)) << " dst=" << Ipv4Address(ReadU32(IpOffset() + 16))
+	   << " sport=" << ReadU16(UdpOffset()) << " dport=" << ReadU16(UdpOffset() + 2)
+	   << " id=" << ReadU16(IpOffset() + 4) << " seq=" << ReadU32(SeqOffset())
+	   << " pg=" << ReadU16(SeqOffset() + 4);
+}
+
+uint32_t RdmaDataHeader::GetSerializedSize(void) const {
+	return IsBuilt() ? m_bytes.size() : GetStaticSize();
+}
+
+void RdmaDataHeader::Serialize(Buffer::Iterator start) const {
+	start.Write(m_bytes.data(), m_bytes.size());
+}
+
+uint32_t RdmaDataHeader::Deserialize(Buffer::Iterator start) {
+	m_bytes.resize(GetStaticSize());
+	start.Read(m_bytes.data(), m_bytes.size());
+	return m_bytes.size();
+}
+
+} // namespace ns3
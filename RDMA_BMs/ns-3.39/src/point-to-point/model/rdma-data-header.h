@@ -0,0 +1,63 @@
+#ifndef RDMA_DATA_HEADER_H
+#define RDMA_DATA_HEADER_H
+
+#include <stdint.h>
+#include <vector>
+#include "ns3/header.h"
+#include "ns3/buffer.h"
+#include "ns3/ipv4-address.h"
+#include "ppp-header.h"
+
+namespace ns3 {
+
+/**
+ * \brief Pre-serialized PPP + IPv4 + UDP + SeqTs headers of the data packets of a QP.
+ *
+ * Build() serializes the four headers once with the fields that do not change during
+ * the life of the QP. Set() then patches the fields that change per packet (sequence
+ * number, IP identification and lengths), so a data packet gets all its headers with a
+ * single AddHeader and copy. The bytes are the same as with the four AddHeader calls;
+ * only the packet metadata (printing) shows a single header.
+ */
+class RdmaDataHeader : public Header
+{
+public:
+	RdmaDataHeader();
+
+	void Build(Ipv4Address sip, Ipv4Address dip, uint16_t sport, uint16_t dport, uint16_t pg);
+	bool IsBuilt() const { return !m_bytes.empty(); }
+
+	/// seq and ipid of the next packet, which carries payload bytes. In IntHeader::TS mode the
+	/// timestamp is the current time, as SeqTsHeader stamps it when a packet is built.
+	void Set(uint32_t seq, uint16_t ipid, uint32_t payload);
+
+	static TypeId GetTypeId (void);
+	virtual TypeId GetInstanceTypeId (void) const;
+	virtual void Print (std::ostream &os) const;
+	virtual uint32_t GetSerializedSize (void) const;
+	virtual void Serialize (Buffer::Iterator start) const;
+	virtual uint32_t Deserialize (Buffer::Iterator start);
+	static uint32_t GetStaticSize(); // depends on IntHeader::mode
+
+private:
+	// offsets in m_bytes; the PPP header is Ethernet-sized, see PppHeader::GetStaticSize
+	static uint32_t IpOffset() { return PppHeader::GetStaticSize(); }
+	static uint32_t UdpOffset() { return IpOffset() + IP_SIZE; }
+	static uint32_t SeqOffset() { return UdpOffset() + UDP_SIZE; }
+	static const uint32_t IP_SIZE = 20;
+	static const uint32_t UDP_SIZE = 8;
+
+	void WriteU16(uint32_t offset, uint16_t v)
+	{
+		m_bytes[offset] = v >> 8;
+		m_bytes[offset + 1] = v & 0xff;
+	}
+	uint16_t ReadU16(uint32_t offset) const;
+	uint32_t ReadU32(uint32_t offset) const;
+
+	std::vector<uint8_t> m_bytes; // the headers as on the wire
+};
+
+} // namespace ns3
+
+#endif /* RDMA_DATA_HEADER_H */
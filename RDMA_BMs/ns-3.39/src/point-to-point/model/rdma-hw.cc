@@ -8,11 +8,13 @@
 #include "ns3/double.h"
 #include "ns3/data-rate.h"
 #include "ns3/pointer.h"
+#include "ns3/nstime.h"
 #include "rdma-hw.h"
 #include "ppp-header.h"
 #include "qbb-header.h"
 #include "cn-header.h"
 #include "ns3/unsched-tag.h"
+#include "ns3/rank-tag.h"
 
 namespace ns3 {
 
@@ -177,6 +179,61 @@ TypeId RdmaHw::GetTypeId (void)
 	                                  MakeUintegerChecker<uint32_t>())
 	                    .AddAttribute("PowerTCPEnabled", "to enable PowerTCP", BooleanValue(false), MakeBooleanAccessor(&RdmaHw::PowerTCPEnabled), MakeBooleanChecker())
 	                    .AddAttribute("PowerTCPdelay", "to enable PowerTCP in delaymode", BooleanValue(false), MakeBooleanAccessor(&RdmaHw::PowerTCPdelay), MakeBooleanChecker())
+	                    .AddAttribute("IrnEnabled",
+	                                  "Use IRN selective retransmission instead of go-back-N for all qps",
+	                                  BooleanValue(false),
+	                                  MakeBooleanAccessor(&RdmaHw::m_irn),
+	                                  MakeBooleanChecker())
+	                    .AddAttribute("IrnPgMask",
+	                                  "Use IRN selective retransmission for qps whose pg bit is set in this mask",
+	                                  UintegerValue(0),
+	                                  MakeUintegerAccessor(&RdmaHw::m_irnPgMask),
+	                                  MakeUintegerChecker<uint32_t>())
+	                    .AddAttribute("IrnRtoHigh",
+	                                  "IRN retransmission timeout in microseconds",
+	                                  DoubleValue(320.0),
+	                                  MakeDoubleAccessor(&RdmaHw::m_irnRtoHigh),
+	                                  MakeDoubleChecker<double>())
+	                    .AddAttribute("IrnRtoLow",
+	                                  "IRN retransmission timeout in microseconds when few packets are on the fly",
+	                                  DoubleValue(100.0),
+	                                  MakeDoubleAccessor(&RdmaHw::m_irnRtoLow),
+	                                  MakeDoubleChecker<double>())
+	                    .AddAttribute("IrnRtoLowThreshold",
+	                                  "Use IrnRtoLow when fewer than this many packets are on the fly",
+	                                  UintegerValue(3),
+	                                  MakeUintegerAccessor(&RdmaHw::m_irnRtoLowThresh),
+	                                  MakeUintegerChecker<uint32_t>())
+	                    .AddAttribute("RankTag",
+	                                  "Add a RankTag (remaining size, deadline) to data packets, for the PIFO egress queues",
+	                                  BooleanValue(false),
+	                                  MakeBooleanAccessor(&RdmaHw::m_rankTag),
+	                                  MakeBooleanChecker())
+	                    .AddAttribute("SlackFactor",
+	                                  "Flow deadline in the RankTag, in multiples of the ideal completion time (size at line rate plus base rtt)",
+	                                  DoubleValue(2.0),
+	                                  MakeDoubleAccessor(&RdmaHw::m_slackFactor),
+	                                  MakeDoubleChecker<double>(0))
+	                    .AddAttribute("HeaderTemplate",
+	                                  "Build data packets from headers serialized once per qp, instead of serializing the four headers per packet",
+	                                  BooleanValue(true),
+	                                  MakeBooleanAccessor(&RdmaHw::m_headerTemplate),
+	                                  MakeBooleanChecker())
+	                    .AddAttribute("AckCoalesceInterval",
+	                                  "Hold ACKs up to this long and send the held ACKs of a NIC together, 0 to send each ACK at once",
+	                                  TimeValue(Time(0)),
+	                                  MakeTimeAccessor(&RdmaHw::m_ackCoalesceInterval),
+	                                  MakeTimeChecker())
+	                    .AddAttribute("AckCoalesceBytes",
+	                                  "With AckCoalesceInterval, send the held ACKs once a rx qp received this many bytes since its last ACK/NACK, 0 for no limit",
+	                                  UintegerValue(0),
+	                                  MakeUintegerAccessor(&RdmaHw::m_ackCoalesceBytes),
+	                                  MakeUintegerChecker<uint32_t>())
+	                    .AddAttribute("MinCnpInterval",
+	                                  "At most one ACK/NACK of a rx qp carries a CNP in this interval",
+	                                  TimeValue(Time(0)),
+	                                  MakeTimeAccessor(&RdmaHw::m_minCnpInterval),
+	                                  MakeTimeChecker())
 	                    ;
 	return tid;
 }
@@ -233,6 +290,11 @@ void RdmaHw::AddQueuePair(uint64_t size, uint16_t pg, Ipv4Address sip, Ipv4Addre
 	qp->SetAppNotifyCallback(notifyAppFinish);
 	qp->stopTime = stopTime;
 
+	if (IrnEnabled(pg)) {
+		qp->irn.m_enabled = true;
+		qp->irn.m_mtu = m_mtu;
+	}
+
 	if (stopTime == Simulator::GetMaximumSimulationTime()-MicroSeconds(1)){
 		qp->incastFlow = 1;
 	}
@@ -258,6 +320,13 @@ void RdmaHw::AddQueuePair(uint64_t size, uint16_t pg, Ipv4Address sip, Ipv4Addre
 		qp->SetWin(m_bps.GetBitRate() * 1 * baseRtt * 1e-9 / 8);
 	qp->m_rate = m_bps;
 	qp->m_max_rate = m_bps;
+	SetUnschedBytes(qp);
+	if (m_headerTemplate)
+		qp->m_dataHdr.Build(sip, dip, sport, dport, pg);
+	if (qp->irn.m_enabled) { // BDP-FC: at most one BDP (rounded up to whole packets) on the fly
+		uint64_t bdp = m_bps.GetBitRate() * baseRtt / 8000000000lu;
+		qp->irn.m_bdpCap = std::max<uint64_t>(1, (bdp + m_mtu - 1) / m_mtu) * m_mtu;
+	}
 	if (m_cc_mode == 1) {
 		qp->mlx.m_targetRate = m_bps;
 	} else if (m_cc_mode == 3) {
@@ -296,6 +365,7 @@ Ptr<RdmaRxQueuePair> RdmaHw::GetRxQp(uint32_t sip, uint32_t dip, uint16_t sport,
 		q->sport = sport;
 		q->dport = dport;
 		q->m_ecn_source.qIndex = pg;
+		q->m_irn = IrnEnabled(pg);
 		// store in map
 		m_rxQpMap[key] = q;
 		return q;
@@ -312,13 +382,18 @@ uint32_t RdmaHw::GetNicIdxOfRxQp(Ptr<RdmaRxQueuePair> q) {
 }
 void RdmaHw::DeleteRxQp(uint32_t dip, uint16_t pg, uint16_t dport) {
 	uint64_t key = ((uint64_t)dip << 32) | ((uint64_t)pg << 16) | (uint64_t)dport;
-	m_rxQpMap.erase(key);
+	auto it = m_rxQpMap.find(key);
+	if (it == m_rxQpMap.end())
+		return;
+	it->second->m_ackPending = false; // do not send its held ACK
+	m_rxQpMap.erase(it);
 }
 
 int RdmaHw::ReceiveUdp(Ptr<Packet> p, CustomHeader &ch) {
 	uint8_t ecnbits = ch.GetIpv4EcnBits();
 
 	uint32_t payload_size = p->GetSize() - ch.GetSerializedSize();
+	m_feedbackStats.dataBytes += payload_size;
 
 	// TODO find corresponding rx queue pair
 	Ptr<RdmaRxQueuePair> rxQp = GetRxQp(ch.dip, ch.sip, ch.udp.dport, ch.udp.sport, ch.udp.pg, true);
@@ -329,38 +404,121 @@ int RdmaHw::ReceiveUdp(Ptr<Packet> p, CustomHeader &ch) {
 	rxQp->m_ecn_source.total++;
 	rxQp->m_milestone_rx = m_ack_interval;
 
-	int x = ReceiverCheckSeq(ch.udp.seq, rxQp, payload_size);
-	if (x == 1 || x == 2) { //generate ACK or NACK
-		qbbHeader seqh;
-		seqh.SetSeq(rxQp->ReceiverNextExpectedSeq);
-		seqh.SetPG(ch.udp.pg);
-		seqh.SetSport(ch.udp.dport);
-		seqh.SetDport(ch.udp.sport);
-		seqh.SetIntHeader(ch.udp.ih);
-		if (ecnbits)
-			seqh.SetCnp();
-
-		Ptr<Packet> newp = Create<Packet>(std::max(60 - 14 - 20 - (int)seqh.GetSerializedSize(), 0));
-		newp->AddHeader(seqh);
-
-		Ipv4Header head;	// Prepare IPv4 header
-		head.SetDestination(Ipv4Address(ch.sip));
-		head.SetSource(Ipv4Address(ch.dip));
-		head.SetProtocol(x == 1 ? 0xFC : 0xFD); //ack=0xFC nack=0xFD
-		head.SetTtl(64);
-		head.SetPayloadSize(newp->GetSize());
-		head.SetIdentification(rxQp->m_ipid++);
-
-		newp->AddHeader(head);
-		AddHeader(newp, 0x800);	// Attach PPP header
-		// send
+	int x = rxQp->m_irn ? ReceiverCheckSeqIrn(ch.udp.seq, rxQp, payload_size) : ReceiverCheckSeq(ch.udp.seq, rxQp, payload_size);
+	bool ecn = ecnbits != 0;
+	if (m_ackCoalesceInterval.IsStrictlyPositive()) { // the feedback covers every packet since the last one
+		rxQp->m_ackEcn |= ecn;
+		rxQp->m_ackBytes += payload_size;
+		ecn = rxQp->m_ackEcn;
+	}
+	if (x == 1 && m_ackCoalesceInterval.IsStrictlyPositive()) {
+		HoldAck(rxQp, ch.udp.ih);
+	} else if (x == 1 || x == 2) { //generate ACK or NACK
+		SendFeedback(rxQp, x == 2, ch.udp.ih, ecn, x == 2 && rxQp->m_irn ? ch.udp.seq : 0);
 		uint32_t nic_idx = GetNicIdxOfRxQp(rxQp);
-		m_nic[nic_idx].dev->RdmaEnqueueHighPrioQ(newp);
 		m_nic[nic_idx].dev->TriggerTransmit();
 	}
 	return 0;
 }
 
+// Builds the ACK/NACK of rx qp q, with the CNP flag if ecn and the CNP interval of q allows it,
+// and enqueues it on the high priority queue of the NIC. The caller triggers the transmission.
+void RdmaHw::SendFeedback(Ptr<RdmaRxQueuePair> q, bool nack, const IntHeader &ih, bool ecn, uint32_t sack) {
+	qbbHeader seqh;
+	seqh.SetSeq(q->ReceiverNextExpectedSeq);
+	seqh.SetPG(q->m_ecn_source.qIndex);
+	seqh.SetSport(q->sport);
+	seqh.SetDport(q->dport);
+	seqh.SetIntHeader(ih);
+	if (ecn) {
+		if (Simulator::Now() >= q->m_nextCnp) {
+			seqh.SetCnp();
+			q->m_nextCnp = Simulator::Now() + m_minCnpInterval;
+			m_feedbackStats.cnps++;
+		} else
+			m_feedbackStats.suppressedCnps++;
+	}
+	if (sack)
+		seqh.SetSack(sack);
+	if (q->m_ackPending) { // a NACK carries the cumulative ack too
+		q->m_ackPending = false;
+		m_feedbackStats.coalescedAcks++;
+	}
+	q->m_ackEcn = false;
+	q->m_ackBytes = 0;
+	if (nack)
+		m_feedbackStats.nacks++;
+	else
+		m_feedbackStats.acks++;
+
+	Ptr<Packet> newp = Create<Packet>(std::max(60 - 14 - 20 - (int)seqh.GetSerializedSize(), 0));
+	newp->AddHeader(seqh);
+
+	Ipv4Header head;	// Prepare IPv4 header
+	head.SetDestination(Ipv4Address(q->dip));
+	head.SetSource(Ipv4Address(q->sip));
+	head.SetProtocol(nack ? 0xFD : 0xFC); //ack=0xFC nack=0xFD
+	head.SetTtl(64);
+	head.SetPayloadSize(newp->GetSize());
+	head.SetIdentification(q->m_ipid++);
+
+	newp->AddHeader(head);
+	AddHeader(newp, 0x800);	// Attach PPP header
+	// send
+	uint32_t nic_idx = GetNicIdxOfRxQp(q);
+	m_nic[nic_idx].dev->RdmaEnqueueHighPrioQ(newp);
+}
+
+// Holds the ACK of q in the coalescing window of its NIC. A later ACK of q replaces it. The NIC
+// sends all its held ACKs when the window of the first one ends, or as soon as one rx qp
+// received m_ackCoalesceBytes since its last feedback.
+void RdmaHw::HoldAck(Ptr<RdmaRxQueuePair> q, const IntHeader &ih) {
+	uint32_t nic_idx = GetNicIdxOfRxQp(q);
+	RdmaInterfaceMgr &nic = m_nic[nic_idx];
+	q->m_ackIh = ih;
+	if (q->m_ackPending)
+		m_feedbackStats.coalescedAcks++;
+	else {
+		q->m_ackPending = true;
+		nic.heldAcks.push_back(q);
+	}
+	if (m_ackCoalesceBytes && q->m_ackBytes >= m_ackCoalesceBytes)
+		FlushAcks(nic_idx);
+	else if (!nic.ackFlushEvent.IsRunning())
+		nic.ackFlushEvent = Simulator::Schedule(m_ackCoalesceInterval, &RdmaHw::FlushAcks, this, nic_idx);
+}
+
+void RdmaHw::FlushAcks(uint32_t nic_idx) {
+	RdmaInterfaceMgr &nic = m_nic[nic_idx];
+	nic.ackFlushEvent.Cancel();
+	std::vector<Ptr<RdmaRxQueuePair> > held;
+	held.swap(nic.heldAcks);
+	for (Ptr<RdmaRxQueuePair> q : held) {
+		if (!q->m_ackPending) // sent with a NACK meanwhile
+			continue;
+		q->m_ackPending = false;
+		SendFeedback(q, false, q->m_ackIh, q->m_ackEcn, 0);
+	}
+	if (nic.dev)
+		nic.dev->TriggerTransmit();
+}
+
+void RdmaHw::FeedbackStats::Add(const FeedbackStats &o) {
+	dataBytes += o.dataBytes;
+	acks += o.acks;
+	nacks += o.nacks;
+	cnps += o.cnps;
+	coalescedAcks += o.coalescedAcks;
+	suppressedCnps += o.suppressedCnps;
+}
+
+void RdmaHw::FeedbackStats::Print(std::ostream &os) const {
+	uint64_t ctrl = acks + nacks;
+	os << "data bytes " << dataBytes << " acks " << acks << " nacks " << nacks << " cnps " << cnps
+	   << " coalesced acks " << coalescedAcks << " suppressed cnps " << suppressedCnps
+	   << " control packets per KB " << (dataBytes ? ctrl * 1000.0 / dataBytes : 0) << std::endl;
+}
+
 int RdmaHw::ReceiveCnp(Ptr<Packet> p, CustomHeader &ch) {
 	// QCN on NIC
 	// This is a Congestion signal
@@ -421,6 +579,14 @@ int RdmaHw::ReceiveAck(Ptr<Packet> p, CustomHeader &ch) {
 	Ptr<QbbNetDevice> dev = m_nic[nic_idx].dev;
 	if (m_ack_interval == 0)
 		std::cout << "ERROR: shouldn't receive ack\n";
+	else if (qp->irn.m_enabled) {
+		qp->Acknowledge(seq);
+		if (ch.l3Prot == 0xFD && ((ch.ack.flags >> qbbHeader::FLAG_SACK) & 1))
+			qp->IrnSack(ch.ack.sack);
+		if (qp->IsFinished()) {
+			QpComplete(qp);
+		}
+	}
 	else {
 		if (!m_backto0) {
 			qp->Acknowledge(seq);
@@ -432,7 +598,7 @@ int RdmaHw::ReceiveAck(Ptr<Packet> p, CustomHeader &ch) {
 			QpComplete(qp);
 		}
 	}
-	if (ch.l3Prot == 0xFD) // NACK
+	if (ch.l3Prot == 0xFD && !qp->irn.m_enabled) // NACK
 		RecoverQueue(qp);
 
 	// handle cnp
@@ -451,6 +617,8 @@ int RdmaHw::ReceiveAck(Ptr<Packet> p, CustomHeader &ch) {
 	} else if (m_cc_mode == 10) {
 		HandleAckHpPint(qp, p, ch);
 	}
+	// the ack, sack or NACK changed the bytes left
+	m_nic[nic_idx].qpGrp->Update(qp);
 	// ACK may advance the on-the-fly window, allowing more packets to send
 	dev->TriggerTransmit();
 	return 0;
@@ -473,7 +641,7 @@ int RdmaHw::ReceiverCheckSeq(uint32_t seq, Ptr<RdmaRxQueuePair> q, uint32_t size
 	uint32_t expected = q->ReceiverNextExpectedSeq;
 	if (seq == expected) {
 		q->ReceiverNextExpectedSeq = expected + size;
-		if (q->ReceiverNextExpectedSeq >= q->m_milestone_rx) {
+		if (q->ReceiverNextExpectedSeq >= (uint32_t)q->m_milestone_rx) {
 			q->m_milestone_rx += m_ack_interval;
 			return 1; //Generate ACK
 		} else if (q->ReceiverNextExpectedSeq % m_chunk == 0) {
@@ -497,6 +665,42 @@ int RdmaHw::ReceiverCheckSeq(uint32_t seq, Ptr<RdmaRxQueuePair> q, uint32_t size
 		return 3;
 	}
 }
+// IRN receiver: out-of-order packets are kept (bitmap) and each of them is NACKed with its seq as SACK.
+// The cumulative ack skips over everything already received once the hole is filled.
+int RdmaHw::ReceiverCheckSeqIrn(uint32_t seq, Ptr<RdmaRxQueuePair> q, uint32_t size) {
+	uint32_t expected = q->ReceiverNextExpectedSeq;
+	if (seq == expected) {
+		q->ReceiverNextExpectedSeq = expected + size;
+		q->m_irnRcv.Advance(1);
+		uint32_t n = q->m_irnRcv.CountLeadingSet();
+		if (n > 0) {
+			q->m_irnRcv.Advance(n);
+			q->ReceiverNextExpectedSeq += n * m_mtu;
+			if (q->m_irnLastEnd != 0 && q->ReceiverNextExpectedSeq > q->m_irnLastEnd) // the short last packet was among them
+				q->ReceiverNextExpectedSeq = q->m_irnLastEnd;
+		}
+		if (q->ReceiverNextExpectedSeq >= (uint32_t)q->m_milestone_rx) {
+			q->m_milestone_rx += m_ack_interval;
+			return 1; //Generate ACK
+		} else if (q->ReceiverNextExpectedSeq % m_chunk == 0) {
+			return 1;
+		} else {
+			return 5;
+		}
+	} else if (seq > expected) {
+		uint32_t idx = (seq - expected) / m_mtu;
+		if (q->m_irnRcv.Test(idx))
+			return 1; // duplicate of an out-of-order packet, re-ack so a lost ACK does not stall the sender
+		q->m_irnRcv.Set(idx);
+		if (size < m_mtu)
+			q->m_irnLastEnd = seq + size;
+		return 2; // NACK with SACK
+	} else {
+		// Duplicate of an in-order packet (spurious retransmission), ack it
+		return 1;
+	}
+}
+
 void RdmaHw::AddHeader (Ptr<Packet> p, uint16_t protocolNumber) {
 	PppHeader ppp;
 	ppp.SetProtocol (EtherToPpp (protocolNumber));
@@ -517,8 +721,8 @@ void RdmaHw::RecoverQueue(Ptr<RdmaQueuePair> qp) {
 
 void RdmaHw::QpComplete(Ptr<RdmaQueuePair> qp) {
 	NS_ASSERT(!m_qpCompleteCallback.IsNull());
+	Simulator::Cancel(qp->irn.m_rtoEvent);
 	if (m_cc_mode == 1) {
-		Simulator::Cancel(qp->mlx.m_eventUpdateAlpha);
 		Simulator::Cancel(qp->mlx.m_eventDecreaseRate);
 		Simulator::Cancel(qp->mlx.m_rpTimer);
 	}
@@ -565,25 +769,47 @@ void RdmaHw::RedistributeQp() {
 }
 
 Ptr<Packet> RdmaHw::GetNxtPacket(Ptr<RdmaQueuePair> qp) {
-	uint32_t payload_size = qp->GetBytesLeft();
+	// IRN retransmissions go before new data
+	bool retx = qp->irn.m_enabled && qp->IrnHasRetx();
+	uint64_t seq = retx ? qp->IrnNextRetx() : qp->snd_nxt;
+	uint32_t payload_size = qp->m_size >= seq ? qp->m_size - seq : 0;
 	if (m_mtu < payload_size)
 		payload_size = m_mtu;
 	Ptr<Packet> p = Create<Packet> (payload_size);
-	uint32_t sentBytes = qp->m_size - qp->GetBytesLeft();
-	uint32_t nic_idx = GetNicIdxOfQp(qp);
-	DataRate m_bps = m_nic[nic_idx].dev->GetDataRate();
-	double bdp = m_bps.GetBitRate() * 1 * qp->m_baseRtt * 1e-9 / 8;
+	uint32_t sentBytes = seq;
 	UnSchedTag unschedtag;
-	if (sentBytes <= bdp){
-		unschedtag.SetValue(1);
+	unschedtag.SetValue(sentBytes <= qp->m_unschedBytes ? 1 : 0);
+	p->AddPacketTag(unschedtag);
+	if (m_rankTag) {
+		DataRate m_bps = m_nic[GetNicIdxOfQp(qp)].dev->GetDataRate();
+		uint32_t flow = (qp->sip.Get() * 2654435761u) ^ (qp->dip.Get() * 40503u) ^ ((uint32_t)qp->sport << 16 | qp->dport);
+		double ideal = qp->m_size * 8e9 / m_bps.GetBitRate() + qp->m_baseRtt;
+		uint64_t deadline = qp->startTime.GetNanoSeconds() + uint64_t(m_slackFactor * ideal);
+		p->AddPacketTag(RankTag(flow, qp->m_size > seq ? qp->m_size - seq : 0, deadline));
 	}
-	else{
-		unschedtag.SetValue(0);
+	if (qp->m_dataHdr.IsBuilt()) {
+		qp->m_dataHdr.Set(seq, qp->m_ipid, payload_size);
+		p->AddHeader(qp->m_dataHdr);
+	} else {
+		AddDataHeaders(qp, p, seq);
 	}
-	p->AddPacketTag(unschedtag);
+
+	// update state
+	if (retx)
+		qp->IrnRetxSent(seq + payload_size);
+	else
+		qp->snd_nxt += payload_size;
+	qp->lastPktEnd = seq + payload_size;
+	qp->m_ipid++;
+
+	// return
+	return p;
+}
+
+void RdmaHw::AddDataHeaders(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, uint64_t seq) {
 	// add SeqTsHeader
 	SeqTsHeader seqTs;
-	seqTs.SetSeq (qp->snd_nxt);
+	seqTs.SetSeq (seq);
 	seqTs.SetPG (qp->m_pg);
 	p->AddHeader (seqTs);
 	// add udp header
@@ -605,23 +831,53 @@ Ptr<Packet> RdmaHw::GetNxtPacket(Ptr<RdmaQueuePair> qp) {
 	PppHeader ppp;
 	ppp.SetProtocol (0x0021); // EtherToPpp(0x800), see point-to-point-net-device.cc
 	p->AddHeader (ppp);
+}
 
-	// update state
-	qp->snd_nxt += payload_size;
-	qp->m_ipid++;
-
-	// return
-	return p;
+void RdmaHw::SetUnschedBytes(Ptr<RdmaQueuePair> qp) {
+	DataRate m_bps = m_nic[GetNicIdxOfQp(qp)].dev->GetDataRate();
+	// the packets whose offset is at most the BDP are unscheduled; sentBytes <= bdp is sentBytes <= floor(bdp)
+	double bdp = m_bps.GetBitRate() * 1 * qp->m_baseRtt * 1e-9 / 8;
+	qp->m_unschedBytes = bdp;
 }
 
 void RdmaHw::PktSent(Ptr<RdmaQueuePair> qp, Ptr<Packet> pkt, Time interframeGap) {
 	qp->lastPktSize = pkt->GetSize();
 //	SeqTsHeader seqTs;
 //	pkt->PeekHeader(seqTs);
-	uint32_t seq = qp->snd_nxt;
-	qp->rates[qp->snd_nxt] = Simulator::Now().GetNanoSeconds();
+	// keyed by the ack of the packet, which for an IRN retransmission is not snd_nxt
+	qp->rates[qp->lastPktEnd] = Simulator::Now().GetNanoSeconds();
 	UpdateNextAvail(qp, interframeGap, pkt->GetSize());
+	if (qp->irn.m_enabled && !qp->irn.m_rtoEvent.IsRunning()) {
+		qp->irn.m_lastAckTime = Simulator::Now();
+		qp->irn.m_rtoEvent = Simulator::Schedule(IrnRto(qp), &RdmaHw::IrnRtoCheck, this, qp);
+	}
+
+}
+
+Time RdmaHw::IrnRto(Ptr<RdmaQueuePair> qp) {
+	if (qp->GetOnTheFly() < (uint64_t)m_irnRtoLowThresh * m_mtu)
+		return MicroSeconds(m_irnRtoLow);
+	return MicroSeconds(m_irnRtoHigh);
+}
+
+// The RTO is not rescheduled on every ACK. It fires, checks whether the cumulative ack moved within the last RTO and
+// re-arms itself for the remaining time if it did.
+void RdmaHw::IrnRtoCheck(Ptr<RdmaQueuePair> qp) {
+	if (qp->IsFinished() || qp->GetOnTheFly() == 0)
+		return;
+	Time deadline = qp->irn.m_lastAckTime + IrnRto(qp);
+	if (Simulator::Now() >= deadline) {
+		qp->IrnTimeout();
+		uint32_t nic_idx = GetNicIdxOfQp(qp);
+		m_nic[nic_idx].qpGrp->Update(qp);
+		m_nic[nic_idx].dev->TriggerTransmit();
+		deadline = Simulator::Now() + IrnRto(qp);
+	}
+	qp->irn.m_rtoEvent = Simulator::Schedule(deadline - Simulator::Now(), &RdmaHw::IrnRtoCheck, this, qp);
+}
 
+bool RdmaHw::IrnEnabled(uint16_t pg) {
+	return m_irn || ((m_irnPgMask >> pg) & 1);
 }
 
 void RdmaHw::UpdateNextAvail(Ptr<RdmaQueuePair> qp, Time interframeGap, uint32_t pkt_size) {
@@ -640,6 +896,7 @@ void RdmaHw::ChangeRate(Ptr<RdmaQueuePair> qp, DataRate new_rate) {
 	qp->m_nextAvail = qp->m_nextAvail + new_sendintTime - sendingTime;
 	// update nic's next avail event
 	uint32_t nic_idx = GetNicIdxOfQp(qp);
+	m_nic[nic_idx].qpGrp->Update(qp);
 	m_nic[nic_idx].dev->UpdateNextAvail(qp->m_nextAvail);
 #endif
 	// change to new rate
@@ -651,48 +908,62 @@ void RdmaHw::ChangeRate(Ptr<RdmaQueuePair> qp, DataRate new_rate) {
  * Mellanox's version of DCQCN
  *****************************/
 void RdmaHw::UpdateAlphaMlx(Ptr<RdmaQueuePair> q) {
+	Time now = Simulator::Now();
+	int64_t interval = MicroSeconds(m_alpha_resume_interval).GetTimeStep();
+	while (q->mlx.m_nextAlphaUpdate <= now) {
 #if PRINT_LOG
-	//std::cout << Simulator::Now() << " alpha update:" << m_node->GetId() << ' ' << q->mlx.m_alpha << ' ' << (int)q->mlx.m_alpha_cnp_arrived << '\n';
-	//printf("%lu alpha update: %08x %08x %u %u %.6lf->", Simulator::Now().GetTimeStep(), q->sip.Get(), q->dip.Get(), q->sport, q->dport, q->mlx.m_alpha);
+		//std::cout << q->mlx.m_nextAlphaUpdate << " alpha update:" << m_node->GetId() << ' ' << q->mlx.m_alpha << ' ' << (int)q->mlx.m_alpha_cnp_arrived << '\n';
 #endif
-	if (q->mlx.m_alpha_cnp_arrived) {
-		q->mlx.m_alpha = (1 - m_g) * q->mlx.m_alpha + m_g; 	//binary feedback
-	} else {
-		q->mlx.m_alpha = (1 - m_g) * q->mlx.m_alpha; 	//binary feedback
+		if (q->mlx.m_alpha_cnp_arrived) {
+			q->mlx.m_alpha = (1 - m_g) * q->mlx.m_alpha + m_g; 	//binary feedback
+		} else {
+			double alpha = (1 - m_g) * q->mlx.m_alpha; 	//binary feedback
+			if (alpha == q->mlx.m_alpha) { // no more change (0 or the smallest denormal): skip the idle slots
+				q->mlx.m_nextAlphaUpdate += TimeStep((now - q->mlx.m_nextAlphaUpdate).GetTimeStep() / interval * interval);
+			}
+			q->mlx.m_alpha = alpha;
+		}
+		q->mlx.m_alpha_cnp_arrived = false; // clear the CNP_arrived bit
+		q->mlx.m_nextAlphaUpdate += TimeStep(interval);
 	}
-#if PRINT_LOG
-	//printf("%.6lf\n", q->mlx.m_alpha);
-#endif
-	q->mlx.m_alpha_cnp_arrived = false; // clear the CNP_arrived bit
-	ScheduleUpdateAlphaMlx(q);
-}
-void RdmaHw::ScheduleUpdateAlphaMlx(Ptr<RdmaQueuePair> q) {
-	q->mlx.m_eventUpdateAlpha = Simulator::Schedule(MicroSeconds(m_alpha_resume_interval), &RdmaHw::UpdateAlphaMlx, this, q);
 }
 
 void RdmaHw::cnp_received_mlx(Ptr<RdmaQueuePair> q) {
+	Time now = Simulator::Now();
+	if (!q->mlx.m_first_cnp)
+		UpdateAlphaMlx(q); // the slots that ended before this CNP
 	q->mlx.m_alpha_cnp_arrived = true; // set CNP_arrived bit for alpha update
-	q->mlx.m_decrease_cnp_arrived = true; // set CNP_arrived bit for rate decrease
+	if (!q->mlx.m_decrease_cnp_arrived) {
+		q->mlx.m_decrease_cnp_arrived = true; // set CNP_arrived bit for rate decrease
+		q->mlx.m_decreaseCnpTime = now;
+	}
+	q->mlx.m_lastCnp = now;
 	if (q->mlx.m_first_cnp) {
 		// init alpha
 		q->mlx.m_alpha = 1;
 		q->mlx.m_alpha_cnp_arrived = false;
-		// schedule alpha update
-		ScheduleUpdateAlphaMlx(q);
+		// alpha slots from now on
+		q->mlx.m_nextAlphaUpdate = now + MicroSeconds(m_alpha_resume_interval);
 		// schedule rate decrease
-		ScheduleDecreaseRateMlx(q, 1); // add 1 ns to make sure rate decrease is after alpha update
+		q->mlx.m_nextDecreaseCheck = now + MicroSeconds(m_rateDecreaseInterval) + NanoSeconds(1); // add 1 ns to make sure rate decrease is after alpha update
+		ScheduleDecreaseRateMlx(q);
 		// set rate on first CNP
 		q->mlx.m_targetRate = q->m_rate = m_rateOnFirstCNP * q->m_rate;
 		q->mlx.m_first_cnp = false;
+	} else if (!q->mlx.m_eventDecreaseRate.IsRunning()) {
+		ScheduleDecreaseRateMlx(q);
 	}
 }
 
+// A CNP in the same nanosecond as a check counts for the next check, as if the periodic check ran first.
 void RdmaHw::CheckRateDecreaseMlx(Ptr<RdmaQueuePair> q) {
-	ScheduleDecreaseRateMlx(q, 0);
-	if (q->mlx.m_decrease_cnp_arrived) {
+	Time now = Simulator::Now();
+	q->mlx.m_nextDecreaseCheck = now + MicroSeconds(m_rateDecreaseInterval);
+	if (q->mlx.m_decrease_cnp_arrived && q->mlx.m_decreaseCnpTime < now) {
 #if PRINT_LOG
 		printf("%lu rate dec: %08x %08x %u %u (%0.3lf %.3lf)->", Simulator::Now().GetTimeStep(), q->sip.Get(), q->dip.Get(), q->sport, q->dport, q->mlx.m_targetRate.GetBitRate() * 1e-9, q->m_rate.GetBitRate() * 1e-9);
 #endif
+		UpdateAlphaMlx(q);
 		bool clamp = true;
 		if (!m_EcnClampTgtRate) {
 			if (q->mlx.m_rpTimeStage == 0)
@@ -703,22 +974,36 @@ void RdmaHw::CheckRateDecreaseMlx(Ptr<RdmaQueuePair> q) {
 		q->m_rate = std::max(m_minRate, q->m_rate * (1 - q->mlx.m_alpha / 2));
 		// reset rate increase related things
 		q->mlx.m_rpTimeStage = 0;
-		q->mlx.m_decrease_cnp_arrived = false;
+		q->mlx.m_decrease_cnp_arrived = q->mlx.m_lastCnp == now;
+		q->mlx.m_decreaseCnpTime = now;
 		Simulator::Cancel(q->mlx.m_rpTimer);
 		q->mlx.m_rpTimer = Simulator::Schedule(MicroSeconds(m_rpgTimeReset), &RdmaHw::RateIncEventTimerMlx, this, q);
 #if PRINT_LOG
 		printf("(%.3lf %.3lf)\n", q->mlx.m_targetRate.GetBitRate() * 1e-9, q->m_rate.GetBitRate() * 1e-9);
 #endif
 	}
+	if (q->mlx.m_decrease_cnp_arrived)
+		ScheduleDecreaseRateMlx(q);
 }
-void RdmaHw::ScheduleDecreaseRateMlx(Ptr<RdmaQueuePair> q, uint32_t delta) {
-	q->mlx.m_eventDecreaseRate = Simulator::Schedule(MicroSeconds(m_rateDecreaseInterval) + NanoSeconds(delta), &RdmaHw::CheckRateDecreaseMlx, this, q);
+// Schedules the first check from m_nextDecreaseCheck on that is after now.
+void RdmaHw::ScheduleDecreaseRateMlx(Ptr<RdmaQueuePair> q) {
+	Time now = Simulator::Now();
+	if (q->mlx.m_nextDecreaseCheck <= now) {
+		int64_t interval = MicroSeconds(m_rateDecreaseInterval).GetTimeStep();
+		q->mlx.m_nextDecreaseCheck += TimeStep(((now - q->mlx.m_nextDecreaseCheck).GetTimeStep() / interval + 1) * interval);
+	}
+	q->mlx.m_eventDecreaseRate = Simulator::Schedule(q->mlx.m_nextDecreaseCheck - now, &RdmaHw::CheckRateDecreaseMlx, this, q);
 }
 
 void RdmaHw::RateIncEventTimerMlx(Ptr<RdmaQueuePair> q) {
-	q->mlx.m_rpTimer = Simulator::Schedule(MicroSeconds(m_rpgTimeReset), &RdmaHw::RateIncEventTimerMlx, this, q);
+	DataRate rate = q->m_rate, targetRate = q->mlx.m_targetRate;
+	bool hyper = q->mlx.m_rpTimeStage > m_rpgThreshold;
 	RateIncEventMlx(q);
 	q->mlx.m_rpTimeStage++;
+	// a hyper increase that changes nothing (at line rate) is the same at every later event,
+	// until the next rate decrease restarts the timer
+	if (!hyper || q->m_rate != rate || q->mlx.m_targetRate != targetRate)
+		q->mlx.m_rpTimer = Simulator::Schedule(MicroSeconds(m_rpgTimeReset), &RdmaHw::RateIncEventTimerMlx, this, q);
 }
 void RdmaHw::RateIncEventMlx(Ptr<RdmaQueuePair> q) {
 	// check which increase phase: fast recovery, active increase, hyper increase
@@ -990,6 +1275,7 @@ void RdmaHw::UpdateRatePower(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, CustomHeader
 		prevRtt = Simulator::Now().GetNanoSeconds() - it->second;
 		if (PowerTCPdelay) {
 			qp->m_baseRtt = std::min(uint64_t(Simulator::Now().GetNanoSeconds() - it->second), qp->m_baseRtt);
+			SetUnschedBytes(qp);
 		}
 		prevCompletion = Simulator::Now().GetNanoSeconds();
         qp->rates.erase(it);
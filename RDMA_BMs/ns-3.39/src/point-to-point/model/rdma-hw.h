@@ -14,6 +14,8 @@ namespace ns3 {
 struct RdmaInterfaceMgr{
 	Ptr<QbbNetDevice> dev;
 	Ptr<RdmaQueuePairGroup> qpGrp;
+	std::vector<Ptr<RdmaRxQueuePair> > heldAcks; // rx qps with an ACK in the coalescing window
+	EventId ackFlushEvent;
 
 	RdmaInterfaceMgr() : dev(NULL), qpGrp(NULL) {}
 	RdmaInterfaceMgr(Ptr<QbbNetDevice> _dev){
@@ -65,9 +67,30 @@ public:
 
 	void CheckandSendQCN(Ptr<RdmaRxQueuePair> q);
 	int ReceiverCheckSeq(uint32_t seq, Ptr<RdmaRxQueuePair> q, uint32_t size);
+	int ReceiverCheckSeqIrn(uint32_t seq, Ptr<RdmaRxQueuePair> q, uint32_t size);
 	void AddHeader (Ptr<Packet> p, uint16_t protocolNumber);
 	static uint16_t EtherToPpp (uint16_t protocol);
 
+	/******************************
+	 * Receiver feedback
+	 *****************************/
+	Time m_ackCoalesceInterval; // hold ACKs up to this long and send the held ones of a NIC together, 0 sends each at once
+	uint32_t m_ackCoalesceBytes; // send the held ACKs once a rx qp received this many bytes since its last feedback, 0 for no limit
+	Time m_minCnpInterval; // at most one CNP per rx qp in this interval
+	struct FeedbackStats {
+		uint64_t dataBytes; // payload received
+		uint64_t acks, nacks, cnps; // sent; cnps are the ACKs/NACKs with the CNP flag
+		uint64_t coalescedAcks; // ACKs merged into a later ACK/NACK
+		uint64_t suppressedCnps; // ECN feedback dropped by m_minCnpInterval
+		FeedbackStats() { memset(this, 0, sizeof(FeedbackStats)); }
+		void Add(const FeedbackStats &o);
+		void Print(std::ostream &os) const; // one line, with the control packets per KB of data
+	};
+	FeedbackStats m_feedbackStats;
+	void SendFeedback(Ptr<RdmaRxQueuePair> q, bool nack, const IntHeader &ih, bool ecn, uint32_t sack); // sack = 0 for none
+	void HoldAck(Ptr<RdmaRxQueuePair> q, const IntHeader &ih);
+	void FlushAcks(uint32_t nic_idx);
+
 	void RecoverQueue(Ptr<RdmaQueuePair> qp);
 	void QpComplete(Ptr<RdmaQueuePair> qp);
 	void SetLinkDown(Ptr<QbbNetDevice> dev);
@@ -78,9 +101,25 @@ public:
 	void RedistributeQp();
 
 	Ptr<Packet> GetNxtPacket(Ptr<RdmaQueuePair> qp); // get next packet to send, inc snd_nxt
+	bool m_headerTemplate; // build data packets from the pre-serialized headers of the qp
+	void SetUnschedBytes(Ptr<RdmaQueuePair> qp); // from the base rtt of the qp and the rate of its NIC
+	void AddDataHeaders(Ptr<RdmaQueuePair> qp, Ptr<Packet> p, uint64_t seq); // the four headers, without template
+	bool m_rankTag; // stamp data packets with a RankTag for the PIFO egress queues
+	double m_slackFactor; // deadline = start + m_slackFactor * (size / line rate + base rtt)
 	void PktSent(Ptr<RdmaQueuePair> qp, Ptr<Packet> pkt, Time interframeGap);
 	void UpdateNextAvail(Ptr<RdmaQueuePair> qp, Time interframeGap, uint32_t pkt_size);
 	void ChangeRate(Ptr<RdmaQueuePair> qp, DataRate new_rate);
+	/******************************
+	 * IRN selective retransmission
+	 *****************************/
+	bool m_irn; // all qps
+	uint32_t m_irnPgMask; // qps of these pgs
+	double m_irnRtoHigh, m_irnRtoLow; // us
+	uint32_t m_irnRtoLowThresh; // packets on the fly
+	bool IrnEnabled(uint16_t pg);
+	Time IrnRto(Ptr<RdmaQueuePair> qp);
+	void IrnRtoCheck(Ptr<RdmaQueuePair> qp);
+
 	/******************************
 	 * Mellanox's version of DCQCN
 	 *****************************/
@@ -96,8 +135,8 @@ public:
 
 	// the Mellanox's version of alpha update:
 	// every fixed time slot, update alpha.
+	// The slots that ended are applied when alpha is needed, without an event per slot.
 	void UpdateAlphaMlx(Ptr<RdmaQueuePair> q);
-	void ScheduleUpdateAlphaMlx(Ptr<RdmaQueuePair> q);
 
 	// Mellanox's version of CNP receive
 	void cnp_received_mlx(Ptr<RdmaQueuePair> q);
@@ -105,10 +144,12 @@ public:
 	// Mellanox's version of rate decrease
 	// It checks every m_rateDecreaseInterval if CNP arrived (m_decrease_cnp_arrived).
 	// If so, decrease rate, and reset all rate increase related things
+	// Only the checks after a CNP are scheduled, the others do nothing.
 	void CheckRateDecreaseMlx(Ptr<RdmaQueuePair> q);
-	void ScheduleDecreaseRateMlx(Ptr<RdmaQueuePair> q, uint32_t delta);
+	void ScheduleDecreaseRateMlx(Ptr<RdmaQueuePair> q);
 
 	// Mellanox's version of rate increase
+	// The timer stops once the hyper increase changes nothing.
 	void RateIncEventTimerMlx(Ptr<RdmaQueuePair> q);
 	void RateIncEventMlx(Ptr<RdmaQueuePair> q);
 	void FastRecoveryMlx(Ptr<RdmaQueuePair> q);
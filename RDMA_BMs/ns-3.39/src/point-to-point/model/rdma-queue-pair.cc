@@ -1,14 +1,82 @@
+#include <algorithm>
 #include <ns3/hash.h>
 #include <ns3/uinteger.h>
 #include <ns3/seq-ts-header.h>
 #include <ns3/udp-header.h>
 #include <ns3/ipv4-header.h>
 #include <ns3/simulator.h>
+#include <ns3/memory-stats.h>
 #include "ns3/ppp-header.h"
 #include "rdma-queue-pair.h"
 
 namespace ns3 {
 
+/**************************
+ * RdmaSeqBitmap
+ *************************/
+bool RdmaSeqBitmap::Test(uint32_t idx) const {
+	uint32_t cap = m_words.size() * 64;
+	if (idx >= cap)
+		return false;
+	uint32_t pos = (m_head + idx) & (cap - 1);
+	return (m_words[pos >> 6] >> (pos & 63)) & 1;
+}
+
+void RdmaSeqBitmap::Set(uint32_t idx) {
+	uint32_t cap = m_words.size() * 64;
+	if (idx >= cap) { // grow to the next power of 2 and re-lay the bits from position 0
+		uint32_t newCap = cap > 0 ? cap : 64;
+		while (newCap <= idx)
+			newCap *= 2;
+		std::vector<uint64_t> w(newCap / 64, 0);
+		for (uint32_t i = 0; i < cap; i++)
+			if (Test(i))
+				w[i >> 6] |= 1ull << (i & 63);
+		m_words.swap(w);
+		m_head = 0;
+		cap = newCap;
+	}
+	uint32_t pos = (m_head + idx) & (cap - 1);
+	m_words[pos >> 6] |= 1ull << (pos & 63);
+}
+
+void RdmaSeqBitmap::Advance(uint32_t n) {
+	uint32_t cap = m_words.size() * 64;
+	if (cap == 0)
+		return;
+	if (n >= cap) {
+		Clear();
+		return;
+	}
+	while (n > 0) {
+		uint32_t off = m_head & 63;
+		uint32_t bits = std::min(n, 64 - off);
+		uint64_t mask = (bits == 64 ? ~0ull : ((1ull << bits) - 1)) << off;
+		m_words[m_head >> 6] &= ~mask;
+		m_head = (m_head + bits) & (cap - 1);
+		n -= bits;
+	}
+}
+
+uint32_t RdmaSeqBitmap::CountLeadingSet() const {
+	uint32_t cap = m_words.size() * 64;
+	uint32_t n = 0;
+	while (n < cap) {
+		uint32_t pos = (m_head + n) & (cap - 1);
+		uint32_t off = pos & 63;
+		uint64_t unset = ~m_words[pos >> 6] >> off; // shifted-in high bits read as set
+		if (unset)
+			return std::min(cap, n + __builtin_ctzll(unset));
+		n += 64 - off;
+	}
+	return cap;
+}
+
+void RdmaSeqBitmap::Clear() {
+	std::fill(m_words.begin(), m_words.end(), 0);
+	m_head = 0;
+}
+
 /**************************
  * RdmaQueuePair
  *************************/
@@ -21,6 +89,7 @@ TypeId RdmaQueuePair::GetTypeId (void)
 }
 
 RdmaQueuePair::RdmaQueuePair(uint16_t pg, Ipv4Address _sip, Ipv4Address _dip, uint16_t _sport, uint16_t _dport) {
+	NS_MEMORY_STATS_ADD(QP, sizeof(RdmaQueuePair));
 	startTime = Simulator::Now();
 	stopTime = Simulator::GetMaximumSimulationTime();
 	sip = _sip;
@@ -33,14 +102,21 @@ RdmaQueuePair::RdmaQueuePair(uint16_t pg, Ipv4Address _sip, Ipv4Address _dip, ui
 	m_ipid = 0;
 	m_win = 0;
 	m_baseRtt = 0;
+	m_unschedBytes = 0;
 	m_max_rate = 0;
 	m_var_win = false;
 	m_rate = 0;
 	m_nextAvail = Time(0);
+	m_grouped = false;
+	m_idxAvail = Time(0);
+	m_idxBytes = 0;
+	lastPktSize = 0;
+	lastPktEnd = 0;
 	mlx.m_alpha = 1;
 	mlx.m_alpha_cnp_arrived = false;
 	mlx.m_first_cnp = true;
 	mlx.m_decrease_cnp_arrived = false;
+	mlx.m_nextAlphaUpdate = mlx.m_nextDecreaseCheck = mlx.m_decreaseCnpTime = mlx.m_lastCnp = Time(0);
 	mlx.m_rpTimeStage = 0;
 	hp.m_lastUpdateSeq = 0;
 	for (uint32_t i = 0; i < sizeof(hp.keep) / sizeof(hp.keep[0]); i++)
@@ -67,6 +143,17 @@ RdmaQueuePair::RdmaQueuePair(uint16_t pg, Ipv4Address _sip, Ipv4Address _dip, ui
 
 	hpccPint.m_lastUpdateSeq = 0;
 	hpccPint.m_incStage = 0;
+
+	irn.m_enabled = false;
+	irn.m_mtu = 1000;
+	irn.m_bdpCap = 0;
+	irn.m_recoverEnd = 0;
+	irn.m_retxNxt = 0;
+	irn.m_lastAckTime = Time(0);
+}
+
+RdmaQueuePair::~RdmaQueuePair() {
+	NS_MEMORY_STATS_REMOVE(QP, sizeof(RdmaQueuePair));
 }
 
 void RdmaQueuePair::SetSize(uint64_t size) {
@@ -89,8 +176,12 @@ void RdmaQueuePair::SetAppNotifyCallback(Callback<void> notifyAppFinish) {
 	m_notifyAppFinish = notifyAppFinish;
 }
 
+// With IRN, a pending retransmission also counts as bytes left so the NIC keeps scheduling this qp.
 uint64_t RdmaQueuePair::GetBytesLeft() {
-	return m_size >= snd_nxt ? m_size - snd_nxt : 0;
+	uint64_t left = m_size >= snd_nxt ? m_size - snd_nxt : 0;
+	if (irn.m_enabled && IrnHasRetx())
+		left += std::min<uint64_t>(irn.m_mtu, m_size - IrnNextRetx());
+	return left;
 }
 
 uint32_t RdmaQueuePair::GetHash(void) {
@@ -110,7 +201,14 @@ uint32_t RdmaQueuePair::GetHash(void) {
 
 void RdmaQueuePair::Acknowledge(uint64_t ack) {
 	if (ack > snd_una) {
-		snd_una = ack;
+		if (irn.m_enabled) {
+			irn.m_sacked.Advance((ack - snd_una) / irn.m_mtu);
+			irn.m_lastAckTime = Simulator::Now();
+			snd_una = ack;
+			IrnSkipSacked();
+		}
+		else
+			snd_una = ack;
 	}
 }
 
@@ -119,6 +217,12 @@ uint64_t RdmaQueuePair::GetOnTheFly() {
 }
 
 bool RdmaQueuePair::IsWinBound() {
+	if (irn.m_enabled) {
+		if (IrnHasRetx()) // retransmissions do not add bytes on the fly
+			return false;
+		if (irn.m_bdpCap != 0 && GetOnTheFly() >= irn.m_bdpCap)
+			return true;
+	}
 	uint64_t w = GetWin();
 	return w != 0 && GetOnTheFly() >= w;
 }
@@ -160,6 +264,39 @@ uint64_t RdmaQueuePair::HpGetCurWin() {
 	return w;
 }
 
+// IRN: a NACK sacks the out-of-order packet at seq. Every unsacked packet below the highest sack is considered lost.
+void RdmaQueuePair::IrnSack(uint64_t seq) {
+	if (seq < snd_una)
+		return;
+	irn.m_sacked.Set((seq - snd_una) / irn.m_mtu);
+	if (seq > irn.m_recoverEnd)
+		irn.m_recoverEnd = seq;
+	IrnSkipSacked();
+}
+
+void RdmaQueuePair::IrnRetxSent(uint64_t end) {
+	irn.m_retxNxt = end;
+	IrnSkipSacked();
+}
+
+// The cursor only moves forward between two RTOs, so GetBytesLeft and IsWinBound read it in O(1) and every packet
+// is skipped at most once.
+void RdmaQueuePair::IrnSkipSacked() {
+	uint64_t &s = irn.m_retxNxt;
+	if (s < snd_una)
+		s = snd_una;
+	while (s < irn.m_recoverEnd && irn.m_sacked.Test((s - snd_una) / irn.m_mtu))
+		s += irn.m_mtu;
+}
+
+// RTO: everything on the fly that was not sacked is retransmitted.
+void RdmaQueuePair::IrnTimeout() {
+	irn.m_recoverEnd = snd_nxt;
+	irn.m_retxNxt = snd_una;
+	IrnSkipSacked();
+	irn.m_lastAckTime = Simulator::Now();
+}
+
 bool RdmaQueuePair::IsFinished() {
 
 	if (Simulator::Now() > stopTime)
@@ -180,12 +317,23 @@ TypeId RdmaRxQueuePair::GetTypeId (void)
 }
 
 RdmaRxQueuePair::RdmaRxQueuePair() {
+	NS_MEMORY_STATS_ADD(QP, sizeof(RdmaRxQueuePair));
 	sip = dip = sport = dport = 0;
 	m_ipid = 0;
 	ReceiverNextExpectedSeq = 0;
 	m_nackTimer = Time(0);
 	m_milestone_rx = 0;
 	m_lastNACK = 0;
+	m_irn = false;
+	m_irnLastEnd = 0;
+	m_ackPending = false;
+	m_ackEcn = false;
+	m_ackBytes = 0;
+	m_nextCnp = Time(0);
+}
+
+RdmaRxQueuePair::~RdmaRxQueuePair() {
+	NS_MEMORY_STATS_REMOVE(QP, sizeof(RdmaRxQueuePair));
 }
 
 uint32_t RdmaRxQueuePair::GetHash(void) {
@@ -231,6 +379,9 @@ Ptr<RdmaQueuePair> RdmaQueuePairGroup::operator[](uint32_t idx) {
 
 void RdmaQueuePairGroup::AddQp(Ptr<RdmaQueuePair> qp) {
 	m_qps.push_back(qp);
+	qp->m_grouped = true;
+	qp->m_idxBytes = 0;
+	Update(qp);
 }
 
 #if 0
@@ -240,7 +391,36 @@ void RdmaQueuePairGroup::AddRxQp(Ptr<RdmaRxQueuePair> rxQp) {
 #endif
 
 void RdmaQueuePairGroup::Clear(void) {
+	for (auto &qp : m_qps) {
+		qp->m_grouped = false;
+		qp->m_idxBytes = 0;
+	}
 	m_qps.clear();
+	m_pending.clear();
+}
+
+void RdmaQueuePairGroup::Update(Ptr<RdmaQueuePair> qp) {
+	if (!qp->m_grouped)
+		return;
+	if (qp->m_idxBytes > 0)
+		m_pending.erase(std::make_pair(qp->m_idxAvail, PeekPointer(qp)));
+	qp->m_idxAvail = qp->m_nextAvail;
+	qp->m_idxBytes = qp->GetBytesLeft();
+	if (qp->m_idxBytes > 0)
+		m_pending.insert(std::make_pair(qp->m_idxAvail, PeekPointer(qp)));
+}
+
+void RdmaQueuePairGroup::Remove(Ptr<RdmaQueuePair> qp) {
+	if (qp->m_idxBytes > 0)
+		m_pending.erase(std::make_pair(qp->m_idxAvail, PeekPointer(qp)));
+	qp->m_grouped = false;
+	qp->m_idxBytes = 0;
+}
+
+Time RdmaQueuePairGroup::GetNextAvail(void) {
+	if (m_pending.empty())
+		return Simulator::GetMaximumSimulationTime();
+	return m_pending.begin()->first;
 }
 
 }
\ No newline at end of file
@@ -8,12 +8,29 @@
 #include <ns3/event-id.h>
 #include <ns3/custom-header.h>
 #include <ns3/int-header.h>
+#include <ns3/rdma-data-header.h>
 #include <vector>
+#include <set>
 //vamsi
 #include <map>
 
 namespace ns3 {
 
+// One bit per MTU-sized packet, relative to a moving base (the cumulative ack on the sender, the next
+// expected seq on the receiver). Used by IRN selective retransmission. The ring grows on demand.
+class RdmaSeqBitmap {
+public:
+	RdmaSeqBitmap() : m_head(0) {}
+	bool Test(uint32_t idx) const;
+	void Set(uint32_t idx);
+	void Advance(uint32_t n); // drop n bits from the front
+	uint32_t CountLeadingSet() const; // number of consecutive set bits from the front
+	void Clear();
+private:
+	std::vector<uint64_t> m_words;
+	uint32_t m_head;
+};
+
 class RdmaQueuePair : public Object {
 public:
 	Time startTime;
@@ -28,9 +45,15 @@ public:
 	DataRate m_max_rate; // max rate
 	bool m_var_win; // variable window size
 	Time m_nextAvail;	//< Soonest time of next send
+	bool m_grouped; // in the m_qps of a RdmaQueuePairGroup
+	Time m_idxAvail; // m_nextAvail and bytes left as of the last RdmaQueuePairGroup::Update
+	uint64_t m_idxBytes;
 	uint32_t wp; // current window of packets
 	uint32_t lastPktSize;
+	uint64_t lastPktEnd; // end seq of the last data packet built, new or retransmitted: what its ACK acks
 	Callback<void> m_notifyAppFinish;
+	RdmaDataHeader m_dataHdr; // headers of the data packets, patched per packet
+	uint64_t m_unschedBytes; // data starting at or below this offset is unscheduled: the BDP at the NIC rate
 
 // vamsi
 	std::map<uint32_t,double> rates;
@@ -45,14 +68,17 @@ public:
 	DataRate m_rate;	//< Current rate
 	struct {
 		DataRate m_targetRate;	//< Target rate
-		EventId m_eventUpdateAlpha;
+		Time m_nextAlphaUpdate; // end of the current alpha slot, the updates are applied lazily
 		double m_alpha;
 		bool m_alpha_cnp_arrived; // indicate if CNP arrived in the last slot
 		bool m_first_cnp; // indicate if the current CNP is the first CNP
-		EventId m_eventDecreaseRate;
+		EventId m_eventDecreaseRate; // only scheduled after a CNP
+		Time m_nextDecreaseCheck;
 		bool m_decrease_cnp_arrived; // indicate if CNP arrived in the last slot
+		Time m_decreaseCnpTime; // first CNP of the slot
+		Time m_lastCnp;
 		uint32_t m_rpTimeStage;
-		EventId m_rpTimer;
+		EventId m_rpTimer; // stopped once the rate does not increase any more
 	} mlx;
 	struct {
 		uint32_t m_lastUpdateSeq;
@@ -104,12 +130,23 @@ public:
 		DataRate m_curRate;
 		uint32_t m_incStage;
 	}hpccPint;
+	struct {
+		bool m_enabled; // selective retransmission instead of go-back-N
+		uint32_t m_mtu;
+		uint64_t m_bdpCap; // max bytes on the fly
+		RdmaSeqBitmap m_sacked; // bit i: packet at snd_una + i * m_mtu was sacked
+		uint64_t m_recoverEnd; // packets below this that are not sacked are considered lost
+		uint64_t m_retxNxt; // seq of the next lost packet to retransmit, or at least m_recoverEnd if none
+		Time m_lastAckTime; // last time the cumulative ack advanced, for the RTO
+		EventId m_rtoEvent;
+	} irn;
 
 	/***********
 	 * methods
 	 **********/
 	static TypeId GetTypeId (void);
 	RdmaQueuePair(uint16_t pg, Ipv4Address _sip, Ipv4Address _dip, uint16_t _sport, uint16_t _dport);
+	~RdmaQueuePair();
 	void SetSize(uint64_t size);
 	void SetWin(uint32_t win);
 	void SetBaseRtt(uint64_t baseRtt);
@@ -124,6 +161,12 @@ public:
 	uint64_t GetWin(); // window size calculated from m_rate
 	bool IsFinished();
 	uint64_t HpGetCurWin(); // window size calculated from hp.m_curRate, used by HPCC
+	void IrnSack(uint64_t seq);
+	uint64_t IrnNextRetx() {return irn.m_retxNxt;} // seq of the next lost packet to retransmit
+	bool IrnHasRetx() {return irn.m_retxNxt < irn.m_recoverEnd;} // a lost packet is waiting for retransmission
+	void IrnRetxSent(uint64_t end); // the retransmission of IrnNextRetx() up to end was sent
+	void IrnTimeout();
+	void IrnSkipSacked(); // moves m_retxNxt past snd_una and the sacked packets
 	uint32_t incastFlow;
 };
 
@@ -146,9 +189,19 @@ public:
 	int32_t m_milestone_rx;
 	uint32_t m_lastNACK;
 	EventId QcnTimerEvent; // if destroy this rxQp, remember to cancel this timer
+	bool m_irn; // accept out-of-order packets, NACK each of them with a SACK
+	RdmaSeqBitmap m_irnRcv; // bit i: packet at ReceiverNextExpectedSeq + i * mtu was received
+	uint32_t m_irnLastEnd; // end seq of a received packet shorter than mtu (the last one of a message), 0 if none
+	// feedback state, see RdmaHw::SendFeedback
+	bool m_ackPending; // an ACK is held in the coalescing window of the NIC
+	bool m_ackEcn; // ECN seen since the last ACK/NACK (coalescing only)
+	uint32_t m_ackBytes; // bytes received since the last ACK/NACK (coalescing only)
+	IntHeader m_ackIh; // INT of the latest packet, for the held ACK
+	Time m_nextCnp; // no CNP before this time
 
 	static TypeId GetTypeId (void);
 	RdmaRxQueuePair();
+	~RdmaRxQueuePair();
 	uint32_t GetHash(void);
 };
 
@@ -156,6 +209,9 @@ class RdmaQueuePairGroup : public Object {
 public:
 	std::vector<Ptr<RdmaQueuePair> > m_qps;
 	//std::vector<Ptr<RdmaRxQueuePair> > m_rxQps;
+	// The qps of m_qps that have bytes left, by m_nextAvail.
+	// Whoever changes the m_nextAvail or the bytes left of a qp calls Update.
+	std::set<std::pair<Time, RdmaQueuePair*> > m_pending;
 
 	static TypeId GetTypeId (void);
 	RdmaQueuePairGroup(void);
@@ -165,6 +221,9 @@ public:
 	void AddQp(Ptr<RdmaQueuePair> qp);
 	//void AddRxQp(Ptr<RdmaRxQueuePair> rxQp);
 	void Clear(void);
+	void Update(Ptr<RdmaQueuePair> qp); // no-op if qp is not in m_qps
+	void Remove(Ptr<RdmaQueuePair> qp); // from the index, before it leaves m_qps
+	Time GetNextAvail(void); // earliest m_nextAvail of a qp with bytes left, the max simulation time if none
 };
 
 }
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include "ns3/log.h"
+#include "ns3/timestamp-tag.h"
+#include "switch-aqm.h"
+
+NS_LOG_COMPONENT_DEFINE("SwitchAqm");
+namespace ns3 {
+TypeId SwitchAqm::GetTypeId(void) {
+	static TypeId tid = TypeId("ns3::SwitchAqm")
+	                    .SetParent<Object>()
+	                    .AddConstructor<SwitchAqm>()
+	                    .AddAttribute("Pi2Classic",
+	                                  "PI2 marks with probability p'^2 (classic congestion control) instead of p' (scalable, e.g. DCTCP/DCQCN)",
+	                                  BooleanValue(false),
+	                                  MakeBooleanAccessor(&SwitchAqm::m_pi2Classic),
+	                                  MakeBooleanChecker());
+	return tid;
+}
+
+SwitchAqm::SwitchAqm(void) {
+	m_uv = CreateObject<UniformRandomVariable>();
+	m_pi2Classic = false;
+
+	for (uint32_t port = 0; port < pCnt; port++) {
+		// RED thresholds must be set with ConfigRed (SwitchMmu::ConfigEcn).
+		kmin[port] = kmax[port] = 0;
+		pmax[port] = 0;
+
+		// PI2 gains are RFC 9332 defaults with the time scale shrunk by 1000x for datacenter RTTs.
+		pi2Target[port] = 15000;
+		pi2Tupdate[port] = 16000;
+		pi2Alpha[port] = 160;
+		pi2Beta[port] = 3200;
+
+		// Step marking at 10us of queueing delay.
+		sojournMin[port] = sojournMax[port] = 10000;
+		sojournPmax[port] = 1;
+
+		// HULL: phantom queue drained at 95% of the line rate, marking above 1KB.
+		phantomGamma[port] = 0.95;
+		phantomKmin[port] = phantomKmax[port] = 1000;
+		phantomPmax[port] = 1;
+
+		for (uint32_t q = 0; q < qCnt; q++) {
+			alg[port][q] = AQM_RED;
+			markPoint[port][q] = MARK_DEQUEUE;
+
+			pi2Prob[port][q] = 0;
+			pi2Delay[port][q] = 0;
+			pi2LastDelay[port][q] = 0;
+			pi2LastUpdate[port][q] = 0;
+			vqBytes[port][q] = 0;
+			vqLastUpdate[port][q] = 0;
+		}
+	}
+}
+
+int64_t SwitchAqm::AssignStreams(int64_t stream) {
+	m_uv->SetStream(stream);
+	return 1;
+}
+
+void SwitchAqm::SetAqm(uint32_t port, uint32_t qIndex, uint32_t _alg, uint32_t _markPoint) {
+	if (_alg > AQM_PHANTOM || _markPoint > MARK_ENQUEUE) {
+		std::cout << "Error in SetAqm: unknown AQM algorithm " << _alg << " or marking point " << _markPoint << std::endl;
+		exit(1);
+	}
+	alg[port][qIndex] = _alg;
+	markPoint[port][qIndex] = _markPoint;
+}
+
+void SwitchAqm::SetAqm(uint32_t _alg, uint32_t _markPoint) {
+	for (uint32_t port = 0; port < pCnt; port++) {
+		for (uint32_t q = 0; q < qCnt; q++) {
+			SetAqm(port, q, _alg, _markPoint);
+		}
+	}
+}
+
+void SwitchAqm::ConfigRed(uint32_t port, uint64_t _kmin, uint64_t _kmax, double _pmax) {
+	kmin[port] = _kmin;
+	kmax[port] = _kmax;
+	pmax[port] = _pmax;
+}
+
+void SwitchAqm::ConfigPi2(uint32_t port, uint64_t targetNs, uint64_t tupdateNs, double alpha, double beta) {
+	NS_ASSERT_MSG(tupdateNs > 0, "PI2 update interval must be positive");
+	pi2Target[port] = targetNs;
+	pi2Tupdate[port] = tupdateNs;
+	pi2Alpha[port] = alpha;
+	pi2Beta[port] = beta;
+}
+
+void SwitchAqm::ConfigSojourn(uint32_t port, uint64_t minNs, uint64_t maxNs, double _pmax) {
+	sojournMin[port] = minNs;
+	sojournMax[port] = maxNs;
+	sojournPmax[port] = _pmax;
+}
+
+void SwitchAqm::ConfigPhantom(uint32_t port, double gamma, uint64_t _kmin, uint64_t _kmax, double _pmax) {
+	phantomGamma[port] = gamma;
+	phantomKmin[port] = _kmin;
+	phantomKmax[port] = _kmax;
+	phantomPmax[port] = _pmax;
+}
+
+bool SwitchAqm::ShouldMarkEnqueue(uint32_t port, uint32_t qIndex, Ptr<Packet> p, uint64_t qlen, uint64_t bw) {
+	uint64_t now = Simulator::Now().GetTimeStep();
+	uint32_t a = alg[port][qIndex];
+
+	// state updates happen regardless of where we mark
+	if (a == AQM_PI2)
+		Pi2Update(port, qIndex, qlen, bw, now);
+	else if (a == AQM_SOJOURN && markPoint[port][qIndex] == MARK_DEQUEUE)
+		p->AddPacketTag(TimestampTag(Simulator::Now())); // per packet, as PIFO queues do not dequeue in arrival order
+	else if (a == AQM_PHANTOM) {
+		PhantomDrain(port, qIndex, bw, now);
+		vqBytes[port][qIndex] += p->GetSize();
+	}
+
+	if (markPoint[port][qIndex] != MARK_ENQUEUE)
+		return false;
+
+	// At enqueue the sojourn time is not known yet; use the time needed to drain the backlog instead.
+	uint64_t sojourn = 0;
+	if (a == AQM_SOJOURN && bw > 0)
+		sojourn = qlen * 8e9 / bw;
+	return Decide(port, qIndex, qlen, bw, sojourn, now);
+}
+
+bool SwitchAqm::ShouldMarkDequeue(uint32_t port, uint32_t qIndex, Ptr<Packet> p, uint64_t qlen, uint64_t bw) {
+	uint64_t now = Simulator::Now().GetTimeStep();
+	if (alg[port][qIndex] == AQM_PI2)
+		Pi2Update(port, qIndex, qlen, bw, now);
+	if (markPoint[port][qIndex] != MARK_DEQUEUE)
+		return false;
+
+	uint64_t sojourn = 0;
+	TimestampTag ts;
+	if (alg[port][qIndex] == AQM_SOJOURN && p->RemovePacketTag(ts)) // no tag if the algorithm was switched while queued
+		sojourn = now - ts.GetTimestamp().GetTimeStep();
+	else if (alg[port][qIndex] == AQM_PHANTOM)
+		PhantomDrain(port, qIndex, bw, now);
+	return Decide(port, qIndex, qlen, bw, sojourn, now);
+}
+
+bool SwitchAqm::Decide(uint32_t port, uint32_t qIndex, uint64_t qlen, uint64_t bw, uint64_t sojourn, uint64_t now) {
+	switch (alg[port][qIndex]) {
+	case AQM_RED:
+		return Ramp(qlen, kmin[port], kmax[port], pmax[port]);
+	case AQM_PI2: {
+		double p = pi2Prob[port][qIndex];
+		if (m_pi2Classic)
+			p = p * p;
+		return p > 0 && m_uv->GetValue() < p;
+	}
+	case AQM_SOJOURN:
+		return Ramp(sojourn, sojournMin[port], sojournMax[port], sojournPmax[port]);
+	case AQM_PHANTOM:
+		return Ramp(vqBytes[port][qIndex], phantomKmin[port], phantomKmax[port], phantomPmax[port]);
+	}
+	return false;
+}
+
+// Marks with certainty above hi and with probability rising linearly to p between lo and hi.
+bool SwitchAqm::Ramp(uint64_t v, uint64_t lo, uint64_t hi, double p) {
+	if (v > hi)
+		return true;
+	if (v > lo) {
+		double prob = p * double(v - lo) / (hi - lo);
+		if (m_uv->GetValue() < prob)
+			return true;
+	}
+	return false;
+}
+
+// The controller is updated lazily on the enqueues and dequeues of the queue, which are the only times its length
+// changes. The tupdate intervals that ended since the previous event all saw the delay that event left, so they are
+// applied at once with that delay; the delay after this event is only recorded, for the next intervals.
+void SwitchAqm::Pi2Update(uint32_t port, uint32_t qIndex, uint64_t qlen, uint64_t bw, uint64_t now) {
+	uint64_t steps = (now - pi2LastUpdate[port][qIndex]) / pi2Tupdate[port];
+	if (steps > 0) {
+		double qdelay = pi2Delay[port][qIndex];
+		double inc = pi2Alpha[port] * (qdelay - double(pi2Target[port])) * 1e-9;
+		// the first interval has the proportional term; the others add the same inc, so clamping once is exact
+		double p = pi2Prob[port][qIndex] + inc + pi2Beta[port] * (qdelay - pi2LastDelay[port][qIndex]) * 1e-9;
+		p = std::min(1.0, std::max(0.0, p)) + inc * (steps - 1);
+		pi2Prob[port][qIndex] = std::min(1.0, std::max(0.0, p));
+		pi2LastDelay[port][qIndex] = qdelay;
+		pi2LastUpdate[port][qIndex] += steps * pi2Tupdate[port];
+	}
+	pi2Delay[port][qIndex] = (bw > 0) ? qlen * 8e9 / bw : 0;
+}
+
+void SwitchAqm::PhantomDrain(uint32_t port, uint32_t qIndex, uint64_t bw, uint64_t now) {
+	double drained = (now - vqLastUpdate[port][qIndex]) * phantomGamma[port] * bw / 8e9;
+	vqBytes[port][qIndex] = std::max(0.0, vqBytes[port][qIndex] - drained);
+	vqLastUpdate[port][qIndex] = now;
+}
+
+}
@@ -0,0 +1,104 @@
+#ifndef SWITCH_AQM_H
+#define SWITCH_AQM_H
+
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3 {
+
+/*
+SwitchAqm decides whether a packet on an egress queue of the RDMA switch gets CE marked.
+The algorithm and the marking point (enqueue or dequeue) are selected per port and queue.
+Algorithm parameters are per port, same as the legacy kmin/kmax/pmax ECN configuration.
+
+	AQM_RED      ramp between kmin and kmax bytes of egress queue length (default, the legacy behavior)
+	AQM_PI2      PI controller on the queueing delay, p' updated every tupdate ns (RFC 9332 style)
+	AQM_SOJOURN  ramp between min and max ns of queueing delay (TCN-like when min == max)
+	AQM_PHANTOM  ramp on a virtual queue drained at gamma * link rate (HULL-like)
+
+The caller (SwitchMmu) passes the queue length and the link rate, so this class only holds AQM state.
+*/
+class SwitchAqm : public Object {
+public:
+	static const uint32_t pCnt = 257;	// Number of ports used
+	static const uint32_t qCnt = 8;	// Number of queues/priorities used
+
+	enum {
+		AQM_RED = 0,
+		AQM_PI2 = 1,
+		AQM_SOJOURN = 2,
+		AQM_PHANTOM = 3
+	};
+	enum {
+		MARK_DEQUEUE = 0,
+		MARK_ENQUEUE = 1
+	};
+
+	static TypeId GetTypeId (void);
+
+	SwitchAqm(void);
+
+	int64_t AssignStreams(int64_t stream);
+
+	// Must be set before any traffic is enqueued: the sojourn algorithm stamps packets at enqueue.
+	void SetAqm(uint32_t port, uint32_t qIndex, uint32_t alg, uint32_t markPoint);
+	void SetAqm(uint32_t alg, uint32_t markPoint);
+
+	void ConfigRed(uint32_t port, uint64_t _kmin, uint64_t _kmax, double _pmax);
+	void ConfigPi2(uint32_t port, uint64_t targetNs, uint64_t tupdateNs, double alpha, double beta);
+	void ConfigSojourn(uint32_t port, uint64_t minNs, uint64_t maxNs, double _pmax);
+	void ConfigPhantom(uint32_t port, double gamma, uint64_t _kmin, uint64_t _kmax, double _pmax);
+
+	// qlen is the egress queue length in bytes after p was added (enqueue) or removed (dequeue). bw is in bps.
+	bool ShouldMarkEnqueue(uint32_t port, uint32_t qIndex, Ptr<Packet> p, uint64_t qlen, uint64_t bw);
+	bool ShouldMarkDequeue(uint32_t port, uint32_t qIndex, Ptr<Packet> p, uint64_t qlen, uint64_t bw);
+
+	uint32_t GetAlgorithm(uint32_t port, uint32_t qIndex) {return alg[port][qIndex];}
+	uint32_t GetMarkPoint(uint32_t port, uint32_t qIndex) {return markPoint[port][qIndex];}
+	double GetPi2Prob(uint32_t port, uint32_t qIndex) {return pi2Prob[port][qIndex];} // p', as of the last enqueue or dequeue
+
+	// per queue selection
+	uint32_t alg[pCnt][qCnt];
+	uint32_t markPoint[pCnt][qCnt];
+
+	// RED, bytes
+	uint64_t kmin[pCnt], kmax[pCnt];
+	double pmax[pCnt];
+
+	// PI2, delays in ns and gains in 1/s
+	uint64_t pi2Target[pCnt];
+	uint64_t pi2Tupdate[pCnt];
+	double pi2Alpha[pCnt];
+	double pi2Beta[pCnt];
+
+	// Sojourn, ns
+	uint64_t sojournMin[pCnt], sojournMax[pCnt];
+	double sojournPmax[pCnt];
+
+	// Phantom queue, bytes
+	double phantomGamma[pCnt];
+	uint64_t phantomKmin[pCnt], phantomKmax[pCnt];
+	double phantomPmax[pCnt];
+
+private:
+	bool Ramp(uint64_t v, uint64_t lo, uint64_t hi, double p);
+	void Pi2Update(uint32_t port, uint32_t qIndex, uint64_t qlen, uint64_t bw, uint64_t now);
+	void PhantomDrain(uint32_t port, uint32_t qIndex, uint64_t bw, uint64_t now);
+	bool Decide(uint32_t port, uint32_t qIndex, uint64_t qlen, uint64_t bw, uint64_t sojourn, uint64_t now);
+
+	Ptr<UniformRandomVariable> m_uv; // allocated once, drawn for every probabilistic mark
+	bool m_pi2Classic; // mark with p'^2 instead of p'
+
+	// per queue run time
+	double pi2Prob[pCnt][qCnt];
+	double pi2Delay[pCnt][qCnt]; // queueing delay since the last enqueue or dequeue, ns
+	double pi2LastDelay[pCnt][qCnt]; // at the last tupdate interval, ns
+	uint64_t pi2LastUpdate[pCnt][qCnt];
+	double vqBytes[pCnt][qCnt];
+	uint64_t vqLastUpdate[pCnt][qCnt];
+};
+
+} /* namespace ns3 */
+
+#endif /* SWITCH_AQM_H */
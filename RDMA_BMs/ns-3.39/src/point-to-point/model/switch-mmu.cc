@@ -1,5 +1,7 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <cmath>
 #include "ns3/packet.h"
 #include "ns3/simulator.h"
 #include "ns3/object-vector.h"
@@ -8,8 +10,9 @@
 #include "ns3/assert.h"
 #include "ns3/global-value.h"
 #include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/memory-stats.h"
 #include "ns3/simulator.h"
-#include "ns3/random-variable.h"
 #include "switch-mmu.h"
 
 #define LOSSLESS 0
@@ -28,7 +31,12 @@ namespace ns3 {
 TypeId SwitchMmu::GetTypeId(void) {
 	static TypeId tid = TypeId("ns3::SwitchMmu")
 	                    .SetParent<Object>()
-	                    .AddConstructor<SwitchMmu>();
+	                    .AddConstructor<SwitchMmu>()
+	                    .AddAttribute("Gamma",
+	                                  "Reverie low pass filter gamma.",
+	                                  DoubleValue(0.99),
+	                                  MakeDoubleAccessor(&SwitchMmu::Reveriegamma),
+	                                  MakeDoubleChecker<double>(0, 1));
 	return tid;
 }
 
@@ -54,8 +62,9 @@ similarly `egressPool[LOSSLESS]` for lossless traffic.
 
 
 SwitchMmu::SwitchMmu(void) {
-
+	NS_MEMORY_STATS_ADD(MMU, sizeof(SwitchMmu));
 	// Here we just initialize some default values.
+	aqm = CreateObject<SwitchAqm>();
 	// The buffer can be configured using Set functions through the simulation file later.
 
 	// Buffer model
@@ -64,6 +73,7 @@ SwitchMmu::SwitchMmu(void) {
 	// Buffer pools
 	bufferPool = 24 * 1024 * 1024; // ASIC buffer size i.e, total shared buffer
 	ingressPool = 18 * 1024 * 1024; // Size of ingress pool. Note: This is shared by both lossless and lossy traffic.
+	memset(egressPool, 0, sizeof(egressPool));
 	egressPool[LOSSLESS] = 24 * 1024 * 1024; // Size of egress lossless pool. Lossless bypasses egress admission
 	egressPool[LOSSY] = 14 * 1024 * 1024; // Size of egress lossy pool.
 	sharedPool = 18 * 1024 * 1024; // For Reverie which maintains a single shared buffer pool, all lossless and lossy share this pool
@@ -79,6 +89,7 @@ SwitchMmu::SwitchMmu(void) {
 	// `totalUsed` IMPORTANT TO NOTE: THIS IS NOT bytes in the "ingress pool".
 	// This is the total bytes USED in the switch buffer, which includes occupied buffer in reserved + headroom + ingresspool.
 	totalUsed = 0;
+	memset(egressPoolUsed, 0, sizeof(egressPoolUsed));
 	egressPoolUsed[LOSSLESS] = 0; // Total bytes USED in the egress lossless pool
 	egressPoolUsed[LOSSY] = 0; // Total bytes USED in the egress lossy pool
 	xoffTotalUsed = 0; // Total headroom bytes USED so far. Updated at runtime.
@@ -135,9 +146,22 @@ SwitchMmu::SwitchMmu(void) {
 	egressAlg[LOSSY] = DT;
 
 
+	// No buffer profiles: every queue uses ingressPool and egressPool[type], priority group i goes to queue i.
+	for (uint32_t pg = 0; pg < qCnt; pg++)
+		pgToQueue[pg] = pg;
+	memset(ingressProfile, NO_PROFILE, sizeof(ingressProfile));
+	memset(egressProfile, NO_PROFILE, sizeof(egressProfile));
+	nIngressPools = 0;
+	nEgressPools = 2;
+	memset(ingressPools, 0, sizeof(ingressPools));
+	memset(ingressPoolReserved, 0, sizeof(ingressPoolReserved));
+	memset(ingressPoolSharedUsed, 0, sizeof(ingressPoolSharedUsed));
+
 	memset(ingress_bytes, 0, sizeof(ingress_bytes));
 	memset(paused, 0, sizeof(paused));
 	memset(egress_bytes, 0, sizeof(egress_bytes));
+	memset(egressPortBytes, 0, sizeof(egressPortBytes));
+	occStatsEnabled = false;
 
 	dequeueUpdatedOnce = 0; // For ABM, to trigger dequeue rate updates
 	lpfUpdatedOnce = 0; // For Reverie, LPF updates
@@ -146,6 +170,10 @@ SwitchMmu::SwitchMmu(void) {
 	portCount = pCnt; // default value is 257. This should be set to the real port count using SetPortCount function externally based on the simulation setup
 }
 
+SwitchMmu::~SwitchMmu() {
+	NS_MEMORY_STATS_REMOVE(MMU, sizeof(SwitchMmu));
+}
+
 void
 SwitchMmu::SetBufferPool(uint64_t b) {
 	bufferPool = b;
@@ -318,6 +346,221 @@ SwitchMmu::SetEgressLosslessAlg(uint32_t alg) {
 	egressAlg[LOSSLESS] = alg;
 }
 
+/*
+Buffer configuration file, one statement per line, # starts a comment:
+
+	pool <name> ingress|egress lossless|lossy <size in bytes>
+	profile <name> <pool> <dynamic_th> [size=<bytes>] [xoff=<bytes>] [xon=<bytes>] [xon_offset=<bytes>]
+	pg <ports> <pgs> <profile>
+	queue <ports> <queues> <profile>
+	map <pg> <queue>
+
+As in SONiC, the alpha of a profile is 2^dynamic_th and size is the reserved buffer; size, xoff, xon and xon_offset that
+are not given keep the values of the queue. pg binds ingress profiles to the priority groups of ports, queue binds egress
+profiles to egress queues. <ports> and <pgs>/<queues> are a number, a range a-b or all. The pool of the ingress profile
+of a priority group decides whether it is lossless, instead of MyPriorityTag. map sends the packets of a priority group
+to another egress queue (and ingress priority group); only a priority group and a queue bound to lossy profiles on
+every port can be mapped, since PFC pauses a lossless priority group by its index at the upstream device.
+
+Ingress pools are carved out of ingressPool, which stays the limit of all of them together. Egress pools come next to
+the default lossless and lossy pools, which keep serving the queues without a profile.
+*/
+static void BufferConfigError(const std::string &line, const std::string &what) {
+	std::cout << "buffer config: " << what << " in \"" << line << "\". Exiting..!" << std::endl;
+	exit(1);
+}
+
+static void ParseRange(const std::string &line, const std::string &s, uint32_t &lo, uint32_t &hi) {
+	if (s == "all") {
+		lo = 0;
+		hi = 0xffffffff;
+		return;
+	}
+	size_t dash = s.find('-');
+	char *end;
+	lo = strtoul(s.c_str(), &end, 10);
+	hi = dash == std::string::npos ? lo : strtoul(s.c_str() + dash + 1, &end, 10);
+	if (*end != '\0' || hi < lo)
+		BufferConfigError(line, "bad range " + s);
+}
+
+void SwitchBufferConfig::Load(std::istream &is) {
+	std::string line;
+	while (std::getline(is, line)) {
+		std::string text = line.substr(0, line.find('#'));
+		std::istringstream iss(text);
+		std::string kind;
+		if (!(iss >> kind))
+			continue;
+		if (kind == "pool") {
+			Pool pool;
+			std::string dir, mode;
+			if (!(iss >> pool.name >> dir >> mode >> pool.size) || (dir != "ingress" && dir != "egress") || (mode != "lossless" && mode != "lossy"))
+				BufferConfigError(line, "expected pool <name> ingress|egress lossless|lossy <size>");
+			pool.ingress = dir == "ingress";
+			pool.lossless = mode == "lossless";
+			pools.push_back(pool);
+		}
+		else if (kind == "profile") {
+			Profile profile;
+			std::string poolName, kv;
+			int dynamicTh;
+			if (!(iss >> profile.name >> poolName >> dynamicTh))
+				BufferConfigError(line, "expected profile <name> <pool> <dynamic_th>");
+			profile.pool = pools.size();
+			for (uint32_t i = 0; i < pools.size(); i++)
+				if (pools[i].name == poolName)
+					profile.pool = i;
+			if (profile.pool == pools.size())
+				BufferConfigError(line, "unknown pool " + poolName);
+			profile.alpha = std::pow(2.0, dynamicTh);
+			profile.size = profile.xoff = profile.xon = profile.xonOffset = -1;
+			while (iss >> kv) {
+				size_t eq = kv.find('=');
+				if (eq == std::string::npos)
+					BufferConfigError(line, "expected key=value, got " + kv);
+				std::string key = kv.substr(0, eq);
+				char *end;
+				int64_t value = strtoll(kv.c_str() + eq + 1, &end, 10);
+				if (eq + 1 == kv.size() || *end != '\0' || value < 0)
+					BufferConfigError(line, "expected a number of bytes, got " + kv);
+				if (key == "size")
+					profile.size = value;
+				else if (key == "xoff")
+					profile.xoff = value;
+				else if (key == "xon")
+					profile.xon = value;
+				else if (key == "xon_offset")
+					profile.xonOffset = value;
+				else
+					BufferConfigError(line, "unknown key " + key);
+			}
+			if (profiles.size() >= SwitchMmu::NO_PROFILE)
+				BufferConfigError(line, "too many profiles");
+			profiles.push_back(profile);
+		}
+		else if (kind == "pg" || kind == "queue") {
+			Binding b;
+			std::string ports, queues, profileName;
+			if (!(iss >> ports >> queues >> profileName))
+				BufferConfigError(line, "expected " + kind + " <ports> <queues> <profile>");
+			b.ingress = kind == "pg";
+			ParseRange(line, ports, b.portMin, b.portMax);
+			ParseRange(line, queues, b.qMin, b.qMax);
+			b.profile = profiles.size();
+			for (uint32_t i = 0; i < profiles.size(); i++)
+				if (profiles[i].name == profileName)
+					b.profile = i;
+			if (b.profile == profiles.size())
+				BufferConfigError(line, "unknown profile " + profileName);
+			if (pools[profiles[b.profile].pool].ingress != b.ingress)
+				BufferConfigError(line, "profile " + profileName + (b.ingress ? " is not an ingress profile" : " is not an egress profile"));
+			bindings.push_back(b);
+		}
+		else if (kind == "map") {
+			uint32_t pg, q;
+			if (!(iss >> pg >> q) || pg >= SwitchMmu::qCnt || q >= SwitchMmu::qCnt || (q == 0) != (pg == 0))
+				BufferConfigError(line, "expected map <pg> <queue>, queue 0 only for pg 0");
+			if (pgToQueue.empty())
+				for (uint32_t i = 0; i < SwitchMmu::qCnt; i++)
+					pgToQueue.push_back(i);
+			pgToQueue[pg] = q;
+		}
+		else
+			BufferConfigError(line, "unknown statement " + kind);
+	}
+}
+
+void SwitchBufferConfig::Load(std::string file) {
+	std::ifstream is(file);
+	if (!is.is_open()) {
+		std::cout << "cannot open buffer config " << file << ". Exiting..!" << std::endl;
+		exit(1);
+	}
+	Load(is);
+}
+
+void SwitchMmu::ApplyBufferConfig(const SwitchBufferConfig &cfg) {
+	if (totalUsed != 0) {
+		std::cout << "buffer profiles can only be applied to an empty buffer. Exiting..!" << std::endl;
+		exit(1);
+	}
+	// pools
+	std::vector<uint32_t> poolIdx;
+	nIngressPools = 0;
+	nEgressPools = 2;
+	for (auto &pool : cfg.pools) {
+		uint32_t &n = pool.ingress ? nIngressPools : nEgressPools;
+		if (n >= poolCnt) {
+			std::cout << "more than " << poolCnt << " buffer pools per direction. Exiting..!" << std::endl;
+			exit(1);
+		}
+		if (pool.ingress)
+			ingressPools[n] = pool.size;
+		else
+			egressPool[n] = pool.size;
+		poolIdx.push_back(n++);
+	}
+
+	// profiles, then the queues bound to them. A later binding of a queue replaces the earlier one.
+	profilePool.clear();
+	profileType.clear();
+	for (auto &profile : cfg.profiles) {
+		profilePool.push_back(poolIdx[profile.pool]);
+		profileType.push_back(cfg.pools[profile.pool].lossless ? LOSSLESS : LOSSY);
+	}
+	for (auto &b : cfg.bindings) {
+		const SwitchBufferConfig::Profile &profile = cfg.profiles[b.profile];
+		uint32_t portMax = std::min(b.portMax, std::min(portCount, pCnt - 1));
+		uint32_t qMax = std::min(b.qMax, qCnt - 1);
+		for (uint32_t port = std::max(b.portMin, 1u); port <= portMax; port++) { // port 0 is the loopback
+			for (uint32_t q = b.qMin; q <= qMax; q++) {
+				if (b.ingress) {
+					ingressProfile[port][q] = b.profile;
+					alphaIngress[port][q] = profile.alpha;
+					if (profile.size >= 0)
+						SetReserved(profile.size, port, q, "ingress");
+					if (profile.xoff >= 0)
+						SetHeadroom(profile.xoff, port, q);
+					if (profile.xon >= 0)
+						SetXon(profile.xon, port, q);
+					if (profile.xonOffset >= 0)
+						SetXonOffset(profile.xonOffset, port, q);
+				}
+				else {
+					egressProfile[port][q] = b.profile;
+					alphaEgress[port][q] = profile.alpha;
+				}
+			}
+		}
+	}
+	memset(ingressPoolReserved, 0, sizeof(ingressPoolReserved));
+	memset(ingressPoolSharedUsed, 0, sizeof(ingressPoolSharedUsed));
+	for (uint32_t port = 0; port < pCnt; port++)
+		for (uint32_t q = 0; q < qCnt; q++)
+			if (ingressProfile[port][q] != NO_PROFILE)
+				ingressPoolReserved[profilePool[ingressProfile[port][q]]] += reserveIngress[port][q];
+
+	// priority groups to queues
+	for (uint32_t pg = 0; pg < qCnt; pg++)
+		pgToQueue[pg] = cfg.pgToQueue.empty() ? pg : cfg.pgToQueue[pg];
+	// Without lossy profiles, the packets of a priority group can be lossless (untagged packets are), and PFC would pause
+	// the queue they are mapped to instead of the priority group itself. Both must be lossy on every port.
+	for (uint32_t pg = 0; pg < qCnt; pg++) {
+		uint32_t q = pgToQueue[pg];
+		if (q == pg)
+			continue;
+		for (uint32_t port = 1; port <= std::min(portCount, pCnt - 1); port++) {
+			uint8_t pr = ingressProfile[port][pg], qpr = ingressProfile[port][q];
+			if (pr == NO_PROFILE || profileType[pr] != LOSSY || qpr == NO_PROFILE || profileType[qpr] != LOSSY) {
+				std::cout << "priority group " << pg << " is mapped to queue " << q << " but they are not both bound to lossy profiles on port "
+				          << port << ". Exiting..!" << std::endl;
+				exit(1);
+			}
+		}
+	}
+}
+
 uint64_t SwitchMmu::GetIngressReservedUsed() {
 	return totalIngressReservedUsed;
 }
@@ -335,15 +578,39 @@ uint64_t SwitchMmu::GetIngressSharedUsed() {
 	return (totalUsed - xoffTotalUsed - totalIngressReservedUsed);
 }
 
+// The bytes of a queue beyond its reserved and its headroom. Summed over the queues of a pool, this is the part of the
+// shared pool that the pool uses, as GetIngressSharedUsed is for all the queues.
+int64_t SwitchMmu::GetIngressSharedBytes(uint32_t port, uint32_t qIndex) {
+	return int64_t(ingress_bytes[port][qIndex]) - int64_t(xoffUsed[port][qIndex]) - int64_t(GetIngressReservedUsed(port, qIndex));
+}
+
+uint64_t SwitchMmu::GetIngressSharedFree(uint32_t port, uint32_t qIndex) {
+	uint8_t pr = ingressProfile[port][qIndex];
+	if (pr == NO_PROFILE) {
+		uint64_t ingressPoolSharedUsed = GetIngressSharedUsed(); // Total bytes used from the ingress "shared" pool specifically.
+		uint64_t ingressSharedPool = ingressPool - totalIngressReserved;
+		return ingressSharedPool > ingressPoolSharedUsed ? ingressSharedPool - ingressPoolSharedUsed : 0;
+	}
+	uint32_t pool = profilePool[pr];
+	int64_t sharedPool = int64_t(ingressPools[pool]) - int64_t(ingressPoolReserved[pool]);
+	return sharedPool > ingressPoolSharedUsed[pool] ? sharedPool - ingressPoolSharedUsed[pool] : 0;
+}
+
+uint32_t SwitchMmu::GetType(uint32_t inPort, uint32_t qIndex, bool tagged) {
+	uint8_t pr = ingressProfile[inPort][qIndex];
+	if (pr == NO_PROFILE)
+		return tagged ? LOSSY : LOSSLESS;
+	return profileType[pr];
+}
+
 // DT's threshold = Alpha x remaining.
 // A sky high threshold for a queue can be emulated by setting the corresponding alpha to a large value. eg., UINT32_MAX
 uint64_t SwitchMmu::DynamicThreshold(uint32_t port, uint32_t qIndex, std::string inout, uint32_t type) {
 	if (inout == "ingress") {
 		double remaining = 0;
-		uint64_t ingressPoolSharedUsed = GetIngressSharedUsed(); // Total bytes used from the ingress "shared" pool specifically.
-		uint64_t ingressSharedPool = ingressPool - totalIngressReserved;
-		if (ingressSharedPool > ingressPoolSharedUsed) {
-			uint64_t remaining = ingressSharedPool - ingressPoolSharedUsed;
+		uint64_t sharedFree = GetIngressSharedFree(port, qIndex); // Free bytes in the shared part of the ingress pool of the queue.
+		if (sharedFree > 0) {
+			uint64_t remaining = sharedFree;
 			return std::min(uint64_t(alphaIngress[port][qIndex] * (remaining)), UINT64_MAX - 1024 * 1024);
 		}
 		else {
@@ -354,8 +621,9 @@ uint64_t SwitchMmu::DynamicThreshold(uint32_t port, uint32_t qIndex, std::string
 	}
 	else if (inout == "egress") {
 		double remaining = 0;
-		if (egressPool[type] > egressPoolUsed[type]) {
-			uint64_t remaining = egressPool[type] - egressPoolUsed[type];
+		uint32_t pool = GetEgressPool(port, qIndex, type);
+		if (egressPool[pool] > egressPoolUsed[pool]) {
+			uint64_t remaining = egressPool[pool] - egressPoolUsed[pool];
 			// UINT64_MAX - 1024*1024 is just a randomly chosen big value.
 			// Just don't want to return UINT64_MAX value, sometimes causes overflow issues later.
 			uint64_t threshold = std::min(uint64_t(alphaEgress[port][qIndex] * (remaining)), UINT64_MAX - 1024 * 1024);
@@ -454,15 +722,14 @@ uint64_t SwitchMmu::ActiveBufferManagement(uint32_t port, uint32_t qIndex, std::
 	}
 	if (inout == "ingress") {
 		double remaining = 0;
-		uint64_t ingressPoolSharedUsed = GetIngressSharedUsed(); // Total bytes used from the ingress "shared" pool specifically.
-		uint64_t ingressSharedPool = ingressPool - totalIngressReserved;
+		uint64_t sharedFree = GetIngressSharedFree(port, qIndex); // Free bytes in the shared part of the ingress pool of the queue.
 		double satLevel = double(ingress_bytes[port][qIndex]) / congestionIndicator;
 		if (satLevel > 1) {
 			satLevel = 1;
 		}
 		setCongested(port, qIndex, inout, satLevel);
-		if (ingressSharedPool > ingressPoolSharedUsed) {
-			uint64_t remaining = ingressSharedPool - ingressPoolSharedUsed;
+		if (sharedFree > 0) {
+			uint64_t remaining = sharedFree;
 			double alphaP = 1;
 			if (unsched) {
 				alphaP = alphaHigh;
@@ -488,8 +755,9 @@ uint64_t SwitchMmu::ActiveBufferManagement(uint32_t port, uint32_t qIndex, std::
 			satLevel = 1;
 		}
 		setCongested(port, qIndex, inout, satLevel);
-		if (egressPool[type] > egressPoolUsed[type]) {
-			uint64_t remaining = egressPool[type] - egressPoolUsed[type];
+		uint32_t pool = GetEgressPool(port, qIndex, type);
+		if (egressPool[pool] > egressPoolUsed[pool]) {
+			uint64_t remaining = egressPool[pool] - egressPoolUsed[pool];
 			// UINT64_MAX - 1024*1024 is just a randomly chosen big value.
 			// Just don't want to return UINT64_MAX value, sometimes causes overflow issues later.
 			double alphaP = 1;
@@ -511,10 +779,9 @@ uint64_t SwitchMmu::ActiveBufferManagement(uint32_t port, uint32_t qIndex, std::
 uint64_t SwitchMmu::FlowAwareBuffer(uint32_t port, uint32_t qIndex, std::string inout, uint32_t type, uint32_t unsched) {
 	if (inout == "ingress") {
 		double remaining = 0;
-		uint64_t ingressPoolSharedUsed = GetIngressSharedUsed(); // Total bytes used from the ingress "shared" pool specifically.
-		uint64_t ingressSharedPool = ingressPool - totalIngressReserved;
-		if (ingressSharedPool > ingressPoolSharedUsed) {
-			uint64_t remaining = ingressSharedPool - ingressPoolSharedUsed;
+		uint64_t sharedFree = GetIngressSharedFree(port, qIndex); // Free bytes in the shared part of the ingress pool of the queue.
+		if (sharedFree > 0) {
+			uint64_t remaining = sharedFree;
 			double alphaP = 1;
 			if (unsched) {
 				alphaP = alphaHigh;
@@ -533,8 +800,9 @@ uint64_t SwitchMmu::FlowAwareBuffer(uint32_t port, uint32_t qIndex, std::string
 	}
 	else if (inout == "egress") {
 		double remaining = 0;
-		if (egressPool[type] > egressPoolUsed[type]) {
-			uint64_t remaining = egressPool[type] - egressPoolUsed[type];
+		uint32_t pool = GetEgressPool(port, qIndex, type);
+		if (egressPool[pool] > egressPoolUsed[pool]) {
+			uint64_t remaining = egressPool[pool] - egressPoolUsed[pool];
 			// UINT64_MAX - 1024*1024 is just a randomly chosen big value.
 			// Just don't want to return UINT64_MAX value, sometimes causes overflow issues later.
 			double alphaP = 1;
@@ -770,6 +1038,7 @@ bool SwitchMmu::CheckEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t ps
 		}
 	}
 	else if (model == "sonic") {
+		uint32_t pool = GetEgressPool(port, qIndex, type);
 		switch (type) {
 		case LOSSY:
 			// if the egress queue length is greater than the threshold
@@ -778,7 +1047,7 @@ bool SwitchMmu::CheckEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t ps
 			        // && psize + egress_bytes[port][qIndex] > reserveEgress[port][qIndex]
 			     )
 			        // or if the egress pool is full
-			        || (psize + egressPoolUsed[type] > egressPool[type])
+			        || (psize + egressPoolUsed[pool] > egressPool[pool])
 			        // or if the switch buffer is full
 			        || (psize + totalUsed > bufferPool) )
 			{
@@ -795,7 +1064,7 @@ bool SwitchMmu::CheckEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t ps
 			        // && (psize + egress_bytes[port][qIndex] > reserveEgress[port][qIndex])
 			     )
 			        // or if the corresponding egress pool is used up
-			        || (psize + egressPoolUsed[type] > egressPool[type])
+			        || (psize + egressPoolUsed[pool] > egressPool[pool])
 			        // or if the switch buffer is full
 			        || (psize + totalUsed > bufferPool) )
 			{
@@ -822,6 +1091,7 @@ bool SwitchMmu::CheckEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t ps
 void SwitchMmu::UpdateIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize, uint32_t type, uint32_t unsched) {
 
 	std::string model = bufferModel;
+	int64_t shared = GetIngressSharedBytes(port, qIndex);
 
 	// if (Threshold(port, qIndex, "ingress", LOSSLESS, unsched) != ReverieThreshold(port, qIndex, LOSSLESS, unsched)){
 	// 	std::cout << "FUCK" << std::endl;
@@ -887,20 +1157,27 @@ void SwitchMmu::UpdateIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t
 		// uint64_t inst_ingress_shared_bytes = ingress_bytes[port][qIndex]-xoffUsed[port][qIndex];
 		// ingressLpf_bytes[port][qIndex] = Reveriegamma * ingressLpf_bytes [port][qIndex] + (1-Reveriegamma) * (inst_ingress_shared_bytes);
 	}
+	if (ingressProfile[port][qIndex] != NO_PROFILE)
+		ingressPoolSharedUsed[profilePool[ingressProfile[port][qIndex]]] += GetIngressSharedBytes(port, qIndex) - shared;
 }
 
 void SwitchMmu::UpdateEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize, uint32_t type) {
 	egress_bytes[port][qIndex] += psize;
-	egressPoolUsed[type] += psize;
+	egressPortBytes[port] += psize;
+	egressPoolUsed[GetEgressPool(port, qIndex, type)] += psize;
 	if (type == LOSSY) {
 		sharedPoolUsed += psize;
 		// egressLpf_bytes[port][qIndex] = Reveriegamma * egressLpf_bytes[port][qIndex] + (1-Reveriegamma) * (egress_bytes[port][qIndex]);
 	}
+	// Ingress admission is always updated first, so totalUsed and sharedPoolUsed are final here.
+	if (occStatsEnabled)
+		RecordOccupancy(port, qIndex);
 }
 
 void SwitchMmu::RemoveFromIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize, uint32_t type) {
 
 	txBytesIngress[port][qIndex] += psize; // We assume that the packet will not be dropped after this step for any other reason.
+	int64_t shared = GetIngressSharedBytes(port, qIndex);
 
 	// If else are simply unnecessary but its a safety check to avoid magic scenarios (if a packet vanishes in the buffer) where we
 	// might assign negative value to unsigned intergers.
@@ -956,6 +1233,8 @@ void SwitchMmu::RemoveFromIngressAdmission(uint32_t port, uint32_t qIndex, uint3
 		}
 		xoffTotalUsed += xoffUsed[port][qIndex]; // add the current used headroom to total headroom
 	}
+	if (ingressProfile[port][qIndex] != NO_PROFILE)
+		ingressPoolSharedUsed[profilePool[ingressProfile[port][qIndex]]] += GetIngressSharedBytes(port, qIndex) - shared;
 }
 
 // void SwitchMmu::UpdateLpfCounters(){
@@ -982,10 +1261,16 @@ void SwitchMmu::RemoveFromEgressAdmission(uint32_t port, uint32_t qIndex, uint32
 	else
 		egress_bytes[port][qIndex] = 0;
 
-	if (egressPoolUsed[type] >= psize)
-		egressPoolUsed[type] -= psize;
+	if (egressPortBytes[port] >= psize)
+		egressPortBytes[port] -= psize;
+	else
+		egressPortBytes[port] = 0;
+
+	uint32_t pool = GetEgressPool(port, qIndex, type);
+	if (egressPoolUsed[pool] >= psize)
+		egressPoolUsed[pool] -= psize;
 	else
-		egressPoolUsed[type] = 0;
+		egressPoolUsed[pool] = 0;
 
 	if (type == LOSSY) {
 		if (sharedPoolUsed >= psize)
@@ -998,6 +1283,81 @@ void SwitchMmu::RemoveFromEgressAdmission(uint32_t port, uint32_t qIndex, uint32
 			egressLpf_bytes[port][qIndex] = egress_bytes[port][qIndex];
 		}
 	}
+
+	if (occStatsEnabled)
+		RecordOccupancy(port, qIndex);
+}
+
+// Fluid bytes are accounted like admitted packets, except that they never use headroom and do not count as dequeued
+// traffic for ABM. The caller only removes what it added, so the counters cannot underflow.
+void SwitchMmu::AddFluidBytes(uint32_t inPort, uint32_t port, uint32_t qIndex, uint32_t type, int64_t delta) {
+	int64_t shared = GetIngressSharedBytes(inPort, qIndex);
+	totalIngressReservedUsed -= GetIngressReservedUsed(inPort, qIndex);
+	ingress_bytes[inPort][qIndex] += delta;
+	totalIngressReservedUsed += GetIngressReservedUsed(inPort, qIndex);
+	if (ingressProfile[inPort][qIndex] != NO_PROFILE)
+		ingressPoolSharedUsed[profilePool[ingressProfile[inPort][qIndex]]] += GetIngressSharedBytes(inPort, qIndex) - shared;
+	totalUsed += delta;
+	sharedPoolUsed += delta;
+
+	egress_bytes[port][qIndex] += delta;
+	egressPortBytes[port] += delta;
+	egressPoolUsed[GetEgressPool(port, qIndex, type)] += delta;
+
+	if (occStatsEnabled)
+		RecordOccupancy(port, qIndex);
+}
+
+void SwitchMmu::EnableOccupancyStats(const std::vector<uint64_t> &thresholds) {
+	// ports are device indices 1..portCount, index 0 is the loopback and stays empty
+	queueOcc.assign((portCount + 1) * qCnt, OccupancyHistogram());
+	portOcc.assign(portCount + 1, OccupancyHistogram());
+	for (auto &h : queueOcc)
+		h.SetThresholds(thresholds);
+	for (auto &h : portOcc)
+		h.SetThresholds(thresholds);
+	totalOcc.SetThresholds(thresholds);
+	sharedOcc.SetThresholds(thresholds);
+	occStatsEnabled = true;
+}
+
+void SwitchMmu::RecordOccupancy(uint32_t port, uint32_t qIndex) {
+	if (port > portCount)
+		return;
+	uint64_t now = Simulator::Now().GetTimeStep();
+	queueOcc[port * qCnt + qIndex].Update(egress_bytes[port][qIndex], now);
+	portOcc[port].Update(egressPortBytes[port], now);
+	totalOcc.Update(totalUsed, now);
+	sharedOcc.Update(sharedPoolUsed, now);
+}
+
+/*
+One line per histogram, only for queues/ports that ever held a byte:
+	occ <node> <kind> <port> <queue> <p50> <p99> <p999> <max> <ns above threshold 0> ... <observed ns>
+kind is "total" and "shared" (port and queue are -1), "port" (queue is -1) or "queue". Occupancies are in bytes.
+*/
+static void PrintOccupancyLine(std::ostream &os, uint32_t node, const char *kind, int port, int q, OccupancyHistogram &h, uint64_t now) {
+	h.Finish(now);
+	if (!h.IsActive())
+		return;
+	os << "occ " << node << " " << kind << " " << port << " " << q
+	   << " " << h.Percentile(0.5) << " " << h.Percentile(0.99) << " " << h.Percentile(0.999) << " " << h.GetMax();
+	for (uint32_t i = 0; i < h.GetNThresholds(); i++)
+		os << " " << h.GetTimeAbove(i);
+	os << " " << h.GetTotalTime() << "\n";
+}
+
+void SwitchMmu::PrintOccupancyStats(std::ostream &os) {
+	if (!occStatsEnabled)
+		return;
+	uint64_t now = Simulator::Now().GetTimeStep();
+	PrintOccupancyLine(os, node_id, "total", -1, -1, totalOcc, now);
+	PrintOccupancyLine(os, node_id, "shared", -1, -1, sharedOcc, now);
+	for (uint32_t port = 0; port <= portCount; port++) {
+		PrintOccupancyLine(os, node_id, "port", port, -1, portOcc[port], now);
+		for (uint32_t q = 0; q < qCnt; q++)
+			PrintOccupancyLine(os, node_id, "queue", port, q, queueOcc[port * qCnt + q], now);
+	}
 }
 
 
@@ -1032,22 +1392,22 @@ void SwitchMmu::SetResume(uint32_t port, uint32_t qIndex) {
 	paused[port][qIndex] = false;
 }
 
-bool SwitchMmu::ShouldSendCN(uint32_t ifindex, uint32_t qIndex) {
+// Called at dequeue, after the packet was removed from egress admission.
+bool SwitchMmu::ShouldSendCN(uint32_t ifindex, uint32_t qIndex, Ptr<Packet> p) {
 	if (qIndex == 0)
 		return false;
-	if (egress_bytes[ifindex][qIndex] > kmax[ifindex])
-		return true;
-	if (egress_bytes[ifindex][qIndex] > kmin[ifindex]) {
-		double p = pmax[ifindex] * double(egress_bytes[ifindex][qIndex] - kmin[ifindex]) / (kmax[ifindex] - kmin[ifindex]);
-		if (UniformVariable(0, 1).GetValue() < p)
-			return true;
-	}
-	return false;
+	return aqm->ShouldMarkDequeue(ifindex, qIndex, p, egress_bytes[ifindex][qIndex], bandwidth[ifindex]);
 }
+
+// Called at enqueue, after the packet was added to egress admission. Also keeps the AQM state that is updated on arrivals.
+bool SwitchMmu::ShouldSendCNOnEnqueue(uint32_t ifindex, uint32_t qIndex, Ptr<Packet> p) {
+	if (qIndex == 0)
+		return false;
+	return aqm->ShouldMarkEnqueue(ifindex, qIndex, p, egress_bytes[ifindex][qIndex], bandwidth[ifindex]);
+}
+
 void SwitchMmu::ConfigEcn(uint32_t port, uint32_t _kmin, uint32_t _kmax, double _pmax) {
-	kmin[port] = _kmin * 1000;
-	kmax[port] = _kmax * 1000;
-	pmax[port] = _pmax;
+	aqm->ConfigRed(port, uint64_t(_kmin) * 1000, uint64_t(_kmax) * 1000, _pmax);
 }
 
 }
@@ -2,20 +2,60 @@
 #define SWITCH_MMU_H
 
 #include <unordered_map>
+#include <vector>
+#include <ostream>
+#include <istream>
+#include <string>
 #include <ns3/node.h>
+#include <ns3/occupancy-histogram.h>
+#include "switch-aqm.h"
 
 namespace ns3 {
 
 class Packet;
 
+// SONiC-like buffer configuration: pools, profiles, the queues bound to the profiles and the priority
+// group to queue map. Parsed once and applied to every switch with SwitchMmu::ApplyBufferConfig.
+// See switch-mmu.cc for the file format.
+struct SwitchBufferConfig {
+	struct Pool {
+		std::string name;
+		bool ingress;
+		bool lossless;
+		uint64_t size;
+	};
+	struct Profile {
+		std::string name;
+		uint32_t pool;
+		double alpha; // 2^dynamic_th
+		int64_t size, xoff, xon, xonOffset; // -1 keeps the value of the queue
+	};
+	struct Binding {
+		bool ingress; // pg, or egress queue
+		uint32_t portMin, portMax; // portMax 0xffffffff for all ports
+		uint32_t qMin, qMax;
+		uint32_t profile;
+	};
+	std::vector<Pool> pools;
+	std::vector<Profile> profiles;
+	std::vector<Binding> bindings;
+	std::vector<uint32_t> pgToQueue; // empty for the identity
+
+	void Load(std::istream &is); // exits on a malformed line, like the other configuration errors of the mmu
+	void Load(std::string file);
+};
+
 class SwitchMmu: public Object {
 public:
 	static const uint32_t pCnt = 257;	// Number of ports used
 	static const uint32_t qCnt = 8;	// Number of queues/priorities used
+	static const uint32_t poolCnt = 8;	// Max pools per direction
+	static const uint8_t NO_PROFILE = 0xff;
 
 	static TypeId GetTypeId (void);
 
 	SwitchMmu(void);
+	~SwitchMmu();
 
 	bool CheckIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize, uint32_t type, uint32_t unsched);
 	bool CheckEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize, uint32_t type, uint32_t unsched);
@@ -23,13 +63,16 @@ public:
 	void UpdateEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize, uint32_t type);
 	void RemoveFromIngressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize, uint32_t type);
 	void RemoveFromEgressAdmission(uint32_t port, uint32_t qIndex, uint32_t psize, uint32_t type);
+	// Bytes held by fluid background traffic (FluidBackground) from inPort to port. delta may be negative.
+	void AddFluidBytes(uint32_t inPort, uint32_t port, uint32_t qIndex, uint32_t type, int64_t delta);
 
 	bool CheckShouldPause(uint32_t port, uint32_t qIndex);
 	bool CheckShouldResume(uint32_t port, uint32_t qIndex);
 	void SetPause(uint32_t port, uint32_t qIndex);
 	void SetResume(uint32_t port, uint32_t qIndex);
 
-	bool ShouldSendCN(uint32_t ifindex, uint32_t qIndex);
+	bool ShouldSendCN(uint32_t ifindex, uint32_t qIndex, Ptr<Packet> p);
+	bool ShouldSendCNOnEnqueue(uint32_t ifindex, uint32_t qIndex, Ptr<Packet> p);
 
 	void ConfigEcn(uint32_t port, uint32_t _kmin, uint32_t _kmax, double _pmax);
 
@@ -75,6 +118,14 @@ public:
 
 	void SetGamma(double value);
 
+	// Buffer profiles of the sonic model. Apply after the per queue setters and SetPortCount, before traffic starts;
+	// the reserved, headroom, xon and alpha of the bound queues are overwritten.
+	void ApplyBufferConfig(const SwitchBufferConfig &cfg);
+	// the egress queue of the packets of priority group pg
+	uint32_t GetQueue(uint32_t pg) { return pg < qCnt ? pgToQueue[pg] : pg; }
+	// LOSSLESS or LOSSY: from the pool of the ingress profile of (inPort, qIndex), else lossy iff the packet has MyPriorityTag
+	uint32_t GetType(uint32_t inPort, uint32_t qIndex, bool tagged);
+
 	uint64_t Threshold(uint32_t port, uint32_t qIndex, std::string inout, uint32_t type, uint32_t alphaPrio);
 
 	uint64_t DynamicThreshold(uint32_t port, uint32_t qIndex, std::string inout, uint32_t type);
@@ -87,6 +138,13 @@ public:
 
 	uint64_t GetIngressSharedUsed();
 
+	uint64_t GetIngressSharedFree(uint32_t port, uint32_t qIndex); // in the shared part of the ingress pool of the queue
+
+	uint32_t GetEgressPool(uint32_t port, uint32_t qIndex, uint32_t type) {
+		uint8_t pr = egressProfile[port][qIndex];
+		return pr == NO_PROFILE ? type : profilePool[pr];
+	}
+
 	void setCongested(uint32_t portId, uint32_t qIndex, std::string inout, double satLevel);
 
 	double GetNofP(std::string inout, uint32_t qIndex);
@@ -109,11 +167,16 @@ public:
 
 	void UpdateLpfCounters();
 
+	// Occupancy histograms are off by default. Enable after SetPortCount and before traffic starts.
+	void EnableOccupancyStats(const std::vector<uint64_t> &thresholds);
+	void PrintOccupancyStats(std::ostream &os);
+
 
 	// config
 	uint32_t node_id;
-	uint32_t kmin[pCnt], kmax[pCnt];
-	double pmax[pCnt];
+
+	// ECN marking. ConfigEcn sets the RED thresholds, other algorithms are configured on aqm directly.
+	Ptr<SwitchAqm> aqm;
 
 	// Buffer model
 	std::string bufferModel;
@@ -121,7 +184,7 @@ public:
 	// Buffer pools
 	uint64_t bufferPool;
 	uint64_t ingressPool ;
-	uint64_t egressPool[2];
+	uint64_t egressPool[poolCnt]; // LOSSLESS and LOSSY, then the egress pools of the buffer profiles
 	uint64_t egressPoolAll;
 	uint64_t sharedPool;
 	uint64_t xoffTotal;
@@ -129,7 +192,7 @@ public:
 
 	// aggregate run time
 	uint64_t totalUsed;
-	uint64_t egressPoolUsed[2];
+	uint64_t egressPoolUsed[poolCnt];
 	uint64_t xoffTotalUsed;
 	uint64_t totalIngressReservedUsed;
 	uint64_t sharedPoolUsed;
@@ -153,6 +216,17 @@ public:
 	uint64_t ingressLpf_bytes[pCnt][qCnt];
 	uint64_t egressLpf_bytes[pCnt][qCnt];
 
+	// Buffer profiles. A queue without a profile uses ingressPool and egressPool[type].
+	uint32_t pgToQueue[qCnt];
+	uint8_t ingressProfile[pCnt][qCnt]; // index into profilePool/profileType, or NO_PROFILE
+	uint8_t egressProfile[pCnt][qCnt];
+	std::vector<uint8_t> profilePool; // ingress profiles: index into ingressPools, egress profiles: into egressPool
+	std::vector<uint8_t> profileType;
+	uint32_t nIngressPools, nEgressPools;
+	uint64_t ingressPools[poolCnt];
+	uint64_t ingressPoolReserved[poolCnt]; // reserveIngress of the queues of the pool
+	int64_t ingressPoolSharedUsed[poolCnt]; // bytes beyond reserved and headroom of the queues of the pool
+
 	// Buffer Sharing algorithm
 	uint32_t ingressAlg[2];
 	uint32_t egressAlg[2];
@@ -176,6 +250,18 @@ public:
 	double Reveriegamma;
 	uint32_t lpfUpdatedOnce;
 
+	// Occupancy statistics, updated on every egress admission/removal
+	uint64_t egressPortBytes[pCnt];
+	bool occStatsEnabled;
+	std::vector<OccupancyHistogram> queueOcc; // (portCount + 1) * qCnt, egress_bytes
+	std::vector<OccupancyHistogram> portOcc; // portCount + 1, egressPortBytes
+	OccupancyHistogram totalOcc; // totalUsed
+	OccupancyHistogram sharedOcc; // sharedPoolUsed
+
+private:
+	void RecordOccupancy(uint32_t port, uint32_t qIndex);
+	int64_t GetIngressSharedBytes(uint32_t port, uint32_t qIndex);
+
 };
 
 } /* namespace ns3 */
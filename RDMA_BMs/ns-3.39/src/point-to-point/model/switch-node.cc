@@ -6,6 +6,8 @@
 #include "ns3/boolean.h"
 #include "ns3/uinteger.h"
 #include "ns3/double.h"
+#include "ns3/pointer.h"
+#include "ns3/memory-stats.h"
 #include "switch-node.h"
 #include "qbb-net-device.h"
 #include "ppp-header.h"
@@ -50,12 +52,19 @@ TypeId SwitchNode::GetTypeId (void)
 	                                  BooleanValue(false),
 	                                  MakeBooleanAccessor(&SwitchNode::PowerEnabled),
 	                                  MakeBooleanChecker())
+	                    .AddAttribute("Mmu",
+	                                  "The switch MMU, to reach its attributes through the config paths.",
+	                                  TypeId::ATTR_GET, // not reset at construction
+	                                  PointerValue(),
+	                                  MakePointerAccessor(&SwitchNode::m_mmu),
+	                                  MakePointerChecker<SwitchMmu>())
 
 	                    ;
 	return tid;
 }
 
 SwitchNode::SwitchNode() {
+	NS_MEMORY_STATS_RESIZE(NODE, sizeof(SwitchNode) - sizeof(Node));
 	m_ecmpSeed = m_id;
 	m_node_type = 1;
 	m_mmu = CreateObject<SwitchMmu>();
@@ -67,8 +76,18 @@ SwitchNode::SwitchNode() {
 		m_txBytes[i] = 0;
 	for (uint32_t i = 0; i < pCnt; i++)
 		m_lastPktSize[i] = m_lastPktTs[i] = 0;
-	for (uint32_t i = 0; i < pCnt; i++)
+	for (uint32_t i = 0; i < pCnt; i++) {
 		m_u[i] = 0;
+		m_pintB[i] = 0;
+		m_pintLogB[i] = 0;
+	}
+	m_pintT = 0;
+	m_pintLogT = 0;
+	m_pintRngState = 0;
+}
+
+SwitchNode::~SwitchNode() {
+	NS_MEMORY_STATS_RESIZE(NODE, -int64_t(sizeof(SwitchNode) - sizeof(Node)));
 }
 
 int SwitchNode::GetOutDev(Ptr<const Packet> p, CustomHeader &ch) {
@@ -147,11 +166,11 @@ void SwitchNode::SendToDev(Ptr<Packet>p, CustomHeader &ch) {
 			qIndex = 0;
 		}
 		else if (found) {
-			qIndex = priotag.GetPriority();
+			qIndex = m_mmu->GetQueue(priotag.GetPriority());
 			// std::cout << "using queue " << qIndex << std::endl;
 		}
 		else {
-			qIndex = (ch.l3Prot == 0x06 ? 1 : ch.udp.pg); // For TCP/IP if the stack did not attach MyPriorityTag, put to queue 1.
+			qIndex = m_mmu->GetQueue(ch.l3Prot == 0x06 ? 1 : ch.udp.pg); // For TCP/IP if the stack did not attach MyPriorityTag, put to queue 1.
 		}
 
 		// admission control
@@ -160,13 +179,17 @@ void SwitchNode::SendToDev(Ptr<Packet>p, CustomHeader &ch) {
 		uint32_t inDev = t.GetPortId();
 		if (qIndex != 0) { //not highest priority
 			// IMPORTANT: MyPriorityTag should only be attached by lossy traffic. This tag indicates the qIndex but also indicates that it is "lossy". Never attach MyPriorityTag on lossless traffic.
-			if (m_mmu->CheckIngressAdmission(inDev, qIndex, p->GetSize(), found,unsched) && m_mmu->CheckEgressAdmission(idx, qIndex, p->GetSize(), found,unsched)) {			// Admission control
-				m_mmu->UpdateIngressAdmission(inDev, qIndex, p->GetSize(), found, unsched);
-				m_mmu->UpdateEgressAdmission(idx, qIndex, p->GetSize(), found);
+			// Unless the priority group has a buffer profile, whose pool says if it is lossless.
+			uint32_t type = m_mmu->GetType(inDev, qIndex, found);
+			if (m_mmu->CheckIngressAdmission(inDev, qIndex, p->GetSize(), type, unsched) && m_mmu->CheckEgressAdmission(idx, qIndex, p->GetSize(), type, unsched)) {			// Admission control
+				m_mmu->UpdateIngressAdmission(inDev, qIndex, p->GetSize(), type, unsched);
+				m_mmu->UpdateEgressAdmission(idx, qIndex, p->GetSize(), type);
 			} else {
 				return; // Drop
 			}
 			CheckAndSendPfc(inDev, qIndex);
+			if (m_ecnEnabled && m_mmu->ShouldSendCNOnEnqueue(idx, qIndex, p))
+				MarkCe(p);
 		}
 		m_bytes[inDev][idx][qIndex] += p->GetSize();
 		m_devices[idx]->SwitchSend(qIndex, p, ch);
@@ -176,6 +199,16 @@ void SwitchNode::SendToDev(Ptr<Packet>p, CustomHeader &ch) {
 	return; // Drop
 }
 
+void SwitchNode::MarkCe(Ptr<Packet> p) {
+	PppHeader ppp;
+	Ipv4Header h;
+	p->RemoveHeader(ppp);
+	p->RemoveHeader(h);
+	h.SetEcn((Ipv4Header::EcnType)0x03);
+	p->AddHeader(h);
+	p->AddHeader(ppp);
+}
+
 uint32_t SwitchNode::EcmpHash(const uint8_t* key, size_t len, uint32_t seed) {
 	uint32_t h = seed;
 	if (len > 3) {
@@ -227,6 +260,11 @@ void SwitchNode::ClearTable() {
 	m_rtTable.clear();
 }
 
+std::vector<int> SwitchNode::GetTableEntry(Ipv4Address dstAddr) const {
+	auto entry = m_rtTable.find(dstAddr.Get());
+	return entry == m_rtTable.end() ? std::vector<int>() : entry->second;
+}
+
 // This function can only be called in switch mode
 bool SwitchNode::SwitchReceiveFromDevice(Ptr<NetDevice> device, Ptr<Packet> packet, CustomHeader &ch) {
 	SendToDev(packet, ch);
@@ -242,20 +280,14 @@ void SwitchNode::SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Pack
 
 	if (qIndex != 0) {
 		uint32_t inDev = t.GetPortId();
-		m_mmu->RemoveFromIngressAdmission(inDev, qIndex, p->GetSize(), found);
-		m_mmu->RemoveFromEgressAdmission(ifIndex, qIndex, p->GetSize(), found);
+		uint32_t type = m_mmu->GetType(inDev, qIndex, found);
+		m_mmu->RemoveFromIngressAdmission(inDev, qIndex, p->GetSize(), type);
+		m_mmu->RemoveFromEgressAdmission(ifIndex, qIndex, p->GetSize(), type);
 		m_bytes[inDev][ifIndex][qIndex] -= p->GetSize();
 		if (m_ecnEnabled) {
-			bool egressCongested = m_mmu->ShouldSendCN(ifIndex, qIndex);
-			if (egressCongested) {
-				PppHeader ppp;
-				Ipv4Header h;
-				p->RemoveHeader(ppp);
-				p->RemoveHeader(h);
-				h.SetEcn((Ipv4Header::EcnType)0x03);
-				p->AddHeader(h);
-				p->AddHeader(ppp);
-			}
+			bool egressCongested = m_mmu->ShouldSendCN(ifIndex, qIndex, p);
+			if (egressCongested)
+				MarkCe(p);
 		}
 		//CheckAndSendPfc(inDev, qIndex);
 		CheckAndSendResume(inDev, qIndex);
@@ -278,69 +310,27 @@ void SwitchNode::SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Pack
 					dt = m_maxRtt;
 				uint64_t B = dev->GetDataRate().GetBitRate() / 8; //Bps
 				uint64_t qlen = dev->GetQueue()->GetNBytesTotal();
-				double newU;
 
-				/**************************
-				 * approximate calc
-				 *************************/
-				int b = 20, m = 16, l = 20; // see log2apprx's paremeters
-				int sft = logres_shift(b, l);
-				double fct = 1 << sft; // (multiplication factor corresponding to sft)
-				double log_T = log2(m_maxRtt) * fct; // log2(T)*fct
-				double log_B = log2(B) * fct; // log2(B)*fct
-				double log_1e9 = log2(1e9) * fct; // log2(1e9)*fct
-				double qterm = 0;
-				double byteTerm = 0;
-				double uTerm = 0;
-				if ((qlen >> 8) > 0) {
-					int log_dt = log2apprx(dt, b, m, l); // ~log2(dt)*fct
-					int log_qlen = log2apprx(qlen >> 8, b, m, l); // ~log2(qlen / 256)*fct
-					qterm = pow(2, (
-					                log_dt + log_qlen + log_1e9 - log_B - 2 * log_T
-					            ) / fct
-					           ) * 256;
-					// 2^((log2(dt)*fct+log2(qlen/256)*fct+log2(1e9)*fct-log2(B)*fct-2*log2(T)*fct)/fct)*256 ~= dt*qlen*1e9/(B*T^2)
-				}
-				if (m_lastPktSize[ifIndex] > 0) {
-					int byte = m_lastPktSize[ifIndex];
-					int log_byte = log2apprx(byte, b, m, l);
-					byteTerm = pow(2, (
-					                   log_byte + log_1e9 - log_B - log_T
-					               ) / fct
-					              );
-					// 2^((log2(byte)*fct+log2(1e9)*fct-log2(B)*fct-log2(T)*fct)/fct) ~= byte*1e9 / (B*T)
+				// the log of the port rate and of the max RTT only change with the configuration
+				if (B != m_pintB[ifIndex]) {
+					m_pintB[ifIndex] = B;
+					m_pintLogB[ifIndex] = PintMath::log2(B);
 				}
-				if (m_maxRtt > dt && m_u[ifIndex] > 0) {
-					int log_T_dt = log2apprx(m_maxRtt - dt, b, m, l); // ~log2(T-dt)*fct
-					int log_u = log2apprx(int(round(m_u[ifIndex] * 8192)), b, m, l); // ~log2(u*512)*fct
-					uTerm = pow(2, (
-					                log_T_dt + log_u - log_T
-					            ) / fct
-					           ) / 8192;
-					// 2^((log2(T-dt)*fct+log2(u*512)*fct-log2(T)*fct)/fct)/512 = (T-dt)*u/T
+				if (m_maxRtt != m_pintT) {
+					m_pintT = m_maxRtt;
+					m_pintLogT = PintMath::log2(m_maxRtt);
 				}
-				newU = qterm + byteTerm + uTerm;
 
-#if 0
 				/**************************
-				 * accurate calc
+				 * approximate calc, fixed point (see Pint::update_u_float for the former floating point version)
 				 *************************/
-				double weight_ewma = double(dt) / m_maxRtt;
-				double u;
-				if (m_lastPktSize[ifIndex] == 0)
-					u = 0;
-				else {
-					double txRate = m_lastPktSize[ifIndex] / double(dt); // B/ns
-					u = (qlen / m_maxRtt + txRate) * 1e9 / B;
-				}
-				newU = m_u[ifIndex] * (1 - weight_ewma) + u * weight_ewma;
-				printf(" %lf\n", newU);
-#endif
+				uint32_t newU = Pint::update_u(dt, qlen, m_lastPktSize[ifIndex], m_u[ifIndex], m_maxRtt, m_pintLogB[ifIndex], m_pintLogT);
 
 				/************************
 				 * update PINT header
 				 ***********************/
-				uint16_t power = Pint::encode_u(newU);
+				uint32_t u_toInt = (uint64_t(newU) * Pint::max_concurrent + (1 << Pint::u_shift) - 1) >> Pint::u_shift; // ceil(u * max_concurrent)
+				uint16_t power = Pint::encode_u(u_toInt, PintRand());
 				if (power > ih->GetPower())
 					ih->SetPower(power);
 
@@ -368,25 +358,27 @@ void SwitchNode::SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Pack
 	m_lastPktTs[ifIndex] = Simulator::Now().GetTimeStep();
 }
 
-int SwitchNode::logres_shift(int b, int l) {
-	static int data[] = {0, 0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5};
-	return l - data[b];
+// xorshift64* seeded from the switch's random stream, so that PINT runs are reproducible for a given seed and run
+uint32_t SwitchNode::PintRand() {
+	if (m_pintRngState == 0) {
+		if (m_pintRng == NULL)
+			m_pintRng = CreateObject<UniformRandomVariable>();
+		m_pintRngState = (uint64_t(m_pintRng->GetInteger(1, UINT32_MAX)) << 32) | m_pintRng->GetInteger(0, UINT32_MAX);
+	}
+	uint64_t x = m_pintRngState;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	m_pintRngState = x;
+	return (x * 0x2545F4914F6CDD1DULL) >> 48;
 }
 
-int SwitchNode::log2apprx(int x, int b, int m, int l) {
-	int x0 = x;
-	int msb = int(log2(x)) + 1;
-	if (msb > m) {
-		x = (x >> (msb - m) << (msb - m));
-#if 0
-		x += + (1 << (msb - m - 1));
-#else
-		int mask = (1 << (msb - m)) - 1;
-		if ((x0 & mask) > (rand() & mask))
-			x += 1 << (msb - m);
-#endif
-	}
-	return int(log2(x) * (1 << logres_shift(b, l)));
+int64_t SwitchNode::AssignStreams(int64_t stream) {
+	if (m_pintRng == NULL)
+		m_pintRng = CreateObject<UniformRandomVariable>();
+	m_pintRng->SetStream(stream);
+	m_pintRngState = 0;
+	return 1 + m_mmu->aqm->AssignStreams(stream + 1);
 }
 
 } /* namespace ns3 */
@@ -3,6 +3,7 @@
 
 #include <unordered_map>
 #include <ns3/node.h>
+#include <ns3/random-variable-stream.h>
 #include "qbb-net-device.h"
 #include "switch-mmu.h"
 #include "pint.h"
@@ -25,7 +26,15 @@ class SwitchNode : public Node{
 
 	uint32_t m_lastPktSize[pCnt];
 	uint64_t m_lastPktTs[pCnt]; // ns
-	double m_u[pCnt];
+	uint32_t m_u[pCnt]; // PINT utilization estimate in units of 1/2^Pint::u_shift
+
+	// PINT per port constants and dithering
+	uint64_t m_pintB[pCnt];
+	int32_t m_pintLogB[pCnt];
+	uint64_t m_pintT;
+	int32_t m_pintLogT;
+	Ptr<UniformRandomVariable> m_pintRng; // created on first use, so that other runs draw the same streams as before
+	uint64_t m_pintRngState;
 
 protected:
 	bool m_ecnEnabled;
@@ -43,20 +52,24 @@ private:
 	static uint32_t EcmpHash(const uint8_t* key, size_t len, uint32_t seed);
 	void CheckAndSendPfc(uint32_t inDev, uint32_t qIndex);
 	void CheckAndSendResume(uint32_t inDev, uint32_t qIndex);
+	void MarkCe(Ptr<Packet> p);
+	uint32_t PintRand(void);
 public:
 	Ptr<SwitchMmu> m_mmu;
 
 	static TypeId GetTypeId (void);
 	SwitchNode();
+	~SwitchNode();
 	void SetEcmpSeed(uint32_t seed);
 	void AddTableEntry(Ipv4Address &dstAddr, uint32_t intf_idx);
 	void ClearTable();
+	// the ECMP ports (index of dev) towards dstAddr, empty if there is no route
+	std::vector<int> GetTableEntry(Ipv4Address dstAddr) const;
 	bool SwitchReceiveFromDevice(Ptr<NetDevice> device, Ptr<Packet> packet, CustomHeader &ch);
 	void SwitchNotifyDequeue(uint32_t ifIndex, uint32_t qIndex, Ptr<Packet> p);
 
-	// for approximate calc in PINT
-	int logres_shift(int b, int l);
-	int log2apprx(int x, int b, int m, int l); // given x of at most b bits, use most significant m bits of x, calc the result in l bits
+	// streams for the PINT dithering and the probabilistic ECN marking of the AQM
+	int64_t AssignStreams(int64_t stream);
 };
 
 } /* namespace ns3 */
@@ -0,0 +1,312 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/dc-topology-helper.h"
+#include "ns3/rdma-driver.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/simulator.h"
+#include "ns3/switch-node.h"
+#include "ns3/test.h"
+
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+namespace
+{
+
+/// Shortest paths to one host, found by a BFS from it that does not cross other hosts
+struct ReferencePaths
+{
+    std::vector<uint32_t> dist;    //!< hops to the host, UINT32_MAX if unreachable
+    std::vector<uint64_t> delay;   //!< along the first path found
+    std::vector<uint64_t> txDelay; //!< along the first path found
+    std::vector<uint64_t> bw;      //!< bottleneck of the first path found
+};
+
+ReferencePaths
+FindPaths(const DcTopologyHelper& topo, uint32_t dst, uint32_t mtu)
+{
+    uint32_t n = topo.GetN();
+    ReferencePaths r;
+    r.dist.assign(n, std::numeric_limits<uint32_t>::max());
+    r.delay.assign(n, 0);
+    r.txDelay.assign(n, 0);
+    r.bw.assign(n, 0);
+    r.dist[dst] = 0;
+    r.bw[dst] = std::numeric_limits<uint64_t>::max();
+    std::vector<uint32_t> q = {dst};
+    for (uint32_t i = 0; i < q.size(); i++)
+    {
+        uint32_t now = q[i];
+        for (const DcTopologyHelper::Port& port : topo.GetPorts(now))
+        {
+            uint32_t next = port.peer;
+            if (r.dist[next] != std::numeric_limits<uint32_t>::max())
+            {
+                continue;
+            }
+            const DcTopologyHelper::Link& link = topo.GetLinks()[port.link];
+            r.dist[next] = r.dist[now] + 1;
+            r.delay[next] = r.delay[now] + link.delay.GetNanoSeconds();
+            r.txDelay[next] = r.txDelay[now] + mtu * 8000000000ULL / link.rate.GetBitRate();
+            r.bw[next] = std::min(r.bw[now], link.rate.GetBitRate());
+            if (topo.GetTier(next) != DcTopologyHelper::HOST)
+            {
+                q.push_back(next);
+            }
+        }
+    }
+    return r;
+}
+
+/// Installs an RdmaHw on every host, as the examples do before PopulateRoutes
+void
+InstallRdma(const DcTopologyHelper& topo)
+{
+    NodeContainer hosts = topo.GetNodes(DcTopologyHelper::HOST);
+    for (uint32_t i = 0; i < hosts.GetN(); i++)
+    {
+        Ptr<RdmaDriver> rdma = CreateObject<RdmaDriver>();
+        rdma->SetNode(hosts.Get(i));
+        rdma->SetRdmaHw(CreateObject<RdmaHw>());
+        hosts.Get(i)->AggregateObject(rdma);
+        rdma->Init();
+    }
+}
+
+} // namespace
+
+/**
+ * \brief Builds a topology and checks, for every node and destination host, the next hops
+ * and the SwitchNode or RdmaHw table entries against a BFS over the built links, and for
+ * every host pair the delay, tx delay and bottleneck rate along the first shortest path.
+ */
+class DcTopologyRoutesTestCase : public TestCase
+{
+  public:
+    DcTopologyRoutesTestCase(std::string name = "next hops, tables and pair metrics against a BFS");
+
+  protected:
+    void CheckRoutes(const DcTopologyHelper& topo, uint32_t mtu);
+
+  private:
+    void DoRun() override;
+};
+
+DcTopologyRoutesTestCase::DcTopologyRoutesTestCase(std::string name)
+    : TestCase(name)
+{
+}
+
+void
+DcTopologyRoutesTestCase::CheckRoutes(const DcTopologyHelper& topo, uint32_t mtu)
+{
+    uint32_t n = topo.GetN();
+    for (uint32_t dst = 0; dst < n; dst++)
+    {
+        if (topo.GetTier(dst) != DcTopologyHelper::HOST)
+        {
+            continue;
+        }
+        ReferencePaths r = FindPaths(topo, dst, mtu);
+        Ipv4Address addr = DcTopologyHelper::GetHostAddress(dst);
+        for (uint32_t node = 0; node < n; node++)
+        {
+            const std::vector<DcTopologyHelper::Port>& ports = topo.GetPorts(node);
+            std::vector<uint32_t> expected;
+            std::vector<int> ifIndices;
+            for (uint32_t p = 0; node != dst && p < ports.size(); p++)
+            {
+                uint32_t peer = ports[p].peer;
+                if ((peer == dst || topo.GetTier(peer) != DcTopologyHelper::HOST) &&
+                    r.dist[peer] + 1 == r.dist[node])
+                {
+                    expected.push_back(p);
+                    ifIndices.push_back(ports[p].dev->GetIfIndex());
+                }
+            }
+            NS_TEST_ASSERT_MSG_EQ((topo.GetNextHops(node, dst) == expected),
+                                  true,
+                                  "next hops of " << node << " to " << dst);
+            std::vector<int> table;
+            if (topo.GetTier(node) != DcTopologyHelper::HOST)
+            {
+                table = DynamicCast<SwitchNode>(topo.GetNodes().Get(node))->GetTableEntry(addr);
+            }
+            else
+            {
+                Ptr<RdmaHw> rdma = topo.GetNodes().Get(node)->GetObject<RdmaDriver>()->m_rdma;
+                auto entry = rdma->m_rtTable.find(addr.Get());
+                if (entry != rdma->m_rtTable.end())
+                {
+                    table = entry->second;
+                }
+            }
+            NS_TEST_ASSERT_MSG_EQ((table == ifIndices),
+                                  true,
+                                  "table of " << node << " to " << dst);
+            if (topo.GetTier(node) != DcTopologyHelper::HOST)
+            {
+                continue;
+            }
+            bool reachable = r.dist[node] != std::numeric_limits<uint32_t>::max();
+            NS_TEST_ASSERT_MSG_EQ(topo.GetPairDelay(node, dst),
+                                  r.delay[node],
+                                  "delay from " << node << " to " << dst);
+            NS_TEST_ASSERT_MSG_EQ(topo.GetPairTxDelay(node, dst),
+                                  r.txDelay[node],
+                                  "tx delay from " << node << " to " << dst);
+            NS_TEST_ASSERT_MSG_EQ(topo.GetPairBw(node, dst),
+                                  reachable ? r.bw[node] : 0,
+                                  "rate from " << node << " to " << dst);
+        }
+    }
+}
+
+void
+DcTopologyRoutesTestCase::DoRun()
+{
+    const uint32_t mtu = 1000;
+    QbbHelper qbb;
+    {
+        // 2 hosts under each of 4 leaves, 2 parallel links from every leaf to each of 3 spines
+        DcTopologyHelper topo;
+        topo.SetShape("leafspine:2,4,3,2");
+        topo.SetTierLink(DcTopologyHelper::LEAF, DataRate("40Gbps"), MicroSeconds(2));
+        topo.Build(qbb);
+        InstallRdma(topo);
+        topo.PopulateRoutes(mtu);
+        NS_TEST_EXPECT_MSG_EQ(topo.GetLinks().size(), 8 + 4 * 3 * 2, "links");
+        NS_TEST_EXPECT_MSG_EQ(topo.GetNextHops(8, 7).size(), 6, "leaf to leaf over 6 links");
+        CheckRoutes(topo, mtu);
+    }
+    Simulator::Destroy();
+    {
+        // host 0 on both leaves, hosts 1 and 2 on one each; leaf 4 reaches host 1 over leaf 3
+        // or over host 0, which does not forward
+        std::istringstream file("5 2 2 5 100000000000 100000000000\n"
+                                "3 4\n"
+                                "0 3 100Gbps 1us 0\n"
+                                "0 4 100Gbps 1us 0\n"
+                                "1 3 25Gbps 1us 0\n"
+                                "2 4 100Gbps 3us 0\n"
+                                "3 4 40Gbps 2us 0\n");
+        DcTopologyHelper topo;
+        topo.LoadFile(file);
+        topo.Build(qbb);
+        InstallRdma(topo);
+        topo.PopulateRoutes(mtu);
+        NS_TEST_EXPECT_MSG_EQ(topo.GetPairDelay(2, 1), 6000, "host 2 to host 1");
+        NS_TEST_EXPECT_MSG_EQ(topo.GetPairBw(2, 1), 25000000000ULL, "host 2 to host 1");
+        NS_TEST_EXPECT_MSG_EQ(topo.GetNextHops(0, 2).size(), 1, "host 0 to host 2");
+        CheckRoutes(topo, mtu);
+    }
+    Simulator::Destroy();
+}
+
+/**
+ * \brief A k=4 fat-tree with a different rate and delay per tier: the next hops and the
+ * pair metrics of hosts under the same leaf, in the same pod and in different pods, by
+ * hand, then all of them against a BFS.
+ */
+class DcTopologyFatTreeTestCase : public DcTopologyRoutesTestCase
+{
+  public:
+    DcTopologyFatTreeTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+DcTopologyFatTreeTestCase::DcTopologyFatTreeTestCase()
+    : DcTopologyRoutesTestCase("k=4 fat-tree next hops and pair delays")
+{
+}
+
+void
+DcTopologyFatTreeTestCase::DoRun()
+{
+    const uint32_t mtu = 1000;
+    DcTopologyHelper topo;
+    topo.SetFatTree(4);
+    topo.SetTierLink(DcTopologyHelper::HOST, DataRate("100Gbps"), MicroSeconds(1));
+    topo.SetTierLink(DcTopologyHelper::LEAF, DataRate("40Gbps"), MicroSeconds(2));
+    topo.SetTierLink(DcTopologyHelper::SPINE, DataRate("10Gbps"), MicroSeconds(3));
+    QbbHelper qbb;
+    topo.Build(qbb);
+    InstallRdma(topo);
+    topo.PopulateRoutes(mtu);
+
+    // hosts 0-15, two per leaf; leaves 16-23, two per pod; spines 24-31; cores 32-35
+    NS_TEST_EXPECT_MSG_EQ(topo.GetN(DcTopologyHelper::HOST), 16, "hosts");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetN(DcTopologyHelper::LEAF), 8, "leaves");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetN(DcTopologyHelper::SPINE), 8, "spines");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetN(DcTopologyHelper::CORE), 4, "cores");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetLinks().size(), 48, "links");
+
+    // leaf 16 reaches host 1 directly, host 2 and host 15 over both spines of its pod
+    NS_TEST_EXPECT_MSG_EQ(topo.GetNextHops(16, 1).size(), 1, "leaf to a host of its own");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetPorts(16)[topo.GetNextHops(16, 1)[0]].peer, 1, "to host 1");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetNextHops(16, 2).size(), 2, "leaf up to both spines");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetNextHops(16, 15).size(), 2, "leaf up to both spines");
+    // spine 24 goes down to leaf 17 for host 2, up to both of its cores for host 15
+    NS_TEST_EXPECT_MSG_EQ(topo.GetNextHops(24, 2).size(), 1, "spine down to a leaf");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetPorts(24)[topo.GetNextHops(24, 2)[0]].peer, 17, "leaf 17");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetNextHops(24, 15).size(), 2, "spine up to both cores");
+    // core 32 down to spine 30 of pod 3, which goes down to leaf 23
+    NS_TEST_EXPECT_MSG_EQ(topo.GetNextHops(32, 15).size(), 1, "core down to a pod");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetPorts(32)[topo.GetNextHops(32, 15)[0]].peer, 30, "spine 30");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetNextHops(30, 15).size(), 1, "spine down to a leaf");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetNextHops(0, 15).size(), 1, "host up to its leaf");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetNextHops(15, 15).size(), 0, "no hop to itself");
+
+    // tx delays of 1000 bytes: 80 ns at 100Gbps, 200 ns at 40Gbps, 800 ns at 10Gbps
+    NS_TEST_EXPECT_MSG_EQ(topo.GetPairDelay(0, 1), 2000, "same leaf");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetPairTxDelay(0, 1), 160, "same leaf");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetPairBw(0, 1), 100000000000ULL, "same leaf");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetPairDelay(0, 2), 6000, "same pod");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetPairTxDelay(0, 2), 560, "same pod");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetPairBw(0, 2), 40000000000ULL, "same pod");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetPairDelay(0, 15), 12000, "other pod");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetPairTxDelay(15, 0), 2160, "other pod");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetPairBw(0, 15), 10000000000ULL, "other pod");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetPairDelay(5, 5), 0, "itself");
+    NS_TEST_EXPECT_MSG_EQ(topo.GetPairBw(5, 5), std::numeric_limits<uint64_t>::max(), "itself");
+
+    CheckRoutes(topo, mtu);
+    Simulator::Destroy();
+}
+
+/**
+ * \brief TestSuite for the data center topology helper
+ */
+class DcTopologyHelperTestSuite : public TestSuite
+{
+  public:
+    DcTopologyHelperTestSuite();
+};
+
+DcTopologyHelperTestSuite::DcTopologyHelperTestSuite()
+    : TestSuite("dc-topology-helper", UNIT)
+{
+    AddTestCase(new DcTopologyRoutesTestCase(), TestCase::QUICK);
+    AddTestCase(new DcTopologyFatTreeTestCase(), TestCase::QUICK);
+}
+
+static DcTopologyHelperTestSuite g_dcTopologyHelperTestSuite; //!< The testsuite
@@ -0,0 +1,321 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/double.h"
+#include "ns3/fluid-background.h"
+#include "ns3/node-container.h"
+#include "ns3/qbb-helper.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/test.h"
+
+#include <map>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Builds the links of a chain of nodes, 16 Gbps each. With a ForegroundShare of 0.5
+ * the fluid gets 1 byte/ns of every link, which keeps the hand-computed rates simple.
+ */
+static std::vector<Ptr<QbbNetDevice>>
+BuildChain(uint32_t links)
+{
+    NodeContainer nodes;
+    nodes.Create(links + 1);
+    QbbHelper qbb;
+    qbb.SetDeviceAttribute("DataRate", StringValue("16Gbps"));
+    qbb.SetChannelAttribute("Delay", StringValue("1us"));
+    std::vector<Ptr<QbbNetDevice>> devs;
+    for (uint32_t i = 0; i < links; i++)
+    {
+        NetDeviceContainer d = qbb.Install(nodes.Get(i), nodes.Get(i + 1));
+        devs.push_back(DynamicCast<QbbNetDevice>(d.Get(0)));
+    }
+    return devs;
+}
+
+/**
+ * \brief Max-min rates and completion times of a hand-computed case.
+ *
+ * Links A and B carry 1 byte/ns of fluid each. From time T:
+ * - f1 [A] 10000 B, f2 [A, B] 4000 B, f3 [B] 1000 B, f4 [B] 2000 B: B is the bottleneck of
+ *   f2, f3 and f4 at 1/3, and f1 takes the 2/3 left on A.
+ * - f3 finishes at T + 3000: f2 and f4 get 1/2 of B, f1 the 1/2 left on A.
+ * - f4 finishes at T + 5000: A is now the bottleneck of f1 and f2, 1/2 each.
+ * - f2 finishes at T + 9000, and f1 gets A alone until T + 14000.
+ * - f5 [C] 500 B starts at T + 4000 on a link of its own, at 1 byte/ns, and finishes at
+ *   T + 4500 without changing the other rates.
+ */
+class FluidBackgroundMaxMinTestCase : public TestCase
+{
+  public:
+    FluidBackgroundMaxMinTestCase();
+
+  private:
+    void DoRun() override;
+    void Check(std::vector<double> gbps);
+    void Complete(uint64_t size, Time start, Time fct);
+
+    Ptr<FluidBackground> m_fluid;
+    std::vector<uint32_t> m_ids;
+    std::map<uint64_t, Time> m_fct; //!< by flow size
+};
+
+FluidBackgroundMaxMinTestCase::FluidBackgroundMaxMinTestCase()
+    : TestCase("FluidBackground max-min rates and completion times of a hand-computed case")
+{
+}
+
+void
+FluidBackgroundMaxMinTestCase::Check(std::vector<double> gbps)
+{
+    for (uint32_t i = 0; i < gbps.size(); i++)
+    {
+        NS_TEST_EXPECT_MSG_EQ_TOL(m_fluid->GetFlowRate(m_ids[i]).GetBitRate() / 1e9,
+                                  gbps[i],
+                                  1e-6,
+                                  "rate of f" << i + 1 << " at " << Simulator::Now().As(Time::NS));
+    }
+}
+
+void
+FluidBackgroundMaxMinTestCase::Complete(uint64_t size, Time start, Time fct)
+{
+    m_fct[size] = fct;
+}
+
+void
+FluidBackgroundMaxMinTestCase::DoRun()
+{
+    std::vector<Ptr<QbbNetDevice>> dev = BuildChain(3);
+    m_fluid = CreateObject<FluidBackground>();
+    m_fluid->SetAttribute("ForegroundShare", DoubleValue(0.5));
+    m_fluid->TraceConnectWithoutContext(
+        "FlowComplete",
+        MakeCallback(&FluidBackgroundMaxMinTestCase::Complete, this));
+
+    Time t = MicroSeconds(1);
+    m_ids.push_back(m_fluid->AddFlow({dev[0]}, 3, 0, 10000, t));
+    m_ids.push_back(m_fluid->AddFlow({dev[0], dev[1]}, 3, 0, 4000, t));
+    m_ids.push_back(m_fluid->AddFlow({dev[1]}, 3, 0, 1000, t));
+    m_ids.push_back(m_fluid->AddFlow({dev[1]}, 3, 0, 2000, t));
+    m_ids.push_back(m_fluid->AddFlow({dev[2]}, 3, 0, 500, t + NanoSeconds(4000)));
+
+    // rates in Gbps, 1 byte/ns is 8 Gbps
+    Simulator::Schedule(t + NanoSeconds(100),
+                        &FluidBackgroundMaxMinTestCase::Check,
+                        this,
+                        std::vector<double>{16.0 / 3, 8.0 / 3, 8.0 / 3, 8.0 / 3, 0});
+    Simulator::Schedule(t + NanoSeconds(3100),
+                        &FluidBackgroundMaxMinTestCase::Check,
+                        this,
+                        std::vector<double>{4, 4, 0, 4, 0});
+    Simulator::Schedule(t + NanoSeconds(4100),
+                        &FluidBackgroundMaxMinTestCase::Check,
+                        this,
+                        std::vector<double>{4, 4, 0, 4, 8});
+    Simulator::Schedule(t + NanoSeconds(5100),
+                        &FluidBackgroundMaxMinTestCase::Check,
+                        this,
+                        std::vector<double>{4, 4, 0, 0, 0});
+    Simulator::Schedule(t + NanoSeconds(9100),
+                        &FluidBackgroundMaxMinTestCase::Check,
+                        this,
+                        std::vector<double>{8, 0, 0, 0, 0});
+    Simulator::Run();
+
+    // the completion of a flow rounds up to the next ns after each rate change
+    std::map<uint64_t, double> expected = {{1000, 3000},
+                                           {2000, 5000},
+                                           {4000, 9000},
+                                           {10000, 14000},
+                                           {500, 500}};
+    NS_TEST_EXPECT_MSG_EQ(m_fct.size(), expected.size(), "completed flows");
+    for (const auto& e : expected)
+    {
+        NS_TEST_EXPECT_MSG_EQ_TOL(m_fct[e.first].GetNanoSeconds(),
+                                  e.second,
+                                  3,
+                                  "completion time of the " << e.first << " B flow");
+    }
+    NS_TEST_EXPECT_MSG_EQ(m_fluid->GetNActiveFlows(), 0, "active flows at the end");
+    NS_TEST_EXPECT_MSG_EQ(m_fluid->GetNFlows(), 0, "finished flows are kept");
+
+    Simulator::Destroy();
+}
+
+/**
+ * \brief Random flows on random paths over a chain of links: after every arrival and departure
+ * the rates of the active flows, recomputed for the links of the event only, must be the
+ * max-min allocation of all the active flows computed from scratch.
+ */
+class FluidBackgroundRandomTestCase : public TestCase
+{
+  public:
+    FluidBackgroundRandomTestCase();
+
+  private:
+    void DoRun() override;
+    void Check();
+
+    static const uint32_t LINKS = 12;
+
+    Ptr<FluidBackground> m_fluid;
+    std::vector<std::vector<uint32_t>> m_paths; //!< links of every flow, by id
+    uint32_t m_checks;
+    uint32_t m_maxActive;
+    double m_maxErr;
+};
+
+FluidBackgroundRandomTestCase::FluidBackgroundRandomTestCase()
+    : TestCase("FluidBackground rates of random flows against a global max-min allocation"),
+      m_checks(0),
+      m_maxActive(0),
+      m_maxErr(0)
+{
+}
+
+void
+FluidBackgroundRandomTestCase::Check()
+{
+    // the active flows are the ones with a rate: every link has some capacity
+    std::vector<uint32_t> active;
+    std::vector<double> rate(m_paths.size(), 0);
+    for (uint32_t id = 0; id < m_paths.size(); id++)
+    {
+        if (m_fluid->GetFlowRate(id).GetBitRate() > 0)
+        {
+            active.push_back(id);
+        }
+    }
+    NS_TEST_EXPECT_MSG_EQ(active.size(), m_fluid->GetNActiveFlows(), "flows with a rate");
+
+    std::vector<double> left(LINKS, 1);
+    std::vector<uint32_t> cnt(LINKS, 0);
+    std::vector<bool> frozen(m_paths.size(), false);
+    for (uint32_t id : active)
+    {
+        for (uint32_t l : m_paths[id])
+        {
+            cnt[l]++;
+        }
+    }
+    while (true)
+    {
+        int best = -1;
+        for (uint32_t l = 0; l < LINKS; l++)
+        {
+            if (cnt[l] > 0 && (best < 0 || left[l] / cnt[l] < left[best] / cnt[best]))
+            {
+                best = l;
+            }
+        }
+        if (best < 0)
+        {
+            break;
+        }
+        double share = left[best] / cnt[best];
+        for (uint32_t id : active)
+        {
+            bool onBest = false;
+            for (uint32_t l : m_paths[id])
+            {
+                onBest |= (int)l == best;
+            }
+            if (!onBest || frozen[id])
+            {
+                continue;
+            }
+            frozen[id] = true;
+            rate[id] = share;
+            for (uint32_t l : m_paths[id])
+            {
+                left[l] -= share;
+                cnt[l]--;
+            }
+        }
+    }
+    for (uint32_t id : active)
+    {
+        double got = m_fluid->GetFlowRate(id).GetBitRate() / 8e9;
+        m_maxErr = std::max(m_maxErr, std::abs(got - rate[id]));
+    }
+    m_maxActive = std::max<uint32_t>(m_maxActive, active.size());
+    m_checks++;
+}
+
+void
+FluidBackgroundRandomTestCase::DoRun()
+{
+    std::vector<Ptr<QbbNetDevice>> dev = BuildChain(LINKS);
+    m_fluid = CreateObject<FluidBackground>();
+    m_fluid->SetAttribute("ForegroundShare", DoubleValue(0.5));
+
+    Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable>();
+    rng->SetStream(7);
+    uint64_t t = 1000;
+    for (uint32_t i = 0; i < 300; i++)
+    {
+        // a path of 1 to 4 consecutive links of the chain
+        uint32_t hops = rng->GetInteger(1, 4);
+        uint32_t first = rng->GetInteger(0, LINKS - hops);
+        std::vector<Ptr<QbbNetDevice>> path;
+        m_paths.emplace_back();
+        for (uint32_t h = 0; h < hops; h++)
+        {
+            path.push_back(dev[first + h]);
+            m_paths.back().push_back(first + h);
+        }
+        t += rng->GetInteger(10, 400);
+        uint32_t id = m_fluid->AddFlow(path, 3, 0, rng->GetInteger(500, 20000), NanoSeconds(t));
+        NS_TEST_ASSERT_MSG_EQ(id, m_paths.size() - 1, "flow ids");
+    }
+    // the rates are consistent between any two events, so the order at the same ns does not matter
+    for (uint64_t c = 1000; c < t + 100000; c += 37)
+    {
+        Simulator::Schedule(NanoSeconds(c),
+                            &FluidBackgroundRandomTestCase::Check,
+                            this);
+    }
+    Simulator::Run();
+
+    NS_TEST_EXPECT_MSG_LT(m_maxErr, 1e-6, "rate differs from the global allocation");
+    NS_TEST_EXPECT_MSG_GT(m_maxActive, 10, "flows sharing the links");
+    NS_TEST_EXPECT_MSG_EQ(m_fluid->GetNActiveFlows(), 0, "active flows at the end");
+    NS_TEST_EXPECT_MSG_EQ(m_fluid->GetNFlows(), 0, "finished flows are kept");
+
+    Simulator::Destroy();
+}
+
+/**
+ * \brief TestSuite for FluidBackground
+ */
+class FluidBackgroundTestSuite : public TestSuite
+{
+  public:
+    FluidBackgroundTestSuite();
+};
+
+FluidBackgroundTestSuite::FluidBackgroundTestSuite()
+    : TestSuite("fluid-background", UNIT)
+{
+    AddTestCase(new FluidBackgroundMaxMinTestCase(), TestCase::QUICK);
+    AddTestCase(new FluidBackgroundRandomTestCase(), TestCase::QUICK);
+}
+
+static FluidBackgroundTestSuite g_fluidBackgroundTestSuite; //!< The testsuite
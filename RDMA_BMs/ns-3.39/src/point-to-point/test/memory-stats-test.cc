@@ -0,0 +1,210 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/broadcom-egress-queue.h"
+#include "ns3/drop-tail-queue.h"
+#include "ns3/flow-id-tag.h"
+#include "ns3/memory-stats.h"
+#include "ns3/point-to-point-channel.h"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/rdma-queue-pair.h"
+#include "ns3/simulator.h"
+#include "ns3/switch-node.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * \brief Runs a short simulation of a burst of tagged packets over a point-to-point link,
+ * next to a switch with packets stuck in its egress queue and a pair of RDMA QPs, and
+ * checks the MemoryStats counters: they follow the objects, queued packets, tags and
+ * events while the simulation runs, and are back to where they started once everything
+ * is destroyed, including the packets and events left when the simulation is stopped.
+ * Without ENABLE_MEMORY_STATS, the counters must not move.
+ */
+class MemoryStatsTestCase : public TestCase
+{
+  public:
+    MemoryStatsTestCase();
+
+  private:
+    void DoRun() override;
+    void Send(Ptr<PointToPointNetDevice> device);
+    void CheckQueued(Ptr<PointToPointNetDevice> device);
+    bool Receive(Ptr<NetDevice> dev, Ptr<const Packet> p, uint16_t mode, const Address& sender);
+    /// count of c since the start of the test
+    int64_t Count(MemoryStats::Category c) const;
+    /// bytes of c since the start of the test
+    int64_t Bytes(MemoryStats::Category c) const;
+
+    static constexpr uint32_t PACKETS = 20;
+    static constexpr uint32_t SIZE = 1000;
+
+    int64_t m_count[MemoryStats::N_CATEGORIES];
+    int64_t m_bytes[MemoryStats::N_CATEGORIES];
+    int64_t m_on; //!< 1 if the counters are compiled in, else 0
+    uint32_t m_received;
+};
+
+MemoryStatsTestCase::MemoryStatsTestCase()
+    : TestCase("memory counters balance after a short simulation"),
+      m_on(MemoryStats::IsEnabled()),
+      m_received(0)
+{
+}
+
+int64_t
+MemoryStatsTestCase::Count(MemoryStats::Category c) const
+{
+    return MemoryStats::GetCount(c) - m_count[c];
+}
+
+int64_t
+MemoryStatsTestCase::Bytes(MemoryStats::Category c) const
+{
+    return MemoryStats::GetBytes(c) - m_bytes[c];
+}
+
+void
+MemoryStatsTestCase::Send(Ptr<PointToPointNetDevice> device)
+{
+    for (uint32_t i = 0; i < PACKETS; i++)
+    {
+        Ptr<Packet> p = Create<Packet>(SIZE);
+        p->AddPacketTag(FlowIdTag(i));
+        device->Send(p, device->GetBroadcast(), 0x800);
+    }
+}
+
+void
+MemoryStatsTestCase::CheckQueued(Ptr<PointToPointNetDevice> device)
+{
+    Ptr<Queue<Packet>> queue = device->GetQueue();
+    NS_TEST_EXPECT_MSG_GT(queue->GetNPackets(), 0, "packets queued");
+    // plus the 2 packets stuck in the switch
+    NS_TEST_EXPECT_MSG_EQ(Count(MemoryStats::QUEUED_PACKET),
+                          m_on * (queue->GetNPackets() + 2),
+                          "queued packets");
+    NS_TEST_EXPECT_MSG_EQ(Bytes(MemoryStats::QUEUED_PACKET),
+                          m_on * (queue->GetNBytes() + 2 * SIZE +
+                                  (queue->GetNPackets() + 2) * sizeof(Packet)),
+                          "queued bytes");
+    // one tag per packet not yet received, the one on the wire included
+    NS_TEST_EXPECT_MSG_EQ(Count(MemoryStats::PACKET_TAG),
+                          m_on * (PACKETS - m_received),
+                          "tags of the packets in flight");
+    NS_TEST_EXPECT_MSG_EQ((Count(MemoryStats::EVENT) > 0), bool(m_on), "pending events");
+}
+
+bool
+MemoryStatsTestCase::Receive(Ptr<NetDevice> dev,
+                             Ptr<const Packet> p,
+                             uint16_t mode,
+                             const Address& sender)
+{
+    m_received++;
+    return true;
+}
+
+void
+MemoryStatsTestCase::DoRun()
+{
+    for (uint32_t c = 0; c < MemoryStats::N_CATEGORIES; c++)
+    {
+        m_count[c] = MemoryStats::GetCount(MemoryStats::Category(c));
+        m_bytes[c] = MemoryStats::GetBytes(MemoryStats::Category(c));
+    }
+    {
+        Ptr<Node> a = CreateObject<Node>();
+        Ptr<Node> b = CreateObject<Node>();
+        Ptr<PointToPointNetDevice> devA = CreateObject<PointToPointNetDevice>();
+        Ptr<PointToPointNetDevice> devB = CreateObject<PointToPointNetDevice>();
+        Ptr<PointToPointChannel> channel = CreateObject<PointToPointChannel>();
+        devA->Attach(channel);
+        devA->SetAddress(Mac48Address::Allocate());
+        devA->SetDataRate(DataRate("8Mbps")); // about 1 ms per packet
+        devA->SetQueue(CreateObject<DropTailQueue<Packet>>());
+        devB->Attach(channel);
+        devB->SetAddress(Mac48Address::Allocate());
+        devB->SetQueue(CreateObject<DropTailQueue<Packet>>());
+        a->AddDevice(devA);
+        b->AddDevice(devB);
+        devB->SetReceiveCallback(MakeCallback(&MemoryStatsTestCase::Receive, this));
+
+        Ptr<SwitchNode> sw = CreateObject<SwitchNode>();
+        Ptr<QbbNetDevice> port = CreateObject<QbbNetDevice>();
+        Ptr<BEgressQueue> egress = CreateObject<BEgressQueue>();
+        egress->Enqueue(Create<Packet>(SIZE), 3);
+        egress->Enqueue(Create<Packet>(SIZE), 3);
+        port->SetQueue(egress);
+        sw->AddDevice(port);
+        Ipv4Address sip("10.0.0.1");
+        Ipv4Address dip("10.0.0.2");
+        Ptr<RdmaQueuePair> qp = CreateObject<RdmaQueuePair>(3, sip, dip, 10000, 100);
+        Ptr<RdmaRxQueuePair> rxQp = CreateObject<RdmaRxQueuePair>();
+
+        NS_TEST_EXPECT_MSG_EQ(Count(MemoryStats::NODE), m_on * 3, "nodes");
+        NS_TEST_EXPECT_MSG_EQ(Bytes(MemoryStats::NODE),
+                              m_on * (2 * sizeof(Node) + sizeof(SwitchNode)),
+                              "node bytes");
+        NS_TEST_EXPECT_MSG_EQ(Count(MemoryStats::DEVICE), m_on * 3, "devices");
+        NS_TEST_EXPECT_MSG_EQ(Bytes(MemoryStats::DEVICE),
+                              m_on * (2 * sizeof(PointToPointNetDevice) + sizeof(QbbNetDevice)),
+                              "device bytes");
+        NS_TEST_EXPECT_MSG_EQ(Count(MemoryStats::MMU), m_on, "MMU of the switch");
+        NS_TEST_EXPECT_MSG_EQ(Count(MemoryStats::QP), m_on * 2, "QPs");
+        NS_TEST_EXPECT_MSG_EQ(Count(MemoryStats::QUEUED_PACKET), m_on * 2, "packets queued");
+
+        Simulator::Schedule(Seconds(1), &MemoryStatsTestCase::Send, this, devA);
+        Simulator::Schedule(Seconds(1) + MicroSeconds(2500),
+                            &MemoryStatsTestCase::CheckQueued,
+                            this,
+                            devA);
+        // stop halfway through the burst, with packets queued and events pending
+        Simulator::Stop(Seconds(1) + MicroSeconds(10500));
+        Simulator::Run();
+        NS_TEST_EXPECT_MSG_GT(m_received, 0, "packets received");
+        NS_TEST_EXPECT_MSG_GT(devA->GetQueue()->GetNPackets(), 0, "packets left queued");
+        CheckQueued(devA);
+    }
+    Simulator::Destroy();
+
+    for (uint32_t c = 0; c < MemoryStats::N_CATEGORIES; c++)
+    {
+        MemoryStats::Category category = MemoryStats::Category(c);
+        NS_TEST_EXPECT_MSG_EQ(Count(category), 0, MemoryStats::GetName(category) << " left");
+        NS_TEST_EXPECT_MSG_EQ(Bytes(category),
+                              0,
+                              MemoryStats::GetName(category) << " bytes left");
+    }
+}
+
+/**
+ * \brief TestSuite for the per-subsystem memory counters
+ */
+class MemoryStatsTestSuite : public TestSuite
+{
+  public:
+    MemoryStatsTestSuite();
+};
+
+MemoryStatsTestSuite::MemoryStatsTestSuite()
+    : TestSuite("memory-stats", UNIT)
+{
+    AddTestCase(new MemoryStatsTestCase(), TestCase::QUICK);
+}
+
+static MemoryStatsTestSuite g_memoryStatsTestSuite; //!< The testsuite
@@ -0,0 +1,350 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/broadcom-egress-queue.h"
+#include "ns3/int-header.h"
+#include "ns3/interface-tag.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/pint.h"
+#include "ns3/ppp-header.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/seq-ts-header.h"
+#include "ns3/simulator.h"
+#include "ns3/switch-node.h"
+#include "ns3/test.h"
+#include "ns3/udp-header.h"
+#include "ns3/uinteger.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Checks the fixed point PintMath::log2 and PintMath::exp2 against std::log2 and
+ * std::exp2.
+ */
+class PintMathTestCase : public TestCase
+{
+  public:
+    PintMathTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+PintMathTestCase::PintMathTestCase()
+    : TestCase("PintMath log2 and exp2 accuracy")
+{
+}
+
+void
+PintMathTestCase::DoRun()
+{
+    const double one = 1 << PintMath::FRAC_BITS;
+    std::mt19937_64 rng(1);
+    for (uint32_t i = 0; i < 100000; i++)
+    {
+        // spread over all magnitudes
+        uint64_t x = rng() >> (rng() % 64);
+        if (x == 0)
+        {
+            continue;
+        }
+        double err = std::fabs(PintMath::log2(x) / one - std::log2(double(x)));
+        NS_TEST_ASSERT_MSG_LT(err, 2 / one, "log2 of " << x);
+    }
+    for (int64_t y = -20 * int64_t(one); y < 60 * int64_t(one); y += 37)
+    {
+        double exact = std::exp2(y / one);
+        double err = std::fabs(double(PintMath::exp2(y)) - exact);
+        NS_TEST_ASSERT_MSG_LT(err, std::max(1.0, exact * 1e-5), "exp2 of " << y / one);
+    }
+    NS_TEST_EXPECT_MSG_EQ(PintMath::exp2(70 * int64_t(one)), uint64_t(1) << 63, "saturation");
+}
+
+/**
+ * \brief Checks Pint::update_u against the exact
+ * u' = (T-dt)/T*u + dt*qlen/(B*T^2) + byte/(B*T), with qlen in units of 256 bytes as the switch
+ * reports it.
+ */
+class PintUpdateTestCase : public TestCase
+{
+  public:
+    PintUpdateTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+PintUpdateTestCase::PintUpdateTestCase()
+    : TestCase("Pint::update_u accuracy")
+{
+}
+
+void
+PintUpdateTestCase::DoRun()
+{
+    const uint64_t T = 9000;
+    const double scale = 1 << Pint::u_shift;
+    std::mt19937_64 rng(2);
+    for (uint64_t B : {uint64_t(25000000000 / 8), uint64_t(100000000000 / 8)})
+    {
+        int32_t logB = PintMath::log2(B);
+        int32_t logT = PintMath::log2(T);
+        double sumErr = 0;
+        uint32_t n = 100000;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            uint64_t dt = 1 + rng() % T;
+            uint64_t qlen = rng() % 1000000;
+            uint32_t byte = rng() % 9001;
+            uint32_t u = rng() % (2 * uint32_t(scale));
+            double exact = double(T - dt) / T * u +
+                           double(dt) * (qlen >> 8) * 256 * 1e9 / (double(B) * T * T) * scale +
+                           byte * 1e9 / (double(B) * T) * scale;
+            double newU = Pint::update_u(dt, qlen, byte, u, T, logB, logT);
+            double err = std::fabs(newU - exact);
+            NS_TEST_ASSERT_MSG_LT_OR_EQ(err,
+                                        exact * 1e-3 + 1,
+                                        "dt " << dt << " qlen " << qlen << " byte " << byte
+                                              << " u " << u << " B " << B);
+            if (exact > 0)
+            {
+                sumErr += err / exact;
+            }
+        }
+        NS_TEST_EXPECT_MSG_LT(sumErr / n, 1e-4, "mean relative error at B " << B);
+    }
+}
+
+/**
+ * \brief Checks Pint::encode_u: the probabilistic rounding picks one of the two powers around
+ * u_toInt and is unbiased over rnd, the encoding grows with u_toInt and it saturates at the last
+ * power of the table.
+ */
+class PintEncodeTestCase : public TestCase
+{
+  public:
+    PintEncodeTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+PintEncodeTestCase::PintEncodeTestCase()
+    : TestCase("Pint::encode_u rounding and saturation")
+{
+}
+
+void
+PintEncodeTestCase::DoRun()
+{
+    const uint32_t n = 1 << Pint::get_n_bits();
+    for (uint32_t u : {1, 2, 3, 100, 410, 1000, 77777, 250000})
+    {
+        uint16_t lo = Pint::encode_u(u, 65535);
+        double sum = 0;
+        for (uint32_t rnd = 0; rnd < 65536; rnd++)
+        {
+            uint16_t p = Pint::encode_u(u, rnd);
+            NS_TEST_ASSERT_MSG_EQ((p == lo || p == lo + 1), true, "power of " << u);
+            sum += Pint::decode_u(p) * Pint::max_concurrent;
+        }
+        NS_TEST_EXPECT_MSG_LT_OR_EQ(Pint::decode_u(lo) * Pint::max_concurrent,
+                                    u * (1 + 1e-9),
+                                    "lower power of " << u);
+        NS_TEST_EXPECT_MSG_LT(Pint::decode_u(lo + 1) * Pint::max_concurrent,
+                              u * Pint::log_base * (1 + 1e-9),
+                              "upper power of " << u);
+        NS_TEST_EXPECT_MSG_LT(std::fabs(sum / 65536 - u), u * 1e-3, "mean of " << u);
+    }
+    uint16_t last = 0;
+    for (uint32_t u = 1; u < 20000; u++)
+    {
+        uint16_t p = Pint::encode_u(u, 32768);
+        NS_TEST_ASSERT_MSG_GT_OR_EQ(p, last, "monotone at " << u);
+        last = p;
+    }
+    for (uint32_t rnd : {0, 32768, 65535})
+    {
+        NS_TEST_EXPECT_MSG_EQ(Pint::encode_u(1 << 20, rnd), n - 1, "saturation");
+        NS_TEST_EXPECT_MSG_EQ(Pint::encode_u(UINT32_MAX, rnd), n - 1, "saturation");
+    }
+}
+
+/**
+ * \brief Sends packets through a path of three HPCC-PINT switches, whose egress queues hold
+ * different backlogs, one packet every MaxRtt so that u is qlen/(B*T) + byte/(B*T) at each hop.
+ *
+ * The PINT header carries the largest power of the path, so it encodes the utilization of the
+ * bottleneck hop whatever its position: every sample decodes within one log_base step of it, the
+ * samples average to it, and the samples are the same for a given stream in both path orders.
+ */
+class PintHopTestCase : public TestCase
+{
+  public:
+    PintHopTestCase();
+
+  private:
+    void DoRun() override;
+    /// powers seen by the receiver, for the switches in the given order
+    std::vector<uint16_t> RunPath(const std::vector<uint32_t>& order, int64_t stream);
+    void Dequeue(const std::vector<uint32_t>& order);
+    static Ptr<Packet> MakeData();
+
+    static constexpr uint32_t SAMPLES = 400;
+    static constexpr uint64_t T = 9000;
+
+    std::vector<Ptr<SwitchNode>> m_switches;
+    std::vector<uint16_t> m_powers;
+};
+
+PintHopTestCase::PintHopTestCase()
+    : TestCase("PINT power of a path is the bottleneck utilization")
+{
+}
+
+Ptr<Packet>
+PintHopTestCase::MakeData()
+{
+    Ptr<Packet> p = Create<Packet>(1000);
+    SeqTsHeader seqTs;
+    seqTs.SetSeq(0);
+    seqTs.SetPG(3);
+    p->AddHeader(seqTs);
+    UdpHeader udp;
+    udp.SetDestinationPort(100);
+    udp.SetSourcePort(10000);
+    p->AddHeader(udp);
+    Ipv4Header ip;
+    ip.SetSource(Ipv4Address("11.0.0.1"));
+    ip.SetDestination(Ipv4Address("11.0.1.1"));
+    ip.SetProtocol(0x11);
+    ip.SetPayloadSize(p->GetSize());
+    ip.SetTtl(64);
+    p->AddHeader(ip);
+    PppHeader ppp;
+    ppp.SetProtocol(0x0021);
+    p->AddHeader(ppp);
+    p->AddPacketTag(InterfaceTag(0));
+    return p;
+}
+
+void
+PintHopTestCase::Dequeue(const std::vector<uint32_t>& order)
+{
+    Ptr<Packet> p = MakeData();
+    for (uint32_t k : order)
+    {
+        // queue 0, which the MMU does not account
+        m_switches[k]->SwitchNotifyDequeue(1, 0, p);
+    }
+    uint8_t* buf = p->GetBuffer();
+    IntHeader* ih = (IntHeader*)&buf[PppHeader::GetStaticSize() + 20 + 8 + 6];
+    m_powers.push_back(ih->GetPower());
+}
+
+std::vector<uint16_t>
+PintHopTestCase::RunPath(const std::vector<uint32_t>& order, int64_t stream)
+{
+    // backlogs of 0.2, 0.8 and 0.5 times B*T
+    const uint64_t qlen[] = {22500, 90000, 56250};
+    m_switches.clear();
+    m_powers.clear();
+    for (uint32_t k = 0; k < 3; k++)
+    {
+        Ptr<SwitchNode> sw = CreateObject<SwitchNode>();
+        sw->SetAttribute("CcMode", UintegerValue(10));
+        sw->SetAttribute("MaxRtt", UintegerValue(T));
+        sw->AssignStreams(stream + 2 * k);
+        Ptr<QbbNetDevice> in = CreateObject<QbbNetDevice>();
+        Ptr<QbbNetDevice> out = CreateObject<QbbNetDevice>();
+        out->SetDataRate(DataRate("100Gbps"));
+        Ptr<BEgressQueue> queue = CreateObject<BEgressQueue>();
+        queue->Enqueue(Create<Packet>(qlen[k]), 3);
+        out->SetQueue(queue);
+        sw->AddDevice(in);
+        sw->AddDevice(out);
+        m_switches.push_back(sw);
+    }
+    for (uint32_t i = 1; i <= SAMPLES; i++)
+    {
+        Simulator::Schedule(NanoSeconds(i * T), &PintHopTestCase::Dequeue, this, order);
+    }
+    Simulator::Run();
+    Simulator::Destroy();
+    return m_powers;
+}
+
+void
+PintHopTestCase::DoRun()
+{
+    IntHeader::Mode mode = IntHeader::mode;
+    int pintBytes = IntHeader::pint_bytes;
+    IntHeader::mode = IntHeader::PINT;
+    IntHeader::pint_bytes = Pint::get_n_bytes();
+
+    std::vector<uint16_t> forward = RunPath({0, 1, 2}, 10);
+    std::vector<uint16_t> backward = RunPath({2, 1, 0}, 10);
+    std::vector<uint16_t> other = RunPath({0, 1, 2}, 20);
+    NS_TEST_ASSERT_MSG_EQ(forward.size(), SAMPLES, "samples");
+    NS_TEST_ASSERT_MSG_EQ(backward.size(), SAMPLES, "samples");
+
+    // the first packet has no previous packet at the hop, the others add its size
+    const double BT = 100e9 / 8 * T * 1e-9;
+    const double uFirst = 90000 / BT;
+    const double u = (90000 + MakeData()->GetSize()) / BT;
+    double sum = 0;
+    for (uint32_t i = 0; i < SAMPLES; i++)
+    {
+        double expected = i == 0 ? uFirst : u;
+        double decoded = Pint::decode_u(forward[i]);
+        NS_TEST_EXPECT_MSG_GT(decoded, expected / Pint::log_base, "sample " << i);
+        NS_TEST_EXPECT_MSG_LT(decoded, expected * Pint::log_base, "sample " << i);
+        NS_TEST_EXPECT_MSG_EQ(forward[i], backward[i], "reversed path, sample " << i);
+        if (i > 0)
+        {
+            sum += decoded;
+        }
+    }
+    // u_toInt rounds up by at most 1/max_concurrent
+    NS_TEST_EXPECT_MSG_LT(std::fabs(sum / (SAMPLES - 1) - u), 0.01 * u, "mean of the samples");
+    NS_TEST_EXPECT_MSG_EQ((forward != other), true, "another stream dithers differently");
+
+    IntHeader::mode = mode;
+    IntHeader::pint_bytes = pintBytes;
+}
+
+/**
+ * \brief TestSuite for the HPCC-PINT utilization estimate and encoding
+ */
+class PintTestSuite : public TestSuite
+{
+  public:
+    PintTestSuite();
+};
+
+PintTestSuite::PintTestSuite()
+    : TestSuite("pint", UNIT)
+{
+    AddTestCase(new PintMathTestCase(), TestCase::QUICK);
+    AddTestCase(new PintUpdateTestCase(), TestCase::QUICK);
+    AddTestCase(new PintEncodeTestCase(), TestCase::QUICK);
+    AddTestCase(new PintHopTestCase(), TestCase::QUICK);
+}
+
+static PintTestSuite g_pintTestSuite; //!< The testsuite
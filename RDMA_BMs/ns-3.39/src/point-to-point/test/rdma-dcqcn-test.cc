@@ -0,0 +1,328 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/boolean.h"
+#include "ns3/data-rate.h"
+#include "ns3/double.h"
+#include "ns3/node.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/rdma-queue-pair.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+
+using namespace ns3;
+
+/**
+ * \brief Mellanox DCQCN of RdmaHw with a periodic event per timer and qp, as RdmaHw had it
+ * before the alpha updates became lazy and the idle timers stopped.
+ */
+class DcqcnReference
+{
+  public:
+    double g;
+    double rateOnFirstCnp;
+    bool clampTargetRate;
+    double rpTimer;               //!< us
+    double rateDecreaseInterval;  //!< us
+    uint32_t fastRecoveryTimes;
+    double alphaResumeInterval;   //!< us
+    DataRate rai;
+    DataRate rhai;
+    DataRate minRate;
+    DataRate lineRate;
+
+    DataRate rate;
+    DataRate targetRate;
+    double alpha{1};
+    bool alphaCnpArrived{false};
+    bool firstCnp{true};
+    bool decreaseCnpArrived{false};
+    uint32_t rpTimeStage{0};
+    EventId eventUpdateAlpha;
+    EventId eventDecreaseRate;
+    EventId rpTimerEvent;
+
+    void CnpReceived()
+    {
+        alphaCnpArrived = true;
+        decreaseCnpArrived = true;
+        if (firstCnp)
+        {
+            alpha = 1;
+            alphaCnpArrived = false;
+            ScheduleUpdateAlpha();
+            ScheduleDecreaseRate(1);
+            targetRate = rate = rateOnFirstCnp * rate;
+            firstCnp = false;
+        }
+    }
+
+    void Stop()
+    {
+        eventUpdateAlpha.Cancel();
+        eventDecreaseRate.Cancel();
+        rpTimerEvent.Cancel();
+    }
+
+  private:
+    void UpdateAlpha()
+    {
+        if (alphaCnpArrived)
+        {
+            alpha = (1 - g) * alpha + g;
+        }
+        else
+        {
+            alpha = (1 - g) * alpha;
+        }
+        alphaCnpArrived = false;
+        ScheduleUpdateAlpha();
+    }
+
+    void ScheduleUpdateAlpha()
+    {
+        eventUpdateAlpha = Simulator::Schedule(MicroSeconds(alphaResumeInterval),
+                                               &DcqcnReference::UpdateAlpha,
+                                               this);
+    }
+
+    void CheckRateDecrease()
+    {
+        ScheduleDecreaseRate(0);
+        if (decreaseCnpArrived)
+        {
+            bool clamp = true;
+            if (!clampTargetRate && rpTimeStage == 0)
+            {
+                clamp = false;
+            }
+            if (clamp)
+            {
+                targetRate = rate;
+            }
+            rate = std::max(minRate, rate * (1 - alpha / 2));
+            rpTimeStage = 0;
+            decreaseCnpArrived = false;
+            rpTimerEvent.Cancel();
+            rpTimerEvent =
+                Simulator::Schedule(MicroSeconds(rpTimer), &DcqcnReference::RateIncTimer, this);
+        }
+    }
+
+    void ScheduleDecreaseRate(uint32_t delta)
+    {
+        eventDecreaseRate =
+            Simulator::Schedule(MicroSeconds(rateDecreaseInterval) + NanoSeconds(delta),
+                                &DcqcnReference::CheckRateDecrease,
+                                this);
+    }
+
+    void RateIncTimer()
+    {
+        rpTimerEvent =
+            Simulator::Schedule(MicroSeconds(rpTimer), &DcqcnReference::RateIncTimer, this);
+        if (rpTimeStage < fastRecoveryTimes)
+        {
+            rate = (rate / 2) + (targetRate / 2);
+        }
+        else
+        {
+            targetRate += rpTimeStage == fastRecoveryTimes ? rai : rhai;
+            if (targetRate > lineRate)
+            {
+                targetRate = lineRate;
+            }
+            rate = (rate / 2) + (targetRate / 2);
+        }
+        rpTimeStage++;
+    }
+};
+
+/**
+ * \brief Feeds the same CNPs to a qp of RdmaHw (CcMode 1) and to DcqcnReference, and checks
+ * that the rate and the target rate are the same all along.
+ *
+ * The first CNP sets the phase of the alpha slots and of the rate decrease checks; the other
+ * CNPs and the samples are at different nanoseconds than the timers, so that the order of the
+ * events in a nanosecond does not matter. Between the two bursts of CNPs the qp recovers until
+ * the hyper increase changes nothing and idles for a second: RdmaHw must have no DCQCN event
+ * pending then, and catch up with the alpha decay at the next CNP.
+ */
+class RdmaDcqcnTestCase : public TestCase
+{
+  public:
+    /**
+     * \param clampTargetRate ClampTargetRate of RdmaHw
+     * \param rateOnFirstCnp RateOnFirstCnp of RdmaHw
+     */
+    RdmaDcqcnTestCase(bool clampTargetRate, double rateOnFirstCnp);
+
+  private:
+    void DoRun() override;
+    void Cnp();
+    void Sample();
+    void CheckIdle();
+
+    bool m_clampTargetRate;
+    double m_rateOnFirstCnp;
+    Ptr<RdmaHw> m_hw;
+    Ptr<RdmaQueuePair> m_qp;
+    DcqcnReference m_ref;
+    uint32_t m_samples;
+    uint32_t m_mismatches;
+    Time m_firstMismatch;
+    DataRate m_minRate;
+    bool m_idle;
+};
+
+RdmaDcqcnTestCase::RdmaDcqcnTestCase(bool clampTargetRate, double rateOnFirstCnp)
+    : TestCase("DCQCN rate trajectory, ClampTargetRate " + std::to_string(clampTargetRate) +
+               ", RateOnFirstCnp " + std::to_string(rateOnFirstCnp)),
+      m_clampTargetRate(clampTargetRate),
+      m_rateOnFirstCnp(rateOnFirstCnp),
+      m_samples(0),
+      m_mismatches(0),
+      m_idle(false)
+{
+}
+
+void
+RdmaDcqcnTestCase::Cnp()
+{
+    m_hw->cnp_received_mlx(m_qp);
+    m_ref.CnpReceived();
+}
+
+void
+RdmaDcqcnTestCase::Sample()
+{
+    m_samples++;
+    m_minRate = std::min(m_minRate, m_qp->m_rate);
+    if (m_qp->m_rate != m_ref.rate || m_qp->mlx.m_targetRate != m_ref.targetRate)
+    {
+        if (m_mismatches++ == 0)
+        {
+            m_firstMismatch = Simulator::Now();
+        }
+    }
+}
+
+void
+RdmaDcqcnTestCase::CheckIdle()
+{
+    m_idle = m_qp->mlx.m_targetRate == m_ref.lineRate && !m_qp->mlx.m_rpTimer.IsRunning() &&
+             !m_qp->mlx.m_eventDecreaseRate.IsRunning();
+}
+
+void
+RdmaDcqcnTestCase::DoRun()
+{
+    DataRate lineRate("100Gbps");
+    Ptr<Node> node = CreateObject<Node>();
+    Ptr<QbbNetDevice> dev = CreateObject<QbbNetDevice>();
+    dev->SetDataRate(lineRate);
+    node->AddDevice(dev);
+
+    m_hw = CreateObject<RdmaHw>();
+    m_hw->SetAttribute("CcMode", UintegerValue(1));
+    m_hw->SetAttribute("EwmaGain", DoubleValue(1.0 / 16));
+    m_hw->SetAttribute("RateOnFirstCnp", DoubleValue(m_rateOnFirstCnp));
+    m_hw->SetAttribute("ClampTargetRate", BooleanValue(m_clampTargetRate));
+    m_hw->SetAttribute("RPTimer", DoubleValue(50));
+    m_hw->SetAttribute("RateDecreaseInterval", DoubleValue(4));
+    m_hw->SetAttribute("FastRecoveryTimes", UintegerValue(1));
+    m_hw->SetAttribute("AlphaResumInterval", DoubleValue(55));
+    m_hw->SetAttribute("RateAI", DataRateValue(DataRate("50Mb/s")));
+    m_hw->SetAttribute("RateHAI", DataRateValue(DataRate("2Gb/s")));
+    m_hw->SetAttribute("MinRate", DataRateValue(DataRate("100Mb/s")));
+    m_hw->m_nic.push_back(RdmaInterfaceMgr(dev));
+    m_hw->m_nic.back().qpGrp = CreateObject<RdmaQueuePairGroup>();
+    Ipv4Address sip("11.0.0.1");
+    Ipv4Address dip("11.0.1.1");
+    m_hw->AddTableEntry(dip, 0);
+    m_qp = CreateObject<RdmaQueuePair>(3, sip, dip, 10000, 100);
+    m_qp->m_rate = lineRate;
+    m_qp->m_max_rate = lineRate;
+    m_qp->mlx.m_targetRate = lineRate;
+    m_minRate = lineRate;
+
+    m_ref.g = 1.0 / 16;
+    m_ref.rateOnFirstCnp = m_rateOnFirstCnp;
+    m_ref.clampTargetRate = m_clampTargetRate;
+    m_ref.rpTimer = 50;
+    m_ref.rateDecreaseInterval = 4;
+    m_ref.fastRecoveryTimes = 1;
+    m_ref.alphaResumeInterval = 55;
+    m_ref.rai = DataRate("50Mb/s");
+    m_ref.rhai = DataRate("2Gb/s");
+    m_ref.minRate = DataRate("100Mb/s");
+    m_ref.lineRate = lineRate;
+    m_ref.rate = lineRate;
+    m_ref.targetRate = lineRate;
+
+    // timers at 0 and 1 ns modulo 1us, CNPs at 250 ns, samples at 500 ns
+    Simulator::Schedule(MicroSeconds(10), &RdmaDcqcnTestCase::Cnp, this);
+    for (uint32_t k = 1; k <= 60; k++)
+    {
+        Simulator::Schedule(NanoSeconds(10250 + k * 3000), &RdmaDcqcnTestCase::Cnp, this);
+    }
+    for (uint32_t k = 0; k < 40; k++)
+    {
+        // uneven gaps: several CNPs in some decrease intervals, none in others
+        Simulator::Schedule(NanoSeconds(1000000250 + (k * k % 23) * 1000 + k * 37000),
+                            &RdmaDcqcnTestCase::Cnp,
+                            this);
+    }
+    for (uint64_t t = 500; t < 1100000000; t += 10000)
+    {
+        Simulator::Schedule(NanoSeconds(t), &RdmaDcqcnTestCase::Sample, this);
+    }
+    Simulator::Schedule(MilliSeconds(900) + NanoSeconds(500), &RdmaDcqcnTestCase::CheckIdle, this);
+    Simulator::Stop(MilliSeconds(1100));
+    Simulator::Run();
+    m_ref.Stop();
+
+    NS_TEST_ASSERT_MSG_GT(m_samples, 0, "no sample");
+    NS_TEST_EXPECT_MSG_EQ(m_mismatches,
+                          0,
+                          "rate differs from the periodic timers first at " << m_firstMismatch);
+    NS_TEST_EXPECT_MSG_EQ(m_idle, true, "DCQCN events pending on an idle qp");
+    NS_TEST_EXPECT_MSG_LT(m_minRate.GetBitRate(), lineRate.GetBitRate(), "no rate decrease");
+
+    Simulator::Destroy();
+}
+
+/**
+ * \brief TestSuite for the DCQCN timers of RdmaHw
+ */
+class RdmaDcqcnTestSuite : public TestSuite
+{
+  public:
+    RdmaDcqcnTestSuite();
+};
+
+RdmaDcqcnTestSuite::RdmaDcqcnTestSuite()
+    : TestSuite("rdma-dcqcn", UNIT)
+{
+    AddTestCase(new RdmaDcqcnTestCase(false, 1.0), TestCase::QUICK);
+    AddTestCase(new RdmaDcqcnTestCase(true, 1.0), TestCase::QUICK);
+    AddTestCase(new RdmaDcqcnTestCase(false, 0.5), TestCase::QUICK);
+}
+
+static RdmaDcqcnTestSuite g_rdmaDcqcnTestSuite; //!< The testsuite
@@ -0,0 +1,266 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/custom-header.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/node.h"
+#include "ns3/ppp-header.h"
+#include "ns3/qbb-header.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/rdma-queue-pair.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Feeds the data packets of one qp to the receiving RdmaHw, one every microsecond, and
+ * checks the ACKs, NACKs and CNP flags it enqueues on its NIC.
+ *
+ * Packet 12 arrives after packet 13, which triggers a NACK, and packets 12 to 19 are then
+ * received again in order. The NIC has no channel, so the feedback stays in its queue.
+ *
+ * - With both intervals 0, there is one ACK per packet with the cumulative bytes, one NACK at
+ *   the hole, and every feedback of a marked packet carries a CNP.
+ * - With AckCoalesceInterval, the ACKs are at least one interval apart, their seqs increase,
+ *   the NACK still carries the cumulative ack, the last ACK acks the whole message, and every
+ *   ACK of the receiver is either sent or counted as coalesced.
+ * - With MinCnpInterval, the CNPs are at least one interval apart and every other marked
+ *   feedback is counted as suppressed.
+ */
+class RdmaFeedbackTestCase : public TestCase
+{
+  public:
+    /**
+     * \param coalesce RdmaHw AckCoalesceInterval
+     * \param minCnp RdmaHw MinCnpInterval
+     * \param ecn whether the data packets are ECN-marked
+     */
+    RdmaFeedbackTestCase(Time coalesce, Time minCnp, bool ecn);
+
+  private:
+    struct Feedback
+    {
+        Time time;
+        bool nack;
+        uint32_t seq;
+        bool cnp;
+    };
+
+    void DoRun() override;
+    void Deliver(uint32_t seq);
+    void Enqueue(Ptr<const Packet> p, uint32_t qIndex);
+
+    static const uint32_t MTU = 1000;
+    static const uint32_t SIZE = 20000;
+
+    Time m_coalesce;
+    Time m_minCnp;
+    bool m_ecn;
+    Ptr<RdmaHw> m_hw[2]; //!< sender, receiver
+    Ptr<RdmaQueuePair> m_qp;
+    std::vector<Feedback> m_feedback;
+};
+
+RdmaFeedbackTestCase::RdmaFeedbackTestCase(Time coalesce, Time minCnp, bool ecn)
+    : TestCase("RDMA feedback, AckCoalesceInterval " + std::to_string(coalesce.GetNanoSeconds()) +
+               "ns, MinCnpInterval " + std::to_string(minCnp.GetNanoSeconds()) + "ns" +
+               (ecn ? ", ECN" : "")),
+      m_coalesce(coalesce),
+      m_minCnp(minCnp),
+      m_ecn(ecn)
+{
+}
+
+void
+RdmaFeedbackTestCase::Deliver(uint32_t seq)
+{
+    m_qp->snd_nxt = seq;
+    Ptr<Packet> p = m_hw[0]->GetNxtPacket(m_qp);
+    CustomHeader ch(CustomHeader::L2_Header | CustomHeader::L3_Header | CustomHeader::L4_Header);
+    ch.getInt = 1;
+    p->PeekHeader(ch);
+    if (m_ecn)
+    {
+        ch.m_tos |= 0x3;
+    }
+    m_hw[1]->Receive(p, ch);
+}
+
+void
+RdmaFeedbackTestCase::Enqueue(Ptr<const Packet> p, uint32_t qIndex)
+{
+    Ptr<Packet> cp = p->Copy();
+    PppHeader ppp;
+    Ipv4Header ip;
+    qbbHeader seqh;
+    cp->RemoveHeader(ppp);
+    cp->RemoveHeader(ip);
+    cp->RemoveHeader(seqh);
+    m_feedback.push_back(
+        {Simulator::Now(), ip.GetProtocol() == 0xFD, seqh.GetSeq(), seqh.GetCnp() != 0});
+}
+
+void
+RdmaFeedbackTestCase::DoRun()
+{
+    Ipv4Address sip("11.0.0.1");
+    Ipv4Address dip("11.0.1.1");
+    Ptr<QbbNetDevice> rxDev;
+    for (uint32_t k = 0; k < 2; k++)
+    {
+        Ptr<Node> node = CreateObject<Node>();
+        Ptr<QbbNetDevice> dev = CreateObject<QbbNetDevice>();
+        dev->SetDataRate(DataRate("100Gbps"));
+        node->AddDevice(dev);
+        m_hw[k] = CreateObject<RdmaHw>();
+        m_hw[k]->SetAttribute("Mtu", UintegerValue(MTU));
+        m_hw[k]->SetAttribute("L2AckInterval", UintegerValue(1));
+        m_hw[k]->SetAttribute("AckCoalesceInterval", TimeValue(m_coalesce));
+        m_hw[k]->SetAttribute("MinCnpInterval", TimeValue(m_minCnp));
+        m_hw[k]->m_nic.push_back(RdmaInterfaceMgr(dev));
+        m_hw[k]->m_nic.back().qpGrp = CreateObject<RdmaQueuePairGroup>();
+        m_hw[k]->AddTableEntry(k == 0 ? dip : sip, 0);
+        rxDev = dev;
+    }
+    rxDev->TraceConnectWithoutContext("QbbEnqueue",
+                                      MakeCallback(&RdmaFeedbackTestCase::Enqueue, this));
+    m_qp = CreateObject<RdmaQueuePair>(3, sip, dip, 10000, 100);
+    m_qp->SetSize(SIZE);
+    m_qp->SetBaseRtt(8000);
+    m_hw[0]->SetUnschedBytes(m_qp);
+
+    // packet 12 comes after 13, then the sender goes back to 12
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < 12; i++)
+    {
+        order.push_back(i);
+    }
+    order.push_back(13);
+    for (uint32_t i = 12; i < SIZE / MTU; i++)
+    {
+        order.push_back(i);
+    }
+    for (uint32_t k = 0; k < order.size(); k++)
+    {
+        Simulator::Schedule(MicroSeconds(k + 1),
+                            &RdmaFeedbackTestCase::Deliver,
+                            this,
+                            order[k] * MTU);
+    }
+    Simulator::Run();
+    Simulator::Destroy();
+
+    const RdmaHw::FeedbackStats& s = m_hw[1]->m_feedbackStats;
+    NS_TEST_ASSERT_MSG_EQ(s.dataBytes, order.size() * MTU, "data bytes received");
+    NS_TEST_ASSERT_MSG_EQ(s.acks + s.nacks, m_feedback.size(), "feedback enqueued");
+    NS_TEST_EXPECT_MSG_EQ(s.nacks, 1, "NACKs");
+    NS_TEST_EXPECT_MSG_EQ(s.acks + s.coalescedAcks, SIZE / MTU, "ACKs sent or coalesced");
+
+    Time lastAck;
+    Time lastCnp;
+    uint32_t ackedSeq = 0;
+    uint32_t cnps = 0;
+    for (uint32_t i = 0; i < m_feedback.size(); i++)
+    {
+        const Feedback& f = m_feedback[i];
+        if (m_coalesce.IsZero())
+        {
+            // one ACK per packet, the NACK is the 13th feedback
+            bool nack = i == 12;
+            uint32_t seq = (i < 12 ? i + 1 : i) * MTU;
+            NS_TEST_EXPECT_MSG_EQ(f.nack, nack, "feedback " << i);
+            NS_TEST_EXPECT_MSG_EQ(f.seq, seq, "seq of feedback " << i);
+            NS_TEST_EXPECT_MSG_EQ(f.time, MicroSeconds(i + 1), "time of feedback " << i);
+        }
+        else if (f.nack)
+        {
+            NS_TEST_EXPECT_MSG_EQ(f.seq, 12 * MTU, "NACK cumulative ack");
+        }
+        else
+        {
+            NS_TEST_EXPECT_MSG_GT(f.seq, ackedSeq, "ACK " << i << " acks nothing new");
+            if (ackedSeq > 0)
+            {
+                NS_TEST_EXPECT_MSG_GT_OR_EQ(f.time - lastAck, m_coalesce, "ACK " << i);
+            }
+            ackedSeq = f.seq;
+            lastAck = f.time;
+        }
+        if (f.cnp)
+        {
+            NS_TEST_EXPECT_MSG_EQ(m_ecn, true, "CNP without ECN");
+            if (cnps > 0)
+            {
+                NS_TEST_EXPECT_MSG_GT_OR_EQ(f.time - lastCnp, m_minCnp, "CNP of feedback " << i);
+            }
+            lastCnp = f.time;
+            cnps++;
+        }
+    }
+    NS_TEST_EXPECT_MSG_EQ(m_feedback.back().seq, SIZE, "the last feedback acks the message");
+    NS_TEST_EXPECT_MSG_EQ(cnps, s.cnps, "CNPs");
+    if (m_coalesce.IsZero())
+    {
+        NS_TEST_EXPECT_MSG_EQ(m_feedback.size(), order.size(), "one feedback per packet");
+        NS_TEST_EXPECT_MSG_EQ(s.coalescedAcks, 0, "coalesced ACKs");
+    }
+    else
+    {
+        NS_TEST_EXPECT_MSG_LT(s.acks * 3, SIZE / MTU, "ACKs not coalesced");
+        NS_TEST_EXPECT_MSG_LT_OR_EQ(m_feedback.back().time,
+                                    MicroSeconds(order.size()) + m_coalesce,
+                                    "last ACK held past the window");
+    }
+    if (!m_ecn)
+    {
+        NS_TEST_EXPECT_MSG_EQ(s.cnps + s.suppressedCnps, 0, "CNPs without ECN");
+    }
+    else if (m_minCnp.IsZero())
+    {
+        NS_TEST_EXPECT_MSG_EQ(s.cnps, m_feedback.size(), "every feedback carries a CNP");
+        NS_TEST_EXPECT_MSG_EQ(s.suppressedCnps, 0, "suppressed CNPs");
+    }
+    else
+    {
+        NS_TEST_EXPECT_MSG_EQ(s.cnps + s.suppressedCnps, m_feedback.size(), "marked feedback");
+        NS_TEST_EXPECT_MSG_GT(s.suppressedCnps, 0, "no CNP suppressed");
+    }
+}
+
+/**
+ * \brief TestSuite for the ACK coalescing and the CNP interval of RdmaHw
+ */
+class RdmaFeedbackTestSuite : public TestSuite
+{
+  public:
+    RdmaFeedbackTestSuite();
+};
+
+RdmaFeedbackTestSuite::RdmaFeedbackTestSuite()
+    : TestSuite("rdma-feedback", UNIT)
+{
+    AddTestCase(new RdmaFeedbackTestCase(Time(0), Time(0), false), TestCase::QUICK);
+    AddTestCase(new RdmaFeedbackTestCase(Time(0), Time(0), true), TestCase::QUICK);
+    AddTestCase(new RdmaFeedbackTestCase(MicroSeconds(5), Time(0), false), TestCase::QUICK);
+    AddTestCase(new RdmaFeedbackTestCase(Time(0), MicroSeconds(4), true), TestCase::QUICK);
+    AddTestCase(new RdmaFeedbackTestCase(MicroSeconds(5), MicroSeconds(12), true), TestCase::QUICK);
+}
+
+static RdmaFeedbackTestSuite g_rdmaFeedbackTestSuite; //!< The testsuite
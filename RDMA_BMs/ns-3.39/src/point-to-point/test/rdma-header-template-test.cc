@@ -0,0 +1,179 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/int-header.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/node.h"
+#include "ns3/ppp-header.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/rdma-queue-pair.h"
+#include "ns3/seq-ts-header.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+#include "ns3/udp-header.h"
+#include "ns3/uinteger.h"
+#include "ns3/unsched-tag.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Builds the data packets of the same qp with and without the header template
+ * (RdmaHw::m_headerTemplate), and checks that they are the same bytes with the same UnSchedTag.
+ *
+ * The packets are built at several times after the template, so that the timestamp of the
+ * IntHeader::TS mode must be the one of the packet, not the one of the template.
+ */
+class RdmaHeaderTemplateTestCase : public TestCase
+{
+  public:
+    /**
+     * \param mode IntHeader::mode of the packets
+     */
+    RdmaHeaderTemplateTestCase(IntHeader::Mode mode);
+
+  private:
+    void DoRun() override;
+    void Compare(uint32_t n);
+
+    IntHeader::Mode m_mode;
+    Ptr<RdmaHw> m_hw[2];
+    Ptr<RdmaQueuePair> m_qp[2];
+    uint32_t m_packets;
+    uint32_t m_differ;
+    uint32_t m_firstDiffer;
+    uint32_t m_badTs;
+};
+
+RdmaHeaderTemplateTestCase::RdmaHeaderTemplateTestCase(IntHeader::Mode mode)
+    : TestCase("RDMA data header template, IntHeader mode " + std::to_string(mode)),
+      m_mode(mode),
+      m_packets(0),
+      m_differ(0),
+      m_firstDiffer(0),
+      m_badTs(0)
+{
+}
+
+void
+RdmaHeaderTemplateTestCase::Compare(uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++, m_packets++)
+    {
+        Ptr<Packet> p[2];
+        std::vector<uint8_t> bytes[2];
+        UnSchedTag tag[2];
+        for (uint32_t k = 0; k < 2; k++)
+        {
+            if (m_qp[k]->snd_nxt >= m_qp[k]->m_size)
+            {
+                m_qp[k]->snd_nxt = 0; // start the message again
+            }
+            p[k] = m_hw[k]->GetNxtPacket(m_qp[k]);
+            bytes[k].resize(p[k]->GetSize());
+            p[k]->CopyData(bytes[k].data(), bytes[k].size());
+            // PppHeader reserves GetStaticSize() bytes but writes the protocol only
+            std::fill(bytes[k].begin() + 2, bytes[k].begin() + PppHeader::GetStaticSize(), 0);
+            p[k]->PeekPacketTag(tag[k]);
+        }
+        if (bytes[0] != bytes[1] || tag[0].GetValue() != tag[1].GetValue())
+        {
+            if (m_differ++ == 0)
+            {
+                m_firstDiffer = m_packets;
+            }
+        }
+        if (m_mode == IntHeader::TS)
+        {
+            PppHeader ppp;
+            Ipv4Header ip;
+            UdpHeader udp;
+            SeqTsHeader seqTs;
+            p[0]->RemoveHeader(ppp);
+            p[0]->RemoveHeader(ip);
+            p[0]->RemoveHeader(udp);
+            p[0]->RemoveHeader(seqTs);
+            if (seqTs.GetTs() != Simulator::Now())
+            {
+                m_badTs++;
+            }
+        }
+    }
+}
+
+void
+RdmaHeaderTemplateTestCase::DoRun()
+{
+    IntHeader::Mode savedMode = (IntHeader::Mode)IntHeader::mode;
+    IntHeader::mode = m_mode;
+
+    Ipv4Address sip("11.0.0.1");
+    Ipv4Address dip("11.0.1.1");
+    for (uint32_t k = 0; k < 2; k++)
+    {
+        Ptr<Node> node = CreateObject<Node>();
+        Ptr<QbbNetDevice> dev = CreateObject<QbbNetDevice>();
+        dev->SetDataRate(DataRate("100Gbps"));
+        node->AddDevice(dev);
+        m_hw[k] = CreateObject<RdmaHw>();
+        m_hw[k]->SetAttribute("Mtu", UintegerValue(1000));
+        m_hw[k]->m_headerTemplate = k == 0;
+        m_hw[k]->m_nic.push_back(RdmaInterfaceMgr(dev));
+        m_hw[k]->m_nic.back().qpGrp = CreateObject<RdmaQueuePairGroup>();
+        m_hw[k]->AddTableEntry(dip, 0);
+        m_qp[k] = CreateObject<RdmaQueuePair>(3, sip, dip, 10000, 100);
+        m_qp[k]->SetSize(25500);
+        m_qp[k]->SetBaseRtt(8000);
+        m_hw[k]->SetUnschedBytes(m_qp[k]);
+    }
+    m_qp[0]->m_dataHdr.Build(sip, dip, 10000, 100, 3);
+    NS_TEST_ASSERT_MSG_EQ(m_qp[0]->m_dataHdr.GetSerializedSize(),
+                          RdmaDataHeader::GetStaticSize(),
+                          "template size");
+
+    Simulator::Schedule(NanoSeconds(0), &RdmaHeaderTemplateTestCase::Compare, this, 30);
+    Simulator::Schedule(MicroSeconds(5), &RdmaHeaderTemplateTestCase::Compare, this, 30);
+    Simulator::Schedule(MilliSeconds(1), &RdmaHeaderTemplateTestCase::Compare, this, 30);
+    Simulator::Run();
+    Simulator::Destroy();
+    IntHeader::mode = savedMode;
+
+    NS_TEST_EXPECT_MSG_EQ(m_packets, 90, "packets built");
+    NS_TEST_EXPECT_MSG_EQ(m_differ, 0, "first differing packet " << m_firstDiffer);
+    NS_TEST_EXPECT_MSG_EQ(m_badTs, 0, "IntHeader ts is not the time the packet was built");
+}
+
+/**
+ * \brief TestSuite for the header template of the RDMA data packets
+ */
+class RdmaHeaderTemplateTestSuite : public TestSuite
+{
+  public:
+    RdmaHeaderTemplateTestSuite();
+};
+
+RdmaHeaderTemplateTestSuite::RdmaHeaderTemplateTestSuite()
+    : TestSuite("rdma-header-template", UNIT)
+{
+    AddTestCase(new RdmaHeaderTemplateTestCase(IntHeader::NORMAL), TestCase::QUICK);
+    AddTestCase(new RdmaHeaderTemplateTestCase(IntHeader::TS), TestCase::QUICK);
+    AddTestCase(new RdmaHeaderTemplateTestCase(IntHeader::PINT), TestCase::QUICK);
+    AddTestCase(new RdmaHeaderTemplateTestCase(IntHeader::NONE), TestCase::QUICK);
+}
+
+static RdmaHeaderTemplateTestSuite g_rdmaHeaderTemplateTestSuite; //!< The testsuite
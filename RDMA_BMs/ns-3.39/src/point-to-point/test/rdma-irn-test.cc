@@ -0,0 +1,294 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/boolean.h"
+#include "ns3/custom-header.h"
+#include "ns3/double.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/node.h"
+#include "ns3/ppp-header.h"
+#include "ns3/qbb-header.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/rdma-queue-pair.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+
+#include <map>
+
+using namespace ns3;
+
+/**
+ * \brief Sends the first 7 packets of an IRN qp, a full window, drops packets 0 and 3, and
+ * feeds the SACKs of the receiving RdmaHw back to the qp as RdmaHw::ReceiveAck does.
+ *
+ * Checks the retransmission cursor and the window at every step: the lost packets are
+ * retransmitted one by one, skipping the sacked packets between them, without moving snd_nxt
+ * and although the window is full, and then the qp sends the rest of the message. The send
+ * times of RdmaHw::PktSent are keyed by the ack of each packet, also for the retransmissions.
+ */
+class RdmaIrnTestCase : public TestCase
+{
+  public:
+    RdmaIrnTestCase();
+
+  private:
+    void DoRun() override;
+    /// sends the next packet of the qp and checks its seq
+    void Send(uint64_t seq, bool retx);
+    void Deliver(uint64_t seq);
+    void Feedback(Ptr<const Packet> p, uint32_t qIndex);
+    /// checks the IRN state of the qp
+    void Check(const std::string& step,
+               uint64_t snd_una,
+               uint64_t snd_nxt,
+               uint64_t retxNxt,
+               bool hasRetx,
+               bool winBound);
+    static uint64_t GetSeq(Ptr<Packet> p);
+
+    static const uint32_t MTU = 1000;
+    static const uint32_t SIZE = 10000;
+
+    Ptr<RdmaHw> m_hw[2]; //!< sender, receiver
+    Ptr<RdmaQueuePair> m_qp;
+    std::map<uint64_t, Ptr<Packet>> m_sent; //!< last packet sent at each seq
+    std::map<uint64_t, Time> m_sendTime;    //!< last send time, keyed by the ack of the packet
+};
+
+RdmaIrnTestCase::RdmaIrnTestCase()
+    : TestCase("IRN selective retransmission of two lost packets in a full window")
+{
+}
+
+uint64_t
+RdmaIrnTestCase::GetSeq(Ptr<Packet> p)
+{
+    CustomHeader ch(CustomHeader::L2_Header | CustomHeader::L3_Header | CustomHeader::L4_Header);
+    ch.getInt = 1;
+    p->PeekHeader(ch);
+    return ch.udp.seq;
+}
+
+void
+RdmaIrnTestCase::Send(uint64_t seq, bool retx)
+{
+    NS_TEST_EXPECT_MSG_GT(m_qp->GetBytesLeft(), 0, "nothing to send at " << seq);
+    Ptr<Packet> p = m_hw[0]->GetNxtPacket(m_qp);
+    m_hw[0]->PktSent(m_qp, p, Time(0));
+    NS_TEST_EXPECT_MSG_EQ(GetSeq(p), seq, "seq of the packet sent");
+    NS_TEST_EXPECT_MSG_EQ(m_qp->lastPktEnd, seq + MTU, "end of the packet sent");
+    if (retx)
+    {
+        NS_TEST_EXPECT_MSG_GT(m_qp->snd_nxt, seq + MTU, "snd_nxt after a retransmission");
+    }
+    else
+    {
+        NS_TEST_EXPECT_MSG_EQ(m_qp->snd_nxt, seq + MTU, "snd_nxt after new data");
+    }
+    m_sent[seq] = p;
+    m_sendTime[seq + MTU] = Simulator::Now();
+}
+
+void
+RdmaIrnTestCase::Deliver(uint64_t seq)
+{
+    Ptr<Packet> p = m_sent[seq]->Copy();
+    CustomHeader ch(CustomHeader::L2_Header | CustomHeader::L3_Header | CustomHeader::L4_Header);
+    ch.getInt = 1;
+    p->PeekHeader(ch);
+    m_hw[1]->Receive(p, ch);
+}
+
+void
+RdmaIrnTestCase::Feedback(Ptr<const Packet> p, uint32_t qIndex)
+{
+    Ptr<Packet> cp = p->Copy();
+    PppHeader ppp;
+    Ipv4Header ip;
+    qbbHeader seqh;
+    cp->RemoveHeader(ppp);
+    cp->RemoveHeader(ip);
+    cp->RemoveHeader(seqh);
+    m_qp->Acknowledge(seqh.GetSeq());
+    if (ip.GetProtocol() == 0xFD && seqh.GetSack() != 0)
+    {
+        m_qp->IrnSack(seqh.GetSack());
+    }
+}
+
+void
+RdmaIrnTestCase::Check(const std::string& step,
+                       uint64_t snd_una,
+                       uint64_t snd_nxt,
+                       uint64_t retxNxt,
+                       bool hasRetx,
+                       bool winBound)
+{
+    NS_TEST_EXPECT_MSG_EQ(m_qp->snd_una, snd_una, step << ": snd_una");
+    NS_TEST_EXPECT_MSG_EQ(m_qp->snd_nxt, snd_nxt, step << ": snd_nxt");
+    NS_TEST_EXPECT_MSG_EQ(m_qp->IrnNextRetx(), retxNxt, step << ": retransmission cursor");
+    NS_TEST_EXPECT_MSG_EQ(m_qp->IrnHasRetx(), hasRetx, step << ": retransmission pending");
+    NS_TEST_EXPECT_MSG_EQ(m_qp->IsWinBound(), winBound, step << ": window bound");
+    uint64_t left = SIZE - snd_nxt + (hasRetx ? MTU : 0);
+    NS_TEST_EXPECT_MSG_EQ(m_qp->GetBytesLeft(), left, step << ": bytes left");
+}
+
+void
+RdmaIrnTestCase::DoRun()
+{
+    Ipv4Address sip("11.0.0.1");
+    Ipv4Address dip("11.0.1.1");
+    Ptr<QbbNetDevice> rxDev;
+    for (uint32_t k = 0; k < 2; k++)
+    {
+        Ptr<Node> node = CreateObject<Node>();
+        Ptr<QbbNetDevice> dev = CreateObject<QbbNetDevice>();
+        dev->SetDataRate(DataRate("100Gbps"));
+        node->AddDevice(dev);
+        m_hw[k] = CreateObject<RdmaHw>();
+        m_hw[k]->SetAttribute("Mtu", UintegerValue(MTU));
+        m_hw[k]->SetAttribute("L2AckInterval", UintegerValue(1));
+        m_hw[k]->SetAttribute("IrnEnabled", BooleanValue(true));
+        // no RTO within the test
+        m_hw[k]->SetAttribute("IrnRtoLow", DoubleValue(10000));
+        m_hw[k]->SetAttribute("IrnRtoHigh", DoubleValue(10000));
+        m_hw[k]->m_nic.push_back(RdmaInterfaceMgr(dev));
+        m_hw[k]->m_nic.back().qpGrp = CreateObject<RdmaQueuePairGroup>();
+        m_hw[k]->AddTableEntry(k == 0 ? dip : sip, 0);
+        rxDev = dev;
+    }
+    rxDev->TraceConnectWithoutContext("QbbEnqueue", MakeCallback(&RdmaIrnTestCase::Feedback, this));
+    m_qp = CreateObject<RdmaQueuePair>(3, sip, dip, 10000, 100);
+    m_qp->SetSize(SIZE);
+    m_qp->SetBaseRtt(8000);
+    m_qp->m_rate = m_qp->m_max_rate = DataRate("100Gbps");
+    m_qp->irn.m_enabled = true;
+    m_qp->irn.m_mtu = MTU;
+    m_qp->irn.m_bdpCap = 7 * MTU;
+    m_hw[0]->SetUnschedBytes(m_qp);
+
+    // packets 0 to 6 fill the window, 0 and 3 are lost
+    for (uint32_t i = 0; i < 7; i++)
+    {
+        Simulator::Schedule(MicroSeconds(i + 1), &RdmaIrnTestCase::Send, this, i * MTU, false);
+    }
+    Simulator::Schedule(MicroSeconds(8),
+                        &RdmaIrnTestCase::Check,
+                        this,
+                        "window full",
+                        0,
+                        7000,
+                        0,
+                        false,
+                        true);
+    for (uint32_t i : {1, 2, 4, 5, 6})
+    {
+        Simulator::Schedule(MicroSeconds(10 + i), &RdmaIrnTestCase::Deliver, this, i * MTU);
+    }
+    // 1000, 2000, 4000, 5000 and 6000 are sacked: the retransmission of 0 goes first, although
+    // the window is full
+    Simulator::Schedule(MicroSeconds(20),
+                        &RdmaIrnTestCase::Check,
+                        this,
+                        "sacked",
+                        0,
+                        7000,
+                        0,
+                        true,
+                        false);
+    Simulator::Schedule(MicroSeconds(21), &RdmaIrnTestCase::Send, this, 0, true);
+    Simulator::Schedule(MicroSeconds(22),
+                        &RdmaIrnTestCase::Check,
+                        this,
+                        "0 retransmitted",
+                        0,
+                        7000,
+                        3000,
+                        true,
+                        false);
+    Simulator::Schedule(MicroSeconds(23), &RdmaIrnTestCase::Send, this, 3000, true);
+    // past the last sack: nothing is pending and the window bounds the qp again
+    Simulator::Schedule(MicroSeconds(24),
+                        &RdmaIrnTestCase::Check,
+                        this,
+                        "3000 retransmitted",
+                        0,
+                        7000,
+                        6000,
+                        false,
+                        true);
+    Simulator::Schedule(MicroSeconds(25), &RdmaIrnTestCase::Deliver, this, 0);
+    Simulator::Schedule(MicroSeconds(26),
+                        &RdmaIrnTestCase::Check,
+                        this,
+                        "0 acked",
+                        3000,
+                        7000,
+                        6000,
+                        false,
+                        false);
+    Simulator::Schedule(MicroSeconds(27), &RdmaIrnTestCase::Deliver, this, 3000);
+    Simulator::Schedule(MicroSeconds(28),
+                        &RdmaIrnTestCase::Check,
+                        this,
+                        "all acked",
+                        7000,
+                        7000,
+                        7000,
+                        false,
+                        false);
+    for (uint32_t i = 7; i < SIZE / MTU; i++)
+    {
+        Simulator::Schedule(MicroSeconds(i + 22), &RdmaIrnTestCase::Send, this, i * MTU, false);
+        Simulator::Schedule(MicroSeconds(i + 22) + NanoSeconds(500),
+                            &RdmaIrnTestCase::Deliver,
+                            this,
+                            i * MTU);
+    }
+    Simulator::Stop(MicroSeconds(40));
+    Simulator::Run();
+
+    NS_TEST_EXPECT_MSG_EQ(m_qp->snd_una, SIZE, "message acked");
+    NS_TEST_EXPECT_MSG_EQ(m_qp->IsFinished(), true, "qp finished");
+    NS_TEST_EXPECT_MSG_EQ(m_hw[1]->m_feedbackStats.nacks, 5, "NACKs");
+    // one send time per packet, the retransmissions replaced those of 0 and 3000
+    NS_TEST_EXPECT_MSG_EQ(m_qp->rates.size(), SIZE / MTU, "send times");
+    for (const auto& t : m_sendTime)
+    {
+        NS_TEST_EXPECT_MSG_EQ(m_qp->rates[t.first],
+                              t.second.GetNanoSeconds(),
+                              "send time of the packet acked by " << t.first);
+    }
+    Simulator::Destroy();
+}
+
+/**
+ * \brief TestSuite for the IRN selective retransmission of RdmaQueuePair and RdmaHw
+ */
+class RdmaIrnTestSuite : public TestSuite
+{
+  public:
+    RdmaIrnTestSuite();
+};
+
+RdmaIrnTestSuite::RdmaIrnTestSuite()
+    : TestSuite("rdma-irn", UNIT)
+{
+    AddTestCase(new RdmaIrnTestCase(), TestCase::QUICK);
+}
+
+static RdmaIrnTestSuite g_rdmaIrnTestSuite; //!< The testsuite
@@ -0,0 +1,238 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/data-rate.h"
+#include "ns3/double.h"
+#include "ns3/error-model.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4.h"
+#include "ns3/node-container.h"
+#include "ns3/pointer.h"
+#include "ns3/qbb-helper.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/rdma-driver.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/rdma-queue-pair.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+
+using namespace ns3;
+
+/**
+ * \brief Runs RDMA flows between two hosts and checks, every 100 ns, that
+ * RdmaQueuePairGroup::GetNextAvail is the earliest m_nextAvail of the qps with bytes left,
+ * as QbbNetDevice found it by walking all the qps, and that the index holds exactly those qps
+ * with their current m_nextAvail.
+ *
+ * The flows start at different times (NewQp, then PktSent), the receiver drops packets so
+ * that the sender goes back to the last acked packet (RecoverQueue), the rates of the qps
+ * change between 10 and 25 Gbps (ChangeRate, as the congestion controls do), and the finished
+ * qps leave the group when the round robin compacts it.
+ */
+class RdmaQpGroupTestCase : public TestCase
+{
+  public:
+    RdmaQpGroupTestCase();
+
+  private:
+    void DoRun() override;
+    void StartFlow(uint32_t f);
+    void Check();
+    void ChangeRates(uint32_t k);
+    void AppFinish();
+    void RxDrop(Ptr<const Packet> p);
+
+    Ipv4Address m_addr[2];
+    Ptr<RdmaHw> m_hw;
+    Ptr<RdmaQueuePairGroup> m_grp;
+    uint32_t m_checks;
+    uint32_t m_mismatches;
+    Time m_firstMismatch;
+    uint32_t m_maxQps;
+    uint32_t m_rateChanges;
+    uint32_t m_completed;
+    uint32_t m_drops;
+};
+
+RdmaQpGroupTestCase::RdmaQpGroupTestCase()
+    : TestCase("RdmaQueuePairGroup next available time against a scan of the qps"),
+      m_checks(0),
+      m_mismatches(0),
+      m_maxQps(0),
+      m_rateChanges(0),
+      m_completed(0),
+      m_drops(0)
+{
+}
+
+void
+RdmaQpGroupTestCase::StartFlow(uint32_t f)
+{
+    m_hw->AddQueuePair(20000 + 7000 * f,
+                       1 + f % 3,
+                       m_addr[0],
+                       m_addr[1],
+                       10000 + f,
+                       100,
+                       0,
+                       8000,
+                       MakeCallback(&RdmaQpGroupTestCase::AppFinish, this),
+                       Simulator::GetMaximumSimulationTime());
+}
+
+void
+RdmaQpGroupTestCase::Check()
+{
+    Time t = Simulator::GetMaximumSimulationTime();
+    uint32_t pending = 0;
+    uint32_t stale = 0; // qps with bytes left not indexed with their m_nextAvail
+    for (uint32_t i = 0; i < m_grp->GetN(); i++)
+    {
+        Ptr<RdmaQueuePair> qp = m_grp->Get(i);
+        if (qp->GetBytesLeft() == 0)
+        {
+            continue;
+        }
+        t = Min(qp->m_nextAvail, t);
+        pending++;
+        if (!m_grp->m_pending.count(std::make_pair(qp->m_nextAvail, PeekPointer(qp))))
+        {
+            stale++;
+        }
+    }
+    if (m_grp->GetNextAvail() != t || m_grp->m_pending.size() != pending || stale)
+    {
+        if (m_mismatches++ == 0)
+        {
+            m_firstMismatch = Simulator::Now();
+        }
+    }
+    m_checks++;
+    m_maxQps = std::max(m_maxQps, m_grp->GetN());
+}
+
+void
+RdmaQpGroupTestCase::ChangeRates(uint32_t k)
+{
+    for (uint32_t i = 0; i < m_grp->GetN(); i++)
+    {
+        if (!m_grp->Get(i)->IsFinished())
+        {
+            m_hw->ChangeRate(m_grp->Get(i), DataRate((i + k) % 2 ? "10Gbps" : "25Gbps"));
+            m_rateChanges++;
+        }
+    }
+}
+
+void
+RdmaQpGroupTestCase::AppFinish()
+{
+    m_completed++;
+}
+
+void
+RdmaQpGroupTestCase::RxDrop(Ptr<const Packet> p)
+{
+    m_drops++;
+}
+
+void
+RdmaQpGroupTestCase::DoRun()
+{
+    NodeContainer hosts;
+    hosts.Create(2);
+    InternetStackHelper internet;
+    internet.Install(hosts);
+
+    QbbHelper qbb;
+    qbb.SetDeviceAttribute("DataRate", StringValue("25Gbps"));
+    qbb.SetChannelAttribute("Delay", StringValue("1us"));
+    Ptr<RateErrorModel> rem = CreateObject<RateErrorModel>();
+    rem->SetAttribute("ErrorRate", DoubleValue(0.01));
+    rem->SetAttribute("ErrorUnit", StringValue("ERROR_UNIT_PACKET"));
+    NetDeviceContainer d = qbb.Install(hosts.Get(0), hosts.Get(1));
+    d.Get(1)->SetAttribute("ReceiveErrorModel", PointerValue(rem));
+    d.Get(1)->TraceConnectWithoutContext("PhyRxDrop",
+                                         MakeCallback(&RdmaQpGroupTestCase::RxDrop, this));
+    m_addr[0] = Ipv4Address("11.0.0.1");
+    m_addr[1] = Ipv4Address("11.0.1.1");
+    Ptr<RdmaHw> hw[2];
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        Ptr<Ipv4> ipv4 = hosts.Get(i)->GetObject<Ipv4>();
+        ipv4->AddInterface(d.Get(i));
+        ipv4->AddAddress(1, Ipv4InterfaceAddress(m_addr[i], Ipv4Mask(0xff000000)));
+
+        hw[i] = CreateObject<RdmaHw>();
+        hw[i]->SetAttribute("Mtu", UintegerValue(1000));
+        hw[i]->SetAttribute("L2AckInterval", UintegerValue(1));
+        Ptr<RdmaDriver> rdma = CreateObject<RdmaDriver>();
+        rdma->SetNode(hosts.Get(i));
+        rdma->SetRdmaHw(hw[i]);
+        hosts.Get(i)->AggregateObject(rdma);
+        rdma->Init();
+        hw[i]->AddTableEntry(m_addr[1 - i], d.Get(i)->GetIfIndex());
+    }
+    m_hw = hw[0];
+    m_grp = hw[0]->m_nic[d.Get(0)->GetIfIndex()].qpGrp;
+
+    // 12 flows of 3 priorities, in two waves
+    for (uint32_t f = 0; f < 12; f++)
+    {
+        Time start = MicroSeconds(f < 6 ? 10 + 3 * f : 300 + 7 * f);
+        Simulator::Schedule(start, &RdmaQpGroupTestCase::StartFlow, this, f);
+    }
+    for (uint32_t k = 0; k < 16; k++)
+    {
+        Simulator::Schedule(NanoSeconds(20250 + k * 37000), &RdmaQpGroupTestCase::ChangeRates, this, k);
+    }
+    for (uint64_t t = 0; t < 2000000; t += 100)
+    {
+        Simulator::Schedule(NanoSeconds(t + 7), &RdmaQpGroupTestCase::Check, this);
+    }
+    Simulator::Stop(MilliSeconds(2));
+    Simulator::Run();
+
+    NS_TEST_EXPECT_MSG_EQ(m_mismatches,
+                          0,
+                          "GetNextAvail differs from the scan first at " << m_firstMismatch);
+    NS_TEST_EXPECT_MSG_GT(m_rateChanges, 0, "no rate change");
+    NS_TEST_EXPECT_MSG_GT(m_drops, 0, "no loss");
+    NS_TEST_EXPECT_MSG_EQ(m_completed, 12, "flows completed");
+    NS_TEST_EXPECT_MSG_GT(m_maxQps, 1, "qps sending together");
+    NS_TEST_EXPECT_MSG_EQ(m_grp->GetN(), 0, "finished qps left in the group");
+    NS_TEST_EXPECT_MSG_EQ(m_grp->m_pending.size(), 0, "finished qps left in the index");
+
+    Simulator::Destroy();
+}
+
+/**
+ * \brief TestSuite for RdmaQueuePairGroup
+ */
+class RdmaQpGroupTestSuite : public TestSuite
+{
+  public:
+    RdmaQpGroupTestSuite();
+};
+
+RdmaQpGroupTestSuite::RdmaQpGroupTestSuite()
+    : TestSuite("rdma-qp-group", UNIT)
+{
+    AddTestCase(new RdmaQpGroupTestCase(), TestCase::QUICK);
+}
+
+static RdmaQpGroupTestSuite g_rdmaQpGroupTestSuite; //!< The testsuite
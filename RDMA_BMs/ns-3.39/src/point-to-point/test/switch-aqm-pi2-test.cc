@@ -0,0 +1,252 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/simulator.h"
+#include "ns3/switch-aqm.h"
+#include "ns3/test.h"
+#include "ns3/timestamp-tag.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief Drives the PI2 of a SwitchAqm queue with enqueues and dequeues, and checks p' after
+ * every event against a loop that updates the controller every tupdate with the queue length
+ * of that time.
+ *
+ * The queue is idle for 1 ms, steps to a fixed backlog (enqueues and dequeues alternate), grows
+ * with enqueues only as during a PFC pause, then drains with dequeues only. An update at the
+ * time of an event sees the queue before the event.
+ */
+class SwitchAqmPi2TestCase : public TestCase
+{
+  public:
+    /**
+     * \param markPoint SwitchAqm::MARK_ENQUEUE or MARK_DEQUEUE
+     */
+    SwitchAqmPi2TestCase(uint32_t markPoint);
+
+  private:
+    struct Event
+    {
+        uint64_t time; //!< ns
+        bool enqueue;
+        uint64_t qlen; //!< bytes, after the event
+    };
+
+    void DoRun() override;
+    void Apply(uint32_t i);
+    double Reference(uint64_t now);
+
+    static const uint32_t PORT = 1;
+    static const uint32_t QUEUE = 3;
+    static const uint64_t BW = 10000000000;
+    static const uint64_t TARGET = 15000;
+    static const uint64_t TUPDATE = 16000;
+    static constexpr double ALPHA = 160;
+    static constexpr double BETA = 3200;
+
+    uint32_t m_markPoint;
+    Ptr<SwitchAqm> m_aqm;
+    std::vector<Event> m_events;
+    uint32_t m_checked;
+    double m_maxErr;
+    double m_maxProb;
+
+    // reference controller
+    uint64_t m_refTick;
+    uint32_t m_refEvent; //!< events before m_refTick * TUPDATE
+    double m_refProb;
+    double m_refLastDelay;
+};
+
+SwitchAqmPi2TestCase::SwitchAqmPi2TestCase(uint32_t markPoint)
+    : TestCase("PI2 p' against per-interval updates, mark point " + std::to_string(markPoint)),
+      m_markPoint(markPoint),
+      m_checked(0),
+      m_maxErr(0),
+      m_maxProb(0),
+      m_refTick(0),
+      m_refEvent(0),
+      m_refProb(0),
+      m_refLastDelay(0)
+{
+}
+
+double
+SwitchAqmPi2TestCase::Reference(uint64_t now)
+{
+    // the interval ending at tick * TUPDATE sees the queue left by the events before it
+    for (m_refTick++; m_refTick * TUPDATE <= now; m_refTick++)
+    {
+        uint64_t t = m_refTick * TUPDATE;
+        while (m_refEvent < m_events.size() && m_events[m_refEvent].time < t)
+        {
+            m_refEvent++;
+        }
+        uint64_t qlen = m_refEvent ? m_events[m_refEvent - 1].qlen : 0;
+        double qdelay = qlen * 8e9 / BW;
+        m_refProb += ALPHA * (qdelay - TARGET) * 1e-9 + BETA * (qdelay - m_refLastDelay) * 1e-9;
+        m_refProb = std::min(1.0, std::max(0.0, m_refProb));
+        m_refLastDelay = qdelay;
+    }
+    m_refTick--;
+    return m_refProb;
+}
+
+void
+SwitchAqmPi2TestCase::Apply(uint32_t i)
+{
+    const Event& e = m_events[i];
+    if (e.enqueue)
+    {
+        m_aqm->ShouldMarkEnqueue(PORT, QUEUE, Create<Packet>(1000), e.qlen, BW);
+    }
+    else
+    {
+        m_aqm->ShouldMarkDequeue(PORT, QUEUE, Create<Packet>(1000), e.qlen, BW);
+    }
+    double p = m_aqm->GetPi2Prob(PORT, QUEUE);
+    m_maxErr = std::max(m_maxErr, std::fabs(p - Reference(e.time)));
+    m_maxProb = std::max(m_maxProb, p);
+    m_checked++;
+}
+
+void
+SwitchAqmPi2TestCase::DoRun()
+{
+    m_aqm = CreateObject<SwitchAqm>();
+    m_aqm->SetAqm(PORT, QUEUE, SwitchAqm::AQM_PI2, m_markPoint);
+    m_aqm->ConfigPi2(PORT, TARGET, TUPDATE, ALPHA, BETA);
+
+    uint64_t t = 1000500;
+    for (uint32_t k = 0; k < 400; k++, t += 1250) // fixed backlog of 50us
+    {
+        m_events.push_back({t, k % 2 == 0, k % 2 == 0 ? 62500u : 61250u});
+    }
+    uint64_t qlen = 62500;
+    for (uint32_t k = 0; k < 200; k++, t += 1250) // paused: arrivals only
+    {
+        qlen += 1250;
+        m_events.push_back({t, true, qlen});
+    }
+    while (qlen > 0) // resumed: departures only
+    {
+        qlen -= 1250;
+        m_events.push_back({t, false, qlen});
+        t += 1000;
+    }
+    m_events.push_back({t + 20000000, true, 1250}); // after a long idle period
+    for (uint32_t i = 0; i < m_events.size(); i++)
+    {
+        Simulator::Schedule(NanoSeconds(m_events[i].time), &SwitchAqmPi2TestCase::Apply, this, i);
+    }
+    Simulator::Run();
+    Simulator::Destroy();
+
+    NS_TEST_EXPECT_MSG_EQ(m_checked, m_events.size(), "events applied");
+    NS_TEST_EXPECT_MSG_GT(m_maxProb, 0.1, "the backlog does not raise p'");
+    NS_TEST_EXPECT_MSG_LT(m_maxErr, 1e-9, "p' differs from the per-interval updates");
+    NS_TEST_EXPECT_MSG_EQ(m_aqm->GetPi2Prob(PORT, QUEUE), 0, "p' does not decay while idle");
+}
+
+/**
+ * \brief Dequeues two packets in the reverse of their arrival order, as a PIFO queue does, and
+ * checks that the sojourn AQM marks each by its own queueing delay.
+ *
+ * The first packet waits 17us and the second 1us, against a 10us step.
+ */
+class SwitchAqmSojournTestCase : public TestCase
+{
+  public:
+    SwitchAqmSojournTestCase();
+
+  private:
+    void DoRun() override;
+    void Enqueue(uint32_t i);
+    void Dequeue(uint32_t i);
+
+    static const uint32_t PORT = 1;
+    static const uint32_t QUEUE = 3;
+    static const uint64_t BW = 10000000000;
+
+    Ptr<SwitchAqm> m_aqm;
+    Ptr<Packet> m_pkt[2];
+    bool m_marked[2];
+};
+
+SwitchAqmSojournTestCase::SwitchAqmSojournTestCase()
+    : TestCase("Sojourn marking with packets dequeued out of arrival order")
+{
+}
+
+void
+SwitchAqmSojournTestCase::Enqueue(uint32_t i)
+{
+    bool mark = m_aqm->ShouldMarkEnqueue(PORT, QUEUE, m_pkt[i], 1000 * (i + 1), BW);
+    NS_TEST_EXPECT_MSG_EQ(mark, false, "marked at enqueue " << i);
+}
+
+void
+SwitchAqmSojournTestCase::Dequeue(uint32_t i)
+{
+    m_marked[i] = m_aqm->ShouldMarkDequeue(PORT, QUEUE, m_pkt[i], 1000 * i, BW);
+    TimestampTag ts;
+    NS_TEST_EXPECT_MSG_EQ(m_pkt[i]->PeekPacketTag(ts), false, "timestamp left on packet " << i);
+}
+
+void
+SwitchAqmSojournTestCase::DoRun()
+{
+    m_aqm = CreateObject<SwitchAqm>();
+    m_aqm->SetAqm(PORT, QUEUE, SwitchAqm::AQM_SOJOURN, SwitchAqm::MARK_DEQUEUE);
+    m_aqm->ConfigSojourn(PORT, 10000, 10000, 1);
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        m_pkt[i] = Create<Packet>(1000);
+        m_marked[i] = false;
+    }
+    Simulator::Schedule(MicroSeconds(0), &SwitchAqmSojournTestCase::Enqueue, this, 0);
+    Simulator::Schedule(MicroSeconds(15), &SwitchAqmSojournTestCase::Enqueue, this, 1);
+    Simulator::Schedule(MicroSeconds(16), &SwitchAqmSojournTestCase::Dequeue, this, 1);
+    Simulator::Schedule(MicroSeconds(17), &SwitchAqmSojournTestCase::Dequeue, this, 0);
+    Simulator::Run();
+    Simulator::Destroy();
+
+    NS_TEST_EXPECT_MSG_EQ(m_marked[0], true, "17us in the queue, not marked");
+    NS_TEST_EXPECT_MSG_EQ(m_marked[1], false, "1us in the queue, marked");
+}
+
+/**
+ * \brief TestSuite for the AQMs of SwitchAqm
+ */
+class SwitchAqmTestSuite : public TestSuite
+{
+  public:
+    SwitchAqmTestSuite();
+};
+
+SwitchAqmTestSuite::SwitchAqmTestSuite()
+    : TestSuite("switch-aqm", UNIT)
+{
+    AddTestCase(new SwitchAqmPi2TestCase(SwitchAqm::MARK_DEQUEUE), TestCase::QUICK);
+    AddTestCase(new SwitchAqmPi2TestCase(SwitchAqm::MARK_ENQUEUE), TestCase::QUICK);
+    AddTestCase(new SwitchAqmSojournTestCase(), TestCase::QUICK);
+}
+
+static SwitchAqmTestSuite g_switchAqmTestSuite; //!< The testsuite
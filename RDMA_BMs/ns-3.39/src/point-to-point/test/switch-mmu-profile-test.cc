@@ -0,0 +1,134 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/switch-mmu.h"
+#include "ns3/test.h"
+
+#include <sstream>
+
+using namespace ns3;
+
+namespace
+{
+
+const uint32_t LOSSLESS = 0;
+const uint32_t LOSSY = 1;
+
+/// Two lossy tenants with a pool each on ports 1-2 and 3-4, a lossless pool for pg 3 everywhere
+const char* g_bufferConfig = "# tenants\n"
+                             "pool tenant_a ingress lossy 20000\n"
+                             "pool tenant_b ingress lossy 20000\n"
+                             "pool lossless ingress lossless 40000\n"
+                             "pool egress_b egress lossy 30000\n"
+                             "profile pa tenant_a 0 size=0\n"
+                             "profile pb tenant_b 0 size=0\n"
+                             "profile pll lossless -1 size=2000 xoff=5000\n"
+                             "profile qb egress_b 1\n"
+                             "pg 1-2 1 pa\n"
+                             "pg 3-4 1 pb\n"
+                             "pg 1-2 2 pa\n"
+                             "pg 3-4 2 pb\n"
+                             "pg all 3 pll\n"
+                             "queue 3-4 1 qb\n"
+                             "map 2 1\n";
+
+} // namespace
+
+/**
+ * \brief Applies g_bufferConfig to a sonic SwitchMmu and checks the types, the queue map, the
+ * profile values, and that a lossy queue filling its pool leaves the pool of the other tenant
+ * alone.
+ */
+class SwitchMmuProfileTestCase : public TestCase
+{
+  public:
+    SwitchMmuProfileTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+SwitchMmuProfileTestCase::SwitchMmuProfileTestCase()
+    : TestCase("SwitchMmu buffer pools and profiles")
+{
+}
+
+void
+SwitchMmuProfileTestCase::DoRun()
+{
+    SwitchBufferConfig cfg;
+    std::istringstream is(g_bufferConfig);
+    cfg.Load(is);
+    NS_TEST_ASSERT_MSG_EQ(cfg.pools.size(), 4, "pools");
+    NS_TEST_ASSERT_MSG_EQ(cfg.profiles.size(), 4, "profiles");
+    NS_TEST_ASSERT_MSG_EQ(cfg.bindings.size(), 6, "bindings");
+
+    Ptr<SwitchMmu> mmu = CreateObject<SwitchMmu>();
+    mmu->SetBufferModel("sonic");
+    mmu->SetPortCount(4);
+    mmu->ApplyBufferConfig(cfg);
+
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetType(1, 3, true), LOSSLESS, "the pool decides, not the tag");
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetType(4, 1, false), LOSSY, "the pool decides, not the tag");
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetType(1, 5, false), LOSSLESS, "no profile: untagged is lossless");
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetType(1, 5, true), LOSSY, "no profile: tagged is lossy");
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetType(5, 1, false), LOSSLESS, "port 5 is beyond the port count");
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetQueue(2), 1, "map 2 1");
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetQueue(5), 5, "identity");
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetEgressPool(3, 1, LOSSY), 2, "first pool after lossless and lossy");
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetEgressPool(1, 1, LOSSY), LOSSY, "no egress profile");
+    NS_TEST_EXPECT_MSG_EQ(mmu->egressPool[2], 30000, "egress pool size");
+    NS_TEST_EXPECT_MSG_EQ_TOL(mmu->alphaIngress[2][3], 0.5, 1e-9, "2^-1");
+    NS_TEST_EXPECT_MSG_EQ_TOL(mmu->alphaEgress[4][1], 2, 1e-9, "2^1");
+    NS_TEST_EXPECT_MSG_EQ(mmu->reserveIngress[4][3], 2000, "size");
+    NS_TEST_EXPECT_MSG_EQ(mmu->xoff[4][3], 5000, "xoff");
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetIngressSharedFree(1, 3), 40000 - 4 * 2000, "reserved out of its pool");
+
+    // port 1 fills pool tenant_a up to its DT threshold (alpha 1: half of the pool)
+    uint32_t admitted = 0;
+    while (admitted < 100 && mmu->CheckIngressAdmission(1, 1, 1000, LOSSY, 0))
+    {
+        mmu->UpdateIngressAdmission(1, 1, 1000, LOSSY, 0);
+        admitted++;
+    }
+    NS_TEST_EXPECT_MSG_EQ(admitted, 10, "DT in a 20000 bytes pool");
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetIngressSharedFree(2, 1), 10000, "same tenant");
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetIngressSharedFree(3, 1), 20000, "other tenant");
+    NS_TEST_EXPECT_MSG_EQ(mmu->CheckIngressAdmission(3, 1, 1000, LOSSY, 0), true, "other tenant");
+
+    for (uint32_t i = 0; i < admitted; i++)
+    {
+        mmu->RemoveFromIngressAdmission(1, 1, 1000, LOSSY);
+    }
+    NS_TEST_EXPECT_MSG_EQ(mmu->totalUsed, 0, "drained");
+    NS_TEST_EXPECT_MSG_EQ(mmu->GetIngressSharedFree(2, 1), 20000, "drained");
+}
+
+/**
+ * \brief TestSuite for the buffer profiles of SwitchMmu
+ */
+class SwitchMmuProfileTestSuite : public TestSuite
+{
+  public:
+    SwitchMmuProfileTestSuite();
+};
+
+SwitchMmuProfileTestSuite::SwitchMmuProfileTestSuite()
+    : TestSuite("switch-mmu-profile", UNIT)
+{
+    AddTestCase(new SwitchMmuProfileTestCase(), TestCase::QUICK);
+}
+
+static SwitchMmuProfileTestSuite g_switchMmuProfileTestSuite; //!< The testsuite
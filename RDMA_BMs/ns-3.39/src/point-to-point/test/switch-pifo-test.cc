@@ -0,0 +1,238 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/broadcom-egress-queue.h"
+#include "ns3/custom-header.h"
+#include "ns3/custom-priority-tag.h"
+#include "ns3/enum.h"
+#include "ns3/interface-tag.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/pause-header.h"
+#include "ns3/ppp-header.h"
+#include "ns3/qbb-channel.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/rank-tag.h"
+#include "ns3/seq-ts-header.h"
+#include "ns3/simulator.h"
+#include "ns3/switch-node.h"
+#include "ns3/test.h"
+#include "ns3/udp-header.h"
+
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \brief A switch port with SRPT PIFO queues, paused by PFC on queue 1.
+ *
+ * Six lossy packets arrive for the paused queue 1, whose egress share holds four: the last two
+ * are dropped at admission, although one of them has the smallest rank. A packet of queue 2 is
+ * still admitted and sent while queue 1 is paused. On resume, queue 1 sends its four packets by
+ * remaining size, equal sizes in arrival order, and the MMU counters go back to 0.
+ */
+class SwitchPifoTestCase : public TestCase
+{
+  public:
+    SwitchPifoTestCase();
+
+  private:
+    void DoRun() override;
+    static Ptr<Packet> MakeData(uint32_t flow, uint64_t remaining, uint32_t qIndex);
+    void Send(uint32_t flow, uint64_t remaining, uint32_t qIndex);
+    void Pfc(uint32_t qIndex, bool pause);
+    int Receive(Ptr<Packet> p, CustomHeader& ch);
+    void Enqueue(Ptr<const Packet> p, uint32_t qIndex);
+    void CheckPaused();
+
+    static const uint32_t IN = 0;  //!< ingress port of the switch
+    static const uint32_t OUT = 1; //!< egress port of the switch
+
+    Ptr<SwitchNode> m_switch;
+    Ptr<QbbNetDevice> m_in;
+    Ptr<QbbNetDevice> m_out;
+    uint32_t m_size;                //!< size of a data packet
+    uint32_t m_sent;                //!< data packets sent to the switch
+    uint32_t m_enqueued;            //!< data packets admitted to the egress queues
+    std::vector<uint32_t> m_flows;  //!< flows received, in order
+};
+
+SwitchPifoTestCase::SwitchPifoTestCase()
+    : TestCase("PIFO egress queue behind PFC and the MMU admission"),
+      m_size(0),
+      m_sent(0),
+      m_enqueued(0)
+{
+}
+
+Ptr<Packet>
+SwitchPifoTestCase::MakeData(uint32_t flow, uint64_t remaining, uint32_t qIndex)
+{
+    Ptr<Packet> p = Create<Packet>(1000);
+    SeqTsHeader seqTs;
+    seqTs.SetSeq(0);
+    seqTs.SetPG(qIndex);
+    p->AddHeader(seqTs);
+    UdpHeader udp;
+    udp.SetDestinationPort(100);
+    udp.SetSourcePort(flow);
+    p->AddHeader(udp);
+    Ipv4Header ip;
+    ip.SetSource(Ipv4Address("11.0.0.1"));
+    ip.SetDestination(Ipv4Address("11.0.1.1"));
+    ip.SetProtocol(0x11);
+    ip.SetPayloadSize(p->GetSize());
+    ip.SetTtl(64);
+    p->AddHeader(ip);
+    PppHeader ppp;
+    ppp.SetProtocol(0x0021);
+    p->AddHeader(ppp);
+    p->AddPacketTag(RankTag(flow, remaining, 0));
+    // lossy, so that the MMU drops instead of pausing the ingress port
+    MyPriorityTag prio;
+    prio.SetPriority(qIndex);
+    p->AddPacketTag(prio);
+    return p;
+}
+
+void
+SwitchPifoTestCase::Send(uint32_t flow, uint64_t remaining, uint32_t qIndex)
+{
+    Ptr<Packet> p = MakeData(flow, remaining, qIndex);
+    p->AddPacketTag(InterfaceTag(IN));
+    CustomHeader ch(CustomHeader::L2_Header | CustomHeader::L3_Header | CustomHeader::L4_Header);
+    p->PeekHeader(ch);
+    m_sent++;
+    m_switch->SwitchReceiveFromDevice(m_in, p, ch);
+}
+
+void
+SwitchPifoTestCase::Pfc(uint32_t qIndex, bool pause)
+{
+    Ptr<Packet> p = Create<Packet>(0);
+    p->AddHeader(PauseHeader(pause ? 0xffff : 0, 0, qIndex));
+    Ipv4Header ip;
+    ip.SetProtocol(0xFE);
+    ip.SetPayloadSize(p->GetSize());
+    p->AddHeader(ip);
+    PppHeader ppp;
+    ppp.SetProtocol(0x0021);
+    p->AddHeader(ppp);
+    m_out->Receive(p);
+}
+
+int
+SwitchPifoTestCase::Receive(Ptr<Packet> p, CustomHeader& ch)
+{
+    RankTag tag;
+    NS_TEST_EXPECT_MSG_EQ(p->PeekPacketTag(tag), true, "RankTag of a received packet");
+    m_flows.push_back(tag.GetFlow());
+    return 0;
+}
+
+void
+SwitchPifoTestCase::Enqueue(Ptr<const Packet> p, uint32_t qIndex)
+{
+    m_enqueued++;
+}
+
+void
+SwitchPifoTestCase::CheckPaused()
+{
+    NS_TEST_EXPECT_MSG_EQ(m_sent, 7, "packets sent");
+    NS_TEST_EXPECT_MSG_EQ(m_enqueued, 5, "packets admitted");
+    NS_TEST_ASSERT_MSG_EQ(m_flows.size(), 1, "only queue 2 sends while queue 1 is paused");
+    NS_TEST_EXPECT_MSG_EQ(m_flows[0], 20, "flow of queue 2");
+    NS_TEST_EXPECT_MSG_EQ(m_out->GetQueue()->GetNBytes(1), 4 * m_size, "bytes in queue 1");
+    NS_TEST_EXPECT_MSG_EQ(m_switch->m_mmu->egress_bytes[OUT][1], 4 * m_size, "MMU egress bytes");
+    NS_TEST_EXPECT_MSG_EQ(m_switch->m_mmu->totalUsed, 4 * m_size, "MMU bytes used");
+}
+
+void
+SwitchPifoTestCase::DoRun()
+{
+    m_switch = CreateObject<SwitchNode>();
+    m_in = CreateObject<QbbNetDevice>();
+    m_out = CreateObject<QbbNetDevice>();
+    m_out->SetDataRate(DataRate("10Gbps"));
+    Ptr<BEgressQueue> queue = CreateObject<BEgressQueue>();
+    queue->SetAttribute("PifoRank", EnumValue(PifoQueue::RANK_SRPT));
+    m_out->SetQueue(queue);
+    m_switch->AddDevice(m_in);
+    m_switch->AddDevice(m_out);
+    Ipv4Address dst("11.0.1.1");
+    m_switch->AddTableEntry(dst, OUT);
+
+    Ptr<Node> host = CreateObject<Node>();
+    Ptr<QbbNetDevice> rx = CreateObject<QbbNetDevice>();
+    host->AddDevice(rx);
+    rx->m_rdmaReceiveCb = MakeCallback(&SwitchPifoTestCase::Receive, this);
+    Ptr<QbbChannel> channel = CreateObject<QbbChannel>();
+    m_out->Attach(channel);
+    rx->Attach(channel);
+    m_out->TraceConnectWithoutContext("QbbEnqueue",
+                                      MakeCallback(&SwitchPifoTestCase::Enqueue, this));
+
+    // the egress lossy pool holds 8 packets and each queue takes at most the free part (alpha
+    // 1), so queue 1 gets 4 packets
+    m_size = MakeData(0, 0, 1)->GetSize();
+    m_switch->m_mmu->SetPortCount(2);
+    m_switch->m_mmu->SetEgressLossyPool(8 * m_size);
+
+    Simulator::Schedule(MicroSeconds(0), &SwitchPifoTestCase::Pfc, this, 1, true);
+    uint32_t flows[] = {1, 2, 3, 4, 5, 6};
+    uint64_t remaining[] = {4000, 2000, 3000, 2000, 500, 1000};
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        Simulator::Schedule(MicroSeconds(1),
+                            &SwitchPifoTestCase::Send,
+                            this,
+                            flows[i],
+                            remaining[i],
+                            1);
+    }
+    Simulator::Schedule(MicroSeconds(2), &SwitchPifoTestCase::Send, this, 20, 100000, 2);
+    Simulator::Schedule(MicroSeconds(5), &SwitchPifoTestCase::CheckPaused, this);
+    Simulator::Schedule(MicroSeconds(6), &SwitchPifoTestCase::Pfc, this, 1, false);
+    Simulator::Stop(MicroSeconds(20));
+    Simulator::Run();
+
+    std::vector<uint32_t> expected = {20, 2, 4, 3, 1};
+    NS_TEST_ASSERT_MSG_EQ(m_flows.size(), expected.size(), "packets received");
+    for (uint32_t i = 0; i < expected.size(); i++)
+    {
+        NS_TEST_EXPECT_MSG_EQ(m_flows[i], expected[i], "flow of packet " << i);
+    }
+    NS_TEST_EXPECT_MSG_EQ(m_out->GetQueue()->GetNBytesTotal(), 0, "egress queue empty");
+    NS_TEST_EXPECT_MSG_EQ(m_switch->m_mmu->egress_bytes[OUT][1], 0, "MMU egress bytes");
+    NS_TEST_EXPECT_MSG_EQ(m_switch->m_mmu->totalUsed, 0, "MMU bytes used");
+    Simulator::Destroy();
+}
+
+/**
+ * \brief TestSuite for the PIFO egress queues of the switch
+ */
+class SwitchPifoTestSuite : public TestSuite
+{
+  public:
+    SwitchPifoTestSuite();
+};
+
+SwitchPifoTestSuite::SwitchPifoTestSuite()
+    : TestSuite("switch-pifo", UNIT)
+{
+    AddTestCase(new SwitchPifoTestCase(), TestCase::QUICK);
+}
+
+static SwitchPifoTestSuite g_switchPifoTestSuite; //!< The testsuite
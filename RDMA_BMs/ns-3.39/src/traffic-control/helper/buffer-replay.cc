@@ -0,0 +1,323 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "buffer-replay.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "ns3/abort.h"
+#include "ns3/custom-priority-tag.h"
+#include "ns3/fifo-queue-disc.h"
+#include "ns3/flow-id-tag.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/unsched-tag.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("BufferReplay");
+
+namespace {
+
+/// A replayed packet; there are no headers to add or mark
+class ReplayItem : public QueueDiscItem
+{
+public:
+  ReplayItem (Ptr<Packet> p)
+    : QueueDiscItem (p, Address (), 0)
+  {
+  }
+  void AddHeader () override
+  {
+  }
+  bool Mark () override
+  {
+    return false;
+  }
+};
+
+void
+CountDrop (BufferReplay::Stats *stats, uint32_t nPrior, Ptr<const QueueDiscItem> item)
+{
+  uint32_t p = 0;
+  MyPriorityTag tag;
+  if (item->GetPacket ()->PeekPacketTag (tag))
+    {
+      p = std::min<uint32_t> (tag.GetPriority (), nPrior - 1);
+    }
+  stats->drops++;
+  stats->dropBytes += item->GetSize ();
+  stats->queueDrops[p]++;
+}
+
+void
+RecordArrival (Ptr<OutputStreamWrapper> stream, Ptr<const Packet> packet, uint32_t queue, Ptr<GenQueueDisc> q)
+{
+  FlowIdTag flowTag;
+  UnSchedTag unschedTag;
+  uint32_t flowId = packet->PeekPacketTag (flowTag) ? flowTag.GetFlowId () : 0;
+  uint32_t unsched = packet->PeekPacketTag (unschedTag) ? unschedTag.GetValue () : 0;
+  *stream->GetStream () << Simulator::Now ().GetNanoSeconds () << " " << q->getPortId () << " " << queue
+                        << " " << packet->GetSize () << " " << q->getPortBw () << " " << flowId << " "
+                        << unsched << "\n";
+}
+
+} // namespace
+
+BufferReplay::BufferReplay ()
+  : m_bufferSize (1000 * 1000),
+    m_nPrior (2),
+    m_averageInterval (MicroSeconds (10))
+{
+}
+
+void
+BufferReplay::SetBufferSize (uint32_t bytes)
+{
+  m_bufferSize = bytes;
+}
+
+void
+BufferReplay::SetNPrior (uint32_t nPrior)
+{
+  NS_ABORT_MSG_IF (nPrior == 0 || nPrior > 8, "BufferReplay supports 1 to 8 queues per port");
+  m_nPrior = nPrior;
+}
+
+void
+BufferReplay::SetAverageInterval (Time interval)
+{
+  m_averageInterval = interval;
+}
+
+void
+BufferReplay::AddPolicy (std::string name, uint32_t algorithm, Callback<void, Ptr<GenQueueDisc> > configure)
+{
+  Policy policy;
+  policy.name = name;
+  policy.algorithm = algorithm;
+  policy.configure = configure;
+  m_policies.push_back (policy);
+}
+
+void
+BufferReplay::Load (std::istream &is)
+{
+  std::string line;
+  while (std::getline (is, line))
+    {
+      if (line.empty () || line[0] == '#')
+        {
+          continue;
+        }
+      std::istringstream iss (line);
+      Arrival a;
+      a.flowId = 0;
+      a.unsched = 0;
+      iss >> a.time >> a.port >> a.queue >> a.size >> a.rate;
+      NS_ABORT_MSG_IF (iss.fail (), "Bad trace line: " << line);
+      iss >> a.flowId >> a.unsched;
+      AddArrival (a);
+    }
+}
+
+void
+BufferReplay::AddArrival (const Arrival &a)
+{
+  NS_ABORT_MSG_IF (!m_arrivals.empty () && a.time < m_arrivals.back ().time, "Trace arrivals out of time order");
+  NS_ABORT_MSG_IF (a.rate <= 0, "Port " << a.port << " has no drain rate");
+  if (a.port >= m_rates.size ())
+    {
+      m_rates.resize (a.port + 1, 0);
+    }
+  if (m_rates[a.port] == 0)
+    {
+      m_rates[a.port] = a.rate;
+    }
+  m_arrivals.push_back (a);
+}
+
+void
+BufferReplay::Setup (Policy &policy)
+{
+  uint32_t nPorts = m_rates.size ();
+  policy.sm = CreateObject<SharedMemoryBuffer> ();
+  policy.sm->SetAttribute ("BufferSize", UintegerValue (m_bufferSize));
+  policy.sm->Initialize ();
+  policy.sm->SetSharedBufferSize (m_bufferSize);
+  policy.sm->setQueues (m_nPrior);
+  policy.sm->setAverageInteral (m_averageInterval);
+  policy.sm->setPorts (nPorts);
+
+  policy.stats.queueDrops.assign (m_nPrior, 0);
+  policy.ports.resize (nPorts);
+  for (uint32_t i = 0; i < nPorts; i++)
+    {
+      Ptr<GenQueueDisc> q = CreateObject<GenQueueDisc> ();
+      for (uint32_t n = 0; n < m_nPrior; n++)
+        {
+          Ptr<FifoQueueDisc> fifo = CreateObject<FifoQueueDisc> ();
+          fifo->SetMaxSize (QueueSize ("100MB")); // the buffer management does the limiting
+          Ptr<QueueDiscClass> c = CreateObject<QueueDiscClass> ();
+          c->SetQueueDisc (fifo);
+          q->AddQueueDiscClass (c);
+        }
+      q->SetAttribute ("nPrior", UintegerValue (m_nPrior));
+      q->setNPrior (m_nPrior); // IMPORTANT. This will also trigger "alphas = new ..."
+      for (uint32_t n = 0; n < m_nPrior; n++)
+        {
+          q->alphas[n] = 1;
+        }
+      q->setPortBw (m_rates[i]);
+      q->SetSharedMemory (policy.sm);
+      q->SetBufferAlgorithm (policy.algorithm);
+      q->SetPortId (i);
+      if (!policy.configure.IsNull ())
+        {
+          policy.configure (q);
+        }
+      q->Initialize ();
+      q->TraceConnectWithoutContext ("Drop", MakeBoundCallback (&CountDrop, &policy.stats, m_nPrior));
+      policy.sm->addQueuePtr (q, i);
+      policy.ports[i].qdisc = q;
+      policy.ports[i].rate = m_rates[i];
+    }
+}
+
+void
+BufferReplay::Run ()
+{
+  NS_ABORT_MSG_IF (m_policies.empty (), "No policy to replay");
+  if (m_arrivals.empty ())
+    {
+      return;
+    }
+  // m_policies does not change from here on; the drop traces keep pointers into it
+  for (Policy &policy : m_policies)
+    {
+      Setup (policy);
+    }
+  uint64_t start = Simulator::Now ().GetNanoSeconds ();
+  uint64_t first = m_arrivals.front ().time;
+  for (uint32_t i = 0; i < m_arrivals.size (); i++)
+    {
+      Simulator::Schedule (NanoSeconds (m_arrivals[i].time - first), &BufferReplay::Arrive, this, i);
+    }
+  // ABM keeps rescheduling its updates; stop once every buffer could have drained
+  double minRate = *std::min_element (m_rates.begin (), m_rates.end (), [] (double a, double b) {
+    return (a > 0 ? a : 1e18) < (b > 0 ? b : 1e18);
+  });
+  uint64_t drain = uint64_t (8.0 * m_bufferSize / minRate) + 1;
+  uint64_t end = m_arrivals.back ().time - first + drain;
+  Simulator::Stop (NanoSeconds (end));
+  Simulator::Run ();
+
+  for (Policy &policy : m_policies)
+    {
+      UpdateOccupancy (policy);
+      uint64_t duration = Simulator::Now ().GetNanoSeconds () - start;
+      policy.stats.avgOccupancy = duration ? policy.occupancyArea / duration : 0;
+    }
+}
+
+void
+BufferReplay::UpdateOccupancy (Policy &policy)
+{
+  uint64_t now = Simulator::Now ().GetNanoSeconds ();
+  uint32_t occupied = policy.sm->GetOccupiedBuffer ();
+  policy.occupancyArea += double (occupied) * (now - policy.lastChange);
+  policy.lastChange = now;
+  policy.stats.maxOccupancy = std::max (policy.stats.maxOccupancy, occupied);
+}
+
+void
+BufferReplay::Arrive (uint32_t index)
+{
+  const Arrival &a = m_arrivals[index];
+  for (Policy &policy : m_policies)
+    {
+      Ptr<Packet> packet = Create<Packet> (a.size);
+      MyPriorityTag priorityTag;
+      priorityTag.SetPriority (a.queue);
+      packet->AddPacketTag (priorityTag);
+      if (a.flowId)
+        {
+          packet->AddPacketTag (FlowIdTag (a.flowId));
+        }
+      if (a.unsched)
+        {
+          UnSchedTag unschedTag;
+          unschedTag.SetValue (a.unsched);
+          packet->AddPacketTag (unschedTag);
+        }
+      UpdateOccupancy (policy);
+      policy.stats.arrivals++;
+      policy.stats.arrivalBytes += a.size;
+      policy.ports[a.port].qdisc->Enqueue (Create<ReplayItem> (packet));
+      UpdateOccupancy (policy);
+      if (!policy.ports[a.port].busy)
+        {
+          StartTx (&policy, a.port);
+        }
+    }
+}
+
+// Dequeues the next packet of the port and schedules the end of its transmission at the port
+// rate, as the device does with the queue disc
+void
+BufferReplay::StartTx (Policy *policy, uint32_t port)
+{
+  Port &p = policy->ports[port];
+  UpdateOccupancy (*policy);
+  Ptr<QueueDiscItem> item = p.qdisc->Dequeue ();
+  UpdateOccupancy (*policy);
+  if (!item)
+    {
+      p.busy = false;
+      return;
+    }
+  p.busy = true;
+  policy->stats.departures++;
+  Simulator::Schedule (NanoSeconds (uint64_t (8.0 * item->GetSize () / p.rate)), &BufferReplay::StartTx, this,
+                       policy, port);
+}
+
+void
+BufferReplay::Print (std::ostream &os) const
+{
+  os << "policy arrivals drops dropRate dropBytes departures maxOccupancy avgOccupancy queueDrops" << std::endl;
+  for (const Policy &policy : m_policies)
+    {
+      const Stats &s = policy.stats;
+      os << policy.name << " " << s.arrivals << " " << s.drops << " "
+         << (s.arrivals ? double (s.drops) / s.arrivals : 0) << " " << s.dropBytes << " " << s.departures << " "
+         << s.maxOccupancy << " " << s.avgOccupancy;
+      for (uint64_t d : s.queueDrops)
+        {
+          os << " " << d;
+        }
+      os << std::endl;
+    }
+}
+
+void
+BufferReplay::Record (Ptr<GenQueueDisc> q, Ptr<OutputStreamWrapper> stream)
+{
+  q->TraceConnectWithoutContext ("genArrival", MakeBoundCallback (&RecordArrival, stream));
+}
+
+} // namespace ns3
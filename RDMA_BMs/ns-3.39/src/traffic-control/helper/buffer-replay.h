@@ -0,0 +1,145 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef BUFFER_REPLAY_H
+#define BUFFER_REPLAY_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ns3/callback.h"
+#include "ns3/gen-queue-disc.h"
+#include "ns3/nstime.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/shared-memory.h"
+
+namespace ns3 {
+
+/**
+ * \brief Replays the packet arrivals recorded at one shared buffer switch through several
+ * buffer management policies at once.
+ *
+ * Each policy gets its own SharedMemoryBuffer and one GenQueueDisc per port, with nPrior
+ * FifoQueueDisc classes, exactly as the ABM and Credence examples set them up; admission is
+ * GenQueueDisc::AcceptPacket, so DT, ABM, FAB, CS, IB, LQD and Credence run their own code.
+ * Every arrival of the trace is offered to all the policies at its recorded time, and each
+ * port of each policy drains its queue disc at the recorded port rate. There is no feedback:
+ * the arrivals do not depend on the drops, so the results are first order buffer occupancy
+ * and drop statistics of the policies under the same arrival process.
+ *
+ * A trace has one arrival per line: "time(ns) port queue size(bytes) rate(Gbps)", optionally
+ * followed by the flow id and the unscheduled flag that FAB, IB and ABM look at. Lines
+ * starting with # are ignored. Record writes such a trace from the genArrival trace source
+ * of the queue discs of a switch in a full simulation.
+ */
+class BufferReplay
+{
+public:
+  struct Arrival
+  {
+    uint64_t time; //!< ns
+    uint32_t port;
+    uint32_t queue;
+    uint32_t size;
+    double rate; //!< Gbps, drain rate of the port
+    uint32_t flowId;
+    uint32_t unsched;
+  };
+
+  struct Stats
+  {
+    uint64_t arrivals = 0;
+    uint64_t arrivalBytes = 0;
+    uint64_t drops = 0; //!< dropped before enqueue or pushed out
+    uint64_t dropBytes = 0;
+    uint64_t departures = 0;
+    uint32_t maxOccupancy = 0; //!< shared buffer bytes
+    double avgOccupancy = 0; //!< time average of the shared buffer bytes over the trace
+    std::vector<uint64_t> queueDrops; //!< drops per queue
+  };
+
+  BufferReplay ();
+
+  /// Shared buffer size of every policy (default 1MB)
+  void SetBufferSize (uint32_t bytes);
+  /// Queues per port; queue ids of the trace beyond it go to the last queue (default 2)
+  void SetNPrior (uint32_t nPrior);
+  /// EWMA interval of the queue lengths in the SharedMemoryBuffer (default 10us)
+  void SetAverageInterval (Time interval);
+
+  /**
+   * Adds a policy. configure is called on every GenQueueDisc of the policy after its classes,
+   * priorities, port rate and shared buffer are set up, to set the alphas and the parameters
+   * of the algorithm (as the examples do right after SetBufferAlgorithm).
+   */
+  void AddPolicy (std::string name, uint32_t algorithm, Callback<void, Ptr<GenQueueDisc> > configure);
+
+  /// Reads a trace; arrivals have to be in time order
+  void Load (std::istream &is);
+  void AddArrival (const Arrival &a);
+
+  /// Replays the trace through all the policies, until the buffers drained
+  void Run ();
+
+  uint32_t GetNPolicies () const { return m_policies.size (); }
+  const std::string &GetName (uint32_t policy) const { return m_policies[policy].name; }
+  const Stats &GetStats (uint32_t policy) const { return m_policies[policy].stats; }
+  /// Drain rate of each port in Gbps, from the first arrival at the port (0 for a port without arrivals)
+  const std::vector<double> &GetRates () const { return m_rates; }
+  /// One line per policy
+  void Print (std::ostream &os) const;
+
+  /// Writes the arrivals at q to stream in the trace format
+  static void Record (Ptr<GenQueueDisc> q, Ptr<OutputStreamWrapper> stream);
+
+private:
+  struct Port
+  {
+    Ptr<GenQueueDisc> qdisc;
+    double rate = 0; //!< Gbps
+    bool busy = false;
+  };
+
+  struct Policy
+  {
+    std::string name;
+    uint32_t algorithm;
+    Callback<void, Ptr<GenQueueDisc> > configure;
+    Ptr<SharedMemoryBuffer> sm;
+    std::vector<Port> ports;
+    Stats stats;
+    uint64_t lastChange = 0; //!< ns, of the occupancy
+    double occupancyArea = 0; //!< byte ns
+  };
+
+  void Setup (Policy &policy);
+  void Arrive (uint32_t index);
+  void StartTx (Policy *policy, uint32_t port);
+  void UpdateOccupancy (Policy &policy);
+
+  uint32_t m_bufferSize;
+  uint32_t m_nPrior;
+  Time m_averageInterval;
+  std::vector<Policy> m_policies;
+  std::vector<Arrival> m_arrivals;
+  std::vector<double> m_rates; //!< by port
+};
+
+} // namespace ns3
+
+#endif /* BUFFER_REPLAY_H */
@@ -36,6 +36,7 @@
 #include "ns3/unsched-tag.h"
 #include "ns3/feedback-tag.h"
 #include "ns3/bufferlog-tag.h"
+#include "ns3/string.h"
 
 # define DT 101
 # define FAB 102
@@ -104,6 +105,14 @@ TypeId GenQueueDisc::GetTypeId (void)
                                      UintegerValue (0),
                                      MakeUintegerAccessor (&GenQueueDisc::strict_priority),
                                      MakeUintegerChecker<uint32_t> ())
+                      .AddAttribute ("PriorityClasses", "with round robin, number of leading classes served in strict priority before the others",
+                                     UintegerValue (0),
+                                     MakeUintegerAccessor (&GenQueueDisc::priorityClasses),
+                                     MakeUintegerChecker<uint32_t> ())
+                      .AddAttribute ("Quanta", "DRR quanta in bytes per class, comma separated. Classes not listed or with a 0 quantum send one packet per turn (round robin)",
+                                     StringValue (""),
+                                     MakeStringAccessor (&GenQueueDisc::quanta),
+                                     MakeStringChecker ())
                       .AddAttribute ("predict", "whether to use predictions or not in Credence buffer sharing",
                                      BooleanValue (false),
                                      MakeBooleanAccessor (&GenQueueDisc::enablePredictions),
@@ -111,6 +120,9 @@ TypeId GenQueueDisc::GetTypeId (void)
                       .AddTraceSource ("genEnqueue", "trace enqueue events",
                                        MakeTraceSourceAccessor (&GenQueueDisc::m_rxTrace),
                                        "ns3::Packet::TracedCallback")
+                      .AddTraceSource ("genArrival", "trace every arrival, including the ones into the static reserve",
+                                       MakeTraceSourceAccessor (&GenQueueDisc::m_arrivalTrace),
+                                       "ns3::Packet::TracedCallback")
                       .AddTraceSource ("genDequeue", "trace dequeue events",
                                        MakeTraceSourceAccessor (&GenQueueDisc::m_txTrace),
                                        "ns3::Packet::TracedCallback")
@@ -219,6 +231,13 @@ GenQueueDisc::UpdateDequeueRate(double nanodelay) { // delay in NANOSECONDS. Pay
   //     DeqRate[p]=1;
   //   }
   // }
+  int32_t skipped = 0;
+  for (uint32_t p = 0; p <= GetNQueueDiscClasses(); p++) {
+    skipped += skipDiff[p];
+    skipDiff[p] = 0;
+    if (p < GetNQueueDiscClasses())
+      Deq[p] += 1472 * skipped;
+  }
   for (uint32_t p = 0; p < nPrior; p++) {
     double th = 8 * Deq[p] / nanodelay / portBW; // portBW should be in Gbps
     if (th < 1.0 / double(nPrior) || th > 1) {
@@ -596,6 +615,7 @@ GenQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
 
   if (p >= nPrior)
     p = uint32_t(nPrior - 1);
+  m_arrivalTrace(packet, p, this);
 
   /* Arrival Statistics*/
   numBytesSent[p] += item->GetSize();
@@ -607,6 +627,8 @@ GenQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
   /*Check if we can use the reserved space*/
   if (GetCurrentSize().GetValue() + item->GetSize() < staticBuffer) {
     bool ret = GetQueueDiscClass (p)->GetQueueDisc ()->Enqueue (item);
+    if (ret)
+      sched.SetBacklogged(p);
 
     if (firstSeen[p] == Seconds(0)) {
       firstSeen[p] = Simulator::Now();
@@ -671,6 +693,7 @@ GenQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
     NS_LOG_WARN ("Packet enqueue failed. Check the size of the internal queues");
   }
   else {
+    sched.SetBacklogged(p);
     if (firstSeen[p] == Seconds(0)) {
       firstSeen[p] = Simulator::Now();
     }
@@ -704,42 +727,26 @@ GenQueueDisc::DoDequeue (void)
 
   Ptr<QueueDiscItem> item;
 
-  if (round_robin) {
-  /* Round robin scheduling */
-    for (uint32_t i = 0; i < GetNQueueDiscClasses(); i++)
-    {
-      if ((item = GetQueueDiscClass (dequeueIndex)->GetQueueDisc ()->Dequeue ()) != 0)
-      {
-        // return item;
-        break;
-      }
-      Deq[dequeueIndex] += 1472;
+  if (schedDirty)
+    ConfigureScheduler();
 
-      dequeueIndex++;
-      if (dequeueIndex >= GetNQueueDiscClasses())
-        dequeueIndex = 0;
+  int32_t c;
+  while ((c = sched.Select()) >= 0) {
+    Ptr<QueueDisc> qd = GetQueueDiscClass (c)->GetQueueDisc ();
+    if ((item = qd->Dequeue ()) != 0) {
+      sched.Served(c, item->GetSize(), qd->GetNPackets() == 0);
+      break;
     }
+    sched.SetEmpty(c);
   }
-  else {
-    /*Strict priority scheduling*/
-    for (uint32_t i = 0; i < GetNQueueDiscClasses(); i++)
-    {
-      if ((item = GetQueueDiscClass (i)->GetQueueDisc ()->Dequeue ()) != 0)
-      {
-        // return item;
-        dequeueIndex = i;
-        break;
-      }
-      Deq[i] += 1472;
-    }
-  }
-
+  CountSkipped(c);
   // NS_LOG_LOGIC ("Queue empty"); // We break out of loop instead of returning. So it doesn't mean that the queue is empty if we arrive here.
   if (item) {
 
     Ptr<Packet> packet = item->GetPacket();
     
-    m_txTrace(packet, dequeueIndex, this); // trace dequeue event from dequeueIndex queue
+    uint32_t p = c;
+    m_txTrace(packet, p, this); // trace dequeue event from p queue
     if (bufferalg == LQD){
       uint32_t arr[4]={0,0,0,0};
       BufferLogTag buffertag;
@@ -754,8 +761,6 @@ GenQueueDisc::DoDequeue (void)
       bool gone = packet->RemovePacketTag (buffertag);
     }
 
-    uint32_t p = dequeueIndex;
-
     numBytesSentQueue[p] += item->GetSize();
 
     // 10 is used for aggregate. Assuming that the actual number of queues are less than 10.
@@ -800,10 +805,6 @@ GenQueueDisc::DoDequeue (void)
       m_departure(item->GetPacket()->GetSize(), numPackets_big, numPackets_small, unsched, Simulator::Now().GetNanoSeconds(), Simulator::Now().GetSeconds(), sharedMemory->GetQueueSize(portId, p), 2, portId, p);
     }
 
-    dequeueIndex++; // This increment is for the round-robin case.
-    if (dequeueIndex >= GetNQueueDiscClasses())
-      dequeueIndex = 0;
-
   }
   // if (round_robin){
   //   dequeueIndex++; // This increment is for the round-robin case.
@@ -813,6 +814,65 @@ GenQueueDisc::DoDequeue (void)
   return item;
 }
 
+void
+GenQueueDisc::ConfigureScheduler (void)
+{
+  uint32_t n = GetNQueueDiscClasses();
+  schedPrio = round_robin ? std::min(priorityClasses, n) : n;
+  std::vector<uint32_t> q = ClassScheduler::ParseList(quanta);
+  q.resize(n, 0);
+  std::vector<uint32_t> levels(n);
+  for (uint32_t i = 0; i < n; i++) {
+    levels[i] = std::min(i, schedPrio);
+    if (i < schedPrio)
+      q[i] = 0;
+  }
+  sched.Configure(levels, q);
+  for (uint32_t i = 0; i < n; i++) {
+    if (GetQueueDiscClass (i)->GetQueueDisc ()->GetNPackets() > 0)
+      sched.SetBacklogged(i);
+  }
+  if (dequeueIndex < schedPrio || dequeueIndex >= n)
+    dequeueIndex = schedPrio;
+  schedDirty = false;
+}
+
+/* Credit the classes the former linear scan would have probed before finding class p (-1 if none):
+the strict priority classes ahead of it, then the round robin classes from dequeueIndex on. */
+void
+GenQueueDisc::CountSkipped (int32_t p)
+{
+  uint32_t n = GetNQueueDiscClasses();
+  if (p < 0) {
+    SkipRange(0, n, 0, n);
+    return;
+  }
+  if (uint32_t(p) < schedPrio) {
+    SkipRange(0, n, 0, p);
+    return;
+  }
+  SkipRange(0, n, 0, schedPrio);
+  SkipRange(schedPrio, n, dequeueIndex, (p + n - schedPrio - dequeueIndex) % (n - schedPrio));
+  dequeueIndex = uint32_t(p) + 1 < n ? p + 1 : schedPrio;
+}
+
+// n classes from "from" on, wrapping around within [lo, hi)
+void
+GenQueueDisc::SkipRange (uint32_t lo, uint32_t hi, uint32_t from, uint32_t n)
+{
+  if (n == 0)
+    return;
+  skipDiff[from]++;
+  if (from + n <= hi) {
+    skipDiff[from + n]--;
+  }
+  else {
+    skipDiff[hi]--;
+    skipDiff[lo]++;
+    skipDiff[lo + from + n - hi]--;
+  }
+}
+
 Ptr<const QueueDiscItem>
 GenQueueDisc::DoPeek (void)
 {
@@ -28,6 +28,7 @@
 #include "ns3/simulator.h"
 #include "shared-memory.h"
 #include "ns3/random-variable-stream.h"
+#include "ns3/class-scheduler.h"
 
 namespace ns3 {
 
@@ -52,11 +53,13 @@ public:
   void setStrictPriority() {
     strict_priority = 1;
     round_robin = 0; //Just to avoid clash
+    schedDirty = true;
   }
 
   void setRoundRobin() {
     round_robin = 1;
     strict_priority = 0;//Just to avoid clash
+    schedDirty = true;
   }
 
   double GetThroughputQueue(uint32_t p, double nanodelay);
@@ -77,6 +80,7 @@ public:
   }
 
   void setPortBw(double bw) {portBW = bw;}
+  double getPortBw() {return portBW;}
 
   void SetSharedMemory(Ptr<SharedMemoryBuffer> sm) {sharedMemory = sm;}
 
@@ -134,6 +138,10 @@ private:
   virtual bool CheckConfig (void);
   virtual void InitializeParams (void);
 
+  void ConfigureScheduler (void);
+  void CountSkipped (int32_t p);
+  void SkipRange (uint32_t lo, uint32_t hi, uint32_t from, uint32_t n);
+
   uint64_t droppedBytes[101];
 
   /*at enqueue*/
@@ -155,10 +163,20 @@ private:
   Time timeSinceLastChange;
   uint32_t new_index = 0;
 
-  uint32_t dequeueIndex = 0;
+  uint32_t dequeueIndex = 0; // where the round robin part resumes
   uint32_t strict_priority;
   uint32_t round_robin;
 
+  /* The first priorityClasses classes (all of them with StrictPriority) are served in strict priority,
+  the others round robin, or DRR if quanta are set. */
+  ClassScheduler sched;
+  bool schedDirty = true;
+  uint32_t priorityClasses;
+  uint32_t schedPrio; // priorityClasses in use
+  std::string quanta;
+  /* Empty classes passed over by a dequeue are credited 1472 bytes in Deq, as if a scan had probed them.
+  Counted with a difference array and applied in UpdateDequeueRate. */
+  int32_t skipDiff[12] = {0};
   Ptr<SharedMemoryBuffer> sharedMemory;
   uint32_t bufferalg;
   uint32_t portId;
@@ -207,6 +225,7 @@ private:
   bool enableINT;
 
   TracedCallback<Ptr<const Packet>, uint32_t, bool, Ptr<GenQueueDisc>> m_rxTrace; // trace enqueue events
+  TracedCallback<Ptr<const Packet>, uint32_t, Ptr<GenQueueDisc>> m_arrivalTrace; // every arrival, before the reserve and the admission
   TracedCallback<Ptr<const Packet>, uint32_t, Ptr<GenQueueDisc>> m_txTrace; // trace dequeue events
   TracedCallback<uint32_t, uint32_t, uint32_t, uint32_t,uint32_t> m_traceLQD; // trace LQD events
   TracedCallback<uint32_t, uint32_t, uint32_t, uint32_t, int &> m_getPrediction; // trace LQD events
@@ -6,6 +6,10 @@
  */
 #include "shared-memory.h"
 
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
 namespace ns3 {
 NS_LOG_COMPONENT_DEFINE ("SharedMemoryBuffer");
 NS_OBJECT_ENSURE_REGISTERED (SharedMemoryBuffer);
@@ -21,6 +25,11 @@ TypeId SharedMemoryBuffer::GetTypeId (void)
 	                   UintegerValue (1000*1000),
 	                   MakeUintegerAccessor (&SharedMemoryBuffer::TotalBuffer),
 	                   MakeUintegerChecker <uint32_t> ())
+		.AddAttribute ("MaxRate",
+	                   "Port rate in bps the dequeue rate of getDeq is a fraction of",
+	                   UintegerValue (100000000000),
+	                   MakeUintegerAccessor (&SharedMemoryBuffer::MaxRate),
+	                   MakeUintegerChecker <uint64_t> (1))
 		;
   return tid;
 }
@@ -29,16 +38,8 @@ SharedMemoryBuffer::SharedMemoryBuffer(){
 	for (int i=0;i<8;i++){
 		N[i]=0;
 	}
-	for (int i=0;i<99;i++){
-		for (int j=0;j<8;j++){
-			saturated[i][j]=0;
-			sumBytes[i][j]=1500;
-			tDiff[i][j]=Seconds(0);
-			queueLength[i][j]=0;
-			averageQueueLength[i][j]=0;
-			threshold[i][j]=0;
-		}
-	}
+	stride = maxQueues;
+	portCapacity = 0;
 
 	OccupiedBuffer=0;
 	numPorts = 0;
@@ -61,21 +62,20 @@ SharedMemoryBuffer::DoDispose (void)
   for (int i=0;i<8;i++){
   		N[i]=0;
   	}
-  	for (int i=0;i<99;i++){
-  		for (int j=0;j<8;j++){
-  			saturated[i][j]=0;
-  			timestamp[i][j]=Seconds(0);
-			queueLength[i][j]=0;
-			averageQueueLength[i][j]=0;
-			threshold[i][j]=0;
-  		}
-  	}
+  	std::fill(saturated.begin(), saturated.end(), 0);
+  	std::fill(timestamp.begin(), timestamp.end(), Seconds(0));
+  	std::fill(queueLength.begin(), queueLength.end(), 0);
+  	std::fill(averageQueueLength.begin(), averageQueueLength.end(), 0);
+  	std::fill(threshold.begin(), threshold.end(), 0);
+  	QueuePtr.clear();
+  	QueuePtr.resize(portCapacity);
   	TotalBuffer=0;
   	OccupiedBuffer=0;
   	RemainingBuffer=0;
 	numPorts = 0;
 	numQueues = 0;
 	averageSharedOccupancy=0;
+	ResetLongest();
 
   Object::DoDispose ();
 }
@@ -87,22 +87,94 @@ SharedMemoryBuffer::DoInitialize (void)
   for (int i=0;i<8;i++){
   		N[i]=1;
   	}
-  	for (int i=0;i<99;i++){
-  		for (int j=0;j<8;j++){
-  			saturated[i][j]=0;
-			queueLength[i][j]=0;
-			averageQueueLength[i][j]=0;
-			threshold[i][j]=0;
-		}
-  	}
+  	std::fill(saturated.begin(), saturated.end(), 0);
+  	std::fill(queueLength.begin(), queueLength.end(), 0);
+  	std::fill(averageQueueLength.begin(), averageQueueLength.end(), 0);
+  	std::fill(threshold.begin(), threshold.end(), 0);
 
   	OccupiedBuffer=0;
 	averageSharedOccupancy=0;
 	numPorts = 0;
 	numQueues = 0;
+	ResetLongest();
   Object::DoInitialize ();
 }
 
+void SharedMemoryBuffer::setPorts(uint32_t ports){
+	numPorts = ports;
+	if (ports > portCapacity)
+		Grow(ports, stride);
+	ResetLongest();
+}
+
+void SharedMemoryBuffer::setQueues(uint32_t queues){
+	numQueues = queues;
+	Grow(portCapacity, std::max(queues, uint32_t(2))); // queue 1 carries the data packets
+}
+
+// Lays the per (port, queue) state out again for ports ports of queues queues, keeping
+// the state of the queues that exist in both layouts.
+void SharedMemoryBuffer::Grow(uint32_t ports, uint32_t queues){
+	NS_ABORT_MSG_IF(queues > maxQueues, "SharedMemoryBuffer supports " << maxQueues << " queues per port");
+	if (ports == portCapacity && queues == stride)
+		return;
+	uint32_t common = std::min(queues, stride);
+	auto relayout = [&](auto &v, auto init){
+		typename std::remove_reference<decltype(v)>::type n(ports * queues, init);
+		for (uint32_t i = 0; i < portCapacity; i++)
+			for (uint32_t j = 0; j < common; j++)
+				n[i * queues + j] = std::move(v[i * stride + j]);
+		v.swap(n);
+	};
+	relayout(saturated, 0.0);
+	relayout(Deq, DeqWindow());
+	relayout(timestamp, Seconds(0));
+	relayout(queueLength, uint32_t(0));
+	relayout(averageQueueLength, uint32_t(0));
+	relayout(threshold, uint32_t(0));
+	relayout(LastUpdatedAverage, Seconds(0));
+	QueuePtr.resize(ports);
+	portCapacity = ports;
+	stride = queues;
+}
+
+void SharedMemoryBuffer::ResetLongest(){
+	longestQueue.Reset(numPorts);
+	longestThreshold.Reset(numPorts);
+	for (uint32_t i = 0; i < numPorts; i++){
+		longestQueue.Set(i, queueLength[Slot(i,1)]);
+		longestThreshold.Set(i, threshold[Slot(i,1)]);
+	}
+}
+
+void SharedMemoryBuffer::LongestPort::Reset(uint32_t ports){
+	node.clear();
+	if (ports == 0){
+		leaves = 0;
+		return;
+	}
+	leaves = 1;
+	while (leaves < ports)
+		leaves *= 2;
+	// padding leaves hold 0 and lose every tie against a port
+	node.assign(2 * leaves, std::make_pair(uint32_t(0), std::numeric_limits<uint32_t>::max()));
+	for (uint32_t i = 0; i < ports; i++)
+		node[leaves + i].second = i;
+	for (uint32_t i = leaves - 1; i >= 1; i--)
+		node[i] = node[2 * i].second < node[2 * i + 1].second ? node[2 * i] : node[2 * i + 1];
+}
+
+void SharedMemoryBuffer::LongestPort::Set(uint32_t port, uint32_t value){
+	uint32_t i = leaves + port;
+	node[i].first = value;
+	for (i /= 2; i >= 1; i /= 2){
+		const std::pair<uint32_t,uint32_t> &l = node[2 * i];
+		const std::pair<uint32_t,uint32_t> &r = node[2 * i + 1];
+		// the longest, the lowest port among equals, as the linear scan over the ports
+		node[i] = (r.first > l.first || (r.first == l.first && r.second < l.second)) ? r : l;
+	}
+}
+
 
 void SharedMemoryBuffer::SetSharedBufferSize(uint32_t size){
 	TotalBuffer = size;
@@ -121,27 +193,20 @@ void SharedMemoryBuffer::PerPriorityStatDeq(uint32_t size, uint32_t priority){
 }
 
 uint32_t SharedMemoryBuffer::GetQueueSize(uint32_t port, uint32_t queue){
-	return queueLength[port][queue];
+	return queueLength[Slot(port,queue)];
 }
 
 
 uint32_t SharedMemoryBuffer::findLongestThreshold(){
-	uint32_t longestQueueLength = 0;
-	uint32_t longestQueue = 0;
-	for (uint32_t i = 0; i < numPorts; i++){
-		if (threshold[i][1] > longestQueueLength ){ // For now, this is a single queue case. We assume only queue id 1 at each port receives data packets.
-			longestQueueLength = threshold[i][1];
-			longestQueue = i;
-		}
-	}
-	return longestQueue;
+	return longestThreshold.Get(); // For now, this is a single queue case. We assume only queue id 1 at each port receives data packets.
 }
 
 void SharedMemoryBuffer::UpdateThreshold(uint32_t size, uint32_t port, uint32_t queue){
 	while(totalThreshold + size > TotalBuffer){
 		uint32_t lq = findLongestThreshold();
-		if (threshold[lq][1] >= 1500){ // 1500 MTU
-			threshold[lq][1] -= 1500;
+		uint32_t lqThreshold = threshold[Slot(lq,1)];
+		if (lqThreshold >= 1500){ // 1500 MTU
+			SetThreshold(lq, 1, lqThreshold - 1500);
 			if (totalThreshold>=1500){
 				totalThreshold -= 1500;
 			}
@@ -150,16 +215,16 @@ void SharedMemoryBuffer::UpdateThreshold(uint32_t size, uint32_t port, uint32_t
 			}
 		}
 		else{
-			if (totalThreshold>=threshold[lq][1]){
-				totalThreshold -= threshold[lq][1];
+			if (totalThreshold>=lqThreshold){
+				totalThreshold -= lqThreshold;
 			}
 			else{
 				totalThreshold = 0;
 			}
-			threshold[lq][1] = 0;
+			SetThreshold(lq, 1, 0);
 		}
 	}
-	threshold[port][queue] = std::min(threshold[port][queue]+size, TotalBuffer);
+	SetThreshold(port, queue, std::min(threshold[Slot(port,queue)]+size, TotalBuffer));
 	totalThreshold = std::min(totalThreshold+size, TotalBuffer);
 	// if (switchId==0 && port==17 && queue==1){
 	// 	std::cout << "UpdateThreshold: " << "queuelength " << queueLength[port][queue] << " threshold " << threshold[port][queue] << " totalThreshold " << totalThreshold << " size " << size  << std::endl;
@@ -171,7 +236,7 @@ bool SharedMemoryBuffer::EnqueueBuffer(uint32_t size, uint32_t port, uint32_t qu
 	if(RemainingBuffer>size){
 		RemainingBuffer-=size;
 		OccupiedBuffer= std::min(OccupiedBuffer+size, TotalBuffer);
-		queueLength[port][queue]+=size;
+		SetQueueLength(port, queue, queueLength[Slot(port,queue)]+size);
 		// if (switchId==0 && port==17 && queue==1){
 		// 	std::cout << "Enqueue: " << "queuelength " << queueLength[port][queue] << " threshold " << threshold[port][queue] << " totalThreshold " << totalThreshold << " size " << size  << std::endl;
 		// }
@@ -186,8 +251,9 @@ bool SharedMemoryBuffer::EnqueueBuffer(uint32_t size, uint32_t port, uint32_t qu
 }
 
 void SharedMemoryBuffer::DequeueBuffer(uint32_t size, uint32_t port, uint32_t queue){
-	double gammaqueue = (std::min((Simulator::Now()-LastUpdatedAverage[port][queue]).GetNanoSeconds(), AverageInterval.GetNanoSeconds())/double(AverageInterval.GetNanoSeconds()));
-	LastUpdatedAverage[port][queue] = Simulator::Now();
+	uint32_t slot = Slot(port, queue);
+	double gammaqueue = (std::min((Simulator::Now()-LastUpdatedAverage[slot]).GetNanoSeconds(), AverageInterval.GetNanoSeconds())/double(AverageInterval.GetNanoSeconds()));
+	LastUpdatedAverage[slot] = Simulator::Now();
 	double gamma = (std::min((Simulator::Now()-LastUpdatedAverageTotal).GetNanoSeconds(), AverageInterval.GetNanoSeconds())/double(AverageInterval.GetNanoSeconds()));
 	LastUpdatedAverageTotal = Simulator::Now();
 	if(OccupiedBuffer>size){
@@ -200,28 +266,28 @@ void SharedMemoryBuffer::DequeueBuffer(uint32_t size, uint32_t port, uint32_t qu
 		averageSharedOccupancy = gamma*(double(OccupiedBuffer)) + (1-gamma)*double(averageSharedOccupancy);
 		RemainingBuffer = TotalBuffer;
 	}
-	if (queueLength[port][queue]>size){
-		queueLength[port][queue]-=size;
-		averageQueueLength[port][queue] = gammaqueue*(double(queueLength[port][queue])) + (1-gammaqueue)*double(averageQueueLength[port][queue]);
+	if (queueLength[slot]>size){
+		SetQueueLength(port, queue, queueLength[slot]-size);
+		averageQueueLength[slot] = gammaqueue*(double(queueLength[slot])) + (1-gammaqueue)*double(averageQueueLength[slot]);
 	}
 	else{
-		queueLength[port][queue]=0;
-		averageQueueLength[port][queue] = gammaqueue*(double(queueLength[port][queue])) + (1-gammaqueue)*double(averageQueueLength[port][queue]);
+		SetQueueLength(port, queue, 0);
+		averageQueueLength[slot] = gammaqueue*(double(queueLength[slot])) + (1-gammaqueue)*double(averageQueueLength[slot]);
 	}
 	// Dequeue thresholds
-	if (queueLength[port][queue]==0){
-		if (totalThreshold >= threshold[port][queue]){
-			totalThreshold -= threshold[port][queue];
-			threshold[port][queue] = 0;// reset thresholds when queue drains to zero.
+	if (queueLength[slot]==0){
+		if (totalThreshold >= threshold[slot]){
+			totalThreshold -= threshold[slot];
+			SetThreshold(port, queue, 0);// reset thresholds when queue drains to zero.
 		}
 		else{
 			totalThreshold = 0;
-			threshold[port][queue] = 0;
+			SetThreshold(port, queue, 0);
 		}
 	}
 	else{
-		if (threshold[port][queue] >=size){
-			threshold[port][queue] -= size;
+		if (threshold[slot] >=size){
+			SetThreshold(port, queue, threshold[slot]-size);
 			if (totalThreshold>= size){
 				totalThreshold -= size;
 			}
@@ -230,13 +296,13 @@ void SharedMemoryBuffer::DequeueBuffer(uint32_t size, uint32_t port, uint32_t qu
 			}
 		}
 		else{
-			if (totalThreshold>= threshold[port][queue]){
-				totalThreshold -= threshold[port][queue];
-				threshold[port][queue] = 0;
+			if (totalThreshold>= threshold[slot]){
+				totalThreshold -= threshold[slot];
+				SetThreshold(port, queue, 0);
 			}
 			else{
 				totalThreshold = 0;
-				threshold[port][queue] = 0;
+				SetThreshold(port, queue, 0);
 			}	
 		}
 	}
@@ -253,19 +319,12 @@ double SharedMemoryBuffer::GetNofP(uint32_t priority){
 }
 
 void SharedMemoryBuffer::addQueuePtr(Ptr<QueueDisc> queuePtr, uint32_t port){
+	Slot(port, 0);
 	QueuePtr[port]=queuePtr;
 }
 
 uint32_t SharedMemoryBuffer::findLongestQueue(){
-	uint32_t longestQueueLength = 0;
-	uint32_t longestQueue = 0;
-	for (uint32_t i = 0; i < numPorts; i++){
-		if (queueLength[i][1] > longestQueueLength ){ // For now, this is a single queue case. We assume only queue id 1 at each port receives data packets.
-			longestQueueLength = queueLength[i][1];
-			longestQueue = i;
-		}
-	}
-	return longestQueue;
+	return longestQueue.Get(); // For now, this is a single queue case. We assume only queue id 1 at each port receives data packets.
 }
 
 uint32_t*
@@ -320,35 +379,37 @@ SharedMemoryBuffer::RemoveLongestQueuePacket(){
 
 
 void SharedMemoryBuffer::setSaturated(uint32_t port,uint32_t priority, double satLevel){
-	N[priority] += satLevel - saturated[port][priority];
-	saturated[port][priority]=satLevel;
+	uint32_t slot = Slot(port, priority);
+	N[priority] += satLevel - saturated[slot];
+	saturated[slot]=satLevel;
 }
 
 void SharedMemoryBuffer::addDeq(uint32_t bytes,uint32_t prio, uint32_t port){
-	if(Deq[port][prio].size() > 100){
-		sumBytes[port][prio]-= Deq[port][prio][0].first;
-		Deq[port][prio].erase(Deq[port][prio].begin());
-	}
-
+	DeqWindow &w = Deq[Slot(port,prio)];
 	std::pair<uint32_t,Time> temp;
 	temp.first=bytes;
 	temp.second=Simulator::Now();
-	Deq[port][prio].push_back(temp);
-	sumBytes[port][prio]+=bytes;
+	if (w.entries.size() < deqWindow){
+		w.entries.push_back(temp);
+	}
+	else{ // the oldest dequeue makes room
+		w.sumBytes-= w.entries[w.first].first;
+		w.entries[w.first]=temp;
+		w.first = (w.first+1)%deqWindow;
+	}
+	w.sumBytes+=bytes;
 }
 
 double SharedMemoryBuffer::getDeq(uint32_t prio,uint32_t port){
+	const DeqWindow &w = Deq[Slot(port,prio)];
 	Time t = Seconds(0);
-//	std::cout << "Size " << Deq[port][prio].size() << " SumBytes " << sumBytes[port][prio] << std::endl;
-	if(Deq[port][prio].size()>1){
-//		std::cout << "tEnd " << (Deq[port][prio].end()-1)->second.GetSeconds() << " tBegin " << Deq[port][prio].begin()->second.GetSeconds() << std::endl;
-		t = (Deq[port][prio].end()-1)->second - Deq[port][prio].begin()->second;
+	uint32_t n = w.entries.size();
+	if(n>1){
+		t = w.entries[(w.first+n-1)%n].second - w.entries[w.first].second;
 	}
 	else
 		return 1;
-	double deq = 8*sumBytes[port][prio]/t.GetSeconds()/MaxRate;
-//	std::cout << "Size " << Deq[port][prio].size() << " SumBytes " << sumBytes[port][prio] << " Deq " << deq << " t " << t.GetSeconds()<< std::endl;
-//	std::cout << "Deq " << deq << std::endl;
+	double deq = 8*w.sumBytes/t.GetSeconds()/MaxRate;
 	if (deq>1 || deq<0) // sanity check
 		return 1;
 	else
@@ -23,6 +23,8 @@
 #include "ns3/socket.h"
 #include "ns3/unused.h"
 
+#include <vector>
+
 namespace ns3 {
 
 class SharedMemoryBuffer : public Object{
@@ -42,7 +44,7 @@ public:
 
 	void setSaturated(uint32_t port,uint32_t priority, double satLevel);
 	
-	uint32_t isSaturated(uint32_t port,uint32_t priority){return saturated[port][priority];}
+	uint32_t isSaturated(uint32_t port,uint32_t priority){return saturated[Slot(port,priority)];}
 
 	void setPriorityToGroup(uint32_t priority,uint32_t group){PriorityToGroupMap[priority]=group;}
 
@@ -52,23 +54,21 @@ public:
 
 	double getDeq(uint32_t prio,uint32_t port);
 	void addDeq(uint32_t bytes,uint32_t prio, uint32_t port);
-	Time getTimestamp(uint32_t port, uint32_t queue){return timestamp[port][queue];}
-	void setTimestamp(Time x,uint32_t port,uint32_t queue){timestamp[port][queue]=x;}
+	Time getTimestamp(uint32_t port, uint32_t queue){return timestamp[Slot(port,queue)];}
+	void setTimestamp(Time x,uint32_t port,uint32_t queue){timestamp[Slot(port,queue)]=x;}
 
 	void PerPriorityStatEnq(uint32_t size, uint32_t priority);
 	void PerPriorityStatDeq(uint32_t size, uint32_t priority);
 
 	void addQueuePtr(Ptr<QueueDisc> queue, uint32_t port);
 
-	void setPorts(uint32_t ports){
-		numPorts = ports;
-	}
+	// The per port state grows with the highest port seen; setPorts also sets the ports
+	// findLongestQueue and findLongestThreshold look at, and setQueues the queues per port (at most 8).
+	void setPorts(uint32_t ports);
 	uint32_t getPorts(){
 		return numPorts;
 	}
-	void setQueues(uint32_t queues){
-		numQueues = queues;
-	}
+	void setQueues(uint32_t queues);
 
 	uint32_t findLongestQueue();
 
@@ -90,13 +90,13 @@ public:
 	uint32_t GetPerPriorityOccupied(uint32_t priority){return OccupiedBufferPriority[priority];}
 	uint32_t GetQueueSize(uint32_t port, uint32_t queue);
 	uint32_t getAverageQueueLength(uint32_t port, uint32_t queue){
-		return averageQueueLength[port][queue];
+		return averageQueueLength[Slot(port,queue)];
 	}
 	uint32_t getAverageOccupancy(){
 		return averageSharedOccupancy;
 	}
 	uint32_t GetThreshold(uint32_t port, uint32_t queue){
-		return threshold[port][queue];
+		return threshold[Slot(port,queue)];
 	}
 	/////////////////////////////////////////////
 
@@ -107,32 +107,77 @@ protected:
 
 
 private:
+	static const uint32_t maxQueues = 8;
+	static const uint32_t deqWindow = 101; // dequeues kept by addDeq
+
+	// Largest value of a set of ports and its port, the lowest port among equal values,
+	// updated in O(log ports) on every change instead of scanning all ports.
+	class LongestPort {
+	public:
+		void Reset(uint32_t ports);
+		void Set(uint32_t port, uint32_t value);
+		uint32_t Get() const {return node.size() > 1 ? node[1].second : 0;}
+	private:
+		uint32_t leaves = 0;
+		std::vector<std::pair<uint32_t,uint32_t>> node; // value, port; node i has children 2i and 2i+1
+	};
+
+	// The last deqWindow dequeues of a queue, oldest at first once the window is full
+	struct DeqWindow {
+		std::vector<std::pair<uint32_t,Time>> entries;
+		uint32_t first = 0;
+		double sumBytes = 1500;
+	};
+
+	uint32_t Slot(uint32_t port, uint32_t queue){
+		if (port >= portCapacity || queue >= stride)
+			Grow(std::max(port + 1, portCapacity), std::max(queue + 1, stride));
+		return port * stride + queue;
+	}
+	void Grow(uint32_t ports, uint32_t queues);
+	void SetQueueLength(uint32_t port, uint32_t queue, uint32_t length){
+		uint32_t i = Slot(port, queue);
+		queueLength[i] = length;
+		if (queue == 1 && port < numPorts)
+			longestQueue.Set(port, length);
+	}
+	void SetThreshold(uint32_t port, uint32_t queue, uint32_t value){
+		uint32_t i = Slot(port, queue);
+		threshold[i] = value;
+		if (queue == 1 && port < numPorts)
+			longestThreshold.Set(port, value);
+	}
+	void ResetLongest();
+
 	uint32_t TotalBuffer;
 	uint32_t OccupiedBuffer;
 	uint32_t OccupiedBufferPriority[8]={0,0,0,0,0,0,0,0};
 	uint32_t RemainingBuffer;
 	double N[8]; // N corresponds to each queue (one-one mapping with priority) at each port. 8 queues exist at each port.
-	double saturated[100][8]; // 100 ports and 8 queues per node which share the buffer, are supported for now.
+	// per (port, queue) state at port * stride + queue, for portCapacity ports
+	uint32_t stride;
+	uint32_t portCapacity;
+	std::vector<double> saturated;
 
 	std::unordered_map<uint32_t,uint32_t> PriorityToGroupMap;
 
-	std::vector<std::pair<uint32_t,Time>> Deq[100][8];
-	double sumBytes[100][8];
-	Time tDiff[100][8];
+	std::vector<DeqWindow> Deq;
 	uint64_t MaxRate;
-	Time timestamp[100][8];
+	std::vector<Time> timestamp;
 
 	///////////////
-	uint32_t queueLength[100][8];
-	uint32_t averageQueueLength[100][8];
-	uint32_t threshold[100][8];
+	std::vector<uint32_t> queueLength;
+	std::vector<uint32_t> averageQueueLength;
+	std::vector<uint32_t> threshold;
 	uint32_t totalThreshold;
 	uint32_t averageSharedOccupancy;
-	Ptr<QueueDisc> QueuePtr[100];
+	std::vector<Ptr<QueueDisc>> QueuePtr;
 	uint32_t numPorts;
 	uint32_t numQueues;
 	uint32_t switchId;
-	Time LastUpdatedAverage[100][8];
+	std::vector<Time> LastUpdatedAverage;
+	LongestPort longestQueue; // queue 1 of the first numPorts ports
+	LongestPort longestThreshold;
 	Time LastUpdatedAverageTotal;
 	Time AverageInterval;
 
@@ -0,0 +1,123 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/buffer-replay.h"
+#include "ns3/gen-queue-disc.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+
+#include <sstream>
+
+using namespace ns3;
+
+namespace
+{
+
+const uint32_t DT = 101;
+
+/// A burst of ten 1000 bytes packets at port 0 (1 Gbps), and one packet at port 1 (10 Gbps)
+const char* g_trace = "# time port queue size rate\n"
+                      "1000 0 0 1000 1\n"
+                      "1000 0 0 1000 1\n"
+                      "1000 0 0 1000 1\n"
+                      "1000 0 0 1000 1\n"
+                      "1000 0 0 1000 1\n"
+                      "1000 0 0 1000 1\n"
+                      "1000 0 0 1000 1\n"
+                      "1000 0 0 1000 1\n"
+                      "1000 0 0 1000 1\n"
+                      "1000 0 0 1000 1\n"
+                      "2000 1 1 1000 10 7 1\n";
+
+void
+SetAlpha(double alpha, Ptr<GenQueueDisc> q)
+{
+    q->alphas[0] = alpha;
+    q->alphas[1] = alpha;
+}
+
+} // namespace
+
+/**
+ * \brief Replays g_trace through DT with alpha 1 and 0.5 in a 10000 bytes buffer.
+ *
+ * The first packet of the burst goes out at once. With alpha 1, DT then accepts the packets
+ * while queue + 1000 <= 10000 - queue, that is up to a queue of 5000: 4 drops. With alpha 0.5,
+ * up to a queue of 3000: 6 drops. The packet of port 1 arrives while the queue of port 0 is
+ * still full, and is accepted.
+ */
+class BufferReplayDtTestCase : public TestCase
+{
+  public:
+    BufferReplayDtTestCase();
+
+  private:
+    void DoRun() override;
+};
+
+BufferReplayDtTestCase::BufferReplayDtTestCase()
+    : TestCase("BufferReplay drops of DT on a burst")
+{
+}
+
+void
+BufferReplayDtTestCase::DoRun()
+{
+    BufferReplay replay;
+    replay.SetBufferSize(10000);
+    replay.SetNPrior(2);
+    std::istringstream is(g_trace);
+    replay.Load(is);
+    NS_TEST_ASSERT_MSG_EQ(replay.GetRates().size(), 2, "ports");
+    NS_TEST_EXPECT_MSG_EQ_TOL(replay.GetRates()[0], 1, 1e-9, "rate of port 0");
+    NS_TEST_EXPECT_MSG_EQ_TOL(replay.GetRates()[1], 10, 1e-9, "rate of port 1");
+
+    replay.AddPolicy("DT1", DT, MakeBoundCallback(&SetAlpha, 1.0));
+    replay.AddPolicy("DT0.5", DT, MakeBoundCallback(&SetAlpha, 0.5));
+    replay.Run();
+    Simulator::Destroy();
+
+    uint64_t drops[2] = {4, 6};
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        const BufferReplay::Stats& s = replay.GetStats(i);
+        NS_TEST_EXPECT_MSG_EQ(s.arrivals, 11, replay.GetName(i) << " arrivals");
+        NS_TEST_EXPECT_MSG_EQ(s.arrivalBytes, 11000, replay.GetName(i) << " arrival bytes");
+        NS_TEST_EXPECT_MSG_EQ(s.drops, drops[i], replay.GetName(i) << " drops");
+        NS_TEST_EXPECT_MSG_EQ(s.dropBytes, drops[i] * 1000, replay.GetName(i) << " drop bytes");
+        NS_TEST_EXPECT_MSG_EQ(s.queueDrops[0], drops[i], replay.GetName(i) << " drops of queue 0");
+        NS_TEST_EXPECT_MSG_EQ(s.queueDrops[1], 0, replay.GetName(i) << " drops of queue 1");
+        NS_TEST_EXPECT_MSG_EQ(s.departures, 11 - drops[i], replay.GetName(i) << " departures");
+        // the queue of port 0 and the packet of port 1, before it goes out
+        NS_TEST_EXPECT_MSG_EQ(s.maxOccupancy, (10 - drops[i]) * 1000, replay.GetName(i) << " max occupancy");
+    }
+}
+
+/**
+ * \brief TestSuite for BufferReplay
+ */
+class BufferReplayTestSuite : public TestSuite
+{
+  public:
+    BufferReplayTestSuite();
+};
+
+BufferReplayTestSuite::BufferReplayTestSuite()
+    : TestSuite("buffer-replay", UNIT)
+{
+    AddTestCase(new BufferReplayDtTestCase(), TestCase::QUICK);
+}
+
+static BufferReplayTestSuite g_bufferReplayTestSuite; //!< The testsuite
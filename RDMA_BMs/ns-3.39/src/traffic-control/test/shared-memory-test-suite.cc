@@ -0,0 +1,278 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/shared-memory.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+
+#include <deque>
+#include <random>
+
+using namespace ns3;
+
+/**
+ * \brief Applies random enqueues, dequeues, threshold updates and port count changes to a
+ * SharedMemoryBuffer, and checks after each of them that findLongestQueue and
+ * findLongestThreshold return the port of a linear scan over queue 1 of the ports: the
+ * largest value, the lowest port among equal values, port 0 when all are 0.
+ *
+ * The sizes are multiples of 500 bytes in a small buffer, so that ties are frequent and
+ * UpdateThreshold has to take bytes from the longest threshold. The queues of ports beyond
+ * the ones set with setPorts and queue 0 are updated too, and must not be picked.
+ */
+class SharedMemoryLongestTestCase : public TestCase
+{
+  public:
+    SharedMemoryLongestTestCase();
+
+  private:
+    void DoRun() override;
+    /// port of the largest GetQueueSize (or GetThreshold) of queue 1, the lowest among equals
+    static uint32_t Scan(Ptr<SharedMemoryBuffer> buffer, bool threshold);
+
+    static constexpr uint32_t PORTS = 13;
+    static constexpr uint32_t STEPS = 20000;
+};
+
+SharedMemoryLongestTestCase::SharedMemoryLongestTestCase()
+    : TestCase("longest queue and threshold match a linear scan")
+{
+}
+
+uint32_t
+SharedMemoryLongestTestCase::Scan(Ptr<SharedMemoryBuffer> buffer, bool threshold)
+{
+    uint32_t best = 0;
+    uint32_t bestValue = 0;
+    for (uint32_t p = 0; p < buffer->getPorts(); p++)
+    {
+        uint32_t value = threshold ? buffer->GetThreshold(p, 1) : buffer->GetQueueSize(p, 1);
+        if (p == 0 || value > bestValue)
+        {
+            best = p;
+            bestValue = value;
+        }
+    }
+    return best;
+}
+
+void
+SharedMemoryLongestTestCase::DoRun()
+{
+    Ptr<SharedMemoryBuffer> buffer = CreateObject<SharedMemoryBuffer>();
+    buffer->SetSharedBufferSize(30000);
+    buffer->setAverageInteral(MicroSeconds(10));
+    buffer->setQueues(2);
+    buffer->setPorts(PORTS);
+
+    std::mt19937_64 rng(1);
+    uint32_t queueErrors = 0;
+    uint32_t thresholdErrors = 0;
+    uint32_t queueTies = 0; // steps where several ports have the longest queue, not empty
+    uint32_t thresholdTies = 0; // same for the thresholds
+    for (uint32_t step = 0; step < STEPS; step++)
+    {
+        uint32_t size = 500 * (rng() % 3 + 1);
+        uint32_t port = rng() % (PORTS + 2);
+        uint32_t queue = rng() % 4 == 0 ? 0 : 1;
+        switch (rng() % 10)
+        {
+        case 0:
+        case 1:
+        case 2:
+        case 3:
+            buffer->EnqueueBuffer(size, port, queue);
+            break;
+        case 4:
+        case 5:
+        case 6:
+            buffer->DequeueBuffer(size, port, queue);
+            break;
+        case 7:
+        case 8:
+            // UpdateThreshold takes room from the longest threshold of the ports it looks at,
+            // and would never find it elsewhere
+            buffer->UpdateThreshold(size, port % buffer->getPorts(), 1);
+            break;
+        default:
+            if (rng() % 20 == 0)
+            {
+                // down to the last port with a threshold, for the same reason
+                uint32_t minPorts = 1;
+                for (uint32_t p = 0; p < PORTS; p++)
+                {
+                    minPorts = buffer->GetThreshold(p, 1) > 0 ? p + 1 : minPorts;
+                }
+                buffer->setPorts(minPorts + rng() % (PORTS - minPorts + 1));
+            }
+            break;
+        }
+
+        uint32_t longestQueue = Scan(buffer, false);
+        uint32_t longestThreshold = Scan(buffer, true);
+        if (buffer->findLongestQueue() != longestQueue)
+        {
+            queueErrors++;
+        }
+        if (buffer->findLongestThreshold() != longestThreshold)
+        {
+            thresholdErrors++;
+        }
+        for (uint32_t p = longestQueue + 1; p < buffer->getPorts(); p++)
+        {
+            if (buffer->GetQueueSize(p, 1) > 0 &&
+                buffer->GetQueueSize(p, 1) == buffer->GetQueueSize(longestQueue, 1))
+            {
+                queueTies++;
+                break;
+            }
+        }
+        for (uint32_t p = longestThreshold + 1; p < buffer->getPorts(); p++)
+        {
+            if (buffer->GetThreshold(p, 1) > 0 &&
+                buffer->GetThreshold(p, 1) == buffer->GetThreshold(longestThreshold, 1))
+            {
+                thresholdTies++;
+                break;
+            }
+        }
+    }
+    NS_TEST_EXPECT_MSG_EQ(queueErrors, 0, "steps where findLongestQueue differs from the scan");
+    NS_TEST_EXPECT_MSG_EQ(thresholdErrors,
+                          0,
+                          "steps where findLongestThreshold differs from the scan");
+    NS_TEST_EXPECT_MSG_GT(queueTies, STEPS / 20, "ties among the queues");
+    NS_TEST_EXPECT_MSG_GT(thresholdTies, STEPS / 20, "ties among the thresholds");
+    Simulator::Destroy();
+}
+
+/**
+ * \brief Records random dequeues of two queues at random times with addDeq, about 2.5 times
+ * the window for one queue and less for the other, and checks after each of them that
+ * getDeq returns the rate of the last 101 dequeues of the queue (plus the 1500 bytes the sum
+ * starts from) over the time between the oldest and the newest, as a fraction of MaxRate.
+ */
+class SharedMemoryDeqWindowTestCase : public TestCase
+{
+  public:
+    SharedMemoryDeqWindowTestCase();
+
+  private:
+    void DoRun() override;
+    void Dequeue(uint32_t bytes, uint32_t prio, uint32_t port);
+
+    static constexpr uint32_t WINDOW = 101;
+    static constexpr uint64_t MAX_RATE = 10000000000; // bps
+
+    Ptr<SharedMemoryBuffer> m_buffer;
+    std::deque<std::pair<uint32_t, Time>> m_window[2]; //!< last dequeues of port 0 and port 1
+    uint32_t m_dequeues[2];
+    uint32_t m_errors;
+};
+
+SharedMemoryDeqWindowTestCase::SharedMemoryDeqWindowTestCase()
+    : TestCase("dequeue rate over the last 101 dequeues, across wraparounds"),
+      m_dequeues{0, 0},
+      m_errors(0)
+{
+}
+
+void
+SharedMemoryDeqWindowTestCase::Dequeue(uint32_t bytes, uint32_t prio, uint32_t port)
+{
+    std::deque<std::pair<uint32_t, Time>>& window = m_window[port];
+    window.emplace_back(bytes, Simulator::Now());
+    if (window.size() > WINDOW)
+    {
+        window.pop_front();
+    }
+    m_dequeues[port]++;
+    m_buffer->addDeq(bytes, prio, port);
+
+    double expected = 1;
+    if (window.size() > 1)
+    {
+        double sum = 1500;
+        for (const auto& d : window)
+        {
+            sum += d.first;
+        }
+        double t = (window.back().second - window.front().second).GetSeconds();
+        expected = std::min(8 * sum / t / MAX_RATE, 1.0);
+    }
+    double deq = m_buffer->getDeq(prio, port);
+    if (std::abs(deq - expected) > 1e-9 * expected)
+    {
+        m_errors++;
+    }
+}
+
+void
+SharedMemoryDeqWindowTestCase::DoRun()
+{
+    m_buffer = CreateObject<SharedMemoryBuffer>();
+    m_buffer->SetAttribute("MaxRate", UintegerValue(MAX_RATE));
+    m_buffer->setQueues(3);
+    m_buffer->setPorts(2);
+
+    std::mt19937_64 rng(1);
+    Time t = Seconds(1);
+    for (uint32_t i = 0; i < 250; i++)
+    {
+        t += NanoSeconds(500 + rng() % 1500);
+        Simulator::Schedule(t,
+                            &SharedMemoryDeqWindowTestCase::Dequeue,
+                            this,
+                            64 + rng() % 1437,
+                            1,
+                            0);
+        if (i % 3 == 0)
+        {
+            Simulator::Schedule(t,
+                                &SharedMemoryDeqWindowTestCase::Dequeue,
+                                this,
+                                64 + rng() % 1437,
+                                2,
+                                1);
+        }
+    }
+    Simulator::Run();
+    NS_TEST_EXPECT_MSG_EQ(m_dequeues[0], 250, "dequeues of port 0");
+    NS_TEST_EXPECT_MSG_EQ(m_dequeues[1], 84, "dequeues of port 1");
+    NS_TEST_EXPECT_MSG_EQ(m_errors, 0, "dequeues after which getDeq differs from the window");
+    // the rate of queue 0 of port 0 was never recorded
+    NS_TEST_EXPECT_MSG_EQ(m_buffer->getDeq(0, 0), 1, "rate without dequeues");
+    Simulator::Destroy();
+    m_buffer = nullptr;
+}
+
+/**
+ * \brief TestSuite for the SharedMemoryBuffer bookkeeping
+ */
+class SharedMemoryTestSuite : public TestSuite
+{
+  public:
+    SharedMemoryTestSuite();
+};
+
+SharedMemoryTestSuite::SharedMemoryTestSuite()
+    : TestSuite("shared-memory", UNIT)
+{
+    AddTestCase(new SharedMemoryLongestTestCase(), TestCase::QUICK);
+    AddTestCase(new SharedMemoryDeqWindowTestCase(), TestCase::QUICK);
+}
+
+static SharedMemoryTestSuite g_sharedMemoryTestSuite; //!< The testsuite
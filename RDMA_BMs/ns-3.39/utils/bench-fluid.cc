@@ -0,0 +1,320 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program measures the speedup of FluidBackground on a leaf-spine network running DCQCN:
+// Poisson background flows between hosts of different leaves, simulated either packet by packet
+// (--fluid=0) or as fluid flows (--fluid=1), under periodic incasts of foreground RDMA flows. It
+// reports the wall clock time, the number of events and the FCT of the foreground flows. With
+// --local the background flows stay within their leaf, so the fluid flows of different leaves do
+// not share links and an arrival or departure only reallocates the flows of its leaf.
+// Sample usage:  ./ns3 run 'bench-fluid --fluid=1 --load=0.5'
+
+#include "ns3/command-line.h"
+#include "ns3/dc-topology-helper.h"
+#include "ns3/fluid-background.h"
+#include "ns3/memory-stats.h"
+#include "ns3/node-list.h"
+#include "ns3/qbb-channel.h"
+#include "ns3/rdma-driver.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/rdma-queue-pair.h"
+#include "ns3/simulator.h"
+#include "ns3/switch-node.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace ns3;
+
+static const uint32_t LOSSLESS = 0;
+static const uint16_t INCAST_SPORT = 40000; //!< foreground flows use sports from here on
+
+static DcTopologyHelper topo;
+static std::vector<Time> fgFct;
+static uint64_t bgDone = 0;
+
+// Egress devices from src to dst, following the routing tables. hash picks among the ECMP next hops.
+static std::vector<Ptr<QbbNetDevice>>
+FluidPath(uint32_t src, uint32_t dst, uint32_t hash)
+{
+    std::vector<Ptr<QbbNetDevice>> path;
+    uint32_t now = src;
+    while (now != dst)
+    {
+        std::vector<uint32_t> nexts = topo.GetNextHops(now, dst);
+        const DcTopologyHelper::Port& port = topo.GetPorts(now)[nexts[hash % nexts.size()]];
+        path.push_back(port.dev);
+        now = port.peer;
+    }
+    return path;
+}
+
+static void
+QpComplete(Ptr<RdmaQueuePair> q)
+{
+    if (q->sport >= INCAST_SPORT)
+    {
+        fgFct.push_back(Simulator::Now() - q->startTime);
+    }
+    else
+    {
+        bgDone++;
+    }
+}
+
+static void
+FluidComplete(uint64_t size, Time start, Time fct)
+{
+    bgDone++;
+}
+
+static void
+Nothing()
+{
+}
+
+static void
+StartQp(uint32_t src, uint32_t dst, uint64_t size, uint16_t sport, uint16_t dport, uint64_t rtt)
+{
+    Ptr<RdmaDriver> rdma = NodeList::GetNode(src)->GetObject<RdmaDriver>();
+    rdma->AddQueuePair(size,
+                       3,
+                       DcTopologyHelper::GetHostAddress(src),
+                       DcTopologyHelper::GetHostAddress(dst),
+                       sport,
+                       dport,
+                       0,
+                       rtt,
+                       MakeCallback(&Nothing),
+                       Seconds(100));
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string shape = "leafspine:8,4,2";
+    bool fluid = false;
+    bool local = false;
+    double load = 0.5;
+    double duration = 0.005;
+    uint32_t fanIn = 8;
+    uint64_t incastSize = 64000;
+    double incastInterval = 0.0005;
+    uint32_t mtu = 1000;
+    uint32_t seed = 1;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("shape", "leafspine:h,l,s[,links], fattree:k or clos:h,l,s,pods,cores[,links]", shape);
+    cmd.AddValue("fluid", "simulate the background flows as fluid", fluid);
+    cmd.AddValue("local", "background flows stay within their leaf", local);
+    cmd.AddValue("load", "background load of each host link", load);
+    cmd.AddValue("duration", "seconds of background arrivals", duration);
+    cmd.AddValue("fanIn", "senders of each incast", fanIn);
+    cmd.AddValue("incastSize", "bytes sent by each incast sender", incastSize);
+    cmd.AddValue("incastInterval", "seconds between incasts", incastInterval);
+    cmd.AddValue("mtu", "payload bytes of a packet", mtu);
+    cmd.AddValue("seed", "seed of the workload", seed);
+    cmd.Parse(argc, argv);
+
+    SystemWallClockMs clock;
+    clock.Start();
+
+    topo.SetShape(shape);
+    QbbHelper qbb;
+    NodeContainer nodes = topo.Build(qbb);
+    NodeContainer hosts = topo.GetNodes(DcTopologyHelper::HOST);
+    for (uint32_t i = 0; i < hosts.GetN(); i++)
+    {
+        Ptr<RdmaHw> rdmaHw = CreateObject<RdmaHw>();
+        rdmaHw->SetAttribute("Mtu", UintegerValue(mtu));
+        rdmaHw->SetAttribute("L2AckInterval", UintegerValue(1));
+        rdmaHw->SetAttribute("CcMode", UintegerValue(1));
+        Ptr<RdmaDriver> rdma = CreateObject<RdmaDriver>();
+        rdma->SetNode(hosts.Get(i));
+        rdma->SetRdmaHw(rdmaHw);
+        hosts.Get(i)->AggregateObject(rdma);
+        rdma->Init();
+        rdma->TraceConnectWithoutContext("QpComplete", MakeCallback(&QpComplete));
+    }
+    topo.PopulateRoutes(mtu);
+
+    uint64_t maxRtt = 0;
+    for (uint32_t i = 0; i < hosts.GetN(); i++)
+    {
+        for (uint32_t j = 0; j < hosts.GetN(); j++)
+        {
+            uint32_t a = hosts.Get(i)->GetId();
+            uint32_t b = hosts.Get(j)->GetId();
+            if (a != b)
+            {
+                maxRtt = std::max(maxRtt, topo.GetPairDelay(a, b) * 2 + topo.GetPairTxDelay(a, b));
+            }
+        }
+    }
+
+    // the switches as the examples set them up: DCQCN marking, PFC on queues 0 and 3
+    uint64_t bufferSize = 9000000;
+    for (uint32_t i = 0; i < nodes.GetN(); i++)
+    {
+        Ptr<SwitchNode> sw = DynamicCast<SwitchNode>(nodes.Get(i));
+        if (!sw)
+        {
+            continue;
+        }
+        uint64_t totalHeadroom = 0;
+        sw->m_mmu->SetPortCount(sw->GetNDevices() - 1);
+        for (uint32_t j = 1; j < sw->GetNDevices(); j++)
+        {
+            Ptr<QbbNetDevice> dev = DynamicCast<QbbNetDevice>(sw->GetDevice(j));
+            uint64_t rate = dev->GetDataRate().GetBitRate();
+            sw->m_mmu->bandwidth[j] = rate;
+            for (uint32_t qu = 0; qu < 8; qu++)
+            {
+                if (qu == 3 || qu == 0)
+                {
+                    sw->m_mmu->SetAlphaIngress(1, j, qu);
+                    sw->m_mmu->SetAlphaEgress(10000, j, qu);
+                    double delay =
+                        DynamicCast<QbbChannel>(dev->GetChannel())->GetDelay().GetSeconds();
+                    uint32_t headroom = (mtu + 48) * 2 + 3860 + (2 * rate * delay / 8);
+                    sw->m_mmu->SetHeadroom(headroom, j, qu);
+                    totalHeadroom += headroom;
+                }
+                else
+                {
+                    sw->m_mmu->SetAlphaIngress(10000, j, qu);
+                    sw->m_mmu->SetAlphaEgress(1, j, qu);
+                }
+            }
+            // kmin, kmax in KB scaled from 400, 1600 at 100Gbps
+            uint32_t k = rate / 100000000000.0 * 400;
+            sw->m_mmu->ConfigEcn(j, k, k * 4, 0.2);
+        }
+        sw->m_mmu->SetBufferPool(bufferSize);
+        sw->m_mmu->SetIngressPool(bufferSize - totalHeadroom);
+        sw->m_mmu->SetSharedPool(bufferSize - totalHeadroom);
+        sw->m_mmu->SetEgressLosslessPool(bufferSize);
+        sw->m_mmu->SetEgressLossyPool(bufferSize - totalHeadroom);
+        sw->m_mmu->node_id = sw->GetId();
+        sw->SetAttribute("CcMode", UintegerValue(1));
+        sw->SetAttribute("MaxRtt", UintegerValue(maxRtt));
+    }
+
+    Ptr<FluidBackground> fluidBg;
+    if (fluid)
+    {
+        fluidBg = CreateObject<FluidBackground>();
+        fluidBg->TraceConnectWithoutContext("FlowComplete", MakeCallback(&FluidComplete));
+    }
+
+    // background: Poisson arrivals at every host, sizes uniform in [10KB, 390KB], to a host of
+    // another leaf, or of the same leaf with --local
+    std::mt19937 gen(seed);
+    uint32_t nHosts = hosts.GetN();
+    uint32_t perLeaf = topo.GetN(DcTopologyHelper::HOST) / topo.GetN(DcTopologyHelper::LEAF);
+    uint64_t hostRate = DynamicCast<QbbNetDevice>(hosts.Get(0)->GetDevice(1))->GetDataRate().GetBitRate();
+    double meanSize = 200000;
+    double arrivalRate = load * hostRate / 8 / meanSize;
+    std::exponential_distribution<double> interval(arrivalRate);
+    std::uniform_int_distribution<uint64_t> size(10000, 390000);
+    uint64_t bgFlows = 0;
+    uint16_t sport = 1000;
+    uint16_t dport = 1000;
+    for (uint32_t i = 0; i < nHosts; i++)
+    {
+        uint32_t src = hosts.Get(i)->GetId();
+        for (double t = interval(gen); t < duration; t += interval(gen))
+        {
+            uint32_t j;
+            if (local)
+            {
+                j = i / perLeaf * perLeaf + (i % perLeaf + 1 + gen() % (perLeaf - 1)) % perLeaf;
+            }
+            else
+            {
+                j = gen() % (nHosts - perLeaf);
+                j = (i / perLeaf * perLeaf + perLeaf + j) % nHosts;
+            }
+            uint32_t dst = hosts.Get(j)->GetId();
+            uint64_t s = size(gen);
+            if (fluid)
+            {
+                fluidBg->AddFlow(FluidPath(src, dst, sport), 3, LOSSLESS, s, Seconds(t));
+            }
+            else
+            {
+                Simulator::Schedule(Seconds(t), &StartQp, src, dst, s, sport, dport, maxRtt);
+            }
+            bgFlows++;
+            sport = sport + 1 < INCAST_SPORT ? sport + 1 : 1000;
+            dport = dport + 1 < 60000 ? dport + 1 : 1000;
+        }
+    }
+
+    // foreground: fanIn hosts of other leaves send incastSize bytes each to one host
+    uint64_t fgFlows = 0;
+    uint16_t fgSport = INCAST_SPORT;
+    for (double t = incastInterval; t < duration; t += incastInterval)
+    {
+        uint32_t i = gen() % nHosts;
+        uint32_t dst = hosts.Get(i)->GetId();
+        for (uint32_t k = 0; k < fanIn; k++)
+        {
+            uint32_t j = gen() % (nHosts - perLeaf);
+            j = (i / perLeaf * perLeaf + perLeaf + j) % nHosts;
+            Simulator::Schedule(Seconds(t),
+                                &StartQp,
+                                hosts.Get(j)->GetId(),
+                                dst,
+                                incastSize,
+                                fgSport,
+                                100,
+                                maxRtt);
+            fgFlows++;
+            fgSport = fgSport < 65000 ? fgSport + 1 : INCAST_SPORT;
+        }
+    }
+    double setupMs = clock.End();
+
+    clock.Start();
+    Simulator::Run();
+    double runMs = clock.End();
+
+    std::sort(fgFct.begin(), fgFct.end());
+    double mean = 0;
+    for (const Time& t : fgFct)
+    {
+        mean += t.GetMicroSeconds();
+    }
+    mean = fgFct.empty() ? 0 : mean / fgFct.size();
+    double p99 = fgFct.empty() ? 0 : fgFct[(fgFct.size() - 1) * 99 / 100].GetMicroSeconds();
+
+    std::cout << "bench-fluid " << shape << " " << (fluid ? "fluid" : "packet") << (local ? " local" : "")
+              << " load " << load
+              << ": " << bgFlows << " background flows, " << bgDone << " done, " << fgFlows
+              << " foreground flows, " << fgFct.size() << " done" << std::endl;
+    std::cout << "foreground fct: mean " << mean << " us, p99 " << p99 << " us" << std::endl;
+    std::cout << "setup: " << setupMs << " ms" << std::endl;
+    std::cout << "run: " << runMs << " ms, " << Simulator::GetEventCount() << " events, simulated "
+              << Simulator::Now().GetMicroSeconds() << " us" << std::endl;
+    std::cout << "peak rss " << MemoryStats::GetPeakRss() << " KB" << std::endl;
+
+    Simulator::Destroy();
+    return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program benchmarks the HPCC-PINT utilization estimate done by the switches on every dequeue,
+// comparing the table-driven fixed point path (Pint::update_u) with the former floating point path
+// (Pint::update_u_float). Both are checked against the exact formula.
+// Sample usage:  ./ns3 run 'bench-pint --n=1000000'
+
+#include "ns3/command-line.h"
+#include "ns3/pint.h"
+#include "ns3/system-wall-clock-ms.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace ns3;
+
+/// One dequeue event as seen by SwitchNode::SwitchNotifyDequeue
+struct PintInput
+{
+    uint64_t dt;   //!< time since the previous dequeue, ns
+    uint64_t qlen; //!< egress queue length, bytes
+    uint32_t byte; //!< size of the previous packet
+    double u;      //!< previous utilization estimate
+};
+
+/// Relative error statistics
+struct ErrStat
+{
+    double sum = 0; //!< sum of relative errors
+    double max = 0; //!< max relative error
+    uint64_t n = 0; //!< number of samples
+
+    /**
+     * Add one sample
+     * \param v the approximation
+     * \param exact the exact value
+     */
+    void Add(double v, double exact)
+    {
+        double e = std::fabs(v - exact) / exact;
+        sum += e;
+        max = std::max(max, e);
+        n++;
+    }
+};
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t n = 1000000;
+    uint64_t T = 9000;
+    uint64_t rate = 100000000000;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("n", "number of dequeue events", n);
+    cmd.AddValue("maxRtt", "max RTT (T) in ns", T);
+    cmd.AddValue("rate", "port rate in bps", rate);
+    cmd.Parse(argc, argv);
+
+    uint64_t B = rate / 8;
+    std::mt19937_64 gen(1);
+    std::vector<PintInput> in(n);
+    for (auto& x : in)
+    {
+        x.dt = 1 + gen() % T;
+        x.qlen = gen() % 2000000;
+        x.byte = 64 + gen() % 1437;
+        x.u = std::ldexp(double(gen() % 16384), -Pint::u_shift); // [0, 2)
+    }
+
+    // exact: (T-dt)/T*u + dt*qlen/(B*T^2) + byte/(B*T)
+    std::vector<double> exact(n);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        const PintInput& x = in[i];
+        exact[i] = double(T - x.dt) / T * x.u + double(x.dt) * (x.qlen >> 8 << 8) * 1e9 / (double(B) * T * T) +
+                   x.byte * 1e9 / (double(B) * T);
+    }
+
+    std::vector<double> fl(n);
+    SystemWallClockMs clock;
+    clock.Start();
+    for (uint32_t i = 0; i < n; i++)
+    {
+        fl[i] = Pint::update_u_float(in[i].dt, in[i].qlen, in[i].byte, in[i].u, T, B);
+    }
+    double floatMs = clock.End();
+
+    std::vector<uint32_t> fx(n);
+    std::vector<uint32_t> uFixed(n);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        uFixed[i] = std::lround(std::ldexp(in[i].u, Pint::u_shift));
+    }
+    int32_t logB = PintMath::log2(B);
+    int32_t logT = PintMath::log2(T);
+    clock.Start();
+    for (uint32_t i = 0; i < n; i++)
+    {
+        fx[i] = Pint::update_u(in[i].dt, in[i].qlen, in[i].byte, uFixed[i], T, logB, logT);
+    }
+    double fixedMs = clock.End();
+
+    ErrStat floatErr;
+    ErrStat fixedErr;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        floatErr.Add(fl[i], exact[i]);
+        fixedErr.Add(std::ldexp(double(fx[i]), -int(Pint::u_shift)), exact[i]);
+    }
+
+    // encoding: the decoded value averaged over the dithering should be u itself
+    ErrStat encodeErr;
+    std::mt19937 rnd(2);
+    for (uint32_t u_toInt = 1; u_toInt < Pint::max_concurrent * 4; u_toInt++)
+    {
+        double sum = 0;
+        const int samples = 256;
+        for (int s = 0; s < samples; s++)
+        {
+            sum += Pint::decode_u(Pint::encode_u(u_toInt, rnd() & 0xffff));
+        }
+        encodeErr.Add(sum / samples, double(u_toInt) / Pint::max_concurrent);
+    }
+
+    std::cout << "bench-pint n=" << n << " T=" << T << "ns rate=" << rate << "bps" << std::endl;
+    std::cout << "float: " << floatMs << " ms, " << floatMs * 1e6 / n << " ns/update, rel err mean "
+              << floatErr.sum / floatErr.n << " max " << floatErr.max << std::endl;
+    std::cout << "fixed: " << fixedMs << " ms, " << fixedMs * 1e6 / n << " ns/update, rel err mean "
+              << fixedErr.sum / fixedErr.n << " max " << fixedErr.max << std::endl;
+    std::cout << "encode/decode: rel err of the mean mean " << encodeErr.sum / encodeErr.n << " max "
+              << encodeErr.max << std::endl;
+    return 0;
+}
@@ -0,0 +1,156 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program measures the cost of the TCP sender and receiver buffers: --flows BulkSendApplications
+// send --bytes each over one point-to-point link (400Gbps, 5us by default) with the initial window set
+// to the BDP of the path, as the Occamy and incast runs do, and with SACK. --errorRate drops that
+// fraction of the data packets at the receiver, to exercise the scoreboard and the reassembly.
+// It reports the wall time per delivered segment, which should not grow with --bytes or --delay.
+// Sample usage:  ./ns3 run 'bench-tcp-bulk --bytes=100000000 --errorRate=0.001'
+
+#include "ns3/boolean.h"
+#include "ns3/bulk-send-helper.h"
+#include "ns3/command-line.h"
+#include "ns3/config.h"
+#include "ns3/data-rate.h"
+#include "ns3/error-model.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/memory-stats.h"
+#include "ns3/packet-sink-helper.h"
+#include "ns3/packet.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/pointer.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/tcp-socket.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace ns3;
+
+/// Bytes delivered to the sinks, and the time the last of them arrived
+struct Delivery
+{
+    uint64_t expected;
+    uint64_t received;
+    Time last;
+};
+
+/// Stops the simulation once every byte is delivered, before the connections close and
+/// wait in TIME_WAIT
+static void
+SinkRx(Delivery* delivery, Ptr<const Packet> p, const Address& from)
+{
+    delivery->received += p->GetSize();
+    delivery->last = Simulator::Now();
+    if (delivery->received == delivery->expected)
+    {
+        Simulator::Stop();
+    }
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string rate = "400Gbps";
+    std::string delay = "5us";
+    uint64_t bytes = 100000000;
+    uint32_t flows = 1;
+    uint32_t segmentSize = 1448;
+    double errorRate = 0;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("rate", "link rate", rate);
+    cmd.AddValue("delay", "one way link delay", delay);
+    cmd.AddValue("bytes", "bytes sent by each flow", bytes);
+    cmd.AddValue("flows", "number of BulkSendApplications", flows);
+    cmd.AddValue("segmentSize", "TCP segment size", segmentSize);
+    cmd.AddValue("errorRate", "fraction of packets dropped at the receiver", errorRate);
+    cmd.Parse(argc, argv);
+
+    DataRate linkRate(rate);
+    Time rtt = 2 * Time(delay);
+    uint64_t bdp = linkRate.GetBitRate() / 8 * rtt.GetSeconds();
+    uint32_t bdpSegments = std::max<uint64_t>(10, bdp / segmentSize);
+    uint32_t bufSize = std::max<uint64_t>(4 * bdp, 1 << 20);
+
+    Config::SetDefault("ns3::TcpSocket::SegmentSize", UintegerValue(segmentSize));
+    Config::SetDefault("ns3::TcpSocket::InitialCwnd", UintegerValue(bdpSegments));
+    Config::SetDefault("ns3::TcpSocket::SndBufSize", UintegerValue(bufSize));
+    Config::SetDefault("ns3::TcpSocket::RcvBufSize", UintegerValue(bufSize));
+    Config::SetDefault("ns3::TcpSocketBase::Sack", BooleanValue(true));
+
+    NodeContainer nodes;
+    nodes.Create(2);
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue(rate));
+    p2p.SetDeviceAttribute("Mtu", UintegerValue(segmentSize + 52));
+    p2p.SetChannelAttribute("Delay", StringValue(delay));
+    p2p.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue("100000p"));
+    NetDeviceContainer devices = p2p.Install(nodes);
+    if (errorRate > 0)
+    {
+        Ptr<RateErrorModel> em = CreateObject<RateErrorModel>();
+        em->SetUnit(RateErrorModel::ERROR_UNIT_PACKET);
+        em->SetRate(errorRate);
+        devices.Get(1)->SetAttribute("ReceiveErrorModel", PointerValue(em));
+    }
+
+    InternetStackHelper stack;
+    stack.Install(nodes);
+    Ipv4AddressHelper address("10.1.1.0", "255.255.255.0");
+    Ipv4InterfaceContainer interfaces = address.Assign(devices);
+
+    Delivery delivery = {flows * bytes, 0, Time()};
+    ApplicationContainer sinks;
+    for (uint32_t i = 0; i < flows; i++)
+    {
+        uint16_t port = 5000 + i;
+        PacketSinkHelper sink("ns3::TcpSocketFactory",
+                              InetSocketAddress(Ipv4Address::GetAny(), port));
+        sinks.Add(sink.Install(nodes.Get(1)));
+        sinks.Get(i)->TraceConnectWithoutContext("Rx", MakeBoundCallback(&SinkRx, &delivery));
+        BulkSendHelper source("ns3::TcpSocketFactory",
+                              InetSocketAddress(interfaces.GetAddress(1), port));
+        source.SetAttribute("MaxBytes", UintegerValue(bytes));
+        source.SetAttribute("SendSize", UintegerValue(segmentSize));
+        source.Install(nodes.Get(0));
+    }
+
+    SystemWallClockMs clock;
+    clock.Start();
+    Simulator::Run();
+    double runMs = clock.End();
+
+    uint64_t received = delivery.received;
+    double segments = double(received) / segmentSize;
+    Time end = delivery.last;
+
+    std::cout << "bench-tcp-bulk " << flows << " x " << bytes << " bytes at " << rate << ", rtt "
+              << rtt.As(Time::US) << ", initial window " << bdpSegments << " segments"
+              << std::endl;
+    std::cout << "received: " << received << " bytes in " << end.As(Time::MS) << " ("
+              << received * 8 / std::max(end.GetSeconds(), 1e-9) / 1e9 << " Gbps)" << std::endl;
+    std::cout << "events: " << Simulator::GetEventCount() << std::endl;
+    std::cout << "run: " << runMs << " ms, " << runMs * 1e6 / std::max(segments, 1.0)
+              << " ns per segment, peak rss " << MemoryStats::GetPeakRss() << " KB" << std::endl;
+
+    Simulator::Destroy();
+    return 0;
+}
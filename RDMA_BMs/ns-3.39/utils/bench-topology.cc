@@ -0,0 +1,114 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program measures the setup time of a data center network built with DcTopologyHelper,
+// by default a k=16 fat-tree (1024 hosts, 320 switches): nodes and links, RDMA drivers, the
+// SwitchNode/RdmaHw routing tables and the host global routing. --legacy also times the global
+// routing of all nodes as Ipv4GlobalRoutingHelper::PopulateRoutingTables computes it, with the
+// LSDB and SPF calculation and with a BFS per router on --threads threads.
+// Sample usage:  ./ns3 run 'bench-topology --shape=fattree:16'
+
+#include "ns3/command-line.h"
+#include "ns3/dc-topology-helper.h"
+#include "ns3/global-route-manager.h"
+#include "ns3/memory-stats.h"
+#include "ns3/rdma-driver.h"
+#include "ns3/rdma-hw.h"
+#include "ns3/simulator.h"
+#include "ns3/system-wall-clock-ms.h"
+
+#include <iostream>
+
+using namespace ns3;
+
+int
+main(int argc, char* argv[])
+{
+    std::string shape = "fattree:16";
+    uint32_t mtu = 1000;
+    bool legacy = false;
+    uint32_t threads = 0;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("shape", "leafspine:h,l,s[,links], fattree:k or clos:h,l,s,pods,cores[,links]", shape);
+    cmd.AddValue("mtu", "payload bytes of a packet, for the pair tx delays", mtu);
+    cmd.AddValue("legacy", "also time the SPF and BFS global routing of all nodes", legacy);
+    cmd.AddValue("threads", "threads of the BFS global routing, 0 for one per core", threads);
+    cmd.Parse(argc, argv);
+
+    SystemWallClockMs clock;
+    SystemWallClockMs total;
+    total.Start();
+
+    DcTopologyHelper topo;
+    topo.SetShape(shape);
+    QbbHelper qbb;
+    clock.Start();
+    NodeContainer nodes = topo.Build(qbb);
+    double buildMs = clock.End();
+
+    clock.Start();
+    NodeContainer hosts = topo.GetNodes(DcTopologyHelper::HOST);
+    for (uint32_t i = 0; i < hosts.GetN(); i++)
+    {
+        Ptr<RdmaDriver> rdma = CreateObject<RdmaDriver>();
+        rdma->SetNode(hosts.Get(i));
+        rdma->SetRdmaHw(CreateObject<RdmaHw>());
+        hosts.Get(i)->AggregateObject(rdma);
+        rdma->Init();
+    }
+    double rdmaMs = clock.End();
+
+    clock.Start();
+    topo.PopulateRoutes(mtu);
+    double routesMs = clock.End();
+
+    clock.Start();
+    topo.PopulateGlobalRouting();
+    double globalMs = clock.End();
+
+    double legacyMs = 0;
+    double bfsMs = 0;
+    if (legacy)
+    {
+        clock.Start();
+        GlobalRouteManager::BuildGlobalRoutingDatabase();
+        GlobalRouteManager::InitializeRoutes();
+        legacyMs = clock.End();
+        GlobalRouteManager::DeleteGlobalRoutes();
+        clock.Start();
+        GlobalRouteManager::InitializeRoutesBfs(threads);
+        bfsMs = clock.End();
+    }
+    double totalMs = total.End();
+
+    std::cout << "bench-topology " << shape << ": " << topo.GetN(DcTopologyHelper::HOST) << " hosts, "
+              << nodes.GetN() - hosts.GetN() << " switches, " << topo.GetLinks().size() << " links"
+              << std::endl;
+    std::cout << "build: " << buildMs << " ms" << std::endl;
+    std::cout << "rdma drivers: " << rdmaMs << " ms" << std::endl;
+    std::cout << "routes: " << routesMs << " ms" << std::endl;
+    std::cout << "global routing: " << globalMs << " ms" << std::endl;
+    if (legacy)
+    {
+        std::cout << "spf global routing: " << legacyMs << " ms" << std::endl;
+        std::cout << "bfs global routing: " << bfsMs << " ms" << std::endl;
+    }
+    std::cout << "total: " << totalMs << " ms, peak rss " << MemoryStats::GetPeakRss() << " KB"
+              << std::endl;
+
+    Simulator::Destroy();
+    return 0;
+}